@@ -22,6 +22,7 @@
 
 #include <sys/shm.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
 #include <poll.h>
 #include <sys/un.h>
 #include <sys/uio.h>
@@ -110,8 +111,7 @@ static int make_inet_socket(int port)
 	return sock;
 }
 
-struct pollfd *pollfds;
-unsigned int pollfds_count = 0;
+int epoll_fd = -1;
 typedef struct waiter waiter_t;
 typedef int (*waiter_handler_t)(waiter_t *waiter, unsigned short events);
 struct waiter {
@@ -125,30 +125,25 @@ static void add_waiter(int fd, unsigned short events, waiter_handler_t handler,
 		void *data)
 {
 	waiter_t *w = &waiters[fd];
-	struct pollfd *pfd = &pollfds[pollfds_count];
+	struct epoll_event ev;
 	assert(!w->handler);
-	pfd->fd = fd;
-	pfd->events = events;
-	pfd->revents = 0;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = events;	/* POLL* and EPOLL* values match */
+	ev.data.fd = fd;
 	w->fd = fd;
 	w->private_data = data;
 	w->handler = handler;
-	pollfds_count++;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0)
+		SYSERROR("epoll_ctl add failed");
 }
 
 static void del_waiter(int fd)
 {
 	waiter_t *w = &waiters[fd];
-	unsigned int k;
 	assert(w->handler);
 	w->handler = 0;
-	for (k = 0; k < pollfds_count; ++k) {
-		if (pollfds[k].fd == fd)
-			break;
-	}
-	assert(k < pollfds_count);
-	pollfds_count--;
-	memmove(&pollfds[k], &pollfds[k + 1], pollfds_count - k);
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL) < 0)
+		SYSERROR("epoll_ctl del failed");
 }
 
 typedef struct client client_t;
@@ -436,6 +431,12 @@ static int pcm_shm_cmd(client_t *client)
 	case SNDRV_PCM_IOCTL_STATUS:
 		ctrl->result = snd_pcm_status(pcm, (snd_pcm_status_t *) &ctrl->u.status);
 		break;
+	case SND_PCM_IOCTL_STATUS_AVAIL:
+		/* coalesced status + avail_update, one round trip */
+		ctrl->result = snd_pcm_status(pcm, (snd_pcm_status_t *) &ctrl->u.status);
+		if (ctrl->result >= 0)
+			ctrl->result = snd_pcm_avail_update(pcm);
+		break;
 	case SND_PCM_IOCTL_STATE:
 		ctrl->result = snd_pcm_state(pcm);
 		break;
@@ -814,9 +815,13 @@ static int client_poll_handler(waiter_t *waiter, unsigned short events ATTRIBUTE
 	return 0;
 }
 
+#define CLIENT_CMD_BURST 16
+
 static int client_ctrl_handler(waiter_t *waiter, unsigned short events)
 {
 	client_t *client = waiter->private_data;
+	struct pollfd pfd;
+	int err, burst;
 	if (events & POLLHUP) {
 		if (client->open)
 			client->ops->close(client);
@@ -826,10 +831,21 @@ static int client_ctrl_handler(waiter_t *waiter, unsigned short events)
 		free(client);
 		return 0;
 	}
-	if (client->open)
-		return client->ops->cmd(client);
-	else
+	if (!client->open)
 		return snd_client_open(client);
+	/* drain the commands already pending on this wakeup instead of
+	 * going back through epoll_wait between them; bounded so that one
+	 * busy client cannot starve the others
+	 */
+	for (burst = 1; ; burst++) {
+		err = client->ops->cmd(client);
+		if (err < 0 || !client->open || burst >= CLIENT_CMD_BURST)
+			return err;
+		pfd.fd = client->ctrl_fd;
+		pfd.events = POLLIN;
+		if (poll(&pfd, 1, 0) != 1 || !(pfd.revents & POLLIN))
+			return 0;
+	}
 }
 
 static int inet_pending_handler(waiter_t *waiter, unsigned short events)
@@ -921,10 +937,12 @@ static int inet_handler(waiter_t *waiter, unsigned short events ATTRIBUTE_UNUSED
 	return 0;
 }
 
+#define EPOLL_EVENTS_MAX 64
+
 static int server(const char *sockname, int port)
 {
 	int err, result, sockn = -1, socki = -1;
-	unsigned int k;
+	int k, nfds;
 	long open_max;
 
 	if (!sockname && port < 0)
@@ -935,7 +953,12 @@ static int server(const char *sockname, int port)
 		SYSERROR("sysconf failed");
 		return result;
 	}
-	pollfds = calloc((size_t) open_max, sizeof(*pollfds));
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd < 0) {
+		result = -errno;
+		SYSERROR("epoll_create1 failed");
+		return result;
+	}
 	waiters = calloc((size_t) open_max, sizeof(*waiters));
 
 	if (sockname) {
@@ -972,28 +995,23 @@ static int server(const char *sockname, int port)
 	}
 
 	while (1) {
-		struct pollfd pfds[open_max];
-		size_t pfds_count;
-		do {
-			err = poll(pollfds, pollfds_count, -1);
-		} while (err == 0);
-		if (err < 0) {
-			SYSERROR("poll failed");
+		struct epoll_event evs[EPOLL_EVENTS_MAX];
+
+		nfds = epoll_wait(epoll_fd, evs, EPOLL_EVENTS_MAX, -1);
+		if (nfds < 0) {
+			if (errno == EINTR)
+				continue;
+			SYSERROR("epoll_wait failed");
 			continue;
 		}
-
-		pfds_count = pollfds_count;
-		memcpy(pfds, pollfds, sizeof(*pfds) * pfds_count);
-		for (k = 0; k < pfds_count; k++) {
-			struct pollfd *pfd = &pfds[k];
-			if (pfd->revents) {
-				waiter_t *w = &waiters[pfd->fd];
-				if (!w->handler)
-					continue;
-				err = w->handler(w, pfd->revents);
-				if (err < 0)
-					ERROR("waiter handler failed");
-			}
+		for (k = 0; k < nfds; k++) {
+			waiter_t *w = &waiters[evs[k].data.fd];
+			/* removed by an earlier handler of this batch */
+			if (!w->handler)
+				continue;
+			err = w->handler(w, evs[k].events);
+			if (err < 0)
+				ERROR("waiter handler failed");
 		}
 	}
  _end:
@@ -1001,7 +1019,8 @@ static int server(const char *sockname, int port)
 		close(sockn);
 	if (socki >= 0)
 		close(socki);
-	free(pollfds);
+	close(epoll_fd);
+	epoll_fd = -1;
 	free(waiters);
 	return result;
 }
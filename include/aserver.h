@@ -50,6 +50,7 @@ typedef enum _snd_transport_type {
 #define SND_PCM_IOCTL_HW_PTR_FD		_IO ('A', 0xf9)
 #define SND_PCM_IOCTL_APPL_PTR_FD	_IO ('A', 0xfa)
 #define SND_PCM_IOCTL_FORWARD		_IO ('A', 0xfb)
+#define SND_PCM_IOCTL_STATUS_AVAIL	_IO ('A', 0xfc)
 
 typedef struct {
 	snd_pcm_uframes_t ptr;
@@ -92,10 +92,14 @@ int snd_config_load(snd_config_t *config, snd_input_t *in);
 int snd_config_load_string(snd_config_t **config, const char *s, size_t size);
 int snd_config_load_override(snd_config_t *config, snd_input_t *in);
 int snd_config_save(snd_config_t *config, snd_output_t *out);
+int snd_config_save_cache(snd_config_t *config, const char *path);
+int snd_config_load_cache(snd_config_t **config, const char *path);
 int snd_config_update(void);
 int snd_config_update_r(snd_config_t **top, snd_config_update_t **update, const char *path);
 int snd_config_update_free(snd_config_update_t *update);
 int snd_config_update_free_global(void);
+int snd_config_update_watch(void);
+int snd_config_update_watch_free(void);
 
 int snd_config_update_ref(snd_config_t **top);
 void snd_config_ref(snd_config_t *top);
@@ -387,11 +387,16 @@ int snd_ctl_poll_descriptors_count(snd_ctl_t *ctl);
 int snd_ctl_poll_descriptors(snd_ctl_t *ctl, struct pollfd *pfds, unsigned int space);
 int snd_ctl_poll_descriptors_revents(snd_ctl_t *ctl, struct pollfd *pfds, unsigned int nfds, unsigned short *revents);
 int snd_ctl_subscribe_events(snd_ctl_t *ctl, int subscribe);
+int snd_ctl_event_filter_add_id(snd_ctl_t *ctl, const snd_ctl_elem_id_t *id);
+int snd_ctl_event_filter_add_numid(snd_ctl_t *ctl, unsigned int numid);
+int snd_ctl_event_filter_clear(snd_ctl_t *ctl);
 int snd_ctl_card_info(snd_ctl_t *ctl, snd_ctl_card_info_t *info);
 int snd_ctl_elem_list(snd_ctl_t *ctl, snd_ctl_elem_list_t *list);
 int snd_ctl_elem_info(snd_ctl_t *ctl, snd_ctl_elem_info_t *info);
 int snd_ctl_elem_read(snd_ctl_t *ctl, snd_ctl_elem_value_t *data);
 int snd_ctl_elem_write(snd_ctl_t *ctl, snd_ctl_elem_value_t *data);
+int snd_ctl_elem_read_many(snd_ctl_t *ctl, snd_ctl_elem_value_t **data, unsigned int count);
+int snd_ctl_elem_write_many(snd_ctl_t *ctl, snd_ctl_elem_value_t **data, unsigned int count);
 int snd_ctl_elem_lock(snd_ctl_t *ctl, snd_ctl_elem_id_t *id);
 int snd_ctl_elem_unlock(snd_ctl_t *ctl, snd_ctl_elem_id_t *id);
 int snd_ctl_elem_tlv_read(snd_ctl_t *ctl, const snd_ctl_elem_id_t *id,
@@ -423,6 +428,7 @@ int snd_ctl_set_power_state(snd_ctl_t *ctl, unsigned int state);
 int snd_ctl_get_power_state(snd_ctl_t *ctl, unsigned int *state);
 
 int snd_ctl_read(snd_ctl_t *ctl, snd_ctl_event_t *event);
+int snd_ctl_read_many(snd_ctl_t *ctl, snd_ctl_event_t *events, unsigned int count);
 int snd_ctl_wait(snd_ctl_t *ctl, int timeout);
 const char *snd_ctl_name(snd_ctl_t *ctl);
 snd_ctl_type_t snd_ctl_type(snd_ctl_t *ctl);
@@ -445,10 +451,18 @@ void snd_ctl_elem_list_free_space(snd_ctl_elem_list_t *obj);
 
 char *snd_ctl_ascii_elem_id_get(snd_ctl_elem_id_t *id);
 int snd_ctl_ascii_elem_id_parse(snd_ctl_elem_id_t *dst, const char *str);
+int snd_ctl_ascii_elem_id_parse_many(snd_ctl_elem_id_t *ids,
+				     unsigned int space,
+				     const char *str,
+				     const char **ret_ptr);
 int snd_ctl_ascii_value_parse(snd_ctl_t *handle,
 			      snd_ctl_elem_value_t *dst,
 			      snd_ctl_elem_info_t *info,
 			      const char *value);
+int snd_ctl_ascii_value_parse_many(snd_ctl_t *handle,
+				   const char *buf,
+				   snd_ctl_elem_value_t **values,
+				   unsigned int space);
 
 size_t snd_ctl_elem_id_sizeof(void);
 /** \hideinitializer
@@ -74,7 +74,7 @@ typedef int (snd_ctl_ext_tlv_rw_t)(snd_ctl_ext_t *ext, snd_ctl_ext_key_t key, in
  */
 #define SND_CTL_EXT_VERSION_MAJOR	1	/**< Protocol major version */
 #define SND_CTL_EXT_VERSION_MINOR	0	/**< Protocol minor version */
-#define SND_CTL_EXT_VERSION_TINY	1	/**< Protocol tiny version */
+#define SND_CTL_EXT_VERSION_TINY	2	/**< Protocol tiny version */
 /**
  * external plugin protocol version
  */
@@ -251,6 +251,23 @@ struct snd_ctl_ext_callback {
 	 * mangle the revents of poll descriptors
 	 */
 	int (*poll_revents)(snd_ctl_ext_t *ext, struct pollfd *pfds, unsigned int nfds, unsigned short *revents);
+	/**
+	 * fill the current element value directly in place via the
+	 * snd_ctl_elem_value_set_xxx() accessors; when defined (and the
+	 * protocol version is 1.0.2 or newer), it replaces the per-type
+	 * read callbacks including the get_attribute round trip, so
+	 * frequently polled elements avoid the intermediate copy;
+	 * optional (since protocol 1.0.2)
+	 */
+	int (*elem_read)(snd_ctl_ext_t *ext, snd_ctl_ext_key_t key,
+			 snd_ctl_elem_value_t *value);
+	/**
+	 * apply the element value read directly in place via the
+	 * snd_ctl_elem_value_get_xxx() accessors; the counterpart of
+	 * elem_read; optional (since protocol 1.0.2)
+	 */
+	int (*elem_write)(snd_ctl_ext_t *ext, snd_ctl_ext_key_t key,
+			  snd_ctl_elem_value_t *value);
 };
 
 /**
@@ -127,13 +127,26 @@ int snd_async_del_handler(snd_async_handler_t *handler);
 int snd_async_handler_get_fd(snd_async_handler_t *handler);
 int snd_async_handler_get_signo(snd_async_handler_t *handler);
 void *snd_async_handler_get_callback_private(snd_async_handler_t *handler);
+int snd_async_handler_get_poll_fd(snd_async_handler_t *handler);
+int snd_async_handler_dispatch(snd_async_handler_t *handler);
 
 struct snd_shm_area *snd_shm_area_create(int shmid, void *ptr);
+struct snd_shm_area *snd_shm_area_create_memfd(const char *name, size_t size,
+					       void **ptr);
 struct snd_shm_area *snd_shm_area_share(struct snd_shm_area *area);
+int snd_shm_area_get_fd(struct snd_shm_area *area);
 int snd_shm_area_destroy(struct snd_shm_area *area);
 
 int snd_user_file(const char *file, char **result);
 
+/** Memory held by a library subsystem, see #snd_lib_memstats */
+typedef struct _snd_lib_memstats {
+	unsigned long long bytes;	/**< bytes currently allocated */
+	unsigned long long objects;	/**< currently live objects */
+} snd_lib_memstats_t;
+
+int snd_lib_memstats(const char *subsystem, snd_lib_memstats_t *stats);
+
 #ifdef __GLIBC__
 #if !defined(_POSIX_C_SOURCE) && !defined(_POSIX_SOURCE)
 struct timeval {
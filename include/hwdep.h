@@ -105,6 +105,11 @@ typedef enum _snd_hwdep_type {
 /** HwDep handle */
 typedef struct _snd_hwdep snd_hwdep_t;
 
+struct iovec;
+
+/** transfer progress callback for #snd_hwdep_write_chunked */
+typedef int (*snd_hwdep_xfer_callback_t)(void *private_data, size_t xfer, size_t size);
+
 int snd_hwdep_open(snd_hwdep_t **hwdep, const char *name, int mode);
 int snd_hwdep_close(snd_hwdep_t *hwdep);
 int snd_hwdep_poll_descriptors(snd_hwdep_t *hwdep, struct pollfd *pfds, unsigned int space);
@@ -117,6 +122,13 @@ int snd_hwdep_dsp_load(snd_hwdep_t *hwdep, snd_hwdep_dsp_image_t *block);
 int snd_hwdep_ioctl(snd_hwdep_t *hwdep, unsigned int request, void * arg);
 ssize_t snd_hwdep_write(snd_hwdep_t *hwdep, const void *buffer, size_t size);
 ssize_t snd_hwdep_read(snd_hwdep_t *hwdep, void *buffer, size_t size);
+ssize_t snd_hwdep_writev(snd_hwdep_t *hwdep, const struct iovec *vector, int count);
+ssize_t snd_hwdep_readv(snd_hwdep_t *hwdep, const struct iovec *vector, int count);
+ssize_t snd_hwdep_write_chunked(snd_hwdep_t *hwdep, const void *buffer, size_t size,
+				size_t chunk_size,
+				snd_hwdep_xfer_callback_t callback, void *private_data);
+int snd_hwdep_mmap(snd_hwdep_t *hwdep, size_t size, off_t offset, void **bufp);
+int snd_hwdep_munmap(snd_hwdep_t *hwdep, void *buf, size_t size);
 
 size_t snd_hwdep_info_sizeof(void);
 /** allocate #snd_hwdep_info_t container on stack */
@@ -64,6 +64,7 @@ typedef enum _snd_input_type {
 } snd_input_type_t;
 
 int snd_input_stdio_open(snd_input_t **inputp, const char *file, const char *mode);
+int snd_input_file_open(snd_input_t **inputp, const char *file);
 int snd_input_stdio_attach(snd_input_t **inputp, FILE *fp, int _close);
 int snd_input_buffer_open(snd_input_t **inputp, const char *buffer, ssize_t size);
 int snd_input_close(snd_input_t *input);
@@ -78,6 +78,24 @@
 #error "Unsupported endian..."
 #endif
 
+/* resolve per-ISA clones of plain C hot loops once at load via the
+ * ifunc mechanism; the kernels the compiler can vectorize then use
+ * the widest vector unit of the running CPU while one binary keeps
+ * serving the compile time baseline elsewhere
+ */
+#ifdef HAVE_TARGET_CLONES
+#if defined(__x86_64__)
+#define SND_TARGET_CLONES \
+	__attribute__((target_clones("default,avx2,avx512f")))
+#elif defined(__aarch64__)
+#define SND_TARGET_CLONES \
+	__attribute__((target_clones("default,sve")))
+#endif
+#endif
+#ifndef SND_TARGET_CLONES
+#define SND_TARGET_CLONES
+#endif
+
 #ifndef HAVE_LFS
 #define stat64 stat
 #define lstat64 lstat
@@ -236,6 +254,8 @@ struct _snd_async_handler {
 	} u;
 	snd_async_callback_t callback;
 	void *private_data;
+	int event_fd;		/* pollable completion fd, -1 = signal mode */
+	struct _snd_async_handler *hash_next; /* fd hash bucket chain */
 	struct list_head glist;
 	struct list_head hlist;
 };
@@ -269,8 +289,13 @@ size_t snd_strlcpy(char *dst, const char *src, size_t size);
 #ifndef NDEBUG
 #define CHECK_SANITY(x) x
 extern snd_lib_error_handler_t snd_err_msg;
-#define SNDMSG(args...) snd_err_msg(__FILE__, __LINE__, __func__, 0, ##args)
-#define SYSMSG(args...) snd_err_msg(__FILE__, __LINE__, __func__, errno, ##args)
+extern int snd_err_msg_on;
+/* the test keeps the hot paths down to a load and a branch once the
+ * first message found the debug output disabled */
+#define SNDMSG(args...) do { if (snd_err_msg_on) \
+	snd_err_msg(__FILE__, __LINE__, __func__, 0, ##args); } while (0)
+#define SYSMSG(args...) do { if (snd_err_msg_on) \
+	snd_err_msg(__FILE__, __LINE__, __func__, errno, ##args); } while (0)
 #else
 #define CHECK_SANITY(x) 0 /* not evaluated */
 #define SNDMSG(args...) /* nop */
@@ -367,6 +392,10 @@ static inline int snd_open_device(const char *filename, int fmode)
 	snd1_config_check_hop
 #define snd_config_search_alias_hooks \
 	snd1_config_search_alias_hooks
+#define snd_config_update_generation \
+	snd1_config_update_generation
+#define snd_user_cache_path \
+	snd1_user_cache_path
 
 /* dlobj cache */
 void *snd_dlobj_cache_get(const char *lib, const char *name, const char *version, int verbose);
@@ -383,11 +412,68 @@ int snd_config_search_alias_hooks(snd_config_t *config,
                                   const char *base, const char *key,
 				  snd_config_t **result);
 
+/* generation counter for caches derived from the configuration */
+unsigned int snd_config_update_generation(void);
+
+/* per-user cache files */
+int snd_user_cache_path(const char *name, int create, char **result);
+
+/* subsystem-tagged allocation accounting backing snd_lib_memstats() */
+enum {
+	SND_MEMSTAT_CONFIG,
+	SND_MEMSTAT_HCTL,
+	SND_MEMSTAT_PCM,
+	SND_MEMSTAT_UCM,
+	SND_MEMSTAT_LAST
+};
+void snd_memstat_update(unsigned int subsys, ssize_t bytes, int objects);
+
+/* shared worker thread pool for threaded plugin features (threadpool.c) */
+typedef struct _snd_thread_pool snd_thread_pool_t;
+typedef struct _snd_thread_pool_batch {
+	unsigned int pending;
+} snd_thread_pool_batch_t;
+typedef struct _snd_thread_pool_job {
+	struct list_head list;
+	void (*func)(void *data);
+	void *data;
+	snd_thread_pool_batch_t *batch;
+} snd_thread_pool_job_t;
+snd_thread_pool_t *snd_thread_pool_get(void);
+void snd_thread_pool_submit(snd_thread_pool_t *pool,
+			    snd_thread_pool_job_t *job,
+			    void (*func)(void *data), void *data,
+			    snd_thread_pool_batch_t *batch, int critical);
+void snd_thread_pool_batch_wait(snd_thread_pool_t *pool,
+				snd_thread_pool_batch_t *batch);
+
 int _snd_conf_generic_id(const char *id);
 
+int _snd_input_buffer_window(snd_input_t *input, const unsigned char **ptr,
+			     size_t *size);
+
 int _snd_config_load_with_include(snd_config_t *config, snd_input_t *in,
 				  int override, const char * const *default_include_path);
 
+/*
+ * Static USDT tracepoints under the "alsa" provider (--enable-usdt);
+ * compiled out by default. When enabled, perf/bpftrace/systemtap can
+ * attach to running processes without a rebuild, e.g.
+ *   bpftrace -e 'usdt:/usr/lib/libasound.so.2:alsa:pcm_xrun { ... }'
+ */
+#ifdef ENABLE_USDT
+#include <sys/sdt.h>
+#define snd_trace(name)			DTRACE_PROBE(alsa, name)
+#define snd_trace1(name, a)		DTRACE_PROBE1(alsa, name, a)
+#define snd_trace2(name, a, b)		DTRACE_PROBE2(alsa, name, a, b)
+#define snd_trace3(name, a, b, c)	DTRACE_PROBE3(alsa, name, a, b, c)
+#else
+#define snd_trace(name)			do { } while (0)
+#define snd_trace1(name, a)		do { } while (0)
+#define snd_trace2(name, a, b)		do { } while (0)
+#define snd_trace3(name, a, b, c)	do { } while (0)
+#endif
+
 /* convenience macros */
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof(x[0]))
 
@@ -526,6 +526,7 @@ int snd_pcm_open_lconf(snd_pcm_t **pcm, const char *name,
 int snd_pcm_open_fallback(snd_pcm_t **pcm, snd_config_t *root,
 			  const char *name, const char *orig_name,
 			  snd_pcm_stream_t stream, int mode);
+int snd_pcm_clone(snd_pcm_t **pcmp, snd_pcm_t *pcm);
 
 int snd_pcm_close(snd_pcm_t *pcm);
 const char *snd_pcm_name(snd_pcm_t *pcm);
@@ -534,6 +535,7 @@ snd_pcm_stream_t snd_pcm_stream(snd_pcm_t *pcm);
 int snd_pcm_poll_descriptors_count(snd_pcm_t *pcm);
 int snd_pcm_poll_descriptors(snd_pcm_t *pcm, struct pollfd *pfds, unsigned int space);
 int snd_pcm_poll_descriptors_revents(snd_pcm_t *pcm, struct pollfd *pfds, unsigned int nfds, unsigned short *revents);
+unsigned int snd_pcm_poll_descriptors_generation(snd_pcm_t *pcm);
 int snd_pcm_nonblock(snd_pcm_t *pcm, int nonblock);
 static __inline__ int snd_pcm_abort(snd_pcm_t *pcm) { return snd_pcm_nonblock(pcm, 2); }
 int snd_async_add_pcm_handler(snd_async_handler_t **handler, snd_pcm_t *pcm, 
@@ -545,18 +547,23 @@ int snd_pcm_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t *params);
 int snd_pcm_hw_free(snd_pcm_t *pcm);
 int snd_pcm_sw_params_current(snd_pcm_t *pcm, snd_pcm_sw_params_t *params);
 int snd_pcm_sw_params(snd_pcm_t *pcm, snd_pcm_sw_params_t *params);
+int snd_pcm_configure(snd_pcm_t *pcm, snd_pcm_hw_params_t *params, snd_pcm_sw_params_t *swparams);
 int snd_pcm_prepare(snd_pcm_t *pcm);
 int snd_pcm_reset(snd_pcm_t *pcm);
 int snd_pcm_status(snd_pcm_t *pcm, snd_pcm_status_t *status);
+int snd_pcm_status_many(snd_pcm_t **pcms, snd_pcm_status_t **statuses,
+			unsigned int count);
 int snd_pcm_start(snd_pcm_t *pcm);
 int snd_pcm_drop(snd_pcm_t *pcm);
 int snd_pcm_drain(snd_pcm_t *pcm);
+int snd_pcm_drain_nowait(snd_pcm_t *pcm);
 int snd_pcm_pause(snd_pcm_t *pcm, int enable);
 snd_pcm_state_t snd_pcm_state(snd_pcm_t *pcm);
 int snd_pcm_hwsync(snd_pcm_t *pcm);
 int snd_pcm_delay(snd_pcm_t *pcm, snd_pcm_sframes_t *delayp);
 int snd_pcm_resume(snd_pcm_t *pcm);
 int snd_pcm_htimestamp(snd_pcm_t *pcm, snd_pcm_uframes_t *avail, snd_htimestamp_t *tstamp);
+int snd_pcm_audio_htimestamp(snd_pcm_t *pcm, snd_pcm_uframes_t *avail, snd_htimestamp_t *tstamp, snd_htimestamp_t *audio_tstamp);
 snd_pcm_sframes_t snd_pcm_avail(snd_pcm_t *pcm);
 snd_pcm_sframes_t snd_pcm_avail_update(snd_pcm_t *pcm);
 int snd_pcm_avail_delay(snd_pcm_t *pcm, snd_pcm_sframes_t *availp, snd_pcm_sframes_t *delayp);
@@ -570,8 +577,42 @@ snd_pcm_sframes_t snd_pcm_writen(snd_pcm_t *pcm, void **bufs, snd_pcm_uframes_t
 snd_pcm_sframes_t snd_pcm_readn(snd_pcm_t *pcm, void **bufs, snd_pcm_uframes_t size);
 int snd_pcm_wait(snd_pcm_t *pcm, int timeout);
 
+/** PCM wait set handle */
+typedef struct _snd_pcm_waitset snd_pcm_waitset_t;
+
+int snd_pcm_waitset_open(snd_pcm_waitset_t **waitsetp);
+int snd_pcm_waitset_close(snd_pcm_waitset_t *waitset);
+int snd_pcm_waitset_add(snd_pcm_waitset_t *waitset, snd_pcm_t *pcm);
+int snd_pcm_waitset_remove(snd_pcm_waitset_t *waitset, snd_pcm_t *pcm);
+int snd_pcm_waitset_wait(snd_pcm_waitset_t *waitset, int timeout,
+			 snd_pcm_t **ready, unsigned int space);
+
+/** PCM clock drift model handle */
+typedef struct _snd_pcm_clock_model snd_pcm_clock_model_t;
+
+size_t snd_pcm_clock_model_sizeof(void);
+/** \hideinitializer
+ * \brief allocate an invalid #snd_pcm_clock_model_t using standard alloca
+ * \param ptr returned pointer
+ */
+#define snd_pcm_clock_model_alloca(ptr) __snd_alloca(ptr, snd_pcm_clock_model)
+int snd_pcm_clock_model_malloc(snd_pcm_clock_model_t **ptr);
+void snd_pcm_clock_model_free(snd_pcm_clock_model_t *obj);
+void snd_pcm_clock_model_reset(snd_pcm_clock_model_t *model, unsigned int rate);
+int snd_pcm_clock_model_update(snd_pcm_clock_model_t *model,
+			       snd_pcm_uframes_t hw_ptr,
+			       const snd_htimestamp_t *tstamp);
+int snd_pcm_clock_model_feed(snd_pcm_clock_model_t *model, snd_pcm_t *pcm);
+double snd_pcm_clock_model_ratio(const snd_pcm_clock_model_t *model);
+int snd_pcm_clock_model_predict(const snd_pcm_clock_model_t *model,
+				const snd_htimestamp_t *tstamp,
+				snd_pcm_uframes_t *hw_ptr);
+
 int snd_pcm_link(snd_pcm_t *pcm1, snd_pcm_t *pcm2);
 int snd_pcm_unlink(snd_pcm_t *pcm);
+int snd_pcm_group_prepare(snd_pcm_t **pcms, unsigned int count);
+int snd_pcm_group_start(snd_pcm_t **pcms, unsigned int count);
+int snd_pcm_group_drain(snd_pcm_t **pcms, unsigned int count);
 
 /** channel mapping API version number */
 #define SND_CHMAP_API_VERSION	((1 << 16) | (0 << 8) | 1)
@@ -654,6 +695,7 @@ snd_pcm_chmap_query_t **snd_pcm_query_chmaps_from_hw(int card, int dev,
 						     snd_pcm_stream_t stream);
 void snd_pcm_free_chmaps(snd_pcm_chmap_query_t **maps);
 snd_pcm_chmap_t *snd_pcm_get_chmap(snd_pcm_t *pcm);
+int snd_pcm_get_chmap_buf(snd_pcm_t *pcm, snd_pcm_chmap_t *map, size_t maxlen);
 int snd_pcm_set_chmap(snd_pcm_t *pcm, const snd_pcm_chmap_t *map);
 
 const char *snd_pcm_chmap_type_name(enum snd_pcm_chmap_type val);
@@ -682,6 +724,40 @@ int snd_pcm_get_params(snd_pcm_t *pcm,
                        snd_pcm_uframes_t *buffer_size,
                        snd_pcm_uframes_t *period_size);
 
+/** PCM runtime statistics, see #snd_pcm_stats_get */
+typedef struct _snd_pcm_stats {
+	unsigned long long xruns;		/**< xruns handled by #snd_pcm_recover */
+	unsigned long long waits;		/**< #snd_pcm_wait calls entering poll */
+	unsigned long long wakeups;		/**< poll wakeups inside #snd_pcm_wait */
+	unsigned long long frames_written;	/**< frames accepted by write transfers */
+	unsigned long long frames_read;		/**< frames returned by read transfers */
+	unsigned long long mmap_commits;	/**< #snd_pcm_mmap_commit calls */
+	unsigned long long mmap_commit_frames;	/**< frames committed via mmap transfers */
+	unsigned long long reserved[9];		/**< reserved for future extensions */
+} snd_pcm_stats_t;
+
+int snd_pcm_stats_enable(snd_pcm_t *pcm, int enable);
+int snd_pcm_stats_get(snd_pcm_t *pcm, snd_pcm_stats_t *stats);
+int snd_pcm_stats_reset(snd_pcm_t *pcm);
+int snd_pcm_autotune_enable(snd_pcm_t *pcm,
+			    snd_pcm_uframes_t min_avail_min,
+			    snd_pcm_uframes_t max_avail_min);
+
+/** Scheduler recommendation for the thread driving a PCM,
+    see #snd_pcm_thread_hint */
+typedef struct _snd_pcm_thread_hint {
+	unsigned long long period_ns;	/**< activation period (one hardware period) */
+	unsigned long long runtime_ns;	/**< CPU budget per activation */
+	unsigned long long deadline_ns;	/**< relative deadline per activation */
+} snd_pcm_thread_hint_t;
+
+int snd_pcm_thread_hint(snd_pcm_t *pcm, unsigned long long cpu_ns_per_period,
+			snd_pcm_thread_hint_t *hint, int apply);
+
+int snd_pcm_open_trace_enable(int enable);
+int snd_pcm_open_trace_read(unsigned int index, const char **name,
+			    unsigned int *depth, unsigned long long *nsec);
+
 /** \} */
 
 /**
@@ -726,6 +802,7 @@ void snd_pcm_info_set_stream(snd_pcm_info_t *obj, snd_pcm_stream_t val);
  */
 
 int snd_pcm_hw_params_any(snd_pcm_t *pcm, snd_pcm_hw_params_t *params);
+int snd_pcm_hw_params_any_cached(snd_pcm_t *pcm, snd_pcm_hw_params_t *params);
 
 int snd_pcm_hw_params_can_mmap_sample_resolution(const snd_pcm_hw_params_t *params);
 int snd_pcm_hw_params_is_double(const snd_pcm_hw_params_t *params);
@@ -938,6 +1015,8 @@ int snd_pcm_sw_params_set_avail_min(snd_pcm_t *pcm, snd_pcm_sw_params_t *params,
 int snd_pcm_sw_params_get_avail_min(const snd_pcm_sw_params_t *params, snd_pcm_uframes_t *val);
 int snd_pcm_sw_params_set_period_event(snd_pcm_t *pcm, snd_pcm_sw_params_t *params, int val);
 int snd_pcm_sw_params_get_period_event(const snd_pcm_sw_params_t *params, int *val);
+int snd_pcm_sw_params_set_wait_spin_us(snd_pcm_t *pcm, snd_pcm_sw_params_t *params, unsigned int val);
+int snd_pcm_sw_params_get_wait_spin_us(const snd_pcm_sw_params_t *params, unsigned int *val);
 int snd_pcm_sw_params_set_start_threshold(snd_pcm_t *pcm, snd_pcm_sw_params_t *params, snd_pcm_uframes_t val);
 int snd_pcm_sw_params_get_start_threshold(const snd_pcm_sw_params_t *paramsm, snd_pcm_uframes_t *val);
 int snd_pcm_sw_params_set_stop_threshold(snd_pcm_t *pcm, snd_pcm_sw_params_t *params, snd_pcm_uframes_t val);
@@ -1138,6 +1217,8 @@ int snd_pcm_mmap_begin(snd_pcm_t *pcm,
 snd_pcm_sframes_t snd_pcm_mmap_commit(snd_pcm_t *pcm,
 				      snd_pcm_uframes_t offset,
 				      snd_pcm_uframes_t frames);
+int snd_pcm_mmap_mirror(snd_pcm_t *pcm, int enable);
+int snd_pcm_mmap_mirrored(snd_pcm_t *pcm);
 snd_pcm_sframes_t snd_pcm_mmap_writei(snd_pcm_t *pcm, const void *buffer, snd_pcm_uframes_t size);
 snd_pcm_sframes_t snd_pcm_mmap_readi(snd_pcm_t *pcm, void *buffer, snd_pcm_uframes_t size);
 snd_pcm_sframes_t snd_pcm_mmap_writen(snd_pcm_t *pcm, void **bufs, snd_pcm_uframes_t size);
@@ -1193,6 +1274,13 @@ int snd_pcm_areas_copy_wrap(const snd_pcm_channel_area_t *dst_channels,
 			    const unsigned int channels,
 			    snd_pcm_uframes_t frames,
 			    const snd_pcm_format_t format);
+int snd_pcm_format_convert(const snd_pcm_channel_area_t *dst_areas,
+			   snd_pcm_uframes_t dst_offset,
+			   snd_pcm_format_t dst_format,
+			   const snd_pcm_channel_area_t *src_areas,
+			   snd_pcm_uframes_t src_offset,
+			   snd_pcm_format_t src_format,
+			   unsigned int channels, snd_pcm_uframes_t frames);
 
 /**
  * \brief get the address of the given PCM channel area
@@ -1364,6 +1452,22 @@ int snd_spcm_init_duplex(snd_pcm_t *playback_pcm,
 			 snd_spcm_xrun_type_t xrun_type,
 			 snd_spcm_duplex_type_t duplex_type);
 
+/** Simple PCM parameter preset - a known-good configuration,
+    usually defined at build time */
+typedef struct _snd_spcm_preset {
+	const char *name;		/**< preset name for error messages */
+	unsigned int rate;		/**< sample rate in Hz */
+	unsigned int channels;		/**< channels count */
+	snd_pcm_format_t format;	/**< sample format */
+	snd_pcm_subformat_t subformat;	/**< subformat */
+	snd_pcm_access_t access;	/**< access type */
+	unsigned int buffer_time;	/**< ring buffer length in us */
+	unsigned int period_time;	/**< period time in us (0 = three periods) */
+	snd_spcm_xrun_type_t xrun_type;	/**< xrun handling */
+} snd_spcm_preset_t;
+
+int snd_spcm_init_preset(snd_pcm_t *pcm, const snd_spcm_preset_t *preset);
+
 int snd_spcm_init_get_params(snd_pcm_t *pcm,
 			     unsigned int *rate,
 			     snd_pcm_uframes_t *buffer_size,
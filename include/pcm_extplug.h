@@ -60,7 +60,7 @@ typedef snd_pcm_extplug_callback snd_pcm_extplug_callback_t;
  */
 #define SND_PCM_EXTPLUG_VERSION_MAJOR	1	/**< Protocol major version */
 #define SND_PCM_EXTPLUG_VERSION_MINOR	0	/**< Protocol minor version */
-#define SND_PCM_EXTPLUG_VERSION_TINY	2	/**< Protocol tiny version */
+#define SND_PCM_EXTPLUG_VERSION_TINY	3	/**< Protocol tiny version */
 /**
  * Filter-plugin protocol version
  */
@@ -123,8 +123,23 @@ struct snd_pcm_extplug {
 	 * slave_channels hw parameter; filled after hw_params is caled
 	 */
 	unsigned int slave_channels;
+	/**
+	 * optional flags (SND_PCM_EXTPLUG_FLAG_XXX); can be filled before
+	 * calling #snd_pcm_extplug_create(); since v1.0.3
+	 */
+	unsigned int flags;
 };
 
+/**
+ * Bit flag: the transfer callback handles the in-place processing,
+ * i.e. it works correctly when the dst and src areas refer to the very
+ * same data.  When the flag is set (and the plugin keeps the client
+ * and slave parameters identical), no intermediate buffer is created
+ * for the mmap access modes; the client mmap area maps the slave
+ * buffer directly and one full copy per transfer is saved.
+ */
+#define SND_PCM_EXTPLUG_FLAG_INPLACE	(1 << 0)
+
 /** Callback table of extplug */
 struct snd_pcm_extplug_callback {
 	/**
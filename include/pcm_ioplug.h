@@ -73,7 +73,7 @@ typedef snd_pcm_ioplug_callback snd_pcm_ioplug_callback_t;
  */
 #define SND_PCM_IOPLUG_VERSION_MAJOR	1	/**< Protocol major version */
 #define SND_PCM_IOPLUG_VERSION_MINOR	0	/**< Protocol minor version */
-#define SND_PCM_IOPLUG_VERSION_TINY	2	/**< Protocol tiny version */
+#define SND_PCM_IOPLUG_VERSION_TINY	3	/**< Protocol tiny version */
 /**
  * IO-plugin protocol version
  */
@@ -211,6 +211,22 @@ struct snd_pcm_ioplug_callback {
 	 * set the channel map; optional; since v1.0.2
 	 */
 	int (*set_chmap)(snd_pcm_ioplug_t *io, const snd_pcm_chmap_t *map);
+	/**
+	 * get the current DMA position together with its validity horizon;
+	 * optional; since v1.0.3, called inside mutex lock
+	 *
+	 * The callback returns the buffer position like the pointer
+	 * callback and stores into \a avail the number of frames by which
+	 * the position is guaranteed not to advance; alsa-lib then skips
+	 * further pointer queries until that many frames' worth of
+	 * wall-clock time has elapsed.  A plugin whose position advances
+	 * in fixed quanta (e.g. one server cycle) reports the distance to
+	 * the next quantum boundary.  Storing 0 disables the skipping for
+	 * this query.  When this callback is set, the pointer callback
+	 * is not used.
+	 */
+	snd_pcm_sframes_t (*pointer_with_avail)(snd_pcm_ioplug_t *io,
+						snd_pcm_uframes_t *avail);
 };
 
 
@@ -177,6 +177,26 @@ int _snd_pcm_rate_open(snd_pcm_t **pcmp, const char *name,
 		       snd_config_t *root, snd_config_t *conf,
 		       snd_pcm_stream_t stream, int mode);
 
+/*
+ *  Multi streams plugin
+ */
+int snd_pcm_multi_open(snd_pcm_t **pcmp, const char *name,
+		       unsigned int slaves_count, unsigned int master_slave,
+		       snd_pcm_t **slaves_pcm, unsigned int *schannels_count,
+		       unsigned int channels_count,
+		       int *sidxs, unsigned int *schannels,
+		       int close_slaves);
+int _snd_pcm_multi_open(snd_pcm_t **pcmp, const char *name,
+			snd_config_t *root, snd_config_t *conf,
+			snd_pcm_stream_t stream, int mode);
+
+/*
+ *  Routing graph plugin
+ */
+int _snd_pcm_graph_open(snd_pcm_t **pcmp, const char *name,
+			snd_config_t *root, snd_config_t *conf,
+			snd_pcm_stream_t stream, int mode);
+
 /*
  *  Hooks plugin
  */
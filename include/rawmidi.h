@@ -166,8 +166,23 @@ int snd_rawmidi_status(snd_rawmidi_t *rmidi, snd_rawmidi_status_t * status);
 int snd_rawmidi_drain(snd_rawmidi_t *rmidi);
 int snd_rawmidi_drop(snd_rawmidi_t *rmidi);
 ssize_t snd_rawmidi_write(snd_rawmidi_t *rmidi, const void *buffer, size_t size);
+int snd_rawmidi_output_buffer_mode(snd_rawmidi_t *rmidi, size_t size, unsigned int deadline);
+int snd_rawmidi_output_flush(snd_rawmidi_t *rmidi);
+int snd_rawmidi_output_pending(snd_rawmidi_t *rmidi);
 ssize_t snd_rawmidi_read(snd_rawmidi_t *rmidi, void *buffer, size_t size);
+int snd_rawmidi_input_ring(snd_rawmidi_t *rmidi, size_t size);
+ssize_t snd_rawmidi_read_begin(snd_rawmidi_t *rmidi, const unsigned char **buf);
+int snd_rawmidi_read_done(snd_rawmidi_t *rmidi, size_t size);
 ssize_t snd_rawmidi_tread(snd_rawmidi_t *rmidi, struct timespec *tstamp, void *buffer, size_t size);
+
+/** one timestamped input frame filled by #snd_rawmidi_tread_frames */
+typedef struct _snd_rawmidi_frame {
+	struct timespec tstamp;		/**< frame timestamp */
+	const unsigned char *data;	/**< MIDI bytes, borrowed from the handle */
+	size_t length;			/**< count of MIDI bytes */
+} snd_rawmidi_frame_t;
+
+ssize_t snd_rawmidi_tread_frames(snd_rawmidi_t *rmidi, snd_rawmidi_frame_t *frames, size_t space);
 const char *snd_rawmidi_name(snd_rawmidi_t *rmidi);
 snd_rawmidi_type_t snd_rawmidi_type(snd_rawmidi_t *rmidi);
 snd_rawmidi_stream_t snd_rawmidi_stream(snd_rawmidi_t *rawmidi);
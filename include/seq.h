@@ -514,6 +514,9 @@ void snd_seq_queue_tempo_set_skew_base(snd_seq_queue_tempo_t *info, unsigned int
 void snd_seq_queue_tempo_set_tempo_base(snd_seq_queue_tempo_t *info, unsigned int tempo_base);
 
 int snd_seq_get_queue_tempo(snd_seq_t *handle, int q, snd_seq_queue_tempo_t *tempo);
+int snd_seq_get_queue_tempo_cached(snd_seq_t *handle, int q, snd_seq_queue_tempo_t *tempo);
+unsigned long long snd_seq_queue_tempo_tick_to_ns(const snd_seq_queue_tempo_t *tempo, snd_seq_tick_time_t tick);
+snd_seq_tick_time_t snd_seq_queue_tempo_ns_to_tick(const snd_seq_queue_tempo_t *tempo, unsigned long long ns);
 int snd_seq_set_queue_tempo(snd_seq_t *handle, int q, snd_seq_queue_tempo_t *tempo);
 int snd_seq_has_queue_tempo_base(snd_seq_t *handle);
 
@@ -563,7 +566,14 @@ int snd_seq_event_output_buffer(snd_seq_t *handle, snd_seq_event_t *ev);
 int snd_seq_event_output_direct(snd_seq_t *handle, snd_seq_event_t *ev);
 int snd_seq_event_input(snd_seq_t *handle, snd_seq_event_t **ev);
 int snd_seq_event_input_pending(snd_seq_t *seq, int fetch_sequencer);
+int snd_seq_event_input_batch_size(snd_seq_t *seq);
 int snd_seq_drain_output(snd_seq_t *handle);
+int snd_seq_drain_output_nowait(snd_seq_t *handle);
+int snd_seq_set_output_flush_policy(snd_seq_t *handle, unsigned int count, unsigned int time_us);
+int snd_seq_set_output_staging(snd_seq_t *handle, size_t size);
+int snd_seq_set_output_pool_adaptive(snd_seq_t *handle, size_t max_size);
+int snd_seq_get_output_pool_stats(snd_seq_t *handle, unsigned int *full_count, unsigned int *grow_count);
+int snd_seq_event_output_staged(snd_seq_t *handle, snd_seq_event_t *ev);
 int snd_seq_event_output_pending(snd_seq_t *seq);
 int snd_seq_extract_output(snd_seq_t *handle, snd_seq_event_t **ev);
 int snd_seq_drop_output(snd_seq_t *handle);
@@ -51,6 +51,8 @@ void snd_midi_event_reset_decode(snd_midi_event_t *dev);
 void snd_midi_event_no_status(snd_midi_event_t *dev, int on);
 /* encode from byte stream - return number of written bytes if success */
 long snd_midi_event_encode(snd_midi_event_t *dev, const unsigned char *buf, long count, snd_seq_event_t *ev);
+long snd_midi_event_encode_direct(snd_midi_event_t *dev, const unsigned char *buf, long count, snd_seq_event_t *ev);
+long snd_midi_event_encode_buffer(snd_midi_event_t *dev, const unsigned char *buf, long count, snd_seq_event_t *evs, long max_events, long *nevents);
 int snd_midi_event_encode_byte(snd_midi_event_t *dev, int c, snd_seq_event_t *ev);
 /* decode from event to bytes - return number of written bytes if success */
 long snd_midi_event_decode(snd_midi_event_t *dev, unsigned char *buf, long count, const snd_seq_event_t *ev);
@@ -325,6 +325,17 @@ static inline int snd_seq_ev_set_ump_data(snd_seq_ump_event_t *ev, void *data, s
 /* set and send a queue control event */
 int snd_seq_control_queue(snd_seq_t *seq, int q, int type, int value, snd_seq_event_t *ev);
 
+/** one queue control command for #snd_seq_control_queue_batch */
+typedef struct snd_seq_queue_control_cmd {
+	int type;	/**< event type, e.g. #SND_SEQ_EVENT_START */
+	int value;	/**< event value, e.g. the tempo */
+} snd_seq_queue_control_cmd_t;
+
+/* pack several queue control events into one output flush */
+int snd_seq_control_queue_batch(snd_seq_t *seq, int q,
+				const snd_seq_queue_control_cmd_t *cmds,
+				int count, snd_seq_event_t *ev);
+
 /**
  * \brief start the specified queue
  * \param seq sequencer handle
@@ -388,6 +399,9 @@ int snd_seq_set_client_pool_output_room(snd_seq_t *seq, size_t size);
 int snd_seq_set_client_pool_input(snd_seq_t *seq, size_t size);
 /* sync output queue */
 int snd_seq_sync_output_queue(snd_seq_t *seq);
+/* event-driven queue sync via an echo completion event */
+int snd_seq_sync_queue_request(snd_seq_t *seq, int q, int port, unsigned int cookie);
+int snd_seq_sync_queue_done(snd_seq_t *seq, const snd_seq_event_t *ev, unsigned int cookie);
 
 /*
  * parse the given string and get the sequencer address
@@ -143,6 +143,8 @@ int snd_timer_query_open(snd_timer_query_t **handle, const char *name, int mode)
 int snd_timer_query_open_lconf(snd_timer_query_t **handle, const char *name, int mode, snd_config_t *lconf);
 int snd_timer_query_close(snd_timer_query_t *handle);
 int snd_timer_query_next_device(snd_timer_query_t *handle, snd_timer_id_t *tid);
+int snd_timer_query_next_device_cached(snd_timer_query_t *handle, snd_timer_id_t *tid);
+void snd_timer_query_cache_flush(void);
 int snd_timer_query_info(snd_timer_query_t *handle, snd_timer_ginfo_t *info);
 int snd_timer_query_params(snd_timer_query_t *handle, snd_timer_gparams_t *params);
 int snd_timer_query_status(snd_timer_query_t *handle, snd_timer_gstatus_t *status);
@@ -159,10 +161,32 @@ int snd_timer_poll_descriptors_revents(snd_timer_t *timer, struct pollfd *pfds,
 int snd_timer_info(snd_timer_t *handle, snd_timer_info_t *timer);
 int snd_timer_params(snd_timer_t *handle, snd_timer_params_t *params);
 int snd_timer_status(snd_timer_t *handle, snd_timer_status_t *status);
+int snd_timer_status_cached(snd_timer_t *handle, snd_timer_status_t *status);
 int snd_timer_start(snd_timer_t *handle);
 int snd_timer_stop(snd_timer_t *handle);
 int snd_timer_continue(snd_timer_t *handle);
 ssize_t snd_timer_read(snd_timer_t *handle, void *buffer, size_t size);
+int snd_timer_tread_ring(snd_timer_t *handle, size_t events);
+ssize_t snd_timer_tread_begin(snd_timer_t *handle, const snd_timer_tread_t **evs);
+int snd_timer_tread_done(snd_timer_t *handle, size_t events);
+
+/** timer multiplexer handle */
+typedef struct _snd_timer_mux snd_timer_mux_t;
+/** timer multiplexer subscription handle */
+typedef struct _snd_timer_mux_sub snd_timer_mux_sub_t;
+/** timer multiplexer subscription callback; \a intervals is the count
+ *  of subscription intervals elapsed since the last dispatch */
+typedef void (*snd_timer_mux_callback_t)(void *private_data, unsigned int intervals);
+
+int snd_timer_mux_open(snd_timer_mux_t **muxp, const char *name, int mode);
+int snd_timer_mux_close(snd_timer_mux_t *mux);
+int snd_timer_mux_poll_descriptors_count(snd_timer_mux_t *mux);
+int snd_timer_mux_poll_descriptors(snd_timer_mux_t *mux, struct pollfd *pfds, unsigned int space);
+int snd_timer_mux_subscribe(snd_timer_mux_sub_t **subp, snd_timer_mux_t *mux,
+			    unsigned long long interval_ns,
+			    snd_timer_mux_callback_t callback, void *private_data);
+int snd_timer_mux_unsubscribe(snd_timer_mux_sub_t *sub);
+int snd_timer_mux_handle_events(snd_timer_mux_t *mux);
 
 size_t snd_timer_id_sizeof(void);
 /** allocate #snd_timer_id_t container on stack */
@@ -201,16 +201,19 @@ extern "C" {
  * <pre>
  * SectionData."pdata for EQU1" {
  *	file "/path/to/file"
+ *	base64 "EjRWeA=="
  *	bytes "0x12,0x34,0x56,0x78"
  *	shorts "0x1122,0x3344,0x5566,0x7788"
  *	words "0xaabbccdd,0x11223344,0x66aa77bb,0xefef1234"
  *	tuples "section id of the vendor tuples"
  * };
  * </pre>
- * The file, bytes, shorts, words and tuples keywords are all mutually
+ * The file, base64, bytes, shorts, words and tuples keywords are all mutually
  * exclusive as the private data should only be taken from one source.
  * The private data can either be read from a separate file or defined in
- * the topology file using the bytes, shorts, words or tuples keywords.
+ * the topology file using the base64, bytes, shorts, words or tuples
+ * keywords.  Large opaque blobs are best kept in a raw binary file or as
+ * base64, which avoid the per-value hex parsing.
  * The keyword tuples is to define vendor specific tuples. Please refer to
  * section Vendor Tokens and Vendor tuples.
  *
@@ -772,6 +775,7 @@ enum snd_tplg_type {
 /** Flags for the snd_tplg_create */
 #define SND_TPLG_CREATE_VERBOSE		(1<<0)	/*!< Verbose output */
 #define SND_TPLG_CREATE_DAPM_NOSORT	(1<<1)	/*!< Do not sort DAPM objects by index */
+#define SND_TPLG_CREATE_PARALLEL	(1<<2)	/*!< Parse topology sections on a worker pool */
 
 /**
  * \brief Return the version of the topology library.
@@ -1115,6 +1119,18 @@ int snd_tplg_add_object(snd_tplg_t *tplg, snd_tplg_obj_template_t *t);
  */
 int snd_tplg_build(snd_tplg_t *tplg, const char *outfile);
 
+/**
+ * \brief Build all registered topology data to a file descriptor.
+ * \param tplg Topology instance.
+ * \param fd File descriptor opened for writing.
+ * \return Zero on success, otherwise a negative error code
+ *
+ * The binary image is assembled in memory and written to the given
+ * descriptor as one stream, so it can go to a pipe or socket as well
+ * as to a regular file.  The descriptor is not closed.
+ */
+int snd_tplg_build_to_fd(snd_tplg_t *tplg, int fd);
+
 /**
  * \brief Build all registered topology data into memory.
  * \param tplg Topology instance.
@@ -1172,6 +1188,61 @@ int snd_tplg_save(snd_tplg_t *tplg, char **dst, int flags);
  */
 int snd_tplg_decode(snd_tplg_t *tplg, void *bin, size_t size, int dflags);
 
+/** Read-only view of one section block of a binary topology image.
+ *  The payload pointer refers into the caller's buffer (which may be a
+ *  read-only file mapping); nothing is copied.
+ */
+typedef struct snd_tplg_sect_view {
+	int type;		/*!< object type (SND_TPLG_TYPE_*), negative if unknown */
+	unsigned int index;	/*!< block index */
+	unsigned int count;	/*!< number of objects in the block */
+	unsigned int vendor_type;	/*!< vendor type */
+	unsigned int version;	/*!< block version */
+	size_t pos;		/*!< payload offset in the image */
+	const void *payload;	/*!< block payload in the source buffer */
+	size_t payload_size;	/*!< block payload size in bytes */
+} snd_tplg_sect_view_t;
+
+/** Callback for snd_tplg_scan(); a non-zero return value stops the
+ *  scan and is passed back to the caller.
+ */
+typedef int (*snd_tplg_scan_cb_t)(const snd_tplg_sect_view_t *view,
+				  void *private_data);
+
+/**
+ * \brief Scan the section blocks of a binary topology image.
+ * \param bin Binary topology input buffer (may be a read-only mapping).
+ * \param size Binary topology input buffer size.
+ * \param callback Function called for each section block.
+ * \param private_data Opaque pointer passed to the callback.
+ * \return Zero on success, otherwise a negative error code or the
+ *         first non-zero callback return value.
+ *
+ * Walks and validates the block headers only; the payloads are neither
+ * parsed nor copied, so the scan cost is independent of the element
+ * sizes.  Useful to build a section index over a mapped file or to
+ * locate a single section without decoding the whole image.
+ */
+int snd_tplg_scan(const void *bin, size_t size,
+		  snd_tplg_scan_cb_t callback, void *private_data);
+
+/**
+ * \brief Decode only the matching sections of a binary topology image.
+ * \param tplg Topology instance.
+ * \param bin Binary topology input buffer.
+ * \param size Binary topology input buffer size.
+ * \param type Object type to decode (SND_TPLG_TYPE_*).
+ * \param index Block index to decode, or SND_TPLG_INDEX_ALL.
+ * \param dflags - not used, must be set to 0.
+ * \return Zero on success, otherwise a negative error code
+ *
+ * Like snd_tplg_decode(), but only the blocks matching the given type
+ * (and index) are decoded into elements; the payloads of all other
+ * blocks are skipped without being parsed or copied.
+ */
+int snd_tplg_decode_section(snd_tplg_t *tplg, void *bin, size_t size,
+			    int type, int index, int dflags);
+
 /** \} */
 
 #ifdef __cplusplus
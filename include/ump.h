@@ -9,6 +9,8 @@
 #ifndef __ALSA_UMP_H
 #define __ALSA_UMP_H
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -42,6 +44,9 @@ int snd_ump_drop(snd_ump_t *ump);
 int snd_ump_drain(snd_ump_t *ump);
 ssize_t snd_ump_write(snd_ump_t *ump, const void *buffer, size_t size);
 ssize_t snd_ump_read(snd_ump_t *ump, void *buffer, size_t size);
+int snd_ump_input_ring(snd_ump_t *ump, size_t size);
+ssize_t snd_ump_read_begin(snd_ump_t *ump, const uint32_t **buf);
+int snd_ump_read_done(snd_ump_t *ump, size_t size);
 ssize_t snd_ump_tread(snd_ump_t *ump, struct timespec *tstamp, void *buffer, size_t size);
 
 /** Max number of UMP Groups */
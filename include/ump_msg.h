@@ -1085,6 +1085,11 @@ static inline uint8_t snd_ump_get_byte(const uint32_t *ump, unsigned int offset)
 int snd_ump_msg_sysex_expand(const uint32_t *ump, uint8_t *buf, size_t maxlen,
 			     size_t *filled);
 int snd_ump_packet_length(unsigned int type);
+ssize_t snd_ump_msgs_to_midi1(const uint32_t *ump, size_t *words,
+			      uint8_t *buf, size_t maxlen);
+ssize_t snd_ump_msgs_from_midi1(const uint8_t *buf, size_t *len,
+				unsigned int group, uint32_t *ump,
+				size_t words);
 
 #ifdef __cplusplus
 }
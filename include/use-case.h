@@ -492,6 +492,29 @@ int snd_use_case_mgr_open(snd_use_case_mgr_t **uc_mgr,
  */
 int snd_use_case_mgr_reload(snd_use_case_mgr_t *uc_mgr);
 
+/**
+ * \brief Watch the use case configuration files for changes.
+ * \param uc_mgr Use case manager
+ * \return a pollable file descriptor if success, otherwise a negative
+ *         error code
+ *
+ * Registers inotify watches for the configuration files the manager
+ * contents were parsed from and returns a file descriptor which becomes
+ * readable (POLLIN) when some of them may have changed.  The descriptor
+ * is owned by the manager and stays valid until #snd_use_case_mgr_close.
+ * After a wakeup, refresh the manager with #snd_use_case_mgr_reload and
+ * call this function again; the repeated call drains the pending events
+ * and registers watches for files added by the reload, returning the
+ * same descriptor.
+ *
+ * The parent directories of the files are watched, so a file replaced
+ * by rename (the usual editor behaviour) or re-created is noticed, too.
+ * Changes to unrelated files in the same directories may cause spurious
+ * wakeups; a wakeup only means that a reload may be needed, not that
+ * the configuration contents differ.
+ */
+int snd_use_case_mgr_watch(snd_use_case_mgr_t *uc_mgr);
+
 /**
  * \brief Close use case manager
  * \param uc_mgr Use case manager
@@ -131,11 +131,19 @@ static struct alisp_object * new_object(struct alisp_instance *instance, int typ
 	struct alisp_object * p;
 
 	if (list_empty(&instance->free_objs_list)) {
-		p = (struct alisp_object *)malloc(sizeof(struct alisp_object));
-		if (p == NULL) {
-			nomem();
-			return NULL;
+		struct alisp_slab *slab = instance->slabs;
+		if (slab == NULL || slab->used >= ALISP_SLAB_OBJS) {
+			slab = (struct alisp_slab *)malloc(sizeof(struct alisp_slab));
+			if (slab == NULL) {
+				nomem();
+				return NULL;
+			}
+			slab->next = instance->slabs;
+			slab->used = 0;
+			instance->slabs = slab;
+			lisp_debug(instance, "allocating slab %p", slab);
 		}
+		p = &slab->objs[slab->used++];
 		lisp_debug(instance, "allocating cons %p", p);
 	} else {
 		p = (struct alisp_object *)instance->free_objs_list.next;
@@ -189,11 +197,6 @@ static void delete_object(struct alisp_instance *instance, struct alisp_object *
 	list_del(&p->list);
 	instance->used_objs--;
 	free_object(p);
-	if (instance->free_objs >= ALISP_FREE_OBJ_POOL) {
-		lisp_debug(instance, "freed cons %p", p);
-		free(p);
-		return;
-	}
 	lisp_debug(instance, "moved cons %p to free list", p);
 	list_add(&p->list, &instance->free_objs_list);
 	instance->free_objs++;
@@ -287,11 +290,15 @@ static void free_objects(struct alisp_instance *instance)
 				delete_object(instance, p);
 			}
 		}
-	list_for_each_safe(pos, pos1, &instance->free_objs_list) {
-		p = list_entry(pos, struct alisp_object, list);
-		list_del(&p->list);
-		free(p);
-		lisp_debug(instance, "freed (all) cons %p", p);
+	/* all objects live in the slabs, so the free list entries
+	 * go away together with them */
+	INIT_LIST_HEAD(&instance->free_objs_list);
+	instance->free_objs = 0;
+	while (instance->slabs) {
+		struct alisp_slab *slab = instance->slabs;
+		instance->slabs = slab->next;
+		lisp_debug(instance, "freeing slab %p", slab);
+		free(slab);
 	}
 }
 
@@ -119,7 +119,13 @@ struct alisp_object_pair {
 #define ALISP_OBJ_PAIR_HASH_SHIFT 4
 #define ALISP_OBJ_PAIR_HASH_SIZE (1<<ALISP_OBJ_PAIR_HASH_SHIFT)
 #define ALISP_OBJ_PAIR_HASH_MASK (ALISP_OBJ_PAIR_HASH_SIZE-1)
-#define ALISP_FREE_OBJ_POOL	512	/* free objects above this pool */
+#define ALISP_SLAB_OBJS		128	/* objects per allocation slab */
+
+struct alisp_slab {
+	struct alisp_slab *next;
+	size_t used;			/* objects carved from this slab */
+	struct alisp_object objs[ALISP_SLAB_OBJS];
+};
 
 struct alisp_instance {
 	int verbose: 1,
@@ -145,6 +151,7 @@ struct alisp_instance {
 	long used_objs;
 	long max_objs;
 	struct list_head free_objs_list;
+	struct alisp_slab *slabs;	/* object slabs, freed in one sweep */
 	struct list_head used_objs_list[ALISP_OBJ_PAIR_HASH_SIZE][ALISP_OBJ_LAST_SEARCH + 1];
 	/* set object */
 	struct list_head setobjs_list[ALISP_OBJ_PAIR_HASH_SIZE];
@@ -27,6 +27,9 @@
 #include "pcm/pcm_local.h"
 #include "control/control_local.h"
 #include <signal.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
 
 static struct sigaction previous_action;
 #ifndef DOC_HIDDEN
@@ -54,6 +57,64 @@ static const int snd_async_signo = SIGIO;
 
 static LIST_HEAD(snd_async_handlers);
 
+/* fd-indexed hash so the signal handler finds its targets without
+ * scanning the whole handler list; the buckets are singly linked
+ * chains updated only in application context.  An insert publishes
+ * the chain pointer before the bucket head, so a signal arriving
+ * concurrently sees either the old or the new chain, never a torn
+ * one; removal has the same exposure as the old global list walk.
+ */
+#ifndef DOC_HIDDEN
+#define SND_ASYNC_HASH_SIZE 64	/* must be a power of two */
+#endif
+
+static snd_async_handler_t *snd_async_hash[SND_ASYNC_HASH_SIZE];
+
+static inline unsigned int snd_async_hash_bucket(int fd)
+{
+	return (unsigned int)fd & (SND_ASYNC_HASH_SIZE - 1);
+}
+
+static void snd_async_hash_add(snd_async_handler_t *h)
+{
+	unsigned int bucket = snd_async_hash_bucket(h->fd);
+
+	h->hash_next = snd_async_hash[bucket];
+	__sync_synchronize();
+	snd_async_hash[bucket] = h;
+}
+
+static void snd_async_hash_del(snd_async_handler_t *h)
+{
+	snd_async_handler_t **hp = &snd_async_hash[snd_async_hash_bucket(h->fd)];
+
+	while (*hp && *hp != h)
+		hp = &(*hp)->hash_next;
+	if (*hp)
+		*hp = h->hash_next;
+	__sync_synchronize();
+}
+
+/* notify one handler; in the pollable fd mode the completion is posted
+ * to the eventfd (a single async-signal-safe write) and the callback
+ * runs later from snd_async_handler_dispatch() in application context
+ */
+static void snd_async_notify(snd_async_handler_t *h)
+{
+#ifdef __linux__
+	if (h->event_fd >= 0) {
+		static const uint64_t one = 1;
+		int err;
+
+		err = write(h->event_fd, &one, sizeof(one));
+		(void)err;	/* EAGAIN means the counter is saturated */
+		return;
+	}
+#endif
+	if (h->callback)
+		h->callback(h);
+}
+
 static void snd_async_handler(int signo ATTRIBUTE_UNUSED, siginfo_t *siginfo, void *context ATTRIBUTE_UNUSED)
 {
 #if defined(__DragonFly__) || defined(__FreeBSD__) || defined(__OpenBSD__)
@@ -61,22 +122,19 @@ static void snd_async_handler(int signo ATTRIBUTE_UNUSED, siginfo_t *siginfo, vo
 	struct list_head *i;
 	list_for_each(i, &snd_async_handlers) {
 		snd_async_handler_t *h = list_entry(i, snd_async_handler_t, glist);
-		if (h->callback)
-			h->callback(h);
+		snd_async_notify(h);
 	}
 #else
 	int fd;
-	struct list_head *i;
+	snd_async_handler_t *h;
 	//assert(siginfo->si_code == SI_SIGIO);
 	if (signo == SIGIO
 	 && (unsigned long)(previous_action.sa_sigaction) > MAX_SIG_FUNCTION_CODE)
 		previous_action.sa_sigaction(signo, siginfo, context);
 	fd = siginfo->si_fd;
-	list_for_each(i, &snd_async_handlers) {
-		snd_async_handler_t *h = list_entry(i, snd_async_handler_t, glist);
-		if (h->fd == fd && h->callback)
-			h->callback(h);
-	}
+	for (h = snd_async_hash[snd_async_hash_bucket(fd)]; h; h = h->hash_next)
+		if (h->fd == fd)
+			snd_async_notify(h);
 #endif
 }
 
@@ -121,8 +179,10 @@ int snd_async_add_handler(snd_async_handler_t **handler, int fd,
 	h->fd = fd;
 	h->callback = callback;
 	h->private_data = private_data;
+	h->event_fd = -1;
 	was_empty = list_empty(&snd_async_handlers);
 	list_add_tail(&h->glist, &snd_async_handlers);
+	snd_async_hash_add(h);
 	INIT_LIST_HEAD(&h->hlist);
 	*handler = h;
 	if (was_empty) {
@@ -172,6 +232,7 @@ int snd_async_del_handler(snd_async_handler_t *handler)
 	}
  _glist:
 	was_empty = list_empty(&snd_async_handlers);
+	snd_async_hash_del(handler);
 	list_del(&handler->glist);
 	if (!was_empty && list_empty(&snd_async_handlers)) {
 		err = sigaction(snd_async_signo, &previous_action, NULL);
@@ -181,6 +242,8 @@ int snd_async_del_handler(snd_async_handler_t *handler)
 		}
 		memset(&previous_action, 0, sizeof(previous_action));
 	}
+	if (handler->event_fd >= 0)
+		close(handler->event_fd);
 	free(handler);
 	return err ? err : err2;
 }
@@ -222,3 +285,78 @@ void *snd_async_handler_get_callback_private(snd_async_handler_t *handler)
 	return handler->private_data;
 }
 
+/**
+ * \brief Returns a pollable completion file descriptor for an async handler.
+ * \param handler Handle to an async handler.
+ * \result A file descriptor if successful, otherwise a negative error code.
+ *
+ * The first call switches the handler to the pollable fd mode: the
+ * notifications are no longer delivered by invoking the callback from
+ * the signal handler; instead, each completion is posted to the
+ * returned file descriptor (an eventfd). The application adds this
+ * descriptor to its own event loop (\c poll / \c epoll, waiting for
+ * \c POLLIN) and calls #snd_async_handler_dispatch to invoke the
+ * callback in its own thread context. This avoids the restrictions of
+ * the signal context and allows each handler to be dispatched
+ * independently by multithreaded applications.
+ *
+ * The descriptor is owned by the handler and is closed by
+ * #snd_async_del_handler.
+ *
+ * The function is available on Linux only (-ENOSYS is returned on
+ * other systems).
+ */
+int snd_async_handler_get_poll_fd(snd_async_handler_t *handler)
+{
+	assert(handler);
+#ifdef __linux__
+	if (handler->event_fd < 0) {
+		handler->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (handler->event_fd < 0)
+			return -errno;
+	}
+	return handler->event_fd;
+#else
+	return -ENOSYS;
+#endif
+}
+
+/**
+ * \brief Dispatches the pending completions of an async handler.
+ * \param handler Handle to an async handler in the pollable fd mode.
+ * \result The number of consumed completions (the callback is invoked
+ *         once when it is greater than zero), zero when no completion
+ *         is pending, otherwise a negative error code.
+ *
+ * Reads the completion counter posted via the descriptor returned by
+ * #snd_async_handler_get_poll_fd and invokes the callback in the
+ * context of the caller. Like the signal based delivery, multiple
+ * completions may be coalesced into one callback invocation.
+ */
+int snd_async_handler_dispatch(snd_async_handler_t *handler)
+{
+#ifdef __linux__
+	uint64_t count;
+	ssize_t res;
+
+	assert(handler);
+	if (handler->event_fd < 0)
+		return -EBADFD;
+	res = read(handler->event_fd, &count, sizeof(count));
+	if (res < 0) {
+		if (errno == EAGAIN)
+			return 0;
+		return -errno;
+	}
+	if (res != sizeof(count))
+		return -EIO;
+	if (count == 0)
+		return 0;
+	if (handler->callback)
+		handler->callback(handler);
+	return count > INT_MAX ? INT_MAX : (int)count;
+#else
+	return -ENOSYS;
+#endif
+}
+
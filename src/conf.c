@@ -429,8 +429,13 @@ beginning:</P>
 #include <stdbool.h>
 #include <limits.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/inotify.h>
+#include <fcntl.h>
 #include <dirent.h>
 #include <locale.h>
+#include <poll.h>
+#include <time.h>
 #ifdef HAVE_LIBPTHREAD
 #include <pthread.h>
 #endif
@@ -455,16 +460,23 @@ struct _snd_config {
 		struct {
 			struct list_head fields;
 			bool join;
+			struct _snd_config_index *index;
+			/* set on parentless roots only; owns the node
+			 * structs of the whole tree */
+			struct _snd_config_arena *arena;
 		} compound;
 	} u;
 	struct list_head list;
 	snd_config_t *parent;
 	int hop;
+	bool from_arena;	/* node struct owned by the tree arena */
 };
 
 struct filedesc {
 	char *name;
 	snd_input_t *in;
+	const unsigned char *wptr;	/* flat tokenizer window for */
+	size_t wsize;			/* buffer backed inputs */
 	unsigned int line, column;
 	struct filedesc *next;
 
@@ -635,8 +647,8 @@ static char *_snd_config_path(const char *name)
  *    <searchdir:relative-path/to/user/share/alsa>;
  *    These directories should be subdirectories of /usr/share/alsa.
  */
-static int input_stdio_open(snd_input_t **inputp, const char *file,
-			    struct filedesc *current)
+static int input_file_open(snd_input_t **inputp, const char *file,
+			   struct filedesc *current)
 {
 	struct list_head *pos;
 	struct include_path *path;
@@ -644,7 +656,7 @@ static int input_stdio_open(snd_input_t **inputp, const char *file,
 	int err;
 
 	if (file[0] == '/')
-		return snd_input_stdio_open(inputp, file, "r");
+		return snd_input_file_open(inputp, file);
 
 	/* search file in user specified include paths. These directories
 	 * are subdirectories of /usr/share/alsa.
@@ -657,7 +669,7 @@ static int input_stdio_open(snd_input_t **inputp, const char *file,
 				continue;
 
 			snprintf(full_path, PATH_MAX, "%s/%s", path->dir, file);
-			err = snd_input_stdio_open(inputp, full_path, "r");
+			err = snd_input_file_open(inputp, full_path);
 			if (err == 0)
 				return 0;
 		}
@@ -743,6 +755,17 @@ int _snd_safe_strtod(const char *str, double *val)
 	return 0;
 }
 
+/* take over the memory window of a buffer backed input, so the
+ * tokenizer consumes it with plain pointer arithmetic instead of a
+ * function call round trip per character
+ */
+static void init_input_window(struct filedesc *fd)
+{
+	fd->wptr = NULL;
+	fd->wsize = 0;
+	_snd_input_buffer_window(fd->in, &fd->wptr, &fd->wsize);
+}
+
 static int get_char(input_t *input)
 {
 	int c;
@@ -753,7 +776,11 @@ static int get_char(input_t *input)
 	}
  again:
 	fd = input->current;
-	c = snd_input_getc(fd->in);
+	if (fd->wsize > 0) {
+		fd->wsize--;
+		c = *fd->wptr++;
+	} else
+		c = snd_input_getc(fd->in);
 	switch (c) {
 	case '\n':
 		fd->column = 0;
@@ -834,9 +861,9 @@ static int get_char_skip_comments(input_t *input)
 				if (tmp == NULL)
 					return -ENOMEM;
 				str = tmp;
-				err = snd_input_stdio_open(&in, str, "r");
+				err = snd_input_file_open(&in, str);
 			} else { /* absolute or relative file path */
-				err = input_stdio_open(&in, str, input->current);
+				err = input_file_open(&in, str, input->current);
 			}
 
 			if (err < 0) {
@@ -854,6 +881,7 @@ static int get_char_skip_comments(input_t *input)
 			fd->next = input->current;
 			fd->line = 1;
 			fd->column = 0;
+			init_input_window(fd);
 			INIT_LIST_HEAD(&fd->include_paths);
 			input->current = fd;
 			continue;
@@ -1123,11 +1151,304 @@ static int get_string(char **string, int id, input_t *input)
 	}
 }
 
-static int _snd_config_make(snd_config_t **config, char **id, snd_config_type_t type)
+/*
+ * Interned strings for node ids and string values
+ *
+ * Ids like "type", "card" or "device" and many values are identical
+ * across thousands of nodes of a configuration tree.  All node ids and
+ * string values are therefore reference counted in a small global hash
+ * table and shared; _snd_config_intern() returns a shared copy and
+ * _snd_config_unintern() drops one reference.  The table is guarded by
+ * its own mutex, independent of the global update lock.
+ */
+
+#ifndef DOC_HIDDEN
+#define CONFIG_INTERN_HASH_SIZE		512
+
+struct intern_entry {
+	struct intern_entry *next;
+	unsigned int refs;
+	unsigned int hash;
+	char str[];
+};
+#endif
+
+static struct intern_entry *intern_hash[CONFIG_INTERN_HASH_SIZE];
+
+#ifdef HAVE_LIBPTHREAD
+static pthread_mutex_t intern_mutex = PTHREAD_MUTEX_INITIALIZER;
+static inline void intern_lock(void) { pthread_mutex_lock(&intern_mutex); }
+static inline void intern_unlock(void) { pthread_mutex_unlock(&intern_mutex); }
+#else
+static inline void intern_lock(void) { }
+static inline void intern_unlock(void) { }
+#endif
+
+static unsigned int _snd_config_str_hash(const char *str)
+{
+	unsigned int h = 5381;
+
+	while (*str)
+		h = h * 33 + (unsigned char)*str++;
+	return h;
+}
+
+/* get a shared, reference counted copy of str (NULL stays NULL) */
+static char *_snd_config_intern(const char *str)
+{
+	struct intern_entry *e;
+	unsigned int hash, idx;
+
+	if (!str)
+		return NULL;
+	hash = _snd_config_str_hash(str);
+	idx = hash % CONFIG_INTERN_HASH_SIZE;
+	intern_lock();
+	for (e = intern_hash[idx]; e; e = e->next) {
+		if (e->hash == hash && strcmp(e->str, str) == 0) {
+			e->refs++;
+			intern_unlock();
+			return e->str;
+		}
+	}
+	e = malloc(sizeof(*e) + strlen(str) + 1);
+	if (e) {
+		e->refs = 1;
+		e->hash = hash;
+		strcpy(e->str, str);
+		e->next = intern_hash[idx];
+		intern_hash[idx] = e;
+	}
+	intern_unlock();
+	return e ? e->str : NULL;
+}
+
+/* bump the reference of an already interned string */
+static char *_snd_config_intern_ref(const char *str)
+{
+	struct intern_entry *e;
+
+	if (!str)
+		return NULL;
+	e = (struct intern_entry *)(str - offsetof(struct intern_entry, str));
+	intern_lock();
+	e->refs++;
+	intern_unlock();
+	return (char *)str;
+}
+
+/* drop one reference of an interned string */
+static void _snd_config_unintern(const char *str)
+{
+	struct intern_entry *e, **ep;
+	unsigned int idx;
+
+	if (!str)
+		return;
+	e = (struct intern_entry *)(str - offsetof(struct intern_entry, str));
+	intern_lock();
+	if (--e->refs == 0) {
+		for (ep = &intern_hash[e->hash % CONFIG_INTERN_HASH_SIZE];
+		     *ep; ep = &(*ep)->next)
+			if (*ep == e) {
+				*ep = e->next;
+				break;
+			}
+		free(e);
+	}
+	intern_unlock();
+}
+
+/*
+ * Arena allocator for configuration trees
+ *
+ * A full configuration update creates tens of thousands of nodes; doing
+ * an individual calloc()/free() per node fragments the heap of
+ * long-lived clients.  A tree root may own an arena (attached by
+ * snd_config_update_r()); nodes below such a root are then carved out
+ * of chunked bump allocations and the per-node free at teardown becomes
+ * a no-op - the chunks are released wholesale when the root is deleted.
+ * Ids and string values stay individually allocated, since they can be
+ * replaced during the node lifetime.
+ */
+
+#ifndef DOC_HIDDEN
+#define CONFIG_ARENA_CHUNK_SIZE		(32 * 1024)
+
+struct _snd_config_arena_chunk {
+	struct _snd_config_arena_chunk *next;
+	size_t used;
+	size_t size;
+	/* payload follows, max_align boundary from malloc */
+};
+
+struct _snd_config_arena {
+	struct _snd_config_arena_chunk *chunks;
+};
+#endif
+
+static void *_snd_config_arena_alloc(struct _snd_config_arena *arena,
+				     size_t size)
+{
+	struct _snd_config_arena_chunk *chunk = arena->chunks;
+	void *p;
+
+	size = (size + sizeof(void *) * 2 - 1) & ~(sizeof(void *) * 2 - 1);
+	if (!chunk || chunk->size - chunk->used < size) {
+		size_t csize = CONFIG_ARENA_CHUNK_SIZE - sizeof(*chunk);
+		if (csize < size)
+			csize = size;
+		chunk = malloc(sizeof(*chunk) + csize);
+		if (!chunk)
+			return NULL;
+		chunk->next = arena->chunks;
+		chunk->used = 0;
+		chunk->size = csize;
+		arena->chunks = chunk;
+		snd_memstat_update(SND_MEMSTAT_CONFIG,
+				   sizeof(*chunk) + csize, 1);
+	}
+	p = (char *)(chunk + 1) + chunk->used;
+	chunk->used += size;
+	return p;
+}
+
+static struct _snd_config_arena *_snd_config_arena_new(void)
+{
+	return calloc(1, sizeof(struct _snd_config_arena));
+}
+
+static void _snd_config_arena_free(struct _snd_config_arena *arena)
+{
+	struct _snd_config_arena_chunk *chunk, *next;
+
+	if (!arena)
+		return;
+	for (chunk = arena->chunks; chunk; chunk = next) {
+		next = chunk->next;
+		snd_memstat_update(SND_MEMSTAT_CONFIG,
+				   -(ssize_t)(sizeof(*chunk) + chunk->size), -1);
+		free(chunk);
+	}
+	free(arena);
+}
+
+/* the arena, if any, hangs off the root of the tree */
+static struct _snd_config_arena *_snd_config_get_arena(snd_config_t *config)
+{
+	while (config->parent)
+		config = config->parent;
+	if (config->type != SND_CONFIG_TYPE_COMPOUND)
+		return NULL;
+	return config->u.compound.arena;
+}
+
+/*
+ * Hash index over the children of a compound node, built lazily by
+ * _snd_config_search() once a compound grows large enough and used for
+ * O(1) id lookups.  Ids are unique below one parent (enforced by
+ * snd_config_add() and the parser), so a simple open addressing table
+ * without deletion support is sufficient; any child removal or rename
+ * just drops the index and the next search rebuilds it.
+ */
+
+#ifndef DOC_HIDDEN
+struct _snd_config_index {
+	unsigned int size;		/* slots, power of two */
+	unsigned int used;
+	snd_config_t *slot[];
+};
+#endif
+
+/* below this sibling count a linear walk is cheaper than a table */
+#define CONFIG_INDEX_MIN_FIELDS		16
+
+static unsigned int _snd_config_index_hash(const char *id, int len)
+{
+	unsigned int h = 5381;
+
+	if (len < 0)
+		len = strlen(id);
+	while (len-- > 0)
+		h = h * 33 + (unsigned char)*id++;
+	return h;
+}
+
+static void _snd_config_index_drop(snd_config_t *config)
+{
+	if (config && config->type == SND_CONFIG_TYPE_COMPOUND &&
+	    config->u.compound.index) {
+		free(config->u.compound.index);
+		config->u.compound.index = NULL;
+	}
+}
+
+/* keep an existing index up to date when a child is appended */
+static void _snd_config_index_add(snd_config_t *parent, snd_config_t *child)
+{
+	struct _snd_config_index *idx;
+	unsigned int i;
+
+	if (parent->type != SND_CONFIG_TYPE_COMPOUND)
+		return;
+	idx = parent->u.compound.index;
+	if (!idx)
+		return;
+	/* over half full (or unhashable): rebuilt by the next search */
+	if (!child->id || (idx->used + 1) * 2 > idx->size) {
+		_snd_config_index_drop(parent);
+		return;
+	}
+	i = _snd_config_index_hash(child->id, -1) & (idx->size - 1);
+	while (idx->slot[i])
+		i = (i + 1) & (idx->size - 1);
+	idx->slot[i] = child;
+	idx->used++;
+}
+
+static struct _snd_config_index *_snd_config_index_build(snd_config_t *config)
+{
+	struct _snd_config_index *idx;
+	snd_config_iterator_t i, next;
+	unsigned int count = 0, size, j;
+
+	snd_config_for_each(i, next, config) {
+		snd_config_t *n = snd_config_iterator_entry(i);
+		if (!n->id)
+			return NULL;
+		count++;
+	}
+	if (count < CONFIG_INDEX_MIN_FIELDS)
+		return NULL;
+	for (size = CONFIG_INDEX_MIN_FIELDS; size < count * 2; size <<= 1)
+		;
+	idx = calloc(1, sizeof(*idx) + size * sizeof(idx->slot[0]));
+	if (!idx)
+		return NULL;
+	idx->size = size;
+	idx->used = count;
+	snd_config_for_each(i, next, config) {
+		snd_config_t *n = snd_config_iterator_entry(i);
+		j = _snd_config_index_hash(n->id, -1) & (size - 1);
+		while (idx->slot[j])
+			j = (j + 1) & (size - 1);
+		idx->slot[j] = n;
+	}
+	return idx;
+}
+
+static int __snd_config_make(snd_config_t **config, char **id,
+			     snd_config_type_t type,
+			     struct _snd_config_arena *arena)
 {
 	snd_config_t *n;
 	assert(config);
-	n = calloc(1, sizeof(*n));
+	if (arena) {
+		n = _snd_config_arena_alloc(arena, sizeof(*n));
+		if (n)
+			memset(n, 0, sizeof(*n));
+	} else
+		n = calloc(1, sizeof(*n));
 	if (n == NULL) {
 		if (*id) {
 			free(*id);
@@ -1135,16 +1456,30 @@ static int _snd_config_make(snd_config_t **config, char **id, snd_config_type_t
 		}
 		return -ENOMEM;
 	}
-	if (id) {
-		n->id = *id;
+	if (id && *id) {
+		n->id = _snd_config_intern(*id);
+		free(*id);
 		*id = NULL;
+		if (!n->id) {
+			if (!arena)
+				free(n);
+			return -ENOMEM;
+		}
 	}
 	n->type = type;
+	n->from_arena = arena != NULL;
 	if (type == SND_CONFIG_TYPE_COMPOUND)
 		INIT_LIST_HEAD(&n->u.compound.fields);
+	if (!arena)	/* arena nodes are accounted per chunk */
+		snd_memstat_update(SND_MEMSTAT_CONFIG, sizeof(*n), 1);
 	*config = n;
 	return 0;
 }
+
+static int _snd_config_make(snd_config_t **config, char **id, snd_config_type_t type)
+{
+	return __snd_config_make(config, id, type, NULL);
+}
 	
 
 static int _snd_config_make_add(snd_config_t **config, char **id,
@@ -1153,19 +1488,42 @@ static int _snd_config_make_add(snd_config_t **config, char **id,
 	snd_config_t *n;
 	int err;
 	assert(parent->type == SND_CONFIG_TYPE_COMPOUND);
-	err = _snd_config_make(&n, id, type);
+	err = __snd_config_make(&n, id, type, _snd_config_get_arena(parent));
 	if (err < 0)
 		return err;
 	n->parent = parent;
 	list_add_tail(&n->list, &parent->u.compound.fields);
+	_snd_config_index_add(parent, n);
 	*config = n;
 	return 0;
 }
 
-static int _snd_config_search(snd_config_t *config, 
+static int _snd_config_search(snd_config_t *config,
 			      const char *id, int len, snd_config_t **result)
 {
 	snd_config_iterator_t i, next;
+	if (config->type == SND_CONFIG_TYPE_COMPOUND && id) {
+		struct _snd_config_index *idx = config->u.compound.index;
+		if (!idx)
+			idx = config->u.compound.index =
+				_snd_config_index_build(config);
+		if (idx) {
+			size_t l = len < 0 ? strlen(id) : (size_t)len;
+			unsigned int j = _snd_config_index_hash(id, len) &
+					 (idx->size - 1);
+			while (idx->slot[j]) {
+				snd_config_t *n = idx->slot[j];
+				if (strlen(n->id) == l &&
+				    memcmp(n->id, id, l) == 0) {
+					if (result)
+						*result = n;
+					return 0;
+				}
+				j = (j + 1) & (idx->size - 1);
+			}
+			return -ENOENT;
+		}
+	}
 	snd_config_for_each(i, next, config) {
 		snd_config_t *n = snd_config_iterator_entry(i);
 		if (len < 0) {
@@ -1251,8 +1609,11 @@ static int parse_value(snd_config_t **_n, snd_config_t *parent, input_t *input,
 		if (err < 0)
 			return err;
 	}
-	free(n->u.string);
-	n->u.string = s;
+	_snd_config_unintern(n->u.string);
+	n->u.string = _snd_config_intern(s);
+	free(s);
+	if (!n->u.string)
+		return -ENOMEM;
 	*_n = n;
 	return 0;
 }
@@ -1745,15 +2106,18 @@ int snd_config_substitute(snd_config_t *dst, snd_config_t *src)
 		src->u.compound.fields.next->prev = &dst->u.compound.fields;
 		src->u.compound.fields.prev->next = &dst->u.compound.fields;
 	}
-	free(dst->id);
+	_snd_config_unintern(dst->id);
 	if (dst->type == SND_CONFIG_TYPE_STRING)
-		free(dst->u.string);
+		_snd_config_unintern(dst->u.string);
 	if (src->parent)	/* like snd_config_remove */
 		list_del(&src->list);
 	dst->id = src->id;
 	dst->type = src->type;
 	dst->u = src->u;
-	free(src);
+	if (!src->from_arena) {
+		snd_memstat_update(SND_MEMSTAT_CONFIG, -(ssize_t)sizeof(*src), -1);
+		free(src);
+	}
 	return 0;
 }
 
@@ -1920,7 +2284,7 @@ int snd_config_set_id(snd_config_t *config, const char *id)
 					return -EEXIST;
 			}
 		}
-		new_id = strdup(id);
+		new_id = _snd_config_intern(id);
 		if (!new_id)
 			return -ENOMEM;
 	} else {
@@ -1928,8 +2292,9 @@ int snd_config_set_id(snd_config_t *config, const char *id)
 			return -EINVAL;
 		new_id = NULL;
 	}
-	free(config->id);
+	_snd_config_unintern(config->id);
 	config->id = new_id;
+	_snd_config_index_drop(config->parent);
 	return 0;
 }
 
@@ -1972,6 +2337,7 @@ int _snd_config_load_with_include(snd_config_t *config, snd_input_t *in,
 	fd->line = 1;
 	fd->column = 0;
 	fd->next = NULL;
+	init_input_window(fd);
 	INIT_LIST_HEAD(&fd->include_paths);
 	if (include_paths) {
 		for (; *include_paths; include_paths++) {
@@ -2154,6 +2520,7 @@ int snd_config_add(snd_config_t *parent, snd_config_t *child)
 	}
 	child->parent = parent;
 	list_add_tail(&child->list, &parent->u.compound.fields);
+	_snd_config_index_add(parent, child);
 	return 0;
 }
 
@@ -2195,6 +2562,7 @@ int snd_config_add_after(snd_config_t *after, snd_config_t *child)
 	}
 	child->parent = parent;
 	list_insert(&child->list, &after->list, after->list.next);
+	_snd_config_index_add(parent, child);
 	return 0;
 }
 
@@ -2236,6 +2604,7 @@ int snd_config_add_before(snd_config_t *before, snd_config_t *child)
 	}
 	child->parent = parent;
 	list_insert(&child->list, before->list.prev, &before->list);
+	_snd_config_index_add(parent, child);
 	return 0;
 }
 
@@ -2259,6 +2628,7 @@ static int _snd_config_array_merge(snd_config_t *dst, snd_config_t *src, int ind
 		}
 		sn->parent = dst;
 		list_add_tail(&sn->list, &dst->u.compound.fields);
+		_snd_config_index_add(dst, sn);
 	}
 	snd_config_delete(src);
 	return 0;
@@ -2329,6 +2699,7 @@ int snd_config_merge(snd_config_t *dst, snd_config_t *src, int override)
 			snd_config_remove(sn);
 			sn->parent = dst;
 			list_add_tail(&sn->list, &dst->u.compound.fields);
+			_snd_config_index_add(dst, sn);
 		}
 	}
 	snd_config_delete(src);
@@ -2351,8 +2722,10 @@ int snd_config_merge(snd_config_t *dst, snd_config_t *src, int override)
 int snd_config_remove(snd_config_t *config)
 {
 	assert(config);
-	if (config->parent)
+	if (config->parent) {
+		_snd_config_index_drop(config->parent);
 		list_del(&config->list);
+	}
 	config->parent = NULL;
 	return 0;
 }
@@ -2382,8 +2755,10 @@ int snd_config_remove(snd_config_t *config)
 int snd_config_delete(snd_config_t *config)
 {
 	assert(config);
-	if (config->refcount > 0) {
-		config->refcount--;
+	/* atomic: the reference may have been taken by the lock-free
+	 * read side of the global tree (see snd_config_borrow) */
+	if (__atomic_load_n(&config->refcount, __ATOMIC_ACQUIRE) > 0) {
+		__atomic_fetch_sub(&config->refcount, 1, __ATOMIC_RELEASE);
 		return 0;
 	}
 	switch (config->type) {
@@ -2400,18 +2775,26 @@ int snd_config_delete(snd_config_t *config)
 				return err;
 			i = nexti;
 		}
+		free(config->u.compound.index);
 		break;
 	}
 	case SND_CONFIG_TYPE_STRING:
-		free(config->u.string);
+		_snd_config_unintern(config->u.string);
 		break;
 	default:
 		break;
 	}
-	if (config->parent)
+	if (config->parent) {
+		_snd_config_index_drop(config->parent);
 		list_del(&config->list);
-	free(config->id);
-	free(config);
+	} else if (config->type == SND_CONFIG_TYPE_COMPOUND) {
+		_snd_config_arena_free(config->u.compound.arena);
+	}
+	_snd_config_unintern(config->id);
+	if (!config->from_arena) {
+		snd_memstat_update(SND_MEMSTAT_CONFIG, -(ssize_t)sizeof(*config), -1);
+		free(config);
+	}
 	return 0;
 }
 
@@ -2866,7 +3249,7 @@ int snd_config_imake_string(snd_config_t **config, const char *id, const char *v
 	if (err < 0)
 		return err;
 	if (value) {
-		tmp->u.string = strdup(value);
+		tmp->u.string = _snd_config_intern(value);
 		if (!tmp->u.string) {
 			snd_config_delete(tmp);
 			return -ENOMEM;
@@ -2908,13 +3291,13 @@ int snd_config_imake_safe_string(snd_config_t **config, const char *id, const ch
 	if (err < 0)
 		return err;
 	if (value) {
-		tmp->u.string = strdup(value);
-		if (!tmp->u.string) {
+		char *safe = strdup(value);
+		if (!safe) {
 			snd_config_delete(tmp);
 			return -ENOMEM;
 		}
 
-		for (c = tmp->u.string; *c; c++) {
+		for (c = safe; *c; c++) {
 			if (*c == ' ' || *c == '-' || *c == '_' ||
 				(*c >= '0' && *c <= '9') ||
 				(*c >= 'a' && *c <= 'z') ||
@@ -2922,6 +3305,12 @@ int snd_config_imake_safe_string(snd_config_t **config, const char *id, const ch
 					continue;
 			*c = '_';
 		}
+		tmp->u.string = _snd_config_intern(safe);
+		free(safe);
+		if (!tmp->u.string) {
+			snd_config_delete(tmp);
+			return -ENOMEM;
+		}
 	} else {
 		tmp->u.string = NULL;
 	}
@@ -3047,13 +3436,13 @@ int snd_config_set_string(snd_config_t *config, const char *value)
 	if (config->type != SND_CONFIG_TYPE_STRING)
 		return -EINVAL;
 	if (value) {
-		new_string = strdup(value);
+		new_string = _snd_config_intern(value);
 		if (!new_string)
 			return -ENOMEM;
 	} else {
 		new_string = NULL;
 	}
-	free(config->u.string);
+	_snd_config_unintern(config->u.string);
 	config->u.string = new_string;
 	return 0;
 }
@@ -3138,10 +3527,10 @@ int snd_config_set_ascii(snd_config_t *config, const char *ascii)
 		}
 	case SND_CONFIG_TYPE_STRING:
 		{
-			char *ptr = strdup(ascii);
+			char *ptr = _snd_config_intern(ascii);
 			if (ptr == NULL)
 				return -ENOMEM;
-			free(config->u.string);
+			_snd_config_unintern(config->u.string);
 			config->u.string = ptr;
 		}
 		break;
@@ -3406,6 +3795,18 @@ int snd_config_test_id(const snd_config_t *config, const char *id)
 		return -1;
 }
 
+#ifndef DOC_HIDDEN
+static int _snd_config_save(snd_config_t *config, snd_output_t *out)
+{
+	if (config->type == SND_CONFIG_TYPE_COMPOUND) {
+		int array = snd_config_is_array(config);
+		return _snd_config_save_children(config, out, 0, 0, array);
+	} else {
+		return _snd_config_save_node_value(config, out, 0);
+	}
+}
+#endif
+
 /**
  * \brief Dumps the contents of a configuration node or tree.
  * \param config Handle to the (root) configuration node.
@@ -3426,13 +3827,28 @@ int snd_config_test_id(const snd_config_t *config, const char *id)
  */
 int snd_config_save(snd_config_t *config, snd_output_t *out)
 {
+	snd_output_t *buf;
+	char *str;
+	size_t size;
+	int err;
+
 	assert(config && out);
-	if (config->type == SND_CONFIG_TYPE_COMPOUND) {
-		int array = snd_config_is_array(config);
-		return _snd_config_save_children(config, out, 0, 0, array);
-	} else {
-		return _snd_config_save_node_value(config, out, 0);
+	/* render into a memory buffer first and hand the text over in
+	 * one piece; emitting a large tree through the per-character
+	 * interface of a stdio output dominates the save time */
+	err = snd_output_buffer_open(&buf);
+	if (err < 0)
+		return _snd_config_save(config, out);
+	err = _snd_config_save(config, buf);
+	if (err >= 0 && snd_output_putc(buf, '\0') < 0)
+		err = -ENOMEM;
+	if (err >= 0) {
+		size = snd_output_buffer_string(buf, &str);
+		if (size > 1 && snd_output_puts(out, str) < 0)
+			err = -EIO;
 	}
+	snd_output_close(buf);
+	return err;
 }
 
 /*
@@ -3953,118 +4369,721 @@ struct finfo {
 struct _snd_config_update {
 	unsigned int count;
 	struct finfo *finfo;
+	/* copy of the tree after parsing all but the last file; an
+	 * update where only the last file changed (typically a small
+	 * site-local override) restarts from this snapshot instead of
+	 * re-parsing the whole configuration */
+	snd_config_t *base;
+	/* monotonic time of the last file stamp check, for the
+	 * ALSA_CONFIG_UPDATE_TTL fast path (0 = never checked) */
+	time_t stamp;
 };
 #endif /* DOC_HIDDEN */
 
 static snd_config_update_t *snd_config_global_update = NULL;
 
-static int snd_config_hooks_call(snd_config_t *root, snd_config_t *config, snd_config_t *private_data)
+/* inotify descriptor watching the directories of the files behind
+ * snd_config_global_update (see snd_config_update_watch) and the
+ * update structure it was armed for; the pointer is only compared,
+ * never dereferenced, as the structure is replaced on every change */
+static int snd_config_watch_fd = -1;
+static snd_config_update_t *snd_config_watch_update;
+
+/* freshness window in seconds within which snd_config_update_r() skips
+ * the per-file stat checks; 0 = check on every call (default) */
+static long snd_config_update_ttl(void)
 {
-	void *h = NULL;
-	snd_config_t *c, *func_conf = NULL;
-	char *buf = NULL, errbuf[256];
-	const char *lib = NULL, *func_name = NULL;
-	const char *str;
-	int (*func)(snd_config_t *root, snd_config_t *config, snd_config_t **dst, snd_config_t *private_data) = NULL;
-	int err;
+	static long ttl = -1;
+	const char *e;
 
-	err = snd_config_search(config, "func", &c);
-	if (err < 0) {
-		SNDERR("Field func is missing");
-		return err;
-	}
-	err = snd_config_get_string(c, &str);
-	if (err < 0) {
-		SNDERR("Invalid type for field func");
-		return err;
-	}
-	assert(str);
-	err = snd_config_search_definition(root, "hook_func", str, &func_conf);
-	if (err >= 0) {
-		snd_config_iterator_t i, next;
-		if (snd_config_get_type(func_conf) != SND_CONFIG_TYPE_COMPOUND) {
-			SNDERR("Invalid type for func %s definition", str);
-			err = -EINVAL;
-			goto _err;
-		}
-		snd_config_for_each(i, next, func_conf) {
-			snd_config_t *n = snd_config_iterator_entry(i);
-			const char *id = n->id;
-			if (strcmp(id, "comment") == 0)
-				continue;
-			if (strcmp(id, "lib") == 0) {
-				err = snd_config_get_string(n, &lib);
-				if (err < 0) {
-					SNDERR("Invalid type for %s", id);
-					goto _err;
-				}
-				continue;
-			}
-			if (strcmp(id, "func") == 0) {
-				err = snd_config_get_string(n, &func_name);
-				if (err < 0) {
-					SNDERR("Invalid type for %s", id);
-					goto _err;
-				}
-				continue;
-			}
-			SNDERR("Unknown field %s", id);
-		}
-	}
-	if (!func_name) {
-		int len = 16 + strlen(str) + 1;
-		buf = malloc(len);
-		if (! buf) {
-			err = -ENOMEM;
-			goto _err;
-		}
-		snprintf(buf, len, "snd_config_hook_%s", str);
-		buf[len-1] = '\0';
-		func_name = buf;
-	}
-	h = INTERNAL(snd_dlopen)(lib, RTLD_NOW, errbuf, sizeof(errbuf));
-	func = h ? snd_dlsym(h, func_name, SND_DLSYM_VERSION(SND_CONFIG_DLSYM_VERSION_HOOK)) : NULL;
-	err = 0;
-	if (!h) {
-		SNDERR("Cannot open shared library %s (%s)", lib, errbuf);
-		err = -ENOENT;
-	} else if (!func) {
-		SNDERR("symbol %s is not defined inside %s", func_name, lib);
-		snd_dlclose(h);
-		err = -ENXIO;
-	}
-	_err:
-	if (func_conf)
-		snd_config_delete(func_conf);
-	if (err >= 0) {
-		snd_config_t *nroot;
-		err = func(root, config, &nroot, private_data);
-		if (err < 0)
-			SNDERR("function %s returned error: %s", func_name, snd_strerror(err));
-		snd_dlclose(h);
-		if (err >= 0 && nroot)
-			err = snd_config_substitute(root, nroot);
+	if (ttl < 0) {
+		e = getenv("ALSA_CONFIG_UPDATE_TTL");
+		ttl = e && *e ? atol(e) : 0;
+		if (ttl < 0)
+			ttl = 0;
 	}
-	free(buf);
-	if (err < 0)
-		return err;
-	return 0;
+	return ttl;
 }
 
-static int snd_config_hooks(snd_config_t *config, snd_config_t *private_data)
+static time_t snd_config_monotonic(void)
 {
-	snd_config_t *n;
-	snd_config_iterator_t i, next;
-	int err, hit, idx = 0;
+	struct timespec ts;
 
-	if ((err = snd_config_search(config, "@hooks", &n)) < 0)
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0)
 		return 0;
-	snd_config_lock();
-	snd_config_remove(n);
-	do {
-		hit = 0;
-		snd_config_for_each(i, next, n) {
-			snd_config_t *n = snd_config_iterator_entry(i);
+	return ts.tv_sec;
+}
+
+/* bumped every time snd_config_update_r() installs a new tree; caches
+ * derived from evaluated configuration (see confmisc.c) compare it to
+ * find out whether their contents may have gone stale */
+static unsigned int snd_config_generation;
+
+#ifndef DOC_HIDDEN
+unsigned int snd_config_update_generation(void)
+{
+	return snd_config_generation;
+}
+#endif
+
+#ifndef DOC_HIDDEN
+#ifdef HAVE_LIBPTHREAD
+
+/*
+ * Lock-free read side for the global configuration tree.
+ *
+ * The tree behaves like an RCU protected pointer: a fully built tree
+ * is published with an atomic store and readers take their reference
+ * with atomic operations only, so concurrent opens do not serialize on
+ * snd_config_update_mutex just to read an unchanged tree.  Writers
+ * retract the pointer and wait for the readers counter to drain before
+ * the old tree or its update structure may be freed; a reader holds
+ * the counter only across the freshness check, so the wait is a short
+ * spin.
+ */
+static snd_config_t *snd_config_published;
+static unsigned int snd_config_readers;
+/* the configuration path the published tree was built from; replaced
+ * only under the mutex after a grace period
+ */
+static char *snd_config_published_cfgs;
+
+/* resolve the configuration path the same way snd_config_update_r()
+ * does; buf must provide room for the default path
+ */
+static const char *snd_config_update_cfgs(char *buf, size_t size)
+{
+	const char *configs = getenv(ALSA_CONFIG_PATH_VAR);
+
+	if (configs && *configs)
+		return configs;
+	snprintf(buf, size, "%s/alsa.conf", snd_config_topdir());
+	return buf;
+}
+
+/* prove without the mutex that the published tree is still current:
+ * the configuration path is the one it was built from, no file was
+ * dropped as inaccessible when it was built, and every file still
+ * carries the recorded identity and modification time.  An armed
+ * inotify watch or a valid freshness window replaces the stat calls,
+ * mirroring the fast paths of snd_config_update_r().
+ */
+static int snd_config_published_fresh(const snd_config_update_t *update)
+{
+	char buf[PATH_MAX];
+	const char *configs, *c;
+	unsigned int k;
+	size_t l;
+	long ttl;
+
+	if (!update || !snd_config_published_cfgs)
+		return 0;
+	if (update == snd_config_watch_update && snd_config_watch_fd >= 0) {
+		struct pollfd pfd;
+		pfd.fd = snd_config_watch_fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		return poll(&pfd, 1, 0) == 0;
+	}
+	configs = snd_config_update_cfgs(buf, sizeof(buf));
+	if (strcmp(configs, snd_config_published_cfgs) != 0)
+		return 0;
+	ttl = snd_config_update_ttl();
+	if (ttl > 0 && update->stamp != 0 &&
+	    snd_config_monotonic() < update->stamp + ttl)
+		return 1;
+	for (k = 0, c = configs; (l = strcspn(c, ": ")) > 0; ) {
+		c += l;
+		k++;
+		if (!*c)
+			break;
+		c++;
+	}
+	if (k != update->count)
+		return 0;
+	for (k = 0; k < update->count; ++k) {
+		const struct finfo *uf = &update->finfo[k];
+		struct stat64 st;
+		if (stat64(uf->name, &st) < 0 ||
+		    st.st_dev != uf->dev ||
+		    st.st_ino != uf->ino ||
+		    st.st_mtime != uf->mtime)
+			return 0;
+	}
+	return 1;
+}
+
+/* take a reference on the published tree without the mutex; returns
+ * NULL when there is no published tree or its freshness cannot be
+ * proven without a reload under the lock
+ */
+static snd_config_t *snd_config_borrow(void)
+{
+	snd_config_t *cfg;
+
+	if (!__atomic_load_n(&snd_config_published, __ATOMIC_RELAXED))
+		return NULL;
+	__atomic_fetch_add(&snd_config_readers, 1, __ATOMIC_ACQ_REL);
+	cfg = __atomic_load_n(&snd_config_published, __ATOMIC_ACQUIRE);
+	if (cfg) {
+		/* the writer frees neither the tree nor the update
+		 * structure while the readers counter is held */
+		if (snd_config_published_fresh(snd_config_global_update))
+			__atomic_fetch_add(&cfg->refcount, 1,
+					   __ATOMIC_ACQ_REL);
+		else
+			cfg = NULL;
+	}
+	__atomic_fetch_sub(&snd_config_readers, 1, __ATOMIC_RELEASE);
+	return cfg;
+}
+
+/* retract the published tree before it or its update structure may be
+ * freed; called with the mutex held.  The spin is bounded by the few
+ * statements a reader can hold the counter across.
+ */
+static void snd_config_unpublish(void)
+{
+	if (!snd_config_published)
+		return;
+	__atomic_store_n(&snd_config_published, NULL, __ATOMIC_RELEASE);
+	while (__atomic_load_n(&snd_config_readers, __ATOMIC_ACQUIRE) != 0)
+		sched_yield();
+}
+
+/* publish the current global tree for the lock-free read side; called
+ * with the mutex held after snd_config_update_r() succeeded, when no
+ * reader can be in flight
+ */
+static void snd_config_publish(void)
+{
+	char buf[PATH_MAX];
+	const char *configs;
+
+	if (!snd_config)
+		return;
+	configs = snd_config_update_cfgs(buf, sizeof(buf));
+	if (!snd_config_published_cfgs ||
+	    strcmp(configs, snd_config_published_cfgs) != 0) {
+		free(snd_config_published_cfgs);
+		snd_config_published_cfgs = strdup(configs);
+		if (!snd_config_published_cfgs)
+			return;
+	}
+	__atomic_store_n(&snd_config_published, snd_config, __ATOMIC_RELEASE);
+}
+
+#else
+
+static inline snd_config_t *snd_config_borrow(void) { return NULL; }
+static inline void snd_config_unpublish(void) { }
+static inline void snd_config_publish(void) { }
+
+#endif /* HAVE_LIBPTHREAD */
+#endif /* DOC_HIDDEN */
+
+/*
+ * Compiled binary configuration cache
+ *
+ * When the environment variable ALSA_CONFIG_CACHE points to a file, the
+ * configuration tree built by snd_config_update_r() is serialized there
+ * after a successful text parse, and later updates mmap and validate the
+ * cache instead of running the tokenizer again.  The cache records the
+ * device/inode/mtime triple of every top-level configuration file; any
+ * mismatch makes the loader fall back to the text parser and rewrite the
+ * cache.  The cached tree is the state before the hooks are run, so the
+ * hooks (card specific configs etc.) are evaluated as usual.
+ */
+
+#define SND_CONFIG_CACHE_MAGIC		0x414c4343	/* 'ALCC' */
+#define SND_CONFIG_CACHE_VERSION	1
+
+struct cache_cursor {
+	const unsigned char *p;
+	size_t left;
+};
+
+static int cache_read(struct cache_cursor *c, void *buf, size_t size)
+{
+	if (c->left < size)
+		return -EINVAL;
+	memcpy(buf, c->p, size);
+	c->p += size;
+	c->left -= size;
+	return 0;
+}
+
+static int cache_read_u32(struct cache_cursor *c, uint32_t *val)
+{
+	return cache_read(c, val, sizeof(*val));
+}
+
+static int cache_read_string(struct cache_cursor *c, char **str)
+{
+	uint32_t len;
+	int err;
+
+	err = cache_read_u32(c, &len);
+	if (err < 0)
+		return err;
+	if (len == UINT32_MAX) {
+		*str = NULL;
+		return 0;
+	}
+	if (c->left < len)
+		return -EINVAL;
+	*str = malloc(len + 1);
+	if (!*str)
+		return -ENOMEM;
+	memcpy(*str, c->p, len);
+	(*str)[len] = '\0';
+	c->p += len;
+	c->left -= len;
+	return 0;
+}
+
+static int cache_load_node(struct cache_cursor *c, snd_config_t *parent)
+{
+	snd_config_t *n;
+	uint32_t type;
+	char *id = NULL, *s;
+	uint32_t count, k;
+	int err;
+
+	err = cache_read_u32(c, &type);
+	if (err < 0)
+		return err;
+	err = cache_read_string(c, &id);
+	if (err < 0)
+		return err;
+	err = __snd_config_make(&n, &id, type,
+				parent ? _snd_config_get_arena(parent) : NULL);
+	if (err < 0) {
+		free(id);
+		return err;
+	}
+	switch (n->type) {
+	case SND_CONFIG_TYPE_INTEGER:
+	{
+		int64_t v;
+		err = cache_read(c, &v, sizeof(v));
+		n->u.integer = v;
+		break;
+	}
+	case SND_CONFIG_TYPE_INTEGER64:
+		err = cache_read(c, &n->u.integer64, sizeof(n->u.integer64));
+		break;
+	case SND_CONFIG_TYPE_REAL:
+		err = cache_read(c, &n->u.real, sizeof(n->u.real));
+		break;
+	case SND_CONFIG_TYPE_STRING:
+		err = cache_read_string(c, &s);
+		if (err >= 0) {
+			n->u.string = _snd_config_intern(s);
+			free(s);
+			if (s && !n->u.string)
+				err = -ENOMEM;
+		}
+		break;
+	case SND_CONFIG_TYPE_COMPOUND:
+	{
+		unsigned char join;
+		err = cache_read(c, &join, 1);
+		if (err < 0)
+			break;
+		n->u.compound.join = join;
+		err = cache_read_u32(c, &count);
+		for (k = 0; err >= 0 && k < count; k++)
+			err = cache_load_node(c, n);
+		break;
+	}
+	default:
+		err = -EINVAL;
+		break;
+	}
+	if (err >= 0 && parent)
+		err = snd_config_add(parent, n);
+	if (err < 0) {
+		snd_config_delete(n);
+		return err;
+	}
+	return 0;
+}
+
+static int cache_write(FILE *out, const void *buf, size_t size)
+{
+	if (fwrite(buf, 1, size, out) != size)
+		return -EIO;
+	return 0;
+}
+
+static int cache_write_u32(FILE *out, uint32_t val)
+{
+	return cache_write(out, &val, sizeof(val));
+}
+
+static int cache_write_string(FILE *out, const char *str)
+{
+	int err;
+
+	if (!str)
+		return cache_write_u32(out, UINT32_MAX);
+	err = cache_write_u32(out, strlen(str));
+	if (err < 0)
+		return err;
+	return cache_write(out, str, strlen(str));
+}
+
+static int cache_save_node(FILE *out, snd_config_t *n)
+{
+	snd_config_iterator_t i, next;
+	uint32_t count;
+	int err;
+
+	err = cache_write_u32(out, n->type);
+	if (err < 0)
+		return err;
+	err = cache_write_string(out, n->id);
+	if (err < 0)
+		return err;
+	switch (n->type) {
+	case SND_CONFIG_TYPE_INTEGER:
+	{
+		int64_t v = n->u.integer;
+		return cache_write(out, &v, sizeof(v));
+	}
+	case SND_CONFIG_TYPE_INTEGER64:
+		return cache_write(out, &n->u.integer64, sizeof(n->u.integer64));
+	case SND_CONFIG_TYPE_REAL:
+		return cache_write(out, &n->u.real, sizeof(n->u.real));
+	case SND_CONFIG_TYPE_STRING:
+		return cache_write_string(out, n->u.string);
+	case SND_CONFIG_TYPE_COMPOUND:
+	{
+		unsigned char join = n->u.compound.join;
+		err = cache_write(out, &join, 1);
+		if (err < 0)
+			return err;
+		count = 0;
+		snd_config_for_each(i, next, n)
+			count++;
+		err = cache_write_u32(out, count);
+		if (err < 0)
+			return err;
+		snd_config_for_each(i, next, n) {
+			err = cache_save_node(out, snd_config_iterator_entry(i));
+			if (err < 0)
+				return err;
+		}
+		return 0;
+	}
+	default:
+		return -EINVAL;
+	}
+}
+
+/* validate the stored file info against the freshly stat'ed one */
+static int cache_check_finfo(struct cache_cursor *c, snd_config_update_t *local)
+{
+	uint32_t count, k;
+	int err;
+
+	err = cache_read_u32(c, &count);
+	if (err < 0)
+		return err;
+	if (!local)	/* plain tree file without file info */
+		return count == 0 ? 0 : -EINVAL;
+	if (count != local->count)
+		return -EINVAL;
+	for (k = 0; k < count; k++) {
+		char *name;
+		uint64_t dev, ino;
+		int64_t mtime;
+		struct finfo *lf = &local->finfo[k];
+
+		err = cache_read_string(c, &name);
+		if (err < 0)
+			return err;
+		if (!name)
+			return -EINVAL;
+		err = strcmp(name, lf->name) ? -EINVAL : 0;
+		free(name);
+		if (err < 0)
+			return err;
+		if (cache_read(c, &dev, sizeof(dev)) < 0 ||
+		    cache_read(c, &ino, sizeof(ino)) < 0 ||
+		    cache_read(c, &mtime, sizeof(mtime)) < 0)
+			return -EINVAL;
+		if (dev != (uint64_t)lf->dev || ino != (uint64_t)lf->ino ||
+		    mtime != (int64_t)lf->mtime)
+			return -EINVAL;
+	}
+	return 0;
+}
+
+/* try to build the tree from the binary cache; returns zero on success */
+static int snd_config_cache_load(const char *path, snd_config_update_t *local,
+				 snd_config_t *top)
+{
+	struct cache_cursor c;
+	struct stat64 st;
+	void *map = MAP_FAILED;
+	uint32_t magic, version, count, k;
+	int fd, err;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -errno;
+	err = -EINVAL;
+	if (fstat64(fd, &st) < 0 || st.st_size < (off64_t)(3 * sizeof(uint32_t)))
+		goto _err;
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED) {
+		err = -errno;
+		goto _err;
+	}
+	c.p = map;
+	c.left = st.st_size;
+	if (cache_read_u32(&c, &magic) < 0 || magic != SND_CONFIG_CACHE_MAGIC ||
+	    cache_read_u32(&c, &version) < 0 || version != SND_CONFIG_CACHE_VERSION)
+		goto _err;
+	err = cache_check_finfo(&c, local);
+	if (err < 0)
+		goto _err;
+	err = cache_read_u32(&c, &count);
+	for (k = 0; err >= 0 && k < count; k++)
+		err = cache_load_node(&c, top);
+	if (err >= 0 && c.left > 0)
+		err = -EINVAL;
+ _err:
+	if (map != MAP_FAILED)
+		munmap(map, st.st_size);
+	close(fd);
+	if (err < 0)
+		snd_config_delete_compound_members(top);
+	return err;
+}
+
+/* serialize the parsed tree; written to a temp file and renamed */
+static int snd_config_cache_save(const char *path, snd_config_update_t *local,
+				 snd_config_t *top)
+{
+	FILE *out;
+	snd_config_iterator_t i, next;
+	char *tmp;
+	uint32_t count, k;
+	int err;
+
+	tmp = malloc(strlen(path) + 5);
+	if (!tmp)
+		return -ENOMEM;
+	sprintf(tmp, "%s.new", path);
+	out = fopen(tmp, "wb");
+	if (!out) {
+		err = -errno;
+		free(tmp);
+		return err;
+	}
+	err = cache_write_u32(out, SND_CONFIG_CACHE_MAGIC);
+	if (err >= 0)
+		err = cache_write_u32(out, SND_CONFIG_CACHE_VERSION);
+	if (err >= 0)
+		err = cache_write_u32(out, local ? local->count : 0);
+	for (k = 0; err >= 0 && local && k < local->count; k++) {
+		struct finfo *lf = &local->finfo[k];
+		uint64_t dev = lf->dev, ino = lf->ino;
+		int64_t mtime = lf->mtime;
+
+		err = cache_write_string(out, lf->name);
+		if (err >= 0)
+			err = cache_write(out, &dev, sizeof(dev));
+		if (err >= 0)
+			err = cache_write(out, &ino, sizeof(ino));
+		if (err >= 0)
+			err = cache_write(out, &mtime, sizeof(mtime));
+	}
+	count = 0;
+	snd_config_for_each(i, next, top)
+		count++;
+	if (err >= 0)
+		err = cache_write_u32(out, count);
+	snd_config_for_each(i, next, top) {
+		if (err < 0)
+			break;
+		err = cache_save_node(out, snd_config_iterator_entry(i));
+	}
+	if (fclose(out) != 0)
+		err = -EIO;
+	if (err >= 0 && rename(tmp, path) < 0)
+		err = -errno;
+	if (err < 0)
+		unlink(tmp);
+	free(tmp);
+	return err;
+}
+
+/**
+ * \brief Saves a configuration tree in the compact binary format.
+ * \param config Handle to the (compound) root configuration node.
+ * \param path The path of the output file.
+ * \return Zero if successful, otherwise a negative error code.
+ *
+ * This function serializes \a config in the same binary format that is
+ * used for the configuration cache (see \c ALSA_CONFIG_CACHE), without
+ * any source file information.  The file is written to a temporary name
+ * and renamed over \a path, so readers never see a partial file.
+ *
+ * A tree saved this way can be read back with #snd_config_load_cache;
+ * for large trees the round trip is considerably cheaper than saving
+ * the text form with #snd_config_save and re-parsing it with
+ * #snd_config_load.
+ */
+int snd_config_save_cache(snd_config_t *config, const char *path)
+{
+	assert(config && path);
+	if (config->type != SND_CONFIG_TYPE_COMPOUND)
+		return -EINVAL;
+	return snd_config_cache_save(path, NULL, config);
+}
+
+/**
+ * \brief Loads a configuration tree from the compact binary format.
+ * \param[out] config The function puts the handle to the new root
+ *                    configuration node at the address specified by
+ *                    \a config.
+ * \param[in] path The path of a file written by #snd_config_save_cache.
+ * \return Zero if successful, otherwise a negative error code.
+ *
+ * Only files without source file information are accepted here; a cache
+ * file maintained by the \c ALSA_CONFIG_CACHE machinery is validated
+ * against its source files and cannot be loaded directly.
+ */
+int snd_config_load_cache(snd_config_t **config, const char *path)
+{
+	snd_config_t *top;
+	int err;
+
+	assert(config && path);
+	err = snd_config_top(&top);
+	if (err < 0)
+		return err;
+	top->u.compound.arena = _snd_config_arena_new();
+	err = snd_config_cache_load(path, NULL, top);
+	if (err < 0) {
+		snd_config_delete(top);
+		return err;
+	}
+	*config = top;
+	return 0;
+}
+
+static int snd_config_hooks_call(snd_config_t *root, snd_config_t *config, snd_config_t *private_data)
+{
+	void *h = NULL;
+	snd_config_t *c, *func_conf = NULL;
+	char *buf = NULL, errbuf[256];
+	const char *lib = NULL, *func_name = NULL;
+	const char *str;
+	int (*func)(snd_config_t *root, snd_config_t *config, snd_config_t **dst, snd_config_t *private_data) = NULL;
+	int err;
+
+	err = snd_config_search(config, "func", &c);
+	if (err < 0) {
+		SNDERR("Field func is missing");
+		return err;
+	}
+	err = snd_config_get_string(c, &str);
+	if (err < 0) {
+		SNDERR("Invalid type for field func");
+		return err;
+	}
+	assert(str);
+	err = snd_config_search_definition(root, "hook_func", str, &func_conf);
+	if (err >= 0) {
+		snd_config_iterator_t i, next;
+		if (snd_config_get_type(func_conf) != SND_CONFIG_TYPE_COMPOUND) {
+			SNDERR("Invalid type for func %s definition", str);
+			err = -EINVAL;
+			goto _err;
+		}
+		snd_config_for_each(i, next, func_conf) {
+			snd_config_t *n = snd_config_iterator_entry(i);
+			const char *id = n->id;
+			if (strcmp(id, "comment") == 0)
+				continue;
+			if (strcmp(id, "lib") == 0) {
+				err = snd_config_get_string(n, &lib);
+				if (err < 0) {
+					SNDERR("Invalid type for %s", id);
+					goto _err;
+				}
+				continue;
+			}
+			if (strcmp(id, "func") == 0) {
+				err = snd_config_get_string(n, &func_name);
+				if (err < 0) {
+					SNDERR("Invalid type for %s", id);
+					goto _err;
+				}
+				continue;
+			}
+			SNDERR("Unknown field %s", id);
+		}
+	}
+	if (!func_name) {
+		int len = 16 + strlen(str) + 1;
+		buf = malloc(len);
+		if (! buf) {
+			err = -ENOMEM;
+			goto _err;
+		}
+		snprintf(buf, len, "snd_config_hook_%s", str);
+		buf[len-1] = '\0';
+		func_name = buf;
+	}
+	h = INTERNAL(snd_dlopen)(lib, RTLD_NOW, errbuf, sizeof(errbuf));
+	func = h ? snd_dlsym(h, func_name, SND_DLSYM_VERSION(SND_CONFIG_DLSYM_VERSION_HOOK)) : NULL;
+	err = 0;
+	if (!h) {
+		SNDERR("Cannot open shared library %s (%s)", lib, errbuf);
+		err = -ENOENT;
+	} else if (!func) {
+		SNDERR("symbol %s is not defined inside %s", func_name, lib);
+		snd_dlclose(h);
+		err = -ENXIO;
+	}
+	_err:
+	if (func_conf)
+		snd_config_delete(func_conf);
+	if (err >= 0) {
+		snd_config_t *nroot;
+		err = func(root, config, &nroot, private_data);
+		if (err < 0)
+			SNDERR("function %s returned error: %s", func_name, snd_strerror(err));
+		snd_dlclose(h);
+		if (err >= 0 && nroot)
+			err = snd_config_substitute(root, nroot);
+	}
+	free(buf);
+	if (err < 0)
+		return err;
+	return 0;
+}
+
+static int snd_config_hooks(snd_config_t *config, snd_config_t *private_data)
+{
+	snd_config_t *n;
+	snd_config_iterator_t i, next;
+	int err, hit, idx = 0;
+
+	if ((err = snd_config_search(config, "@hooks", &n)) < 0)
+		return 0;
+	snd_config_lock();
+	snd_config_remove(n);
+	do {
+		hit = 0;
+		snd_config_for_each(i, next, n) {
+			snd_config_t *n = snd_config_iterator_entry(i);
 			const char *id = n->id;
 			long i;
 			err = safe_strtol(id, &i);
@@ -4113,7 +5132,7 @@ static int config_file_open(snd_config_t *root, const char *filename)
 	snd_input_t *in;
 	int err;
 
-	err = snd_input_stdio_open(&in, filename, "r");
+	err = snd_input_file_open(&in, filename);
 	if (err >= 0) {
 		err = snd_config_load(root, in);
 		snd_input_close(in);
@@ -4504,6 +5523,24 @@ SND_DLSYM_BUILD_VERSION(snd_config_hook_load_for_all_cards, SND_CONFIG_DLSYM_VER
  * The global configuration files are specified in the environment variable
  * \c ALSA_CONFIG_PATH.
  *
+ * If the environment variable \c ALSA_CONFIG_CACHE names a writable file,
+ * a compiled binary image of the parsed tree is maintained there and used
+ * instead of the text parser as long as the configuration files are
+ * unchanged.
+ *
+ * If the environment variable \c ALSA_CONFIG_UPDATE_TTL is set to a
+ * positive number of seconds, the file modification checks are skipped
+ * entirely for that long after the last check, so frequent reopens do
+ * not stat the same files again and again; edits may then be picked up
+ * with a delay of up to the given time.  When the global configuration
+ * is watched via #snd_config_update_watch, an idle watch replaces the
+ * checks instead, without any delay.
+ *
+ * When only the last configuration file has changed (the usual place of
+ * small site-local overrides), the tree is rebuilt from an internal
+ * snapshot taken before that file was parsed, so the preceding files
+ * are not parsed again.
+ *
  * \warning If the configuration tree is reread, all string pointers and
  * configuration node handles previously obtained from this tree become
  * invalid.
@@ -4516,6 +5553,7 @@ int snd_config_update_r(snd_config_t **_top, snd_config_update_t **_update, cons
 {
 	int err;
 	const char *configs, *c;
+	const char *cache;
 	unsigned int k;
 	size_t l;
 	snd_config_update_t *local;
@@ -4525,6 +5563,30 @@ int snd_config_update_r(snd_config_t **_top, snd_config_update_t **_update, cons
 	assert(_top && _update);
 	top = *_top;
 	update = *_update;
+
+	if (top && update) {
+		/* an armed inotify watch without pending events proves
+		 * that the files are unchanged - skip the stat checks;
+		 * poll() only peeks, the events stay readable for the
+		 * caller of snd_config_update_watch() */
+		if (update == snd_config_watch_update &&
+		    snd_config_watch_fd >= 0) {
+			struct pollfd pfd;
+			pfd.fd = snd_config_watch_fd;
+			pfd.events = POLLIN;
+			pfd.revents = 0;
+			if (poll(&pfd, 1, 0) == 0)
+				return 0;
+		} else {
+			/* opt-in freshness window - trade immediate
+			 * pick-up of edits for stat-free reopens */
+			long ttl = snd_config_update_ttl();
+			if (ttl > 0 && update->stamp != 0 &&
+			    snd_config_monotonic() < update->stamp + ttl)
+				return 0;
+		}
+	}
+
 	configs = cfgs;
 	if (!configs) {
 		configs = getenv(ALSA_CONFIG_PATH_VAR);
@@ -4584,6 +5646,7 @@ int snd_config_update_r(snd_config_t **_top, snd_config_update_t **_update, cons
 			local->count--;
 		}
 	}
+	local->stamp = snd_config_monotonic();
 	if (!update)
 		goto _reread;
 	if (local->count != update->count)
@@ -4591,12 +5654,19 @@ int snd_config_update_r(snd_config_t **_top, snd_config_update_t **_update, cons
 	for (k = 0; k < local->count; ++k) {
 		struct finfo *lf = &local->finfo[k];
 		struct finfo *uf = &update->finfo[k];
-		if (strcmp(lf->name, uf->name) != 0 ||
-		    lf->dev != uf->dev ||
+		if (strcmp(lf->name, uf->name) != 0)
+			goto _reread;
+		if (lf->dev != uf->dev ||
 		    lf->ino != uf->ino ||
-		    lf->mtime != uf->mtime)
+		    lf->mtime != uf->mtime) {
+			/* only the last file changed: restart from the
+			 * snapshot taken before it was parsed */
+			if (k == local->count - 1 && update->base)
+				goto _increment;
 			goto _reread;
+		}
 	}
+	update->stamp = local->stamp;
 	err = 0;
 
  _end:
@@ -4614,6 +5684,44 @@ int snd_config_update_r(snd_config_t **_top, snd_config_update_t **_update, cons
 		snd_config_update_free(local);
 	return err;
 
+ _increment:
+	{
+		snd_config_t *newtop = NULL;
+		snd_input_t *in;
+
+		err = snd_config_copy(&newtop, update->base);
+		if (err < 0)
+			goto _reread;
+		err = snd_config_copy(&local->base, update->base);
+		if (err < 0) {
+			local->base = NULL;
+			snd_config_delete(newtop);
+			goto _reread;
+		}
+		err = snd_input_file_open(&in, local->finfo[local->count - 1].name);
+		if (err >= 0) {
+			err = snd_config_load(newtop, in);
+			snd_input_close(in);
+		}
+		if (err >= 0)
+			err = snd_config_hooks(newtop, NULL);
+		if (err < 0) {
+			/* any problem falls back to the full reload so
+			 * the error handling stays identical */
+			snd_config_delete(newtop);
+			snd_config_delete(local->base);
+			local->base = NULL;
+			goto _reread;
+		}
+		if (top)
+			snd_config_delete(top);
+		snd_config_update_free(update);
+		snd_config_generation++;
+		*_top = newtop;
+		*_update = local;
+		return 1;
+	}
+
  _reread:
  	*_top = NULL;
  	*_update = NULL;
@@ -4628,11 +5736,20 @@ int snd_config_update_r(snd_config_t **_top, snd_config_update_t **_update, cons
 	err = snd_config_top(&top);
 	if (err < 0)
 		goto _end;
+	top->u.compound.arena = _snd_config_arena_new();
 	if (!local)
 		goto _skip;
+	cache = getenv("ALSA_CONFIG_CACHE");
+	if (cache && *cache && snd_config_cache_load(cache, local, top) >= 0)
+		goto _skip;
 	for (k = 0; k < local->count; ++k) {
 		snd_input_t *in;
-		err = snd_input_stdio_open(&in, local->finfo[k].name, "r");
+		/* keep a pre-hooks snapshot without the last file for
+		 * the incremental reload path above */
+		if (k == local->count - 1 && k > 0 &&
+		    snd_config_copy(&local->base, top) < 0)
+			local->base = NULL;
+		err = snd_input_file_open(&in, local->finfo[k].name);
 		if (err >= 0) {
 			err = snd_config_load(top, in);
 			snd_input_close(in);
@@ -4644,12 +5761,15 @@ int snd_config_update_r(snd_config_t **_top, snd_config_update_t **_update, cons
 			SNDERR("cannot access file %s", local->finfo[k].name);
 		}
 	}
+	if (cache && *cache)
+		snd_config_cache_save(cache, local, top);
  _skip:
 	err = snd_config_hooks(top, NULL);
 	if (err < 0) {
 		SNDERR("hooks failed, removing configuration");
 		goto _end;
 	}
+	snd_config_generation++;
 	*_top = top;
 	*_update = local;
 	return 1;
@@ -4678,7 +5798,12 @@ int snd_config_update(void)
 	int err;
 
 	snd_config_lock();
+	/* the old tree may be deleted by the update - retract it from
+	 * the lock-free read side first */
+	snd_config_unpublish();
 	err = snd_config_update_r(&snd_config, &snd_config_global_update, NULL);
+	if (err >= 0)
+		snd_config_publish();
 	snd_config_unlock();
 	return err;
 }
@@ -4696,18 +5821,31 @@ int snd_config_update(void)
  */
 int snd_config_update_ref(snd_config_t **top)
 {
+	snd_config_t *cfg;
 	int err;
 
-	if (top)
+	if (top) {
 		*top = NULL;
+		/* fast path: take the reference on the published tree
+		 * with atomic operations only, so concurrent opens do
+		 * not contend on the update mutex */
+		cfg = snd_config_borrow();
+		if (cfg) {
+			*top = cfg;
+			return 0;
+		}
+	}
 	snd_config_lock();
+	snd_config_unpublish();
 	err = snd_config_update_r(&snd_config, &snd_config_global_update, NULL);
 	if (err >= 0) {
 		if (snd_config) {
 			if (top) {
-				snd_config->refcount++;
+				__atomic_fetch_add(&snd_config->refcount, 1,
+						   __ATOMIC_RELAXED);
 				*top = snd_config;
 			}
+			snd_config_publish();
 		} else {
 			err = -ENODEV;
 		}
@@ -4725,10 +5863,8 @@ int snd_config_update_ref(snd_config_t **top)
  */
 void snd_config_ref(snd_config_t *cfg)
 {
-	snd_config_lock();
 	if (cfg)
-		cfg->refcount++;
-	snd_config_unlock();
+		__atomic_fetch_add(&cfg->refcount, 1, __ATOMIC_RELAXED);
 }
 
 /**
@@ -4764,6 +5900,8 @@ int snd_config_update_free(snd_config_update_t *update)
 	for (k = 0; k < update->count; k++)
 		free(update->finfo[k].name);
 	free(update->finfo);
+	if (update->base)
+		snd_config_delete(update->base);
 	free(update);
 	return 0;
 }
@@ -4781,6 +5919,7 @@ int snd_config_update_free(snd_config_update_t *update)
 int snd_config_update_free_global(void)
 {
 	snd_config_lock();
+	snd_config_unpublish();
 	if (snd_config)
 		snd_config_delete(snd_config);
 	snd_config = NULL;
@@ -4794,6 +5933,135 @@ int snd_config_update_free_global(void)
 	return 0;
 }
 
+#ifndef DOC_HIDDEN
+/* add a directory watch for the parent of a configuration file; the
+ * directory is watched instead of the file itself so a replace by
+ * rename or a re-creation of the file is noticed as well
+ */
+static int snd_config_watch_add(int fd, const char *filename)
+{
+	char dir[PATH_MAX];
+	const char *slash;
+	size_t len;
+
+	slash = strrchr(filename, '/');
+	if (slash == NULL || slash == filename) {
+		strcpy(dir, slash ? "/" : ".");
+	} else {
+		len = slash - filename;
+		if (len >= sizeof(dir))
+			return -ENAMETOOLONG;
+		memcpy(dir, filename, len);
+		dir[len] = '\0';
+	}
+	if (inotify_add_watch(fd, dir, IN_CLOSE_WRITE | IN_CREATE |
+				       IN_DELETE | IN_MOVE) < 0)
+		return -errno;
+	return 0;
+}
+#endif /* DOC_HIDDEN */
+
+/**
+ * \brief Watches the global configuration files for changes.
+ * \return A pollable file descriptor if successful, otherwise a negative
+ *         error code.
+ *
+ * Registers inotify watches for the configuration files behind the
+ * global configuration tree (the files scanned by #snd_config_update)
+ * and returns a file descriptor which becomes readable (\c POLLIN) when
+ * some of them may have changed.  When no global configuration exists
+ * yet, it is built first like #snd_config_update does.
+ *
+ * After a wakeup, refresh the tree with #snd_config_update or
+ * #snd_config_update_ref and call this function again; the repeated
+ * call drains the pending events, registers watches for files added by
+ * the update and returns the same descriptor.  This replaces periodic
+ * polling: #snd_config_update re-parses only when the descriptor
+ * signalled a change.
+ *
+ * The parent directories of the files are watched, so a file replaced
+ * by rename (the usual editor behaviour) or created later is noticed,
+ * too.  Changes to unrelated files in the same directories may cause
+ * spurious wakeups; a wakeup only means that an update may be needed,
+ * and #snd_config_update tells via its return value whether the tree
+ * really changed.
+ *
+ * The descriptor stays valid until #snd_config_update_watch_free.
+ *
+ * This function is supposed to be thread-safe.
+ */
+int snd_config_update_watch(void)
+{
+	char buf[sizeof(struct inotify_event) + NAME_MAX + 1];
+	unsigned int k;
+	int err = 0;
+
+	snd_config_lock();
+	if (snd_config_global_update == NULL) {
+		snd_config_unpublish();
+		err = snd_config_update_r(&snd_config,
+					  &snd_config_global_update, NULL);
+		if (err < 0)
+			goto _end;
+		snd_config_publish();
+	}
+	if (snd_config_watch_fd < 0) {
+		snd_config_watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (snd_config_watch_fd < 0) {
+			err = -errno;
+			goto _end;
+		}
+	} else {
+		/* re-arm: the caller handled the events reported so far */
+		while (read(snd_config_watch_fd, buf, sizeof(buf)) > 0)
+			;
+	}
+	/* adding a watch for an already watched directory just refreshes
+	 * it, so the whole file list is walked on every call; watches for
+	 * directories no longer referenced are kept and may cause extra
+	 * wakeups until the descriptor is freed */
+	for (k = 0; k < snd_config_global_update->count; k++) {
+		err = snd_config_watch_add(snd_config_watch_fd,
+					   snd_config_global_update->finfo[k].name);
+		if (err < 0)
+			break;
+	}
+	if (err < 0) {
+		close(snd_config_watch_fd);
+		snd_config_watch_fd = -1;
+		snd_config_watch_update = NULL;
+	} else {
+		/* enables the watch based fast path in
+		 * snd_config_update_r() for the current file set */
+		snd_config_watch_update = snd_config_global_update;
+		err = snd_config_watch_fd;
+	}
+ _end:
+	snd_config_unlock();
+	return err;
+}
+
+/**
+ * \brief Stops watching the global configuration files.
+ * \return Zero if successful, otherwise a negative error code.
+ *
+ * Removes the watches registered by #snd_config_update_watch and closes
+ * the file descriptor returned by it.
+ *
+ * This function is supposed to be thread-safe.
+ */
+int snd_config_update_watch_free(void)
+{
+	snd_config_lock();
+	if (snd_config_watch_fd >= 0) {
+		close(snd_config_watch_fd);
+		snd_config_watch_fd = -1;
+	}
+	snd_config_watch_update = NULL;
+	snd_config_unlock();
+	return 0;
+}
+
 /**
  * \brief Returns an iterator pointing to a node's first child.
  * \param[in] config Handle to a configuration node.
@@ -4929,6 +6197,42 @@ static int snd_config_walk(snd_config_t *src,
 	return err;
 }
 
+/*
+ * Creates a detached shallow copy of a node for tree duplication.
+ *
+ * The id of \a src (and for string nodes also the value) is already a
+ * shared interned string, so it is reused by bumping its reference
+ * instead of hashing into the intern table again; for a typical
+ * expansion this turns nearly every node copy into a plain allocation
+ * plus one or two reference increments.  Children of compound nodes are
+ * not copied - the walk attaches them one by one.
+ */
+static int _snd_config_dup_node(snd_config_t **config, snd_config_t *src)
+{
+	snd_config_t *n;
+
+	n = calloc(1, sizeof(*n));
+	if (n == NULL)
+		return -ENOMEM;
+	snd_memstat_update(SND_MEMSTAT_CONFIG, sizeof(*n), 1);
+	n->id = _snd_config_intern_ref(src->id);
+	n->type = src->type;
+	switch (src->type) {
+	case SND_CONFIG_TYPE_COMPOUND:
+		INIT_LIST_HEAD(&n->u.compound.fields);
+		n->u.compound.join = src->u.compound.join;
+		break;
+	case SND_CONFIG_TYPE_STRING:
+		n->u.string = _snd_config_intern_ref(src->u.string);
+		break;
+	default:
+		n->u = src->u;
+		break;
+	}
+	*config = n;
+	return 0;
+}
+
 static int _snd_config_copy(snd_config_t *src,
 			    snd_config_t *root ATTRIBUTE_UNUSED,
 			    snd_config_t **dst,
@@ -4937,56 +6241,12 @@ static int _snd_config_copy(snd_config_t *src,
 			    void *private_data ATTRIBUTE_UNUSED)
 {
 	int err;
-	const char *id = src->id;
-	snd_config_type_t type = snd_config_get_type(src);
 	switch (pass) {
 	case SND_CONFIG_WALK_PASS_PRE:
-		err = snd_config_make_compound(dst, id, src->u.compound.join);
-		if (err < 0)
-			return err;
-		break;
 	case SND_CONFIG_WALK_PASS_LEAF:
-		err = snd_config_make(dst, id, type);
+		err = _snd_config_dup_node(dst, src);
 		if (err < 0)
 			return err;
-		switch (type) {
-		case SND_CONFIG_TYPE_INTEGER:
-		{
-			long v;
-			err = snd_config_get_integer(src, &v);
-			assert(err >= 0);
-			snd_config_set_integer(*dst, v);
-			break;
-		}
-		case SND_CONFIG_TYPE_INTEGER64:
-		{
-			long long v;
-			err = snd_config_get_integer64(src, &v);
-			assert(err >= 0);
-			snd_config_set_integer64(*dst, v);
-			break;
-		}
-		case SND_CONFIG_TYPE_REAL:
-		{
-			double v;
-			err = snd_config_get_real(src, &v);
-			assert(err >= 0);
-			snd_config_set_real(*dst, v);
-			break;
-		}
-		case SND_CONFIG_TYPE_STRING:
-		{
-			const char *s;
-			err = snd_config_get_string(src, &s);
-			assert(err >= 0);
-			err = snd_config_set_string(*dst, s);
-			if (err < 0)
-				return err;
-			break;
-		}
-		default:
-			assert(0);
-		}
 		break;
 	default:
 		break;
@@ -5043,45 +6303,13 @@ static int _snd_config_expand(snd_config_t *src,
 	{
 		if (id && strcmp(id, "@args") == 0)
 			return 0;
-		err = snd_config_make_compound(dst, id, src->u.compound.join);
+		err = _snd_config_dup_node(dst, src);
 		if (err < 0)
 			return err;
 		break;
 	}
 	case SND_CONFIG_WALK_PASS_LEAF:
-		switch (type) {
-		case SND_CONFIG_TYPE_INTEGER:
-		{
-			long v;
-			err = snd_config_get_integer(src, &v);
-			assert(err >= 0);
-			err = snd_config_imake_integer(dst, id, v);
-			if (err < 0)
-				return err;
-			break;
-		}
-		case SND_CONFIG_TYPE_INTEGER64:
-		{
-			long long v;
-			err = snd_config_get_integer64(src, &v);
-			assert(err >= 0);
-			err = snd_config_imake_integer64(dst, id, v);
-			if (err < 0)
-				return err;
-			break;
-		}
-		case SND_CONFIG_TYPE_REAL:
-		{
-			double v;
-			err = snd_config_get_real(src, &v);
-			assert(err >= 0);
-			err = snd_config_imake_real(dst, id, v);
-			if (err < 0)
-				return err;
-			break;
-		}
-		case SND_CONFIG_TYPE_STRING:
-		{
+		if (type == SND_CONFIG_TYPE_STRING) {
 			const char *s;
 			snd_config_t *vars = private_data;
 			snd_config_get_string(src, &s);
@@ -5096,16 +6324,12 @@ static int _snd_config_expand(snd_config_t *src,
 					snd_config_delete(*dst);
 					return err;
 				}
-			} else {
-				err = snd_config_imake_string(dst, id, s);
-				if (err < 0)
-					return err;
+				break;
 			}
-			break;
-		}
-		default:
-			assert(0);
 		}
+		err = _snd_config_dup_node(dst, src);
+		if (err < 0)
+			return err;
 		break;
 	default:
 		break;
@@ -5122,12 +6346,11 @@ static int _snd_config_evaluate(snd_config_t *src,
 {
 	int err;
 	if (pass == SND_CONFIG_WALK_PASS_PRE) {
-		char *buf = NULL, errbuf[256];
+		char *buf = NULL;
 		const char *lib = NULL, *func_name = NULL;
 		const char *str;
 		int (*func)(snd_config_t **dst, snd_config_t *root,
 			    snd_config_t *src, snd_config_t *private_data) = NULL;
-		void *h = NULL;
 		snd_config_t *c, *func_conf = NULL;
 		err = snd_config_search(src, "@func", &c);
 		if (err < 0)
@@ -5181,20 +6404,12 @@ static int _snd_config_evaluate(snd_config_t *src,
 			buf[len-1] = '\0';
 			func_name = buf;
 		}
-		h = INTERNAL(snd_dlopen)(lib, RTLD_NOW, errbuf, sizeof(errbuf));
-		if (h)
-			func = snd_dlsym(h, func_name, SND_DLSYM_VERSION(SND_CONFIG_DLSYM_VERSION_EVALUATE));
-		err = 0;
-		if (!h) {
-			SNDERR("Cannot open shared library %s (%s)", lib, errbuf);
-			err = -ENOENT;
-			goto _errbuf;
-		} else if (!func) {
-			SNDERR("symbol %s is not defined inside %s", func_name, lib);
-			snd_dlclose(h);
-			err = -ENXIO;
-			goto _errbuf;
-		}
+		/* the cache keeps the shared library open, so a function
+		 * evaluated once per device open is resolved only once
+		 * per process */
+		func = snd_dlobj_cache_get(lib, func_name,
+				SND_DLSYM_VERSION(SND_CONFIG_DLSYM_VERSION_EVALUATE), 1);
+		err = func ? 0 : -ENXIO;
 	       _err:
 		if (func_conf)
 			snd_config_delete(func_conf);
@@ -5203,11 +6418,10 @@ static int _snd_config_evaluate(snd_config_t *src,
 			err = func(&eval, root, src, private_data);
 			if (err < 0)
 				SNDERR("function %s returned error: %s", func_name, snd_strerror(err));
-			snd_dlclose(h);
+			snd_dlobj_cache_put((void *)func);
 			if (err >= 0 && eval)
 				err = snd_config_substitute(src, eval);
 		}
-	       _errbuf:
 		free(buf);
 		if (err < 0)
 			return err;
@@ -80,6 +80,9 @@
 #include <string.h>
 #include <ctype.h>
 #include <limits.h>
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
 
 /**
  * \brief Gets the boolean value from the given ASCII string.
@@ -631,6 +634,74 @@ static int open_ctl(long card, snd_ctl_t **ctl)
 	return snd_ctl_open(ctl, name, 0);
 }
 
+/*
+ * Cached control card info
+ *
+ * The card_* functions are evaluated again and again for every device
+ * open, and each evaluation used to open the control device just to
+ * read the constant card info.  Cache the info per card; a slot is
+ * considered stale once the configuration is updated (the natural
+ * point where hardware changes are picked up), so a multi-card setup
+ * does one control open per card instead of dozens.
+ */
+
+#ifndef DOC_HIDDEN
+#define CARD_INFO_CACHE_SIZE	8
+
+struct card_info_slot {
+	long card;
+	unsigned int generation;
+	int valid;
+	snd_ctl_card_info_t info;
+};
+#endif
+
+static struct card_info_slot card_info_cache[CARD_INFO_CACHE_SIZE];
+
+#ifdef HAVE_LIBPTHREAD
+static pthread_mutex_t card_info_mutex = PTHREAD_MUTEX_INITIALIZER;
+static inline void card_info_lock(void) { pthread_mutex_lock(&card_info_mutex); }
+static inline void card_info_unlock(void) { pthread_mutex_unlock(&card_info_mutex); }
+#else
+static inline void card_info_lock(void) { }
+static inline void card_info_unlock(void) { }
+#endif
+
+static int get_card_info(long card, snd_ctl_card_info_t *info)
+{
+	struct card_info_slot *slot = &card_info_cache[card & (CARD_INFO_CACHE_SIZE - 1)];
+	unsigned int generation = snd_config_update_generation();
+	snd_ctl_t *ctl;
+	int err;
+
+	card_info_lock();
+	if (slot->valid && slot->card == card &&
+	    slot->generation == generation) {
+		*info = slot->info;
+		card_info_unlock();
+		return 0;
+	}
+	card_info_unlock();
+	err = open_ctl(card, &ctl);
+	if (err < 0) {
+		SNDERR("could not open control for card %li", card);
+		return err;
+	}
+	err = snd_ctl_card_info(ctl, info);
+	snd_ctl_close(ctl);
+	if (err < 0) {
+		SNDERR("snd_ctl_card_info error: %s", snd_strerror(err));
+		return err;
+	}
+	card_info_lock();
+	slot->card = card;
+	slot->generation = generation;
+	slot->info = *info;
+	slot->valid = 1;
+	card_info_unlock();
+	return 0;
+}
+
 #if 0
 static int string_from_integer(char **dst, long v)
 {
@@ -751,33 +822,19 @@ SND_DLSYM_BUILD_VERSION(snd_func_private_integer, SND_CONFIG_DLSYM_VERSION_EVALU
 #ifndef DOC_HIDDEN
 int snd_determine_driver(int card, char **driver)
 {
-	snd_ctl_t *ctl = NULL;
 	snd_ctl_card_info_t info = {0};
-	char *res = NULL;
+	char *res;
 	int err;
 
 	assert(card >= 0 && card <= SND_MAX_CARDS);
-	err = open_ctl(card, &ctl);
-	if (err < 0) {
-		SNDERR("could not open control for card %i", card);
-		goto __error;
-	}
-	err = snd_ctl_card_info(ctl, &info);
-	if (err < 0) {
-		SNDERR("snd_ctl_card_info error: %s", snd_strerror(err));
-		goto __error;
-	}
+	err = get_card_info(card, &info);
+	if (err < 0)
+		return err;
 	res = strdup(snd_ctl_card_info_get_driver(&info));
 	if (res == NULL)
-		err = -ENOMEM;
-	else {
-		*driver = res;
-		err = 0;
-	}
-      __error:
-	if (ctl)
-		snd_ctl_close(ctl);
-	return err;
+		return -ENOMEM;
+	*driver = res;
+	return 0;
 }
 #endif
 
@@ -949,31 +1006,20 @@ SND_DLSYM_BUILD_VERSION(snd_func_card_driver, SND_CONFIG_DLSYM_VERSION_EVALUATE)
 int snd_func_card_id(snd_config_t **dst, snd_config_t *root, snd_config_t *src,
 		     snd_config_t *private_data)
 {
-	snd_ctl_t *ctl = NULL;
 	snd_ctl_card_info_t info = {0};
 	const char *id;
 	int card, err;
-	
+
 	card = parse_card(root, src, private_data);
 	if (card < 0)
 		return card;
-	err = open_ctl(card, &ctl);
-	if (err < 0) {
-		SNDERR("could not open control for card %i", card);
-		goto __error;
-	}
-	err = snd_ctl_card_info(ctl, &info);
-	if (err < 0) {
-		SNDERR("snd_ctl_card_info error: %s", snd_strerror(err));
-		goto __error;
-	}
+	err = get_card_info(card, &info);
+	if (err < 0)
+		return err;
 	err = snd_config_get_id(src, &id);
 	if (err >= 0)
 		err = snd_config_imake_string(dst, id,
 					      snd_ctl_card_info_get_id(&info));
-      __error:
-      	if (ctl)
-      		snd_ctl_close(ctl);
 	return err;
 }
 #ifndef DOC_HIDDEN
@@ -1000,31 +1046,20 @@ SND_DLSYM_BUILD_VERSION(snd_func_card_id, SND_CONFIG_DLSYM_VERSION_EVALUATE);
 int snd_func_card_name(snd_config_t **dst, snd_config_t *root,
 		       snd_config_t *src, snd_config_t *private_data)
 {
-	snd_ctl_t *ctl = NULL;
 	snd_ctl_card_info_t info = {0};
 	const char *id;
 	int card, err;
-	
+
 	card = parse_card(root, src, private_data);
 	if (card < 0)
 		return card;
-	err = open_ctl(card, &ctl);
-	if (err < 0) {
-		SNDERR("could not open control for card %i", card);
-		goto __error;
-	}
-	err = snd_ctl_card_info(ctl, &info);
-	if (err < 0) {
-		SNDERR("snd_ctl_card_info error: %s", snd_strerror(err));
-		goto __error;
-	}
+	err = get_card_info(card, &info);
+	if (err < 0)
+		return err;
 	err = snd_config_get_id(src, &id);
 	if (err >= 0)
 		err = snd_config_imake_safe_string(dst, id,
 					snd_ctl_card_info_get_name(&info));
-      __error:
-      	if (ctl)
-      		snd_ctl_close(ctl);
 	return err;
 }
 #ifndef DOC_HIDDEN
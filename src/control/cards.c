@@ -32,13 +32,97 @@
 #include <string.h>
 #include <ctype.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <sys/ioctl.h>
+#include <sys/inotify.h>
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
 
 #ifndef DOC_HIDDEN
 #define SND_FILE_CONTROL	ALSA_DEVICE_DIRECTORY "controlC%i"
 #define SND_FILE_LOAD		ALOAD_DEVICE_DIRECTORY "aloadC%i"
+
+/* process-wide card registry; presence and card info are queried over
+ * and over during client startup (namehint, config hooks, UCM), so the
+ * answers are kept here and dropped when an inotify watch on the device
+ * directory reports a change.  Without a working watch the registry is
+ * left disabled and every query goes to the devices as before.
+ */
+struct snd_card_reg_entry {
+	int present;		/* -1 = unknown, 0 = absent, 1 = present */
+	char *id;		/* card info strings, NULL = not fetched */
+	char *name;
+	char *longname;
+};
+
+static struct snd_card_reg_entry snd_card_registry[SND_MAX_CARDS];
+static int snd_card_notify_fd = -1;
+static int snd_card_notify_failed;
+
+#ifdef HAVE_LIBPTHREAD
+static pthread_mutex_t snd_card_registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static inline void snd_card_registry_lock(void)
+{
+	pthread_mutex_lock(&snd_card_registry_mutex);
+}
+
+static inline void snd_card_registry_unlock(void)
+{
+	pthread_mutex_unlock(&snd_card_registry_mutex);
+}
+#else
+static inline void snd_card_registry_lock(void) {}
+static inline void snd_card_registry_unlock(void) {}
 #endif
 
+static void snd_card_registry_flush(void)
+{
+	int i;
+
+	for (i = 0; i < SND_MAX_CARDS; i++) {
+		struct snd_card_reg_entry *ent = &snd_card_registry[i];
+		ent->present = -1;
+		free(ent->id);
+		free(ent->name);
+		free(ent->longname);
+		ent->id = ent->name = ent->longname = NULL;
+	}
+}
+
+/* returns non-zero when the registry may be used (called with the lock
+ * held); drains the inotify queue and flushes stale entries first
+ */
+static int snd_card_registry_usable(void)
+{
+	char buf[sizeof(struct inotify_event) + NAME_MAX + 1];
+	int changed = 0;
+
+	if (snd_card_notify_failed)
+		return 0;
+	if (snd_card_notify_fd < 0) {
+		snd_card_notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (snd_card_notify_fd < 0 ||
+		    inotify_add_watch(snd_card_notify_fd, ALSA_DEVICE_DIRECTORY,
+				      IN_CREATE | IN_DELETE | IN_MOVE) < 0) {
+			if (snd_card_notify_fd >= 0)
+				close(snd_card_notify_fd);
+			snd_card_notify_fd = -1;
+			snd_card_notify_failed = 1;
+			return 0;
+		}
+		snd_card_registry_flush();
+		return 1;
+	}
+	while (read(snd_card_notify_fd, buf, sizeof(buf)) > 0)
+		changed = 1;
+	if (changed)
+		snd_card_registry_flush();
+	return 1;
+}
+#endif /* DOC_HIDDEN */
+
 static int snd_card_load2(const char *control)
 {
 	int open_dev;
@@ -75,6 +159,51 @@ static int snd_card_load1(int card)
 	return res;
 }
 
+#ifndef DOC_HIDDEN
+/* presence check through the registry (called with the lock held) */
+static int snd_card_registry_load(int card)
+{
+	struct snd_card_reg_entry *ent = &snd_card_registry[card];
+
+	if (ent->present < 0)
+		ent->present = snd_card_load1(card) >= 0;
+	return ent->present;
+}
+
+/* fetch and cache the card info strings (called with the lock held) */
+static int snd_card_registry_info(int card, struct snd_card_reg_entry **entp)
+{
+	struct snd_card_reg_entry *ent = &snd_card_registry[card];
+	snd_ctl_t *handle;
+	snd_ctl_card_info_t info;
+	int err;
+
+	if (ent->id == NULL) {
+		if ((err = snd_ctl_hw_open(&handle, NULL, card, 0)) < 0)
+			return err;
+		if ((err = snd_ctl_card_info(handle, &info)) < 0) {
+			snd_ctl_close(handle);
+			return err;
+		}
+		snd_ctl_close(handle);
+		ent->id = strdup((const char *)info.id);
+		ent->name = strdup((const char *)info.name);
+		ent->longname = strdup((const char *)info.longname);
+		if (ent->id == NULL || ent->name == NULL ||
+		    ent->longname == NULL) {
+			free(ent->id);
+			free(ent->name);
+			free(ent->longname);
+			ent->id = ent->name = ent->longname = NULL;
+			return -ENOMEM;
+		}
+		ent->present = 1;
+	}
+	*entp = ent;
+	return 0;
+}
+#endif /* DOC_HIDDEN */
+
 /**
  * \brief Try to load the driver for a card.
  * \param card Card index.
@@ -82,6 +211,17 @@ static int snd_card_load1(int card)
  */
 int snd_card_load(int card)
 {
+	int res;
+
+	if (card >= 0 && card < SND_MAX_CARDS) {
+		snd_card_registry_lock();
+		if (snd_card_registry_usable()) {
+			res = snd_card_registry_load(card);
+			snd_card_registry_unlock();
+			return res;
+		}
+		snd_card_registry_unlock();
+	}
 	return !!(snd_card_load1(card) >= 0);
 }
 
@@ -161,6 +301,26 @@ int snd_card_get_index(const char *string)
 		/* We got a device name */
 		return snd_card_load2(string);
 	/* We got in ID */
+	snd_card_registry_lock();
+	if (snd_card_registry_usable()) {
+		struct snd_card_reg_entry *ent;
+
+		for (card = 0; card < SND_MAX_CARDS; card++) {
+#ifdef SUPPORT_ALOAD
+			if (! snd_card_registry_load(card))
+				continue;
+#endif
+			if (snd_card_registry_info(card, &ent) < 0)
+				continue;
+			if (!strcmp(ent->id, string)) {
+				snd_card_registry_unlock();
+				return card;
+			}
+		}
+		snd_card_registry_unlock();
+		return -ENODEV;
+	}
+	snd_card_registry_unlock();
 	for (card = 0; card < SND_MAX_CARDS; card++) {
 #ifdef SUPPORT_ALOAD
 		if (! snd_card_load(card))
@@ -191,12 +351,27 @@ int snd_card_get_index(const char *string)
  */
 int snd_card_get_name(int card, char **name)
 {
+	struct snd_card_reg_entry *ent;
 	snd_ctl_t *handle;
 	snd_ctl_card_info_t info;
 	int err;
-	
+
 	if (name == NULL)
 		return -EINVAL;
+	if (card >= 0 && card < SND_MAX_CARDS) {
+		snd_card_registry_lock();
+		if (snd_card_registry_usable()) {
+			err = snd_card_registry_info(card, &ent);
+			if (err >= 0) {
+				*name = strdup(ent->name);
+				if (*name == NULL)
+					err = -ENOMEM;
+			}
+			snd_card_registry_unlock();
+			return err;
+		}
+		snd_card_registry_unlock();
+	}
 	if ((err = snd_ctl_hw_open(&handle, NULL, card, 0)) < 0)
 		return err;
 	if ((err = snd_ctl_card_info(handle, &info)) < 0) {
@@ -221,12 +396,27 @@ int snd_card_get_name(int card, char **name)
  */
 int snd_card_get_longname(int card, char **name)
 {
+	struct snd_card_reg_entry *ent;
 	snd_ctl_t *handle;
 	snd_ctl_card_info_t info;
 	int err;
-	
+
 	if (name == NULL)
 		return -EINVAL;
+	if (card >= 0 && card < SND_MAX_CARDS) {
+		snd_card_registry_lock();
+		if (snd_card_registry_usable()) {
+			err = snd_card_registry_info(card, &ent);
+			if (err >= 0) {
+				*name = strdup(ent->longname);
+				if (*name == NULL)
+					err = -ENOMEM;
+			}
+			snd_card_registry_unlock();
+			return err;
+		}
+		snd_card_registry_unlock();
+	}
 	if ((err = snd_ctl_hw_open(&handle, NULL, card, 0)) < 0)
 		return err;
 	if ((err = snd_ctl_card_info(handle, &info)) < 0) {
@@ -241,6 +241,7 @@ int snd_ctl_close(snd_ctl_t *ctl)
 		snd_async_del_handler(h);
 	}
 	err = ctl->ops->close(ctl);
+	free(ctl->filter_ids);
 	free(ctl->name);
 	snd_dlobj_cache_put(ctl->open_func);
 	free(ctl);
@@ -370,6 +371,72 @@ int snd_ctl_subscribe_events(snd_ctl_t *ctl, int subscribe)
 	return ctl->ops->subscribe_events(ctl, subscribe);
 }
 
+/**
+ * \brief Add an element identifier to the event filter
+ * \param ctl CTL handle
+ * \param id Element identifier of interest
+ * \return 0 on success otherwise a negative error code
+ *
+ * While the event filter is non-empty, #snd_ctl_read delivers only
+ * element events matching one of the registered identifiers and
+ * discards the rest before they reach the caller.  An identifier
+ * with a non-zero numid matches on the numid alone, otherwise the
+ * interface, device, subdevice, name and index are compared.
+ *
+ * The kernel still queues every event for a subscribed handle; the
+ * filter saves the per-event processing in the application, not the
+ * wakeups themselves.
+ */
+int snd_ctl_event_filter_add_id(snd_ctl_t *ctl, const snd_ctl_elem_id_t *id)
+{
+	assert(ctl && id);
+	if (ctl->filter_count >= ctl->filter_alloc) {
+		unsigned int alloc = ctl->filter_alloc + 8;
+		snd_ctl_elem_id_t *ids;
+		ids = realloc(ctl->filter_ids, alloc * sizeof(*ids));
+		if (ids == NULL)
+			return -ENOMEM;
+		ctl->filter_ids = ids;
+		ctl->filter_alloc = alloc;
+	}
+	ctl->filter_ids[ctl->filter_count++] = *id;
+	return 0;
+}
+
+/**
+ * \brief Add an element numeric identifier to the event filter
+ * \param ctl CTL handle
+ * \param numid Element numeric identifier of interest (greater than zero)
+ * \return 0 on success otherwise a negative error code
+ *
+ * Convenience variant of #snd_ctl_event_filter_add_id matching on
+ * the numid alone.
+ */
+int snd_ctl_event_filter_add_numid(snd_ctl_t *ctl, unsigned int numid)
+{
+	snd_ctl_elem_id_t id;
+	assert(ctl && numid > 0);
+	memset(&id, 0, sizeof(id));
+	id.numid = numid;
+	return snd_ctl_event_filter_add_id(ctl, &id);
+}
+
+/**
+ * \brief Remove all element identifiers from the event filter
+ * \param ctl CTL handle
+ * \return 0 on success otherwise a negative error code
+ *
+ * With an empty filter #snd_ctl_read delivers all events again.
+ */
+int snd_ctl_event_filter_clear(snd_ctl_t *ctl)
+{
+	assert(ctl);
+	free(ctl->filter_ids);
+	ctl->filter_ids = NULL;
+	ctl->filter_count = ctl->filter_alloc = 0;
+	return 0;
+}
+
 
 /**
  * \brief Get information about the sound card.
@@ -1037,6 +1104,69 @@ int snd_ctl_elem_write(snd_ctl_t *ctl, snd_ctl_elem_value_t *data)
 	return ctl->ops->element_write(ctl, data);
 }
 
+/**
+ * \brief Get several CTL element values in one call.
+ *
+ * Reads the values for a whole set of elements, e.g. to take a mixer
+ * state snapshot.  The IDs must be set in all values before calling
+ * the function.  Backends which can batch the transfer do so; others
+ * fall back to reading the elements one by one.
+ *
+ * \param ctl CTL handle.
+ * \param data Array of element value pointers; the actual values are
+ *             returned in place.
+ * \param count Number of elements in the array.
+ *
+ * \return 0 on success otherwise a negative error code.
+ */
+int snd_ctl_elem_read_many(snd_ctl_t *ctl, snd_ctl_elem_value_t **data,
+			   unsigned int count)
+{
+	unsigned int k;
+	int err;
+
+	assert(ctl && (data || !count));
+	if (ctl->ops->element_read_many)
+		return ctl->ops->element_read_many(ctl, data, count);
+	for (k = 0; k < count; k++) {
+		err = snd_ctl_elem_read(ctl, data[k]);
+		if (err < 0)
+			return err;
+	}
+	return 0;
+}
+
+/**
+ * \brief Set several CTL element values in one call.
+ *
+ * Writes the values for a whole set of elements, e.g. to restore a
+ * mixer state snapshot.  The IDs and values must be set before
+ * calling the function.  Backends which can batch the transfer do so;
+ * others fall back to writing the elements one by one.
+ *
+ * \param ctl CTL handle.
+ * \param data Array of element value pointers.
+ * \param count Number of elements in the array.
+ *
+ * \return 0 on success otherwise a negative error code.
+ */
+int snd_ctl_elem_write_many(snd_ctl_t *ctl, snd_ctl_elem_value_t **data,
+			    unsigned int count)
+{
+	unsigned int k;
+	int err;
+
+	assert(ctl && (data || !count));
+	if (ctl->ops->element_write_many)
+		return ctl->ops->element_write_many(ctl, data, count);
+	for (k = 0; k < count; k++) {
+		err = snd_ctl_elem_write(ctl, data[k]);
+		if (err < 0)
+			return err;
+	}
+	return 0;
+}
+
 static int snd_ctl_tlv_do(snd_ctl_t *ctl, int op_flag,
 			  const snd_ctl_elem_id_t *id,
 		          unsigned int *tlv, unsigned int tlv_size)
@@ -1336,16 +1466,88 @@ int snd_ctl_get_power_state(snd_ctl_t *ctl, unsigned int *state)
 	return -ENXIO;
 }
 
+#ifndef DOC_HIDDEN
+static int snd_ctl_event_filter_match(snd_ctl_t *ctl, snd_ctl_event_t *event)
+{
+	const snd_ctl_elem_id_t *eid = &event->data.elem.id;
+	unsigned int i;
+
+	if (event->type != SND_CTL_EVENT_ELEM)
+		return 1;
+	for (i = 0; i < ctl->filter_count; i++) {
+		const snd_ctl_elem_id_t *id = &ctl->filter_ids[i];
+		if (id->numid > 0) {
+			if (id->numid == eid->numid)
+				return 1;
+			continue;
+		}
+		if (id->iface == eid->iface &&
+		    id->device == eid->device &&
+		    id->subdevice == eid->subdevice &&
+		    id->index == eid->index &&
+		    strcmp((const char *)id->name, (const char *)eid->name) == 0)
+			return 1;
+	}
+	return 0;
+}
+#endif
+
 /**
  * \brief Read an event
  * \param ctl CTL handle
  * \param event Event pointer
  * \return number of events read otherwise a negative error code on failure
+ *
+ * When an event filter is installed (see #snd_ctl_event_filter_add_id),
+ * element events matching none of the registered identifiers are
+ * discarded here; in nonblock mode the queue is drained until a
+ * matching event or -EAGAIN.
  */
 int snd_ctl_read(snd_ctl_t *ctl, snd_ctl_event_t *event)
 {
+	int err;
+
 	assert(ctl && event);
-	return (ctl->ops->read)(ctl, event);
+	do {
+		err = (ctl->ops->read)(ctl, event);
+	} while (err > 0 && ctl->filter_count > 0 &&
+		 !snd_ctl_event_filter_match(ctl, event));
+	return err;
+}
+
+/**
+ * \brief Read multiple pending events at once
+ * \param ctl CTL handle
+ * \param events Event array
+ * \param count Event array size (greater than zero)
+ * \return number of events read otherwise a negative error code on failure
+ *
+ * Where the backend supports it (the hw backend does), all pending
+ * events up to \a count are fetched with a single read() instead of
+ * one syscall per event.  Backends without bulk support deliver one
+ * event per call.  With an event filter installed this may return 0
+ * when every fetched event was discarded; the caller should simply
+ * read again.
+ */
+int snd_ctl_read_many(snd_ctl_t *ctl, snd_ctl_event_t *events, unsigned int count)
+{
+	int err;
+
+	assert(ctl && events);
+	if (count == 0)
+		return -EINVAL;
+	if (ctl->ops->read_many)
+		err = ctl->ops->read_many(ctl, events, count);
+	else
+		err = (ctl->ops->read)(ctl, events);
+	if (err > 0 && ctl->filter_count > 0) {
+		int i, n = 0;
+		for (i = 0; i < err; i++)
+			if (snd_ctl_event_filter_match(ctl, &events[i]))
+				events[n++] = events[i];
+		err = n;
+	}
+	return err;
 }
 
 /**
@@ -215,6 +215,12 @@ static int snd_ctl_ext_elem_read(snd_ctl_t *handle, snd_ctl_elem_value_t *contro
 	key = get_elem(ext, &control->id);
 	if (key == SND_CTL_EXT_KEY_NOT_FOUND)
 		return -ENOENT;
+	/* direct in-place access without the attribute round trip */
+	if (ext->version >= SNDRV_PROTOCOL_VERSION(1, 0, 2) &&
+	    ext->callback->elem_read) {
+		ret = ext->callback->elem_read(ext, key, control);
+		goto err;
+	}
 	ret = ext->callback->get_attribute(ext, key, &type, &access, &count);
 	if (ret < 0)
 		goto err;
@@ -269,6 +275,12 @@ static int snd_ctl_ext_elem_write(snd_ctl_t *handle, snd_ctl_elem_value_t *contr
 	key = get_elem(ext, &control->id);
 	if (key == SND_CTL_EXT_KEY_NOT_FOUND)
 		return -ENOENT;
+	/* direct in-place access without the attribute round trip */
+	if (ext->version >= SNDRV_PROTOCOL_VERSION(1, 0, 2) &&
+	    ext->callback->elem_write) {
+		ret = ext->callback->elem_write(ext, key, control);
+		goto err;
+	}
 	ret = ext->callback->get_attribute(ext, key, &type, &access, &count);
 	if (ret < 0)
 		goto err;
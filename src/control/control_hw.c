@@ -202,6 +202,36 @@ static int snd_ctl_hw_elem_write(snd_ctl_t *handle, snd_ctl_elem_value_t *contro
 	return 0;
 }
 
+/*
+ * The kernel offers no vectored ELEM_READ/WRITE ioctl so far; the loops
+ * are kept here so a future batched ioctl only needs to land in one place.
+ */
+static int snd_ctl_hw_elem_read_many(snd_ctl_t *handle,
+				     snd_ctl_elem_value_t **controls,
+				     unsigned int count)
+{
+	snd_ctl_hw_t *hw = handle->private_data;
+	unsigned int k;
+
+	for (k = 0; k < count; k++)
+		if (ioctl(hw->fd, SNDRV_CTL_IOCTL_ELEM_READ, controls[k]) < 0)
+			return -errno;
+	return 0;
+}
+
+static int snd_ctl_hw_elem_write_many(snd_ctl_t *handle,
+				      snd_ctl_elem_value_t **controls,
+				      unsigned int count)
+{
+	snd_ctl_hw_t *hw = handle->private_data;
+	unsigned int k;
+
+	for (k = 0; k < count; k++)
+		if (ioctl(hw->fd, SNDRV_CTL_IOCTL_ELEM_WRITE, controls[k]) < 0)
+			return -errno;
+	return 0;
+}
+
 static int snd_ctl_hw_elem_lock(snd_ctl_t *handle, snd_ctl_elem_id_t *id)
 {
 	snd_ctl_hw_t *hw = handle->private_data;
@@ -382,6 +412,20 @@ static int snd_ctl_hw_read(snd_ctl_t *handle, snd_ctl_event_t *event)
 	return 1;
 }
 
+static int snd_ctl_hw_read_many(snd_ctl_t *handle, snd_ctl_event_t *events,
+				unsigned int count)
+{
+	snd_ctl_hw_t *hw = handle->private_data;
+	ssize_t res = read(hw->fd, events, count * sizeof(*events));
+	if (res <= 0)
+		return -errno;
+	if (CHECK_SANITY(res % sizeof(*events) != 0)) {
+		SNDMSG("snd_ctl_hw_read_many: read size error (got:%d)", res);
+		return -EINVAL;
+	}
+	return res / sizeof(*events);
+}
+
 static const snd_ctl_ops_t snd_ctl_hw_ops = {
 	.close = snd_ctl_hw_close,
 	.nonblock = snd_ctl_hw_nonblock,
@@ -395,6 +439,8 @@ static const snd_ctl_ops_t snd_ctl_hw_ops = {
 	.element_remove = snd_ctl_hw_elem_remove,
 	.element_read = snd_ctl_hw_elem_read,
 	.element_write = snd_ctl_hw_elem_write,
+	.element_read_many = snd_ctl_hw_elem_read_many,
+	.element_write_many = snd_ctl_hw_elem_write_many,
 	.element_lock = snd_ctl_hw_elem_lock,
 	.element_unlock = snd_ctl_hw_elem_unlock,
 	.element_tlv = snd_ctl_hw_elem_tlv,
@@ -412,6 +458,7 @@ static const snd_ctl_ops_t snd_ctl_hw_ops = {
 	.set_power_state = snd_ctl_hw_set_power_state,
 	.get_power_state = snd_ctl_hw_get_power_state,
 	.read = snd_ctl_hw_read,
+	.read_many = snd_ctl_hw_read_many,
 };
 
 /**
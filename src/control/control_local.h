@@ -35,6 +35,8 @@ typedef struct _snd_ctl_ops {
 	int (*element_remove)(snd_ctl_t *handle, snd_ctl_elem_id_t *id);
 	int (*element_read)(snd_ctl_t *handle, snd_ctl_elem_value_t *control);
 	int (*element_write)(snd_ctl_t *handle, snd_ctl_elem_value_t *control);
+	int (*element_read_many)(snd_ctl_t *handle, snd_ctl_elem_value_t **controls, unsigned int count);
+	int (*element_write_many)(snd_ctl_t *handle, snd_ctl_elem_value_t **controls, unsigned int count);
 	int (*element_lock)(snd_ctl_t *handle, snd_ctl_elem_id_t *lock);
 	int (*element_unlock)(snd_ctl_t *handle, snd_ctl_elem_id_t *unlock);
 	int (*element_tlv)(snd_ctl_t *handle, int op_flag, unsigned int numid,
@@ -53,6 +55,7 @@ typedef struct _snd_ctl_ops {
 	int (*set_power_state)(snd_ctl_t *handle, unsigned int state);
 	int (*get_power_state)(snd_ctl_t *handle, unsigned int *state);
 	int (*read)(snd_ctl_t *handle, snd_ctl_event_t *event);
+	int (*read_many)(snd_ctl_t *handle, snd_ctl_event_t *events, unsigned int count);
 	int (*poll_descriptors_count)(snd_ctl_t *handle);
 	int (*poll_descriptors)(snd_ctl_t *handle, struct pollfd *pfds, unsigned int space);
 	int (*poll_revents)(snd_ctl_t *handle, struct pollfd *pfds, unsigned int nfds, unsigned short *revents);
@@ -69,12 +72,18 @@ struct _snd_ctl {
 	int nonblock;
 	int poll_fd;
 	struct list_head async_handlers;
+	/* event filter, empty = pass all events */
+	snd_ctl_elem_id_t *filter_ids;	/* element ids of interest */
+	unsigned int filter_count;
+	unsigned int filter_alloc;
 };
 
 struct _snd_hctl_elem {
 	snd_ctl_elem_id_t id; 		/* must be always on top */
 	struct list_head list;		/* links for list of all helems */
 	int compare_weight;		/* compare weight (reversed) */
+	snd_hctl_elem_t *hash_id_next;	/* bucket chain of the id hash */
+	snd_hctl_elem_t *hash_numid_next; /* bucket chain of the numid hash */
 	/* event callback */
 	snd_hctl_elem_callback_t callback;
 	void *callback_private;
@@ -85,9 +94,12 @@ struct _snd_hctl_elem {
 struct _snd_hctl {
 	snd_ctl_t *ctl;
 	struct list_head elems;		/* list of all controls */
-	unsigned int alloc;	
+	unsigned int alloc;
 	unsigned int count;
 	snd_hctl_elem_t **pelems;
+	snd_hctl_elem_t **hash_id;	/* buckets hashed by element id */
+	snd_hctl_elem_t **hash_numid;	/* buckets hashed by numid */
+	unsigned int hash_size;		/* bucket count (power of two), 0 = no index */
 	snd_hctl_compare_t compare;
 	snd_hctl_callback_t callback;
 	void *callback_private;
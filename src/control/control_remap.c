@@ -89,6 +89,10 @@ typedef struct {
 	size_t numid_alloc;
 	snd_ctl_numid_t *numid;
 	snd_ctl_numid_t numid_temp;
+	unsigned int *numid_child_idx;	/* numid_child -> numid index + 1 */
+	size_t numid_child_idx_size;
+	unsigned int *numid_app_idx;	/* numid_app -> numid index + 1 */
+	size_t numid_app_idx_size;
 	size_t remap_items;
 	size_t remap_alloc;
 	snd_ctl_remap_id_t *remap;
@@ -108,13 +112,52 @@ static snd_ctl_numid_t *remap_numid_temp(snd_ctl_remap_t *priv, unsigned int num
 	return &priv->numid_temp;
 }
 
+/*
+ * The direct-mapped tables translate a numid to the index (plus one, zero
+ * means not present) of the corresponding entry in the numid array.  They
+ * are maintained incrementally in remap_numid_new(); entries are never
+ * removed.  The tables are a pure accelerator: lookup misses (numids above
+ * NUMID_IDX_MAX or a failed table growth) fall back to the linear scan.
+ */
+#ifndef DOC_HIDDEN
+#define NUMID_IDX_MAX	8192
+#endif
+
+static void remap_numid_index_set(unsigned int **table, size_t *size,
+				  unsigned int numid, unsigned int idx1)
+{
+	unsigned int *n;
+	size_t nsize;
+
+	if (numid >= NUMID_IDX_MAX)
+		return;
+	if (numid >= *size) {
+		nsize = *size < 64 ? 64 : *size * 2;
+		if (nsize <= numid)
+			nsize = (size_t)numid + 1;
+		n = realloc(*table, nsize * sizeof(*n));
+		if (n == NULL)
+			return;
+		memset(n + *size, 0, (nsize - *size) * sizeof(*n));
+		*table = n;
+		*size = nsize;
+	}
+	(*table)[numid] = idx1;
+}
+
 static snd_ctl_numid_t *remap_find_numid_app(snd_ctl_remap_t *priv, unsigned int numid_app)
 {
 	snd_ctl_numid_t *numid;
 	size_t count;
+	unsigned int idx1;
 
 	if (!priv->numid_remap_active)
 		return remap_numid_temp(priv, numid_app);
+	if (numid_app < priv->numid_app_idx_size) {
+		idx1 = priv->numid_app_idx[numid_app];
+		if (idx1 > 0)
+			return &priv->numid[idx1 - 1];
+	}
 	numid = priv->numid;
 	for (count = priv->numid_items; count > 0; count--, numid++)
 		if (numid_app == numid->numid_app)
@@ -138,6 +181,10 @@ static snd_ctl_numid_t *remap_numid_new(snd_ctl_remap_t *priv, unsigned int numi
 	numid = &priv->numid[priv->numid_items++];
 	numid->numid_child = numid_child;
 	numid->numid_app = numid_app;
+	remap_numid_index_set(&priv->numid_child_idx, &priv->numid_child_idx_size,
+			      numid_child, priv->numid_items);
+	remap_numid_index_set(&priv->numid_app_idx, &priv->numid_app_idx_size,
+			      numid_app, priv->numid_items);
 	debug("new numid: child %u app %u\n", numid->numid_child, numid->numid_app);
 	return numid;
 }
@@ -162,9 +209,15 @@ static snd_ctl_numid_t *remap_find_numid_child(snd_ctl_remap_t *priv, unsigned i
 {
 	snd_ctl_numid_t *numid;
 	size_t count;
+	unsigned int idx1;
 
 	if (!priv->numid_remap_active)
 		return remap_numid_temp(priv, numid_child);
+	if (numid_child < priv->numid_child_idx_size) {
+		idx1 = priv->numid_child_idx[numid_child];
+		if (idx1 > 0)
+			return &priv->numid[idx1 - 1];
+	}
 	numid = priv->numid;
 	for (count = priv->numid_items; count > 0; count--, numid++)
 		if (numid_child == numid->numid_child)
@@ -305,6 +358,8 @@ static void remap_free(snd_ctl_remap_t *priv)
 	free(priv->map_read_queue);
 	free(priv->map);
 	free(priv->remap);
+	free(priv->numid_child_idx);
+	free(priv->numid_app_idx);
 	free(priv->numid);
 	free(priv);
 }
@@ -274,6 +274,50 @@ int snd_ctl_ascii_elem_id_parse(snd_ctl_elem_id_t *dst, const char *str)
 	return __snd_ctl_ascii_elem_id_parse(dst, str, NULL);
 }
 
+/**
+ * \brief parse many whitespace separated CTL element identifiers
+ * \param ids destination CTL identifier array (use
+ *            #snd_ctl_elem_id_sizeof as the element stride)
+ * \param space number of entries in \a ids
+ * \param str source ASCII string
+ * \param ret_ptr when not NULL, receives the first unparsed position
+ * \return the number of parsed identifiers on success, otherwise a
+ *         negative error code
+ *
+ * Parses identifiers from the whole buffer in one pass until the string
+ * or \a space is exhausted, filling the caller's preallocated array
+ * without any per-element allocation.  On an error, \a ret_ptr points
+ * into the offending identifier.
+ */
+int snd_ctl_ascii_elem_id_parse_many(snd_ctl_elem_id_t *ids,
+				     unsigned int space,
+				     const char *str,
+				     const char **ret_ptr)
+{
+	unsigned int count = 0;
+	const char *ptr = str;
+	int err;
+
+	assert(ids && str);
+	while (count < space) {
+		while (isspace(*ptr))
+			ptr++;
+		if (!*ptr)
+			break;
+		memset(&ids[count], 0, sizeof(ids[count]));
+		err = __snd_ctl_ascii_elem_id_parse(&ids[count], ptr, &ptr);
+		if (err < 0) {
+			if (ret_ptr)
+				*ret_ptr = ptr;
+			return err;
+		}
+		count++;
+	}
+	if (ret_ptr)
+		*ret_ptr = ptr;
+	return count;
+}
+
 static int get_ctl_enum_item_index(snd_ctl_t *handle,
 				   snd_ctl_elem_info_t *info,
 				   const char **ptrp)
@@ -424,3 +468,72 @@ int snd_ctl_ascii_value_parse(snd_ctl_t *handle,
 	}
 	return 0;
 }
+
+/**
+ * \brief parse a whole ASCII state buffer as CTL element values
+ * \param handle CTL handle
+ * \param buf source ASCII buffer; each line holds an element identifier
+ *            followed by whitespace and the value string, e.g.
+ *            "name='Master Playback Volume' 60,60"
+ * \param values destination CTL element value array (the entries must be
+ *               allocated by the caller)
+ * \param space number of entries in \a values
+ * \return the number of parsed values on success, otherwise a negative
+ *         error code
+ *
+ * Parses the buffer in one pass without any per-element allocation and
+ * fills the value array, which can then be applied as a second pass with
+ * #snd_ctl_elem_write_many.  One info query per element resolves the
+ * value type and count; listing numid= in the identifiers makes that
+ * lookup cheap.
+ *
+ * The "toggle" value keyword works against the previous contents of the
+ * destination entry, like with #snd_ctl_ascii_value_parse.
+ */
+int snd_ctl_ascii_value_parse_many(snd_ctl_t *handle,
+				   const char *buf,
+				   snd_ctl_elem_value_t **values,
+				   unsigned int space)
+{
+	snd_ctl_elem_id_t id;
+	snd_ctl_elem_info_t info;
+	char line[512];
+	unsigned int count = 0;
+	const char *ptr = buf, *eol;
+	size_t len;
+	int err;
+
+	assert(handle && buf && values);
+	while (count < space) {
+		while (isspace(*ptr))
+			ptr++;
+		if (!*ptr)
+			break;
+		memset(&id, 0, sizeof(id));
+		err = __snd_ctl_ascii_elem_id_parse(&id, ptr, &ptr);
+		if (err < 0)
+			return err;
+		while (*ptr == ' ' || *ptr == '\t')
+			ptr++;
+		/* bound the value string to its line; the value parser
+		 * re-scans the string when no ',' separator is present */
+		eol = strchr(ptr, '\n');
+		len = eol ? (size_t)(eol - ptr) : strlen(ptr);
+		if (len >= sizeof(line))
+			return -EINVAL;
+		memcpy(line, ptr, len);
+		line[len] = '\0';
+		ptr += len;
+		memset(&info, 0, sizeof(info));
+		snd_ctl_elem_info_set_id(&info, &id);
+		err = snd_ctl_elem_info(handle, &info);
+		if (err < 0)
+			return err;
+		err = snd_ctl_ascii_value_parse(handle, values[count],
+						&info, line);
+		if (err < 0)
+			return err;
+		count++;
+	}
+	return count;
+}
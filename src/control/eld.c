@@ -32,6 +32,9 @@
 #include <unistd.h>
 #include <string.h>
 #include <ctype.h>
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
 
 static void __fill_eld_ctl_id(snd_ctl_elem_id_t *id, int dev, int subdev)
 {
@@ -41,14 +44,75 @@ static void __fill_eld_ctl_id(snd_ctl_elem_id_t *id, int dev, int subdev)
 	snd_ctl_elem_id_set_index(id, subdev);
 }
 
+/*
+ * cache of decoded ELD blobs; HDMI hotplug storms re-read the same
+ * blob over and over, an identical blob reuses the decoded name
+ */
+
+#define ELD_CACHE_ENTRIES	8
+#define ELD_NAME_MAX		16
+
+struct eld_cache_entry {
+	int card;
+	int device;
+	int subdevice;
+	unsigned int count;		/* blob length, 0 = empty slot */
+	unsigned char eld[256];
+	char name[ELD_NAME_MAX + 1];	/* decoded monitor name, "" = none */
+};
+
+static struct eld_cache_entry eld_cache[ELD_CACHE_ENTRIES];
+static unsigned int eld_cache_pos;
+
+#ifdef HAVE_LIBPTHREAD
+static pthread_mutex_t eld_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static inline void eld_cache_lock(void)
+{
+	pthread_mutex_lock(&eld_cache_mutex);
+}
+
+static inline void eld_cache_unlock(void)
+{
+	pthread_mutex_unlock(&eld_cache_mutex);
+}
+#else
+static inline void eld_cache_lock(void) {}
+static inline void eld_cache_unlock(void) {}
+#endif
+
+static struct eld_cache_entry *eld_cache_lookup(int card, int dev, int subdev)
+{
+	unsigned int i;
+
+	for (i = 0; i < ELD_CACHE_ENTRIES; i++) {
+		struct eld_cache_entry *ent = &eld_cache[i];
+		if (ent->count > 0 && ent->card == card &&
+		    ent->device == dev && ent->subdevice == subdev)
+			return ent;
+	}
+	return NULL;
+}
+
+static void eld_apply_name(snd_pcm_info_t *info, const char *name)
+{
+	if (name[0]) {
+		snd_strlcpy((char *)info->name, name, sizeof(info->name));
+	} else {
+		strncat((char *)info->name, " *", sizeof(info->name) - 1);
+		((char *)info->name)[sizeof(info->name)-1] = '\0';
+	}
+}
+
 int __snd_pcm_info_eld_fixup(snd_pcm_info_t * info)
 {
 	snd_ctl_t *ctl;
 	snd_ctl_elem_info_t cinfo = {0};
 	snd_ctl_elem_value_t value = {0};
+	struct eld_cache_entry *ent;
 	unsigned char *eld;
 	unsigned int l, spc;
-	char *s, c;
+	char s[ELD_NAME_MAX + 1], c;
 	int ret, valid;
 
 	ret = snd_ctl_hw_open(&ctl, NULL, info->card, 0);
@@ -73,15 +137,26 @@ int __snd_pcm_info_eld_fixup(snd_pcm_info_t * info)
 	eld = value.value.bytes.data;
 	if (cinfo.count < 20 || cinfo.count > 256)
 		return -EIO;
+	eld_cache_lock();
+	ent = eld_cache_lookup(info->card, info->device, info->subdevice);
+	if (ent && ent->count == cinfo.count &&
+	    memcmp(ent->eld, eld, cinfo.count) == 0) {
+		/* unchanged blob, reuse the decoded name */
+		eld_apply_name(info, ent->name);
+		eld_cache_unlock();
+		return 0;
+	}
 	l = eld[4] & 0x1f;
-	if (l == 0)
+	if (l == 0) {
 		/* no monitor name detected */
-		goto __present;
-	if (l > 16 || 20 + l > cinfo.count) {
+		s[0] = '\0';
+		goto __store;
+	}
+	if (l > ELD_NAME_MAX || 20 + l > cinfo.count) {
+		eld_cache_unlock();
 		SNDERR("ELD decode failed, using old HDMI output names");
 		return 0;
 	}
-	s = alloca(l + 1);
 	/* sanitize */
 	valid = 0;
 	spc = 0;
@@ -97,13 +172,22 @@ int __snd_pcm_info_eld_fixup(snd_pcm_info_t * info)
 				spc = l + 1;
 		}
 	}
-	if (valid > 3) {
+	if (valid > 3)
 		s[spc] = '\0';
-		snd_strlcpy((char *)info->name, s, sizeof(info->name));
-	} else {
-__present:
-		strncat((char *)info->name, " *", sizeof(info->name) - 1);
-		((char *)info->name)[sizeof(info->name)-1] = '\0';
+	else
+		s[0] = '\0';
+__store:
+	if (ent == NULL) {
+		ent = &eld_cache[eld_cache_pos];
+		eld_cache_pos = (eld_cache_pos + 1) % ELD_CACHE_ENTRIES;
+		ent->card = info->card;
+		ent->device = info->device;
+		ent->subdevice = info->subdevice;
 	}
+	ent->count = cinfo.count;
+	memcpy(ent->eld, eld, cinfo.count);
+	snd_strlcpy(ent->name, s, sizeof(ent->name));
+	eld_apply_name(info, ent->name);
+	eld_cache_unlock();
 	return 0;
 }
@@ -317,6 +317,136 @@ static int get_compare_weight(const snd_ctl_elem_id_t *id)
 	return res + res1;
 }
 
+/*
+ * Hash index over the loaded elements.  The sorted pelems array is kept
+ * for the ordered iteration and the insertion order, the hash serves the
+ * by-id and by-numid lookups in O(1); HDA codecs expose many hundreds of
+ * elements and every lookup otherwise pays a string-compare binary search.
+ */
+
+#define HCTL_HASH_MIN_SIZE	64
+
+static unsigned int hctl_hash_id(const snd_ctl_elem_id_t *id)
+{
+	unsigned int hash = 2166136261U;
+	const unsigned char *p;
+
+	for (p = id->name; *p; p++)
+		hash = (hash ^ *p) * 16777619U;
+	hash = (hash ^ id->iface) * 16777619U;
+	hash = (hash ^ id->device) * 16777619U;
+	hash = (hash ^ id->subdevice) * 16777619U;
+	hash = (hash ^ id->index) * 16777619U;
+	return hash;
+}
+
+static unsigned int hctl_hash_numid(unsigned int numid)
+{
+	return numid * 2654435761U;
+}
+
+static int hctl_id_equal(const snd_ctl_elem_id_t *id1,
+			 const snd_ctl_elem_id_t *id2)
+{
+	return id1->iface == id2->iface &&
+	       id1->device == id2->device &&
+	       id1->subdevice == id2->subdevice &&
+	       !strcmp((const char *)id1->name, (const char *)id2->name) &&
+	       id1->index == id2->index;
+}
+
+static void hctl_hash_elem_add(snd_hctl_t *hctl, snd_hctl_elem_t *elem)
+{
+	unsigned int b;
+
+	b = hctl_hash_id(&elem->id) & (hctl->hash_size - 1);
+	elem->hash_id_next = hctl->hash_id[b];
+	hctl->hash_id[b] = elem;
+	if (elem->id.numid) {
+		b = hctl_hash_numid(elem->id.numid) & (hctl->hash_size - 1);
+		elem->hash_numid_next = hctl->hash_numid[b];
+		hctl->hash_numid[b] = elem;
+	}
+}
+
+static void hctl_hash_free(snd_hctl_t *hctl)
+{
+	free(hctl->hash_id);
+	free(hctl->hash_numid);
+	hctl->hash_id = NULL;
+	hctl->hash_numid = NULL;
+	hctl->hash_size = 0;
+}
+
+/* (re)build both tables; on memory shortage run without the index */
+static void hctl_hash_rebuild(snd_hctl_t *hctl)
+{
+	unsigned int size = HCTL_HASH_MIN_SIZE;
+	unsigned int k;
+
+	hctl_hash_free(hctl);
+	while (size < hctl->count * 2)
+		size <<= 1;
+	hctl->hash_id = calloc(size, sizeof(*hctl->hash_id));
+	hctl->hash_numid = calloc(size, sizeof(*hctl->hash_numid));
+	if (!hctl->hash_id || !hctl->hash_numid) {
+		hctl_hash_free(hctl);
+		return;
+	}
+	hctl->hash_size = size;
+	for (k = 0; k < hctl->count; k++)
+		hctl_hash_elem_add(hctl, hctl->pelems[k]);
+}
+
+static void hctl_hash_add(snd_hctl_t *hctl, snd_hctl_elem_t *elem)
+{
+	if (!hctl->hash_size || hctl->count > hctl->hash_size * 2)
+		hctl_hash_rebuild(hctl);
+	else
+		hctl_hash_elem_add(hctl, elem);
+}
+
+static void hctl_hash_del(snd_hctl_t *hctl, snd_hctl_elem_t *elem)
+{
+	snd_hctl_elem_t **p;
+
+	if (!hctl->hash_size)
+		return;
+	for (p = &hctl->hash_id[hctl_hash_id(&elem->id) & (hctl->hash_size - 1)];
+	     *p; p = &(*p)->hash_id_next)
+		if (*p == elem) {
+			*p = elem->hash_id_next;
+			break;
+		}
+	if (!elem->id.numid)
+		return;
+	for (p = &hctl->hash_numid[hctl_hash_numid(elem->id.numid) & (hctl->hash_size - 1)];
+	     *p; p = &(*p)->hash_numid_next)
+		if (*p == elem) {
+			*p = elem->hash_numid_next;
+			break;
+		}
+}
+
+static snd_hctl_elem_t *hctl_hash_find(snd_hctl_t *hctl,
+				       const snd_ctl_elem_id_t *id)
+{
+	snd_hctl_elem_t *elem;
+
+	if (id->numid) {
+		for (elem = hctl->hash_numid[hctl_hash_numid(id->numid) & (hctl->hash_size - 1)];
+		     elem; elem = elem->hash_numid_next)
+			if (elem->id.numid == id->numid)
+				return elem;
+		return NULL;
+	}
+	for (elem = hctl->hash_id[hctl_hash_id(id) & (hctl->hash_size - 1)];
+	     elem; elem = elem->hash_id_next)
+		if (hctl_id_equal(&elem->id, id))
+			return elem;
+	return NULL;
+}
+
 static int _snd_hctl_find_elem(snd_hctl_t *hctl, const snd_ctl_elem_id_t *id, int *dir)
 {
 	unsigned int l, u;
@@ -376,6 +506,7 @@ static int snd_hctl_elem_add(snd_hctl_t *hctl, snd_hctl_elem_t *elem)
 		hctl->pelems[idx] = elem;
 	}
 	hctl->count++;
+	hctl_hash_add(hctl, elem);
 	return snd_hctl_throw_event(hctl, SNDRV_CTL_EVENT_MASK_ADD, elem);
 }
 
@@ -385,6 +516,8 @@ static void snd_hctl_elem_remove(snd_hctl_t *hctl, unsigned int idx)
 	unsigned int m;
 	snd_hctl_elem_throw_event(elem, SNDRV_CTL_EVENT_MASK_REMOVE);
 	list_del(&elem->list);
+	hctl_hash_del(hctl, elem);
+	snd_memstat_update(SND_MEMSTAT_HCTL, -(ssize_t)sizeof(*elem), -1);
 	free(elem);
 	hctl->count--;
 	m = hctl->count - idx;
@@ -406,6 +539,7 @@ int snd_hctl_free(snd_hctl_t *hctl)
 	free(hctl->pelems);
 	hctl->pelems = 0;
 	hctl->alloc = 0;
+	hctl_hash_free(hctl);
 	INIT_LIST_HEAD(&hctl->elems);
 	return 0;
 }
@@ -551,22 +685,48 @@ snd_hctl_elem_t *snd_hctl_elem_prev(snd_hctl_elem_t *elem)
 snd_hctl_elem_t *snd_hctl_find_elem(snd_hctl_t *hctl, const snd_ctl_elem_id_t *id)
 {
 	int dir;
-	int res = _snd_hctl_find_elem(hctl, id, &dir);
+	int res;
+
+	/* the hash index matches the equality semantics of the builtin
+	 * compare functions only; custom ones go the slow way */
+	if (hctl->hash_size &&
+	    (hctl->compare == snd_hctl_compare_default ||
+	     hctl->compare == snd_hctl_compare_fast))
+		return hctl_hash_find(hctl, id);
+	res = _snd_hctl_find_elem(hctl, id, &dir);
 	if (res < 0 || dir != 0)
 		return NULL;
 	return hctl->pelems[res];
 }
 
+/** count of element identifiers fetched by one element list ioctl */
+#define HCTL_LOAD_CHUNK		1024
+
+static int hctl_elem_id_compare_numid(const void *a, const void *b)
+{
+	const snd_ctl_elem_id_t *id1 = a;
+	const snd_ctl_elem_id_t *id2 = b;
+	if (id1->numid < id2->numid)
+		return -1;
+	return id1->numid > id2->numid;
+}
+
 /**
  * \brief Load an HCTL with all elements and sort them
  * \param hctl HCTL handle
  * \return 0 on success otherwise a negative error code
+ *
+ * The element identifiers are fetched in chunks; each chunk carries the
+ * element count valid at the time of the query, so additions and removals
+ * during the load are reconciled on the fly in one bounded pass instead
+ * of restarting the whole enumeration.
  */
 int snd_hctl_load(snd_hctl_t *hctl)
 {
 	snd_ctl_elem_list_t list;
-	int err = 0;
-	unsigned int idx;
+	snd_ctl_elem_id_t *ids = NULL;
+	unsigned int idx, total, n, alloc = 0;
+	int err = 0, churn = 0;
 
 	assert(hctl);
 	assert(hctl->ctl);
@@ -575,15 +735,58 @@ int snd_hctl_load(snd_hctl_t *hctl)
 	memset(&list, 0, sizeof(list));
 	if ((err = snd_ctl_elem_list(hctl->ctl, &list)) < 0)
 		goto _end;
-	while (list.count != list.used) {
-		err = snd_ctl_elem_list_alloc_space(&list, list.count);
+	total = list.count;
+	if (total > 0) {
+		err = snd_ctl_elem_list_alloc_space(&list, total < HCTL_LOAD_CHUNK ?
+							   total : HCTL_LOAD_CHUNK);
 		if (err < 0)
 			goto _end;
+		alloc = total;
+		ids = malloc(alloc * sizeof(*ids));
+		if (!ids) {
+			err = -ENOMEM;
+			goto _end;
+		}
+	}
+	n = 0;
+	while (n < total) {
+		list.offset = n;
 		if ((err = snd_ctl_elem_list(hctl->ctl, &list)) < 0)
 			goto _end;
+		if (list.used == 0)
+			break;	/* the set shrank below our offset */
+		if (n + list.used > alloc) {
+			snd_ctl_elem_id_t *nids;
+			alloc = list.count > n + list.used ?
+					list.count : n + list.used;
+			nids = realloc(ids, alloc * sizeof(*ids));
+			if (!nids) {
+				err = -ENOMEM;
+				goto _end;
+			}
+			ids = nids;
+		}
+		memcpy(ids + n, list.pids, list.used * sizeof(*ids));
+		n += list.used;
+		/* each answer reports the current total; pick up the new
+		 * target instead of restarting from scratch */
+		if (list.count != total) {
+			total = list.count;
+			churn = 1;
+		}
+	}
+	if (churn && n > 1) {
+		/* elements inserted below the cursor shift the remainder up
+		 * and get fetched twice; drop the duplicates (the identifier
+		 * order is irrelevant, the list is sorted below anyway) */
+		qsort(ids, n, sizeof(*ids), hctl_elem_id_compare_numid);
+		for (idx = 1, total = 1; idx < n; idx++)
+			if (ids[idx].numid != ids[total - 1].numid)
+				ids[total++] = ids[idx];
+		n = total;
 	}
-	if (hctl->alloc < list.count) {
-		hctl->alloc = list.count;
+	if (hctl->alloc < n) {
+		hctl->alloc = n;
 		free(hctl->pelems);
 		hctl->pelems = malloc(hctl->alloc * sizeof(*hctl->pelems));
 		if (!hctl->pelems) {
@@ -591,7 +794,7 @@ int snd_hctl_load(snd_hctl_t *hctl)
 			goto _end;
 		}
 	}
-	for (idx = 0; idx < list.count; idx++) {
+	for (idx = 0; idx < n; idx++) {
 		snd_hctl_elem_t *elem;
 		elem = calloc(1, sizeof(snd_hctl_elem_t));
 		if (elem == NULL) {
@@ -599,7 +802,8 @@ int snd_hctl_load(snd_hctl_t *hctl)
 			err = -ENOMEM;
 			goto _end;
 		}
-		elem->id = list.pids[idx];
+		snd_memstat_update(SND_MEMSTAT_HCTL, sizeof(*elem), 1);
+		elem->id = ids[idx];
 		elem->hctl = hctl;
 		elem->compare_weight = get_compare_weight(&elem->id);
 		hctl->pelems[idx] = elem;
@@ -609,6 +813,7 @@ int snd_hctl_load(snd_hctl_t *hctl)
 	if (!hctl->compare)
 		hctl->compare = snd_hctl_compare_default;
 	snd_hctl_sort(hctl);
+	hctl_hash_rebuild(hctl);
 	for (idx = 0; idx < hctl->count; idx++) {
 		int res = snd_hctl_throw_event(hctl, SNDRV_CTL_EVENT_MASK_ADD,
 					       hctl->pelems[idx]);
@@ -617,6 +822,7 @@ int snd_hctl_load(snd_hctl_t *hctl)
 	}
 	err = snd_ctl_subscribe_events(hctl->ctl, 1);
  _end:
+	free(ids);
 	free(list.pids);
 	return err;
 }
@@ -751,6 +957,7 @@ static int snd_hctl_handle_event(snd_hctl_t *hctl, snd_ctl_event_t *event)
 		elem = calloc(1, sizeof(snd_hctl_elem_t));
 		if (elem == NULL)
 			return -ENOMEM;
+		snd_memstat_update(SND_MEMSTAT_HCTL, sizeof(*elem), 1);
 		elem->id = event->data.elem.id;
 		elem->hctl = hctl;
 		res = snd_hctl_elem_add(hctl, elem);
@@ -778,20 +985,23 @@ static int snd_hctl_handle_event(snd_hctl_t *hctl, snd_ctl_event_t *event)
  */
 int snd_hctl_handle_events(snd_hctl_t *hctl)
 {
-	snd_ctl_event_t event;
-	int res;
+	snd_ctl_event_t events[16];
+	int res, err, i;
 	unsigned int count = 0;
-	
+
 	assert(hctl);
 	assert(hctl->ctl);
-	while ((res = snd_ctl_read(hctl->ctl, &event)) != 0 &&
+	while ((res = snd_ctl_read_many(hctl->ctl, events,
+					sizeof(events) / sizeof(events[0]))) != 0 &&
 	       res != -EAGAIN) {
 		if (res < 0)
 			return res;
-		res = snd_hctl_handle_event(hctl, &event);
-		if (res < 0)
-			return res;
-		count++;
+		for (i = 0; i < res; i++) {
+			err = snd_hctl_handle_event(hctl, &events[i]);
+			if (err < 0)
+				return err;
+			count++;
+		}
 	}
 	return count;
 }
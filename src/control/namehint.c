@@ -27,9 +27,13 @@
  */
 
 #include "local.h"
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
 
 #ifndef DOC_HIDDEN
 #define DEV_SKIP	9999 /* some non-existing device number */
+#define HINT_CACHE_VERSION 1
 struct hint_list {
 	char **list;
 	unsigned int count;
@@ -104,6 +108,172 @@ static int hint_list_add_custom(struct hint_list *list,
 	return err;
 }
 
+/*
+ * Persistent hint cache
+ *
+ * A full enumeration opens every card and test-opens the configurations,
+ * which takes hundreds of milliseconds on multi-card systems.  When
+ * defaults.namehint.cache is enabled, the final hint list is stored in a
+ * per-user file keyed by the content of /proc/asound/cards, so the result
+ * is reused across processes until the card set changes.
+ */
+
+static int hint_list_add_raw(struct hint_list *list, const char *entry)
+{
+	char *x;
+
+	if (list->count + 1 >= list->allocated) {
+		char **n = realloc(list->list, (list->allocated + 10) * sizeof(char *));
+		if (n == NULL)
+			return -ENOMEM;
+		memset(n + list->allocated, 0, 10 * sizeof(*n));
+		list->allocated += 10;
+		list->list = n;
+	}
+	x = strdup(entry);
+	if (x == NULL)
+		return -ENOMEM;
+	list->list[list->count++] = x;
+	return 0;
+}
+
+static void hint_list_clear(struct hint_list *list)
+{
+	unsigned int k;
+
+	for (k = 0; k < list->count; k++)
+		free(list->list[k]);
+	free(list->list);
+	list->list = NULL;
+	list->count = list->allocated = 0;
+}
+
+static int hint_cache_signature(char *sig, size_t sig_size)
+{
+	FILE *fp;
+	unsigned int hash = 2166136261U;
+	size_t total = 0, n, k;
+	char buf[256];
+
+	fp = fopen("/proc/asound/cards", "re");
+	if (fp == NULL)
+		return -errno;
+	while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+		for (k = 0; k < n; k++)
+			hash = (hash ^ (unsigned char)buf[k]) * 16777619U;
+		total += n;
+	}
+	fclose(fp);
+	snprintf(sig, sig_size, "%08x.%zx", hash, total);
+	return 0;
+}
+
+static int hint_cache_path(const char *iface, int card, int create, char **path)
+{
+	char name[64];
+
+	if (card >= 0)
+		snprintf(name, sizeof(name), "namehint-%s-%i", iface, card);
+	else
+		snprintf(name, sizeof(name), "namehint-%s-all", iface);
+	return snd_user_cache_path(name, create, path);
+}
+
+static int hint_cache_load(struct hint_list *list, const char *iface, int card)
+{
+	char sig[64], fsig[64], line[80], *entry, *path;
+	FILE *fp;
+	long len;
+	int version, hit = 0;
+
+	if (hint_cache_signature(sig, sizeof(sig)) < 0)
+		return 0;
+	if (hint_cache_path(iface, card, 0, &path) < 0)
+		return 0;
+	fp = fopen(path, "re");
+	free(path);
+	if (fp == NULL)
+		return 0;
+	if (fgets(line, sizeof(line), fp) == NULL ||
+	    sscanf(line, "namehint-cache-%i %63s", &version, fsig) != 2 ||
+	    version != HINT_CACHE_VERSION ||
+	    strcmp(fsig, sig) != 0)
+		goto __miss;
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		len = strtol(line, NULL, 10);
+		if (len <= 0 || len >= 0x10000)
+			goto __miss;
+		entry = malloc(len + 1);
+		if (entry == NULL)
+			goto __miss;
+		if (fread(entry, 1, len, fp) != (size_t)len ||
+		    fgetc(fp) != '\n') {
+			free(entry);
+			goto __miss;
+		}
+		entry[len] = '\0';
+		if (hint_list_add_raw(list, entry) < 0) {
+			free(entry);
+			goto __miss;
+		}
+		free(entry);
+	}
+	hit = 1;
+	goto __end;
+      __miss:
+	hint_list_clear(list);
+      __end:
+	fclose(fp);
+	return hit;
+}
+
+static void hint_cache_save(struct hint_list *list, const char *iface, int card)
+{
+	char sig[64], *path, *tmp;
+	FILE *fp;
+	unsigned int k;
+	int fd, err = 0;
+
+	if (hint_cache_signature(sig, sizeof(sig)) < 0)
+		return;
+	if (hint_cache_path(iface, card, 1, &path) < 0)
+		return;
+	tmp = malloc(strlen(path) + 8);
+	if (tmp == NULL) {
+		free(path);
+		return;
+	}
+	sprintf(tmp, "%s.XXXXXX", path);
+	fd = mkstemp(tmp);
+	if (fd < 0)
+		goto __end;
+	fp = fdopen(fd, "w");
+	if (fp == NULL) {
+		close(fd);
+		remove(tmp);
+		goto __end;
+	}
+	if (fprintf(fp, "namehint-cache-%d %s\n", HINT_CACHE_VERSION, sig) < 0)
+		err = -1;
+	for (k = 0; err == 0 && k < list->count; k++) {
+		if (list->list[k] == NULL)
+			continue;
+		if (fprintf(fp, "%zu\n%s\n", strlen(list->list[k]),
+			    list->list[k]) < 0)
+			err = -1;
+	}
+	if (fclose(fp) != 0)
+		err = -1;
+	/* publish atomically so concurrent readers see old or new list */
+	if (err == 0)
+		err = rename(tmp, path);
+	if (err != 0)
+		remove(tmp);
+      __end:
+	free(tmp);
+	free(path);
+}
+
 static void zero_handler(const char *file ATTRIBUTE_UNUSED,
 			 int line ATTRIBUTE_UNUSED,
 			 const char *function ATTRIBUTE_UNUSED,
@@ -554,6 +724,130 @@ static int add_software_devices(snd_config_t *config, snd_config_t *rw_config,
 	return 0;
 }
 
+#ifdef HAVE_LIBPTHREAD
+/*
+ * Parallel per-card probing.  The try_config() test-opens dominate the
+ * enumeration wall time and cards are independent, so a small pool
+ * probes them concurrently.  Each worker keeps a private writable
+ * configuration copy (definition expansion modifies the tree) and a
+ * private hint list merged in card order afterwards.  The local error
+ * handler is thread-local, so the zero_handler suppression inside
+ * try_config() stays per worker.
+ */
+
+#define HINT_PROBE_THREADS 4
+
+struct hint_card_jobs {
+	snd_config_t *config;		/* shared read-only tree */
+	const int *cards;
+	int ncards;
+	int next;			/* next unclaimed card index */
+	pthread_mutex_t lock;
+	struct hint_list *results;	/* one list per card */
+	int *errs;
+};
+
+static void *hint_card_worker(void *arg)
+{
+	struct hint_card_jobs *jobs = arg;
+	snd_config_t *rw_config;
+	struct hint_list *list;
+	int idx, err;
+
+	if (snd_config_copy(&rw_config, jobs->config) < 0)
+		rw_config = NULL;
+	for (;;) {
+		pthread_mutex_lock(&jobs->lock);
+		idx = jobs->next < jobs->ncards ? jobs->next++ : -1;
+		pthread_mutex_unlock(&jobs->lock);
+		if (idx < 0)
+			break;
+		if (rw_config == NULL) {
+			jobs->errs[idx] = -ENOMEM;
+			continue;
+		}
+		list = &jobs->results[idx];
+		err = get_card_name(list, jobs->cards[idx]);
+		if (err >= 0)
+			err = add_card(jobs->config, rw_config, list,
+				       jobs->cards[idx]);
+		jobs->errs[idx] = err;
+	}
+	if (rw_config)
+		snd_config_delete(rw_config);
+	return NULL;
+}
+
+static int hint_list_merge(struct hint_list *dst, struct hint_list *src)
+{
+	unsigned int k;
+	int err;
+
+	for (k = 0; k < src->count; k++) {
+		err = hint_list_add_raw(dst, src->list[k]);
+		if (err < 0)
+			return err;
+	}
+	return 0;
+}
+
+/* probe the given cards with a thread pool; the hints land in list in
+ * card order and the first error in card order is returned
+ */
+static int add_cards_parallel(snd_config_t *config, struct hint_list *list,
+			      const int *cards, int ncards)
+{
+	pthread_t threads[HINT_PROBE_THREADS];
+	struct hint_card_jobs jobs;
+	int i, nstarted, err = 0;
+
+	jobs.config = config;
+	jobs.cards = cards;
+	jobs.ncards = ncards;
+	jobs.next = 0;
+	jobs.results = calloc(ncards, sizeof(*jobs.results));
+	jobs.errs = calloc(ncards, sizeof(*jobs.errs));
+	if (jobs.results == NULL || jobs.errs == NULL) {
+		err = -ENOMEM;
+		goto __end;
+	}
+	for (i = 0; i < ncards; i++) {
+		jobs.results[i].siface = list->siface;
+		jobs.results[i].iface = list->iface;
+		jobs.results[i].show_all = list->show_all;
+	}
+	pthread_mutex_init(&jobs.lock, NULL);
+	nstarted = ncards < HINT_PROBE_THREADS ? ncards : HINT_PROBE_THREADS;
+	for (i = 0; i < nstarted; i++) {
+		if (pthread_create(&threads[i], NULL, hint_card_worker, &jobs))
+			break;
+	}
+	nstarted = i;
+	if (nstarted == 0)
+		/* no worker came up, probe inline */
+		hint_card_worker(&jobs);
+	for (i = 0; i < nstarted; i++)
+		pthread_join(threads[i], NULL);
+	pthread_mutex_destroy(&jobs.lock);
+	for (i = 0; err >= 0 && i < ncards; i++) {
+		if (jobs.errs[i] < 0)
+			err = jobs.errs[i];
+		else
+			err = hint_list_merge(list, &jobs.results[i]);
+	}
+      __end:
+	if (jobs.results) {
+		for (i = 0; i < ncards; i++) {
+			hint_list_clear(&jobs.results[i]);
+			free(jobs.results[i].cardname);
+		}
+		free(jobs.results);
+	}
+	free(jobs.errs);
+	return err;
+}
+#endif /* HAVE_LIBPTHREAD */
+
 /**
  * \brief Get a set of device name hints
  * \param card Card number or -1 (means all cards)
@@ -579,6 +873,12 @@ static int add_software_devices(snd_config_t *config, snd_config_t *rw_config,
  *
  * Special variables: defaults.namehint.showall specifies if all device
  * definitions are accepted (boolean type).
+ *
+ * When defaults.namehint.cache is enabled (boolean type), the result of
+ * a full enumeration is stored in a per-user file below $XDG_CACHE_HOME
+ * (or ~/.cache) and reused across processes until the set of installed
+ * sound cards changes.  Note that changes to the configuration files
+ * alone do not invalidate the cached list.
  */
 int snd_device_name_hint(int card, const char *iface, void ***hints)
 {
@@ -588,7 +888,7 @@ int snd_device_name_hint(int card, const char *iface, void ***hints)
 	snd_config_t *conf, *local_config = NULL, *local_config_rw = NULL;
 	snd_config_update_t *local_config_update = NULL;
 	snd_config_iterator_t i, next;
-	int err;
+	int err, use_cache = 0;
 
 	if (hints == NULL)
 		return -EINVAL;
@@ -622,23 +922,43 @@ int snd_device_name_hint(int card, const char *iface, void ***hints)
 
 	if (snd_config_search(local_config, "defaults.namehint.showall", &conf) >= 0)
 		list.show_all = snd_config_get_bool(conf) > 0;
+	if (snd_config_search(local_config, "defaults.namehint.cache", &conf) >= 0)
+		use_cache = snd_config_get_bool(conf) > 0;
+	if (use_cache && hint_cache_load(&list, list.siface, card) > 0) {
+		err = 0;
+		goto __error;
+	}
 	if (card >= 0) {
 		err = get_card_name(&list, card);
 		if (err >= 0)
 			err = add_card(local_config, local_config_rw, &list, card);
 	} else {
+		int cards[SND_MAX_CARDS], ncards = 0, c;
+
 		add_software_devices(local_config, local_config_rw, &list);
 		err = snd_card_next(&card);
 		if (err < 0)
 			goto __error;
-		while (card >= 0) {
-			err = get_card_name(&list, card);
+		while (card >= 0 && ncards < SND_MAX_CARDS) {
+			cards[ncards++] = card;
+			err = snd_card_next(&card);
 			if (err < 0)
 				goto __error;
-			err = add_card(local_config, local_config_rw, &list, card);
+		}
+#ifdef HAVE_LIBPTHREAD
+		if (ncards > 1) {
+			err = add_cards_parallel(local_config, &list,
+						 cards, ncards);
 			if (err < 0)
 				goto __error;
-			err = snd_card_next(&card);
+			ncards = 0;
+		}
+#endif
+		for (c = 0; c < ncards; c++) {
+			err = get_card_name(&list, cards[c]);
+			if (err < 0)
+				goto __error;
+			err = add_card(local_config, local_config_rw, &list, cards[c]);
 			if (err < 0)
 				goto __error;
 		}
@@ -655,6 +975,8 @@ int snd_device_name_hint(int card, const char *iface, void ***hints)
 				goto __error;
 		}
 	}
+	if (use_cache)
+		hint_cache_save(&list, list.siface, card);
 	err = 0;
       __error:
 	/* add an empty entry if nothing has been added yet; the caller
@@ -36,6 +36,7 @@
 #include <unistd.h>
 #include <string.h>
 #include <ctype.h>
+#include <pthread.h>
 
 #ifndef DOC_HIDDEN
 typedef struct {
@@ -54,6 +55,39 @@ struct _snd_sctl {
 	snd_ctl_t *ctl;
 	struct list_head elems;
 };
+
+/*
+ * Process-level cache of compiled element sets.  The ctl_elems hook
+ * runs snd_sctl_build() on every device open with the same
+ * configuration; the first build resolves the elements and preset
+ * values and the result is replayed for the following opens without
+ * parsing or element lookups.  An entry is keyed by the control
+ * device name, the card identification and the configuration contents
+ * (including the runtime arguments), so a configuration update or a
+ * different card behind the same device name misses the cache.
+ */
+struct sctl_compiled_elem {
+	struct list_head list;
+	unsigned int lock: 1;
+	unsigned int preserve: 1;
+	snd_ctl_elem_id_t *id;
+	snd_ctl_elem_info_t *info;
+	snd_ctl_elem_value_t *val;
+	snd_ctl_elem_value_t *mask;
+};
+
+struct sctl_compiled {
+	struct list_head list;
+	char *sig;
+	size_t sig_len;
+	struct list_head elems;
+};
+
+#define SCTL_COMPILED_MAX	32
+
+static pthread_mutex_t sctl_compiled_mutex = PTHREAD_MUTEX_INITIALIZER;
+static LIST_HEAD(sctl_compiled_cache);
+static unsigned int sctl_compiled_count;
 #endif /* DOC_HIDDEN */
 
 static int free_elems(snd_sctl_t *h)
@@ -164,6 +198,12 @@ int snd_sctl_install(snd_sctl_t *h)
 			assert(0);
 			break;
 		}
+		/* after merging the preserved bits the element may already
+		 * carry the requested value; skip the redundant write (and
+		 * the change event it would broadcast)
+		 */
+		if (snd_ctl_elem_value_compare(elem->val, elem->old) == 0)
+			continue;
 		err = snd_ctl_elem_write(h->ctl, elem->val);
 		if (err < 0) {
 			SNDERR("Cannot write ctl elem");
@@ -591,6 +631,191 @@ static int add_elem(snd_sctl_t *h, snd_config_t *_conf, snd_config_t *private_da
 	return err;
 }
 
+#ifndef DOC_HIDDEN
+/* build the cache key: control device name, card identification and
+ * the configuration contents including the runtime arguments
+ */
+static int sctl_compiled_sig(snd_ctl_t *ctl, snd_config_t *conf,
+			     snd_config_t *private_data,
+			     char **sig, size_t *sig_len)
+{
+	snd_ctl_card_info_t info;
+	snd_output_t *out;
+	const char *name;
+	char *buf;
+	size_t len;
+	int err;
+
+	memset(&info, 0, sizeof(info));
+	err = snd_ctl_card_info(ctl, &info);
+	if (err < 0)
+		return err;
+	err = snd_output_buffer_open(&out);
+	if (err < 0)
+		return err;
+	name = snd_ctl_name(ctl);
+	err = snd_output_printf(out, "%s\1%s\1%s\1",
+				name ? name : "",
+				snd_ctl_card_info_get_id(&info),
+				snd_ctl_card_info_get_longname(&info));
+	if (err >= 0)
+		err = snd_config_save(conf, out);
+	if (err >= 0 && private_data) {
+		err = snd_output_putc(out, '\1');
+		if (err >= 0)
+			err = snd_config_save(private_data, out);
+	}
+	if (err < 0) {
+		snd_output_close(out);
+		return err;
+	}
+	len = snd_output_buffer_steal(out, &buf);
+	snd_output_close(out);
+	if (buf == NULL)
+		return -ENOMEM;
+	*sig = buf;
+	*sig_len = len;
+	return 0;
+}
+
+static struct sctl_compiled *sctl_compiled_find(const char *sig, size_t sig_len)
+{
+	struct list_head *pos;
+	struct sctl_compiled *c;
+
+	list_for_each(pos, &sctl_compiled_cache) {
+		c = list_entry(pos, struct sctl_compiled, list);
+		if (c->sig_len == sig_len && memcmp(c->sig, sig, sig_len) == 0)
+			return c;
+	}
+	return NULL;
+}
+
+/* rebuild the element list from a cached compiled set;
+ * returns 1 when replayed, 0 on a cache miss
+ */
+static int sctl_compiled_replay(snd_sctl_t *h, const char *sig, size_t sig_len)
+{
+	struct sctl_compiled *c;
+	struct sctl_compiled_elem *ce;
+	snd_sctl_elem_t *elem;
+	struct list_head *pos;
+	int err = 0;
+
+	pthread_mutex_lock(&sctl_compiled_mutex);
+	c = sctl_compiled_find(sig, sig_len);
+	if (c == NULL)
+		goto _end;
+	list_for_each(pos, &c->elems) {
+		ce = list_entry(pos, struct sctl_compiled_elem, list);
+		elem = calloc(1, sizeof(*elem));
+		if (!elem) {
+			err = -ENOMEM;
+			goto _end;
+		}
+		if ((err = snd_ctl_elem_id_malloc(&elem->id)) < 0 ||
+		    (err = snd_ctl_elem_info_malloc(&elem->info)) < 0 ||
+		    (err = snd_ctl_elem_value_malloc(&elem->val)) < 0 ||
+		    (err = snd_ctl_elem_value_malloc(&elem->mask)) < 0 ||
+		    (err = snd_ctl_elem_value_malloc(&elem->old)) < 0) {
+			if (elem->id)
+				snd_ctl_elem_id_free(elem->id);
+			if (elem->info)
+				snd_ctl_elem_info_free(elem->info);
+			if (elem->val)
+				snd_ctl_elem_value_free(elem->val);
+			if (elem->mask)
+				snd_ctl_elem_value_free(elem->mask);
+			free(elem);
+			goto _end;
+		}
+		elem->lock = ce->lock;
+		elem->preserve = ce->preserve;
+		snd_ctl_elem_id_copy(elem->id, ce->id);
+		snd_ctl_elem_info_copy(elem->info, ce->info);
+		snd_ctl_elem_value_copy(elem->val, ce->val);
+		snd_ctl_elem_value_copy(elem->mask, ce->mask);
+		snd_ctl_elem_value_set_id(elem->old, elem->id);
+		list_add_tail(&elem->list, &h->elems);
+	}
+	err = 1;
+ _end:
+	pthread_mutex_unlock(&sctl_compiled_mutex);
+	return err;
+}
+
+static void sctl_compiled_elems_free(struct list_head *elems)
+{
+	struct sctl_compiled_elem *ce;
+
+	while (!list_empty(elems)) {
+		ce = list_entry(elems->next, struct sctl_compiled_elem, list);
+		if (ce->id)
+			snd_ctl_elem_id_free(ce->id);
+		if (ce->info)
+			snd_ctl_elem_info_free(ce->info);
+		if (ce->val)
+			snd_ctl_elem_value_free(ce->val);
+		if (ce->mask)
+			snd_ctl_elem_value_free(ce->mask);
+		list_del(&ce->list);
+		free(ce);
+	}
+}
+
+/* remember a freshly built element set; takes the ownership of sig;
+ * failures only cost the caching, so they are not reported
+ */
+static void sctl_compiled_store(snd_sctl_t *h, char *sig, size_t sig_len)
+{
+	struct sctl_compiled *c;
+	struct sctl_compiled_elem *ce;
+	snd_sctl_elem_t *elem;
+	struct list_head *pos;
+
+	c = calloc(1, sizeof(*c));
+	if (c == NULL) {
+		free(sig);
+		return;
+	}
+	INIT_LIST_HEAD(&c->elems);
+	c->sig = sig;
+	c->sig_len = sig_len;
+	list_for_each(pos, &h->elems) {
+		elem = list_entry(pos, snd_sctl_elem_t, list);
+		ce = calloc(1, sizeof(*ce));
+		if (ce == NULL)
+			goto _fail;
+		list_add_tail(&ce->list, &c->elems);
+		if (snd_ctl_elem_id_malloc(&ce->id) < 0 ||
+		    snd_ctl_elem_info_malloc(&ce->info) < 0 ||
+		    snd_ctl_elem_value_malloc(&ce->val) < 0 ||
+		    snd_ctl_elem_value_malloc(&ce->mask) < 0)
+			goto _fail;
+		ce->lock = elem->lock;
+		ce->preserve = elem->preserve;
+		snd_ctl_elem_id_copy(ce->id, elem->id);
+		snd_ctl_elem_info_copy(ce->info, elem->info);
+		snd_ctl_elem_value_copy(ce->val, elem->val);
+		snd_ctl_elem_value_copy(ce->mask, elem->mask);
+	}
+	pthread_mutex_lock(&sctl_compiled_mutex);
+	if (sctl_compiled_count < SCTL_COMPILED_MAX &&
+	    sctl_compiled_find(c->sig, c->sig_len) == NULL) {
+		list_add_tail(&c->list, &sctl_compiled_cache);
+		sctl_compiled_count++;
+		c = NULL;
+	}
+	pthread_mutex_unlock(&sctl_compiled_mutex);
+	if (c == NULL)
+		return;
+ _fail:
+	sctl_compiled_elems_free(&c->elems);
+	free(c->sig);
+	free(c);
+}
+#endif /* DOC_HIDDEN */
+
 /**
  * \brief Build setup control handle
  * \param sctl Result - setup control handle
@@ -604,6 +829,8 @@ int snd_sctl_build(snd_sctl_t **sctl, snd_ctl_t *handle, snd_config_t *conf, snd
 {
 	snd_sctl_t *h;
 	snd_config_iterator_t i, next;
+	char *sig = NULL;
+	size_t sig_len = 0;
 	int err, quit = 0;
 
 	assert(sctl);
@@ -622,16 +849,31 @@ int snd_sctl_build(snd_sctl_t **sctl, snd_ctl_t *handle, snd_config_t *conf, snd
 	h->mode = mode;
 	h->ctl = handle;
 	INIT_LIST_HEAD(&h->elems);
+	if (sctl_compiled_sig(handle, conf, private_data, &sig, &sig_len) == 0) {
+		err = sctl_compiled_replay(h, sig, sig_len);
+		if (err != 0) {
+			free(sig);
+			if (err < 0) {
+				free_elems(h);
+				return err;
+			}
+			*sctl = h;
+			return 0;
+		}
+	}
 	snd_config_for_each(i, next, conf) {
 		snd_config_t *n = snd_config_iterator_entry(i);
 		err = add_elem(h, n, private_data, &quit);
 		if (err < 0) {
+			free(sig);
 			free_elems(h);
 			return err;
 		}
 		if (quit)
 			break;
 	}
+	if (sig)
+		sctl_compiled_store(h, sig, sig_len);
 	*sctl = h;
 	return 0;
 }
@@ -288,35 +288,89 @@ struct dlobj_cache {
 	struct list_head list;
 };
 
+/* the entries are hashed by lib+name into per-bucket lists with
+ * per-bucket locks, so concurrent opens of different plugins do not
+ * serialize on one global mutex
+ */
+#define SND_DLOBJ_HASH_BITS	4
+#define SND_DLOBJ_HASH_SIZE	(1U << SND_DLOBJ_HASH_BITS)
+
+struct dlobj_bucket {
+	struct list_head list;
+#ifdef HAVE_LIBPTHREAD
+	pthread_mutex_t lock;
+#endif
+};
+
+static struct dlobj_bucket snd_dlobj_hash[SND_DLOBJ_HASH_SIZE];
+
+static void snd_dlobj_init(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < SND_DLOBJ_HASH_SIZE; i++) {
+		INIT_LIST_HEAD(&snd_dlobj_hash[i].list);
+#ifdef HAVE_LIBPTHREAD
+		pthread_mutex_init(&snd_dlobj_hash[i].lock, NULL);
+#endif
+	}
+}
+
 #ifdef HAVE_LIBPTHREAD
-static pthread_mutex_t snd_dlobj_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t snd_dlobj_once = PTHREAD_ONCE_INIT;
 
-static inline void snd_dlobj_lock(void)
+static inline void snd_dlobj_init_once(void)
 {
-	pthread_mutex_lock(&snd_dlobj_mutex);
+	pthread_once(&snd_dlobj_once, snd_dlobj_init);
 }
 
-static inline void snd_dlobj_unlock(void)
+static inline void snd_dlobj_lock(struct dlobj_bucket *bucket)
 {
-	pthread_mutex_unlock(&snd_dlobj_mutex);
+	pthread_mutex_lock(&bucket->lock);
+}
+
+static inline void snd_dlobj_unlock(struct dlobj_bucket *bucket)
+{
+	pthread_mutex_unlock(&bucket->lock);
 }
 #else
-static inline void snd_dlobj_lock(void) {}
-static inline void snd_dlobj_unlock(void) {}
+static inline void snd_dlobj_init_once(void)
+{
+	static int initialized;
+
+	if (!initialized) {
+		initialized = 1;
+		snd_dlobj_init();
+	}
+}
+
+static inline void snd_dlobj_lock(struct dlobj_bucket *bucket ATTRIBUTE_UNUSED) {}
+static inline void snd_dlobj_unlock(struct dlobj_bucket *bucket ATTRIBUTE_UNUSED) {}
 #endif
 
-static LIST_HEAD(pcm_dlobj_list);
+static struct dlobj_bucket *snd_dlobj_bucket(const char *lib, const char *name)
+{
+	unsigned int hash = 2166136261U;	/* FNV-1a */
+	const char *s;
+
+	for (s = name; *s; s++)
+		hash = (hash ^ (unsigned char)*s) * 16777619U;
+	if (lib)
+		for (s = lib; *s; s++)
+			hash = (hash ^ (unsigned char)*s) * 16777619U;
+	snd_dlobj_init_once();
+	return &snd_dlobj_hash[hash & (SND_DLOBJ_HASH_SIZE - 1)];
+}
 
+/* call with the bucket lock held */
 static struct dlobj_cache *
-snd_dlobj_cache_get0(const char *lib, const char *name,
-		     const char *version, int verbose)
+snd_dlobj_cache_lookup(struct dlobj_bucket *bucket,
+		       const char *lib, const char *name)
 {
 	struct list_head *p;
 	struct dlobj_cache *c;
-	void *func, *dlobj;
-	char errbuf[256];
 
-	list_for_each(p, &pcm_dlobj_list) {
+	list_for_each(p, &bucket->list) {
 		c = list_entry(p, struct dlobj_cache, list);
 		if (c->lib && lib && strcmp(c->lib, lib) != 0)
 			continue;
@@ -324,12 +378,34 @@ snd_dlobj_cache_get0(const char *lib, const char *name,
 			continue;
 		if (!lib && c->lib)
 			continue;
-		if (strcmp(c->name, name) == 0) {
-			c->refcnt++;
+		if (strcmp(c->name, name) == 0)
 			return c;
-		}
 	}
+	return NULL;
+}
+
+static void *snd_dlobj_cache_get1(const char *lib, const char *name,
+				  const char *version, int verbose,
+				  unsigned int refs)
+{
+	struct dlobj_bucket *bucket = snd_dlobj_bucket(lib, name);
+	struct dlobj_cache *c, *c2;
+	void *func, *dlobj;
+	char errbuf[256];
+
+	snd_dlobj_lock(bucket);
+	c = snd_dlobj_cache_lookup(bucket, lib, name);
+	if (c) {
+		c->refcnt += refs;
+		func = c->func;
+		snd_dlobj_unlock(bucket);
+		return func;
+	}
+	snd_dlobj_unlock(bucket);
 
+	/* resolve outside the lock; concurrent opens do not block
+	 * each other on dlopen/dlsym
+	 */
 	errbuf[0] = '\0';
 	dlobj = INTERNAL(snd_dlopen)(lib, RTLD_NOW,
 	                   verbose ? errbuf : 0,
@@ -352,7 +428,7 @@ snd_dlobj_cache_get0(const char *lib, const char *name,
 	c = malloc(sizeof(*c));
 	if (! c)
 		goto __err;
-	c->refcnt = 1;
+	c->refcnt = refs;
 	c->lib = lib ? strdup(lib) : NULL;
 	c->name = strdup(name);
 	if ((lib && ! c->lib) || ! c->name) {
@@ -365,62 +441,63 @@ snd_dlobj_cache_get0(const char *lib, const char *name,
 	}
 	c->dlobj = dlobj;
 	c->func = func;
-	list_add_tail(&c->list, &pcm_dlobj_list);
-	return c;
+	snd_dlobj_lock(bucket);
+	c2 = snd_dlobj_cache_lookup(bucket, lib, name);
+	if (c2) {
+		/* lost the race against another resolver; reuse its entry */
+		c2->refcnt += refs;
+		func = c2->func;
+		snd_dlobj_unlock(bucket);
+		free((void *)c->name);
+		free((void *)c->lib);
+		free(c);
+		snd_dlclose(dlobj);
+		return func;
+	}
+	list_add_tail(&c->list, &bucket->list);
+	snd_dlobj_unlock(bucket);
+	return func;
 }
 
 void *snd_dlobj_cache_get(const char *lib, const char *name,
 			  const char *version, int verbose)
 {
-	struct dlobj_cache *c;
-	void *func = NULL;
-
-	snd_dlobj_lock();
-	c = snd_dlobj_cache_get0(lib, name, version, verbose);
-	if (c)
-		func = c->func;
-	snd_dlobj_unlock();
-	return func;
+	return snd_dlobj_cache_get1(lib, name, version, verbose, 1);
 }
 
 void *snd_dlobj_cache_get2(const char *lib, const char *name,
 			   const char *version, int verbose)
 {
-	struct dlobj_cache *c;
-	void *func = NULL;
-
-	snd_dlobj_lock();
-	c = snd_dlobj_cache_get0(lib, name, version, verbose);
-	if (c) {
-		func = c->func;
-		/* double reference */
-		c->refcnt++;
-	}
-	snd_dlobj_unlock();
-	return func;
+	/* double reference */
+	return snd_dlobj_cache_get1(lib, name, version, verbose, 2);
 }
 
 int snd_dlobj_cache_put(void *func)
 {
 	struct list_head *p;
 	struct dlobj_cache *c;
-	unsigned int refcnt;
+	unsigned int i, refcnt;
 
 	if (!func)
 		return -ENOENT;
 
-	snd_dlobj_lock();
-	list_for_each(p, &pcm_dlobj_list) {
-		c = list_entry(p, struct dlobj_cache, list);
-		if (c->func == func) {
-			refcnt = c->refcnt;
-			if (c->refcnt > 0)
-				c->refcnt--;
-			snd_dlobj_unlock();
-			return refcnt == 1 ? 0 : -EINVAL;
+	snd_dlobj_init_once();
+	for (i = 0; i < SND_DLOBJ_HASH_SIZE; i++) {
+		struct dlobj_bucket *bucket = &snd_dlobj_hash[i];
+
+		snd_dlobj_lock(bucket);
+		list_for_each(p, &bucket->list) {
+			c = list_entry(p, struct dlobj_cache, list);
+			if (c->func == func) {
+				refcnt = c->refcnt;
+				if (c->refcnt > 0)
+					c->refcnt--;
+				snd_dlobj_unlock(bucket);
+				return refcnt == 1 ? 0 : -EINVAL;
+			}
 		}
+		snd_dlobj_unlock(bucket);
 	}
-	snd_dlobj_unlock();
 	return -ENOENT;
 }
 
@@ -428,19 +505,25 @@ void snd_dlobj_cache_cleanup(void)
 {
 	struct list_head *p, *npos;
 	struct dlobj_cache *c;
-
-	snd_dlobj_lock();
-	list_for_each_safe(p, npos, &pcm_dlobj_list) {
-		c = list_entry(p, struct dlobj_cache, list);
-		if (c->refcnt)
-			continue;
-		list_del(p);
-		snd_dlclose(c->dlobj);
-		free((void *)c->name); /* shut up gcc warning */
-		free((void *)c->lib); /* shut up gcc warning */
-		free(c);
+	unsigned int i;
+
+	snd_dlobj_init_once();
+	for (i = 0; i < SND_DLOBJ_HASH_SIZE; i++) {
+		struct dlobj_bucket *bucket = &snd_dlobj_hash[i];
+
+		snd_dlobj_lock(bucket);
+		list_for_each_safe(p, npos, &bucket->list) {
+			c = list_entry(p, struct dlobj_cache, list);
+			if (c->refcnt)
+				continue;
+			list_del(p);
+			snd_dlclose(c->dlobj);
+			free((void *)c->name); /* shut up gcc warning */
+			free((void *)c->lib); /* shut up gcc warning */
+			free(c);
+		}
+		snd_dlobj_unlock(bucket);
 	}
-	snd_dlobj_unlock();
 	snd_dlpath_lock();
 	snd_plugin_dir_set = 0;
 	free(snd_plugin_dir);
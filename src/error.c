@@ -70,6 +70,78 @@ const char *snd_strerror(int errnum)
 
 static TLS_PFX snd_local_error_handler_t local_error = NULL;
 
+#ifndef DOC_HIDDEN
+/* per-thread record of the last error; the location and the code are
+ * stored cheaply when the error fires, the message is built only when
+ * snd_lib_error_last() asks for it */
+struct snd_error_ctx {
+	const char *file;
+	const char *function;
+	int line;
+	int err;
+	int valid;
+	char fmt[128];
+	char msg[256];
+};
+
+static TLS_PFX struct snd_error_ctx error_ctx;
+static int error_quiet;
+
+static void error_ctx_record(const char *file, int line, const char *function,
+			     int err, const char *fmt)
+{
+	error_ctx.file = file;
+	error_ctx.line = line;
+	error_ctx.function = function;
+	error_ctx.err = err;
+	snd_strlcpy(error_ctx.fmt, fmt, sizeof(error_ctx.fmt));
+	error_ctx.valid = 1;
+}
+#endif
+
+/**
+ * \brief Suppress the default error message output
+ * \param quiet Non-zero to suppress the output
+ * \retval The previous quiet state
+ *
+ * When the quiet mode is enabled, the default error handler neither
+ * formats nor prints the messages; it only records the error location
+ * and code in a per-thread context that can be retrieved cheaply via
+ * snd_lib_error_last().  Handlers installed with
+ * snd_lib_error_set_handler() or snd_lib_error_set_local() are still
+ * called.
+ */
+int snd_lib_error_set_quiet(int quiet)
+{
+	int old = error_quiet;
+	error_quiet = quiet;
+	return old;
+}
+
+/**
+ * \brief Return the last error recorded in the calling thread
+ * \param errp The pointer to store the error code, or NULL
+ * \return The error message, or NULL when no error was recorded
+ *
+ * The message is formatted on demand from the recorded location and
+ * format string; the format arguments of the original message are
+ * deliberately not expanded to keep the recording path cheap.  The
+ * returned string is owned by the per-thread context and is valid
+ * until the next error in the same thread.
+ */
+const char *snd_lib_error_last(int *errp)
+{
+	struct snd_error_ctx *ctx = &error_ctx;
+
+	if (!ctx->valid)
+		return NULL;
+	if (errp)
+		*errp = ctx->err;
+	snprintf(ctx->msg, sizeof(ctx->msg), "%s:%i:(%s) %s",
+		 ctx->file, ctx->line, ctx->function, ctx->fmt);
+	return ctx->msg;
+}
+
 /**
  * \brief Install local error handler
  * \param func The local error handler function
@@ -98,12 +170,16 @@ snd_local_error_handler_t snd_lib_error_set_local(snd_local_error_handler_t func
 static void snd_lib_error_default(const char *file, int line, const char *function, int err, const char *fmt, ...)
 {
 	va_list arg;
-	va_start(arg, fmt);
+	error_ctx_record(file, line, function, err, fmt);
 	if (local_error) {
+		va_start(arg, fmt);
 		local_error(file, line, function, err, fmt, arg);
 		va_end(arg);
 		return;
 	}
+	if (error_quiet)
+		return;
+	va_start(arg, fmt);
 	fprintf(stderr, "ALSA lib %s:%i:(%s) ", file, line, function);
 	vfprintf(stderr, fmt, arg);
 	if (err)
@@ -130,8 +206,11 @@ int snd_lib_error_set_handler(snd_lib_error_handler_t handler)
 {
 	snd_lib_error = handler == NULL ? snd_lib_error_default : handler;
 #ifndef NDEBUG
-	if (snd_lib_error != snd_lib_error_default)
+	if (snd_lib_error != snd_lib_error_default) {
 		snd_err_msg = snd_lib_error;
+		/* the custom handler must see all messages */
+		snd_err_msg_on = 1;
+	}
 #endif
 	return 0;
 }
@@ -149,13 +228,21 @@ const char *snd_asoundlib_version(void)
 /*
  * internal error handling
  */
+/* whether the internal SNDMSG/SYSMSG messages are wanted; -1 until the
+ * environment has been checked, so that the macros reduce to a single
+ * test and branch once the first message found the debugging disabled */
+int snd_err_msg_on = -1;
+
 static void snd_err_msg_default(const char *file, int line, const char *function, int err, const char *fmt, ...)
 {
 	va_list arg;
 	const char *verbose;
-	
-	verbose = getenv("LIBASOUND_DEBUG");
-	if (! verbose || ! *verbose)
+
+	if (snd_err_msg_on < 0) {
+		verbose = getenv("LIBASOUND_DEBUG");
+		snd_err_msg_on = verbose && *verbose ? 1 : 0;
+	}
+	if (!snd_err_msg_on)
 		return;
 	va_start(arg, fmt);
 	fprintf(stderr, "ALSA lib %s:%i:(%s) ", file, line, function);
@@ -35,6 +35,7 @@
 #include <string.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 
 static int snd_hwdep_open_conf(snd_hwdep_t **hwdep,
 			       const char *name, snd_config_t *hwdep_root,
@@ -493,6 +494,173 @@ ssize_t snd_hwdep_read(snd_hwdep_t *hwdep, void *buffer, size_t size)
 	return (hwdep->ops->read)(hwdep, buffer, size);
 }
 
+/**
+ * \brief write a vector of buffers using HwDep handle
+ * \param hwdep HwDep handle
+ * \param vector vector of output buffers (see writev(2))
+ * \param count count of buffers in the vector
+ * \return the number of bytes written otherwise a negative error code
+ *
+ * The whole vector is submitted to the driver in one system call, so
+ * large scattered images (e.g. DSP firmware sections) need not be
+ * copied into a contiguous bounce buffer first.
+ */
+ssize_t snd_hwdep_writev(snd_hwdep_t *hwdep, const struct iovec *vector, int count)
+{
+	ssize_t xfer, result;
+	int i;
+	assert(hwdep);
+	assert(((hwdep->mode & O_ACCMODE) == O_WRONLY) || ((hwdep->mode & O_ACCMODE) == O_RDWR));
+	assert(vector || count == 0);
+	if (hwdep->ops->writev)
+		return hwdep->ops->writev(hwdep, vector, count);
+	/* fall back to one transfer per buffer */
+	xfer = 0;
+	for (i = 0; i < count; i++) {
+		result = hwdep->ops->write(hwdep, vector[i].iov_base, vector[i].iov_len);
+		if (result < 0)
+			return xfer > 0 ? xfer : result;
+		xfer += result;
+		if ((size_t)result < vector[i].iov_len)
+			break;
+	}
+	return xfer;
+}
+
+/**
+ * \brief read a vector of buffers using HwDep handle
+ * \param hwdep HwDep handle
+ * \param vector vector of input buffers (see readv(2))
+ * \param count count of buffers in the vector
+ * \return the number of bytes read otherwise a negative error code
+ */
+ssize_t snd_hwdep_readv(snd_hwdep_t *hwdep, const struct iovec *vector, int count)
+{
+	ssize_t xfer, result;
+	int i;
+	assert(hwdep);
+	assert(((hwdep->mode & O_ACCMODE) == O_RDONLY) || ((hwdep->mode & O_ACCMODE) == O_RDWR));
+	assert(vector || count == 0);
+	if (hwdep->ops->readv)
+		return hwdep->ops->readv(hwdep, vector, count);
+	/* fall back to one transfer per buffer */
+	xfer = 0;
+	for (i = 0; i < count; i++) {
+		result = hwdep->ops->read(hwdep, vector[i].iov_base, vector[i].iov_len);
+		if (result < 0)
+			return xfer > 0 ? xfer : result;
+		xfer += result;
+		if ((size_t)result < vector[i].iov_len)
+			break;
+	}
+	return xfer;
+}
+
+/**
+ * \brief write a large block in chunks with progress reporting
+ * \param hwdep HwDep handle
+ * \param buffer buffer containing bytes to write
+ * \param size total number of bytes to write
+ * \param chunk_size maximal size of one transfer (0 = write all at once)
+ * \param callback function called after each chunk with the number of
+ *        bytes transferred so far and the total size; may be NULL;
+ *        a negative return value aborts the transfer
+ * \param private_data value passed unchanged to the callback
+ * \return the number of bytes written, the callback abort code, or
+ *         another negative error code when nothing was transferred
+ *
+ * Intended for pushing multi-megabyte DSP firmware images where the
+ * application wants to display download progress; a short write by the
+ * driver terminates the loop and the partial count is returned.
+ */
+ssize_t snd_hwdep_write_chunked(snd_hwdep_t *hwdep, const void *buffer, size_t size,
+				size_t chunk_size,
+				snd_hwdep_xfer_callback_t callback, void *private_data)
+{
+	const unsigned char *buf = buffer;
+	size_t xfer = 0, chunk;
+	ssize_t result;
+	int err;
+
+	assert(hwdep);
+	assert(buffer || size == 0);
+	if (chunk_size == 0)
+		chunk_size = size;
+	while (xfer < size) {
+		chunk = size - xfer;
+		if (chunk > chunk_size)
+			chunk = chunk_size;
+		result = snd_hwdep_write(hwdep, buf + xfer, chunk);
+		if (result < 0)
+			return xfer > 0 ? (ssize_t)xfer : result;
+		xfer += result;
+		if (callback) {
+			err = callback(private_data, xfer, size);
+			if (err < 0)
+				return err;
+		}
+		if ((size_t)result < chunk)
+			break;
+	}
+	return xfer;
+}
+
+/**
+ * \brief map a memory area of the HwDep device
+ * \param hwdep HwDep handle
+ * \param size size of the area in bytes
+ * \param offset offset of the area (driver specific)
+ * \param bufp the pointer to the mapped area is stored here
+ * \return 0 on success otherwise a negative error code
+ *
+ * The protection of the mapping follows the open mode of the handle.
+ * Only drivers which implement the mmap file operation support this;
+ * others fail with the error code returned by the kernel (usually
+ * -ENODEV).  Useful for staging DSP images directly in device memory
+ * instead of streaming them through write().
+ */
+int snd_hwdep_mmap(snd_hwdep_t *hwdep, size_t size, off_t offset, void **bufp)
+{
+	int prot;
+	void *buf;
+	assert(hwdep);
+	assert(bufp);
+	if (hwdep->type != SND_HWDEP_TYPE_HW)
+		return -ENOSYS;
+	switch (hwdep->mode & O_ACCMODE) {
+	case O_RDONLY:
+		prot = PROT_READ;
+		break;
+	case O_WRONLY:
+		prot = PROT_WRITE;
+		break;
+	default:
+		prot = PROT_READ | PROT_WRITE;
+		break;
+	}
+	buf = mmap(NULL, size, prot, MAP_SHARED, hwdep->poll_fd, offset);
+	if (buf == MAP_FAILED)
+		return -errno;
+	*bufp = buf;
+	return 0;
+}
+
+/**
+ * \brief unmap a memory area of the HwDep device
+ * \param hwdep HwDep handle
+ * \param buf the area obtained from #snd_hwdep_mmap
+ * \param size size of the area in bytes
+ * \return 0 on success otherwise a negative error code
+ */
+int snd_hwdep_munmap(snd_hwdep_t *hwdep, void *buf, size_t size)
+{
+	assert(hwdep);
+	assert(buf);
+	if (munmap(buf, size) < 0)
+		return -errno;
+	return 0;
+}
+
 /**
  * \brief get the DSP status information
  * \param hwdep HwDep handle
@@ -26,6 +26,7 @@
 #include <string.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 
 #ifndef PIC
 /* entry for static linking */
@@ -94,6 +95,26 @@ static ssize_t snd_hwdep_hw_read(snd_hwdep_t *hwdep, void *buffer, size_t size)
 	return result;
 }
 
+static ssize_t snd_hwdep_hw_writev(snd_hwdep_t *hwdep, const struct iovec *vector, int count)
+{
+	ssize_t result;
+	assert(hwdep && (vector || count == 0));
+	result = writev(hwdep->poll_fd, vector, count);
+	if (result < 0)
+		return -errno;
+	return result;
+}
+
+static ssize_t snd_hwdep_hw_readv(snd_hwdep_t *hwdep, const struct iovec *vector, int count)
+{
+	ssize_t result;
+	assert(hwdep && (vector || count == 0));
+	result = readv(hwdep->poll_fd, vector, count);
+	if (result < 0)
+		return -errno;
+	return result;
+}
+
 static const snd_hwdep_ops_t snd_hwdep_hw_ops = {
 	.close = snd_hwdep_hw_close,
 	.nonblock = snd_hwdep_hw_nonblock,
@@ -101,6 +122,8 @@ static const snd_hwdep_ops_t snd_hwdep_hw_ops = {
 	.ioctl = snd_hwdep_hw_ioctl,
 	.write = snd_hwdep_hw_write,
 	.read = snd_hwdep_hw_read,
+	.writev = snd_hwdep_hw_writev,
+	.readv = snd_hwdep_hw_readv,
 };
 
 int snd_hwdep_hw_open(snd_hwdep_t **handle, const char *name, int card, int device, int mode)
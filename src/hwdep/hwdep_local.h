@@ -23,6 +23,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <sys/uio.h>
 
 typedef struct {
 	int (*close)(snd_hwdep_t *hwdep);
@@ -31,6 +32,8 @@ typedef struct {
 	int (*ioctl)(snd_hwdep_t *hwdep, unsigned int request, void * arg);
 	ssize_t (*write)(snd_hwdep_t *hwdep, const void *buffer, size_t size);
 	ssize_t (*read)(snd_hwdep_t *hwdep, void *buffer, size_t size);
+	ssize_t (*writev)(snd_hwdep_t *hwdep, const struct iovec *vector, int count);
+	ssize_t (*readv)(snd_hwdep_t *hwdep, const struct iovec *vector, int count);
 } snd_hwdep_ops_t;
 
 struct _snd_hwdep {
@@ -32,6 +32,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 
 #ifndef DOC_HIDDEN
 
@@ -226,12 +229,16 @@ typedef struct _snd_input_buffer {
 	unsigned char *buf;
 	unsigned char *ptr;
 	size_t size;
+	size_t map_size;	/* non-zero for a mapped file */
 } snd_input_buffer_t;
 
 static int snd_input_buffer_close(snd_input_t *input)
 {
 	snd_input_buffer_t *buffer = input->private_data;
-	free(buffer->buf);
+	if (buffer->map_size)
+		munmap(buffer->buf, buffer->map_size);
+	else
+		free(buffer->buf);
 	free(buffer);
 	return 0;
 }
@@ -334,4 +341,112 @@ int snd_input_buffer_open(snd_input_t **inputp, const char *buf, ssize_t size)
 	*inputp = input;
 	return 0;
 }
-	
+
+/**
+ * \brief Creates a new buffer input object reading from a file.
+ * \param inputp The function puts the pointer to the new input object
+ *               at the address specified by \p inputp.
+ * \param file The name of the file to read from.
+ * \return Zero if successful, otherwise a negative error code.
+ *
+ * Unlike #snd_input_stdio_open, a regular file is mapped (or read at
+ * once) into memory and served as a buffer input, which makes the
+ * character based parsers considerably faster. Non-regular files fall
+ * back transparently to the stdio mode.
+ */
+int snd_input_file_open(snd_input_t **inputp, const char *file)
+{
+	snd_input_t *input;
+	snd_input_buffer_t *buffer = NULL;
+	unsigned char *buf;
+	struct stat64 st;
+	size_t size;
+	int fd, err;
+
+	assert(inputp && file);
+	fd = open(file, O_RDONLY);
+	if (fd < 0)
+		return -errno;
+	if (fstat64(fd, &st) < 0) {
+		err = -errno;
+		close(fd);
+		return err;
+	}
+	if (!S_ISREG(st.st_mode)) {
+		/* pipes, devices etc. cannot be sized and mapped */
+		FILE *fp = fdopen(fd, "r");
+		if (!fp) {
+			err = -errno;
+			close(fd);
+			return err;
+		}
+		err = snd_input_stdio_attach(inputp, fp, 1);
+		if (err < 0)
+			fclose(fp);
+		return err;
+	}
+	size = st.st_size;
+	buffer = calloc(1, sizeof(*buffer));
+	input = calloc(1, sizeof(*input));
+	if (!buffer || !input) {
+		err = -ENOMEM;
+		goto _err;
+	}
+	buf = MAP_FAILED;
+	if (size > 0)
+		buf = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (buf != MAP_FAILED) {
+		buffer->map_size = size;
+	} else {
+		ssize_t res;
+		buf = malloc(size + 1);
+		if (!buf) {
+			err = -ENOMEM;
+			goto _err;
+		}
+		res = read(fd, buf, size);
+		if (res < 0) {
+			err = -errno;
+			free(buf);
+			goto _err;
+		}
+		size = res;
+		buf[size] = 0;
+	}
+	close(fd);
+	buffer->buf = buf;
+	buffer->ptr = buf;
+	buffer->size = size;
+	input->type = SND_INPUT_BUFFER;
+	input->ops = &snd_input_buffer_ops;
+	input->private_data = buffer;
+	*inputp = input;
+	return 0;
+ _err:
+	free(buffer);
+	free(input);
+	close(fd);
+	return err;
+}
+
+#ifndef DOC_HIDDEN
+/* Hands the unread part of a buffer input over to the caller as a flat
+ * window for direct consumption (used by the config tokenizer); further
+ * reads through the input see the end of file. Returns -ENOENT for
+ * inputs without a memory window.
+ */
+int _snd_input_buffer_window(snd_input_t *input, const unsigned char **ptr,
+			     size_t *size)
+{
+	snd_input_buffer_t *buffer;
+
+	if (input->type != SND_INPUT_BUFFER)
+		return -ENOENT;
+	buffer = input->private_data;
+	*ptr = buffer->ptr;
+	*size = buffer->size;
+	buffer->ptr += buffer->size;
+	buffer->size = 0;
+	return 0;
+}
+#endif
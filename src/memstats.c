@@ -0,0 +1,87 @@
+/**
+ * \file memstats.c
+ * \brief Subsystem-tagged allocation accounting
+ * \author Jaroslav Kysela <perex@perex.cz>
+ * \date 2025
+ */
+/*
+ *  Subsystem-tagged allocation accounting
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 2.1 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include <string.h>
+#include "local.h"
+
+static long long memstat_bytes[SND_MEMSTAT_LAST];
+static long long memstat_objects[SND_MEMSTAT_LAST];
+
+static const char *const memstat_names[SND_MEMSTAT_LAST] = {
+	[SND_MEMSTAT_CONFIG] = "config",
+	[SND_MEMSTAT_HCTL] = "hctl",
+	[SND_MEMSTAT_PCM] = "pcm",
+	[SND_MEMSTAT_UCM] = "ucm",
+};
+
+#ifndef DOC_HIDDEN
+/* called from the allocation choke points of the subsystems; bytes
+ * and objects are signed so the same call accounts frees */
+void snd_memstat_update(unsigned int subsys, ssize_t bytes, int objects)
+{
+	if (subsys >= SND_MEMSTAT_LAST)
+		return;
+	__atomic_add_fetch(&memstat_bytes[subsys], (long long)bytes,
+			   __ATOMIC_RELAXED);
+	__atomic_add_fetch(&memstat_objects[subsys], (long long)objects,
+			   __ATOMIC_RELAXED);
+}
+#endif
+
+/**
+ * \brief Get the memory currently held by a library subsystem
+ * \param subsystem subsystem name ("config", "hctl", "pcm", "ucm"),
+ *        NULL for the sum over all subsystems
+ * \param stats returned counters
+ * \return 0 on success, -ENOENT for an unknown subsystem name
+ *
+ * The counters cover the central allocation points of each subsystem -
+ * configuration tree nodes and their arenas, high-level control
+ * elements, PCM handles and locally allocated sample buffers, use case
+ * manager instances - not every last string, so treat the numbers as a
+ * footprint estimate.  They are process wide and updated with relaxed
+ * atomics, so a snapshot taken while other threads allocate may lag by
+ * the operations in flight.
+ */
+int snd_lib_memstats(const char *subsystem, snd_lib_memstats_t *stats)
+{
+	unsigned int i;
+	long long b = 0, o = 0;
+
+	assert(stats);
+	for (i = 0; i < SND_MEMSTAT_LAST; i++) {
+		if (subsystem && strcmp(subsystem, memstat_names[i]) != 0)
+			continue;
+		b += __atomic_load_n(&memstat_bytes[i], __ATOMIC_RELAXED);
+		o += __atomic_load_n(&memstat_objects[i], __ATOMIC_RELAXED);
+		if (subsystem)
+			break;
+	}
+	if (subsystem && i >= SND_MEMSTAT_LAST)
+		return -ENOENT;
+	stats->bytes = b > 0 ? b : 0;
+	stats->objects = o > 0 ? o : 0;
+	return 0;
+}
@@ -19,55 +19,111 @@
  *
  */
 
+/*
+ * The bag is an array of pointers kept sorted by pointer value, with a
+ * few entries of inline storage so that the common one-element bags of
+ * the mixer (one mixer element per hcontrol element and vice versa)
+ * never touch the heap.  Lookups and removals are binary searches; the
+ * old list based implementation scanned linearly on every event, which
+ * showed up in profiles with many control elements.
+ */
+
 #include "mixer_local.h"
 
+/* returns 1 and the position of ptr when found, otherwise 0 and the
+ * insertion slot that keeps the array sorted */
+static int bag_find(bag_t *bag, void *ptr, unsigned int *pos)
+{
+	unsigned int lo = 0, hi = bag->count;
+
+	while (lo < hi) {
+		unsigned int mid = (lo + hi) / 2;
+		if ((uintptr_t)bag->ptrs[mid] < (uintptr_t)ptr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	*pos = lo;
+	return lo < bag->count && bag->ptrs[lo] == ptr;
+}
+
+void bag_init(bag_t *bag)
+{
+	bag->count = 0;
+	bag->alloc = 0;
+	bag->ptrs = bag->inl;
+}
+
 int bag_new(bag_t **bag)
 {
 	bag_t *b = malloc(sizeof(*b));
 	if (!b)
 		return -ENOMEM;
-	INIT_LIST_HEAD(b);
+	bag_init(b);
 	*bag = b;
 	return 0;
 }
 
 void bag_free(bag_t *bag)
 {
-	assert(list_empty(bag));
+	assert(bag_empty(bag));
+	if (bag->alloc)
+		free(bag->ptrs);
 	free(bag);
 }
 
 int bag_empty(bag_t *bag)
 {
-	return list_empty(bag);
+	return bag->count == 0;
 }
 
 int bag_add(bag_t *bag, void *ptr)
 {
-	bag1_t *b = malloc(sizeof(*b));
-	if (!b)
-		return -ENOMEM;
-	b->ptr = ptr;
-	list_add_tail(&b->list, bag);
+	unsigned int pos;
+
+	bag_find(bag, ptr, &pos);
+	if (bag->count >= (bag->alloc ? bag->alloc : BAG_INLINE)) {
+		unsigned int alloc = bag->alloc ? bag->alloc * 2 : BAG_INLINE * 2;
+		void **ptrs;
+
+		if (bag->alloc) {
+			ptrs = realloc(bag->ptrs, alloc * sizeof(*ptrs));
+			if (!ptrs)
+				return -ENOMEM;
+		} else {
+			ptrs = malloc(alloc * sizeof(*ptrs));
+			if (!ptrs)
+				return -ENOMEM;
+			memcpy(ptrs, bag->inl, bag->count * sizeof(*ptrs));
+		}
+		bag->ptrs = ptrs;
+		bag->alloc = alloc;
+	}
+	memmove(bag->ptrs + pos + 1, bag->ptrs + pos,
+		(bag->count - pos) * sizeof(*bag->ptrs));
+	bag->ptrs[pos] = ptr;
+	bag->count++;
 	return 0;
 }
 
 int bag_del(bag_t *bag, void *ptr)
 {
-	struct list_head *pos;
-	list_for_each(pos, bag) {
-		bag1_t *b = list_entry(pos, bag1_t, list);
-		if (b->ptr == ptr) {
-			list_del(&b->list);
-			free(b);
-			return 0;
-		}
-	}
-	return -ENOENT;
+	unsigned int pos;
+
+	if (!bag_find(bag, ptr, &pos))
+		return -ENOENT;
+	bag->count--;
+	/* the heap storage is kept - releasing it here would invalidate
+	 * a bag_for_each_safe() iteration emptying the bag; it is freed
+	 * by bag_del_all() or bag_free() */
+	memmove(bag->ptrs + pos, bag->ptrs + pos + 1,
+		(bag->count - pos) * sizeof(*bag->ptrs));
+	return 0;
 }
 
 void bag_del_all(bag_t *bag)
 {
-	while (!list_empty(bag))
-		list_del(bag->next);
+	if (bag->alloc)
+		free(bag->ptrs);
+	bag_init(bag);
 }
@@ -75,6 +75,7 @@ int snd_mixer_open(snd_mixer_t **mixerp, int mode ATTRIBUTE_UNUSED)
 	INIT_LIST_HEAD(&mixer->slaves);
 	INIT_LIST_HEAD(&mixer->classes);
 	INIT_LIST_HEAD(&mixer->elems);
+	INIT_LIST_HEAD(&mixer->deferred);
 	mixer->compare = snd_mixer_compare_default;
 	*mixerp = mixer;
 	return 0;
@@ -330,7 +331,21 @@ static int snd_mixer_throw_event(snd_mixer_t *mixer, unsigned int mask,
 
 static int snd_mixer_elem_throw_event(snd_mixer_elem_t *elem, unsigned int mask)
 {
-	elem->class->mixer->events++;
+	snd_mixer_t *mixer = elem->class->mixer;
+
+	mixer->events++;
+	if (mask == SND_CTL_EVENT_MASK_REMOVE) {
+		/* the element goes away - drop any coalesced events */
+		if (elem->deferred_mask != 0) {
+			list_del(&elem->deferred_list);
+			elem->deferred_mask = 0;
+		}
+	} else if (mixer->coalesce && mixer->in_handle) {
+		if (elem->deferred_mask == 0)
+			list_add_tail(&elem->deferred_list, &mixer->deferred);
+		elem->deferred_mask |= mask;
+		return 0;
+	}
 	if (elem->callback)
 		return elem->callback(elem, mask);
 	return 0;
@@ -395,7 +410,7 @@ int snd_mixer_elem_new(snd_mixer_elem_t **elem,
 	melem->compare_weight = compare_weight;
 	melem->private_data = private_data;
 	melem->private_free = private_free;
-	INIT_LIST_HEAD(&melem->helems);
+	bag_init(&melem->helems);
 	*elem = melem;
 	return 0;
 }
@@ -489,6 +504,7 @@ void snd_mixer_elem_free(snd_mixer_elem_t *elem)
 {
 	if (elem->private_free)
 		elem->private_free(elem);
+	bag_del_all(&elem->helems);
 	free(elem);
 }
 
@@ -843,27 +859,84 @@ snd_mixer_elem_t *snd_mixer_elem_prev(snd_mixer_elem_t *elem)
 	return list_entry(elem->list.prev, snd_mixer_elem_t, list);
 }
 
+/* invoke the callbacks coalesced during snd_mixer_handle_events */
+static int snd_mixer_dispatch_deferred(snd_mixer_t *mixer)
+{
+	int err = 0, res;
+
+	while (!list_empty(&mixer->deferred)) {
+		snd_mixer_elem_t *elem;
+		unsigned int mask;
+
+		elem = list_entry(mixer->deferred.next, snd_mixer_elem_t,
+				  deferred_list);
+		mask = elem->deferred_mask;
+		list_del(&elem->deferred_list);
+		elem->deferred_mask = 0;
+		if (elem->callback) {
+			res = elem->callback(elem, mask);
+			if (res < 0 && err == 0)
+				err = res;
+		}
+	}
+	return err;
+}
+
 /**
  * \brief Handle pending mixer events invoking callbacks
  * \param mixer Mixer handle
  * \return Number of events that occured on success, otherwise a negative error code on failure
+ *
+ * When event coalescing is enabled (see #snd_mixer_coalesce_events),
+ * all pending events from all attached HCTLs are drained first and
+ * each element callback is invoked at most once with the aggregate
+ * event mask.
  */
 int snd_mixer_handle_events(snd_mixer_t *mixer)
 {
 	struct list_head *pos;
+	int err = 0, res;
 	assert(mixer);
 	mixer->events = 0;
+	mixer->in_handle = 1;
 	list_for_each(pos, &mixer->slaves) {
-		int err;
 		snd_mixer_slave_t *s;
 		s = list_entry(pos, snd_mixer_slave_t, list);
 		err = snd_hctl_handle_events(s->hctl);
 		if (err < 0)
-			return err;
+			break;
+		err = 0;
 	}
+	mixer->in_handle = 0;
+	res = snd_mixer_dispatch_deferred(mixer);
+	if (err == 0)
+		err = res;
+	if (err < 0)
+		return err;
 	return mixer->events;
 }
 
+/**
+ * \brief Enable or disable event coalescing for a mixer
+ * \param mixer Mixer handle
+ * \param enable Non-zero to coalesce events, zero for immediate dispatch
+ * \return 0 on success otherwise a negative error code
+ *
+ * By default every control event is dispatched to the element callback
+ * separately, so e.g. a volume drag invokes the callback once per
+ * written value.  With coalescing enabled, #snd_mixer_handle_events
+ * drains all pending events first and invokes each element callback at
+ * most once per batch with the ORed mask of all its events.  Remove
+ * events are still dispatched immediately, since the element is freed
+ * afterwards.
+ */
+int snd_mixer_coalesce_events(snd_mixer_t *mixer, int enable)
+{
+	assert(mixer);
+	mixer->coalesce = enable ? 1 : 0;
+	return 0;
+}
+
 /**
  * \brief Set callback function for a mixer
  * \param obj mixer handle
@@ -22,25 +22,34 @@
 
 #include "local.h"
 
-typedef struct _bag1 {
-	void *ptr;
-	struct list_head list;
-} bag1_t;
+#define BAG_INLINE	4
 
-typedef struct list_head bag_t;
+typedef struct _bag {
+	unsigned int count;
+	unsigned int alloc;	/* 0 while the inline storage is used */
+	void **ptrs;		/* sorted; points at inl for small bags */
+	void *inl[BAG_INLINE];
+} bag_t;
 
 int bag_new(bag_t **bag);
+void bag_init(bag_t *bag);
 void bag_free(bag_t *bag);
 int bag_add(bag_t *bag, void *ptr);
 int bag_del(bag_t *bag, void *ptr);
 int bag_empty(bag_t *bag);
 void bag_del_all(bag_t *bag);
 
-typedef struct list_head *bag_iterator_t;
+typedef void **bag_iterator_t;
 
-#define bag_iterator_entry(i) (list_entry((i), bag1_t, list)->ptr)
-#define bag_for_each(pos, bag) list_for_each(pos, bag)
-#define bag_for_each_safe(pos, next, bag) list_for_each_safe(pos, next, bag)
+#define bag_iterator_entry(i) (*(i))
+#define bag_for_each(pos, bag) \
+	for ((pos) = (bag)->ptrs; (pos) < (bag)->ptrs + (bag)->count; (pos)++)
+/* iterates backwards, so removing the current entry (or any entry
+ * behind it) from the loop body does not upset the iteration */
+#define bag_for_each_safe(pos, next, bag) \
+	for ((next) = (bag)->ptrs + (bag)->count - 1; \
+	     ((pos) = (next)) >= (bag)->ptrs; \
+	     (next) = (pos) - 1)
 
 struct _snd_mixer_class {
 	struct list_head list;
@@ -61,6 +70,8 @@ struct _snd_mixer_elem {
 	void *callback_private;
 	bag_t helems;
 	int compare_weight;		/* compare weight (reversed) */
+	struct list_head deferred_list;	/* link for coalesced callbacks */
+	unsigned int deferred_mask;	/* aggregate coalesced event mask */
 };
 
 struct _snd_mixer {
@@ -71,6 +82,9 @@ struct _snd_mixer {
 	unsigned int count;
 	unsigned int alloc;
 	unsigned int events;
+	unsigned int coalesce: 1;	/* batch element callbacks */
+	unsigned int in_handle: 1;	/* inside snd_mixer_handle_events */
+	struct list_head deferred;	/* elems with coalesced callbacks */
 	snd_mixer_callback_t callback;
 	void *callback_private;
 	snd_mixer_compare_t compare;
@@ -37,6 +37,9 @@
 #include <sys/ioctl.h>
 #include <math.h>
 #include <dlfcn.h>
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
 
 #ifndef DOC_HIDDEN
 
@@ -58,6 +61,91 @@ typedef int (*snd_mixer_sfbasic_init_t)(snd_mixer_class_t *class,
 					snd_mixer_t *mixer,
 					const char *device);
 
+/* process lifetime cache of the module probe per control device; the
+ * card components behind a device do not change while the process
+ * runs, so the winning module with its resolved symbols and pinned
+ * dlopen handle - or the definitive probe failure - is reused by
+ * every following attach instead of re-parsing smixer.conf and
+ * walking the dlopen/dlsym probe sequence again (the same idea as
+ * the dlobj cache, keyed by the device instead of the symbol)
+ */
+struct smixer_probe {
+	char *device;
+	void *dlhandle;		/* pinned for the process lifetime */
+	snd_mixer_event_t event_func;
+	void *init_func;	/* sbasic or sfbasic init function */
+	int full;		/* init_func takes the finit arguments */
+	int result;		/* cached probe error when dlhandle == NULL */
+	struct smixer_probe *next;
+};
+
+static struct smixer_probe *smixer_probes;
+#ifdef HAVE_LIBPTHREAD
+static pthread_mutex_t smixer_probes_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static inline void smixer_probes_lock(void)
+{
+#ifdef HAVE_LIBPTHREAD
+	pthread_mutex_lock(&smixer_probes_mutex);
+#endif
+}
+
+static inline void smixer_probes_unlock(void)
+{
+#ifdef HAVE_LIBPTHREAD
+	pthread_mutex_unlock(&smixer_probes_mutex);
+#endif
+}
+
+static struct smixer_probe *smixer_probe_get(const char *device)
+{
+	struct smixer_probe *p;
+
+	smixer_probes_lock();
+	for (p = smixer_probes; p; p = p->next)
+		if (strcmp(p->device, device) == 0)
+			break;
+	smixer_probes_unlock();
+	/* entries are immutable and never removed */
+	return p;
+}
+
+static int smixer_probe_put(const char *device, void *dlhandle,
+			    snd_mixer_event_t event_func, void *init_func,
+			    int full, int result)
+{
+	struct smixer_probe *p, **q;
+
+	p = calloc(1, sizeof(*p));
+	if (p == NULL)
+		return -ENOMEM;
+	p->device = strdup(device);
+	if (p->device == NULL) {
+		free(p);
+		return -ENOMEM;
+	}
+	p->dlhandle = dlhandle;
+	p->event_func = event_func;
+	p->init_func = init_func;
+	p->full = full;
+	p->result = result;
+	smixer_probes_lock();
+	for (q = &smixer_probes; *q; q = &(*q)->next)
+		if (strcmp((*q)->device, device) == 0)
+			break;
+	if (*q) {
+		/* lost the race against another prober; keep its entry */
+		smixer_probes_unlock();
+		free(p->device);
+		free(p);
+		return -EEXIST;
+	}
+	*q = p;
+	smixer_probes_unlock();
+	return 0;
+}
+
 #endif /* !DOC_HIDDEN */
 
 static int try_open(snd_mixer_class_t *class, const char *lib)
@@ -104,6 +192,10 @@ static int try_open(snd_mixer_class_t *class, const char *lib)
 	if (err < 0)
 		return err;
 	snd_mixer_class_set_event(class, event_func);
+	/* pin the handle and the resolved symbols for later attaches */
+	if (smixer_probe_put(priv->device, h, event_func,
+			     (void *)init_func, 0, 0) == 0)
+		priv->dlhandle = NULL;
 	return 1;
 }
 
@@ -151,6 +243,10 @@ static int try_open_full(snd_mixer_class_t *class, snd_mixer_t *mixer,
 	if (err < 0)
 		return err;
 	snd_mixer_class_set_event(class, event_func);
+	/* pin the handle and the resolved symbols for later attaches */
+	if (smixer_probe_put(priv->device, h, event_func,
+			     (void *)init_func, 1, 0) == 0)
+		priv->dlhandle = NULL;
 	return 1;
 }
 
@@ -273,6 +369,7 @@ int snd_mixer_simple_basic_register(snd_mixer_t *mixer,
 {
 	snd_mixer_class_t *class;
 	class_priv_t *priv = calloc(1, sizeof(*priv));
+	struct smixer_probe *probe;
 	const char *file;
 	snd_input_t *input;
 	snd_config_t *top = NULL;
@@ -297,29 +394,52 @@ int snd_mixer_simple_basic_register(snd_mixer_t *mixer,
 	snd_mixer_class_set_compare(class, snd_mixer_selem_compare);
 	snd_mixer_class_set_private(class, priv);
 	snd_mixer_class_set_private_free(class, private_free);
-	file = getenv("ALSA_MIXER_SIMPLE");
-	if (!file) {
-		const char *topdir = snd_config_topdir();
-		char *s = alloca(strlen(topdir) + strlen("smixer.conf") + 2);
-		sprintf(s, "%s/smixer.conf", topdir);
-		file = s;
+	/* probe outcome cached by a previous attach for this device */
+	probe = smixer_probe_get(priv->device);
+	if (probe && probe->dlhandle == NULL) {
+		err = probe->result;
+		goto __error;
 	}
-	err = snd_config_top(&top);
-	if (err >= 0) {
-		err = snd_input_stdio_open(&input, file, "r");
-		if (err < 0) {
-			SNDERR("unable to open simple mixer configuration file '%s'", file);
+	if (probe && probe->full) {
+		snd_mixer_sfbasic_init_t init_func = probe->init_func;
+		err = init_func(class, mixer, priv->device);
+		if (err < 0)
 			goto __error;
+		snd_mixer_class_set_event(class, probe->event_func);
+		err = 0;
+		goto __full;
+	}
+	err = 0;
+	if (!probe) {
+		file = getenv("ALSA_MIXER_SIMPLE");
+		if (!file) {
+			const char *topdir = snd_config_topdir();
+			char *s = alloca(strlen(topdir) + strlen("smixer.conf") + 2);
+			sprintf(s, "%s/smixer.conf", topdir);
+			file = s;
 		}
-		err = snd_config_load(top, input);
-		snd_input_close(input);
-		if (err < 0) {
-			SNDERR("%s may be old or corrupted: consider to remove or fix it", file);
-			goto __error;
+		err = snd_config_top(&top);
+		if (err >= 0) {
+			err = snd_input_stdio_open(&input, file, "r");
+			if (err < 0) {
+				SNDERR("unable to open simple mixer configuration file '%s'", file);
+				goto __error;
+			}
+			err = snd_config_load(top, input);
+			snd_input_close(input);
+			if (err < 0) {
+				SNDERR("%s may be old or corrupted: consider to remove or fix it", file);
+				goto __error;
+			}
+			err = find_full(class, mixer, top, priv->device);
+			if (err >= 0)
+				goto __full;
+			/* definitive resolution failures are cached, so
+			 * the next attach fails without the re-probe */
+			if (err != -ENOENT && err != -ENOMEM)
+				smixer_probe_put(priv->device, NULL, NULL,
+						 NULL, 0, err);
 		}
-		err = find_full(class, mixer, top, priv->device);
-		if (err >= 0)
-			goto __full;
 	}
 	if (err >= 0) {
 		err = snd_ctl_open(&priv->ctl, priv->device, 0);
@@ -337,8 +457,20 @@ int snd_mixer_simple_basic_register(snd_mixer_t *mixer,
 		if (err < 0)
 			goto __error;
 	}
-	if (err >= 0)
-		err = find_module(class, top);
+	if (err >= 0) {
+		if (probe) {
+			snd_mixer_sbasic_init_t init_func = probe->init_func;
+			err = init_func(class);
+			if (err >= 0)
+				snd_mixer_class_set_event(class,
+							  probe->event_func);
+		} else {
+			err = find_module(class, top);
+			if (err == -ENOENT)
+				smixer_probe_put(priv->device, NULL, NULL,
+						 NULL, 0, err);
+		}
+	}
 	if (err >= 0)
 		err = snd_mixer_attach_hctl(mixer, priv->hctl);
 	if (err >= 0) {
@@ -37,6 +37,7 @@
 #include <string.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
+#include <sys/utsname.h>
 #include <assert.h>
 #include <math.h>
 #include <limits.h>
@@ -77,18 +78,24 @@ typedef struct _selem_none {
 	sm_selem_t selem;
 	selem_ctl_t ctls[CTL_LAST + 1];
 	unsigned int capture_item;
+	unsigned int values_read: 1;	/* value state read from the hw */
 	struct selem_str {
 		unsigned int range: 1;	/* Forced range */
 		unsigned int db_initialized: 1;
 		unsigned int db_init_error: 1;
+		unsigned int db_tbl_error: 1;
 		long min, max;
 		unsigned int channels;
 		long vol[32];
 		unsigned int sw;
 		unsigned int *db_info;
+		int *db_tbl;		/* raw -> dB lookup, built lazily */
+		unsigned int db_tbl_size;
 	} str[2];
 } selem_none_t;
 
+static void free_db_table(struct selem_str *rec);
+
 static const struct mixer_name_table {
 	const char *longname;
 	const char *shortname;
@@ -455,6 +462,7 @@ static int selem_read(snd_mixer_elem_t *elem)
 		}
 	}
       __skip_cswitch:
+	s->values_read = 1;
 
 	if (memcmp(pvol, s->str[SM_PLAY].vol, sizeof(pvol)) ||
 	    psw != s->str[SM_PLAY].sw ||
@@ -464,6 +472,22 @@ static int selem_read(snd_mixer_elem_t *elem)
 	return 0;
 }
 
+/* The value state is populated lazily: snd_mixer_load() only registers
+ * the element and the first value access (or the first value event)
+ * does the actual reads.  Applications enumerating everything behave
+ * as before; applications touching a few elements skip the reads for
+ * all the others. */
+static int selem_read_lazy(snd_mixer_elem_t *elem)
+{
+	selem_none_t *s = snd_mixer_elem_get_private(elem);
+	int err;
+
+	if (s->values_read)
+		return 0;
+	err = selem_read(elem);
+	return err < 0 ? err : 0;
+}
+
 static int elem_write_volume(selem_none_t *s, int dir, selem_ctl_type_t type)
 {
 	snd_ctl_elem_value_t ctl = {0};
@@ -665,6 +689,8 @@ static void selem_free(snd_mixer_elem_t *elem)
 	/* free db range information */
 	free(simple->str[0].db_info);
 	free(simple->str[1].db_info);
+	free(simple->str[0].db_tbl);
+	free(simple->str[1].db_tbl);
 	free(simple);
 }
 
@@ -882,8 +908,11 @@ static int simple_update(snd_mixer_elem_t *melem)
 		simple->str[SM_CAPT].min = cmin != LONG_MAX ? cmin : 0;
 		simple->str[SM_CAPT].max = cmax != LONG_MIN ? cmax : 0;
 	}
+	/* the lookup tables depend on the range; rebuild on demand */
+	free_db_table(&simple->str[SM_PLAY]);
+	free_db_table(&simple->str[SM_CAPT]);
 	return 0;
-}	   
+}
 
 #ifndef DOC_HIDDEN
 static const struct suf {
@@ -1076,6 +1105,7 @@ static int set_range_ops(snd_mixer_elem_t *elem, int dir,
 	s->str[dir].range = 1;
 	s->str[dir].min = min;
 	s->str[dir].max = max;
+	free_db_table(&s->str[dir]);
 	if ((err = selem_read(elem)) < 0)
 		return err;
 	return 0;
@@ -1085,6 +1115,10 @@ static int get_volume_ops(snd_mixer_elem_t *elem, int dir,
 			  snd_mixer_selem_channel_id_t channel, long *value)
 {
 	selem_none_t *s = snd_mixer_elem_get_private(elem);
+	int err;
+
+	if ((err = selem_read_lazy(elem)) < 0)
+		return err;
 	if (s->selem.caps & SM_CAP_GVOLUME)
 		dir = SM_PLAY;
 	if ((unsigned int) channel >= s->str[dir].channels)
@@ -1095,11 +1129,341 @@ static int get_volume_ops(snd_mixer_elem_t *elem, int dir,
 
 static int init_db_range(snd_hctl_elem_t *ctl, struct selem_str *rec);
 
+#ifndef DOC_HIDDEN
+/*
+ * Shared dB-range (TLV) cache
+ *
+ * The dB ranges of a codec never change at runtime, yet every mixer
+ * client re-fetches and re-parses the TLV blob of each volume element.
+ * When defaults.mixer.tlv_cache is enabled, the parsed dB info records
+ * are kept in a per-user file below $XDG_CACHE_HOME/alsa, keyed by a
+ * hash of the card longname, its components and the kernel release, so
+ * later attaches reuse them without any TLV ioctl traffic.
+ */
+
+#define DBCACHE_VERSION		1
+#define DBCACHE_MAX_SIZE	4096
+
+struct dbcache_entry {
+	struct dbcache_entry *next;
+	snd_ctl_elem_id_t id;
+	int size;
+	unsigned int *db_info;
+};
+
+struct dbcache_card {
+	struct dbcache_card *next;
+	char *ctlname;		/* process-local key, e.g. "hw:0" */
+	unsigned int sig;	/* on-disk key */
+	int valid;
+	struct dbcache_entry *entries;
+};
+
+static struct dbcache_card *dbcache_cards;
+
+static int dbcache_enabled(void)
+{
+	static int enabled = -1;
+	snd_config_t *conf;
+
+	if (enabled < 0) {
+		enabled = 0;
+		if (snd_config != NULL &&
+		    snd_config_search(snd_config, "defaults.mixer.tlv_cache",
+				      &conf) >= 0)
+			enabled = snd_config_get_bool(conf) > 0;
+	}
+	return enabled;
+}
+
+static unsigned int dbcache_hash(unsigned int hash, const char *s)
+{
+	while (*s)
+		hash = (hash ^ (unsigned char)*s++) * 16777619U;
+	return hash;
+}
+
+static int dbcache_signature(snd_ctl_t *ctl, unsigned int *sig)
+{
+	snd_ctl_card_info_t info = {0};
+	struct utsname un;
+	unsigned int hash = 2166136261U;
+
+	if (snd_ctl_card_info(ctl, &info) < 0)
+		return -EINVAL;
+	if (uname(&un) < 0)
+		return -errno;
+	hash = dbcache_hash(hash, snd_ctl_card_info_get_longname(&info));
+	hash = dbcache_hash(hash, snd_ctl_card_info_get_components(&info));
+	hash = dbcache_hash(hash, un.release);
+	*sig = hash;
+	return 0;
+}
+
+static void dbcache_load(struct dbcache_card *card)
+{
+	char fname[32], nbuf[64], *path;
+	unsigned int numid, iface, dev, subdev, index, k;
+	struct dbcache_entry *entry;
+	FILE *fp;
+	int version, size;
+
+	snprintf(fname, sizeof(fname), "tlv-%08x", card->sig);
+	if (snd_user_cache_path(fname, 0, &path) < 0)
+		return;
+	fp = fopen(path, "re");
+	free(path);
+	if (fp == NULL)
+		return;
+	if (fscanf(fp, "tlv-cache-%d\n", &version) != 1 ||
+	    version != DBCACHE_VERSION)
+		goto __end;
+	while (fscanf(fp, "%u %u %u %u %u %d %63[^\n]", &numid, &iface, &dev,
+		      &subdev, &index, &size, nbuf) == 7) {
+		if (size <= 0 || size > DBCACHE_MAX_SIZE ||
+		    (size % sizeof(unsigned int)) != 0)
+			break;
+		entry = calloc(1, sizeof(*entry));
+		if (entry == NULL)
+			break;
+		entry->db_info = malloc(size);
+		if (entry->db_info == NULL) {
+			free(entry);
+			break;
+		}
+		for (k = 0; k < size / sizeof(unsigned int); k++)
+			if (fscanf(fp, "%x", &entry->db_info[k]) != 1)
+				break;
+		if (k < size / sizeof(unsigned int)) {
+			free(entry->db_info);
+			free(entry);
+			break;
+		}
+		entry->size = size;
+		entry->id.numid = numid;
+		entry->id.iface = iface;
+		entry->id.device = dev;
+		entry->id.subdevice = subdev;
+		entry->id.index = index;
+		snd_strlcpy((char *)entry->id.name, nbuf,
+			    sizeof(entry->id.name));
+		entry->next = card->entries;
+		card->entries = entry;
+	}
+      __end:
+	fclose(fp);
+}
+
+static void dbcache_save(struct dbcache_card *card)
+{
+	char fname[32], *path, *tmp;
+	struct dbcache_entry *entry;
+	unsigned int k;
+	FILE *fp;
+	int fd, err = 0;
+
+	snprintf(fname, sizeof(fname), "tlv-%08x", card->sig);
+	if (snd_user_cache_path(fname, 1, &path) < 0)
+		return;
+	tmp = malloc(strlen(path) + 8);
+	if (tmp == NULL) {
+		free(path);
+		return;
+	}
+	sprintf(tmp, "%s.XXXXXX", path);
+	fd = mkstemp(tmp);
+	if (fd < 0)
+		goto __end;
+	fp = fdopen(fd, "w");
+	if (fp == NULL) {
+		close(fd);
+		remove(tmp);
+		goto __end;
+	}
+	if (fprintf(fp, "tlv-cache-%d\n", DBCACHE_VERSION) < 0)
+		err = -1;
+	for (entry = card->entries; err == 0 && entry != NULL;
+	     entry = entry->next) {
+		if (fprintf(fp, "%u %u %u %u %u %d %s\n", entry->id.numid,
+			    (unsigned int)entry->id.iface, entry->id.device,
+			    entry->id.subdevice, entry->id.index, entry->size,
+			    entry->id.name) < 0)
+			err = -1;
+		for (k = 0; err == 0 && k < entry->size / sizeof(unsigned int); k++)
+			if (fprintf(fp, "%s%08x",
+				    k > 0 ? " " : "", entry->db_info[k]) < 0)
+				err = -1;
+		if (err == 0 && fprintf(fp, "\n") < 0)
+			err = -1;
+	}
+	if (fclose(fp) != 0)
+		err = -1;
+	/* publish atomically so concurrent mixer clients never see
+	 * a partial record
+	 */
+	if (err == 0)
+		err = rename(tmp, path);
+	if (err != 0)
+		remove(tmp);
+      __end:
+	free(tmp);
+	free(path);
+}
+
+static struct dbcache_card *dbcache_get_card(snd_hctl_elem_t *helem)
+{
+	snd_ctl_t *ctl = snd_hctl_ctl(snd_hctl_elem_get_hctl(helem));
+	const char *name = snd_ctl_name(ctl);
+	struct dbcache_card *card;
+
+	if (name == NULL)
+		return NULL;
+	for (card = dbcache_cards; card != NULL; card = card->next)
+		if (strcmp(card->ctlname, name) == 0)
+			return card->valid ? card : NULL;
+	card = calloc(1, sizeof(*card));
+	if (card == NULL)
+		return NULL;
+	card->ctlname = strdup(name);
+	if (card->ctlname == NULL) {
+		free(card);
+		return NULL;
+	}
+	card->next = dbcache_cards;
+	dbcache_cards = card;
+	if (dbcache_signature(ctl, &card->sig) < 0)
+		return NULL;
+	card->valid = 1;
+	dbcache_load(card);
+	return card;
+}
+
+static int dbcache_id_equal(const snd_ctl_elem_id_t *a,
+			    const snd_ctl_elem_id_t *b)
+{
+	return a->numid == b->numid &&
+	       a->iface == b->iface &&
+	       a->device == b->device &&
+	       a->subdevice == b->subdevice &&
+	       a->index == b->index &&
+	       strncmp((const char *)a->name, (const char *)b->name,
+		       sizeof(a->name)) == 0;
+}
+
+/* look up cached dB info; returns the blob size or -ENOENT */
+static int dbcache_lookup(snd_hctl_elem_t *helem, unsigned int **db_info)
+{
+	struct dbcache_card *card;
+	struct dbcache_entry *entry;
+	snd_ctl_elem_id_t id;
+
+	if (!dbcache_enabled())
+		return -ENOENT;
+	card = dbcache_get_card(helem);
+	if (card == NULL)
+		return -ENOENT;
+	snd_hctl_elem_get_id(helem, &id);
+	for (entry = card->entries; entry != NULL; entry = entry->next) {
+		if (dbcache_id_equal(&entry->id, &id)) {
+			*db_info = entry->db_info;
+			return entry->size;
+		}
+	}
+	return -ENOENT;
+}
+
+static void dbcache_store(snd_hctl_elem_t *helem, const unsigned int *db_info,
+			  int size)
+{
+	struct dbcache_card *card;
+	struct dbcache_entry *entry;
+
+	if (!dbcache_enabled())
+		return;
+	if (size <= 0 || size > DBCACHE_MAX_SIZE ||
+	    (size % sizeof(unsigned int)) != 0)
+		return;
+	card = dbcache_get_card(helem);
+	if (card == NULL)
+		return;
+	entry = calloc(1, sizeof(*entry));
+	if (entry == NULL)
+		return;
+	entry->db_info = malloc(size);
+	if (entry->db_info == NULL) {
+		free(entry);
+		return;
+	}
+	memcpy(entry->db_info, db_info, size);
+	snd_hctl_elem_get_id(helem, &entry->id);
+	entry->size = size;
+	entry->next = card->entries;
+	card->entries = entry;
+	dbcache_save(card);
+}
+#endif /* !DOC_HIDDEN */
+
+static void free_db_table(struct selem_str *rec)
+{
+	free(rec->db_tbl);
+	rec->db_tbl = NULL;
+	rec->db_tbl_size = 0;
+	rec->db_tbl_error = 0;
+}
+
+/* limit the lookup table to sane volume ranges; the rare oddball
+ * control with more steps falls back to the TLV arithmetic */
+#define DB_TBL_MAX_STEPS	4096
+
+/* build the raw -> dB lookup table lazily at the first conversion, so
+ * steady-state conversions (volume meters, UI animation) cost a table
+ * index instead of a TLV record walk */
+static int init_db_table(struct selem_str *rec)
+{
+	long steps = rec->max - rec->min;
+	long db, prev;
+	int *tbl;
+	unsigned int i;
+
+	if (rec->db_tbl)
+		return 0;
+	if (rec->db_tbl_error)
+		return -EINVAL;
+	if (steps < 0 || steps >= DB_TBL_MAX_STEPS)
+		goto error;
+	tbl = malloc((steps + 1) * sizeof(*tbl));
+	if (!tbl)
+		return -ENOMEM;
+	prev = LONG_MIN;
+	for (i = 0; i <= (unsigned int)steps; i++) {
+		if (snd_tlv_convert_to_dB(rec->db_info, rec->min, rec->max,
+					  rec->min + i, &db) < 0 ||
+		    db < prev) {	/* not monotonic, do not trust it */
+			free(tbl);
+			goto error;
+		}
+		tbl[i] = db;
+		prev = db;
+	}
+	rec->db_tbl = tbl;
+	rec->db_tbl_size = steps + 1;
+	return 0;
+
+ error:
+	rec->db_tbl_error = 1;
+	return -EINVAL;
+}
+
 static int convert_to_dB(snd_hctl_elem_t *ctl, struct selem_str *rec,
 			 long volume, long *db_gain)
 {
 	if (init_db_range(ctl, rec) < 0)
 		return -EINVAL;
+	if (volume >= rec->min && volume <= rec->max &&
+	    init_db_table(rec) == 0) {
+		*db_gain = rec->db_tbl[volume - rec->min];
+		return 0;
+	}
 	return snd_tlv_convert_to_dB(rec->db_info, rec->min, rec->max,
 				     volume, db_gain);
 }
@@ -1119,6 +1483,16 @@ static int init_db_range(snd_hctl_elem_t *ctl, struct selem_str *rec)
 	if (rec->db_initialized)
 		return 0;
 
+	db_size = dbcache_lookup(ctl, &dbrec);
+	if (db_size > 0) {
+		rec->db_info = malloc(db_size);
+		if (!rec->db_info)
+			return -ENOMEM;
+		memcpy(rec->db_info, dbrec, db_size);
+		rec->db_initialized = 1;
+		return 0;
+	}
+
 	if (snd_hctl_elem_info(ctl, &info) < 0)
 		goto error;
 	if (!snd_ctl_elem_info_is_tlv_readable(&info))
@@ -1135,6 +1509,7 @@ static int init_db_range(snd_hctl_elem_t *ctl, struct selem_str *rec)
 	if (!rec->db_info)
 		goto error;
 	memcpy(rec->db_info, dbrec, db_size);
+	dbcache_store(ctl, dbrec, db_size);
 	free(tlv);
 	rec->db_initialized = 1;
 	return 0;
@@ -1195,6 +1570,31 @@ static int convert_from_dB(snd_hctl_elem_t *ctl, struct selem_str *rec,
 	if (init_db_range(ctl, rec) < 0)
 		return -EINVAL;
 
+	/* the round-to-nearest mode applies type specific arithmetic
+	 * (mute markers, sub-range gaps) that the table cannot
+	 * reproduce; the directional roundings used by the set_dB
+	 * callers map exactly to a binary search */
+	if (xdir != 0 && init_db_table(rec) == 0) {
+		/* first raw value whose dB gain is not below db_gain */
+		unsigned int lo = 0, hi = rec->db_tbl_size;
+
+		while (lo < hi) {
+			unsigned int mid = (lo + hi) / 2;
+			if ((long)rec->db_tbl[mid] < db_gain)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		if (lo >= rec->db_tbl_size)		/* above the range */
+			*value = rec->max;
+		else if ((long)rec->db_tbl[lo] == db_gain || xdir > 0)
+			*value = rec->min + lo;
+		else if (lo > 0)
+			*value = rec->min + lo - 1;
+		else
+			*value = rec->min;
+		return 0;
+	}
 	return snd_tlv_convert_from_dB(rec->db_info, rec->min, rec->max,
 				       db_gain, value, xdir);
 }
@@ -1243,6 +1643,10 @@ static int get_switch_ops(snd_mixer_elem_t *elem, int dir,
 			  snd_mixer_selem_channel_id_t channel, int *value)
 {
 	selem_none_t *s = snd_mixer_elem_get_private(elem);
+	int err;
+
+	if ((err = selem_read_lazy(elem)) < 0)
+		return err;
 	if (s->selem.caps & SM_CAP_GSWITCH)
 		dir = SM_PLAY;
 	if ((unsigned int) channel >= s->str[dir].channels)
@@ -1255,6 +1659,10 @@ static int set_volume_ops(snd_mixer_elem_t *elem, int dir,
 			  snd_mixer_selem_channel_id_t channel, long value)
 {
 	int changed;
+	int err;
+
+	if ((err = selem_read_lazy(elem)) < 0)
+		return err;
 	changed = _snd_mixer_selem_set_volume(elem, dir, channel, value);
 	if (changed < 0)
 		return changed;
@@ -1301,7 +1709,11 @@ static int set_switch_ops(snd_mixer_elem_t *elem, int dir,
 			  snd_mixer_selem_channel_id_t channel, int value)
 {
 	int changed;
+	int err;
 	selem_none_t *s = snd_mixer_elem_get_private(elem);
+
+	if ((err = selem_read_lazy(elem)) < 0)
+		return err;
 	if (s->selem.caps & SM_CAP_GSWITCH)
 		dir = SM_PLAY;
 	if (dir == SM_PLAY) {
@@ -1601,12 +2013,10 @@ static int simple_add1(snd_mixer_class_t *class, const char *name,
 		err = snd_mixer_elem_info(melem);
 	if (err < 0)
 		return err;
-	err = selem_read(melem);
-	if (err < 0)
-		return err;
-	if (err)
-		err = snd_mixer_elem_value(melem);
-	return err;
+	/* the value reads are deferred to the first access or the first
+	 * value event (see selem_read_lazy) */
+	simple->values_read = 0;
+	return 0;
       __error:
 	if (new)
 		snd_mixer_elem_free(melem);
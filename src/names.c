@@ -35,9 +35,13 @@
 #include <limits.h>
 #include <sys/stat.h>
 
-/** 
+/**
  * \brief This function is unimplemented.
  * \deprecated Since 1.0.14
+ *
+ * Use #snd_device_name_hint instead; its results may additionally be
+ * served from the persistent hint cache (defaults.namehint.cache), so
+ * repeated queries do not re-parse the configuration.
  */
 int snd_names_list(const char *iface ATTRIBUTE_UNUSED,
 		   snd_devname_t **list ATTRIBUTE_UNUSED)
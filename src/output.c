@@ -235,12 +235,16 @@ typedef struct _snd_output_buffer {
 	unsigned char *buf;
 	size_t alloc;
 	size_t size;
+	/* the buffer was handed in by the caller (snd_output_buffer_attach)
+	 * and must not be freed or realloc'ed */
+	int borrowed;
 } snd_output_buffer_t;
 
 static int snd_output_buffer_close(snd_output_t *output)
 {
 	snd_output_buffer_t *buffer = output->private_data;
-	free(buffer->buf);
+	if (!buffer->borrowed)
+		free(buffer->buf);
 	free(buffer);
 	return 0;
 }
@@ -263,9 +267,18 @@ static int snd_output_buffer_need(snd_output_t *output, size_t size)
 		alloc = buffer->alloc;
 	while (alloc < buffer->size + size)
 		alloc *= 2;
-	buf = realloc(buffer->buf, alloc);
-	if (!buf)
-		return -ENOMEM;
+	if (buffer->borrowed) {
+		/* the arena overflowed - move to an owned buffer */
+		buf = malloc(alloc);
+		if (!buf)
+			return -ENOMEM;
+		memcpy(buf, buffer->buf, buffer->size);
+		buffer->borrowed = 0;
+	} else {
+		buf = realloc(buffer->buf, alloc);
+		if (!buf)
+			return -ENOMEM;
+	}
 	buffer->buf = buf;
 	buffer->alloc = alloc;
 	return buffer->alloc - buffer->size;
@@ -274,23 +287,31 @@ static int snd_output_buffer_need(snd_output_t *output, size_t size)
 static int snd_output_buffer_print(snd_output_t *output, const char *format, va_list args)
 {
 	snd_output_buffer_t *buffer = output->private_data;
-	size_t size = 256;
-	int result;
-	result = snd_output_buffer_need(output, size);
-	if (result < 0)
-		return result;
-	result = vsnprintf((char *)buffer->buf + buffer->size, size, format, args);
+	va_list args1;
+	int result, avail;
+
+	/* format into the present free space when reasonably large; only
+	 * tight buffers (or a truncated result below) force a growth */
+	avail = buffer->alloc - buffer->size;
+	if (avail < 64) {
+		avail = snd_output_buffer_need(output, 255);
+		if (avail < 0)
+			return avail;
+	}
+	va_copy(args1, args);
+	result = vsnprintf((char *)buffer->buf + buffer->size, avail, format, args1);
+	va_end(args1);
 	assert(result >= 0);
-	if ((size_t)result <= size) {
+	if (result < avail) {
 		buffer->size += result;
 		return result;
 	}
-	size = result;
-	result = snd_output_buffer_need(output, size);
-	if (result < 0)
-		return result;
-	result = vsnprintf((char *)buffer->buf + buffer->size, result, format, args);
-	assert(result == (int)size);
+	/* the first attempt was truncated, but returned the full length */
+	avail = snd_output_buffer_need(output, result);
+	if (avail < 0)
+		return avail;
+	result = vsnprintf((char *)buffer->buf + buffer->size, avail, format, args);
+	assert(result >= 0 && result < avail);
 	buffer->size += result;
 	return result;
 }
@@ -368,12 +389,77 @@ size_t snd_output_buffer_steal(snd_output_t *output, char **buf)
 	size_t size;
 	*buf = (char *)buffer->buf;
 	size = buffer->size;
+	if (buffer->borrowed) {
+		/* the data lives in the caller's arena - hand out an
+		 * owned copy so free() stays valid for the caller */
+		*buf = malloc(size + 1);
+		if (*buf == NULL)
+			return 0;
+		memcpy(*buf, buffer->buf, size);
+		(*buf)[size] = '\0';
+		buffer->size = 0;
+		return size;
+	}
 	buffer->buf = NULL;
 	buffer->alloc = 0;
 	buffer->size = 0;
 	return size;
 }
 
+/**
+ * \brief Reserves writable space in a #SND_OUTPUT_BUFFER output handle.
+ * \param output The output handle.
+ * \param size The number of bytes to make available.
+ * \param buf The function puts the address of the writable area at the
+ *            address specified by \p buf.
+ * \return The number of writable bytes (at least \p size) if successful,
+ *         otherwise a negative error code.
+ *
+ * The caller may format data directly into the returned area and make
+ * it part of the buffer contents with #snd_output_buffer_commit,
+ * avoiding the intermediate copy of #snd_output_puts.  The area is
+ * only valid until the next output function is called on the handle.
+ */
+int snd_output_buffer_reserve(snd_output_t *output, size_t size, char **buf)
+{
+	snd_output_buffer_t *buffer;
+	int avail;
+
+	assert(output && buf);
+	if (output->type != SND_OUTPUT_BUFFER)
+		return -EINVAL;
+	avail = snd_output_buffer_need(output, size);
+	if (avail < 0)
+		return avail;
+	buffer = output->private_data;
+	*buf = (char *)buffer->buf + buffer->size;
+	return avail;
+}
+
+/**
+ * \brief Commits bytes written into a reserved area.
+ * \param output The output handle.
+ * \param size The number of bytes written into the area obtained with
+ *             #snd_output_buffer_reserve.
+ * \return Zero if successful, otherwise a negative error code.
+ *
+ * \p size may be smaller than the reserved size (up to it); committing
+ * more than the reservation is refused.
+ */
+int snd_output_buffer_commit(snd_output_t *output, size_t size)
+{
+	snd_output_buffer_t *buffer;
+
+	assert(output);
+	if (output->type != SND_OUTPUT_BUFFER)
+		return -EINVAL;
+	buffer = output->private_data;
+	if (size > buffer->alloc - buffer->size)
+		return -EINVAL;
+	buffer->size += size;
+	return 0;
+}
+
 /**
  * \brief Creates a new output object with an auto-extending memory buffer.
  * \param outputp The function puts the pointer to the new output object
@@ -402,3 +488,44 @@ int snd_output_buffer_open(snd_output_t **outputp)
 	*outputp = output;
 	return 0;
 }
+
+/**
+ * \brief Creates a new output object writing to a preallocated buffer.
+ * \param outputp The function puts the pointer to the new output object
+ *                at the address specified by \p outputp.
+ * \param buf The caller's buffer receiving the output.
+ * \param size The size of the buffer.
+ * \return Zero if successful, otherwise a negative error code.
+ *
+ * The output behaves like #snd_output_buffer_open but uses the given
+ * arena instead of allocating one, so dumps with a known size bound
+ * run without any allocation.  When the arena overflows, the contents
+ * are moved into an internally allocated buffer and the handle keeps
+ * working; the arena itself is never freed and stays owned by the
+ * caller, who must keep it valid until #snd_output_close.  Use
+ * #snd_output_buffer_string to find out where the data finally is.
+ */
+int snd_output_buffer_attach(snd_output_t **outputp, char *buf, size_t size)
+{
+	snd_output_t *output;
+	snd_output_buffer_t *buffer;
+
+	assert(outputp && buf);
+	buffer = calloc(1, sizeof(*buffer));
+	if (!buffer)
+		return -ENOMEM;
+	output = calloc(1, sizeof(*output));
+	if (!output) {
+		free(buffer);
+		return -ENOMEM;
+	}
+	buffer->buf = (unsigned char *)buf;
+	buffer->alloc = size;
+	buffer->size = 0;
+	buffer->borrowed = 1;
+	output->type = SND_OUTPUT_BUFFER;
+	output->ops = &snd_output_buffer_ops;
+	output->private_data = buffer;
+	*outputp = output;
+	return 0;
+}
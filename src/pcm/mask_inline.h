@@ -32,6 +32,9 @@
 
 MASK_INLINE unsigned int ld2(uint32_t v)
 {
+#ifdef __GNUC__
+        return 31 - __builtin_clz(v);
+#else
         unsigned r = 0;
 
         if (v >= 0x10000) {
@@ -53,15 +56,20 @@ MASK_INLINE unsigned int ld2(uint32_t v)
         if (v >= 2)
                 r++;
         return r;
+#endif
 }
 
 MASK_INLINE unsigned int hweight32(uint32_t v)
 {
+#ifdef __GNUC__
+        return __builtin_popcount(v);
+#else
         v = (v & 0x55555555) + ((v >> 1) & 0x55555555);
         v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
         v = (v & 0x0F0F0F0F) + ((v >> 4) & 0x0F0F0F0F);
         v = (v & 0x00FF00FF) + ((v >> 8) & 0x00FF00FF);
         return (v & 0x0000FFFF) + ((v >> 16) & 0x0000FFFF);
+#endif
 }
 
 MASK_INLINE size_t snd_mask_sizeof(void)
@@ -139,20 +147,31 @@ MASK_INLINE void snd_mask_reset(snd_mask_t *mask, unsigned int val)
 	mask->bits[MASK_OFS(val)] &= ~MASK_BIT(val);
 }
 
+/* bits covered by [from, to] in the word i of the mask */
+MASK_INLINE uint32_t snd_mask_range_word(unsigned int i, unsigned int from, unsigned int to)
+{
+	uint32_t w = 0xffffffff;
+	if (i == MASK_OFS(from))
+		w &= ~(MASK_BIT(from) - 1);
+	if (i == MASK_OFS(to))
+		w &= (MASK_BIT(to) - 1) | MASK_BIT(to);
+	return w;
+}
+
 MASK_INLINE void snd_mask_set_range(snd_mask_t *mask, unsigned int from, unsigned int to)
 {
 	unsigned int i;
 	assert(to <= SND_MASK_MAX && from <= to);
-	for (i = from; i <= to; i++)
-		mask->bits[MASK_OFS(i)] |= MASK_BIT(i);
+	for (i = MASK_OFS(from); i <= MASK_OFS(to); i++)
+		mask->bits[i] |= snd_mask_range_word(i, from, to);
 }
 
 MASK_INLINE void snd_mask_reset_range(snd_mask_t *mask, unsigned int from, unsigned int to)
 {
 	unsigned int i;
 	assert(to <= SND_MASK_MAX && from <= to);
-	for (i = from; i <= to; i++)
-		mask->bits[MASK_OFS(i)] &= ~MASK_BIT(i);
+	for (i = MASK_OFS(from); i <= MASK_OFS(to); i++)
+		mask->bits[i] &= ~snd_mask_range_word(i, from, to);
 }
 
 MASK_INLINE void snd_mask_leave(snd_mask_t *mask, unsigned int val)
@@ -212,14 +231,23 @@ MASK_INLINE int snd_mask_single(const snd_mask_t *mask)
 
 MASK_INLINE int snd_mask_refine(snd_mask_t *mask, const snd_mask_t *v)
 {
-	snd_mask_t old;
+	uint32_t left = 0, changed = 0;
+	int i;
 	if (snd_mask_empty(mask))
 		return -ENOENT;
-	snd_mask_copy(&old, mask);
-	snd_mask_intersect(mask, v);
-	if (snd_mask_empty(mask))
+	/* intersect and detect the change in one pass over the words
+	 * instead of copy + intersect + compare; the plain word loop
+	 * also vectorizes */
+	for (i = 0; i < MASK_SIZE; i++) {
+		uint32_t o = mask->bits[i];
+		uint32_t n = o & v->bits[i];
+		mask->bits[i] = n;
+		left |= n;
+		changed |= o ^ n;
+	}
+	if (!left)
 		return -EINVAL;
-	return !snd_mask_eq(mask, &old);
+	return changed != 0;
 }
 
 MASK_INLINE int snd_mask_refine_first(snd_mask_t *mask)
@@ -679,6 +679,7 @@ playback devices.
 #include <ctype.h>
 #include <poll.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
 #include <limits.h>
 
 #ifndef DOC_HIDDEN
@@ -723,6 +724,81 @@ static int bad_pcm_state(snd_pcm_t *pcm, unsigned int supported_states,
 		return err;
 	return -EBADFD;
 }
+
+/*
+ * open-path phase tracing (see snd_pcm_open_trace_enable(); the
+ * ALSA_PCM_OPEN_TRACE environment variable additionally dumps the
+ * phases to stderr); kept per thread since opens of independent
+ * handles may run concurrently
+ */
+#ifdef HAVE___THREAD
+#define TLS_PFX		__thread
+#else
+#define TLS_PFX		/* NOP */
+#endif
+
+#define OPEN_TRACE_PHASES	64
+#define OPEN_TRACE_NAMELEN	64
+
+static TLS_PFX struct {
+	int mode;	/* -1 = check the environment, 0 = off,
+			 * 1 = collect, 2 = collect and dump */
+	int depth;	/* nesting of traced plugin opens */
+	unsigned int count;
+	unsigned int dumped;	/* entries already written to stderr */
+	struct {
+		char name[OPEN_TRACE_NAMELEN];
+		unsigned int depth;
+		unsigned long long nsec;
+	} phase[OPEN_TRACE_PHASES];
+} open_trace = { .mode = -1 };
+
+static int open_trace_active(void)
+{
+	if (open_trace.mode < 0) {
+		const char *e = getenv("ALSA_PCM_OPEN_TRACE");
+		open_trace.mode = e && *e && strcmp(e, "0") != 0 ? 2 : 0;
+	}
+	return open_trace.mode;
+}
+
+static unsigned long long open_trace_now(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0)
+		return 0;
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void open_trace_log(const char *phase, const char *object,
+			   unsigned long long start)
+{
+	unsigned int i = open_trace.count;
+
+	if (i >= OPEN_TRACE_PHASES)
+		return;
+	snprintf(open_trace.phase[i].name, OPEN_TRACE_NAMELEN, "%s:%s",
+		 phase, object ? object : "");
+	open_trace.phase[i].depth = open_trace.depth;
+	open_trace.phase[i].nsec = open_trace_now() - start;
+	open_trace.count = i + 1;
+}
+
+static void open_trace_dump(void)
+{
+	unsigned int i;
+
+	if (open_trace.mode != 2)
+		return;
+	for (i = open_trace.dumped; i < open_trace.count; i++)
+		fprintf(stderr, "ALSA open trace: %*s%-24s %llu.%03llu us\n",
+			open_trace.phase[i].depth * 2, "",
+			open_trace.phase[i].name,
+			open_trace.phase[i].nsec / 1000,
+			open_trace.phase[i].nsec % 1000);
+	open_trace.dumped = open_trace.count;
+}
 #endif
 
 /**
@@ -951,11 +1027,22 @@ int snd_pcm_hw_params_current(snd_pcm_t *pcm, snd_pcm_hw_params_t *params)
 int snd_pcm_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t *params)
 {
 	int err;
+	unsigned long long trace_t = 0;
+	int tracing = open_trace_active();
+
 	assert(pcm && params);
+	if (tracing)
+		trace_t = open_trace_now();
 	err = _snd_pcm_hw_params_internal(pcm, params);
 	if (err < 0)
 		return err;
+	pcm->poll_gen++;
+	pcm->rewindable_valid = pcm->forwardable_valid = 0;
 	err = snd_pcm_prepare(pcm);
+	if (tracing) {
+		open_trace_log("hw_params", pcm->name, trace_t);
+		open_trace_dump();
+	}
 	return err;
 }
 
@@ -982,6 +1069,14 @@ int snd_pcm_hw_free(snd_pcm_t *pcm)
 	else
 		err = -ENOSYS;
 	pcm->setup = 0;
+	pcm->poll_gen++;
+	pcm->rewindable_valid = pcm->forwardable_valid = 0;
+	/* the tuning bounds were validated against the dropped setup */
+	pcm->autotune_enabled = 0;
+	pcm->autotune.pending = 0;
+	/* the full configuration space may widen again */
+	free(pcm->hw_params_any_cache);
+	pcm->hw_params_any_cache = NULL;
 	if (err < 0)
 		return err;
 	return 0;
@@ -1034,6 +1129,7 @@ int snd_pcm_sw_params(snd_pcm_t *pcm, snd_pcm_sw_params_t *params)
 	pcm->period_step = params->period_step;
 	pcm->avail_min = params->avail_min;
 	pcm->period_event = sw_get_period_event(params);
+	pcm->wait_spin_us = sw_get_wait_spin_us(params);
 	pcm->start_threshold = params->start_threshold;
 	pcm->stop_threshold = params->stop_threshold;
 	pcm->silence_threshold = params->silence_threshold;
@@ -1043,6 +1139,45 @@ int snd_pcm_sw_params(snd_pcm_t *pcm, snd_pcm_sw_params_t *params)
 	return 0;
 }
 
+/**
+ * \brief Install both PCM hardware and software configuration in one pass
+ * \param pcm PCM handle
+ * \param params Hardware configuration container
+ * \param swparams Software configuration container, or NULL to keep the
+ *        defaults chosen by the hardware configuration
+ * \return 0 on success otherwise a negative error code
+ *
+ * Combines #snd_pcm_hw_params() and #snd_pcm_sw_params() into a single
+ * configuration pass: the hardware parameters are installed, the
+ * software parameters applied on top, and the stream is brought to
+ * #SND_PCM_STATE_PREPARED.  Compared to the separate calls this avoids
+ * the intermediate prepare between the two steps, so each layer of a
+ * plugin chain sees the final configuration at prepare time and the
+ * open path issues fewer configuration syscalls.
+ *
+ * A non-NULL \a swparams must be completely filled, e.g. saved with
+ * #snd_pcm_sw_params_current() from a previously configured stream
+ * with the same hardware parameters.
+ */
+int snd_pcm_configure(snd_pcm_t *pcm, snd_pcm_hw_params_t *params,
+		      snd_pcm_sw_params_t *swparams)
+{
+	int err;
+
+	assert(pcm && params);
+	err = _snd_pcm_hw_params_internal(pcm, params);
+	if (err < 0)
+		return err;
+	pcm->poll_gen++;
+	pcm->rewindable_valid = pcm->forwardable_valid = 0;
+	if (swparams) {
+		err = snd_pcm_sw_params(pcm, swparams);
+		if (err < 0)
+			return err;
+	}
+	return snd_pcm_prepare(pcm);
+}
+
 /**
  * \brief Obtain status (runtime) information for PCM handle
  * \param pcm PCM handle
@@ -1066,6 +1201,41 @@ int snd_pcm_status(snd_pcm_t *pcm, snd_pcm_status_t *status)
 	return err;
 }
 
+/**
+ * \brief Obtain status information for many PCM handles at once
+ * \param pcms Array of PCM handles
+ * \param statuses Array of status containers, one per handle
+ * \param count Number of handles
+ * \return 0 on success otherwise the first negative error code
+ *
+ * Queries all handles in one pass, which is the preferred way for
+ * monitoring loops sampling a large number of streams periodically.
+ * Handles whose mapped status view has not changed since their last
+ * query (state, pointers and timestamp all unchanged) are answered
+ * from the cached previous result without entering the kernel, so
+ * the per-tick cost scales with the number of streams that actually
+ * moved rather than with the number of handles.
+ *
+ * On error the remaining handles are not queried and the contents of
+ * their status containers are undefined.  Combined with
+ * #snd_pcm_waitset_wait() a control plane can sleep on all streams
+ * and then collect their states with a single call.
+ */
+int snd_pcm_status_many(snd_pcm_t **pcms, snd_pcm_status_t **statuses,
+			unsigned int count)
+{
+	unsigned int i;
+	int err;
+
+	assert(pcms && statuses);
+	for (i = 0; i < count; ++i) {
+		err = snd_pcm_status(pcms[i], statuses[i]);
+		if (err < 0)
+			return err;
+	}
+	return 0;
+}
+
 /**
  * \brief Return PCM state
  * \param pcm PCM handle
@@ -1225,6 +1395,52 @@ int snd_pcm_htimestamp(snd_pcm_t *pcm, snd_pcm_uframes_t *avail, snd_htimestamp_
 	return err;
 }
 
+/**
+ * \brief Obtain last position update timestamps including the audio timestamp
+ * \param pcm PCM handle
+ * \param avail Number of available frames when the timestamps were grabbed
+ * \param tstamp System hi-res timestamp of the last position update
+ * \param audio_tstamp Audio hi-res timestamp of the last position update
+ * \return 0 on success otherwise a negative error code
+ *
+ * Like #snd_pcm_htimestamp, but additionally reports the audio
+ * timestamp (sample counter or wall clock, depending on the driver).
+ * In the hw backend both stamps come from the mmap'd status page, so
+ * a periodic AV-sync query costs memory loads instead of a status
+ * ioctl per call.  Backends without the fast path, and configurations
+ * asking for link-estimated audio timestamp types, report through
+ * #snd_pcm_status.
+ *
+ * The function is thread-safe when built with the proper option.
+ */
+int snd_pcm_audio_htimestamp(snd_pcm_t *pcm, snd_pcm_uframes_t *avail,
+			     snd_htimestamp_t *tstamp,
+			     snd_htimestamp_t *audio_tstamp)
+{
+	snd_pcm_status_t status = {0};
+	int err;
+
+	assert(pcm && avail && tstamp && audio_tstamp);
+	if (CHECK_SANITY(! pcm->setup)) {
+		SNDMSG("PCM not set up");
+		return -EIO;
+	}
+	if (pcm->fast_ops->audio_htimestamp) {
+		snd_pcm_lock(pcm->fast_op_arg);
+		err = pcm->fast_ops->audio_htimestamp(pcm->fast_op_arg, avail,
+						      tstamp, audio_tstamp);
+		snd_pcm_unlock(pcm->fast_op_arg);
+		return err;
+	}
+	err = snd_pcm_status(pcm, &status);
+	if (err < 0)
+		return err;
+	*avail = status.avail;
+	*tstamp = status.tstamp;
+	*audio_tstamp = status.audio_tstamp;
+	return 0;
+}
+
 /**
  * \brief Prepare PCM for use
  * \param pcm PCM handle
@@ -1250,6 +1466,7 @@ int snd_pcm_prepare(snd_pcm_t *pcm)
 	else
 		err = -ENOSYS;
 	snd_pcm_unlock(pcm->fast_op_arg);
+	snd_trace2(pcm_prepare, pcm, err);
 	return err;
 }
 
@@ -1302,6 +1519,7 @@ int snd_pcm_start(snd_pcm_t *pcm)
 	snd_pcm_lock(pcm->fast_op_arg);
 	err = __snd_pcm_start(pcm);
 	snd_pcm_unlock(pcm->fast_op_arg);
+	snd_trace2(pcm_start, pcm, err);
 	return err;
 }
 
@@ -1337,6 +1555,7 @@ int snd_pcm_drop(snd_pcm_t *pcm)
 	else
 		err = -ENOSYS;
 	snd_pcm_unlock(pcm->fast_op_arg);
+	snd_trace2(pcm_drop, pcm, err);
 	return err;
 }
 
@@ -1374,9 +1593,51 @@ int snd_pcm_drain(snd_pcm_t *pcm)
 		err = pcm->fast_ops->drain(pcm->fast_op_arg);
 	else
 		err = -ENOSYS;
+	snd_trace2(pcm_drain, pcm, err);
 	return err;
 }
 
+/**
+ * \brief Stop a PCM preserving pending frames, without blocking
+ * \param pcm PCM handle
+ * \return 0 when the drain completed, -EAGAIN when draining continues
+ *         in the background, otherwise a negative error code
+ *
+ * Like #snd_pcm_drain(), but the call returns immediately instead of
+ * waiting for all pending frames to be played.  As long as -EAGAIN is
+ * returned the stream stays in #SND_PCM_STATE_DRAINING; wait on the
+ * handle's poll descriptors, which wake up when the stream makes
+ * progress, and call this function again until it returns zero.  This
+ * way a single event loop can overlap the drain of many streams with
+ * other work instead of blocking one thread per draining stream.
+ *
+ * The blocking mode of the handle is left unchanged.
+ *
+ * The function is thread-safe when built with the proper option.
+ */
+int snd_pcm_drain_nowait(snd_pcm_t *pcm)
+{
+	int nonblock, err, res;
+
+	assert(pcm);
+	if (CHECK_SANITY(! pcm->setup)) {
+		SNDMSG("PCM not set up");
+		return -EIO;
+	}
+	nonblock = !!(pcm->mode & SND_PCM_NONBLOCK);
+	if (!nonblock) {
+		err = snd_pcm_nonblock(pcm, 1);
+		if (err < 0)
+			return err;
+	}
+	res = snd_pcm_drain(pcm);
+	if (!nonblock)
+		snd_pcm_nonblock(pcm, 0);
+	if (res == 0 && snd_pcm_state(pcm) == SND_PCM_STATE_DRAINING)
+		res = -EAGAIN;
+	return res;
+}
+
 /**
  * \brief Pause/resume PCM
  * \param pcm PCM handle
@@ -1407,6 +1668,7 @@ int snd_pcm_pause(snd_pcm_t *pcm, int enable)
 	else
 		err = -ENOSYS;
 	snd_pcm_unlock(pcm->fast_op_arg);
+	snd_trace3(pcm_pause, pcm, enable, err);
 	return err;
 }
 
@@ -1419,6 +1681,10 @@ int snd_pcm_pause(snd_pcm_t *pcm, int enable)
  * by this function. But it is not guaranteed that output stream
  * will be consistent with bigger value.
  *
+ * The result is derived from the application and hardware pointers
+ * fetched by the last pointer update and is cached until they move,
+ * so repeated queries are cheap.
+ *
  * The function is thread-safe when built with the proper option.
  */
 snd_pcm_sframes_t snd_pcm_rewindable(snd_pcm_t *pcm)
@@ -1435,9 +1701,25 @@ snd_pcm_sframes_t snd_pcm_rewindable(snd_pcm_t *pcm)
 	if (err < 0)
 		return err;
 	snd_pcm_lock(pcm->fast_op_arg);
-	if (pcm->fast_ops->rewindable)
+	/* the horizon only moves with the pointers; answer from the cache
+	 * without re-walking the chain while they are unchanged */
+	if (pcm->rewindable_valid &&
+	    pcm->horizon_appl == *pcm->appl.ptr &&
+	    pcm->horizon_hw == *pcm->hw.ptr) {
+		result = pcm->rewindable_cache;
+	} else if (pcm->fast_ops->rewindable) {
 		result = pcm->fast_ops->rewindable(pcm->fast_op_arg);
-	else
+		if (result >= 0) {
+			if (pcm->horizon_appl != *pcm->appl.ptr ||
+			    pcm->horizon_hw != *pcm->hw.ptr) {
+				pcm->horizon_appl = *pcm->appl.ptr;
+				pcm->horizon_hw = *pcm->hw.ptr;
+				pcm->forwardable_valid = 0;
+			}
+			pcm->rewindable_cache = result;
+			pcm->rewindable_valid = 1;
+		}
+	} else
 		result = -ENOSYS;
 	snd_pcm_unlock(pcm->fast_op_arg);
 	return result;
@@ -1485,6 +1767,10 @@ snd_pcm_sframes_t snd_pcm_rewind(snd_pcm_t *pcm, snd_pcm_uframes_t frames)
  * by this function. But it is not guaranteed that output stream
  * will be consistent with bigger value.
  *
+ * The result is derived from the application and hardware pointers
+ * fetched by the last pointer update and is cached until they move,
+ * so repeated queries are cheap.
+ *
  * The function is thread-safe when built with the proper option.
  */
 snd_pcm_sframes_t snd_pcm_forwardable(snd_pcm_t *pcm)
@@ -1501,9 +1787,24 @@ snd_pcm_sframes_t snd_pcm_forwardable(snd_pcm_t *pcm)
 	if (err < 0)
 		return err;
 	snd_pcm_lock(pcm->fast_op_arg);
-	if (pcm->fast_ops->forwardable)
+	/* see snd_pcm_rewindable() for the caching scheme */
+	if (pcm->forwardable_valid &&
+	    pcm->horizon_appl == *pcm->appl.ptr &&
+	    pcm->horizon_hw == *pcm->hw.ptr) {
+		result = pcm->forwardable_cache;
+	} else if (pcm->fast_ops->forwardable) {
 		result = pcm->fast_ops->forwardable(pcm->fast_op_arg);
-	else
+		if (result >= 0) {
+			if (pcm->horizon_appl != *pcm->appl.ptr ||
+			    pcm->horizon_hw != *pcm->hw.ptr) {
+				pcm->horizon_appl = *pcm->appl.ptr;
+				pcm->horizon_hw = *pcm->hw.ptr;
+				pcm->rewindable_valid = 0;
+			}
+			pcm->forwardable_cache = result;
+			pcm->forwardable_valid = 1;
+		}
+	} else
 		result = -ENOSYS;
 	snd_pcm_unlock(pcm->fast_op_arg);
 	return result;
@@ -1741,6 +2042,98 @@ int snd_pcm_unlink(snd_pcm_t *pcm)
 	return err;
 }
 
+/**
+ * \brief Prepare a group of PCMs for use
+ * \param pcms Array of PCM handles
+ * \param count Number of PCM handles
+ * \return 0 on success otherwise a negative error code
+ *
+ * Equivalent to calling #snd_pcm_prepare for every handle in order;
+ * the first failure aborts the pass and is returned.
+ */
+int snd_pcm_group_prepare(snd_pcm_t **pcms, unsigned int count)
+{
+	unsigned int i;
+	int err;
+
+	assert(pcms);
+	for (i = 0; i < count; i++) {
+		err = snd_pcm_prepare(pcms[i]);
+		if (err < 0)
+			return err;
+	}
+	return 0;
+}
+
+/**
+ * \brief Start a group of PCMs together
+ * \param pcms Array of PCM handles
+ * \param count Number of PCM handles (greater than zero)
+ * \return 0 on success otherwise a negative error code
+ *
+ * The handles are temporarily linked to the first one where the
+ * backend supports it (see #snd_pcm_link), so that subset is started
+ * atomically by a single start ioctl with sample-accurate alignment.
+ * Handles that cannot be linked (e.g. software plugins) are started
+ * back to back immediately afterwards.  Link groups set up by the
+ * application are left untouched.
+ */
+int snd_pcm_group_start(snd_pcm_t **pcms, unsigned int count)
+{
+	char *linked;
+	unsigned int i;
+	int err;
+
+	assert(pcms);
+	if (count == 0)
+		return -EINVAL;
+	if (count == 1)
+		return snd_pcm_start(pcms[0]);
+	linked = calloc(count, sizeof(*linked));
+	if (linked == NULL)
+		return -ENOMEM;
+	for (i = 1; i < count; i++)
+		linked[i] = snd_pcm_link(pcms[0], pcms[i]) >= 0;
+	err = snd_pcm_start(pcms[0]);
+	for (i = 1; err >= 0 && i < count; i++) {
+		if (linked[i] ||
+		    snd_pcm_state(pcms[i]) == SND_PCM_STATE_RUNNING)
+			continue;
+		err = snd_pcm_start(pcms[i]);
+	}
+	/* restore the previous link state */
+	for (i = 1; i < count; i++)
+		if (linked[i])
+			snd_pcm_unlink(pcms[i]);
+	free(linked);
+	return err;
+}
+
+/**
+ * \brief Drain a group of PCMs
+ * \param pcms Array of PCM handles
+ * \param count Number of PCM handles
+ * \return 0 on success otherwise the first negative error code
+ *
+ * Calls #snd_pcm_drain for every handle; the streams keep playing
+ * concurrently while earlier handles are waited for, so the total
+ * time is bounded by the slowest stream.  Draining continues over
+ * failed handles and the first error is returned.
+ */
+int snd_pcm_group_drain(snd_pcm_t **pcms, unsigned int count)
+{
+	unsigned int i;
+	int err = 0, e;
+
+	assert(pcms);
+	for (i = 0; i < count; i++) {
+		e = snd_pcm_drain(pcms[i]);
+		if (e < 0 && err == 0)
+			err = e;
+	}
+	return err;
+}
+
 /* locked version */
 static int __snd_pcm_poll_descriptors_count(snd_pcm_t *pcm)
 {
@@ -1771,19 +2164,47 @@ int snd_pcm_poll_descriptors_count(snd_pcm_t *pcm)
 static int __snd_pcm_poll_descriptors(snd_pcm_t *pcm, struct pollfd *pfds,
 				      unsigned int space)
 {
-	if (pcm->fast_ops->poll_descriptors)
-		return pcm->fast_ops->poll_descriptors(pcm->fast_op_arg, pfds, space);
-	if (pcm->poll_fd < 0) {
-		SNDMSG("poll_fd < 0");
-		return -EIO;
-	}
-	if (space >= 1 && pfds) {
-		pfds->fd = pcm->poll_fd;
-		pfds->events = pcm->poll_events | POLLERR | POLLNVAL;
+	int count;
+
+	/* the descriptor set only changes on reconfiguration; serve the
+	 * cached copy while the generation matches */
+	if (pcm->poll_cache && !pcm->poll_dynamic &&
+	    pcm->poll_cache_gen == pcm->poll_gen &&
+	    space >= pcm->poll_cache_count && pfds) {
+		memcpy(pfds, pcm->poll_cache,
+		       pcm->poll_cache_count * sizeof(*pfds));
+		return pcm->poll_cache_count;
+	}
+	if (pcm->fast_ops->poll_descriptors) {
+		count = pcm->fast_ops->poll_descriptors(pcm->fast_op_arg, pfds, space);
 	} else {
-		return 0;
+		if (pcm->poll_fd < 0) {
+			SNDMSG("poll_fd < 0");
+			return -EIO;
+		}
+		if (space >= 1 && pfds) {
+			pfds->fd = pcm->poll_fd;
+			pfds->events = pcm->poll_events | POLLERR | POLLNVAL;
+			count = 1;
+		} else {
+			return 0;
+		}
+	}
+	/* refresh the cache when the full set was queried */
+	if (count > 0 && pfds && !pcm->poll_dynamic) {
+		struct pollfd *cache = pcm->poll_cache;
+
+		if ((unsigned int)count != pcm->poll_cache_count) {
+			cache = realloc(cache, count * sizeof(*cache));
+			if (!cache)
+				return count;
+			pcm->poll_cache = cache;
+		}
+		memcpy(cache, pfds, count * sizeof(*pfds));
+		pcm->poll_cache_count = count;
+		pcm->poll_cache_gen = pcm->poll_gen;
 	}
-	return 1;
+	return count;
 }
 
 /**
@@ -1873,6 +2294,29 @@ int snd_pcm_poll_descriptors_revents(snd_pcm_t *pcm, struct pollfd *pfds, unsign
 	return err;
 }
 
+/**
+ * \brief get the generation of the poll descriptor set
+ * \param pcm PCM handle
+ * \return the current generation number
+ *
+ * The generation number changes whenever the set of poll descriptors
+ * returned by #snd_pcm_poll_descriptors() may have changed, i.e. at
+ * #snd_pcm_hw_params() and #snd_pcm_hw_free() time.  An event loop can
+ * remember the number together with the descriptors and skip rebuilding
+ * its pollfd array while the generation is unchanged.
+ *
+ * PCM types whose descriptors may change at any time (e.g. I/O plugins
+ * with their own poll callbacks) report a new generation on every call,
+ * so such handles are always refreshed.
+ */
+unsigned int snd_pcm_poll_descriptors_generation(snd_pcm_t *pcm)
+{
+	assert(pcm);
+	if (pcm->poll_dynamic)
+		pcm->poll_gen++;
+	return pcm->poll_gen;
+}
+
 static int __snd_pcm_poll_revents(snd_pcm_t *pcm, struct pollfd *pfds,
 				  unsigned int nfds, unsigned short *revents)
 {
@@ -2378,6 +2822,7 @@ int snd_pcm_dump_sw_setup(snd_pcm_t *pcm, snd_output_t *out)
 	snd_output_printf(out, "  period_step  : %d\n", pcm->period_step);
 	snd_output_printf(out, "  avail_min    : %ld\n", pcm->avail_min);
 	snd_output_printf(out, "  period_event : %i\n", pcm->period_event);
+	snd_output_printf(out, "  wait_spin_us : %u\n", pcm->wait_spin_us);
 	snd_output_printf(out, "  start_threshold  : %ld\n", pcm->start_threshold);
 	snd_output_printf(out, "  stop_threshold   : %ld\n", pcm->stop_threshold);
 	snd_output_printf(out, "  silence_threshold: %ld\n", pcm->silence_threshold);
@@ -2436,9 +2881,326 @@ int snd_pcm_dump(snd_pcm_t *pcm, snd_output_t *out)
 		pcm->ops->dump(pcm->op_arg, out);
 	else
 		err = -ENOSYS;
+	if (pcm->stats_enabled) {
+		snd_output_printf(out, "Statistics:\n");
+		snd_output_printf(out, "  xruns              : %llu\n", pcm->stats.xruns);
+		snd_output_printf(out, "  waits              : %llu\n", pcm->stats.waits);
+		snd_output_printf(out, "  wakeups            : %llu\n", pcm->stats.wakeups);
+		snd_output_printf(out, "  frames_written     : %llu\n", pcm->stats.frames_written);
+		snd_output_printf(out, "  frames_read        : %llu\n", pcm->stats.frames_read);
+		snd_output_printf(out, "  mmap_commits       : %llu\n", pcm->stats.mmap_commits);
+		snd_output_printf(out, "  mmap_commit_frames : %llu\n", pcm->stats.mmap_commit_frames);
+	}
 	return err;
 }
 
+/**
+ * \brief Enable or disable runtime statistics collection for a PCM
+ * \param pcm PCM handle
+ * \param enable non-zero to collect statistics, zero to stop
+ * \return 0 on success otherwise a negative error code
+ *
+ * The counters are cheap plain increments done by the thread calling
+ * the respective I/O function, so they can stay enabled in production.
+ * Enabling does not reset previously accumulated values; use
+ * #snd_pcm_stats_reset for that.
+ */
+int snd_pcm_stats_enable(snd_pcm_t *pcm, int enable)
+{
+	assert(pcm);
+	pcm->stats_enabled = enable ? 1 : 0;
+	return 0;
+}
+
+/**
+ * \brief Get the runtime statistics of a PCM
+ * \param pcm PCM handle
+ * \param stats returned statistics
+ * \return 0 on success otherwise a negative error code
+ *
+ * The counters are maintained without atomic operations; values read
+ * while another thread is doing I/O on the same handle may lag by the
+ * operation in flight.
+ */
+int snd_pcm_stats_get(snd_pcm_t *pcm, snd_pcm_stats_t *stats)
+{
+	assert(pcm && stats);
+	*stats = pcm->stats;
+	return 0;
+}
+
+/**
+ * \brief Reset the runtime statistics of a PCM
+ * \param pcm PCM handle
+ * \return 0 on success otherwise a negative error code
+ */
+int snd_pcm_stats_reset(snd_pcm_t *pcm)
+{
+	assert(pcm);
+	memset(&pcm->stats, 0, sizeof(pcm->stats));
+	return 0;
+}
+
+/* wakeups per avail_min adjustment interval */
+#define AUTOTUNE_WINDOW		256
+
+/* install the avail_min chosen by the controller; must be called
+ * without the pcm lock held */
+static void snd_pcm_autotune_apply(snd_pcm_t *pcm)
+{
+	snd_pcm_sw_params_t params = {0};
+	snd_pcm_uframes_t target = pcm->autotune.pending;
+
+	pcm->autotune.pending = 0;
+	if (!target || target == pcm->avail_min)
+		return;
+	if (snd_pcm_sw_params_current(pcm, &params) < 0)
+		return;
+	params.avail_min = target;
+	if (snd_pcm_sw_params(pcm, &params) < 0)
+		SNDMSG("autotune: cannot update avail_min");
+}
+
+/* an xrun got through - wake up earlier; called from snd_pcm_recover()
+ * without the pcm lock held */
+static void snd_pcm_autotune_xrun(snd_pcm_t *pcm)
+{
+	snd_pcm_uframes_t target;
+
+	pcm->autotune.xruns++;
+	target = pcm->avail_min / 2;
+	if (target < pcm->autotune.min)
+		target = pcm->autotune.min;
+	pcm->autotune.pending = target;
+	snd_pcm_autotune_apply(pcm);
+}
+
+/* sample the wakeup overshoot and close the adjustment window;
+ * called inside the pcm lock, so a grown avail_min is only recorded
+ * here and installed by the next snd_pcm_wait() outside the lock */
+static void snd_pcm_autotune_wakeup(snd_pcm_t *pcm)
+{
+	snd_pcm_sframes_t avail;
+	snd_pcm_uframes_t over, used, step;
+
+	avail = __snd_pcm_avail_update(pcm);
+	if (avail < 0)
+		return;
+	over = avail > (snd_pcm_sframes_t)pcm->avail_min ?
+		avail - pcm->avail_min : 0;
+	if (over > pcm->autotune.overshoot)
+		pcm->autotune.overshoot = over;
+	if (++pcm->autotune.wakeups < AUTOTUNE_WINDOW)
+		return;
+	if (pcm->autotune.xruns == pcm->autotune.window_xruns &&
+	    pcm->avail_min < pcm->autotune.max) {
+		/* grow only when the peak overshoot leaves the headroom
+		 * to absorb twice the worst scheduling delay seen */
+		step = (pcm->period_size + 3) / 4;
+		used = pcm->avail_min + pcm->autotune.overshoot;
+		if (used + step < pcm->buffer_size &&
+		    pcm->buffer_size - used - step > 2 * pcm->autotune.overshoot) {
+			snd_pcm_uframes_t target = pcm->avail_min + step;
+			if (target > pcm->autotune.max)
+				target = pcm->autotune.max;
+			pcm->autotune.pending = target;
+		}
+	}
+	pcm->autotune.wakeups = 0;
+	pcm->autotune.overshoot = 0;
+	pcm->autotune.window_xruns = pcm->autotune.xruns;
+}
+
+/**
+ * \brief Enable or disable closed-loop tuning of the wakeup threshold
+ * \param pcm PCM handle
+ * \param min_avail_min lower bound for avail_min in frames
+ * \param max_avail_min upper bound for avail_min in frames
+ * \return 0 on success otherwise a negative error code
+ *
+ * While enabled the library adjusts the software parameter avail_min
+ * within the given bounds from the observed behaviour of the stream:
+ * after an xrun the threshold is halved towards \a min_avail_min so
+ * the application wakes up earlier, and after a sustained xrun-free
+ * interval whose measured wakeup overshoot (the frames the hardware
+ * advanced past the threshold before the wakeup was serviced) leaves
+ * ample headroom it is raised towards \a max_avail_min to reduce the
+ * wakeup rate.  The controller converges to the scheduling behaviour
+ * of the running machine instead of a hand-tuned constant.
+ *
+ * Only streams driven through #snd_pcm_wait are measured.  Passing
+ * zero for both bounds disables the controller; the last installed
+ * avail_min is kept.  The tuning state is dropped together with the
+ * hardware configuration.
+ */
+int snd_pcm_autotune_enable(snd_pcm_t *pcm,
+			    snd_pcm_uframes_t min_avail_min,
+			    snd_pcm_uframes_t max_avail_min)
+{
+	assert(pcm);
+	if (min_avail_min == 0 && max_avail_min == 0) {
+		pcm->autotune_enabled = 0;
+		pcm->autotune.pending = 0;
+		return 0;
+	}
+	if (CHECK_SANITY(! pcm->setup)) {
+		SNDMSG("PCM not set up");
+		return -EIO;
+	}
+	if (min_avail_min < 1 || min_avail_min > max_avail_min ||
+	    max_avail_min > pcm->buffer_size)
+		return -EINVAL;
+	pcm->autotune.min = min_avail_min;
+	pcm->autotune.max = max_avail_min;
+	pcm->autotune.wakeups = 0;
+	pcm->autotune.overshoot = 0;
+	pcm->autotune.window_xruns = pcm->autotune.xruns;
+	pcm->autotune_enabled = 1;
+	/* start from the current avail_min clamped into the bounds */
+	if (pcm->avail_min < min_avail_min)
+		pcm->autotune.pending = min_avail_min;
+	else if (pcm->avail_min > max_avail_min)
+		pcm->autotune.pending = max_avail_min;
+	else
+		pcm->autotune.pending = 0;
+	if (pcm->autotune.pending)
+		snd_pcm_autotune_apply(pcm);
+	return 0;
+}
+
+/**
+ * \brief Enable or disable tracing of the PCM open path
+ * \param enable non-zero to collect phase timings, zero to stop
+ * \return 0 on success otherwise a negative error code
+ *
+ * While enabled the library timestamps the phases of opening a PCM on
+ * the calling thread - configuration expansion, plugin symbol lookup
+ * (including any dlopen) and each plugin open function with nested
+ * opens marked by their depth - plus later #snd_pcm_hw_params calls,
+ * and accumulates them in a per-thread log read back with
+ * #snd_pcm_open_trace_read.  Enabling clears the log; a new top-level
+ * open clears it as well.
+ *
+ * Setting the ALSA_PCM_OPEN_TRACE environment variable enables the
+ * collection without this call and additionally dumps every completed
+ * top-level open to stderr.
+ */
+int snd_pcm_open_trace_enable(int enable)
+{
+	open_trace.mode = enable ? 1 : 0;
+	open_trace.count = open_trace.dumped = 0;
+	open_trace.depth = 0;
+	return 0;
+}
+
+/**
+ * \brief Read one entry of the open-path trace log
+ * \param index entry index starting at zero
+ * \param name returned phase name; the storage stays valid until the
+ *        log is cleared
+ * \param depth returned plugin nesting depth of the phase
+ * \param nsec returned duration of the phase in nanoseconds
+ * \return 0 on success, -ENOENT past the end of the log
+ *
+ * A phase is logged when it completes, so the entries of a nested
+ * open precede the enclosing one.  The log is thread-local; read it
+ * on the thread that did the open.
+ */
+int snd_pcm_open_trace_read(unsigned int index, const char **name,
+			    unsigned int *depth, unsigned long long *nsec)
+{
+	if (index >= open_trace.count)
+		return -ENOENT;
+	if (name)
+		*name = open_trace.phase[index].name;
+	if (depth)
+		*depth = open_trace.phase[index].depth;
+	if (nsec)
+		*nsec = open_trace.phase[index].nsec;
+	return 0;
+}
+
+#ifndef DOC_HIDDEN
+#ifdef __NR_sched_setattr
+/* sched_setattr() has no glibc wrapper */
+struct pcm_sched_attr {
+	uint32_t size;
+	uint32_t sched_policy;
+	uint64_t sched_flags;
+	int32_t sched_nice;
+	uint32_t sched_priority;
+	uint64_t sched_runtime;
+	uint64_t sched_deadline;
+	uint64_t sched_period;
+};
+#define PCM_SCHED_DEADLINE	6
+#endif
+#endif
+
+/**
+ * \brief Derive scheduler parameters for the thread driving a PCM
+ * \param pcm PCM handle
+ * \param cpu_ns_per_period measured processing cost per period in
+ *        nanoseconds, zero when unknown
+ * \param hint returned recommendation, may be NULL when applying only
+ * \param apply non-zero to install the recommendation on the calling
+ *        thread with SCHED_DEADLINE
+ * \return 0 on success otherwise a negative error code
+ *
+ * The activation period is the negotiated hardware period, so the
+ * recommendation follows the real geometry even when a plugin chain
+ * changed it behind the application's back.  The runtime reserves
+ * twice the measured per-period cost as scheduling margin (a quarter
+ * of the period when no measurement is given) and is capped at three
+ * quarters of the period.  The cost is typically obtained by timing
+ * the processing loop between the wakeups counted by the statistics
+ * interface.
+ *
+ * Call the function again after re-negotiating the hardware
+ * parameters; nothing is re-applied automatically.  Applying usually
+ * requires CAP_SYS_NICE and returns the kernel error otherwise.
+ */
+int snd_pcm_thread_hint(snd_pcm_t *pcm, unsigned long long cpu_ns_per_period,
+			snd_pcm_thread_hint_t *hint, int apply)
+{
+	unsigned long long period_ns, runtime_ns;
+
+	assert(pcm);
+	if (CHECK_SANITY(! pcm->setup)) {
+		SNDMSG("PCM not set up");
+		return -EIO;
+	}
+	period_ns = (pcm->period_size * 1000000000ULL) / pcm->rate;
+	if (period_ns == 0)
+		return -EINVAL;
+	runtime_ns = cpu_ns_per_period ? cpu_ns_per_period * 2 : period_ns / 4;
+	if (runtime_ns > (period_ns * 3) / 4)
+		runtime_ns = (period_ns * 3) / 4;
+	if (hint) {
+		hint->period_ns = period_ns;
+		hint->runtime_ns = runtime_ns;
+		hint->deadline_ns = period_ns;
+	}
+	if (!apply)
+		return 0;
+#ifdef __NR_sched_setattr
+	{
+		struct pcm_sched_attr attr = {0};
+
+		attr.size = sizeof(attr);
+		attr.sched_policy = PCM_SCHED_DEADLINE;
+		attr.sched_runtime = runtime_ns;
+		attr.sched_deadline = period_ns;
+		attr.sched_period = period_ns;
+		if (syscall(__NR_sched_setattr, 0, &attr, 0) < 0)
+			return -errno;
+		return 0;
+	}
+#else
+	return -ENOSYS;
+#endif
+}
+
 /**
  * \brief Convert bytes in frames for a PCM
  * \param pcm PCM handle
@@ -2553,7 +3315,7 @@ snd_pcm_t *snd_async_handler_get_pcm(snd_async_handler_t *handler)
 }
 
 static const char *const build_in_pcms[] = {
-	"adpcm", "alaw", "copy", "dmix", "file", "hooks", "hw", "ladspa", "lfloat",
+	"adpcm", "alaw", "copy", "dmix", "file", "graph", "hooks", "hw", "ladspa", "lfloat",
 	"linear", "meter", "mulaw", "multi", "null", "empty", "plug", "rate", "route", "share",
 	"shm", "dsnoop", "dshare", "asym", "iec958", "softvol", "mmap_emul",
 	NULL
@@ -2570,9 +3332,11 @@ static int snd_pcm_open_conf(snd_pcm_t **pcmp, const char *name,
 	snd_config_iterator_t i, next;
 	const char *id;
 	const char *lib = NULL, *open_name = NULL;
-	int (*open_func)(snd_pcm_t **, const char *, 
-			 snd_config_t *, snd_config_t *, 
+	int (*open_func)(snd_pcm_t **, const char *,
+			 snd_config_t *, snd_config_t *,
 			 snd_pcm_stream_t, int) = NULL;
+	unsigned long long trace_t = 0;
+	int tracing = open_trace_active();
 #ifndef PIC
 	extern void *snd_pcm_open_symbols(void);
 #endif
@@ -2665,10 +3429,22 @@ static int snd_pcm_open_conf(snd_pcm_t **pcmp, const char *name,
 #ifndef PIC
 	snd_pcm_open_symbols();	/* this call is for static linking only */
 #endif
+	if (tracing)
+		trace_t = open_trace_now();
 	open_func = snd_dlobj_cache_get(lib, open_name,
 			SND_DLSYM_VERSION(SND_PCM_DLSYM_VERSION), 1);
+	if (tracing)
+		open_trace_log("dlsym", str, trace_t);
 	if (open_func) {
+		if (tracing) {
+			trace_t = open_trace_now();
+			open_trace.depth++;
+		}
 		err = open_func(pcmp, name, pcm_root, pcm_conf, stream, mode);
+		if (tracing) {
+			open_trace.depth--;
+			open_trace_log("open", str, trace_t);
+		}
 		if (err >= 0) {
 			if ((*pcmp)->open_func) {
 				/* only init plugin (like empty, asym) */
@@ -2716,12 +3492,21 @@ static int snd_pcm_open_noupdate(snd_pcm_t **pcmp, snd_config_t *root,
 	int err;
 	snd_config_t *pcm_conf;
 	const char *str;
+	unsigned long long trace_t = 0, trace_start = 0;
+	int tracing = open_trace_active();
 
+	if (tracing) {
+		if (open_trace.depth == 0 && hop == 0)
+			open_trace.count = open_trace.dumped = 0;
+		trace_start = trace_t = open_trace_now();
+	}
 	err = snd_config_search_definition(root, "pcm", name, &pcm_conf);
 	if (err < 0) {
 		SNDERR("Unknown PCM %s", name);
 		return err;
 	}
+	if (tracing)
+		open_trace_log("expand", name, trace_t);
 	if (snd_config_get_string(pcm_conf, &str) >= 0)
 		err = snd_pcm_open_noupdate(pcmp, root, str, stream, mode,
 					    hop + 1);
@@ -2729,7 +3514,15 @@ static int snd_pcm_open_noupdate(snd_pcm_t **pcmp, snd_config_t *root,
 		snd_config_set_hop(pcm_conf, hop);
 		err = snd_pcm_open_conf(pcmp, name, root, pcm_conf, stream, mode);
 	}
-	snd_config_delete(pcm_conf);
+	if (err >= 0 && (*pcmp)->open_conf == NULL)
+		(*pcmp)->open_conf = pcm_conf;	/* keep for snd_pcm_clone() */
+	else
+		snd_config_delete(pcm_conf);
+	if (tracing) {
+		open_trace_log("pcm", name, trace_start);
+		if (open_trace.depth == 0 && hop == 0)
+			open_trace_dump();
+	}
 	return err;
 }
 
@@ -2803,18 +3596,89 @@ int snd_pcm_open_fallback(snd_pcm_t **pcmp, snd_config_t *root,
 	return err;
 }
 
+/**
+ * \brief Opens another PCM from a configured template handle
+ * \param pcmp Returned PCM handle
+ * \param pcm Template PCM handle
+ * \return 0 on success otherwise a negative error code
+ *
+ * Creates a new handle against the same device and plugin chain as
+ * \a pcm by replaying the configuration that was resolved when the
+ * template was opened, skipping the name search and expansion.  When
+ * the template is configured, its current hardware and software
+ * parameters are installed on the new handle as well; because they
+ * form an already fixed choice, the refinement is reduced to a single
+ * validation pass.  The stream direction and open mode are inherited
+ * from the template.
+ *
+ * The function returns -EINVAL for handles which were not created
+ * through the configuration layer (e.g. #snd_pcm_open_lconf with a
+ * direct compound or internal slave handles).  Whether two handles
+ * may share the device concurrently is up to the device or plugin;
+ * exclusive hardware still yields -EBUSY here.
+ */
+int snd_pcm_clone(snd_pcm_t **pcmp, snd_pcm_t *pcm)
+{
+	snd_config_t *root;
+	snd_pcm_t *new_pcm;
+	int err;
+
+	assert(pcmp && pcm);
+	if (!pcm->open_conf)
+		return -EINVAL;
+	err = snd_config_update_ref(&root);
+	if (err < 0)
+		return err;
+	err = snd_pcm_open_conf(&new_pcm, pcm->name, root, pcm->open_conf,
+				pcm->stream, pcm->mode);
+	snd_config_unref(root);
+	if (err < 0)
+		return err;
+	if (pcm->setup) {
+		snd_pcm_hw_params_t hw_params;
+		snd_pcm_sw_params_t sw_params;
+
+		err = snd_pcm_hw_params_current(pcm, &hw_params);
+		if (err >= 0)
+			err = snd_pcm_hw_params(new_pcm, &hw_params);
+		if (err >= 0)
+			err = snd_pcm_sw_params_current(pcm, &sw_params);
+		if (err >= 0)
+			err = snd_pcm_sw_params(new_pcm, &sw_params);
+		if (err < 0) {
+			snd_pcm_close(new_pcm);
+			return err;
+		}
+	}
+	*pcmp = new_pcm;
+	return 0;
+}
+
 #ifndef DOC_HIDDEN
-int snd_pcm_new(snd_pcm_t **pcmp, snd_pcm_type_t type, const char *name,
-		snd_pcm_stream_t stream, int mode)
+int snd_pcm_new_priv(snd_pcm_t **pcmp, snd_pcm_type_t type, const char *name,
+		     snd_pcm_stream_t stream, int mode,
+		     size_t priv_size, void **priv_ret)
 {
 	snd_pcm_t *pcm;
 #ifdef THREAD_SAFE_API
 	pthread_mutexattr_t attr;
 #endif
 
-	pcm = calloc(1, sizeof(*pcm));
+	/* lay the plugin private data directly behind the handle, so
+	 * one chain layer is one allocation and the private_data /
+	 * fast_op_arg dereferences on the transfer path stay within
+	 * the block just accessed; the private starts on its own
+	 * cacheline
+	 */
+	pcm = calloc(1, SND_PCM_ARENA_SIZE(sizeof(*pcm)) + priv_size);
 	if (!pcm)
 		return -ENOMEM;
+	if (priv_size) {
+		pcm->embedded_size = priv_size;
+		*priv_ret = (char *)pcm + SND_PCM_ARENA_SIZE(sizeof(*pcm));
+	}
+	snd_memstat_update(SND_MEMSTAT_PCM,
+			   SND_PCM_ARENA_SIZE(sizeof(*pcm)) + priv_size, 1);
 	pcm->type = type;
 	if (name)
 		pcm->name = strdup(name);
@@ -2855,16 +3719,30 @@ int snd_pcm_new(snd_pcm_t **pcmp, snd_pcm_type_t type, const char *name,
 	return 0;
 }
 
+int snd_pcm_new(snd_pcm_t **pcmp, snd_pcm_type_t type, const char *name,
+		snd_pcm_stream_t stream, int mode)
+{
+	return snd_pcm_new_priv(pcmp, type, name, stream, mode, 0, NULL);
+}
+
 int snd_pcm_free(snd_pcm_t *pcm)
 {
 	assert(pcm);
+	if (pcm->open_conf)
+		snd_config_delete(pcm->open_conf);
+	snd_pcm_arena_free(pcm);
 	free(pcm->name);
+	free(pcm->poll_cache);
+	free(pcm->hw_params_any_cache);
 	free(pcm->hw.link_dst);
 	free(pcm->appl.link_dst);
 	snd_dlobj_cache_put(pcm->open_func);
 #ifdef THREAD_SAFE_API
 	pthread_mutex_destroy(&pcm->lock);
 #endif
+	snd_memstat_update(SND_MEMSTAT_PCM,
+			   -(ssize_t)(SND_PCM_ARENA_SIZE(sizeof(*pcm)) +
+				      pcm->embedded_size), -1);
 	free(pcm);
 	return 0;
 }
@@ -2907,6 +3785,8 @@ int snd_pcm_wait(snd_pcm_t *pcm, int timeout)
 	__snd_pcm_lock(pcm->fast_op_arg); /* forced lock */
 	err = __snd_pcm_wait_in_lock(pcm, timeout);
 	__snd_pcm_unlock(pcm->fast_op_arg);
+	if (pcm->autotune_enabled && pcm->autotune.pending)
+		snd_pcm_autotune_apply(pcm);
 	return err;
 }
 
@@ -2957,7 +3837,40 @@ static int __snd_pcm_wait_drain_timeout(snd_pcm_t *pcm)
 	return timeout;
 }
 
-/* 
+/*
+ * busy-poll the hardware pointer for at most the configured budget;
+ * for the hw plugin the avail update is a read of the mmap'd status
+ * page, so the loop never enters the kernel
+ *
+ * returns 1 when the stream got ready, 0 when the budget expired or
+ * the state changed (poll reports the exact reason in that case)
+ *
+ * This function is called inside pcm lock.
+ */
+static int __snd_pcm_wait_spin(snd_pcm_t *pcm)
+{
+	struct timespec start, now;
+	snd_pcm_sframes_t avail;
+	long long elapsed;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &start) < 0)
+		return 0;
+	for (;;) {
+		avail = __snd_pcm_avail_update(pcm);
+		if (avail < 0)
+			return 0;
+		if (!snd_pcm_may_wait_for_avail_min(pcm, avail))
+			return 1;
+		if (clock_gettime(CLOCK_MONOTONIC, &now) < 0)
+			return 0;
+		elapsed = (now.tv_sec - start.tv_sec) * 1000000LL +
+			  (now.tv_nsec - start.tv_nsec) / 1000;
+		if (elapsed >= pcm->wait_spin_us)
+			return 0;
+	}
+}
+
+/*
  * like snd_pcm_wait() but doesn't check mmap_avail before calling poll()
  *
  * used in drain code in some plugins
@@ -2969,7 +3882,23 @@ int snd_pcm_wait_nocheck(snd_pcm_t *pcm, int timeout)
 	struct pollfd *pfd;
 	unsigned short revents = 0;
 	int npfds, err, err_poll;
-	
+
+	if (pcm->wait_spin_us > 0 && timeout != 0 &&
+	    __snd_pcm_state(pcm) == SND_PCM_STATE_RUNNING &&
+	    __snd_pcm_wait_spin(pcm))
+		return 1;
+
+	if (pcm->fast_ops->wait) {
+		int t = timeout;
+		if (t == SND_PCM_WAIT_IO)
+			t = __snd_pcm_wait_io_timeout(pcm);
+		else if (t == SND_PCM_WAIT_DRAIN)
+			t = __snd_pcm_wait_drain_timeout(pcm);
+		err = pcm->fast_ops->wait(pcm->fast_op_arg, t);
+		if (err != -ENOSYS)
+			return err;
+	}
+
 	npfds = __snd_pcm_poll_descriptors_count(pcm);
 	if (npfds <= 0 || npfds >= 16) {
 		SNDERR("Invalid poll_fds %d", npfds);
@@ -2989,6 +3918,9 @@ int snd_pcm_wait_nocheck(snd_pcm_t *pcm, int timeout)
 		timeout = __snd_pcm_wait_drain_timeout(pcm);
 	else if (timeout < -1)
 		SNDMSG("invalid snd_pcm_wait timeout argument %d", timeout);
+	snd_trace2(pcm_wait, pcm, timeout);
+	if (pcm->stats_enabled)
+		pcm->stats.waits++;
 	do {
 		__snd_pcm_unlock(pcm->fast_op_arg);
 		err_poll = poll(pfd, npfds, timeout);
@@ -3009,6 +3941,11 @@ int snd_pcm_wait_nocheck(snd_pcm_t *pcm, int timeout)
 			return err < 0 ? err : -EIO;
 		}
 	} while (!(revents & (POLLIN | POLLOUT)));
+	snd_trace2(pcm_wakeup, pcm, revents);
+	if (pcm->stats_enabled)
+		pcm->stats.wakeups++;
+	if (pcm->autotune_enabled)
+		snd_pcm_autotune_wakeup(pcm);
 #if 0 /* very useful code to test poll related problems */
 	{
 		snd_pcm_sframes_t avail_update;
@@ -3054,6 +3991,7 @@ snd_pcm_sframes_t snd_pcm_avail_update(snd_pcm_t *pcm)
 	snd_pcm_lock(pcm->fast_op_arg);
 	result = __snd_pcm_avail_update(pcm);
 	snd_pcm_unlock(pcm->fast_op_arg);
+	snd_trace2(pcm_avail_update, pcm, result);
 	return result;
 }
 
@@ -3141,6 +4079,38 @@ int snd_pcm_avail_delay(snd_pcm_t *pcm,
  * \param format PCM sample format
  * \return 0 on success otherwise a negative error code
  */
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+/*
+ * Fill a contiguous, 64bit aligned region with the silence pattern.
+ * The wide stores matter for the sw silencing and xrun paths where
+ * whole period buffers are cleared at once.
+ */
+static void snd_pcm_silence_fill_64(uint64_t *dst, unsigned int dwords,
+				    uint64_t silence)
+{
+#if defined(__SSE2__)
+	__m128i v = _mm_set1_epi64x(silence);
+	for (; dwords >= 4; dwords -= 4, dst += 4) {
+		_mm_storeu_si128((__m128i *)dst, v);
+		_mm_storeu_si128((__m128i *)(dst + 2), v);
+	}
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+	uint64x2_t v = vdupq_n_u64(silence);
+	for (; dwords >= 4; dwords -= 4, dst += 4) {
+		vst1q_u64(dst, v);
+		vst1q_u64(dst + 2, v);
+	}
+#endif
+	while (dwords-- > 0)
+		*dst++ = silence;
+}
+
+SND_TARGET_CLONES
 int snd_pcm_area_silence(const snd_pcm_channel_area_t *dst_area, snd_pcm_uframes_t dst_offset,
 			 unsigned int samples, snd_pcm_format_t format)
 {
@@ -3154,6 +4124,10 @@ int snd_pcm_area_silence(const snd_pcm_channel_area_t *dst_area, snd_pcm_uframes
 	dst = snd_pcm_channel_area_addr(dst_area, dst_offset);
 	width = snd_pcm_format_physical_width(format);
 	silence = snd_pcm_format_silence_64(format);
+	/* degenerate area (null plugin): every frame aliases the same
+	 * sample, one store silences them all */
+	if (dst_area->step == 0 && samples > 0)
+		samples = 1;
         /*
          * Iterate copying silent sample for sample data aligned to 64 bit.
          * This is a fast path.
@@ -3164,8 +4138,8 @@ int snd_pcm_area_silence(const snd_pcm_channel_area_t *dst_area, snd_pcm_uframes
 		unsigned int dwords = samples * width / 64;
 		uint64_t *dstp = (uint64_t *)dst;
 		samples -= dwords * 64 / width;
-		while (dwords-- > 0)
-			*dstp++ = silence;
+		snd_pcm_silence_fill_64(dstp, dwords, silence);
+		dstp += dwords;
 		if (samples == 0)
 			return 0;
 		dst = (char *)dstp;
@@ -3307,6 +4281,140 @@ int snd_pcm_areas_silence(const snd_pcm_channel_area_t *dst_areas, snd_pcm_ufram
  * \param format PCM sample format
  * \return 0 on success otherwise a negative error code
  */
+#if defined(__SSE2__) || defined(__ARM_NEON) || defined(__aarch64__)
+/*
+ * Extract one channel of an interleaved stereo buffer into a packed
+ * buffer (the strided case the memcpy fast path cannot catch; the
+ * interleaving direction cannot be vectorized per channel, since a wide
+ * store would clobber the other channel).  Returns the number of
+ * samples handled; the remainder is left to the scalar loop.
+ */
+static unsigned int snd_pcm_deinterleave2_16(int16_t *dst, const int16_t *src,
+					     unsigned int samples)
+{
+	unsigned int done = samples & ~7U;
+	unsigned int n;
+
+#if defined(__SSE2__)
+	for (n = done; n >= 8; n -= 8, src += 16, dst += 8) {
+		__m128i a = _mm_loadu_si128((const __m128i *)src);
+		__m128i b = _mm_loadu_si128((const __m128i *)(src + 8));
+		/* sign-extended 16bit values survive the saturating pack */
+		a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+		b = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+		_mm_storeu_si128((__m128i *)dst, _mm_packs_epi32(a, b));
+	}
+#else
+	for (n = done; n >= 8; n -= 8, src += 16, dst += 8)
+		vst1q_s16(dst, vld2q_s16(src).val[0]);
+#endif
+	return done;
+}
+
+static unsigned int snd_pcm_deinterleave2_32(uint32_t *dst, const uint32_t *src,
+					     unsigned int samples)
+{
+	unsigned int done = samples & ~3U;
+	unsigned int n;
+
+#if defined(__SSE2__)
+	for (n = done; n >= 4; n -= 4, src += 8, dst += 4) {
+		__m128 a = _mm_loadu_ps((const float *)src);
+		__m128 b = _mm_loadu_ps((const float *)(src + 4));
+		_mm_storeu_ps((float *)dst, _mm_shuffle_ps(a, b, 0x88));
+	}
+#else
+	for (n = done; n >= 4; n -= 4, src += 8, dst += 4)
+		vst1q_u32(dst, vld2q_u32(src).val[0]);
+#endif
+	return done;
+}
+#endif /* __SSE2__ || __ARM_NEON || __aarch64__ */
+
+#ifndef DOC_HIDDEN
+/*
+ * Copy a group of channels that occupy consecutive samples in both the
+ * source and the destination interleave in a single pass.  The strides
+ * may differ - this is the transfer between a wide aggregate buffer and
+ * the narrower buffers of its slaves (the pcm_multi channel bindings),
+ * which the memcpy collapse in snd_pcm_areas_copy cannot catch and
+ * which would otherwise walk the buffer once per channel.
+ */
+SND_TARGET_CLONES
+static void snd_pcm_area_group_copy(char *dst, unsigned int dst_step,
+				    const char *src, unsigned int src_step,
+				    unsigned int bytes,
+				    snd_pcm_uframes_t frames)
+{
+	switch (bytes) {
+	case 2:
+		while (frames-- > 0) {
+			*(uint16_t *)dst = *(const uint16_t *)src;
+			src += src_step;
+			dst += dst_step;
+		}
+		break;
+	case 4:
+#if defined(__SSE2__)
+		if (dst_step == 4) {
+			/* gather four frames per 128bit store */
+			for (; frames >= 4;
+			     frames -= 4, src += 4 * src_step, dst += 16)
+				_mm_storeu_si128((__m128i *)dst,
+					_mm_set_epi32(*(const int32_t *)(src + 3 * src_step),
+						      *(const int32_t *)(src + 2 * src_step),
+						      *(const int32_t *)(src + src_step),
+						      *(const int32_t *)src));
+		}
+#endif
+		while (frames-- > 0) {
+			*(uint32_t *)dst = *(const uint32_t *)src;
+			src += src_step;
+			dst += dst_step;
+		}
+		break;
+	case 8:
+		while (frames-- > 0) {
+			*(uint64_t *)dst = *(const uint64_t *)src;
+			src += src_step;
+			dst += dst_step;
+		}
+		break;
+	case 16:
+#if defined(__SSE2__)
+		while (frames-- > 0) {
+			_mm_storeu_si128((__m128i *)dst,
+					 _mm_loadu_si128((const __m128i *)src));
+			src += src_step;
+			dst += dst_step;
+		}
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+		while (frames-- > 0) {
+			vst1q_u8((uint8_t *)dst, vld1q_u8((const uint8_t *)src));
+			src += src_step;
+			dst += dst_step;
+		}
+#else
+		while (frames-- > 0) {
+			((uint64_t *)dst)[0] = ((const uint64_t *)src)[0];
+			((uint64_t *)dst)[1] = ((const uint64_t *)src)[1];
+			src += src_step;
+			dst += dst_step;
+		}
+#endif
+		break;
+	default:
+		while (frames-- > 0) {
+			memcpy(dst, src, bytes);
+			src += src_step;
+			dst += dst_step;
+		}
+		break;
+	}
+}
+#endif /* DOC_HIDDEN */
+
+SND_TARGET_CLONES
 int snd_pcm_area_copy(const snd_pcm_channel_area_t *dst_area, snd_pcm_uframes_t dst_offset,
 		      const snd_pcm_channel_area_t *src_area, snd_pcm_uframes_t src_offset,
 		      unsigned int samples, snd_pcm_format_t format)
@@ -3335,6 +4443,27 @@ int snd_pcm_area_copy(const snd_pcm_channel_area_t *dst_area, snd_pcm_uframes_t
 		if (samples == 0)
 			return 0;
 	}
+#if defined(__SSE2__) || defined(__ARM_NEON) || defined(__aarch64__)
+	if (dst_area->step == (unsigned int)width &&
+	    src_area->step == (unsigned int)width * 2 &&
+	    (width == 16 || width == 32) &&
+	    src_area->first % 8 == 0 && dst_area->first % 8 == 0) {
+		unsigned int done;
+		if (width == 16)
+			done = snd_pcm_deinterleave2_16((int16_t *)dst,
+							(const int16_t *)src,
+							samples);
+		else
+			done = snd_pcm_deinterleave2_32((uint32_t *)dst,
+							(const uint32_t *)src,
+							samples);
+		samples -= done;
+		if (samples == 0)
+			return 0;
+		src += done * (src_area->step / 8);
+		dst += done * (width / 8);
+	}
+#endif
 	src_step = src_area->step / 8;
 	dst_step = dst_area->step / 8;
 	switch (width) {
@@ -3444,27 +4573,29 @@ int snd_pcm_areas_copy(const snd_pcm_channel_area_t *dst_areas, snd_pcm_uframes_
 		return -EINVAL;
 	}
 	while (channels > 0) {
-		unsigned int step = src_areas->step;
+		unsigned int src_step = src_areas->step;
+		unsigned int dst_step = dst_areas->step;
 		void *src_addr = src_areas->addr;
 		const snd_pcm_channel_area_t *src_start = src_areas;
 		void *dst_addr = dst_areas->addr;
 		const snd_pcm_channel_area_t *dst_start = dst_areas;
 		int channels1 = channels;
 		unsigned int chns = 0;
-		while (dst_areas->step == step) {
+		while (1) {
 			channels1--;
 			chns++;
 			src_areas++;
 			dst_areas++;
 			if (channels1 == 0 ||
-			    src_areas->step != step ||
+			    src_areas->step != src_step ||
+			    dst_areas->step != dst_step ||
 			    src_areas->addr != src_addr ||
 			    dst_areas->addr != dst_addr ||
 			    src_areas->first != src_areas[-1].first + width ||
 			    dst_areas->first != dst_areas[-1].first + width)
 				break;
 		}
-		if (chns > 1 && chns * width == step) {
+		if (chns > 1 && chns * width == src_step && src_step == dst_step) {
 			if (src_offset != dst_offset ||
 			    src_start->addr != dst_start->addr ||
 			    src_start->first != dst_start->first) {
@@ -3477,10 +4608,24 @@ int snd_pcm_areas_copy(const snd_pcm_channel_area_t *dst_areas, snd_pcm_uframes_
 				d.first = dst_start->first;
 				d.step = width;
 				snd_pcm_area_copy(&d, dst_offset * chns,
-						  &s, src_offset * chns, 
+						  &s, src_offset * chns,
 						  frames * chns, format);
 			}
 			channels -= chns;
+		} else if (chns > 1 && src_addr && dst_addr &&
+			   src_addr != dst_addr &&
+			   width % 8 == 0 &&
+			   src_start->first % 8 == 0 &&
+			   dst_start->first % 8 == 0 &&
+			   src_step % 8 == 0 && dst_step % 8 == 0) {
+			/* Gather/scatter between differently interleaved
+			 * buffers in one pass over the group */
+			snd_pcm_area_group_copy(snd_pcm_channel_area_addr(dst_start, dst_offset),
+						dst_step / 8,
+						snd_pcm_channel_area_addr(src_start, src_offset),
+						src_step / 8,
+						chns * width / 8, frames);
+			channels -= chns;
 		} else {
 			snd_pcm_area_copy(dst_start, dst_offset,
 					  src_start, src_offset,
@@ -3963,8 +5108,46 @@ int snd_pcm_hw_params_get_fifo_size(const snd_pcm_hw_params_t *params)
  */
 int snd_pcm_hw_params_any(snd_pcm_t *pcm, snd_pcm_hw_params_t *params)
 {
+	int err;
+
 	_snd_pcm_hw_params_any(params);
-	return snd_pcm_hw_refine(pcm, params);
+	err = snd_pcm_hw_refine(pcm, params);
+	if (err >= 0) {
+		/* keep the refined space for snd_pcm_hw_params_any_cached */
+		if (pcm->hw_params_any_cache == NULL)
+			pcm->hw_params_any_cache = malloc(sizeof(*params));
+		if (pcm->hw_params_any_cache != NULL)
+			*pcm->hw_params_any_cache = *params;
+	}
+	return err;
+}
+
+/**
+ * \brief Fill params with the previously refined full configuration space
+ * \param pcm PCM handle
+ * \param params Configuration space
+ *
+ * Like #snd_pcm_hw_params_any, but when a refined full configuration
+ * space from an earlier call on this handle is available, it is
+ * restored with a plain copy instead of re-running the refinement
+ * (which cascades through every plugin layer and ends in an ioctl).
+ * Intended for reconfiguration storms where the same handle is set up
+ * over and over.
+ *
+ * The snapshot is dropped whenever the installed configuration
+ * changes (#snd_pcm_hw_params, #snd_pcm_hw_free), since the space may
+ * depend on it.  Constraints changed behind the handle's back (e.g.
+ * another client occupying a shared device) are not noticed; call
+ * #snd_pcm_hw_params_any to resynchronize the snapshot.
+ */
+int snd_pcm_hw_params_any_cached(snd_pcm_t *pcm, snd_pcm_hw_params_t *params)
+{
+	assert(pcm && params);
+	if (pcm->hw_params_any_cache != NULL) {
+		*params = *pcm->hw_params_any_cache;
+		return 0;
+	}
+	return snd_pcm_hw_params_any(pcm, params);
 }
 
 /**
@@ -6345,6 +7528,7 @@ void snd_pcm_sw_params_current_no_lock(snd_pcm_t *pcm, snd_pcm_sw_params_t *para
 	params->sleep_min = 0;
 	params->avail_min = pcm->avail_min;
 	sw_set_period_event(params, pcm->period_event);
+	sw_set_wait_spin_us(params, pcm->wait_spin_us);
 	params->xfer_align = 1;
 	params->start_threshold = pcm->start_threshold;
 	params->stop_threshold = pcm->stop_threshold;
@@ -6725,6 +7909,39 @@ int snd_pcm_sw_params_get_period_event(const snd_pcm_sw_params_t *params, int *v
 	return 0;
 }
 
+/**
+ * \brief Set the busy-poll budget inside a software configuration container
+ * \param pcm PCM handle
+ * \param params Software configuration container
+ * \param val busy-poll budget in microseconds, 0 to disable
+ * \return 0 otherwise a negative error code
+ *
+ * When nonzero, #snd_pcm_wait() busy-polls the hardware pointer for at
+ * most the given time before falling back to poll().  For very small
+ * period sizes this avoids the scheduler wakeup latency at the cost of
+ * burning one CPU while waiting.  The budget is a library-side setting
+ * and is not passed to the driver.
+ */
+int snd_pcm_sw_params_set_wait_spin_us(snd_pcm_t *pcm, snd_pcm_sw_params_t *params, unsigned int val)
+{
+	assert(pcm && params);
+	sw_set_wait_spin_us(params, val);
+	return 0;
+}
+
+/**
+ * \brief Get the busy-poll budget from a software configuration container
+ * \param params Software configuration container
+ * \param val returned busy-poll budget in microseconds
+ * \return 0 otherwise a negative error code
+ */
+int snd_pcm_sw_params_get_wait_spin_us(const snd_pcm_sw_params_t *params, unsigned int *val)
+{
+	assert(params && val);
+	*val = sw_get_wait_spin_us(params);
+	return 0;
+}
+
 /**
  * \brief (DEPRECATED) Set xfer align inside a software configuration container
  * \param pcm PCM handle
@@ -7437,7 +8654,10 @@ int __snd_pcm_mmap_begin_generic(snd_pcm_t *pcm, const snd_pcm_channel_area_t **
 	f = *frames;
 	if (f > avail)
 		f = avail;
-	if (f > cont)
+	/* a mirrored ring is virtually contiguous across the wrap,
+	 * the window does not have to stop at the buffer end
+	 */
+	if (!pcm->mmap_mirrored && f > cont)
 		f = cont;
 	*frames = f;
 	return 0;
@@ -7543,6 +8763,11 @@ snd_pcm_sframes_t __snd_pcm_mmap_commit(snd_pcm_t *pcm,
 		       snd_pcm_mmap_avail(pcm));
 		return -EPIPE;
 	}
+	snd_trace3(pcm_mmap_commit, pcm, offset, frames);
+	if (pcm->stats_enabled) {
+		pcm->stats.mmap_commits++;
+		pcm->stats.mmap_commit_frames += frames;
+	}
 	if (pcm->fast_ops->mmap_commit)
 		return pcm->fast_ops->mmap_commit(pcm->fast_op_arg, offset, frames);
 	else
@@ -8315,6 +9540,43 @@ snd_pcm_chmap_t *snd_pcm_get_chmap(snd_pcm_t *pcm)
 	return pcm->ops->get_chmap(pcm);
 }
 
+/**
+ * \!brief Get the current channel map into a caller supplied buffer
+ * \param pcm PCM instance
+ * \param map the buffer to fill
+ * \param maxlen the size of the buffer in bytes
+ * \return zero if succeeded, or a negative error code
+ *
+ * Works like snd_pcm_get_chmap() but fills the given buffer instead of
+ * returning a freshly allocated channel map, so that the caller can
+ * poll the map repeatedly without the allocation and free dance.
+ * The buffer must keep at least sizeof(snd_pcm_chmap_t) plus one
+ * unsigned int per channel of the running stream; -ENOSPC is returned
+ * when it is too small.
+ */
+int snd_pcm_get_chmap_buf(snd_pcm_t *pcm, snd_pcm_chmap_t *map, size_t maxlen)
+{
+	snd_pcm_chmap_t *src;
+	size_t size;
+
+	assert(pcm && map);
+	if (pcm->ops->get_chmap_buf)
+		return pcm->ops->get_chmap_buf(pcm, map, maxlen);
+	if (!pcm->ops->get_chmap)
+		return -ENXIO;
+	src = pcm->ops->get_chmap(pcm);
+	if (!src)
+		return -ENXIO;
+	size = sizeof(*src) + src->channels * sizeof(src->pos[0]);
+	if (maxlen < size) {
+		free(src);
+		return -ENOSPC;
+	}
+	memcpy(map, src, size);
+	free(src);
+	return 0;
+}
+
 /**
  * \!brief Configure the current channel map
  * \param pcm PCM instance
@@ -8742,6 +10004,11 @@ int snd_pcm_recover(snd_pcm_t *pcm, int err, int silent)
                 return 0;
         if (err == -EPIPE) {
                 const char *s;
+                snd_trace1(pcm_xrun, pcm);
+                if (pcm->stats_enabled)
+                        pcm->stats.xruns++;
+                if (pcm->autotune_enabled)
+                        snd_pcm_autotune_xrun(pcm);
                 if (snd_pcm_stream(pcm) == SND_PCM_STREAM_PLAYBACK)
                         s = "underrun";
                 else
@@ -103,6 +103,46 @@ static const short StepSize[89] = {
 	15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
 };
 
+/* Precomputed per-state decode tables: the signed difference and the
+ * next step index for every (step index, code) pair.  They turn the
+ * decoder state machine into two dependent loads per nibble and are
+ * filled once at plugin open time (concurrent refills write the same
+ * constants).  The differences are truncated to 16 bits first to keep
+ * the historic short arithmetic of the step loop.
+ */
+static int adpcm_diff_tab[89][16];
+static unsigned char adpcm_next_idx[89][16];
+static int adpcm_tabs_ready;
+
+static void adpcm_build_tables(void)
+{
+	int idx, code, step, diff, mag, next;
+
+	if (adpcm_tabs_ready)
+		return;
+	for (idx = 0; idx < 89; idx++) {
+		for (code = 0; code < 16; code++) {
+			step = StepSize[idx];
+			diff = step >> 3;
+			if (code & 4)
+				diff += step;
+			if (code & 2)
+				diff += step >> 1;
+			if (code & 1)
+				diff += step >> 2;
+			mag = (int16_t)diff;
+			adpcm_diff_tab[idx][code] = (code & 8) ? -mag : mag;
+			next = idx + IndexAdjust[code & 7];
+			if (next < 0)
+				next = 0;
+			else if (next > 88)
+				next = 88;
+			adpcm_next_idx[idx][code] = next;
+		}
+	}
+	adpcm_tabs_ready = 1;
+}
+
 static char adpcm_encoder(int sl, snd_pcm_adpcm_state_t * state)
 {
 	short diff;		/* Difference between sl and predicted sample */
@@ -166,31 +206,12 @@ static char adpcm_encoder(int sl, snd_pcm_adpcm_state_t * state)
 
 static int adpcm_decoder(unsigned char code, snd_pcm_adpcm_state_t * state)
 {
-	short pred_diff;	/* Predicted difference to next sample */
-	short step;		/* holds previous StepSize value */
-	char sign;
-
-	int i;
-
-	/* Separate sign and magnitude */
-	sign = code & 0x8;
-	code &= 0x7;
-
 	/*
 	 * Computes pred_diff = (code + 0.5) * step / 4,
 	 * but see comment in adpcm_coder.
 	 */
-
-	step = StepSize[state->step_idx];
-
-	/* Compute difference and new predicted value */
-	pred_diff = step >> 3;
-	for (i = 0x4; i; i >>= 1, step >>= 1) {
-		if (code & i) {
-			pred_diff += step;
-		}
-	}
-	state->pred_val += (sign) ? -pred_diff : pred_diff;
+	code &= 0x0f;
+	state->pred_val += adpcm_diff_tab[state->step_idx][code];
 
 	/* Clamp output value */
 	if (state->pred_val > 32767) {
@@ -200,13 +221,7 @@ static int adpcm_decoder(unsigned char code, snd_pcm_adpcm_state_t * state)
 	}
 
 	/* Find new StepSize index value */
-	state->step_idx += IndexAdjust[code];
-
-	if (state->step_idx < 0) {
-		state->step_idx = 0;
-	} else if (state->step_idx > 88) {
-		state->step_idx = 88;
-	}
+	state->step_idx = adpcm_next_idx[state->step_idx][code];
 	return (state->pred_val);
 }
 
@@ -225,6 +240,8 @@ void snd_pcm_adpcm_decode(const snd_pcm_channel_area_t *dst_areas,
 #undef PUT16_LABELS
 	void *put = put16_labels[putidx];
 	unsigned int channel;
+	int put_s16 = (int)putidx ==
+		snd_pcm_linear_put_index(SND_PCM_FORMAT_S16, SND_PCM_FORMAT_S16);
 	for (channel = 0; channel < channels; ++channel, ++states) {
 		const char *src;
 		int srcbit;
@@ -241,6 +258,54 @@ void snd_pcm_adpcm_decode(const snd_pcm_channel_area_t *dst_areas,
 		dst = snd_pcm_channel_area_addr(dst_area, dst_offset);
 		dst_step = snd_pcm_channel_area_step(dst_area);
 		frames1 = frames;
+		if (put_s16 && src_step == 0 && srcbit_step == 4 &&
+		    srcbit == 0 && dst_step == 2) {
+			/* flat 4-bit stream into native S16: run the state
+			 * machine through the precomputed tables, a whole
+			 * byte block (8 nibbles) per iteration to amortize
+			 * the loop overhead around the serial dependency
+			 */
+			const unsigned char *s = (const unsigned char *)src;
+			int16_t *dst16 = (int16_t *)dst;
+			int pred = states->pred_val;
+			int idx = states->step_idx;
+			int nib = 0;
+			unsigned char b;
+#define ADPCM_DECODE_NIBBLE(code) do { \
+			pred += adpcm_diff_tab[idx][code]; \
+			if (pred > 32767) \
+				pred = 32767; \
+			else if (pred < -32768) \
+				pred = -32768; \
+			idx = adpcm_next_idx[idx][code]; \
+			*dst16++ = pred; \
+		} while (0)
+			while (frames1 >= 8) {
+				b = s[0];
+				ADPCM_DECODE_NIBBLE(b >> 4);
+				ADPCM_DECODE_NIBBLE(b & 0x0f);
+				b = s[1];
+				ADPCM_DECODE_NIBBLE(b >> 4);
+				ADPCM_DECODE_NIBBLE(b & 0x0f);
+				b = s[2];
+				ADPCM_DECODE_NIBBLE(b >> 4);
+				ADPCM_DECODE_NIBBLE(b & 0x0f);
+				b = s[3];
+				ADPCM_DECODE_NIBBLE(b >> 4);
+				ADPCM_DECODE_NIBBLE(b & 0x0f);
+				s += 4;
+				frames1 -= 8;
+			}
+			while (frames1-- > 0) {
+				b = nib ? (*s++ & 0x0f) : (*s >> 4);
+				nib ^= 1;
+				ADPCM_DECODE_NIBBLE(b);
+			}
+#undef ADPCM_DECODE_NIBBLE
+			states->pred_val = pred;
+			states->step_idx = idx;
+			continue;
+		}
 		while (frames1-- > 0) {
 			int16_t sample;
 			unsigned char v;
@@ -556,10 +621,12 @@ int snd_pcm_adpcm_open(snd_pcm_t **pcmp, const char *name, snd_pcm_format_t sfor
 	if (snd_pcm_format_linear(sformat) != 1 &&
 	    sformat != SND_PCM_FORMAT_IMA_ADPCM)
 		return -EINVAL;
-	adpcm = calloc(1, sizeof(snd_pcm_adpcm_t));
-	if (!adpcm) {
-		return -ENOMEM;
-	}
+	adpcm_build_tables();
+	err = snd_pcm_new_priv(&pcm, SND_PCM_TYPE_ADPCM, name, slave->stream,
+			       slave->mode, sizeof(snd_pcm_adpcm_t),
+			       (void **)&adpcm);
+	if (err < 0)
+		return err;
 	adpcm->sformat = sformat;
 	snd_pcm_plugin_init(&adpcm->plug);
 	adpcm->plug.read = snd_pcm_adpcm_read_areas;
@@ -568,15 +635,11 @@ int snd_pcm_adpcm_open(snd_pcm_t **pcmp, const char *name, snd_pcm_format_t sfor
 	adpcm->plug.gen.slave = slave;
 	adpcm->plug.gen.close_slave = close_slave;
 
-	err = snd_pcm_new(&pcm, SND_PCM_TYPE_ADPCM, name, slave->stream, slave->mode);
-	if (err < 0) {
-		free(adpcm);
-		return err;
-	}
 	pcm->ops = &snd_pcm_adpcm_ops;
 	pcm->fast_ops = &snd_pcm_plugin_fast_ops;
 	pcm->private_data = adpcm;
 	pcm->poll_fd = slave->poll_fd;
+	pcm->poll_dynamic = slave->poll_dynamic;
 	pcm->poll_events = slave->poll_events;
 	pcm->tstamp_type = slave->tstamp_type;
 	snd_pcm_set_hw_ptr(pcm, &adpcm->plug.hw_ptr, -1, 0);
@@ -56,22 +56,13 @@ typedef struct {
 
 #endif
 
-static inline int val_seg(int val)
-{
-	int r = 1;
-	val >>= 8;
-	if (val & 0xf0) {
-		val >>= 4;
-		r += 4;
-	}
-	if (val & 0x0c) {
-		val >>= 2;
-		r += 2;
-	}
-	if (val & 0x02)
-		r += 1;
-	return r;
-}
+/* batch conversion tables: straight 256-entry decode lookups and a
+ * branch-free segment lookup for the encoder, filled once at open time
+ * (a concurrent refill writes the same constants, so it is harmless)
+ */
+static int16_t alaw_decode_tab[256];
+static unsigned char alaw_seg_tab[256];
+static int alaw_tabs_ready;
 
 /*
  * s16_to_alaw() - Convert a 16-bit linear PCM value to 8-bit A-law
@@ -95,24 +86,22 @@ static inline int val_seg(int val)
 
 static unsigned char s16_to_alaw(int pcm_val)
 {
-	int		mask;
+	int		sign = pcm_val >> 31;
+	int		mask = 0xD5 ^ (sign & 0x80);
 	int		seg;
 	unsigned char	aval;
 
-	if (pcm_val >= 0) {
-		mask = 0xD5;
-	} else {
-		mask = 0x55;
-		pcm_val = -pcm_val;
-		if (pcm_val > 0x7fff)
-			pcm_val = 0x7fff;
-	}
+	/* branch-free sign handling keeps the encode loop free of
+	 * data-dependent jumps */
+	pcm_val = (pcm_val ^ sign) - sign;
+	if (pcm_val > 0x7fff)
+		pcm_val = 0x7fff;
 
 	if (pcm_val < 256)
 		aval = pcm_val >> 4;
 	else {
 		/* Convert the scaled magnitude to segment number. */
-		seg = val_seg(pcm_val);
+		seg = alaw_seg_tab[pcm_val >> 8];
 		aval = (seg << 4) | ((pcm_val >> (seg + 3)) & 0x0f);
 	}
 	return aval ^ mask;
@@ -139,6 +128,22 @@ static int alaw_to_s16(unsigned char a_val)
 	return ((a_val & 0x80) ? t : -t);
 }
 
+static void alaw_build_tables(void)
+{
+	int i, seg, v;
+
+	if (alaw_tabs_ready)
+		return;
+	for (i = 0; i < 256; i++) {
+		alaw_decode_tab[i] = alaw_to_s16(i);
+		seg = 0;
+		for (v = i; v; v >>= 1)
+			seg++;
+		alaw_seg_tab[i] = seg;
+	}
+	alaw_tabs_ready = 1;
+}
+
 #ifndef DOC_HIDDEN
 
 void snd_pcm_alaw_decode(const snd_pcm_channel_area_t *dst_areas,
@@ -153,6 +158,8 @@ void snd_pcm_alaw_decode(const snd_pcm_channel_area_t *dst_areas,
 #undef PUT16_LABELS
 	void *put = put16_labels[putidx];
 	unsigned int channel;
+	int put_s16 = (int)putidx ==
+		snd_pcm_linear_put_index(SND_PCM_FORMAT_S16, SND_PCM_FORMAT_S16);
 	for (channel = 0; channel < channels; ++channel) {
 		const unsigned char *src;
 		char *dst;
@@ -165,8 +172,16 @@ void snd_pcm_alaw_decode(const snd_pcm_channel_area_t *dst_areas,
 		src_step = snd_pcm_channel_area_step(src_area);
 		dst_step = snd_pcm_channel_area_step(dst_area);
 		frames1 = frames;
+		if (put_s16 && src_step == 1 && dst_step == 2) {
+			/* flat channel: the plain table loop lets the
+			 * compiler vectorize the lookups */
+			int16_t *dst16 = (int16_t *)dst;
+			while (frames1-- > 0)
+				*dst16++ = alaw_decode_tab[*src++];
+			continue;
+		}
 		while (frames1-- > 0) {
-			int16_t sample = alaw_to_s16(*src);
+			int16_t sample = alaw_decode_tab[*src];
 			goto *put;
 #define PUT16_END after
 #include "plugin_ops.h"
@@ -191,6 +206,8 @@ void snd_pcm_alaw_encode(const snd_pcm_channel_area_t *dst_areas,
 	void *get = get16_labels[getidx];
 	unsigned int channel;
 	int16_t sample = 0;
+	int get_s16 = (int)getidx ==
+		snd_pcm_linear_get_index(SND_PCM_FORMAT_S16, SND_PCM_FORMAT_S16);
 	for (channel = 0; channel < channels; ++channel) {
 		const char *src;
 		char *dst;
@@ -203,6 +220,12 @@ void snd_pcm_alaw_encode(const snd_pcm_channel_area_t *dst_areas,
 		src_step = snd_pcm_channel_area_step(src_area);
 		dst_step = snd_pcm_channel_area_step(dst_area);
 		frames1 = frames;
+		if (get_s16 && src_step == 2 && dst_step == 1) {
+			const int16_t *src16 = (const int16_t *)src;
+			while (frames1-- > 0)
+				*dst++ = s16_to_alaw(*src16++);
+			continue;
+		}
 		while (frames1-- > 0) {
 			goto *get;
 #define GET16_END after
@@ -430,10 +453,12 @@ int snd_pcm_alaw_open(snd_pcm_t **pcmp, const char *name, snd_pcm_format_t sform
 	if (snd_pcm_format_linear(sformat) != 1 &&
 	    sformat != SND_PCM_FORMAT_A_LAW)
 		return -EINVAL;
-	alaw = calloc(1, sizeof(snd_pcm_alaw_t));
-	if (!alaw) {
-		return -ENOMEM;
-	}
+	alaw_build_tables();
+	err = snd_pcm_new_priv(&pcm, SND_PCM_TYPE_ALAW, name, slave->stream,
+			       slave->mode, sizeof(snd_pcm_alaw_t),
+			       (void **)&alaw);
+	if (err < 0)
+		return err;
 	snd_pcm_plugin_init(&alaw->plug);
 	alaw->sformat = sformat;
 	alaw->plug.read = snd_pcm_alaw_read_areas;
@@ -443,15 +468,11 @@ int snd_pcm_alaw_open(snd_pcm_t **pcmp, const char *name, snd_pcm_format_t sform
 	alaw->plug.gen.slave = slave;
 	alaw->plug.gen.close_slave = close_slave;
 
-	err = snd_pcm_new(&pcm, SND_PCM_TYPE_ALAW, name, slave->stream, slave->mode);
-	if (err < 0) {
-		free(alaw);
-		return err;
-	}
 	pcm->ops = &snd_pcm_alaw_ops;
 	pcm->fast_ops = &snd_pcm_plugin_fast_ops;
 	pcm->private_data = alaw;
 	pcm->poll_fd = slave->poll_fd;
+	pcm->poll_dynamic = slave->poll_dynamic;
 	pcm->poll_events = slave->poll_events;
 	pcm->tstamp_type = slave->tstamp_type;
 	snd_pcm_set_hw_ptr(pcm, &alaw->plug.hw_ptr, -1, 0);
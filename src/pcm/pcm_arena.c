@@ -0,0 +1,123 @@
+/*
+ *  PCM Interface - per-handle aligned buffer arena
+ *  Copyright (c) 2025 by Jaroslav Kysela <perex@perex.cz>
+ *
+ *  Conversion plugins allocate their private period buffers during
+ *  hw_params and drop them again at hw_free; the lifetimes are
+ *  identical, but plain malloc scatters them over the heap and gives
+ *  no alignment guarantee for the vectorized converters.  The arena
+ *  backs all of them with one page aligned mapping per handle and
+ *  hands out cacheline aligned slices; the mapping is kept across
+ *  reconfiguration while the declared total still fits, so repeated
+ *  hw_params calls stop hitting the allocator at all.
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 2.1 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "pcm_local.h"
+#include <sys/mman.h>
+
+#ifndef DOC_HIDDEN
+
+#define ARENA_HUGE_SIZE	(2UL * 1024 * 1024)
+
+static void *arena_map(size_t *size)
+{
+	void *base;
+
+#ifdef MAP_HUGETLB
+	if (*size >= ARENA_HUGE_SIZE) {
+		size_t hsize = (*size + ARENA_HUGE_SIZE - 1) &
+			       ~(ARENA_HUGE_SIZE - 1);
+		base = mmap(NULL, hsize, PROT_READ|PROT_WRITE,
+			    MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+		if (base != MAP_FAILED) {
+			*size = hsize;
+			return base;
+		}
+		/* no hugepage pool reserved - fall back below */
+	}
+#endif
+	base = mmap(NULL, *size, PROT_READ|PROT_WRITE,
+		    MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED)
+		return NULL;
+#ifdef MADV_HUGEPAGE
+	if (*size >= ARENA_HUGE_SIZE)
+		madvise(base, *size, MADV_HUGEPAGE);
+#endif
+	return base;
+}
+
+/* back the arena with one block of at least the given total size;
+ * the declared needs of all buffers have to be summed up with
+ * SND_PCM_ARENA_SIZE() before the first slice is taken
+ */
+int snd_pcm_arena_setup(snd_pcm_t *pcm, size_t size)
+{
+	size_t psize = sysconf(_SC_PAGE_SIZE);
+
+	size = (size + psize - 1) & ~(psize - 1);
+	pcm->arena.used = 0;
+	if (pcm->arena.base) {
+		if (pcm->arena.size >= size)
+			return 0;	/* reuse across reconfiguration */
+		snd_pcm_arena_free(pcm);
+	}
+	pcm->arena.base = arena_map(&size);
+	if (!pcm->arena.base)
+		return -ENOMEM;
+	pcm->arena.size = size;
+	snd_memstat_update(SND_MEMSTAT_PCM, size, 1);
+	return 0;
+}
+
+/* take one cacheline aligned slice from the arena */
+void *snd_pcm_arena_alloc(snd_pcm_t *pcm, size_t size)
+{
+	char *ptr;
+
+	size = SND_PCM_ARENA_SIZE(size);
+	if (!pcm->arena.base ||
+	    size > pcm->arena.size - pcm->arena.used) {
+		SNDMSG("arena overflow (%zu + %zu > %zu)",
+		       pcm->arena.used, size, pcm->arena.size);
+		return NULL;
+	}
+	ptr = (char *)pcm->arena.base + pcm->arena.used;
+	pcm->arena.used += size;
+	return ptr;
+}
+
+/* forget all slices but keep the backing block for the next setup */
+void snd_pcm_arena_release(snd_pcm_t *pcm)
+{
+	pcm->arena.used = 0;
+}
+
+/* drop the backing block; called when the handle goes away */
+void snd_pcm_arena_free(snd_pcm_t *pcm)
+{
+	if (!pcm->arena.base)
+		return;
+	munmap(pcm->arena.base, pcm->arena.size);
+	snd_memstat_update(SND_MEMSTAT_PCM, -(ssize_t)pcm->arena.size, -1);
+	pcm->arena.base = NULL;
+	pcm->arena.size = 0;
+	pcm->arena.used = 0;
+}
+
+#endif /* DOC_HIDDEN */
@@ -0,0 +1,243 @@
+/**
+ * \file pcm/pcm_clock.c
+ * \ingroup PCM
+ * \brief PCM Clock Drift Model
+ * \author Jaroslav Kysela <perex@perex.cz>
+ * \date 2025
+ *
+ * Estimates the real rate of a PCM clock against the system clock
+ * from (hw_ptr, timestamp) observations.  Bridging two cards needs
+ * their relative drift; feeding one model per card from the positions
+ * the application obtains anyway and dividing the two smoothed ratios
+ * replaces a hand-rolled PLL over snd_pcm_status() timestamps.  The
+ * position prediction also allows skipping hwsync/avail syscalls
+ * between interrupts.
+ */
+/*
+ *  PCM - Clock Drift Model
+ *  Copyright (c) 2025 by Jaroslav Kysela <perex@perex.cz>
+ *
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 2.1 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "pcm_local.h"
+
+#ifndef DOC_HIDDEN
+
+/* below this spacing the timer quantization dominates the estimate */
+#define CLOCK_MODEL_MIN_DT	0.001
+/* instantaneous ratios further off are discontinuities (xrun, restart),
+ * not drift; the model re-anchors without folding them in
+ */
+#define CLOCK_MODEL_MAX_DEV	0.1
+/* steady-state smoothing window in accepted observations */
+#define CLOCK_MODEL_WINDOW	32
+
+struct _snd_pcm_clock_model {
+	unsigned int rate;		/* nominal frame rate */
+	unsigned int count;		/* accepted rate observations */
+	double ratio;			/* smoothed actual/nominal rate */
+	snd_htimestamp_t last_tstamp;	/* anchor of the model line */
+	snd_pcm_uframes_t last_ptr;
+};
+
+static double clock_model_dt(const snd_htimestamp_t *t1,
+			     const snd_htimestamp_t *t0)
+{
+	return (double)(t1->tv_sec - t0->tv_sec) +
+	       (double)(t1->tv_nsec - t0->tv_nsec) * 1.0e-9;
+}
+
+#endif /* DOC_HIDDEN */
+
+/**
+ * \brief get size of #snd_pcm_clock_model_t
+ * \return size in bytes
+ */
+size_t snd_pcm_clock_model_sizeof(void)
+{
+	return sizeof(snd_pcm_clock_model_t);
+}
+
+/**
+ * \brief allocate an invalid #snd_pcm_clock_model_t using standard malloc
+ * \param ptr returned pointer
+ * \return 0 on success otherwise negative error code
+ */
+int snd_pcm_clock_model_malloc(snd_pcm_clock_model_t **ptr)
+{
+	assert(ptr);
+	*ptr = calloc(1, sizeof(snd_pcm_clock_model_t));
+	if (!*ptr)
+		return -ENOMEM;
+	return 0;
+}
+
+/**
+ * \brief frees a previously allocated #snd_pcm_clock_model_t
+ * \param obj pointer to object to free
+ */
+void snd_pcm_clock_model_free(snd_pcm_clock_model_t *obj)
+{
+	free(obj);
+}
+
+/**
+ * \brief initialize a clock model for a stream
+ * \param model Clock model handle
+ * \param rate Nominal frame rate of the stream
+ *
+ * Drops all state; the ratio estimate restarts at exactly 1.0.  Call
+ * it once before the first update and again whenever the stream is
+ * reconfigured to another rate.
+ */
+void snd_pcm_clock_model_reset(snd_pcm_clock_model_t *model, unsigned int rate)
+{
+	assert(model);
+	model->rate = rate;
+	model->count = 0;
+	model->ratio = 1.0;
+}
+
+/**
+ * \brief feed one position observation into a clock model
+ * \param model Clock model handle
+ * \param hw_ptr Current hardware position in frames (monotonic)
+ * \param tstamp Time the position was obtained
+ * \return 0 on success otherwise a negative error code
+ *
+ * The position must grow monotonically between updates; a backward
+ * step or a jump far away from the modelled rate (an xrun or a
+ * restart) re-anchors the model without disturbing the ratio
+ * estimate.  Observations spaced closer than the timer resolution
+ * allows are ignored.  The smoothing starts as a running mean and
+ * turns into an exponential average, so the estimate is usable after
+ * a few periods and still follows slow drift.
+ */
+int snd_pcm_clock_model_update(snd_pcm_clock_model_t *model,
+			       snd_pcm_uframes_t hw_ptr,
+			       const snd_htimestamp_t *tstamp)
+{
+	double dt, inst;
+	snd_pcm_sframes_t df;
+
+	assert(model && tstamp);
+	if (model->rate == 0)
+		return -EINVAL;
+	if (model->count == 0)
+		goto _anchor;
+	dt = clock_model_dt(tstamp, &model->last_tstamp);
+	if (dt < 0.0)
+		return -EINVAL;
+	if (dt < CLOCK_MODEL_MIN_DT)
+		return 0;
+	df = hw_ptr - model->last_ptr;
+	inst = (double)df / ((double)model->rate * dt);
+	if (df < 0 ||
+	    inst < 1.0 - CLOCK_MODEL_MAX_DEV ||
+	    inst > 1.0 + CLOCK_MODEL_MAX_DEV)
+		goto _anchor;	/* discontinuity, not drift */
+	if (model->count < CLOCK_MODEL_WINDOW)
+		model->count++;
+	model->ratio += (inst - model->ratio) / model->count;
+	model->last_tstamp = *tstamp;
+	model->last_ptr = hw_ptr;
+	return 0;
+
+ _anchor:
+	if (model->count == 0)
+		model->count = 1;
+	model->last_tstamp = *tstamp;
+	model->last_ptr = hw_ptr;
+	return 0;
+}
+
+/**
+ * \brief feed the current position of a PCM into a clock model
+ * \param model Clock model handle
+ * \param pcm PCM handle
+ * \return 0 on success otherwise a negative error code
+ *
+ * Refreshes the hardware position and pairs it with the system clock
+ * of the PCM timestamp type.  Using the same system clock for all
+ * models keeps the ratios of several cards comparable, which is what
+ * bridging needs; driver provided timestamps may come from different
+ * clock bases.
+ */
+int snd_pcm_clock_model_feed(snd_pcm_clock_model_t *model, snd_pcm_t *pcm)
+{
+	snd_pcm_sframes_t avail;
+	snd_htimestamp_t tstamp;
+
+	assert(model && pcm);
+	if (CHECK_SANITY(!pcm->setup)) {
+		SNDMSG("PCM not set up");
+		return -EIO;
+	}
+	avail = snd_pcm_avail_update(pcm);
+	if (avail < 0)
+		return avail;
+	gettimestamp(&tstamp, pcm->tstamp_type);
+	return snd_pcm_clock_model_update(model, *pcm->hw.ptr, &tstamp);
+}
+
+/**
+ * \brief get the smoothed rate ratio of a clock model
+ * \param model Clock model handle
+ * \return actual rate relative to the nominal rate
+ *
+ * A value above 1.0 means the stream clock runs fast against the
+ * system clock.  The relative drift of two streams is the quotient
+ * of their ratios, directly usable as a pitch correction for
+ * drift-compensated resampling.  Before enough observations were
+ * accepted the ratio reads exactly 1.0.
+ */
+double snd_pcm_clock_model_ratio(const snd_pcm_clock_model_t *model)
+{
+	assert(model);
+	return model->ratio;
+}
+
+/**
+ * \brief predict the hardware position at a given time
+ * \param model Clock model handle
+ * \param tstamp Time to predict the position for
+ * \param hw_ptr Returned predicted position in frames
+ * \return 0 on success otherwise a negative error code
+ *
+ * Extrapolates the last observation with the smoothed rate.  Between
+ * interrupts this replaces a hwsync syscall at the price of the
+ * model error, which shrinks with every accepted update.  Fails with
+ * -EBADFD before the first observation.
+ */
+int snd_pcm_clock_model_predict(const snd_pcm_clock_model_t *model,
+				const snd_htimestamp_t *tstamp,
+				snd_pcm_uframes_t *hw_ptr)
+{
+	double dt, pos;
+
+	assert(model && tstamp && hw_ptr);
+	if (model->count == 0)
+		return -EBADFD;
+	dt = clock_model_dt(tstamp, &model->last_tstamp);
+	pos = (double)model->last_ptr +
+	      model->ratio * (double)model->rate * dt;
+	if (pos < 0.0)
+		return -EINVAL;
+	*hw_ptr = (snd_pcm_uframes_t)(pos + 0.5);
+	return 0;
+}
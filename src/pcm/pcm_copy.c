@@ -97,11 +97,55 @@ static int snd_pcm_copy_hw_refine(snd_pcm_t *pcm, snd_pcm_hw_params_t *params)
 
 static int snd_pcm_copy_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t *params)
 {
-	return snd_pcm_hw_params_slave(pcm, params,
-				       snd_pcm_copy_hw_refine_cchange,
-				       snd_pcm_copy_hw_refine_sprepare,
-				       snd_pcm_copy_hw_refine_schange,
-				       snd_pcm_generic_hw_params);
+	snd_pcm_copy_t *copy = pcm->private_data;
+	snd_pcm_t *slave = copy->plug.gen.slave;
+	snd_pcm_access_t access;
+	int err;
+
+	err = snd_pcm_hw_params_slave(pcm, params,
+				      snd_pcm_copy_hw_refine_cchange,
+				      snd_pcm_copy_hw_refine_sprepare,
+				      snd_pcm_copy_hw_refine_schange,
+				      snd_pcm_generic_hw_params);
+	if (err < 0)
+		return err;
+	/* When the client ends up with the same mmap layout as the slave
+	 * there is nothing to convert: map the slave buffer directly and
+	 * let the transfer collapse to pointer bookkeeping, saving one
+	 * full buffer copy per period on pass-through streams.
+	 */
+	if (INTERNAL(snd_pcm_hw_params_get_access)(params, &access) < 0)
+		access = SND_PCM_ACCESS_MMAP_COMPLEX;
+	switch (access) {
+	case SND_PCM_ACCESS_MMAP_INTERLEAVED:
+	case SND_PCM_ACCESS_RW_INTERLEAVED:
+		pcm->mmap_shadow = slave->access == SND_PCM_ACCESS_MMAP_INTERLEAVED;
+		break;
+	case SND_PCM_ACCESS_MMAP_NONINTERLEAVED:
+	case SND_PCM_ACCESS_RW_NONINTERLEAVED:
+		pcm->mmap_shadow = slave->access == SND_PCM_ACCESS_MMAP_NONINTERLEAVED;
+		break;
+	default:
+		pcm->mmap_shadow = 0;
+		break;
+	}
+	return 0;
+}
+
+static int snd_pcm_copy_areas_shared(const snd_pcm_channel_area_t *dst_areas,
+				     snd_pcm_uframes_t dst_offset,
+				     const snd_pcm_channel_area_t *src_areas,
+				     snd_pcm_uframes_t src_offset,
+				     unsigned int channels)
+{
+	unsigned int ch;
+	for (ch = 0; ch < channels; ++ch) {
+		if (snd_pcm_channel_area_addr(&dst_areas[ch], dst_offset) !=
+		    snd_pcm_channel_area_addr(&src_areas[ch], src_offset) ||
+		    dst_areas[ch].step != src_areas[ch].step)
+			return 0;
+	}
+	return 1;
 }
 
 static snd_pcm_uframes_t
@@ -115,9 +159,15 @@ snd_pcm_copy_write_areas(snd_pcm_t *pcm,
 {
 	if (size > *slave_sizep)
 		size = *slave_sizep;
-	snd_pcm_areas_copy(slave_areas, slave_offset,
-			   areas, offset,
-			   pcm->channels, size, pcm->format);
+	/* with the shadowed slave buffer both sides alias the same
+	 * memory and there is nothing to move
+	 */
+	if (!(pcm->mmap_shadow &&
+	      snd_pcm_copy_areas_shared(slave_areas, slave_offset,
+					areas, offset, pcm->channels)))
+		snd_pcm_areas_copy(slave_areas, slave_offset,
+				   areas, offset,
+				   pcm->channels, size, pcm->format);
 	*slave_sizep = size;
 	return size;
 }
@@ -133,9 +183,13 @@ snd_pcm_copy_read_areas(snd_pcm_t *pcm,
 {
 	if (size > *slave_sizep)
 		size = *slave_sizep;
-	snd_pcm_areas_copy(areas, offset, 
-			   slave_areas, slave_offset,
-			   pcm->channels, size, pcm->format);
+	if (!(pcm->mmap_shadow &&
+	      snd_pcm_copy_areas_shared(areas, offset,
+					slave_areas, slave_offset,
+					pcm->channels)))
+		snd_pcm_areas_copy(areas, offset,
+				   slave_areas, slave_offset,
+				   pcm->channels, size, pcm->format);
 	*slave_sizep = size;
 	return size;
 }
@@ -187,10 +241,11 @@ int snd_pcm_copy_open(snd_pcm_t **pcmp, const char *name, snd_pcm_t *slave, int
 	snd_pcm_copy_t *copy;
 	int err;
 	assert(pcmp && slave);
-	copy = calloc(1, sizeof(snd_pcm_copy_t));
-	if (!copy) {
-		return -ENOMEM;
-	}
+	err = snd_pcm_new_priv(&pcm, SND_PCM_TYPE_COPY, name, slave->stream,
+			       slave->mode, sizeof(snd_pcm_copy_t),
+			       (void **)&copy);
+	if (err < 0)
+		return err;
 	snd_pcm_plugin_init(&copy->plug);
 	copy->plug.read = snd_pcm_copy_read_areas;
 	copy->plug.write = snd_pcm_copy_write_areas;
@@ -199,15 +254,11 @@ int snd_pcm_copy_open(snd_pcm_t **pcmp, const char *name, snd_pcm_t *slave, int
 	copy->plug.gen.slave = slave;
 	copy->plug.gen.close_slave = close_slave;
 
-	err = snd_pcm_new(&pcm, SND_PCM_TYPE_COPY, name, slave->stream, slave->mode);
-	if (err < 0) {
-		free(copy);
-		return err;
-	}
 	pcm->ops = &snd_pcm_copy_ops;
 	pcm->fast_ops = &snd_pcm_plugin_fast_ops;
 	pcm->private_data = copy;
 	pcm->poll_fd = slave->poll_fd;
+	pcm->poll_dynamic = slave->poll_dynamic;
 	pcm->poll_events = slave->poll_events;
 	pcm->tstamp_type = slave->tstamp_type;
 	snd_pcm_set_hw_ptr(pcm, &copy->plug.hw_ptr, -1, 0);
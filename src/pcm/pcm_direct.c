@@ -56,17 +56,15 @@ union semun {
 };
 #endif
  
-/*
- * FIXME:
- *  add possibility to use futexes here
- */
-
 int snd_pcm_direct_semaphore_create_or_connect(snd_pcm_direct_t *dmix)
 {
 	union semun s;
 	struct semid_ds buf;
 	int i;
 
+	if (dmix->use_futex)
+		return snd_pcm_direct_futex_create_or_connect(dmix);
+
 	dmix->semid = semget(dmix->ipc_key, DIRECT_IPC_SEMS,
 			     IPC_CREAT | dmix->ipc_perm);
 	if (dmix->semid < 0)
@@ -87,6 +85,191 @@ int snd_pcm_direct_semaphore_create_or_connect(snd_pcm_direct_t *dmix)
 	return 0;
 }
 
+/*
+ * Futex-backed variant of the IPC synchronization (ipc_sync futex)
+ *
+ * A small POSIX shm segment keyed by the IPC key holds process-shared
+ * robust mutexes; lock/unlock then stay in user space on the
+ * uncontended path instead of paying a semop() syscall per period.
+ * Robustness against clients dying while mixing is provided by
+ * PTHREAD_MUTEX_ROBUST (the kernel hands the lock over with
+ * EOWNERDEAD), replacing the SEM_UNDO semantics of the SysV variant.
+ * The first creator initializes the mutexes under a state word that is
+ * flipped with an atomic exchange, so late connectors simply wait for
+ * the ready state.
+ */
+
+#ifdef HAVE_LIBPTHREAD
+
+#define DIRECT_FUTEX_INIT	1
+#define DIRECT_FUTEX_READY	2
+
+struct snd_pcm_direct_futex {
+	unsigned int state;
+	pthread_mutex_t mutex[DIRECT_IPC_SEMS];
+	/* shared wakeup: one leader keeps polling the slave timer and
+	 * re-broadcasts every period tick here, the other clients sleep
+	 * on the condition instead of their own timer fd */
+	pthread_mutex_t wake_lock;
+	pthread_cond_t wake_cond;
+	unsigned int wake_seq;
+	pid_t wake_leader;
+};
+
+static void snd_pcm_direct_futex_name(snd_pcm_direct_t *dmix,
+				      char *buf, size_t size)
+{
+	snprintf(buf, size, "/alsa-direct-%x", (unsigned int)dmix->ipc_key);
+}
+
+int snd_pcm_direct_futex_create_or_connect(snd_pcm_direct_t *dmix)
+{
+	struct snd_pcm_direct_futex *fx;
+	char name[64];
+	int fd, i, retries;
+
+	snd_pcm_direct_futex_name(dmix, name, sizeof(name));
+	fd = shm_open(name, O_CREAT | O_RDWR, dmix->ipc_perm);
+	if (fd < 0)
+		return -errno;
+	if (ftruncate(fd, sizeof(*fx)) < 0) {
+		close(fd);
+		return -errno;
+	}
+	if (dmix->ipc_gid >= 0)
+		fchown(fd, -1, dmix->ipc_gid);
+	fx = mmap(NULL, sizeof(*fx), PROT_READ | PROT_WRITE, MAP_SHARED,
+		  fd, 0);
+	if (fx == MAP_FAILED) {
+		close(fd);
+		return -errno;
+	}
+	if (__sync_bool_compare_and_swap(&fx->state, 0, DIRECT_FUTEX_INIT)) {
+		pthread_mutexattr_t attr;
+		pthread_condattr_t cattr;
+
+		pthread_mutexattr_init(&attr);
+		pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+#ifdef PTHREAD_MUTEX_ROBUST
+		pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+#endif
+		for (i = 0; i < DIRECT_IPC_SEMS; i++)
+			pthread_mutex_init(&fx->mutex[i], &attr);
+		pthread_mutex_init(&fx->wake_lock, &attr);
+		pthread_mutexattr_destroy(&attr);
+		pthread_condattr_init(&cattr);
+		pthread_condattr_setpshared(&cattr, PTHREAD_PROCESS_SHARED);
+		pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+		pthread_cond_init(&fx->wake_cond, &cattr);
+		pthread_condattr_destroy(&cattr);
+		fx->wake_seq = 0;
+		fx->wake_leader = 0;
+		__sync_synchronize();
+		fx->state = DIRECT_FUTEX_READY;
+	} else {
+		/* wait shortly for the creator to finish the setup */
+		for (retries = 0; fx->state != DIRECT_FUTEX_READY; retries++) {
+			if (retries > 1000) {
+				munmap(fx, sizeof(*fx));
+				close(fd);
+				return -EIO;
+			}
+			poll(NULL, 0, 1);
+		}
+	}
+	dmix->futex = fx;
+	dmix->futex_fd = fd;
+	return 0;
+}
+
+int snd_pcm_direct_futex_discard(snd_pcm_direct_t *dmix)
+{
+	char name[64];
+	int i;
+
+	if (!dmix->futex)
+		return 0;
+	/* hand the wakeup leadership over; the followers time out of
+	 * their bounded sleep and elect a new leader */
+	if (dmix->wake_leader) {
+		struct snd_pcm_direct_futex *fx = dmix->futex;
+		int err = pthread_mutex_lock(&fx->wake_lock);
+#ifdef PTHREAD_MUTEX_ROBUST
+		if (err == EOWNERDEAD) {
+			pthread_mutex_consistent(&fx->wake_lock);
+			err = 0;
+		}
+#endif
+		if (err == 0) {
+			fx->wake_leader = 0;
+			fx->wake_seq++;
+			pthread_cond_broadcast(&fx->wake_cond);
+			pthread_mutex_unlock(&fx->wake_lock);
+		}
+		dmix->wake_leader = 0;
+	}
+	/* drop our locks before the mapping goes away; the SysV
+	 * counterpart releases them implicitly with IPC_RMID */
+	for (i = 0; i < DIRECT_IPC_SEMS; i++)
+		while (dmix->locked[i] > 0) {
+			pthread_mutex_unlock(&dmix->futex->mutex[i]);
+			dmix->locked[i]--;
+		}
+	snd_pcm_direct_futex_name(dmix, name, sizeof(name));
+	shm_unlink(name);
+	munmap(dmix->futex, sizeof(*dmix->futex));
+	close(dmix->futex_fd);
+	dmix->futex = NULL;
+	dmix->futex_fd = -1;
+	return 0;
+}
+
+int snd_pcm_direct_futex_down(snd_pcm_direct_t *dmix, int sem_num)
+{
+	int err = pthread_mutex_lock(&dmix->futex->mutex[sem_num]);
+
+#ifdef PTHREAD_MUTEX_ROBUST
+	if (err == EOWNERDEAD) {
+		/* previous owner died while mixing; the buffer states
+		 * are repaired by the usual xrun recovery */
+		pthread_mutex_consistent(&dmix->futex->mutex[sem_num]);
+		err = 0;
+	}
+#endif
+	return -err;
+}
+
+int snd_pcm_direct_futex_up(snd_pcm_direct_t *dmix, int sem_num)
+{
+	return -pthread_mutex_unlock(&dmix->futex->mutex[sem_num]);
+}
+
+#else /* !HAVE_LIBPTHREAD */
+
+int snd_pcm_direct_futex_create_or_connect(snd_pcm_direct_t *dmix ATTRIBUTE_UNUSED)
+{
+	return -ENOSYS;
+}
+
+int snd_pcm_direct_futex_discard(snd_pcm_direct_t *dmix ATTRIBUTE_UNUSED)
+{
+	return -ENOSYS;
+}
+
+int snd_pcm_direct_futex_down(snd_pcm_direct_t *dmix ATTRIBUTE_UNUSED,
+			      int sem_num ATTRIBUTE_UNUSED)
+{
+	return -ENOSYS;
+}
+
+int snd_pcm_direct_futex_up(snd_pcm_direct_t *dmix ATTRIBUTE_UNUSED,
+			    int sem_num ATTRIBUTE_UNUSED)
+{
+	return -ENOSYS;
+}
+
+#endif /* HAVE_LIBPTHREAD */
+
 static unsigned int snd_pcm_direct_magic(snd_pcm_direct_t *dmix)
 {
 	if (!dmix->direct_memory_access)
@@ -748,6 +931,29 @@ int snd_pcm_direct_poll_descriptors(snd_pcm_t *pcm, struct pollfd *pfds,
 	return 1;
 }
 
+#ifdef HAVE_LIBPTHREAD
+/* the leader re-broadcasts a period tick to the sleeping followers */
+static void snd_pcm_direct_wake_broadcast(snd_pcm_direct_t *dmix)
+{
+	struct snd_pcm_direct_futex *fx = dmix->futex;
+	int err = pthread_mutex_lock(&fx->wake_lock);
+
+#ifdef PTHREAD_MUTEX_ROBUST
+	if (err == EOWNERDEAD) {
+		pthread_mutex_consistent(&fx->wake_lock);
+		err = 0;
+	}
+#endif
+	if (err)
+		return;
+	fx->wake_seq++;
+	pthread_cond_broadcast(&fx->wake_cond);
+	pthread_mutex_unlock(&fx->wake_lock);
+}
+#endif
+
+static void snd_pcm_direct_adaptive_tune(snd_pcm_direct_t *dmix, snd_pcm_t *pcm);
+
 int snd_pcm_direct_poll_revents(snd_pcm_t *pcm, struct pollfd *pfds, unsigned int nfds, unsigned short *revents)
 {
 	snd_pcm_direct_t *dmix = pcm->private_data;
@@ -799,10 +1005,120 @@ timer_changed:
 			}
 		}
 	}
+	if (dmix->adaptive_wakeup && !(events & POLLERR))
+		snd_pcm_direct_adaptive_tune(dmix, pcm);
 	*revents = events;
+#ifdef HAVE_LIBPTHREAD
+	if (dmix->wake_leader && (events & (POLLIN | POLLOUT)))
+		snd_pcm_direct_wake_broadcast(dmix);
+#endif
 	return 0;
 }
 
+/*
+ * Shared wakeup mode (shared_wakeup option): with many clients on one
+ * slave the kernel timer delivers every period event once per client
+ * fd.  Here a single leader keeps polling its timer as before and
+ * re-broadcasts each tick through a process-shared condition variable
+ * in the futex area; the remaining clients sleep there and leave their
+ * timer fd untouched.  Only blocking waits take this path -
+ * applications polling the descriptors themselves keep the plain
+ * timer semantics.
+ */
+#ifdef HAVE_LIBPTHREAD
+int snd_pcm_direct_wait(snd_pcm_t *pcm, int timeout)
+{
+	snd_pcm_direct_t *dmix = pcm->private_data;
+	struct snd_pcm_direct_futex *fx = dmix->futex;
+	struct timespec end, ts;
+	unsigned int seq;
+	pid_t pid = getpid();
+	int err;
+
+	if (!dmix->shared_wakeup || !fx || timeout == 0)
+		return -ENOSYS;
+	if (timeout > 0) {
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		end.tv_sec += timeout / 1000;
+		end.tv_nsec += (timeout % 1000) * 1000000L;
+		if (end.tv_nsec >= 1000000000L) {
+			end.tv_sec++;
+			end.tv_nsec -= 1000000000L;
+		}
+	}
+	err = pthread_mutex_lock(&fx->wake_lock);
+#ifdef PTHREAD_MUTEX_ROBUST
+	if (err == EOWNERDEAD) {
+		pthread_mutex_consistent(&fx->wake_lock);
+		err = 0;
+	}
+#endif
+	if (err)
+		return -ENOSYS;
+	/* a leader which died without handover is replaced here */
+	if (fx->wake_leader != 0 && fx->wake_leader != pid &&
+	    kill(fx->wake_leader, 0) < 0 && errno == ESRCH)
+		fx->wake_leader = 0;
+	if (fx->wake_leader == 0 || fx->wake_leader == pid) {
+		fx->wake_leader = pid;
+		dmix->wake_leader = 1;
+		pthread_mutex_unlock(&fx->wake_lock);
+		return -ENOSYS;	/* poll the timer fd as usual */
+	}
+	seq = fx->wake_seq;
+	while (fx->wake_seq == seq) {
+		/* bound every sleep so a vanished leader is noticed */
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		ts.tv_nsec += 100000000L;
+		if (ts.tv_nsec >= 1000000000L) {
+			ts.tv_sec++;
+			ts.tv_nsec -= 1000000000L;
+		}
+		if (timeout > 0 &&
+		    (ts.tv_sec > end.tv_sec ||
+		     (ts.tv_sec == end.tv_sec && ts.tv_nsec > end.tv_nsec)))
+			ts = end;
+		err = pthread_cond_timedwait(&fx->wake_cond, &fx->wake_lock, &ts);
+#ifdef PTHREAD_MUTEX_ROBUST
+		if (err == EOWNERDEAD) {
+			pthread_mutex_consistent(&fx->wake_lock);
+			err = 0;
+		}
+#endif
+		if (err == ETIMEDOUT) {
+			if (timeout > 0) {
+				clock_gettime(CLOCK_MONOTONIC, &ts);
+				if (ts.tv_sec > end.tv_sec ||
+				    (ts.tv_sec == end.tv_sec &&
+				     ts.tv_nsec >= end.tv_nsec)) {
+					pthread_mutex_unlock(&fx->wake_lock);
+					return 0;
+				}
+			}
+			if (fx->wake_leader == 0 ||
+			    (kill(fx->wake_leader, 0) < 0 && errno == ESRCH)) {
+				/* take over the timer polling */
+				fx->wake_leader = pid;
+				dmix->wake_leader = 1;
+				pthread_mutex_unlock(&fx->wake_lock);
+				return -ENOSYS;
+			}
+		} else if (err) {
+			pthread_mutex_unlock(&fx->wake_lock);
+			return -ENOSYS;
+		}
+	}
+	pthread_mutex_unlock(&fx->wake_lock);
+	return 1;
+}
+#else /* !HAVE_LIBPTHREAD */
+int snd_pcm_direct_wait(snd_pcm_t *pcm ATTRIBUTE_UNUSED,
+			int timeout ATTRIBUTE_UNUSED)
+{
+	return -ENOSYS;
+}
+#endif
+
 int snd_pcm_direct_info(snd_pcm_t *pcm, snd_pcm_info_t * info)
 {
 	snd_pcm_direct_t *dmix = pcm->private_data;
@@ -1134,6 +1450,15 @@ int snd_pcm_direct_prepare(snd_pcm_t *pcm)
 		break;
 	}
 	snd_pcm_direct_check_interleave(dmix, pcm);
+	/* the sharded sum buffer handles only the plain interleaved
+	 * layout and cannot coexist with classically mixing clients
+	 */
+	if (dmix->type == SND_PCM_TYPE_DMIX &&
+	    dmix->u.dmix.shard >= 0 && !dmix->interleaved) {
+		SNDERR("sum_shards requires the plain interleaved layout "
+		       "(matching channels, no bindings)");
+		return -EINVAL;
+	}
 	dmix->state = SND_PCM_STATE_PREPARED;
 	dmix->appl_ptr = dmix->last_appl_ptr = 0;
 	dmix->hw_ptr = 0;
@@ -1238,6 +1563,7 @@ int snd_pcm_direct_initialize_slave(snd_pcm_direct_t *dmix, snd_pcm_t *spcm, str
 							SND_PCM_FORMAT_S16_BE,
 			SND_PCM_FORMAT_S24_LE,
 			SND_PCM_FORMAT_S24_3LE,
+			SND_PCM_FORMAT_FLOAT,
 			SND_PCM_FORMAT_U8,
 		};
 		snd_pcm_format_t format;
@@ -1472,20 +1798,39 @@ int snd_pcm_direct_initialize_poll_fd(snd_pcm_direct_t *dmix)
 	snd_pcm_info_t info = {0};
 	char name[128];
 	int capture = dmix->type == SND_PCM_TYPE_DSNOOP ? 1 : 0;
+	int card, device, subdevice, ver = 0;
+	unsigned int gen;
 
 	dmix->tread = 1;
 	dmix->timer_need_poll = 0;
 	dmix->timer_ticks = 1;
-	ret = snd_pcm_info(dmix->spcm, &info);
-	if (ret < 0) {
-		SNDERR("unable to info for slave pcm");
-		return ret;
+
+	/* the first client leaves a validated snapshot of the slave timer
+	 * identity in the shared area; joining clients verify the generation
+	 * counter and skip the per-join query ioctls (the open paths hold
+	 * the IPC semaphore, the double read only guards against an
+	 * uninitialized snapshot)
+	 */
+	gen = dmix->shmptr->tmr.generation;
+	card = dmix->shmptr->tmr.card;
+	device = dmix->shmptr->tmr.device;
+	subdevice = dmix->shmptr->tmr.subdevice;
+	ver = dmix->shmptr->tmr.protocol;
+	if (gen == 0 || gen != dmix->shmptr->tmr.generation) {
+		gen = 0;
+		ver = 0;
+		ret = snd_pcm_info(dmix->spcm, &info);
+		if (ret < 0) {
+			SNDERR("unable to info for slave pcm");
+			return ret;
+		}
+		card = snd_pcm_info_get_card(&info);
+		device = snd_pcm_info_get_device(&info);
+		subdevice = snd_pcm_info_get_subdevice(&info);
 	}
 	sprintf(name, "hw:CLASS=%i,SCLASS=0,CARD=%i,DEV=%i,SUBDEV=%i",
 		(int)SND_TIMER_CLASS_PCM,
-		snd_pcm_info_get_card(&info),
-		snd_pcm_info_get_device(&info),
-		snd_pcm_info_get_subdevice(&info) * 2 + capture);
+		card, device, subdevice * 2 + capture);
 	ret = snd_timer_open(&dmix->timer, name,
 			     SND_TIMER_OPEN_NONBLOCK | SND_TIMER_OPEN_TREAD);
 	if (ret < 0) {
@@ -1513,29 +1858,35 @@ int snd_pcm_direct_initialize_poll_fd(snd_pcm_direct_t *dmix)
 	/*
 	 * Some hacks for older kernel drivers
 	 */
-	{
-		int ver = 0;
+	if (gen == 0)
 		ioctl(dmix->poll_fd, SNDRV_TIMER_IOCTL_PVERSION, &ver);
-		/* In older versions, check via poll before read() is needed
-		 * because of the confliction between TIMER_START and
-		 * FIONBIO ioctls.
-		 */
-		if (ver < SNDRV_PROTOCOL_VERSION(2, 0, 4))
-			dmix->timer_need_poll = 1;
-		/*
-		 * In older versions, timer uses pause events instead
-		 * suspend/resume events.
-		 */
-		if (ver < SNDRV_PROTOCOL_VERSION(2, 0, 5)) {
-			dmix->timer_events &= ~((1<<SND_TIMER_EVENT_MSUSPEND) |
-						(1<<SND_TIMER_EVENT_MRESUME));
-			dmix->timer_events |= (1<<SND_TIMER_EVENT_MPAUSE) |
-					      (1<<SND_TIMER_EVENT_MCONTINUE);
-		}
-		/* In older versions, use SND_TIMER_EVENT_START too.
-		 */
-		if (ver < SNDRV_PROTOCOL_VERSION(2, 0, 6))
-			dmix->timer_events |= 1<<SND_TIMER_EVENT_START;
+	/* In older versions, check via poll before read() is needed
+	 * because of the confliction between TIMER_START and
+	 * FIONBIO ioctls.
+	 */
+	if (ver < SNDRV_PROTOCOL_VERSION(2, 0, 4))
+		dmix->timer_need_poll = 1;
+	/*
+	 * In older versions, timer uses pause events instead
+	 * suspend/resume events.
+	 */
+	if (ver < SNDRV_PROTOCOL_VERSION(2, 0, 5)) {
+		dmix->timer_events &= ~((1<<SND_TIMER_EVENT_MSUSPEND) |
+					(1<<SND_TIMER_EVENT_MRESUME));
+		dmix->timer_events |= (1<<SND_TIMER_EVENT_MPAUSE) |
+				      (1<<SND_TIMER_EVENT_MCONTINUE);
+	}
+	/* In older versions, use SND_TIMER_EVENT_START too.
+	 */
+	if (ver < SNDRV_PROTOCOL_VERSION(2, 0, 6))
+		dmix->timer_events |= 1<<SND_TIMER_EVENT_START;
+
+	if (gen == 0) {
+		dmix->shmptr->tmr.card = card;
+		dmix->shmptr->tmr.device = device;
+		dmix->shmptr->tmr.subdevice = subdevice;
+		dmix->shmptr->tmr.protocol = ver;
+		dmix->shmptr->tmr.generation++;
 	}
 	return 0;
 }
@@ -1651,7 +2002,8 @@ int snd_pcm_direct_initialize_secondary_slave(snd_pcm_direct_t *dmix,
 	return 0;
 }
 
-int snd_pcm_direct_set_timer_params(snd_pcm_direct_t *dmix)
+static int snd_pcm_direct_timer_params_ticks(snd_pcm_direct_t *dmix,
+					     unsigned int ticks)
 {
 	snd_timer_params_t params = {0};
 	unsigned int filter;
@@ -1660,7 +2012,7 @@ int snd_pcm_direct_set_timer_params(snd_pcm_direct_t *dmix)
 	snd_timer_params_set_auto_start(&params, 1);
 	if (dmix->type != SND_PCM_TYPE_DSNOOP)
 		snd_timer_params_set_early_event(&params, 1);
-	snd_timer_params_set_ticks(&params, dmix->timer_ticks);
+	snd_timer_params_set_ticks(&params, ticks);
 	if (dmix->tread) {
 		filter = (1<<SND_TIMER_EVENT_TICK) |
 			 dmix->timer_events;
@@ -1671,9 +2023,56 @@ int snd_pcm_direct_set_timer_params(snd_pcm_direct_t *dmix)
 		SNDERR("unable to set timer parameters");
 		return ret;
 	}
+	dmix->timer_ticks_cur = ticks;
 	return 0;
 }
 
+int snd_pcm_direct_set_timer_params(snd_pcm_direct_t *dmix)
+{
+	return snd_pcm_direct_timer_params_ticks(dmix, dmix->timer_ticks);
+}
+
+/*
+ * Adaptive wakeup (adaptive_wakeup option): when a client keeps a deep
+ * buffer queued there is no point in waking it at every slave period
+ * just to advance the pointers.  Scale the programmed timer ticks to
+ * the pointer headroom, keeping one slave period in reserve, and drop
+ * back to the configured rate as soon as the headroom shrinks.  Each
+ * client tunes only its own timer fd, so active and idle clients can
+ * run at different rates on the same slave.
+ */
+static void snd_pcm_direct_adaptive_tune(snd_pcm_direct_t *dmix, snd_pcm_t *pcm)
+{
+	snd_pcm_sframes_t hw_avail;
+	unsigned int ticks, max;
+
+	if (dmix->state != SND_PCM_STATE_RUNNING)
+		return;
+	/* frames the slave may still process before it catches up with
+	 * the application pointer - the safe sleep budget for playback
+	 * and capture alike
+	 */
+	hw_avail = snd_pcm_mmap_hw_avail(pcm);
+	if (hw_avail <= (snd_pcm_sframes_t)dmix->slave_period_size)
+		ticks = dmix->timer_ticks;
+	else
+		ticks = hw_avail / dmix->slave_period_size - 1;
+	max = dmix->timer_ticks * dmix->adaptive_wakeup;
+	if (ticks > max)
+		ticks = max;
+	if (ticks < dmix->timer_ticks)
+		ticks = dmix->timer_ticks;
+	/* reprogramming stops the timer and costs two ioctls; shrink
+	 * immediately for safety but grow only when the wakeup rate at
+	 * least halves
+	 */
+	if (ticks >= dmix->timer_ticks_cur && ticks < dmix->timer_ticks_cur * 2)
+		return;
+	if (snd_pcm_direct_timer_params_ticks(dmix, ticks) < 0)
+		return;
+	snd_timer_start(dmix->timer);
+}
+
 /*
  *  ring buffer operation
  */
@@ -1931,9 +2330,12 @@ int snd_pcm_direct_parse_open_conf(snd_config_t *root, snd_config_t *conf,
 	rec->ipc_key = 0;
 	rec->ipc_perm = 0600;
 	rec->ipc_gid = -1;
+	rec->ipc_sync_futex = 0;
+	rec->shared_wakeup = 0;
 	rec->slowptr = 1;
 	rec->max_periods = 0;
 	rec->var_periodsize = 0;
+	rec->adaptive_wakeup = 0;
 #ifdef LOCKLESS_DMIX_DEFAULT
 	rec->direct_memory_access = 1;
 #else
@@ -1941,6 +2343,9 @@ int snd_pcm_direct_parse_open_conf(snd_config_t *root, snd_config_t *conf,
 #endif
 	rec->hw_ptr_alignment = SND_PCM_HW_PTR_ALIGNMENT_AUTO;
 	rec->tstamp_type = -1;
+	rec->hugetlb = 0;
+	rec->numa_node = -1;
+	rec->sum_shards = 0;
 
 	/* read defaults */
 	if (snd_config_search(root, "defaults.pcm.dmix_max_periods", &n) >= 0) {
@@ -1968,6 +2373,23 @@ int snd_pcm_direct_parse_open_conf(snd_config_t *root, snd_config_t *conf,
 			rec->ipc_key = key;
 			continue;
 		}
+		if (strcmp(id, "ipc_sync") == 0) {
+			const char *str;
+			err = snd_config_get_string(n, &str);
+			if (err < 0) {
+				SNDERR("Invalid type for %s", id);
+				return -EINVAL;
+			}
+			if (strcmp(str, "sysv") == 0)
+				rec->ipc_sync_futex = 0;
+			else if (strcmp(str, "futex") == 0)
+				rec->ipc_sync_futex = 1;
+			else {
+				SNDERR("The field ipc_sync is invalid : %s", str);
+				return -EINVAL;
+			}
+			continue;
+		}
 		if (strcmp(id, "ipc_perm") == 0) {
 			long perm;
 			err = snd_config_get_integer(n, &perm);
@@ -2075,6 +2497,13 @@ int snd_pcm_direct_parse_open_conf(snd_config_t *root, snd_config_t *conf,
 			rec->bindings = n;
 			continue;
 		}
+		if (strcmp(id, "shared_wakeup") == 0) {
+			err = snd_config_get_bool(n);
+			if (err < 0)
+				return err;
+			rec->shared_wakeup = err;
+			continue;
+		}
 		if (strcmp(id, "slowptr") == 0) {
 			err = snd_config_get_bool(n);
 			if (err < 0)
@@ -2097,6 +2526,20 @@ int snd_pcm_direct_parse_open_conf(snd_config_t *root, snd_config_t *conf,
 			rec->var_periodsize = err;
 			continue;
 		}
+		if (strcmp(id, "adaptive_wakeup") == 0) {
+			long val;
+			err = snd_config_get_integer(n, &val);
+			if (err < 0) {
+				SNDERR("The field adaptive_wakeup must be an integer type");
+				return err;
+			}
+			if (val < 0) {
+				SNDERR("Invalid value for adaptive_wakeup");
+				return -EINVAL;
+			}
+			rec->adaptive_wakeup = val;
+			continue;
+		}
 		if (strcmp(id, "direct_memory_access") == 0) {
 			err = snd_config_get_bool(n);
 			if (err < 0)
@@ -2104,6 +2547,38 @@ int snd_pcm_direct_parse_open_conf(snd_config_t *root, snd_config_t *conf,
 			rec->direct_memory_access = err;
 			continue;
 		}
+		if (strcmp(id, "hugetlb") == 0) {
+			err = snd_config_get_bool(n);
+			if (err < 0)
+				return err;
+			rec->hugetlb = err;
+			continue;
+		}
+		if (strcmp(id, "numa_node") == 0) {
+			long val;
+			err = snd_config_get_integer(n, &val);
+			if (err < 0) {
+				SNDERR("The field numa_node must be an integer type");
+				return err;
+			}
+			rec->numa_node = val;
+			continue;
+		}
+		if (strcmp(id, "sum_shards") == 0) {
+			long val;
+			err = snd_config_get_integer(n, &val);
+			if (err < 0) {
+				SNDERR("The field sum_shards must be an integer type");
+				return err;
+			}
+			if (val < 0 || val > SND_PCM_DIRECT_SUM_SHARDS_MAX) {
+				SNDERR("Invalid value for sum_shards (0-%d)",
+				       SND_PCM_DIRECT_SUM_SHARDS_MAX);
+				return -EINVAL;
+			}
+			rec->sum_shards = val;
+			continue;
+		}
 		SNDERR("Unknown field %s", id);
 		return -EINVAL;
 	}
@@ -2165,7 +2640,22 @@ int _snd_pcm_direct_new(snd_pcm_t **pcmp, snd_pcm_direct_t **_dmix, int type,
 	dmix->ipc_perm = opts->ipc_perm;
 	dmix->ipc_gid = opts->ipc_gid;
 	dmix->tstamp_type = opts->tstamp_type;
+	dmix->use_futex = opts->ipc_sync_futex;
+	dmix->shared_wakeup = opts->shared_wakeup;
+	dmix->adaptive_wakeup = opts->adaptive_wakeup;
+#ifndef HAVE_LIBPTHREAD
+	if (dmix->use_futex) {
+		SNDERR("ipc_sync futex unsupported, falling back to sysv");
+		dmix->use_futex = 0;
+	}
+#endif
+	if (dmix->shared_wakeup && !dmix->use_futex) {
+		SNDERR("shared_wakeup requires ipc_sync futex, ignored");
+		dmix->shared_wakeup = 0;
+	}
 	dmix->semid = -1;
+	dmix->futex = NULL;
+	dmix->futex_fd = -1;
 	dmix->shmid = -1;
 	dmix->shmptr = (void *) -1;
 	dmix->type = type;
@@ -28,6 +28,8 @@
 #define SEC_TO_MS               1000
 /* slave_period time for low latency requirements in ms */
 #define LOW_LATENCY_PERIOD_TIME 10
+/* max clients of a sharded sum buffer (see pcm_dmix_shard.c) */
+#define SND_PCM_DIRECT_SUM_SHARDS_MAX	64
 
 
 typedef void (mix_areas_t)(unsigned int size,
@@ -55,6 +57,19 @@ typedef void (mix_areas_u8_t)(unsigned int size,
 			      volatile signed int *sum, size_t dst_step,
 			      size_t src_step, size_t sum_step);
 
+/* a run of adjacent client channels bound to adjacent slave channels */
+typedef struct {
+	unsigned int chn;	/* first client channel */
+	unsigned int dchn;	/* first slave channel */
+	unsigned int count;	/* run length in channels */
+} snd_pcm_direct_bind_run_t;
+
+/* the sum slots carry float bit patterns for a float slave format */
+typedef void (mix_areas_fl_t)(unsigned int size,
+			      volatile float *dst, float *src,
+			      volatile float *sum, size_t dst_step,
+			      size_t src_step, size_t sum_step);
+
 typedef enum snd_pcm_direct_hw_ptr_alignment {
 	SND_PCM_HW_PTR_ALIGNMENT_NO = 0,	/* use the hw_ptr as is and do no rounding */
 	SND_PCM_HW_PTR_ALIGNMENT_ROUNDUP = 1,	/* round the slave_appl_ptr up to slave_period */
@@ -120,6 +135,16 @@ typedef struct {
 		unsigned int sample_bits;
 		unsigned int frame_bits;
 	} s;
+	struct {
+		/* slave timer identity, validated and cached by the first
+		 * client so that joining clients can skip the per-join
+		 * query ioctls */
+		unsigned int generation;	/* 0 = snapshot not valid yet */
+		int card;
+		int device;
+		int subdevice;
+		int protocol;			/* timer protocol version */
+	} tmr;
 	union {
 		struct {
 			unsigned long long chn_mask;
@@ -127,14 +152,36 @@ typedef struct {
 	} u;
 } snd_pcm_direct_share_t;
 
+/* directory at the start of a sharded sum buffer; shared among the
+ * clients, so be careful to be 32/64bit compatible!
+ */
+typedef struct {
+	unsigned int magic;			/* magic number */
+	unsigned int nshards;			/* number of accumulation planes */
+	unsigned long long inuse;		/* bitmap of claimed slots */
+	struct {
+		int pid;			/* owner, for crashed-client recovery */
+		unsigned int seq;		/* odd while the plane is written */
+		unsigned long long appl;	/* end of the valid window (slave position) */
+		unsigned char pad[48];		/* keep the slots on own cachelines */
+	} slot[SND_PCM_DIRECT_SUM_SHARDS_MAX];
+} snd_pcm_direct_shard_head_t;
+
 typedef struct snd_pcm_direct snd_pcm_direct_t;
 
+struct snd_pcm_direct_futex;
+
 struct snd_pcm_direct {
 	snd_pcm_type_t type;		/* type (dmix, dsnoop, dshare) */
 	key_t ipc_key;			/* IPC key for semaphore and memory */
 	mode_t ipc_perm;		/* IPC socket permissions */
 	int ipc_gid;			/* IPC socket gid */
 	int semid;			/* IPC global semaphore identification */
+	int use_futex;			/* futex-backed IPC synchronization */
+	struct snd_pcm_direct_futex *futex; /* mapped futex area (or NULL) */
+	int futex_fd;			/* backing fd of the futex area */
+	int shared_wakeup;		/* followers sleep on the shared wakeup word */
+	int wake_leader;		/* this client polls the timer and broadcasts */
 	int locked[DIRECT_IPC_SEMS];	/* local lock counter */
 	int shmid;			/* IPC global shared memory identification */
 	snd_pcm_direct_share_t *shmptr;	/* pointer to shared memory area */
@@ -161,6 +208,8 @@ struct snd_pcm_direct {
 	int timer_need_poll: 1;
 	unsigned int timer_events;
 	unsigned int timer_ticks;
+	unsigned int timer_ticks_cur;	/* tick count currently programmed */
+	unsigned int adaptive_wakeup;	/* max tick scaling factor, 0 = off */
 	int server_fd;
 	pid_t server_pid;
 	snd_timer_t *timer; 		/* timer used as poll_fd */
@@ -174,6 +223,9 @@ struct snd_pcm_direct {
 	int direct_memory_access;	/* use arch-optimized buffer RW */
 	snd_pcm_direct_hw_ptr_alignment_t hw_ptr_alignment;
 	int tstamp_type;		/* cached from conf, can be -1(default) on top of real types */
+	int hugetlb;			/* back the sum buffer with huge pages */
+	int numa_node;			/* bind the sum buffer to a NUMA node, -1 = default */
+	int sum_shards;			/* number of sum buffer shards, 0 = one shared sum buffer */
 	union {
 		struct {
 			int shmid_sum;			/* IPC global sum ring buffer memory identification */
@@ -182,14 +234,23 @@ struct snd_pcm_direct {
 			mix_areas_32_t *mix_areas_32;
 			mix_areas_24_t *mix_areas_24;
 			mix_areas_u8_t *mix_areas_u8;
+			mix_areas_fl_t *mix_areas_fl;
 			mix_areas_16_t *remix_areas_16;
 			mix_areas_32_t *remix_areas_32;
 			mix_areas_24_t *remix_areas_24;
 			mix_areas_u8_t *remix_areas_u8;
+			mix_areas_fl_t *remix_areas_fl;
 			unsigned int use_sem;
+			int shard;			/* own shard slot, -1 = shared sum buffer */
+			snd_pcm_direct_shard_head_t *shard_head; /* directory in the sum area */
+			signed int *shard_plane;	/* own accumulation plane */
 		} dmix;
 		struct {
 			unsigned long long chn_mask;
+			/* contiguous binding runs precomputed at open time
+			 * for the batch copy path, NULL = per-channel copies */
+			snd_pcm_direct_bind_run_t *runs;
+			unsigned int nruns;
 		} dshare;
 	} u;
 	void (*server_free)(snd_pcm_direct_t *direct);
@@ -198,6 +259,14 @@ struct snd_pcm_direct {
 /* make local functions really local */
 #define snd_pcm_direct_semaphore_create_or_connect \
 	snd1_pcm_direct_semaphore_create_or_connect
+#define snd_pcm_direct_futex_create_or_connect \
+	snd1_pcm_direct_futex_create_or_connect
+#define snd_pcm_direct_futex_discard \
+	snd1_pcm_direct_futex_discard
+#define snd_pcm_direct_futex_down \
+	snd1_pcm_direct_futex_down
+#define snd_pcm_direct_futex_up \
+	snd1_pcm_direct_futex_up
 #define snd_pcm_direct_shm_create_or_connect \
 	snd1_pcm_direct_shm_create_or_connect
 #define snd_pcm_direct_shm_discard \
@@ -228,6 +297,8 @@ struct snd_pcm_direct {
 	snd1_pcm_direct_poll_descriptors
 #define snd_pcm_direct_poll_revents \
 	snd1_pcm_direct_poll_revents
+#define snd_pcm_direct_wait \
+	snd1_pcm_direct_wait
 #define snd_pcm_direct_info \
 	snd1_pcm_direct_info
 #define snd_pcm_direct_hw_refine \
@@ -272,9 +343,15 @@ struct snd_pcm_direct {
 	snd1_pcm_direct_slave_recover
 
 int snd_pcm_direct_semaphore_create_or_connect(snd_pcm_direct_t *dmix);
+int snd_pcm_direct_futex_create_or_connect(snd_pcm_direct_t *dmix);
+int snd_pcm_direct_futex_discard(snd_pcm_direct_t *dmix);
+int snd_pcm_direct_futex_down(snd_pcm_direct_t *dmix, int sem_num);
+int snd_pcm_direct_futex_up(snd_pcm_direct_t *dmix, int sem_num);
 
 static inline int snd_pcm_direct_semaphore_discard(snd_pcm_direct_t *dmix)
 {
+	if (dmix->use_futex)
+		return snd_pcm_direct_futex_discard(dmix);
 	if (dmix->semid >= 0) {
 		if (semctl(dmix->semid, 0, IPC_RMID, NULL) < 0)
 			return -errno;
@@ -285,23 +362,35 @@ static inline int snd_pcm_direct_semaphore_discard(snd_pcm_direct_t *dmix)
 
 static inline int snd_pcm_direct_semaphore_down(snd_pcm_direct_t *dmix, int sem_num)
 {
-	struct sembuf op[2] = { { sem_num, 0, 0 }, { sem_num, 1, SEM_UNDO } };
-	int err = semop(dmix->semid, op, 2);
+	int err;
+	snd_trace2(dmix_sem_wait, dmix, sem_num);
+	if (dmix->use_futex)
+		err = snd_pcm_direct_futex_down(dmix, sem_num);
+	else {
+		struct sembuf op[2] = { { sem_num, 0, 0 }, { sem_num, 1, SEM_UNDO } };
+		err = semop(dmix->semid, op, 2);
+		if (err == -1)
+			err = -errno;
+	}
 	if (err == 0)
 		dmix->locked[sem_num]++;
-	else if (err == -1)
-		err = -errno;
+	snd_trace3(dmix_sem_acquired, dmix, sem_num, err);
 	return err;
 }
 
 static inline int snd_pcm_direct_semaphore_up(snd_pcm_direct_t *dmix, int sem_num)
 {
-	struct sembuf op = { sem_num, -1, SEM_UNDO | IPC_NOWAIT };
-	int err = semop(dmix->semid, &op, 1);
+	int err;
+	if (dmix->use_futex)
+		err = snd_pcm_direct_futex_up(dmix, sem_num);
+	else {
+		struct sembuf op = { sem_num, -1, SEM_UNDO | IPC_NOWAIT };
+		err = semop(dmix->semid, &op, 1);
+		if (err == -1)
+			err = -errno;
+	}
 	if (err == 0)
 		dmix->locked[sem_num]--;
-	else if (err == -1)
-		err = -errno;
 	return err;
 }
 
@@ -332,6 +421,7 @@ int snd_pcm_direct_async(snd_pcm_t *pcm, int sig, pid_t pid);
 int snd_pcm_direct_poll_descriptors(snd_pcm_t *pcm, struct pollfd *pfds,
 				    unsigned int space);
 int snd_pcm_direct_poll_revents(snd_pcm_t *pcm, struct pollfd *pfds, unsigned int nfds, unsigned short *revents);
+int snd_pcm_direct_wait(snd_pcm_t *pcm, int timeout);
 int snd_pcm_direct_info(snd_pcm_t *pcm, snd_pcm_info_t * info);
 int snd_pcm_direct_hw_refine(snd_pcm_t *pcm, snd_pcm_hw_params_t *params);
 int snd_pcm_direct_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t * params);
@@ -360,12 +450,18 @@ struct snd_pcm_direct_open_conf {
 	key_t ipc_key;
 	mode_t ipc_perm;
 	int ipc_gid;
+	int ipc_sync_futex;
+	int shared_wakeup;
 	int slowptr;
 	int max_periods;
 	int var_periodsize;
+	int adaptive_wakeup;
 	int direct_memory_access;
 	snd_pcm_direct_hw_ptr_alignment_t hw_ptr_alignment;
 	int tstamp_type;
+	int hugetlb;
+	int numa_node;
+	int sum_shards;
 	snd_config_t *slave;
 	snd_config_t *bindings;
 };
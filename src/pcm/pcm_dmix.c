@@ -44,6 +44,7 @@
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
 #include "pcm_direct.h"
 
 #ifndef PIC
@@ -63,20 +64,84 @@ const char *_snd_module_pcm_dmix = "";
 static int shm_sum_discard(snd_pcm_direct_t *dmix);
 
 /*
- *  sum ring buffer shared memory area 
+ *  optionally the sum buffer is split into per-client shards
  */
+
+#include "pcm_dmix_shard.c"
+
+/*
+ *  sum ring buffer shared memory area
+ */
+
+#ifdef SHM_HUGETLB
+/* default huge page size, needed to round up the segment size */
+static size_t huge_page_size(void)
+{
+	size_t size = 2048 * 1024;
+	char line[128];
+	FILE *fp;
+	long kb;
+
+	fp = fopen("/proc/meminfo", "r");
+	if (!fp)
+		return size;
+	while (fgets(line, sizeof(line), fp)) {
+		if (sscanf(line, "Hugepagesize: %ld kB", &kb) == 1) {
+			size = (size_t)kb * 1024;
+			break;
+		}
+	}
+	fclose(fp);
+	return size;
+}
+#endif
+
+/* bind the attached sum buffer to the configured NUMA node (best effort) */
+static void shm_sum_numa_bind(snd_pcm_direct_t *dmix, size_t size)
+{
+#ifdef __NR_mbind
+	unsigned long nodemask[128 / sizeof(unsigned long)] = { 0 };
+	unsigned int node = dmix->numa_node;
+
+	if (dmix->numa_node < 0)
+		return;
+	if (node >= sizeof(nodemask) * 8) {
+		SNDERR("numa_node %u out of range", node);
+		return;
+	}
+	nodemask[node / (sizeof(unsigned long) * 8)] |=
+		1UL << (node % (sizeof(unsigned long) * 8));
+	/* MPOL_BIND = 2, avoiding a libnuma dependency */
+	if (syscall(__NR_mbind, dmix->u.dmix.sum_buffer, size, 2,
+		    nodemask, sizeof(nodemask) * 8 + 1, 0) < 0)
+		SNDERR("unable to bind sum buffer to NUMA node %u", node);
+#endif
+}
+
 static int shm_sum_create_or_connect(snd_pcm_direct_t *dmix)
 {
 	struct shmid_ds buf;
 	int tmpid, err;
 	size_t size;
 
-	size = dmix->shmptr->s.channels *
-	       dmix->shmptr->s.buffer_size *
-	       sizeof(signed int);	
+	size = shard_sum_size(dmix);
 retryshm:
-	dmix->u.dmix.shmid_sum = shmget(dmix->ipc_key + 1, size,
-					IPC_CREAT | dmix->ipc_perm);
+	dmix->u.dmix.shmid_sum = -1;
+#ifdef SHM_HUGETLB
+	if (dmix->hugetlb) {
+		size_t hsize = huge_page_size();
+
+		size = (size + hsize - 1) & ~(hsize - 1);
+		dmix->u.dmix.shmid_sum = shmget(dmix->ipc_key + 1, size,
+						IPC_CREAT | SHM_HUGETLB |
+						dmix->ipc_perm);
+	}
+#endif
+	/* huge pages may be unavailable or not reserved; fall back to
+	 * the plain segment */
+	if (dmix->u.dmix.shmid_sum < 0)
+		dmix->u.dmix.shmid_sum = shmget(dmix->ipc_key + 1, size,
+						IPC_CREAT | dmix->ipc_perm);
 	err = -errno;
 	if (dmix->u.dmix.shmid_sum < 0) {
 		if (errno == EINVAL)
@@ -104,6 +169,7 @@ retryshm:
 		return err;
 	}
 	mlock(dmix->u.dmix.sum_buffer, size);
+	shm_sum_numa_bind(dmix, size);
 	return 0;
 }
 
@@ -114,6 +180,7 @@ static int shm_sum_discard(snd_pcm_direct_t *dmix)
 
 	if (dmix->u.dmix.shmid_sum < 0)
 		return -EINVAL;
+	shard_sum_release(dmix);
 	if (dmix->u.dmix.sum_buffer != (void *) -1 && shmdt(dmix->u.dmix.sum_buffer) < 0)
 		return -errno;
 	dmix->u.dmix.sum_buffer = (void *) -1;
@@ -157,12 +224,18 @@ static void mix_areas(snd_pcm_direct_t *dmix,
 		      const snd_pcm_channel_area_t *dst_areas,
 		      snd_pcm_uframes_t src_ofs,
 		      snd_pcm_uframes_t dst_ofs,
+		      snd_pcm_uframes_t dst_pos,
 		      snd_pcm_uframes_t size)
 {
 	unsigned int src_step, dst_step;
 	unsigned int chn, dchn, channels, sample_size;
 	mix_areas_t *do_mix_areas;
-	
+
+	if (dmix->u.dmix.shard >= 0) {
+		shard_mix_areas(dmix, src_areas, dst_areas, src_ofs, dst_ofs,
+				dst_pos, size, 0);
+		return;
+	}
 	channels = dmix->channels;
 	switch (dmix->shmptr->s.format) {
 	case SND_PCM_FORMAT_S16_LE:
@@ -187,6 +260,11 @@ static void mix_areas(snd_pcm_direct_t *dmix,
 		sample_size = 1;
 		do_mix_areas = (mix_areas_t *)dmix->u.dmix.mix_areas_u8;
 		break;
+	case SND_PCM_FORMAT_FLOAT_LE:
+	case SND_PCM_FORMAT_FLOAT_BE:
+		sample_size = 4;
+		do_mix_areas = (mix_areas_t *)dmix->u.dmix.mix_areas_fl;
+		break;
 	default:
 		return;
 	}
@@ -225,12 +303,18 @@ static void remix_areas(snd_pcm_direct_t *dmix,
 			const snd_pcm_channel_area_t *dst_areas,
 			snd_pcm_uframes_t src_ofs,
 			snd_pcm_uframes_t dst_ofs,
+			snd_pcm_uframes_t dst_pos,
 			snd_pcm_uframes_t size)
 {
 	unsigned int src_step, dst_step;
 	unsigned int chn, dchn, channels, sample_size;
 	mix_areas_t *do_remix_areas;
-	
+
+	if (dmix->u.dmix.shard >= 0) {
+		shard_mix_areas(dmix, src_areas, dst_areas, src_ofs, dst_ofs,
+				dst_pos, size, 1);
+		return;
+	}
 	channels = dmix->channels;
 	switch (dmix->shmptr->s.format) {
 	case SND_PCM_FORMAT_S16_LE:
@@ -255,6 +339,11 @@ static void remix_areas(snd_pcm_direct_t *dmix,
 		sample_size = 1;
 		do_remix_areas = (mix_areas_t *)dmix->u.dmix.remix_areas_u8;
 		break;
+	case SND_PCM_FORMAT_FLOAT_LE:
+	case SND_PCM_FORMAT_FLOAT_BE:
+		sample_size = 4;
+		do_remix_areas = (mix_areas_t *)dmix->u.dmix.remix_areas_fl;
+		break;
 	default:
 		return;
 	}
@@ -312,10 +401,10 @@ static void dmix_up_sem(snd_pcm_direct_t *dmix)
 static void snd_pcm_dmix_sync_area(snd_pcm_t *pcm)
 {
 	snd_pcm_direct_t *dmix = pcm->private_data;
-	snd_pcm_uframes_t slave_hw_ptr, slave_appl_ptr, slave_size;
+	snd_pcm_uframes_t slave_hw_ptr, slave_appl_ptr, slave_pos, slave_size;
 	snd_pcm_uframes_t appl_ptr, size, transfer;
 	const snd_pcm_channel_area_t *src_areas, *dst_areas;
-	
+
 	/* calculate the size to transfer */
 	/* check the available size in the local buffer
 	 * last_appl_ptr keeps the last updated position
@@ -362,6 +451,7 @@ static void snd_pcm_dmix_sync_area(snd_pcm_t *pcm)
 	dmix->last_appl_ptr += size;
 	dmix->last_appl_ptr %= pcm->boundary;
 	slave_appl_ptr = dmix->slave_appl_ptr % dmix->slave_buffer_size;
+	slave_pos = dmix->slave_appl_ptr;
 	dmix->slave_appl_ptr += size;
 	dmix->slave_appl_ptr %= dmix->slave_boundary;
 	dmix_down_sem(dmix);
@@ -371,12 +461,15 @@ static void snd_pcm_dmix_sync_area(snd_pcm_t *pcm)
 			transfer = pcm->buffer_size - appl_ptr;
 		if (slave_appl_ptr + transfer > dmix->slave_buffer_size)
 			transfer = dmix->slave_buffer_size - slave_appl_ptr;
-		mix_areas(dmix, src_areas, dst_areas, appl_ptr, slave_appl_ptr, transfer);
+		mix_areas(dmix, src_areas, dst_areas, appl_ptr, slave_appl_ptr,
+			  slave_pos, transfer);
 		size -= transfer;
 		if (! size)
 			break;
 		slave_appl_ptr += transfer;
 		slave_appl_ptr %= dmix->slave_buffer_size;
+		slave_pos += transfer;
+		slave_pos %= dmix->slave_boundary;
 		appl_ptr += transfer;
 		appl_ptr %= pcm->buffer_size;
 	}
@@ -671,7 +764,7 @@ static snd_pcm_sframes_t snd_pcm_dmix_rewindable(snd_pcm_t *pcm)
 static snd_pcm_sframes_t snd_pcm_dmix_rewind(snd_pcm_t *pcm, snd_pcm_uframes_t frames)
 {
 	snd_pcm_direct_t *dmix = pcm->private_data;
-	snd_pcm_uframes_t slave_appl_ptr, slave_size;
+	snd_pcm_uframes_t slave_appl_ptr, slave_pos, slave_size;
 	snd_pcm_uframes_t appl_ptr, size, transfer, result, frames_to_remix;
 	int err;
 	const snd_pcm_channel_area_t *src_areas, *dst_areas;
@@ -723,6 +816,7 @@ static snd_pcm_sframes_t snd_pcm_dmix_rewind(snd_pcm_t *pcm, snd_pcm_uframes_t f
 	dmix->slave_appl_ptr -= size;
 	dmix->slave_appl_ptr %= dmix->slave_boundary;
 	slave_appl_ptr = dmix->slave_appl_ptr % dmix->slave_buffer_size;
+	slave_pos = dmix->slave_appl_ptr;
 	dmix_down_sem(dmix);
 	for (;;) {
 		transfer = size;
@@ -730,12 +824,15 @@ static snd_pcm_sframes_t snd_pcm_dmix_rewind(snd_pcm_t *pcm, snd_pcm_uframes_t f
 			transfer = pcm->buffer_size - appl_ptr;
 		if (slave_appl_ptr + transfer > dmix->slave_buffer_size)
 			transfer = dmix->slave_buffer_size - slave_appl_ptr;
-		remix_areas(dmix, src_areas, dst_areas, appl_ptr, slave_appl_ptr, transfer);
+		remix_areas(dmix, src_areas, dst_areas, appl_ptr, slave_appl_ptr,
+			    slave_pos, transfer);
 		size -= transfer;
 		if (! size)
 			break;
 		slave_appl_ptr += transfer;
 		slave_appl_ptr %= dmix->slave_buffer_size;
+		slave_pos += transfer;
+		slave_pos %= dmix->slave_boundary;
 		appl_ptr += transfer;
 		appl_ptr %= pcm->buffer_size;
 	}
@@ -940,6 +1037,7 @@ static const snd_pcm_fast_ops_t snd_pcm_dmix_fast_ops = {
 	.poll_descriptors = snd_pcm_direct_poll_descriptors,
 	.poll_descriptors_count = NULL,
 	.poll_revents = snd_pcm_dmix_poll_revents,
+	.wait = snd_pcm_direct_wait,
 };
 
 /**
@@ -989,6 +1087,10 @@ int snd_pcm_dmix_open(snd_pcm_t **pcmp, const char *name,
 	dmix->hw_ptr_alignment = opts->hw_ptr_alignment;
 	dmix->sync_ptr = snd_pcm_dmix_sync_ptr;
 	dmix->direct_memory_access = opts->direct_memory_access;
+	dmix->hugetlb = opts->hugetlb;
+	dmix->numa_node = opts->numa_node;
+	dmix->sum_shards = opts->sum_shards;
+	dmix->u.dmix.shard = -1;
 
  retry:
 	if (first_instance) {
@@ -1079,6 +1181,12 @@ int snd_pcm_dmix_open(snd_pcm_t **pcmp, const char *name,
 		goto _err;
 	}
 
+	ret = shard_sum_claim(dmix);
+	if (ret < 0) {
+		SNDERR("unable to claim a sum buffer shard");
+		goto _err;
+	}
+
 	ret = snd_pcm_direct_initialize_poll_fd(dmix);
 	if (ret < 0) {
 		SNDERR("unable to initialize poll_fd");
@@ -1139,6 +1247,13 @@ pcm.name {
 	ipc_key INT		# unique IPC key
 	ipc_key_add_uid BOOL	# add current uid to unique IPC key
 	ipc_perm INT		# IPC permissions (octal, default 0600)
+	ipc_sync STR		# IPC synchronization primitive
+				# sysv (default) or futex
+	shared_wakeup BOOL	# one client polls the period timer and wakes
+				# the others (requires ipc_sync futex)
+	adaptive_wakeup INT	# scale the period timer wakeups up to INT
+				# times when the client has deep buffered
+				# headroom (default 0 = fixed wakeup rate)
 	hw_ptr_alignment STR	# Slave application and hw pointer alignment type
 				# STR can be one of the below strings :
 				# no (or off)
@@ -1148,6 +1263,12 @@ pcm.name {
 	tstamp_type STR		# timestamp type
 				# STR can be one of the below strings :
 				# default, gettimeofday, monotonic, monotonic_raw
+	hugetlb BOOL		# back the sum buffer with huge pages
+				# (best effort, falls back to small pages)
+	numa_node INT		# bind the sum buffer to the given NUMA node
+				# (best effort, default -1 = no binding)
+	sum_shards INT		# split the sum buffer into per-client shards
+				# (default 0 = one shared sum buffer)
 	slave STR
 	# or
 	slave {			# Slave definition
@@ -1201,6 +1322,15 @@ the possible configurations:
   case of a dependency to another sound device (e.g. forwarding of
   microphone to speaker). Else "no" will be chosen.
 
+<code>sum_shards</code> splits the mixing sum buffer into the given
+number of per-client accumulation planes.  The clients then add their
+samples with plain stores instead of atomic read-modify-write cycles
+on shared cachelines, which cuts the cache coherence traffic with many
+concurrent streams at the cost of a larger shared memory segment.  The
+value limits the number of concurrently connected clients and must be
+the same for all of them; the clients are required to use the plain
+interleaved layout (channels matching the slave, no bindings).
+
 Note that the dmix plugin itself supports only a single configuration.
 That is, it supports only the fixed rate (default 48000), format
 (\c S16), channels (2), and period_time (125000).
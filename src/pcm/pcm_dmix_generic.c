@@ -117,12 +117,18 @@ static void mix_select_callbacks(snd_pcm_direct_t *dmix)
 
 #else
 
-/* non-concurrent version, supporting both endians */
+/* non-concurrent version, supporting both endians;
+ * float is mixed natively only, a swapped float slave makes no sense */
+#ifdef SNDRV_LITTLE_ENDIAN
+#define generic_dmix_float_format (1ULL << SND_PCM_FORMAT_FLOAT_LE)
+#else
+#define generic_dmix_float_format (1ULL << SND_PCM_FORMAT_FLOAT_BE)
+#endif
 #define generic_dmix_supported_format \
 	((1ULL << SND_PCM_FORMAT_S16_LE) | (1ULL << SND_PCM_FORMAT_S32_LE) |\
 	 (1ULL << SND_PCM_FORMAT_S16_BE) | (1ULL << SND_PCM_FORMAT_S32_BE) |\
 	 (1ULL << SND_PCM_FORMAT_S24_LE) | (1ULL << SND_PCM_FORMAT_S24_3LE) | \
-	 (1ULL << SND_PCM_FORMAT_U8))
+	 (1ULL << SND_PCM_FORMAT_U8) | generic_dmix_float_format)
 
 #include "bswap.h"
 
@@ -453,6 +459,63 @@ static void generic_remix_areas_24(unsigned int size,
 	}
 }
 
+/* native endian float; the sum slot carries the float sum bit pattern
+ * and the addition needs no saturation */
+static void generic_mix_areas_fl(unsigned int size,
+				 volatile float *dst,
+				 float *src,
+				 volatile float *sum,
+				 size_t dst_step,
+				 size_t src_step,
+				 size_t sum_step)
+{
+	register float sample;
+
+	for (;;) {
+		sample = *src;
+		if (*dst == 0) {
+			*sum = sample;
+			*dst = sample;
+		} else {
+			sample += *sum;
+			*sum = sample;
+			*dst = sample;
+		}
+		if (!--size)
+			return;
+		src = (float *) ((char *)src + src_step);
+		dst = (float *) ((char *)dst + dst_step);
+		sum = (float *) ((char *)sum + sum_step);
+	}
+}
+
+static void generic_remix_areas_fl(unsigned int size,
+				   volatile float *dst,
+				   float *src,
+				   volatile float *sum,
+				   size_t dst_step,
+				   size_t src_step,
+				   size_t sum_step)
+{
+	register float sample;
+
+	for (;;) {
+		sample = *src;
+		if (*dst == 0) {
+			*sum = -sample;
+			*dst = -sample;
+		} else {
+			*sum = sample = *sum - sample;
+			*dst = sample;
+		}
+		if (!--size)
+			return;
+		src = (float *) ((char *)src + src_step);
+		dst = (float *) ((char *)dst + dst_step);
+		sum = (float *) ((char *)sum + sum_step);
+	}
+}
+
 static void generic_mix_areas_u8(unsigned int size,
 				 volatile unsigned char *dst,
 				 unsigned char *src,
@@ -512,11 +575,178 @@ static void generic_remix_areas_u8(unsigned int size,
 }
 
 
+/*
+ * Vectorized kernels for the serialized mixing path.  The generic
+ * callbacks run with the semaphore held, so unlike the lock-prefixed
+ * x86 per-sample code no atomicity is required and whole vectors can
+ * be processed at once.  The per-sample "fresh slot" test (*dst == 0)
+ * turns into a compare/select; the 16bit clamp falls out of the
+ * saturating pack.  Only the packed layout (sample-sized steps, as
+ * passed for interleaved slaves) is vectorized, everything else falls
+ * back to the scalar loop.
+ */
+#if defined(__SSE2__) || defined(__ARM_NEON) || defined(__aarch64__)
+#define GENERIC_DMIX_SIMD 1
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#else
+#include <arm_neon.h>
+#endif
+
+static void generic_mix_areas_16_simd(unsigned int size,
+				      volatile signed short *dst,
+				      signed short *src,
+				      volatile signed int *sum,
+				      size_t dst_step,
+				      size_t src_step,
+				      size_t sum_step)
+{
+	if (dst_step == 2 && src_step == 2 && sum_step == 4) {
+#if defined(__SSE2__)
+		const __m128i zero = _mm_setzero_si128();
+		while (size >= 8) {
+			__m128i s = _mm_loadu_si128((const __m128i *)src);
+			__m128i d = _mm_loadu_si128((const __m128i *)(void *)dst);
+			__m128i sum_lo = _mm_loadu_si128((const __m128i *)(void *)sum);
+			__m128i sum_hi = _mm_loadu_si128((const __m128i *)(void *)(sum + 4));
+			__m128i fresh = _mm_cmpeq_epi16(d, zero);
+			__m128i fr_lo = _mm_unpacklo_epi16(fresh, fresh);
+			__m128i fr_hi = _mm_unpackhi_epi16(fresh, fresh);
+			__m128i s_lo = _mm_srai_epi32(_mm_unpacklo_epi16(zero, s), 16);
+			__m128i s_hi = _mm_srai_epi32(_mm_unpackhi_epi16(zero, s), 16);
+			__m128i acc_lo = _mm_add_epi32(sum_lo, s_lo);
+			__m128i acc_hi = _mm_add_epi32(sum_hi, s_hi);
+			__m128i new_lo = _mm_or_si128(_mm_and_si128(fr_lo, s_lo),
+						      _mm_andnot_si128(fr_lo, acc_lo));
+			__m128i new_hi = _mm_or_si128(_mm_and_si128(fr_hi, s_hi),
+						      _mm_andnot_si128(fr_hi, acc_hi));
+			_mm_storeu_si128((__m128i *)(void *)sum, new_lo);
+			_mm_storeu_si128((__m128i *)(void *)(sum + 4), new_hi);
+			_mm_storeu_si128((__m128i *)(void *)dst,
+					 _mm_packs_epi32(new_lo, new_hi));
+			src += 8;
+			dst += 8;
+			sum += 8;
+			size -= 8;
+		}
+#else
+		while (size >= 8) {
+			int16x8_t s = vld1q_s16(src);
+			int16x8_t d = vld1q_s16((const int16_t *)dst);
+			int32x4_t sum_lo = vld1q_s32((const int32_t *)sum);
+			int32x4_t sum_hi = vld1q_s32((const int32_t *)(sum + 4));
+			uint16x8_t fresh = vceqq_s16(d, vdupq_n_s16(0));
+			int32x4_t s_lo = vmovl_s16(vget_low_s16(s));
+			int32x4_t s_hi = vmovl_s16(vget_high_s16(s));
+			uint32x4_t fr_lo = vmovl_u16(vget_low_u16(fresh));
+			uint32x4_t fr_hi = vmovl_u16(vget_high_u16(fresh));
+			/* widen 0/0xffff masks to full 32bit masks */
+			fr_lo = vceqq_u32(fr_lo, vdupq_n_u32(0xffff));
+			fr_hi = vceqq_u32(fr_hi, vdupq_n_u32(0xffff));
+			int32x4_t new_lo = vbslq_s32(fr_lo, s_lo,
+						     vaddq_s32(sum_lo, s_lo));
+			int32x4_t new_hi = vbslq_s32(fr_hi, s_hi,
+						     vaddq_s32(sum_hi, s_hi));
+			vst1q_s32((int32_t *)sum, new_lo);
+			vst1q_s32((int32_t *)(sum + 4), new_hi);
+			vst1q_s16((int16_t *)dst,
+				  vcombine_s16(vqmovn_s32(new_lo),
+					       vqmovn_s32(new_hi)));
+			src += 8;
+			dst += 8;
+			sum += 8;
+			size -= 8;
+		}
+#endif
+		if (!size)
+			return;
+	}
+	generic_mix_areas_16_native(size, dst, src, sum,
+				    dst_step, src_step, sum_step);
+}
+
+static void generic_mix_areas_32_simd(unsigned int size,
+				      volatile signed int *dst,
+				      signed int *src,
+				      volatile signed int *sum,
+				      size_t dst_step,
+				      size_t src_step,
+				      size_t sum_step)
+{
+	if (dst_step == 4 && src_step == 4 && sum_step == 4) {
+#if defined(__SSE2__)
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i maxv = _mm_set1_epi32(0x7fffff);
+		const __m128i minv = _mm_set1_epi32(-0x800000);
+		const __m128i satmax = _mm_set1_epi32(0x7fffffff);
+		const __m128i satmin = _mm_set1_epi32(-0x80000000);
+		while (size >= 4) {
+			__m128i s = _mm_loadu_si128((const __m128i *)src);
+			__m128i d = _mm_loadu_si128((const __m128i *)(void *)dst);
+			__m128i sm = _mm_loadu_si128((const __m128i *)(void *)sum);
+			__m128i sample = _mm_srai_epi32(s, 8);
+			__m128i fresh = _mm_cmpeq_epi32(d, zero);
+			__m128i acc = _mm_add_epi32(sm, sample);
+			__m128i new_sum = _mm_or_si128(_mm_and_si128(fresh, sample),
+						       _mm_andnot_si128(fresh, acc));
+			__m128i gt = _mm_cmpgt_epi32(new_sum, maxv);
+			__m128i lt = _mm_cmpgt_epi32(minv, new_sum);
+			__m128i out = _mm_slli_epi32(new_sum, 8);
+			out = _mm_or_si128(_mm_and_si128(gt, satmax),
+					   _mm_andnot_si128(gt, out));
+			out = _mm_or_si128(_mm_and_si128(lt, satmin),
+					   _mm_andnot_si128(lt, out));
+			out = _mm_or_si128(_mm_and_si128(fresh, s),
+					   _mm_andnot_si128(fresh, out));
+			_mm_storeu_si128((__m128i *)(void *)sum, new_sum);
+			_mm_storeu_si128((__m128i *)(void *)dst, out);
+			src += 4;
+			dst += 4;
+			sum += 4;
+			size -= 4;
+		}
+#else
+		const int32x4_t maxv = vdupq_n_s32(0x7fffff);
+		const int32x4_t minv = vdupq_n_s32(-0x800000);
+		while (size >= 4) {
+			int32x4_t s = vld1q_s32(src);
+			int32x4_t d = vld1q_s32((const int32_t *)dst);
+			int32x4_t sm = vld1q_s32((const int32_t *)sum);
+			int32x4_t sample = vshrq_n_s32(s, 8);
+			uint32x4_t fresh = vceqq_s32(d, vdupq_n_s32(0));
+			int32x4_t new_sum = vbslq_s32(fresh, sample,
+						      vaddq_s32(sm, sample));
+			uint32x4_t gt = vcgtq_s32(new_sum, maxv);
+			uint32x4_t lt = vcgtq_s32(minv, new_sum);
+			int32x4_t out = vshlq_n_s32(new_sum, 8);
+			out = vbslq_s32(gt, vdupq_n_s32(0x7fffffff), out);
+			out = vbslq_s32(lt, vdupq_n_s32(-0x80000000), out);
+			out = vbslq_s32(fresh, s, out);
+			vst1q_s32((int32_t *)sum, new_sum);
+			vst1q_s32((int32_t *)dst, out);
+			src += 4;
+			dst += 4;
+			sum += 4;
+			size -= 4;
+		}
+#endif
+		if (!size)
+			return;
+	}
+	generic_mix_areas_32_native(size, dst, src, sum,
+				    dst_step, src_step, sum_step);
+}
+#endif /* GENERIC_DMIX_SIMD */
+
 static void generic_mix_select_callbacks(snd_pcm_direct_t *dmix)
 {
 	if (snd_pcm_format_cpu_endian(dmix->shmptr->s.format)) {
 		dmix->u.dmix.mix_areas_16 = generic_mix_areas_16_native;
 		dmix->u.dmix.mix_areas_32 = generic_mix_areas_32_native;
+#ifdef GENERIC_DMIX_SIMD
+		dmix->u.dmix.mix_areas_16 = generic_mix_areas_16_simd;
+		dmix->u.dmix.mix_areas_32 = generic_mix_areas_32_simd;
+#endif
 		dmix->u.dmix.remix_areas_16 = generic_remix_areas_16_native;
 		dmix->u.dmix.remix_areas_32 = generic_remix_areas_32_native;
 	} else {
@@ -527,8 +757,10 @@ static void generic_mix_select_callbacks(snd_pcm_direct_t *dmix)
 	}
 	dmix->u.dmix.mix_areas_24 = generic_mix_areas_24;
 	dmix->u.dmix.mix_areas_u8 = generic_mix_areas_u8;
+	dmix->u.dmix.mix_areas_fl = generic_mix_areas_fl;
 	dmix->u.dmix.remix_areas_24 = generic_remix_areas_24;
 	dmix->u.dmix.remix_areas_u8 = generic_remix_areas_u8;
+	dmix->u.dmix.remix_areas_fl = generic_remix_areas_fl;
 	dmix->u.dmix.use_sem = 1;
 }
 
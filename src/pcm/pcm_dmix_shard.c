@@ -0,0 +1,366 @@
+/*
+ * sharded sum buffer for the dmix plugin
+ *
+ * In the classic setup all clients accumulate into one shared sum
+ * buffer with atomic read-modify-write cycles, so with many concurrent
+ * streams the same cachelines bounce between all writers.  In the
+ * sharded mode each client owns a private accumulation plane and the
+ * ring range it just mixed is recomputed as the saturated sum over all
+ * live planes in one dense pass; the planes are written with plain
+ * stores and read in a shared state only, which takes the RMW traffic
+ * off the bus.  A per-slot sequence lock guards the reduction against
+ * planes changing under it.
+ */
+
+#include "bswap.h"
+
+#define SHARD_HEAD_MAGIC	0x53554d53
+/* the accumulation planes follow the directory, cacheline aligned */
+#define SHARD_HEAD_SIZE		((sizeof(snd_pcm_direct_shard_head_t) + 63) & ~63UL)
+/* frames * channels of one reduction block (and of the stack accumulator) */
+#define SHARD_ACC_SIZE		1024
+/* retries when a writer keeps interrupting the reduction */
+#define SHARD_MAX_RETRIES	4
+
+static size_t shard_plane_bytes(snd_pcm_direct_t *dmix)
+{
+	return (size_t)dmix->shmptr->s.channels *
+	       dmix->shmptr->s.buffer_size * sizeof(signed int);
+}
+
+static signed int *shard_plane(snd_pcm_direct_t *dmix, unsigned int slot)
+{
+	return (signed int *)((char *)dmix->u.dmix.sum_buffer +
+			      SHARD_HEAD_SIZE + slot * shard_plane_bytes(dmix));
+}
+
+/* the checks depend only on the shared slave setup, so all clients of
+ * one ipc_key come to the same conclusion; the interleaved layout of
+ * the client side is known only at prepare time and enforced there
+ */
+static int shard_sum_usable(snd_pcm_direct_t *dmix)
+{
+	if (dmix->sum_shards <= 0)
+		return 0;
+	if (dmix->shmptr->s.channels > SHARD_ACC_SIZE)
+		return 0;
+	switch (dmix->shmptr->s.format) {
+	case SND_PCM_FORMAT_S16_LE:
+	case SND_PCM_FORMAT_S16_BE:
+	case SND_PCM_FORMAT_S32_LE:
+	case SND_PCM_FORMAT_S32_BE:
+	case SND_PCM_FORMAT_S24_LE:
+	case SND_PCM_FORMAT_S24_3LE:
+	case SND_PCM_FORMAT_U8:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+static size_t shard_sum_size(snd_pcm_direct_t *dmix)
+{
+	if (!shard_sum_usable(dmix))
+		return shard_plane_bytes(dmix);
+	return SHARD_HEAD_SIZE + dmix->sum_shards * shard_plane_bytes(dmix);
+}
+
+/* claim a free slot in the shard directory; called with the semaphore
+ * held after the sum area has been attached
+ */
+static int shard_sum_claim(snd_pcm_direct_t *dmix)
+{
+	snd_pcm_direct_shard_head_t *head;
+	unsigned int i, n;
+
+	dmix->u.dmix.shard = -1;
+	if (!shard_sum_usable(dmix)) {
+		if (dmix->sum_shards > 0)
+			SNDERR("sum_shards is not supported for the slave setup, using the shared sum buffer");
+		return 0;
+	}
+	head = (snd_pcm_direct_shard_head_t *)dmix->u.dmix.sum_buffer;
+	n = dmix->sum_shards;
+	if (head->magic != SHARD_HEAD_MAGIC) {
+		/* a fresh segment comes zeroed from the kernel */
+		memset(head, 0, sizeof(*head));
+		head->nshards = n;
+		head->magic = SHARD_HEAD_MAGIC;
+	} else if (head->nshards != n) {
+		SNDERR("sum_shards mismatch (%u configured, %u in the segment)",
+		       n, head->nshards);
+		return -EINVAL;
+	}
+	for (i = 0; i < n; i++) {
+		if (head->inuse & (1ULL << i)) {
+			/* reclaim the slots of clients which died without
+			 * closing; EPERM still means the owner is alive
+			 */
+			if (kill(head->slot[i].pid, 0) == 0 || errno == EPERM)
+				continue;
+		}
+		head->slot[i].pid = getpid();
+		head->slot[i].seq = 0;
+		head->slot[i].appl = 0;
+		memset(shard_plane(dmix, i), 0, shard_plane_bytes(dmix));
+		dmix->u.dmix.shard = i;
+		dmix->u.dmix.shard_head = head;
+		dmix->u.dmix.shard_plane = shard_plane(dmix, i);
+		__sync_synchronize();
+		head->inuse |= 1ULL << i;
+		return 0;
+	}
+	SNDERR("no free sum shard (%u clients already connected)", n);
+	return -EBUSY;
+}
+
+static void shard_sum_release(snd_pcm_direct_t *dmix)
+{
+	snd_pcm_direct_shard_head_t *head = dmix->u.dmix.shard_head;
+
+	if (dmix->u.dmix.shard < 0)
+		return;
+	if (dmix->u.dmix.sum_buffer != (void *) -1) {
+		head->slot[dmix->u.dmix.shard].pid = 0;
+		head->inuse &= ~(1ULL << dmix->u.dmix.shard);
+	}
+	dmix->u.dmix.shard = -1;
+}
+
+/* widen one interleaved block into the own plane; the plane keeps the
+ * samples in the same 16/24bit domains the classic engines use for the
+ * shared sum buffer
+ */
+static void shard_put(snd_pcm_direct_t *dmix, const unsigned char *src,
+		      signed int *plane, unsigned int samples)
+{
+	int native = snd_pcm_format_cpu_endian(dmix->shmptr->s.format);
+	unsigned int i;
+
+	switch (dmix->shmptr->s.format) {
+	case SND_PCM_FORMAT_S16_LE:
+	case SND_PCM_FORMAT_S16_BE:
+		if (native)
+			for (i = 0; i < samples; i++)
+				plane[i] = ((const signed short *)src)[i];
+		else
+			for (i = 0; i < samples; i++)
+				plane[i] = (signed short)
+					bswap_16(((const unsigned short *)src)[i]);
+		break;
+	case SND_PCM_FORMAT_S32_LE:
+	case SND_PCM_FORMAT_S32_BE:
+		if (native)
+			for (i = 0; i < samples; i++)
+				plane[i] = ((const signed int *)src)[i] >> 8;
+		else
+			for (i = 0; i < samples; i++)
+				plane[i] = (signed int)
+					bswap_32(((const unsigned int *)src)[i]) >> 8;
+		break;
+	case SND_PCM_FORMAT_S24_LE:
+		for (i = 0; i < samples; i++)
+			plane[i] = (signed int)
+				(((const unsigned int *)src)[i] << 8) >> 8;
+		break;
+	case SND_PCM_FORMAT_S24_3LE:
+		for (i = 0; i < samples; i++, src += 3)
+			plane[i] = src[0] | (src[1] << 8) |
+				   (((const signed char *)src)[2] << 16);
+		break;
+	case SND_PCM_FORMAT_U8:
+		for (i = 0; i < samples; i++)
+			plane[i] = src[i] - 0x80;
+		break;
+	default:
+		break;
+	}
+}
+
+/* narrow the accumulated block into the slave ring, saturating like the
+ * classic engines do
+ */
+static void shard_store(snd_pcm_direct_t *dmix, const signed int *acc,
+			volatile unsigned char *dst, unsigned int samples)
+{
+	int native = snd_pcm_format_cpu_endian(dmix->shmptr->s.format);
+	register signed int sample;
+	unsigned int i;
+
+	switch (dmix->shmptr->s.format) {
+	case SND_PCM_FORMAT_S16_LE:
+	case SND_PCM_FORMAT_S16_BE:
+		for (i = 0; i < samples; i++) {
+			sample = acc[i];
+			if (sample > 0x7fff)
+				sample = 0x7fff;
+			else if (sample < -0x8000)
+				sample = -0x8000;
+			if (!native)
+				sample = (signed short)bswap_16((signed short)sample);
+			((volatile signed short *)dst)[i] = sample;
+		}
+		break;
+	case SND_PCM_FORMAT_S32_LE:
+	case SND_PCM_FORMAT_S32_BE:
+		for (i = 0; i < samples; i++) {
+			sample = acc[i];
+			if (sample > 0x7fffff)
+				sample = 0x7fffffff;
+			else if (sample < -0x800000)
+				sample = -0x80000000;
+			else
+				sample *= 256;
+			if (!native)
+				sample = (signed int)bswap_32((unsigned int)sample);
+			((volatile signed int *)dst)[i] = sample;
+		}
+		break;
+	case SND_PCM_FORMAT_S24_LE:
+	case SND_PCM_FORMAT_S24_3LE:
+	{
+		unsigned int step =
+			dmix->shmptr->s.format == SND_PCM_FORMAT_S24_LE ? 4 : 3;
+
+		for (i = 0; i < samples; i++, dst += step) {
+			sample = acc[i];
+			if (sample > 0x7fffff)
+				sample = 0x7fffff;
+			else if (sample < -0x800000)
+				sample = -0x800000;
+			dst[0] = sample;
+			dst[1] = sample >> 8;
+			dst[2] = sample >> 16;
+		}
+		break;
+	}
+	case SND_PCM_FORMAT_U8:
+		for (i = 0; i < samples; i++) {
+			sample = acc[i];
+			if (sample > 0x7f)
+				sample = 0x7f;
+			else if (sample < -0x80)
+				sample = -0x80;
+			dst[i] = sample + 0x80;
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+/* recompute a ring range as the saturated sum over all live planes;
+ * dst_ofs is the ring offset in frames, dst_pos the same point in the
+ * slave position domain which the per-slot validity windows live in
+ */
+static void shard_reduce(snd_pcm_direct_t *dmix, unsigned char *dst,
+			 snd_pcm_uframes_t dst_ofs, snd_pcm_uframes_t dst_pos,
+			 snd_pcm_uframes_t size)
+{
+	volatile snd_pcm_direct_shard_head_t *head = dmix->u.dmix.shard_head;
+	unsigned int channels = dmix->shmptr->s.channels;
+	unsigned int sample_size =
+		snd_pcm_format_physical_width(dmix->shmptr->s.format) / 8;
+	snd_pcm_uframes_t block = SHARD_ACC_SIZE / channels;
+	signed int acc[SHARD_ACC_SIZE];
+	unsigned int seq0[SND_PCM_DIRECT_SUM_SHARDS_MAX];
+	unsigned long long inuse, appl, d;
+	snd_pcm_uframes_t frames, begin, end;
+	unsigned int i, j, retries;
+	const signed int *p;
+
+	while (size) {
+		frames = size < block ? size : block;
+		retries = SHARD_MAX_RETRIES;
+	      __again:
+		inuse = head->inuse;
+		for (i = 0; i < head->nshards; i++)
+			if (inuse & (1ULL << i))
+				seq0[i] = head->slot[i].seq;
+		__sync_synchronize();
+		memset(acc, 0, frames * channels * sizeof(*acc));
+		for (i = 0; i < head->nshards; i++) {
+			if (!(inuse & (1ULL << i)))
+				continue;
+			/* clamp to the window the plane holds valid data
+			 * for, (appl - buffer_size, appl]; everything else
+			 * is silence or a stale lap of a stopped client
+			 */
+			appl = head->slot[i].appl;
+			d = appl - dst_pos;
+			if (appl < dst_pos)
+				d += dmix->slave_boundary;
+			begin = d > dmix->slave_buffer_size ?
+				d - dmix->slave_buffer_size : 0;
+			end = d < frames ? d : frames;
+			if (begin >= end)
+				continue;
+			p = shard_plane(dmix, i) + (dst_ofs + begin) * channels;
+			for (j = begin * channels; j < end * channels; j++)
+				acc[j] += *p++;
+		}
+		__sync_synchronize();
+		for (i = 0; i < head->nshards; i++) {
+			if (!(inuse & (1ULL << i)))
+				continue;
+			if ((seq0[i] & 1) || head->slot[i].seq != seq0[i]) {
+				/* a writer got in between; retry, but don't
+				 * spin forever on a busy block - the writer
+				 * reduces its own range anyway
+				 */
+				if (--retries)
+					goto __again;
+				break;
+			}
+		}
+		shard_store(dmix, acc,
+			    dst + (size_t)dst_ofs * channels * sample_size,
+			    frames * channels);
+		dst_ofs += frames;
+		dst_pos += frames;
+		if (dst_pos >= dmix->slave_boundary)
+			dst_pos -= dmix->slave_boundary;
+		size -= frames;
+	}
+}
+
+/* mix (or unmix) one contiguous chunk through the own plane; called
+ * instead of the classic engines when a shard slot is claimed
+ */
+static void shard_mix_areas(snd_pcm_direct_t *dmix,
+			    const snd_pcm_channel_area_t *src_areas,
+			    const snd_pcm_channel_area_t *dst_areas,
+			    snd_pcm_uframes_t src_ofs,
+			    snd_pcm_uframes_t dst_ofs,
+			    snd_pcm_uframes_t dst_pos,
+			    snd_pcm_uframes_t size,
+			    int remix)
+{
+	volatile snd_pcm_direct_shard_head_t *head = dmix->u.dmix.shard_head;
+	unsigned int channels = dmix->shmptr->s.channels;
+	unsigned int sample_size =
+		snd_pcm_format_physical_width(dmix->shmptr->s.format) / 8;
+	signed int *plane = dmix->u.dmix.shard_plane + dst_ofs * channels;
+	unsigned long long appl;
+
+	head->slot[dmix->u.dmix.shard].seq++;
+	__sync_synchronize();
+	if (remix) {
+		/* take the own contribution back; the window stays valid,
+		 * the rewound range simply sums up as silence
+		 */
+		memset(plane, 0, size * channels * sizeof(*plane));
+	} else {
+		shard_put(dmix, (unsigned char *)src_areas[0].addr +
+			  (size_t)sample_size * src_ofs * channels,
+			  plane, size * channels);
+		appl = dst_pos + size;
+		if (appl >= dmix->slave_boundary)
+			appl -= dmix->slave_boundary;
+		head->slot[dmix->u.dmix.shard].appl = appl;
+	}
+	__sync_synchronize();
+	head->slot[dmix->u.dmix.shard].seq++;
+	shard_reduce(dmix, (unsigned char *)dst_areas[0].addr,
+		     dst_ofs, dst_pos, size);
+}
@@ -74,6 +74,51 @@ static void do_silence(snd_pcm_t *pcm)
 	}
 }
 
+/*
+ * copy one run of adjacent bound channels with a single wide transfer
+ * per frame; possible when both sides store the run interleaved, which
+ * the mmap areas of interleaved clients and slaves do.  memcpy supplies
+ * the wide (vectorized) moves.  Returns zero when the areas do not line
+ * up and the caller must fall back to per-channel copies.
+ */
+static int share_run_copy(const snd_pcm_channel_area_t *src_areas,
+			  const snd_pcm_channel_area_t *dst_areas,
+			  snd_pcm_uframes_t src_ofs,
+			  snd_pcm_uframes_t dst_ofs,
+			  snd_pcm_uframes_t size,
+			  const snd_pcm_direct_bind_run_t *run,
+			  unsigned int fbytes)
+{
+	const snd_pcm_channel_area_t *s = &src_areas[run->chn];
+	const snd_pcm_channel_area_t *d = &dst_areas[run->dchn];
+	unsigned int i, bytes = run->count * fbytes;
+	size_t src_step, dst_step;
+	char *src, *dst;
+
+	for (i = 1; i < run->count; i++) {
+		if (s[i].addr != s->addr || s[i].step != s->step ||
+		    s[i].first != s->first + i * fbytes * 8)
+			return 0;
+		if (d[i].addr != d->addr || d[i].step != d->step ||
+		    d[i].first != d->first + i * fbytes * 8)
+			return 0;
+	}
+	src_step = s->step / 8;
+	dst_step = d->step / 8;
+	src = (char *)s->addr + s->first / 8 + src_ofs * src_step;
+	dst = (char *)d->addr + d->first / 8 + dst_ofs * dst_step;
+	if (src_step == bytes && dst_step == bytes) {
+		memcpy(dst, src, size * bytes);
+		return 1;
+	}
+	while (size-- > 0) {
+		memcpy(dst, src, bytes);
+		src += src_step;
+		dst += dst_step;
+	}
+	return 1;
+}
+
 static void share_areas(snd_pcm_direct_t *dshare,
 		      const snd_pcm_channel_area_t *src_areas,
 		      const snd_pcm_channel_area_t *dst_areas,
@@ -91,6 +136,21 @@ static void share_areas(snd_pcm_direct_t *dshare,
 		memcpy(((char *)dst_areas[0].addr) + (dst_ofs * channels * fbytes),
 		       ((char *)src_areas[0].addr) + (src_ofs * channels * fbytes),
 		       size * channels * fbytes);
+	} else if (dshare->u.dshare.runs) {
+		unsigned int fbytes = snd_pcm_format_physical_width(format) / 8;
+		const snd_pcm_direct_bind_run_t *run = dshare->u.dshare.runs;
+		unsigned int r;
+
+		for (r = 0; r < dshare->u.dshare.nruns; r++, run++) {
+			if (run->count > 1 &&
+			    share_run_copy(src_areas, dst_areas, src_ofs,
+					   dst_ofs, size, run, fbytes))
+				continue;
+			for (chn = run->chn; chn < run->chn + run->count; chn++)
+				snd_pcm_area_copy(&dst_areas[dshare->bindings[chn]],
+						  dst_ofs, &src_areas[chn],
+						  src_ofs, size, format);
+		}
 	} else {
 		for (chn = 0; chn < channels; chn++) {
 			dchn = dshare->bindings ? dshare->bindings[chn] : chn;
@@ -493,6 +553,7 @@ static int snd_pcm_dshare_close(snd_pcm_t *pcm)
 			snd_pcm_direct_semaphore_final(dshare, DIRECT_IPC_SEM_CLIENT);
 	} else
 		snd_pcm_direct_semaphore_final(dshare, DIRECT_IPC_SEM_CLIENT);
+	free(dshare->u.dshare.runs);
 	free(dshare->bindings);
 	pcm->private_data = NULL;
 	free(dshare);
@@ -636,6 +697,7 @@ static const snd_pcm_fast_ops_t snd_pcm_dshare_fast_ops = {
 	.poll_descriptors = snd_pcm_direct_poll_descriptors,
 	.poll_descriptors_count = NULL,
 	.poll_revents = snd_pcm_direct_poll_revents,
+	.wait = snd_pcm_direct_wait,
 };
 
 /**
@@ -784,7 +846,36 @@ int snd_pcm_dshare_open(snd_pcm_t **pcmp, const char *name,
 		goto _err;
 	}
 	dshare->shmptr->u.dshare.chn_mask |= dshare->u.dshare.chn_mask;
-		
+
+	/* precompute contiguous binding runs so share_areas() can copy
+	 * whole channel groups with one wide transfer per frame;
+	 * an allocation failure just keeps the per-channel copy path
+	 */
+	if (dshare->bindings) {
+		snd_pcm_direct_bind_run_t *runs;
+		runs = malloc(dshare->channels * sizeof(*runs));
+		if (runs) {
+			unsigned int n = 0;
+			for (chn = 0; chn < dshare->channels; chn++) {
+				unsigned int dchn = dshare->bindings[chn];
+				if (dchn == UINT_MAX)
+					continue;
+				if (n > 0 &&
+				    runs[n-1].chn + runs[n-1].count == chn &&
+				    runs[n-1].dchn + runs[n-1].count == dchn) {
+					runs[n-1].count++;
+					continue;
+				}
+				runs[n].chn = chn;
+				runs[n].dchn = dchn;
+				runs[n].count = 1;
+				n++;
+			}
+			dshare->u.dshare.runs = runs;
+			dshare->u.dshare.nruns = n;
+		}
+	}
+
 	ret = snd_pcm_direct_initialize_poll_fd(dshare);
 	if (ret < 0) {
 		SNDERR("unable to initialize poll_fd");
@@ -820,6 +911,7 @@ int snd_pcm_dshare_open(snd_pcm_t **pcmp, const char *name,
 	} else
 		snd_pcm_direct_semaphore_up(dshare, DIRECT_IPC_SEM_CLIENT);
  _err_nosem:
+	free(dshare->u.dshare.runs);
 	free(dshare->bindings);
 	free(dshare);
 	snd_pcm_free(pcm);
@@ -843,6 +935,8 @@ pcm.name {
 	ipc_key INT		# unique IPC key
 	ipc_key_add_uid BOOL	# add current uid to unique IPC key
 	ipc_perm INT		# IPC permissions (octal, default 0600)
+	ipc_sync STR		# IPC synchronization primitive
+				# sysv (default) or futex
 	hw_ptr_alignment STR	# Slave application and hw pointer alignment type
 		# STR can be one of the below strings :
 		# no (or off)
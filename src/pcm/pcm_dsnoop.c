@@ -112,6 +112,15 @@ static void snd_pcm_dsnoop_sync_area(snd_pcm_t *pcm, snd_pcm_uframes_t slave_hw_
 	src_areas = snd_pcm_mmap_areas(dsnoop->spcm);
 	hw_ptr %= pcm->buffer_size;
 	slave_hw_ptr %= dsnoop->slave_buffer_size;
+	/* no point copying frames which would be overwritten right away
+	 * by the wrap of our ring; skip ahead to the newest window */
+	if (size > pcm->buffer_size) {
+		snd_pcm_uframes_t skip = size - pcm->buffer_size;
+
+		slave_hw_ptr = (slave_hw_ptr + skip) % dsnoop->slave_buffer_size;
+		hw_ptr = (hw_ptr + skip) % pcm->buffer_size;
+		size = pcm->buffer_size;
+	}
 	while (size > 0) {
 		transfer = hw_ptr + size > pcm->buffer_size ? pcm->buffer_size - hw_ptr : size;
 		transfer = slave_hw_ptr + transfer > dsnoop->slave_buffer_size ?
@@ -131,7 +140,7 @@ static void snd_pcm_dsnoop_sync_area(snd_pcm_t *pcm, snd_pcm_uframes_t slave_hw_
 static int snd_pcm_dsnoop_sync_ptr(snd_pcm_t *pcm)
 {
 	snd_pcm_direct_t *dsnoop = pcm->private_data;
-	snd_pcm_uframes_t slave_hw_ptr, old_slave_hw_ptr, avail;
+	snd_pcm_uframes_t slave_hw_ptr, old_slave_hw_ptr, copy_start, avail;
 	snd_pcm_sframes_t diff;
 	int err;
 
@@ -149,6 +158,28 @@ static int snd_pcm_dsnoop_sync_ptr(snd_pcm_t *pcm)
 	snd_pcm_dsnoop_sync_area(pcm, old_slave_hw_ptr, diff);
 	dsnoop->hw_ptr += diff;
 	dsnoop->hw_ptr %= pcm->boundary;
+	/*
+	 * The area copy runs without the IPC semaphore, racing with the
+	 * hardware producer.  Validate it seqlock-style: re-read the
+	 * slave pointer, and if it ran a whole slave buffer past the
+	 * start of the region we just fetched, the data was (partially)
+	 * overwritten under us and only an overrun can be reported.
+	 */
+	copy_start = old_slave_hw_ptr;
+	if ((snd_pcm_uframes_t)diff > pcm->buffer_size)
+		copy_start = (copy_start + (diff - pcm->buffer_size)) %
+			dsnoop->slave_boundary;
+	snoop_timestamp(pcm);
+	if (pcm_frame_diff(dsnoop->slave_hw_ptr, copy_start, dsnoop->slave_boundary) >
+	    (snd_pcm_sframes_t)dsnoop->slave_buffer_size) {
+		gettimestamp(&dsnoop->trigger_tstamp, pcm->tstamp_type);
+		dsnoop->state = SND_PCM_STATE_XRUN;
+		dsnoop->avail_max = snd_pcm_mmap_capture_avail(pcm);
+		return -EPIPE;
+	}
+	/* keep the pointer we accounted for, so the next sync copies
+	 * from exactly where this one stopped */
+	dsnoop->slave_hw_ptr = slave_hw_ptr;
 	// printf("sync ptr diff = %li\n", diff);
 	if (pcm->stop_threshold >= pcm->boundary)	/* don't care */
 		return 0;
@@ -508,6 +539,7 @@ static const snd_pcm_fast_ops_t snd_pcm_dsnoop_fast_ops = {
 	.poll_descriptors = snd_pcm_direct_poll_descriptors,
 	.poll_descriptors_count = NULL,
 	.poll_revents = snd_pcm_direct_poll_revents,
+	.wait = snd_pcm_direct_wait,
 };
 
 /**
@@ -697,6 +729,8 @@ pcm.name {
 	ipc_key INT		# unique IPC key
 	ipc_key_add_uid BOOL	# add current uid to unique IPC key
 	ipc_perm INT		# IPC permissions (octal, default 0600)
+	ipc_sync STR		# IPC synchronization primitive
+				# sysv (default) or futex
 	hw_ptr_alignment STR	# Slave application and hw pointer alignment type
 		# STR can be one of the below strings :
 		# no (or off)
@@ -309,6 +309,16 @@ static int snd_pcm_extplug_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t *params
 	INTERNAL(snd_pcm_hw_params_get_subformat)(params, &ext->data->subformat);
 	INTERNAL(snd_pcm_hw_params_get_channels)(params, &ext->data->channels);
 
+	if (pcm->mmap_shadow &&
+	    (ext->data->format != ext->data->slave_format ||
+	     ext->data->subformat != ext->data->slave_subformat ||
+	     ext->data->channels != ext->data->slave_channels)) {
+		/* the in-place flag promises identical client and slave
+		 * parameters; a conversion cannot run on the shared buffer */
+		SNDERR("extplug: in-place flag with not matching client/slave parameters");
+		return -EINVAL;
+	}
+
 	if (ext->data->callback->hw_params) {
 		err = ext->data->callback->hw_params(ext->data, params);
 		if (err < 0)
@@ -639,8 +649,16 @@ either #snd_pcm_extplug_set_slave_param_minmax() and
 #snd_pcm_extplug_set_slave_param_list().  The arguments are as same
 as former functions.
 
+When the plugin processes the data purely in place (e.g. a gain or EQ
+filter) and keeps the client and slave parameters identical, set
+#SND_PCM_EXTPLUG_FLAG_INPLACE in the flags field before calling
+#snd_pcm_extplug_create().  Then no intermediate buffer is created for
+the mmap access modes: the client mmap area maps the slave buffer
+directly and the transfer callback is called with the dst and src areas
+referring to the same data, saving one full copy per transfer.
+
 To clear the parameter constraints, call #snd_pcm_extplug_params_reset()
-function. 
+function.
 
 When using snd_pcm_extplug_set_param_*() or snd_pcm_extplug_set_slave_param_*()
 for any parameter. This parameter is no longer linked between the client and
@@ -731,8 +749,14 @@ int snd_pcm_extplug_create(snd_pcm_extplug_t *extplug, const char *name,
 	pcm->fast_ops = &snd_pcm_plugin_fast_ops;
 	pcm->private_data = ext;
 	pcm->poll_fd = spcm->poll_fd;
+	pcm->poll_dynamic = spcm->poll_dynamic;
 	pcm->poll_events = spcm->poll_events;
 	pcm->tstamp_type = spcm->tstamp_type;
+	if (extplug->version >= 0x010003 &&
+	    (extplug->flags & SND_PCM_EXTPLUG_FLAG_INPLACE))
+		/* map the slave buffer directly and process the data on
+		 * the place instead of an own buffer, like softvol does */
+		pcm->mmap_shadow = 1;
 	snd_pcm_set_hw_ptr(pcm, &ext->plug.hw_ptr, -1, 0);
 	snd_pcm_set_appl_ptr(pcm, &ext->plug.appl_ptr, -1, 0);
 
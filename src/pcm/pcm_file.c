@@ -31,6 +31,9 @@
 #include "bswap.h"
 #include <ctype.h>
 #include <string.h>
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
 
 #ifndef PIC
 /* entry for static linking */
@@ -75,6 +78,7 @@ typedef struct {
 	char *ifname;
 	int ifd;
 	int format;
+	int sparse;		/* skip silent blocks in the output file */
 	snd_pcm_uframes_t appl_ptr;
 	snd_pcm_uframes_t file_ptr_bytes;
 	snd_pcm_uframes_t wbuf_size;
@@ -90,6 +94,25 @@ typedef struct {
 	struct wav_fmt wav_header;
 	size_t filelen;
 	char ifmmap_overwritten;
+	int async_write;	/* never block the stream on the output file */
+	int overflow_drop;	/* drop the oldest data when the ring is full */
+#ifdef HAVE_LIBPTHREAD
+	pthread_t wthread;
+	pthread_mutex_t wmutex;
+	pthread_cond_t wcond_data;	/* new data or stop request */
+	pthread_cond_t wcond_space;	/* space freed or write done */
+	char *wring;
+	char *wbounce;
+	size_t wring_size;
+	size_t wbounce_size;
+	size_t wring_head;
+	size_t wring_used;
+	size_t wring_busy;	/* bytes being written out right now */
+	size_t wring_dropped;	/* bytes lost to the overflow policy */
+	int wthread_started;
+	int wthread_stop;
+	int wthread_err;
+#endif
 } snd_pcm_file_t;
 
 #if __BYTE_ORDER == __LITTLE_ENDIAN
@@ -115,6 +138,60 @@ static ssize_t safe_write(int fd, const void *buf, size_t len)
 	}
 }
 
+#define FILE_SPARSE_BLOCK	4096	/* granularity of the silence skipping */
+
+/* write out a data chunk; in the sparse mode runs of silent blocks are
+ * skipped with lseek() so that the filesystem stores them as holes and
+ * the byte offsets in the file stay frame-accurate.  Returns the number
+ * of bytes consumed from buf (written or skipped) like safe_write(). */
+static ssize_t snd_pcm_file_write_out(snd_pcm_file_t *file, const char *buf,
+				      size_t bytes)
+{
+	static const char silent_block[FILE_SPARSE_BLOCK];
+	size_t off = 0, done = 0;
+	ssize_t res;
+
+	if (!file->sparse)
+		return safe_write(file->fd, buf, bytes);
+	while (off < bytes) {
+		size_t run = off;
+		/* collect whole silent blocks */
+		while (bytes - run >= FILE_SPARSE_BLOCK &&
+		       memcmp(buf + run, silent_block, FILE_SPARSE_BLOCK) == 0)
+			run += FILE_SPARSE_BLOCK;
+		if (run > off) {
+			/* skip the silence, leaving a hole in the file */
+			if (lseek(file->fd, run - off, SEEK_CUR) < 0) {
+				/* not seekable - write the file verbatim */
+				file->sparse = 0;
+				res = safe_write(file->fd, buf + off,
+						 bytes - off);
+				return res < 0 ? res : (ssize_t)(done + res);
+			}
+			done += run - off;
+			off = run;
+			continue;
+		}
+		/* advance to the end of the data run */
+		do {
+			run += FILE_SPARSE_BLOCK;
+		} while (run < bytes &&
+			 !(bytes - run >= FILE_SPARSE_BLOCK &&
+			   memcmp(buf + run, silent_block,
+				  FILE_SPARSE_BLOCK) == 0));
+		if (run > bytes)
+			run = bytes;
+		res = safe_write(file->fd, buf + off, run - off);
+		if (res < 0)
+			return res;
+		done += res;
+		if ((size_t)res != run - off)
+			return done;	/* short write */
+		off = run;
+	}
+	return done;
+}
+
 static int snd_pcm_file_append_value(char **string_p, char **index_ch_p,
 		int *len_p, const char *value)
 {
@@ -410,6 +487,175 @@ static void fixup_wav_header(snd_pcm_t *pcm)
 			return;
 	}
 }
+
+#ifdef HAVE_LIBPTHREAD
+/*
+ * Asynchronous write support: the stream side pushes the captured data
+ * into a ring buffer and a helper thread drains the ring into the
+ * output file, so a slow disk can never stall the stream.  The thread
+ * copies the data out of the ring under the lock (a bounded memcpy)
+ * and performs the actual write() with the lock released; when the
+ * ring overflows, the oldest data is dropped by default.
+ */
+
+#define FILE_RING_BUFFERS	8	/* ring size in slave buffers */
+#define FILE_BOUNCE_BYTES	(64 * 1024)
+
+static void *snd_pcm_file_write_thread(void *data)
+{
+	snd_pcm_file_t *file = data;
+
+	pthread_mutex_lock(&file->wmutex);
+	while (!file->wthread_stop || file->wring_used) {
+		size_t n, cont, head;
+		ssize_t res;
+
+		if (!file->wring_used) {
+			pthread_cond_wait(&file->wcond_data, &file->wmutex);
+			continue;
+		}
+		n = file->wring_used;
+		if (n > file->wbounce_size)
+			n = file->wbounce_size;
+		head = file->wring_head;
+		cont = file->wring_size - head;
+		if (n > cont) {
+			memcpy(file->wbounce, file->wring + head, cont);
+			memcpy(file->wbounce + cont, file->wring, n - cont);
+		} else
+			memcpy(file->wbounce, file->wring + head, n);
+		file->wring_head = (head + n) % file->wring_size;
+		file->wring_used -= n;
+		file->wring_busy = n;
+		pthread_mutex_unlock(&file->wmutex);
+		res = snd_pcm_file_write_out(file, file->wbounce, n);
+		pthread_mutex_lock(&file->wmutex);
+		file->wring_busy = 0;
+		if (res < 0) {
+			if (!file->wthread_err)
+				SNDERR("%s write failed, file data may be corrupt",
+				       file->fname);
+			file->wthread_err = res;
+		} else {
+			file->filelen += res;
+			if ((size_t)res != n)
+				file->wring_dropped += n - res;
+		}
+		pthread_cond_broadcast(&file->wcond_space);
+	}
+	pthread_mutex_unlock(&file->wmutex);
+	return NULL;
+}
+
+/* push data into the ring; called with wmutex held */
+static void snd_pcm_file_ring_push(snd_pcm_file_t *file, const char *buf,
+				   size_t bytes)
+{
+	size_t tail, cont;
+
+	if (file->wthread_err)
+		return;		/* already reported, drop silently */
+	if (bytes > file->wring_size) {
+		/* keep only the newest ring-full of data */
+		file->wring_dropped += bytes - file->wring_size;
+		buf += bytes - file->wring_size;
+		bytes = file->wring_size;
+	}
+	while (file->wring_size - file->wring_used < bytes) {
+		if (file->overflow_drop) {
+			size_t k = bytes -
+				(file->wring_size - file->wring_used);
+			file->wring_head = (file->wring_head + k) %
+				file->wring_size;
+			file->wring_used -= k;
+			file->wring_dropped += k;
+			break;
+		}
+		pthread_cond_wait(&file->wcond_space, &file->wmutex);
+		if (file->wthread_err)
+			return;
+	}
+	tail = (file->wring_head + file->wring_used) % file->wring_size;
+	cont = file->wring_size - tail;
+	if (bytes > cont) {
+		memcpy(file->wring + tail, buf, cont);
+		memcpy(file->wring, buf + cont, bytes - cont);
+	} else
+		memcpy(file->wring + tail, buf, bytes);
+	file->wring_used += bytes;
+	pthread_cond_signal(&file->wcond_data);
+}
+
+/* wait until the writer thread catches up with the ring */
+static void snd_pcm_file_async_flush(snd_pcm_file_t *file)
+{
+	pthread_mutex_lock(&file->wmutex);
+	while ((file->wring_used || file->wring_busy) && !file->wthread_err)
+		pthread_cond_wait(&file->wcond_space, &file->wmutex);
+	pthread_mutex_unlock(&file->wmutex);
+}
+
+static int snd_pcm_file_async_start(snd_pcm_file_t *file)
+{
+	int err;
+
+	if (!file->async_write || file->wthread_started)
+		return 0;
+	file->wring_size = file->wbuf_size_bytes * (FILE_RING_BUFFERS / 2);
+	file->wbounce_size = FILE_BOUNCE_BYTES < file->wring_size ?
+		FILE_BOUNCE_BYTES : file->wring_size;
+	file->wring = malloc(file->wring_size);
+	file->wbounce = malloc(file->wbounce_size);
+	if (!file->wring || !file->wbounce) {
+		free(file->wring);
+		free(file->wbounce);
+		file->wring = file->wbounce = NULL;
+		return -ENOMEM;
+	}
+	file->wring_head = file->wring_used = file->wring_busy = 0;
+	file->wring_dropped = 0;
+	file->wthread_stop = 0;
+	file->wthread_err = 0;
+	pthread_mutex_init(&file->wmutex, NULL);
+	pthread_cond_init(&file->wcond_data, NULL);
+	pthread_cond_init(&file->wcond_space, NULL);
+	err = pthread_create(&file->wthread, NULL,
+			     snd_pcm_file_write_thread, file);
+	if (err) {
+		pthread_mutex_destroy(&file->wmutex);
+		pthread_cond_destroy(&file->wcond_data);
+		pthread_cond_destroy(&file->wcond_space);
+		free(file->wring);
+		free(file->wbounce);
+		file->wring = file->wbounce = NULL;
+		return -err;
+	}
+	file->wthread_started = 1;
+	return 0;
+}
+
+static void snd_pcm_file_async_stop(snd_pcm_file_t *file)
+{
+	if (!file->wthread_started)
+		return;
+	pthread_mutex_lock(&file->wmutex);
+	file->wthread_stop = 1;
+	pthread_cond_signal(&file->wcond_data);
+	pthread_mutex_unlock(&file->wmutex);
+	pthread_join(file->wthread, NULL);
+	file->wthread_started = 0;
+	file->wthread_stop = 0;
+	if (file->wring_dropped)
+		SNDERR("%s: %ld bytes dropped by the async writer",
+		       file->fname, (long)file->wring_dropped);
+	pthread_mutex_destroy(&file->wmutex);
+	pthread_cond_destroy(&file->wcond_data);
+	pthread_cond_destroy(&file->wcond_space);
+	free(file->wring);
+	free(file->wbounce);
+	file->wring = file->wbounce = NULL;
+}
+#endif /* HAVE_LIBPTHREAD */
 #endif /* DOC_HIDDEN */
 
 
@@ -431,12 +677,34 @@ static int snd_pcm_file_write_bytes(snd_pcm_t *pcm, size_t bytes)
 		}
 	}
 
+#ifdef HAVE_LIBPTHREAD
+	if (file->wthread_started) {
+		/* hand the data over to the writer thread; the file
+		 * length is accounted there */
+		pthread_mutex_lock(&file->wmutex);
+		while (bytes > 0) {
+			size_t n = bytes;
+			size_t cont = file->wbuf_size_bytes - file->file_ptr_bytes;
+			if (n > cont)
+				n = cont;
+			snd_pcm_file_ring_push(file, file->wbuf + file->file_ptr_bytes, n);
+			bytes -= n;
+			file->wbuf_used_bytes -= n;
+			file->file_ptr_bytes += n;
+			if (file->file_ptr_bytes == file->wbuf_size_bytes)
+				file->file_ptr_bytes = 0;
+		}
+		pthread_mutex_unlock(&file->wmutex);
+		return 0;
+	}
+#endif
+
 	while (bytes > 0) {
 		size_t n = bytes;
 		size_t cont = file->wbuf_size_bytes - file->file_ptr_bytes;
 		if (n > cont)
 			n = cont;
-		err = safe_write(file->fd, file->wbuf + file->file_ptr_bytes, n);
+		err = snd_pcm_file_write_out(file, file->wbuf + file->file_ptr_bytes, n);
 		if (err < 0) {
 			file->wbuf_used_bytes = 0;
 			file->file_ptr_bytes = 0;
@@ -492,7 +760,20 @@ static int snd_pcm_file_add_frames(snd_pcm_t *pcm,
 static int snd_pcm_file_close(snd_pcm_t *pcm)
 {
 	snd_pcm_file_t *file = pcm->private_data;
+#ifdef HAVE_LIBPTHREAD
+	/* normally stopped in hw_free already */
+	snd_pcm_file_async_stop(file);
+#endif
 	if (file->fname) {
+		if (file->sparse && file->fd >= 0 && !file->pipe) {
+			/* materialize a possible trailing hole; lseek()
+			 * alone does not extend the file */
+			off_t len = file->filelen;
+			if (file->wav_header.fmt)
+				len += 0x2c;	/* the WAV header */
+			if (ftruncate(file->fd, len) < 0)
+				SYSERR("%s truncate failed", file->fname);
+		}
 		if (file->wav_header.fmt)
 			fixup_wav_header(pcm);
 		free((void *)file->fname);
@@ -543,6 +824,10 @@ static int snd_pcm_file_drain(snd_pcm_t *pcm)
 		snd_pcm_file_write_bytes(pcm, file->wbuf_used_bytes);
 		assert(file->wbuf_used_bytes == 0);
 		__snd_pcm_unlock(pcm);
+#ifdef HAVE_LIBPTHREAD
+		if (file->wthread_started)
+			snd_pcm_file_async_flush(file);
+#endif
 	}
 	return err;
 }
@@ -737,6 +1022,9 @@ static int snd_pcm_file_mmap_begin(snd_pcm_t *pcm, const snd_pcm_channel_area_t
 static int snd_pcm_file_hw_free(snd_pcm_t *pcm)
 {
 	snd_pcm_file_t *file = pcm->private_data;
+#ifdef HAVE_LIBPTHREAD
+	snd_pcm_file_async_stop(file);
+#endif
 	free(file->wbuf);
 	free(file->wbuf_areas);
 	free(file->final_fname);
@@ -788,6 +1076,13 @@ static int snd_pcm_file_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t * params)
 		a->first = slave->sample_bits * channel;
 		a->step = slave->frame_bits;
 	}
+	if (file->sparse && snd_pcm_format_silence_64(slave->format) != 0) {
+		/* file holes read back as zero bytes, so the silence can
+		 * only be skipped when its pattern is all-zero */
+		SNDERR("%s silence is not zero, writing the file verbatim",
+		       snd_pcm_format_name(slave->format));
+		file->sparse = 0;
+	}
 	if (file->fd < 0) {
 		err = snd_pcm_file_open_output_file(file);
 		if (err < 0) {
@@ -796,6 +1091,14 @@ static int snd_pcm_file_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t * params)
 		}
 	}
 
+#ifdef HAVE_LIBPTHREAD
+	err = snd_pcm_file_async_start(file);
+	if (err < 0) {
+		snd_pcm_file_hw_free(pcm);
+		return err;
+	}
+#endif
+
 	/* pointer may have changed - e.g if plug is used. */
 	snd_pcm_unlink_hw_ptr(pcm, file->gen.slave);
 	snd_pcm_unlink_appl_ptr(pcm, file->gen.slave);
@@ -885,7 +1188,9 @@ static const snd_pcm_fast_ops_t snd_pcm_file_fast_ops = {
  * \param ifd Input file descriptor (if (ifd < 0) && (ifname == NULL), no input
  *            redirection will be performed)
  * \param trunc Truncate the file if it already exists
- * \param fmt File format ("raw" or "wav" are available)
+ * \param fmt File format ("raw", "wav", "sparse" and "sparse_wav"
+ *            are available; the sparse variants skip silent blocks
+ *            so the filesystem stores them as holes)
  * \param perm File permission
  * \param slave Slave PCM handle
  * \param close_slave When set, the slave PCM handle is closed with copy PCM
@@ -905,6 +1210,7 @@ int snd_pcm_file_open(snd_pcm_t **pcmp, const char *name,
 	snd_pcm_file_t *file;
 	snd_pcm_file_format_t format;
 	struct timespec timespec;
+	int sparse = 0;
 	int err;
 
 	assert(pcmp);
@@ -913,7 +1219,13 @@ int snd_pcm_file_open(snd_pcm_t **pcmp, const char *name,
 		format = SND_PCM_FILE_FORMAT_RAW;
 	else if (!strcmp(fmt, "wav"))
 		format = SND_PCM_FILE_FORMAT_WAV;
-	else {
+	else if (!strcmp(fmt, "sparse")) {
+		format = SND_PCM_FILE_FORMAT_RAW;
+		sparse = 1;
+	} else if (!strcmp(fmt, "sparse_wav")) {
+		format = SND_PCM_FILE_FORMAT_WAV;
+		sparse = 1;
+	} else {
 		SNDERR("file format %s is unknown", fmt);
 		return -EINVAL;
 	}
@@ -942,6 +1254,7 @@ int snd_pcm_file_open(snd_pcm_t **pcmp, const char *name,
 	file->fd = fd;
 	file->ifd = ifd;
 	file->format = format;
+	file->sparse = sparse;
 	file->gen.slave = slave;
 	file->gen.close_slave = close_slave;
 
@@ -956,6 +1269,7 @@ int snd_pcm_file_open(snd_pcm_t **pcmp, const char *name,
 	pcm->fast_ops = &snd_pcm_file_fast_ops;
 	pcm->private_data = file;
 	pcm->poll_fd = slave->poll_fd;
+	pcm->poll_dynamic = slave->poll_dynamic;
 	pcm->poll_events = slave->poll_events;
 	pcm->mmap_shadow = 1;
 	pcm->tstamp_type = SND_PCM_TSTAMP_TYPE_GETTIMEOFDAY;
@@ -1004,8 +1318,17 @@ pcm.name {
 	infile STR		# Input filename - only raw format
 	or
 	infile INT		# Input file descriptor number
-	[format STR]		# File format ("raw" or "wav")
+	[format STR]		# File format ("raw", "wav", "sparse" or
+				# "sparse_wav"); the sparse variants skip
+				# silent blocks so the filesystem stores
+				# them as holes, keeping the byte offsets
+				# frame-accurate
 	[perm INT]		# Output file permission (octal, def. 0600)
+	[async BOOL]		# Write the output file from a helper thread
+				# so a slow disk cannot stall the stream
+	[async_overflow STR]	# Overflow policy of the async ring:
+				# "drop" (default) drops the oldest data,
+				# "block" waits for the writer thread
 }
 \endcode
 
@@ -1041,8 +1364,10 @@ int _snd_pcm_file_open(snd_pcm_t **pcmp, const char *name,
 	snd_config_t *slave = NULL, *sconf;
 	const char *fname = NULL, *ifname = NULL;
 	const char *format = NULL;
+	const char *overflow = NULL;
 	long fd = -1, ifd = -1, trunc = 1;
 	long perm = 0600;
+	int async_write = 0, overflow_drop = 1;
 	snd_config_for_each(i, next, conf) {
 		snd_config_t *n = snd_config_iterator_entry(i);
 		const char *id;
@@ -1103,9 +1428,36 @@ int _snd_pcm_file_open(snd_pcm_t **pcmp, const char *name,
 			trunc = err;
 			continue;
 		}
+		if (strcmp(id, "async") == 0) {
+			err = snd_config_get_bool(n);
+			if (err < 0) {
+				SNDERR("Invalid type for %s", id);
+				return -EINVAL;
+			}
+			async_write = err;
+			continue;
+		}
+		if (strcmp(id, "async_overflow") == 0) {
+			err = snd_config_get_string(n, &overflow);
+			if (err < 0) {
+				SNDERR("Invalid type for %s", id);
+				return -EINVAL;
+			}
+			continue;
+		}
 		SNDERR("Unknown field %s", id);
 		return -EINVAL;
 	}
+	if (overflow) {
+		if (strcmp(overflow, "drop") == 0)
+			overflow_drop = 1;
+		else if (strcmp(overflow, "block") == 0)
+			overflow_drop = 0;
+		else {
+			SNDERR("Invalid async_overflow policy %s", overflow);
+			return -EINVAL;
+		}
+	}
 	if (!format) {
 		snd_config_t *n;
 		/* read defaults */
@@ -1135,9 +1487,20 @@ int _snd_pcm_file_open(snd_pcm_t **pcmp, const char *name,
 		return err;
 	err = snd_pcm_file_open(pcmp, name, fname, fd, ifname, ifd,
 				trunc, format, perm, spcm, 1, stream);
-	if (err < 0)
+	if (err < 0) {
 		snd_pcm_close(spcm);
-	return err;
+		return err;
+	}
+	if (async_write) {
+#ifdef HAVE_LIBPTHREAD
+		snd_pcm_file_t *file = (*pcmp)->private_data;
+		file->async_write = 1;
+		file->overflow_drop = overflow_drop;
+#else
+		SNDERR("async mode requires pthread support, writing synchronously");
+#endif
+	}
+	return 0;
 }
 #ifndef DOC_HIDDEN
 SND_DLSYM_BUILD_VERSION(_snd_pcm_file_open, SND_PCM_DLSYM_VERSION);
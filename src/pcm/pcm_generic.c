@@ -39,7 +39,8 @@ int snd_pcm_generic_close(snd_pcm_t *pcm)
 	int err = 0;
 	if (generic->close_slave)
 		err = snd_pcm_close(generic->slave);
-	free(generic);
+	if (!pcm->embedded_size)
+		free(generic);
 	return err;
 }
 
@@ -302,11 +303,22 @@ int snd_pcm_generic_real_htimestamp(snd_pcm_t *pcm, snd_pcm_uframes_t *avail,
 int snd_pcm_generic_mmap(snd_pcm_t *pcm)
 {
 	if (pcm->mmap_shadow) {
-		/* Copy the slave mmapped buffer data */
 		snd_pcm_generic_t *generic = pcm->private_data;
-		pcm->mmap_channels = generic->slave->mmap_channels;
-		pcm->running_areas = generic->slave->running_areas;
-		pcm->stopped_areas = generic->slave->stopped_areas;
+		snd_pcm_t *slave = generic->slave;
+		/* A degenerate slave ring (null plugin) aliases every
+		 * frame onto the same sample; a plugin shadowing such a
+		 * ring may read committed data back (e.g. file capture),
+		 * so allocate a private buffer instead.
+		 */
+		if (slave->running_areas && pcm->buffer_size > 1 &&
+		    slave->running_areas[0].step == 0) {
+			pcm->mmap_shadow = 0;
+			return 0;
+		}
+		/* Copy the slave mmapped buffer data */
+		pcm->mmap_channels = slave->mmap_channels;
+		pcm->running_areas = slave->running_areas;
+		pcm->stopped_areas = slave->stopped_areas;
 	}
 	return 0;
 }
@@ -0,0 +1,429 @@
+/**
+ * \file pcm/pcm_graph.c
+ * \ingroup PCM_Plugins
+ * \brief PCM Routing Graph Plugin Interface
+ * \author Jaroslav Kysela <perex@perex.cz>
+ * \date 2025
+ */
+/*
+ *  PCM - Routing Graph
+ *  Copyright (c) 2025 by Jaroslav Kysela <perex@perex.cz>
+ *
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 2.1 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "pcm_local.h"
+#include "pcm_plugin.h"
+
+#ifndef PIC
+/* entry for static linking */
+const char *_snd_module_pcm_graph = "";
+#endif
+
+/*! \page pcm_plugins
+
+\section pcm_plugins_graph Plugin: Routing graph
+
+This plugin distributes the channels of one stream across multiple
+slave PCMs with an optional gain per route.  It is a macro plugin:
+the destinations are bundled by the \ref pcm_plugins_multi "multi"
+plugin and the routes (including the gains) are folded into one
+\ref pcm_plugins_route "route" transfer table, so the whole graph is
+executed as a single mixing pass per period driven by one scheduler.
+Compared to stacking route, softvol and multi by hand, no intermediate
+buffer and no extra conversion pass is created for the gain stage.
+
+\code
+pcm.name {
+        type graph              # Routing graph PCM
+        slaves {		# Destinations definition
+		ID {
+			pcm STR		# Slave PCM name
+			# or
+			pcm { }		# Slave PCM definition
+			channels INT	# Slave channels
+		}
+        }
+	routes {		# Routes definition
+		N {
+			src INT		# Source channel of this PCM
+			slave STR	# Destination slave key
+			channel INT	# Destination channel on the slave
+			[gain REAL]	# Linear gain (0.0-1.0, default 1.0)
+		}
+	}
+	[channels INT]		# Count of source channels
+				# (default: highest used src + 1)
+	[master STR]		# Key of the timing master slave
+				# (default: first slave)
+}
+\endcode
+
+For example, to feed a stereo stream to two sound cards at the same
+time, with the second one attenuated to a half:
+\code
+pcm.fanout {
+	type graph
+
+	slaves.main.pcm "hw:0,0"
+	slaves.main.channels 2
+	slaves.aux.pcm "hw:1,0"
+	slaves.aux.channels 2
+
+	routes.0.src 0
+	routes.0.slave main
+	routes.0.channel 0
+	routes.1.src 1
+	routes.1.slave main
+	routes.1.channel 1
+	routes.2.src 0
+	routes.2.slave aux
+	routes.2.channel 0
+	routes.2.gain 0.5
+	routes.3.src 1
+	routes.3.slave aux
+	routes.3.channel 1
+	routes.3.gain 0.5
+}
+\endcode
+
+\subsection pcm_plugins_graph_funcref Function reference
+
+<UL>
+  <LI>_snd_pcm_graph_open()
+</UL>
+
+*/
+
+/**
+ * \brief Creates a new Routing Graph PCM
+ * \param pcmp Returns created PCM handle
+ * \param name Name of PCM
+ * \param root Root configuration node
+ * \param conf Configuration node with Routing Graph PCM description
+ * \param stream Stream type
+ * \param mode Stream mode
+ * \retval zero on success otherwise a negative error code
+ * \warning Using of this function might be dangerous in the sense
+ *          of compatibility reasons. The prototype might be freely
+ *          changed in future.
+ */
+int _snd_pcm_graph_open(snd_pcm_t **pcmp, const char *name,
+			snd_config_t *root, snd_config_t *conf,
+			snd_pcm_stream_t stream, int mode)
+{
+	snd_config_iterator_t i, inext, j, jnext;
+	snd_config_t *slaves = NULL;
+	snd_config_t *routes = NULL;
+	const char *master_id = NULL;
+	const char **slaves_id = NULL;
+	snd_config_t **slaves_conf = NULL;
+	snd_pcm_t **slaves_pcm = NULL;
+	unsigned int *slaves_channels = NULL;
+	unsigned int *slaves_offset = NULL;
+	int *bind_sidx = NULL;
+	unsigned int *bind_schannel = NULL;
+	snd_pcm_route_ttable_entry_t *ttable = NULL;
+	snd_pcm_t *mpcm = NULL;
+	unsigned int slaves_count = 0;
+	unsigned int schannels_count = 0;
+	unsigned int channels_count = 0;
+	unsigned int master_slave = 0;
+	unsigned int sused = 0;
+	long channels = -1;
+	unsigned int idx, c;
+	int err;
+
+	snd_config_for_each(i, inext, conf) {
+		snd_config_t *n = snd_config_iterator_entry(i);
+		const char *id;
+		if (snd_config_get_id(n, &id) < 0)
+			continue;
+		if (snd_pcm_conf_generic_id(id))
+			continue;
+		if (strcmp(id, "slaves") == 0) {
+			if (snd_config_get_type(n) != SND_CONFIG_TYPE_COMPOUND) {
+				SNDERR("Invalid type for %s", id);
+				return -EINVAL;
+			}
+			slaves = n;
+			continue;
+		}
+		if (strcmp(id, "routes") == 0) {
+			if (snd_config_get_type(n) != SND_CONFIG_TYPE_COMPOUND) {
+				SNDERR("Invalid type for %s", id);
+				return -EINVAL;
+			}
+			routes = n;
+			continue;
+		}
+		if (strcmp(id, "channels") == 0) {
+			if (snd_config_get_integer(n, &channels) < 0 ||
+			    channels <= 0) {
+				SNDERR("Invalid type for %s", id);
+				return -EINVAL;
+			}
+			continue;
+		}
+		if (strcmp(id, "master") == 0) {
+			if (snd_config_get_string(n, &master_id) < 0) {
+				SNDERR("Invalid type for %s", id);
+				return -EINVAL;
+			}
+			continue;
+		}
+		SNDERR("Unknown field %s", id);
+		return -EINVAL;
+	}
+	if (!slaves) {
+		SNDERR("slaves is not defined");
+		return -EINVAL;
+	}
+	if (!routes) {
+		SNDERR("routes is not defined");
+		return -EINVAL;
+	}
+	snd_config_for_each(i, inext, slaves) {
+		++slaves_count;
+	}
+	if (slaves_count == 0) {
+		SNDERR("No slaves defined");
+		return -EINVAL;
+	}
+	slaves_id = calloc(slaves_count, sizeof(*slaves_id));
+	slaves_conf = calloc(slaves_count, sizeof(*slaves_conf));
+	slaves_pcm = calloc(slaves_count, sizeof(*slaves_pcm));
+	slaves_channels = calloc(slaves_count, sizeof(*slaves_channels));
+	slaves_offset = calloc(slaves_count, sizeof(*slaves_offset));
+	if (!slaves_id || !slaves_conf || !slaves_pcm || !slaves_channels ||
+	    !slaves_offset) {
+		err = -ENOMEM;
+		goto _free;
+	}
+	idx = 0;
+	snd_config_for_each(i, inext, slaves) {
+		snd_config_t *m = snd_config_iterator_entry(i);
+		const char *id;
+		int schannels;
+		if (snd_config_get_id(m, &id) < 0)
+			continue;
+		slaves_id[idx] = id;
+		err = snd_pcm_slave_conf(root, m, &slaves_conf[idx], 1,
+					 SND_PCM_HW_PARAM_CHANNELS,
+					 SCONF_MANDATORY, &schannels);
+		if (err < 0)
+			goto _free;
+		slaves_channels[idx] = schannels;
+		slaves_offset[idx] = schannels_count;
+		schannels_count += schannels;
+		++idx;
+	}
+	if (master_id) {
+		for (idx = 0; idx < slaves_count; ++idx) {
+			if (strcmp(master_id, slaves_id[idx]) == 0) {
+				master_slave = idx;
+				break;
+			}
+		}
+		if (idx >= slaves_count) {
+			SNDERR("Master slave %s is not defined", master_id);
+			err = -EINVAL;
+			goto _free;
+		}
+	}
+	/* one binding per slave channel, slaves laid out consecutively */
+	bind_sidx = calloc(schannels_count, sizeof(*bind_sidx));
+	bind_schannel = calloc(schannels_count, sizeof(*bind_schannel));
+	if (!bind_sidx || !bind_schannel) {
+		err = -ENOMEM;
+		goto _free;
+	}
+	for (idx = 0; idx < slaves_count; ++idx) {
+		for (c = 0; c < slaves_channels[idx]; ++c) {
+			bind_sidx[slaves_offset[idx] + c] = idx;
+			bind_schannel[slaves_offset[idx] + c] = c;
+		}
+	}
+	/* determine the count of source channels */
+	snd_config_for_each(i, inext, routes) {
+		snd_config_t *m = snd_config_iterator_entry(i);
+		snd_config_t *n;
+		long src;
+		if (snd_config_get_type(m) != SND_CONFIG_TYPE_COMPOUND) {
+			SNDERR("Invalid type for routes definition");
+			err = -EINVAL;
+			goto _free;
+		}
+		if (snd_config_search(m, "src", &n) < 0 ||
+		    snd_config_get_integer(n, &src) < 0 || src < 0) {
+			SNDERR("Invalid or missing src for a route");
+			err = -EINVAL;
+			goto _free;
+		}
+		if ((unsigned long)src >= channels_count)
+			channels_count = src + 1;
+	}
+	if (channels_count == 0) {
+		SNDERR("No routes defined");
+		err = -EINVAL;
+		goto _free;
+	}
+	if (channels > 0) {
+		if ((long)channels_count > channels) {
+			SNDERR("Route src is out of range (0-%ld)",
+			       channels - 1);
+			err = -EINVAL;
+			goto _free;
+		}
+		channels_count = channels;
+	}
+	ttable = calloc(channels_count * schannels_count, sizeof(*ttable));
+	if (!ttable) {
+		err = -ENOMEM;
+		goto _free;
+	}
+	snd_config_for_each(i, inext, routes) {
+		snd_config_t *m = snd_config_iterator_entry(i);
+		long src = -1;
+		long schannel = -1;
+		int slave = -1;
+		double gain = 1.0;
+		const char *str;
+		const char *id;
+		if (snd_config_get_id(m, &id) < 0)
+			continue;
+		snd_config_for_each(j, jnext, m) {
+			snd_config_t *n = snd_config_iterator_entry(j);
+			const char *fid;
+			if (snd_config_get_id(n, &fid) < 0)
+				continue;
+			if (strcmp(fid, "comment") == 0)
+				continue;
+			if (strcmp(fid, "src") == 0) {
+				if (snd_config_get_integer(n, &src) < 0) {
+					SNDERR("Invalid type for %s", fid);
+					err = -EINVAL;
+					goto _free;
+				}
+				continue;
+			}
+			if (strcmp(fid, "slave") == 0) {
+				unsigned int k;
+				err = snd_config_get_string(n, &str);
+				if (err < 0) {
+					SNDERR("Invalid value for %s", fid);
+					goto _free;
+				}
+				for (k = 0; k < slaves_count; ++k) {
+					if (strcmp(slaves_id[k], str) == 0)
+						slave = k;
+				}
+				continue;
+			}
+			if (strcmp(fid, "channel") == 0) {
+				if (snd_config_get_integer(n, &schannel) < 0) {
+					SNDERR("Invalid type for %s", fid);
+					err = -EINVAL;
+					goto _free;
+				}
+				continue;
+			}
+			if (strcmp(fid, "gain") == 0) {
+				if (snd_config_get_ireal(n, &gain) < 0 ||
+				    gain < 0.0 || gain > 1.0) {
+					SNDERR("Invalid value for %s", fid);
+					err = -EINVAL;
+					goto _free;
+				}
+				continue;
+			}
+			SNDERR("Unknown field %s", fid);
+			err = -EINVAL;
+			goto _free;
+		}
+		if (slave < 0 || (unsigned int)slave >= slaves_count) {
+			SNDERR("Invalid or missing slave for route %s", id);
+			err = -EINVAL;
+			goto _free;
+		}
+		if (schannel < 0 ||
+		    (unsigned int)schannel >= slaves_channels[slave]) {
+			SNDERR("Invalid or missing channel for route %s", id);
+			err = -EINVAL;
+			goto _free;
+		}
+		c = slaves_offset[slave] + schannel;
+		ttable[src * schannels_count + c] =
+				gain * SND_PCM_PLUGIN_ROUTE_FULL;
+		if (c >= sused)
+			sused = c + 1;
+	}
+
+	for (idx = 0; idx < slaves_count; ++idx) {
+		err = snd_pcm_open_slave(&slaves_pcm[idx], root,
+					 slaves_conf[idx], stream, mode,
+					 conf);
+		if (err < 0)
+			goto _free;
+		snd_config_delete(slaves_conf[idx]);
+		slaves_conf[idx] = NULL;
+	}
+	err = snd_pcm_multi_open(&mpcm, name, slaves_count, master_slave,
+				 slaves_pcm, slaves_channels,
+				 schannels_count,
+				 bind_sidx, bind_schannel,
+				 1);
+	if (err < 0)
+		goto _free;
+	/* the slaves are owned by the multi PCM from now on */
+	for (idx = 0; idx < slaves_count; ++idx)
+		slaves_pcm[idx] = NULL;
+	/* the route pass mixes with the gains applied and writes straight
+	 * into the slave buffers exposed by the multi shadow mapping
+	 */
+	err = snd_pcm_route_open(pcmp, name, SND_PCM_FORMAT_UNKNOWN,
+				 schannels_count, ttable, schannels_count,
+				 channels_count, sused,
+				 mpcm, 1);
+	if (err < 0)
+		snd_pcm_close(mpcm);
+_free:
+	if (err < 0) {
+		for (idx = 0; idx < slaves_count; ++idx) {
+			if (slaves_pcm[idx])
+				snd_pcm_close(slaves_pcm[idx]);
+		}
+	}
+	if (slaves_conf) {
+		for (idx = 0; idx < slaves_count; ++idx) {
+			if (slaves_conf[idx])
+				snd_config_delete(slaves_conf[idx]);
+		}
+		free(slaves_conf);
+	}
+	free(ttable);
+	free(bind_schannel);
+	free(bind_sidx);
+	free(slaves_offset);
+	free(slaves_channels);
+	free(slaves_pcm);
+	free(slaves_id);
+	return err;
+}
+#ifndef DOC_HIDDEN
+SND_DLSYM_BUILD_VERSION(_snd_pcm_graph_open, SND_PCM_DLSYM_VERSION);
+#endif
@@ -44,7 +44,7 @@ struct _snd_pcm_hook {
 };
 
 struct snd_pcm_hook_dllist {
-	void *dlobj;
+	void *install_func;	/* reference held in the dlobj cache */
 	struct list_head list;
 };
 
@@ -55,7 +55,7 @@ typedef struct {
 } snd_pcm_hooks_t;
 #endif
 
-static int hook_add_dlobj(snd_pcm_t *pcm, void *dlobj)
+static int hook_add_dlobj(snd_pcm_t *pcm, void *install_func)
 {
 	snd_pcm_hooks_t *h = pcm->private_data;
 	struct snd_pcm_hook_dllist *dl;
@@ -64,7 +64,7 @@ static int hook_add_dlobj(snd_pcm_t *pcm, void *dlobj)
 	if (!dl)
 		return -ENOMEM;
 
-	dl->dlobj = dlobj;
+	dl->install_func = install_func;
 	list_add_tail(&dl->list, &h->dllist);
 	return 0;
 }
@@ -72,7 +72,7 @@ static int hook_add_dlobj(snd_pcm_t *pcm, void *dlobj)
 static void hook_remove_dlobj(struct snd_pcm_hook_dllist *dl)
 {
 	list_del(&dl->list);
-	snd_dlclose(dl->dlobj);
+	snd_dlobj_cache_put(dl->install_func);
 	free(dl);
 }
 
@@ -238,6 +238,7 @@ int snd_pcm_hooks_open(snd_pcm_t **pcmp, const char *name, snd_pcm_t *slave, int
 	pcm->fast_ops = &snd_pcm_hooks_fast_ops;
 	pcm->private_data = h;
 	pcm->poll_fd = slave->poll_fd;
+	pcm->poll_dynamic = slave->poll_dynamic;
 	pcm->poll_events = slave->poll_events;
 	pcm->mmap_shadow = 1;
 	pcm->tstamp_type = slave->tstamp_type;
@@ -341,13 +342,12 @@ even if the specified control doesn't exist.
 static int snd_pcm_hook_add_conf(snd_pcm_t *pcm, snd_config_t *root, snd_config_t *conf)
 {
 	int err;
-	char buf[256], errbuf[256];
+	char buf[256];
 	const char *str, *id;
 	const char *lib = NULL, *install = NULL;
 	snd_config_t *type = NULL, *args = NULL;
 	snd_config_iterator_t i, next;
 	int (*install_func)(snd_pcm_t *pcm, snd_config_t *args) = NULL;
-	void *h = NULL;
 
 	if (snd_config_get_type(conf) != SND_CONFIG_TYPE_COMPOUND) {
 		SNDERR("Invalid hook definition");
@@ -424,19 +424,11 @@ static int snd_pcm_hook_add_conf(snd_pcm_t *pcm, snd_config_t *root, snd_config_
 		install = buf;
 		snprintf(buf, sizeof(buf), "_snd_pcm_hook_%s_install", str);
 	}
-	h = INTERNAL(snd_dlopen)(lib, RTLD_NOW, errbuf, sizeof(errbuf));
-	install_func = h ? snd_dlsym(h, install, SND_DLSYM_VERSION(SND_PCM_DLSYM_VERSION)) : NULL;
-	err = 0;
-	if (!h) {
-		SNDERR("Cannot open shared library %s (%s)",
-		       lib ? lib : "[builtin]", errbuf);
-		err = -ENOENT;
-	} else if (!install_func) {
-		SNDERR("symbol %s is not defined inside %s", install,
-		       lib ? lib : "[builtin]");
-		snd_dlclose(h);
-		err = -ENXIO;
-	}
+	/* the resolved function is kept in the process-wide dlobj cache,
+	 * so repeated opens of a hooked PCM don't dlopen/dlsym again */
+	install_func = snd_dlobj_cache_get(lib, install,
+					   SND_DLSYM_VERSION(SND_PCM_DLSYM_VERSION), 1);
+	err = install_func ? 0 : -ENXIO;
        _err:
 	if (type)
 		snd_config_delete(type);
@@ -454,11 +446,10 @@ static int snd_pcm_hook_add_conf(snd_pcm_t *pcm, snd_config_t *root, snd_config_
 		err = install_func(pcm, args);
 
 	if (err >= 0)
-		err = hook_add_dlobj(pcm, h);
+		err = hook_add_dlobj(pcm, install_func);
 
 	if (err < 0) {
-		if(h)
-			snd_dlclose(h);
+		snd_dlobj_cache_put(install_func);
 		return err;
 	}
 	return 0;
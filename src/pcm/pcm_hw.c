@@ -40,6 +40,17 @@
 #include <fcntl.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
+#ifdef HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#if defined(IORING_ENTER_EXT_ARG) && \
+    defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define USE_IO_URING_WAIT
+#endif
+#endif
 
 //#define DEBUG_RW		/* use to debug readi/writei/readn/writen */
 //#define DEBUG_MMAP		/* debug mmap_commit */
@@ -105,6 +116,21 @@ typedef struct {
 	snd_timer_t *period_timer;
 	struct pollfd period_timer_pfd;
 	int period_timer_need_poll;
+	int use_uring;
+#ifdef USE_IO_URING_WAIT
+	struct snd_pcm_hw_uring *uring;
+#endif
+	unsigned int hwptr_stale_us;
+	struct timespec hwptr_sync_time;
+	/* replay of the last STATUS ioctl while the mapped view is
+	 * unchanged, see snd_pcm_hw_status()
+	 */
+	bool status_cached;
+	snd_pcm_state_t status_state;
+	snd_pcm_uframes_t status_hw_ptr;
+	snd_pcm_uframes_t status_appl_ptr;
+	struct timespec status_tstamp;
+	snd_pcm_status_t status_cache;
 	/* restricted parameters */
 	snd_pcm_format_t format;
 	struct {
@@ -116,8 +142,11 @@ typedef struct {
 	/* for chmap */
 	unsigned int chmap_caps;
 	snd_pcm_chmap_query_t **chmap_override;
+	snd_pcm_chmap_query_t **chmap_cache;
 } snd_pcm_hw_t;
 
+static void chmap_cache_free(snd_pcm_hw_t *hw);
+
 #define SNDRV_FILE_PCM_STREAM_PLAYBACK		ALSA_DEVICE_DIRECTORY "pcmC%iD%ip"
 #define SNDRV_FILE_PCM_STREAM_CAPTURE		ALSA_DEVICE_DIRECTORY "pcmC%iD%ic"
 #define SNDRV_PCM_VERSION_MAX			SNDRV_PROTOCOL_VERSION(2, 0, 9)
@@ -139,6 +168,29 @@ struct timespec snd_pcm_hw_fast_tstamp(snd_pcm_t *pcm)
 }
 #endif /* DOC_HIDDEN */
 
+/*
+ * Opt-in staleness window for the hardware pointer: when the last
+ * position query is at most hwptr_stale_us microseconds old, trust the
+ * known position instead of issuing another syscall.  Meters polling
+ * avail thousands of times per second per stream then pay for one
+ * query per window.
+ */
+static int hwptr_fresh(snd_pcm_hw_t *hw)
+{
+	struct timespec now;
+	long long diff;
+
+	if (!hw->hwptr_stale_us)
+		return 0;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	diff = (now.tv_sec - hw->hwptr_sync_time.tv_sec) * 1000000LL +
+	       (now.tv_nsec - hw->hwptr_sync_time.tv_nsec) / 1000;
+	if (diff >= 0 && diff < hw->hwptr_stale_us)
+		return 1;
+	hw->hwptr_sync_time = now;
+	return 0;
+}
+
 static int sync_ptr1(snd_pcm_hw_t *hw, unsigned int flags)
 {
 	int err;
@@ -341,9 +393,102 @@ static inline int hw_refine_call(snd_pcm_hw_t *pcm_hw, snd_pcm_hw_params_t *para
 	return use_old_hw_params_ioctl(pcm_hw->fd, SND_PCM_IOCTL_HW_REFINE_OLD, params);
 }
 
+/*
+ * Optional memoization of HW_REFINE results, enabled with the
+ * ALSA_HW_PARAMS_CACHE environment variable.  Through snd_pcm_plug the
+ * constraint refinement runs once per plugin layer on every open, with
+ * identical results on an otherwise idle device.  The parameter space
+ * reported by the kernel may depend on other substreams being active
+ * (e.g. a rate locked by another stream on the same device), therefore
+ * the cache is an opt-in for setups with a fixed device configuration.
+ */
+struct hw_refine_cache_entry {
+	struct hw_refine_cache_entry *next;
+	int card, device, subdevice;
+	snd_pcm_stream_t stream;
+	snd_pcm_hw_params_t key;
+	snd_pcm_hw_params_t res;
+};
+
+#define HW_REFINE_CACHE_MAX	64
+
+static struct hw_refine_cache_entry *hw_refine_cache;
+static unsigned int hw_refine_cache_count;
+#ifdef HAVE_LIBPTHREAD
+static pthread_mutex_t hw_refine_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static int hw_refine_cache_enabled(void)
+{
+	static int enabled = -1;
+
+	if (enabled < 0) {
+		const char *e = getenv("ALSA_HW_PARAMS_CACHE");
+		enabled = e && *e && strcmp(e, "0") != 0;
+	}
+	return enabled;
+}
+
+static int hw_refine_cache_lookup(snd_pcm_hw_t *hw, snd_pcm_stream_t stream,
+				  snd_pcm_hw_params_t *params)
+{
+	struct hw_refine_cache_entry *e;
+	int hit = 0;
+
+#ifdef HAVE_LIBPTHREAD
+	pthread_mutex_lock(&hw_refine_cache_mutex);
+#endif
+	for (e = hw_refine_cache; e; e = e->next) {
+		if (e->card != hw->card || e->device != hw->device ||
+		    e->subdevice != hw->subdevice || e->stream != stream)
+			continue;
+		if (memcmp(&e->key, params, sizeof(*params)))
+			continue;
+		*params = e->res;
+		hit = 1;
+		break;
+	}
+#ifdef HAVE_LIBPTHREAD
+	pthread_mutex_unlock(&hw_refine_cache_mutex);
+#endif
+	return hit;
+}
+
+static void hw_refine_cache_store(snd_pcm_hw_t *hw, snd_pcm_stream_t stream,
+				  const snd_pcm_hw_params_t *key,
+				  const snd_pcm_hw_params_t *res)
+{
+	struct hw_refine_cache_entry *e;
+
+	e = malloc(sizeof(*e));
+	if (e == NULL)
+		return;
+	e->card = hw->card;
+	e->device = hw->device;
+	e->subdevice = hw->subdevice;
+	e->stream = stream;
+	e->key = *key;
+	e->res = *res;
+#ifdef HAVE_LIBPTHREAD
+	pthread_mutex_lock(&hw_refine_cache_mutex);
+#endif
+	if (hw_refine_cache_count < HW_REFINE_CACHE_MAX) {
+		e->next = hw_refine_cache;
+		hw_refine_cache = e;
+		hw_refine_cache_count++;
+		e = NULL;
+	}
+#ifdef HAVE_LIBPTHREAD
+	pthread_mutex_unlock(&hw_refine_cache_mutex);
+#endif
+	free(e);
+}
+
 static int snd_pcm_hw_hw_refine(snd_pcm_t *pcm, snd_pcm_hw_params_t *params)
 {
 	snd_pcm_hw_t *hw = pcm->private_data;
+	snd_pcm_hw_params_t key;
+	int cache = hw_refine_cache_enabled();
 	int err;
 
 	if (hw->format != SND_PCM_FORMAT_UNKNOWN) {
@@ -364,10 +509,16 @@ static int snd_pcm_hw_hw_refine(snd_pcm_t *pcm, snd_pcm_hw_params_t *params)
 			return err;
 	}
 
-	if (hw_refine_call(hw, params) < 0) {
-		err = -errno;
-		// SYSMSG("SNDRV_PCM_IOCTL_HW_REFINE failed");
-		return err;
+	if (cache)
+		key = *params;
+	if (!cache || !hw_refine_cache_lookup(hw, pcm->stream, params)) {
+		if (hw_refine_call(hw, params) < 0) {
+			err = -errno;
+			// SYSMSG("SNDRV_PCM_IOCTL_HW_REFINE failed");
+			return err;
+		}
+		if (cache)
+			hw_refine_cache_store(hw, pcm->stream, &key, params);
 	}
 
 	if (params->info != ~0U) {
@@ -407,6 +558,7 @@ static int snd_pcm_hw_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t * params)
 {
 	snd_pcm_hw_t *hw = pcm->private_data;
 	int err;
+	hw->status_cached = false;
 	if (hw_params_call(hw, params) < 0) {
 		err = -errno;
 		SYSMSG("SNDRV_PCM_IOCTL_HW_PARAMS failed (%i)", err);
@@ -417,6 +569,8 @@ static int snd_pcm_hw_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t * params)
 		params->info |= SND_PCM_INFO_MONOTONIC;
 	hw->perfect_drain = !!(params->info & SND_PCM_INFO_PERFECT_DRAIN) ||
 			    !!(params->flags & SND_PCM_HW_PARAMS_NO_DRAIN_SILENCE);
+	/* the channel map may depend on the configuration */
+	chmap_cache_free(hw);
 	return query_status_data(hw);
 }
 
@@ -512,6 +666,7 @@ static int snd_pcm_hw_hw_free(snd_pcm_t *pcm)
 {
 	snd_pcm_hw_t *hw = pcm->private_data;
 	int fd = hw->fd, err;
+	hw->status_cached = false;
 	snd_pcm_hw_change_timer(pcm, 0);
 	if (ioctl(fd, SNDRV_PCM_IOCTL_HW_FREE) < 0) {
 		err = -errno;
@@ -526,7 +681,9 @@ static int snd_pcm_hw_sw_params(snd_pcm_t *pcm, snd_pcm_sw_params_t * params)
 	snd_pcm_hw_t *hw = pcm->private_data;
 	int fd = hw->fd, err = 0;
 	int old_period_event = sw_get_period_event(params);
+	unsigned int old_wait_spin_us = sw_get_wait_spin_us(params);
 	sw_set_period_event(params, 0);
+	sw_set_wait_spin_us(params, 0);
 	if ((snd_pcm_tstamp_t) params->tstamp_mode == pcm->tstamp_mode &&
 	    (snd_pcm_tstamp_type_t) params->tstamp_type == pcm->tstamp_type &&
 	    params->period_step == pcm->period_step &&
@@ -578,6 +735,7 @@ static int snd_pcm_hw_sw_params(snd_pcm_t *pcm, snd_pcm_sw_params_t * params)
 	}
  out:
 	sw_set_period_event(params, old_period_event);
+	sw_set_wait_spin_us(params, old_wait_spin_us);
 	return err;
 }
 
@@ -606,6 +764,30 @@ static int snd_pcm_hw_status(snd_pcm_t *pcm, snd_pcm_status_t * status)
 {
 	snd_pcm_hw_t *hw = pcm->private_data;
 	int fd = hw->fd, err;
+	bool mapped = !hw->mmap_status_fallbacked &&
+		      !hw->mmap_control_fallbacked;
+
+	if (hw->status_cached && mapped &&
+	    (snd_pcm_state_t) hw->mmap_status->state == hw->status_state &&
+	    hw->mmap_status->hw_ptr == hw->status_hw_ptr &&
+	    hw->mmap_control->appl_ptr == hw->status_appl_ptr &&
+	    hw->mmap_status->tstamp.tv_sec == hw->status_tstamp.tv_sec &&
+	    hw->mmap_status->tstamp.tv_nsec == hw->status_tstamp.tv_nsec) {
+		/* nothing moved since the last query, the kernel would
+		 * assemble the identical answer - replay it
+		 */
+		*status = hw->status_cache;
+		return 0;
+	}
+	/* snapshot the markers before the ioctl; anything advancing in
+	 * between only invalidates the cache early
+	 */
+	if (mapped) {
+		hw->status_state = (snd_pcm_state_t) hw->mmap_status->state;
+		hw->status_hw_ptr = hw->mmap_status->hw_ptr;
+		hw->status_appl_ptr = hw->mmap_control->appl_ptr;
+		hw->status_tstamp = FAST_PCM_TSTAMP(hw);
+	}
 	if (SNDRV_PROTOCOL_VERSION(2, 0, 13) > hw->version) {
 		if (ioctl(fd, SNDRV_PCM_IOCTL_STATUS, status) < 0) {
 			err = -errno;
@@ -623,6 +805,10 @@ static int snd_pcm_hw_status(snd_pcm_t *pcm, snd_pcm_status_t * status)
 		status->tstamp.tv_nsec *= 1000L;
 		status->trigger_tstamp.tv_nsec *= 1000L;
 	}
+	if (mapped) {
+		hw->status_cache = *status;
+		hw->status_cached = true;
+	}
 	return 0;
 }
 
@@ -652,6 +838,8 @@ static int snd_pcm_hw_hwsync(snd_pcm_t *pcm)
 {
 	snd_pcm_hw_t *hw = pcm->private_data;
 	int fd = hw->fd, err;
+	if (hwptr_fresh(hw))
+		return 0;
 	if (SNDRV_PROTOCOL_VERSION(2, 0, 3) <= hw->version) {
 		if (hw->mmap_status_fallbacked) {
 			err = request_hwsync(hw);
@@ -700,6 +888,10 @@ static int snd_pcm_hw_prepare(snd_pcm_t *pcm)
 		SYSMSG("SNDRV_PCM_IOCTL_PREPARE failed (%i)", err);
 		return err;
 	}
+	/* the chmap cache survives a reprepare; the map can only change
+	 * with new hw_params, and dropping it here made every xrun
+	 * recovery pay a control device query on the next chmap call
+	 */
 	return query_status_and_control_data(hw);
 }
 
@@ -1166,6 +1358,251 @@ static int snd_pcm_hw_munmap(snd_pcm_t *pcm ATTRIBUTE_UNUSED)
 	return 0;
 }
 
+#ifdef USE_IO_URING_WAIT
+
+/*
+ * Minimal io_uring based wait backend (no liburing dependency).
+ * A multishot POLL_ADD request is armed once on the device fd and the
+ * completions are reaped with io_uring_enter(); unlike poll() the kernel
+ * poll entry is not set up and torn down again on every period wakeup.
+ * Note that the read/write transfers themselves are ioctl based and
+ * cannot be submitted through the ring; only the wait path is covered.
+ */
+struct snd_pcm_hw_uring {
+	int ring_fd;
+	void *sq_ring;
+	size_t sq_ring_size;
+	void *cq_ring;
+	size_t cq_ring_size;
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+	unsigned int *sq_head;
+	unsigned int *sq_tail;
+	unsigned int *sq_mask;
+	unsigned int *sq_array;
+	unsigned int *cq_head;
+	unsigned int *cq_tail;
+	unsigned int *cq_mask;
+	struct io_uring_cqe *cqes;
+	int armed;
+};
+
+static int hw_io_uring_setup(unsigned int entries, struct io_uring_params *p)
+{
+	return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int hw_io_uring_enter(int fd, unsigned int to_submit,
+			     unsigned int min_complete, unsigned int flags,
+			     const void *arg, size_t argsz)
+{
+	return syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+		       flags, arg, argsz);
+}
+
+static void hw_uring_free(snd_pcm_hw_t *hw)
+{
+	struct snd_pcm_hw_uring *u = hw->uring;
+
+	if (!u)
+		return;
+	hw->uring = NULL;
+	if (u->sqes)
+		munmap(u->sqes, u->sqes_size);
+	if (u->cq_ring && u->cq_ring != u->sq_ring)
+		munmap(u->cq_ring, u->cq_ring_size);
+	if (u->sq_ring)
+		munmap(u->sq_ring, u->sq_ring_size);
+	if (u->ring_fd >= 0)
+		close(u->ring_fd);
+	free(u);
+}
+
+static int hw_uring_init(snd_pcm_hw_t *hw)
+{
+	struct io_uring_params p;
+	struct snd_pcm_hw_uring *u;
+
+	u = calloc(1, sizeof(*u));
+	if (u == NULL)
+		return -ENOMEM;
+	memset(&p, 0, sizeof(p));
+	u->ring_fd = hw_io_uring_setup(4, &p);
+	if (u->ring_fd < 0) {
+		free(u);
+		return -errno;
+	}
+	/* the timeout argument of io_uring_enter() needs EXT_ARG */
+	if (!(p.features & IORING_FEAT_EXT_ARG)) {
+		close(u->ring_fd);
+		free(u);
+		return -ENOSYS;
+	}
+	u->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+	u->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (u->cq_ring_size > u->sq_ring_size)
+			u->sq_ring_size = u->cq_ring_size;
+		u->cq_ring_size = u->sq_ring_size;
+	}
+	u->sq_ring = mmap(NULL, u->sq_ring_size, PROT_READ|PROT_WRITE,
+			  MAP_SHARED|MAP_POPULATE, u->ring_fd,
+			  IORING_OFF_SQ_RING);
+	if (u->sq_ring == MAP_FAILED) {
+		u->sq_ring = NULL;
+		goto error;
+	}
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		u->cq_ring = u->sq_ring;
+	} else {
+		u->cq_ring = mmap(NULL, u->cq_ring_size, PROT_READ|PROT_WRITE,
+				  MAP_SHARED|MAP_POPULATE, u->ring_fd,
+				  IORING_OFF_CQ_RING);
+		if (u->cq_ring == MAP_FAILED) {
+			u->cq_ring = NULL;
+			goto error;
+		}
+	}
+	u->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	u->sqes = mmap(NULL, u->sqes_size, PROT_READ|PROT_WRITE,
+		       MAP_SHARED|MAP_POPULATE, u->ring_fd, IORING_OFF_SQES);
+	if (u->sqes == MAP_FAILED) {
+		u->sqes = NULL;
+		goto error;
+	}
+	u->sq_head = (unsigned int *)((char *)u->sq_ring + p.sq_off.head);
+	u->sq_tail = (unsigned int *)((char *)u->sq_ring + p.sq_off.tail);
+	u->sq_mask = (unsigned int *)((char *)u->sq_ring + p.sq_off.ring_mask);
+	u->sq_array = (unsigned int *)((char *)u->sq_ring + p.sq_off.array);
+	u->cq_head = (unsigned int *)((char *)u->cq_ring + p.cq_off.head);
+	u->cq_tail = (unsigned int *)((char *)u->cq_ring + p.cq_off.tail);
+	u->cq_mask = (unsigned int *)((char *)u->cq_ring + p.cq_off.ring_mask);
+	u->cqes = (struct io_uring_cqe *)((char *)u->cq_ring + p.cq_off.cqes);
+	hw->uring = u;
+	return 0;
+
+ error:
+	hw->uring = u;
+	hw_uring_free(hw);
+	return -ENOMEM;
+}
+
+static void hw_uring_arm_poll(snd_pcm_hw_t *hw, unsigned short events)
+{
+	struct snd_pcm_hw_uring *u = hw->uring;
+	unsigned int tail = *u->sq_tail;
+	unsigned int idx = tail & *u->sq_mask;
+	struct io_uring_sqe *sqe = &u->sqes[idx];
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = hw->fd;
+	sqe->poll_events = events;
+#ifdef IORING_POLL_ADD_MULTI
+	sqe->len = IORING_POLL_ADD_MULTI;
+#endif
+	u->sq_array[idx] = idx;
+	__atomic_store_n(u->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	u->armed = 1;
+}
+
+static int snd_pcm_hw_wait(snd_pcm_t *pcm, int timeout)
+{
+	snd_pcm_hw_t *hw = pcm->private_data;
+	struct snd_pcm_hw_uring *u;
+	unsigned short events;
+	int err;
+
+	if (!hw->use_uring)
+		return -ENOSYS;
+	if (hw->uring == NULL) {
+		err = hw_uring_init(hw);
+		if (err < 0) {
+			/* old kernel, locked ring memory etc. - use poll() */
+			hw->use_uring = 0;
+			return -ENOSYS;
+		}
+	}
+	u = hw->uring;
+	if (pcm->stream == SND_PCM_STREAM_PLAYBACK)
+		events = POLLOUT;
+	else
+		events = POLLIN;
+	for (;;) {
+		unsigned int head = *u->cq_head;
+		struct __kernel_timespec ts;
+		struct io_uring_getevents_arg arg;
+		int res;
+
+		if (head != __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE)) {
+			const struct io_uring_cqe *cqe = &u->cqes[head & *u->cq_mask];
+
+			res = cqe->res;
+			if (!(cqe->flags & IORING_CQE_F_MORE))
+				u->armed = 0;
+			__atomic_store_n(u->cq_head, head + 1, __ATOMIC_RELEASE);
+			if (res == -ECANCELED)
+				continue;
+			if (res < 0) {
+				/* e.g. multishot poll not supported */
+				hw->use_uring = 0;
+				return -ENOSYS;
+			}
+			if (res & (POLLERR | POLLNVAL)) {
+				/* check more precisely */
+				switch (__snd_pcm_state(pcm)) {
+				case SND_PCM_STATE_XRUN:
+					return -EPIPE;
+				case SND_PCM_STATE_SUSPENDED:
+					return -ESTRPIPE;
+				case SND_PCM_STATE_DISCONNECTED:
+					return -ENODEV;
+				default:
+					return -EIO;
+				}
+			}
+			if (res & events)
+				return 1;
+			continue;
+		}
+		if (!u->armed) {
+			/* submit separately; a combined submit+getevents call
+			 * returns the submit count instead of -ETIME
+			 */
+			hw_uring_arm_poll(hw, events | POLLERR | POLLNVAL);
+			err = hw_io_uring_enter(u->ring_fd, 1, 0, 0, NULL, 0);
+			if (err < 0) {
+				hw->use_uring = 0;
+				return -ENOSYS;
+			}
+			/* the poll may have completed inline */
+			continue;
+		}
+		memset(&arg, 0, sizeof(arg));
+		if (timeout >= 0) {
+			ts.tv_sec = timeout / 1000;
+			ts.tv_nsec = (timeout % 1000) * 1000000LL;
+			arg.ts = (unsigned long)&ts;
+		}
+		__snd_pcm_unlock(pcm);
+		err = hw_io_uring_enter(u->ring_fd, 0, 1,
+					IORING_ENTER_GETEVENTS |
+					IORING_ENTER_EXT_ARG,
+					&arg, sizeof(arg));
+		__snd_pcm_lock(pcm);
+		if (err < 0) {
+			if (errno == ETIME)
+				return 0;
+			if (errno == EINTR && !PCMINABORT(pcm) &&
+			    !(pcm->mode & SND_PCM_EINTR))
+				continue;
+			return -errno;
+		}
+	}
+}
+
+#endif /* USE_IO_URING_WAIT */
+
 static int snd_pcm_hw_close(snd_pcm_t *pcm)
 {
 	snd_pcm_hw_t *hw = pcm->private_data;
@@ -1177,6 +1614,10 @@ static int snd_pcm_hw_close(snd_pcm_t *pcm)
 
 	unmap_status_and_control_data(hw);
 
+#ifdef USE_IO_URING_WAIT
+	hw_uring_free(hw);
+#endif
+	chmap_cache_free(hw);
 	free(hw);
 	return err;
 }
@@ -1200,7 +1641,8 @@ static snd_pcm_sframes_t snd_pcm_hw_avail_update(snd_pcm_t *pcm)
 	snd_pcm_hw_t *hw = pcm->private_data;
 	snd_pcm_uframes_t avail;
 
-	query_status_data(hw);
+	if (!hwptr_fresh(hw))
+		query_status_data(hw);
 	avail = snd_pcm_mmap_avail(pcm);
 	switch (FAST_PCM_STATE(hw)) {
 	case SNDRV_PCM_STATE_RUNNING:
@@ -1242,6 +1684,40 @@ static int snd_pcm_hw_htimestamp(snd_pcm_t *pcm, snd_pcm_uframes_t *avail,
 	return 0;
 }
 
+static struct timespec snd_pcm_hw_fast_audio_tstamp(snd_pcm_t *pcm)
+{
+	struct timespec res;
+	snd_pcm_hw_t *hw = pcm->private_data;
+	res = hw->mmap_status->audio_tstamp;
+	if (SNDRV_PROTOCOL_VERSION(2, 0, 5) > hw->version)
+		res.tv_nsec *= 1000L;
+	return res;
+}
+
+static int snd_pcm_hw_audio_htimestamp(snd_pcm_t *pcm, snd_pcm_uframes_t *avail,
+				       snd_htimestamp_t *tstamp,
+				       snd_htimestamp_t *audio_tstamp)
+{
+	snd_pcm_sframes_t avail1;
+	int ok = 0;
+
+	/* same stability loop as htimestamp, additionally picking up
+	 * the audio timestamp the kernel maintains in the status page
+	 */
+	while (1) {
+		avail1 = snd_pcm_hw_avail_update(pcm);
+		if (avail1 < 0)
+			return avail1;
+		if (ok && (snd_pcm_uframes_t)avail1 == *avail)
+			break;
+		*avail = avail1;
+		*tstamp = snd_pcm_hw_fast_tstamp(pcm);
+		*audio_tstamp = snd_pcm_hw_fast_audio_tstamp(pcm);
+		ok = 1;
+	}
+	return 0;
+}
+
 static void __fill_chmap_ctl_id(snd_ctl_elem_id_t *id, int dev, int subdev,
 				int stream)
 {
@@ -1376,6 +1852,12 @@ static void chmap_caps_set_error(snd_pcm_hw_t *hw, int type)
 	hw->chmap_caps |= (1 << (type + 8));
 }
 
+static void chmap_cache_free(snd_pcm_hw_t *hw)
+{
+	snd_pcm_free_chmaps(hw->chmap_cache);
+	hw->chmap_cache = NULL;
+}
+
 static snd_pcm_chmap_query_t **snd_pcm_hw_query_chmaps(snd_pcm_t *pcm)
 {
 	snd_pcm_hw_t *hw = pcm->private_data;
@@ -1384,33 +1866,53 @@ static snd_pcm_chmap_query_t **snd_pcm_hw_query_chmaps(snd_pcm_t *pcm)
 	if (hw->chmap_override)
 		return _snd_pcm_copy_chmap_query(hw->chmap_override);
 
+	if (hw->chmap_cache)
+		return _snd_pcm_copy_chmap_query(hw->chmap_cache);
+
 	if (!chmap_caps(hw, CHMAP_CTL_QUERY))
 		return NULL;
 
 	map = snd_pcm_query_chmaps_from_hw(hw->card, hw->device,
 					   hw->subdevice, pcm->stream);
-	if (map)
+	if (map) {
 		chmap_caps_set_ok(hw, CHMAP_CTL_QUERY);
-	else
+		/* the hardware channel maps are static; keep the result
+		 * for the next query (dropped again on prepare) */
+		hw->chmap_cache = _snd_pcm_copy_chmap_query(map);
+	} else
 		chmap_caps_set_error(hw, CHMAP_CTL_QUERY);
 	return map;
 }
 
-static snd_pcm_chmap_t *snd_pcm_hw_get_chmap(snd_pcm_t *pcm)
+static int snd_pcm_hw_get_chmap_buf(snd_pcm_t *pcm, snd_pcm_chmap_t *map,
+				    size_t maxlen)
 {
 	snd_pcm_hw_t *hw = pcm->private_data;
-	snd_pcm_chmap_t *map;
 	snd_ctl_t *ctl;
 	snd_ctl_elem_id_t id = {0};
 	snd_ctl_elem_value_t val = {0};
 	unsigned int i;
 	int ret;
 
-	if (hw->chmap_override)
-		return _snd_pcm_choose_fixed_chmap(pcm, hw->chmap_override);
+	if (hw->chmap_override) {
+		snd_pcm_chmap_t *src;
+		size_t size;
+
+		src = _snd_pcm_choose_fixed_chmap(pcm, hw->chmap_override);
+		if (!src)
+			return -ENXIO;
+		size = sizeof(*src) + src->channels * sizeof(src->pos[0]);
+		if (maxlen < size) {
+			free(src);
+			return -ENOSPC;
+		}
+		memcpy(map, src, size);
+		free(src);
+		return 0;
+	}
 
 	if (!chmap_caps(hw, CHMAP_CTL_GET))
-		return NULL;
+		return -ENXIO;
 
 	switch (FAST_PCM_STATE(hw)) {
 	case SNDRV_PCM_STATE_PREPARED:
@@ -1423,32 +1925,49 @@ static snd_pcm_chmap_t *snd_pcm_hw_get_chmap(snd_pcm_t *pcm)
 	default:
 		SYSMSG("Invalid PCM state for chmap_get: %s",
 		       snd_pcm_state_name(FAST_PCM_STATE(hw)));
-		return NULL;
+		return -EBADFD;
 	}
-	map = malloc(pcm->channels * sizeof(map->pos[0]) + sizeof(*map));
-	if (!map)
-		return NULL;
-	map->channels = pcm->channels;
+	if (maxlen < sizeof(*map) + pcm->channels * sizeof(map->pos[0]))
+		return -ENOSPC;
 	ret = snd_ctl_hw_open(&ctl, NULL, hw->card, 0);
 	if (ret < 0) {
-		free(map);
 		SYSMSG("Cannot open the associated CTL");
 		chmap_caps_set_error(hw, CHMAP_CTL_GET);
-		return NULL;
+		return ret;
 	}
 	fill_chmap_ctl_id(pcm, &id);
 	snd_ctl_elem_value_set_id(&val, &id);
 	ret = snd_ctl_elem_read(ctl, &val);
 	snd_ctl_close(ctl);
 	if (ret < 0) {
-		free(map);
 		SYSMSG("Cannot read Channel Map ctl");
 		chmap_caps_set_error(hw, CHMAP_CTL_GET);
-		return NULL;
+		return ret;
 	}
+	map->channels = pcm->channels;
 	for (i = 0; i < pcm->channels; i++)
 		map->pos[i] = snd_ctl_elem_value_get_integer(&val, i);
 	chmap_caps_set_ok(hw, CHMAP_CTL_GET);
+	return 0;
+}
+
+static snd_pcm_chmap_t *snd_pcm_hw_get_chmap(snd_pcm_t *pcm)
+{
+	snd_pcm_hw_t *hw = pcm->private_data;
+	snd_pcm_chmap_t *map;
+	size_t size;
+
+	if (hw->chmap_override)
+		return _snd_pcm_choose_fixed_chmap(pcm, hw->chmap_override);
+
+	size = sizeof(*map) + pcm->channels * sizeof(map->pos[0]);
+	map = malloc(size);
+	if (!map)
+		return NULL;
+	if (snd_pcm_hw_get_chmap_buf(pcm, map, size) < 0) {
+		free(map);
+		return NULL;
+	}
 	return map;
 }
 
@@ -1535,6 +2054,7 @@ static const snd_pcm_ops_t snd_pcm_hw_ops = {
 	.munmap = snd_pcm_hw_munmap,
 	.query_chmaps = snd_pcm_hw_query_chmaps,
 	.get_chmap = snd_pcm_hw_get_chmap,
+	.get_chmap_buf = snd_pcm_hw_get_chmap_buf,
 	.set_chmap = snd_pcm_hw_set_chmap,
 };
 
@@ -1564,9 +2084,13 @@ static const snd_pcm_fast_ops_t snd_pcm_hw_fast_ops = {
 	.avail_update = snd_pcm_hw_avail_update,
 	.mmap_commit = snd_pcm_hw_mmap_commit,
 	.htimestamp = snd_pcm_hw_htimestamp,
+	.audio_htimestamp = snd_pcm_hw_audio_htimestamp,
 	.poll_descriptors = NULL,
 	.poll_descriptors_count = NULL,
 	.poll_revents = NULL,
+#ifdef USE_IO_URING_WAIT
+	.wait = snd_pcm_hw_wait,
+#endif
 };
 
 static const snd_pcm_fast_ops_t snd_pcm_hw_fast_ops_timer = {
@@ -1595,6 +2119,7 @@ static const snd_pcm_fast_ops_t snd_pcm_hw_fast_ops_timer = {
 	.avail_update = snd_pcm_hw_avail_update,
 	.mmap_commit = snd_pcm_hw_mmap_commit,
 	.htimestamp = snd_pcm_hw_htimestamp,
+	.audio_htimestamp = snd_pcm_hw_audio_htimestamp,
 	.poll_descriptors = snd_pcm_hw_poll_descriptors,
 	.poll_descriptors_count = snd_pcm_hw_poll_descriptors_count,
 	.poll_revents = snd_pcm_hw_poll_revents,
@@ -1844,6 +2369,9 @@ pcm.name {
 	[device INT]		# Device number (default 0)
 	[subdevice INT]		# Subdevice number (default -1: first available)
 	[sync_ptr_ioctl BOOL]	# Use SYNC_PTR ioctl rather than the direct mmap access for control structures
+	[io_uring BOOL]		# Wait for events via io_uring rather than poll (falls back to poll when not available)
+	[hwptr_stale_us INT]	# Trust the last known hardware pointer for the given number
+				# of microseconds instead of querying the kernel again (default 0)
 	[nonblock BOOL]		# Force non-blocking open mode
 	[format STR]		# Restrict only to the given format
 	[channels INT]		# Restrict only to the given channels
@@ -1882,8 +2410,9 @@ int _snd_pcm_hw_open(snd_pcm_t **pcmp, const char *name,
 	snd_config_iterator_t i, next;
 	long card = -1, device = 0, subdevice = -1;
 	const char *str;
-	int err, sync_ptr_ioctl = 0;
+	int err, sync_ptr_ioctl = 0, io_uring = 0;
 	int min_rate = 0, max_rate = 0, channels = 0, drain_silence = -1;
+	long hwptr_stale_us = 0;
 	snd_pcm_format_t format = SND_PCM_FORMAT_UNKNOWN;
 	snd_config_t *n;
 	int nonblock = 1; /* non-block per default */
@@ -1933,6 +2462,26 @@ int _snd_pcm_hw_open(snd_pcm_t **pcmp, const char *name,
 			sync_ptr_ioctl = err;
 			continue;
 		}
+		if (strcmp(id, "io_uring") == 0) {
+			err = snd_config_get_bool(n);
+			if (err < 0)
+				continue;
+			io_uring = err;
+			continue;
+		}
+		if (strcmp(id, "hwptr_stale_us") == 0) {
+			err = snd_config_get_integer(n, &hwptr_stale_us);
+			if (err < 0) {
+				SNDERR("Invalid type for %s", id);
+				goto fail;
+			}
+			if (hwptr_stale_us < 0) {
+				SNDERR("Invalid value for %s", id);
+				err = -EINVAL;
+				goto fail;
+			}
+			continue;
+		}
 		if (strcmp(id, "nonblock") == 0) {
 			err = snd_config_get_bool(n);
 			if (err < 0)
@@ -2066,6 +2615,8 @@ int _snd_pcm_hw_open(snd_pcm_t **pcmp, const char *name,
 					 SND_PCM_NO_SOFTVOL);
 
 	hw = (*pcmp)->private_data;
+	hw->use_uring = io_uring;
+	hw->hwptr_stale_us = hwptr_stale_us;
 	if (format != SND_PCM_FORMAT_UNKNOWN)
 		hw->format = format;
 	if (channels > 0)
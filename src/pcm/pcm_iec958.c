@@ -59,6 +59,9 @@ struct snd_pcm_iec958 {
 	snd_pcm_format_t format;
 	unsigned int counter;
 	unsigned char status[24];
+	/* channel status bit (bit 30) expanded per frame position of the
+	 * 192-frame block; rebuilt whenever status[] changes */
+	uint32_t status_tbl[192];
 	unsigned int byteswap;
 	unsigned char preamble[3];	/* B/M/W or Z/X/Y */
 	snd_pcm_fast_ops_t fops;
@@ -76,6 +79,9 @@ enum { PREAMBLE_Z, PREAMBLE_X, PREAMBLE_Y };
  */
 static unsigned int iec958_parity(unsigned int data)
 {
+#ifdef __GNUC__
+	return __builtin_parity(data & 0x7ffffff0);
+#else
 	unsigned int parity;
 	int bit;
 
@@ -87,6 +93,18 @@ static unsigned int iec958_parity(unsigned int data)
 		data >>= 1;
 	}
 	return (parity & 1);
+#endif
+}
+
+/* expand the channel status bytes to the per-frame bit template */
+static void iec958_build_status_table(snd_pcm_iec958_t *iec)
+{
+	unsigned int counter;
+
+	for (counter = 0; counter < 192; counter++)
+		iec->status_tbl[counter] =
+			(iec->status[counter >> 3] & (1 << (counter & 7))) ?
+				0x40000000 : 0;
 }
 
 /*
@@ -104,16 +122,12 @@ static unsigned int iec958_parity(unsigned int data)
 
 static inline uint32_t iec958_subframe(snd_pcm_iec958_t *iec, uint32_t data, int channel)
 {
-	unsigned int byte = iec->counter >> 3;
-	unsigned int mask = 1 << (iec->counter - (byte << 3));
-
 	/* bit 4-27 */
 	data >>= 4;
 	data &= ~0xf;
 
 	/* set IEC status bits (up to 192 bits) */
-	if (iec->status[byte] & mask)
-		data |= 0x40000000;
+	data |= iec->status_tbl[iec->counter];
 
 	if (iec958_parity(data))	/* parity bit 4-30 */
 		data |= 0x80000000;
@@ -438,6 +452,7 @@ static int snd_pcm_iec958_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t * params
 			iec->status[4] |= ws;
 		}
 	}
+	iec958_build_status_table(iec);
 	return 0;
 }
 
@@ -583,10 +598,11 @@ int snd_pcm_iec958_open(snd_pcm_t **pcmp, const char *name, snd_pcm_format_t sfo
 	    sformat != SND_PCM_FORMAT_IEC958_SUBFRAME_LE &&
 	    sformat != SND_PCM_FORMAT_IEC958_SUBFRAME_BE)
 		return -EINVAL;
-	iec = calloc(1, sizeof(snd_pcm_iec958_t));
-	if (!iec) {
-		return -ENOMEM;
-	}
+	err = snd_pcm_new_priv(&pcm, SND_PCM_TYPE_IEC958, name, slave->stream,
+			       slave->mode, sizeof(snd_pcm_iec958_t),
+			       (void **)&iec);
+	if (err < 0)
+		return err;
 	snd_pcm_plugin_init(&iec->plug);
 	iec->sformat = sformat;
 	iec->plug.read = snd_pcm_iec958_read_areas;
@@ -601,16 +617,12 @@ int snd_pcm_iec958_open(snd_pcm_t **pcmp, const char *name, snd_pcm_format_t sfo
 		memcpy(iec->status, status_bits, sizeof(iec->status));
 	else
 		memcpy(iec->status, default_status_bits, sizeof(default_status_bits));
+	iec958_build_status_table(iec);
 
 	memcpy(iec->preamble, preamble_vals, 3);
 
 	iec->hdmi_mode = hdmi_mode;
 
-	err = snd_pcm_new(&pcm, SND_PCM_TYPE_IEC958, name, slave->stream, slave->mode);
-	if (err < 0) {
-		free(iec);
-		return err;
-	}
 	pcm->ops = &snd_pcm_iec958_ops;
 
 	iec->fops = snd_pcm_plugin_fast_ops;
@@ -620,6 +632,7 @@ int snd_pcm_iec958_open(snd_pcm_t **pcmp, const char *name, snd_pcm_format_t sfo
 
 	pcm->private_data = iec;
 	pcm->poll_fd = slave->poll_fd;
+	pcm->poll_dynamic = slave->poll_dynamic;
 	pcm->poll_events = slave->poll_events;
 	pcm->tstamp_type = slave->tstamp_type;
 	snd_pcm_set_hw_ptr(pcm, &iec->plug.hw_ptr, -1, 0);
@@ -43,6 +43,8 @@ typedef struct snd_pcm_ioplug_priv {
 	snd_pcm_ioplug_t *data;
 	struct snd_ext_parm params[SND_PCM_IOPLUG_HW_PARAMS];
 	snd_pcm_uframes_t last_hw;
+	snd_pcm_uframes_t hw_ptr_valid;	/* pointer validity horizon (frames) */
+	snd_htimestamp_t hw_ptr_tstamp;	/* when the horizon was recorded */
 	snd_pcm_uframes_t avail_max;
 	snd_htimestamp_t trigger_tstamp;
 } ioplug_priv_t;
@@ -58,8 +60,28 @@ static void snd_pcm_ioplug_hw_ptr_update(snd_pcm_t *pcm)
 {
 	ioplug_priv_t *io = pcm->private_data;
 	snd_pcm_sframes_t hw;
-
-	hw = io->data->callback->pointer(io->data);
+	snd_pcm_uframes_t valid = 0;
+
+	if (io->hw_ptr_valid && io->data->state == SND_PCM_STATE_RUNNING) {
+		/* the last queried position cannot have advanced yet;
+		 * skip the redundant query */
+		snd_htimestamp_t now;
+		int64_t elapsed;
+
+		gettimestamp(&now, pcm->tstamp_type);
+		elapsed = (now.tv_sec - io->hw_ptr_tstamp.tv_sec) * 1000000000LL +
+			(now.tv_nsec - io->hw_ptr_tstamp.tv_nsec);
+		if (elapsed >= 0 && elapsed < 1000000000LL &&
+		    (uint64_t)elapsed * pcm->rate <
+		    (uint64_t)io->hw_ptr_valid * 1000000000ULL)
+			return;
+		io->hw_ptr_valid = 0;
+	}
+	if (io->data->version >= 0x010003 &&
+	    io->data->callback->pointer_with_avail)
+		hw = io->data->callback->pointer_with_avail(io->data, &valid);
+	else
+		hw = io->data->callback->pointer(io->data);
 	if (hw >= 0) {
 		snd_pcm_uframes_t delta;
 		snd_pcm_uframes_t avail;
@@ -80,6 +102,10 @@ static void snd_pcm_ioplug_hw_ptr_update(snd_pcm_t *pcm)
 				snd_pcm_ioplug_drop(pcm);
 		}
 		io->last_hw = (snd_pcm_uframes_t)hw;
+		if (valid) {
+			io->hw_ptr_valid = valid;
+			gettimestamp(&io->hw_ptr_tstamp, pcm->tstamp_type);
+		}
 	} else {
 		if (io->data->state == SND_PCM_STATE_DRAINING)
 			snd_pcm_ioplug_drop(pcm);
@@ -160,6 +186,7 @@ static int snd_pcm_ioplug_reset(snd_pcm_t *pcm)
 	io->data->appl_ptr = 0;
 	io->data->hw_ptr = 0;
 	io->last_hw = 0;
+	io->hw_ptr_valid = 0;
 	io->avail_max = 0;
 	return 0;
 }
@@ -1109,6 +1136,8 @@ int snd_pcm_ioplug_create(snd_pcm_ioplug_t *ioplug, const char *name,
 	pcm->ops = &snd_pcm_ioplug_ops;
 	pcm->fast_ops = &snd_pcm_ioplug_fast_ops;
 	pcm->private_data = io;
+	/* the plugin may change its descriptors at any time */
+	pcm->poll_dynamic = 1;
 
 	snd_pcm_set_hw_ptr(pcm, &ioplug->hw_ptr, -1, 0);
 	snd_pcm_set_appl_ptr(pcm, &ioplug->appl_ptr, -1, 0);
@@ -37,6 +37,9 @@
 #include <dirent.h>
 #include <locale.h>
 #include <math.h>
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
 
 #include "ladspa.h"
 
@@ -54,6 +57,10 @@ typedef enum _snd_pcm_ladspa_policy {
 	SND_PCM_LADSPA_POLICY_DUPLICATE		/* duplicate bindings for all channels */
 } snd_pcm_ladspa_policy_t;
 
+#ifdef HAVE_LIBPTHREAD
+struct snd_pcm_ladspa_sched;
+#endif
+
 typedef struct {
 	/* This field need to be the first */
 	snd_pcm_plugin_t plug;
@@ -63,6 +70,11 @@ typedef struct {
 	unsigned int channels;			/* forced input channels, 0 = auto */
 	unsigned int allocated;			/* count of allocated samples */
 	LADSPA_Data *zero[2];			/* zero input or dummy output */
+#ifdef HAVE_LIBPTHREAD
+	struct snd_pcm_ladspa_sched *sched;	/* parallel graph execution,
+						 * NULL for a pure chain
+						 */
+#endif
 } snd_pcm_ladspa_t;
  
 typedef struct {
@@ -108,6 +120,48 @@ typedef struct {
 	struct list_head instances;		/* one LADSPA plugin might be used multiple times */
 } snd_pcm_ladspa_plugin_t;
 
+#ifdef HAVE_LIBPTHREAD
+
+/* one schedulable unit - a plugin instance plus its dependency links */
+typedef struct {
+	snd_pcm_ladspa_instance_t *instance;
+	unsigned int ndeps;			/* count of predecessors */
+	unsigned int nsucc;			/* count of successors */
+	unsigned int *succ;			/* task indices of successors */
+	unsigned int pending;			/* countdown for the block */
+} snd_pcm_ladspa_task_t;
+
+/* dependency-counting scheduler for channel-independent branches;
+ * built only when the instance graph offers real parallelism
+ */
+typedef struct snd_pcm_ladspa_sched {
+	snd_pcm_ladspa_task_t *tasks;
+	unsigned int count;
+	unsigned int nthreads;
+	pthread_t *threads;
+	pthread_mutex_t lock;
+	pthread_cond_t work;			/* a task became ready */
+	pthread_cond_t done;			/* the block finished */
+	unsigned int *ready;			/* ready-task fifo, each task
+						 * is queued once per block
+						 */
+	unsigned int ready_head, ready_tail;
+	unsigned int remaining;
+	int shutdown;
+	/* parameters of the block being processed */
+	const snd_pcm_channel_area_t *first_areas;	/* client side */
+	const snd_pcm_channel_area_t *in_areas;
+	const snd_pcm_channel_area_t *out_areas;
+	snd_pcm_uframes_t in_offset;
+	snd_pcm_uframes_t out_offset;
+	unsigned int frames;
+} snd_pcm_ladspa_sched_t;
+
+static void snd_pcm_ladspa_build_sched(snd_pcm_t *pcm, snd_pcm_ladspa_t *ladspa);
+static void snd_pcm_ladspa_free_sched(snd_pcm_ladspa_t *ladspa);
+
+#endif /* HAVE_LIBPTHREAD */
+
 #endif /* DOC_HIDDEN */
 
 static unsigned int snd_pcm_ladspa_count_ports(snd_pcm_ladspa_plugin_t *lplug,
@@ -320,7 +374,11 @@ static void snd_pcm_ladspa_free_instances(snd_pcm_t *pcm, snd_pcm_ladspa_t *lads
 {
 	struct list_head *list, *pos, *pos1, *next1;
 	unsigned int idx;
-	
+
+#ifdef HAVE_LIBPTHREAD
+	if (cleanup)
+		snd_pcm_ladspa_free_sched(ladspa);
+#endif
 	list = pcm->stream == SND_PCM_STREAM_PLAYBACK ? &ladspa->pplugins : &ladspa->cplugins;
 	list_for_each(pos, list) {
 		snd_pcm_ladspa_plugin_t *plugin = list_entry(pos, snd_pcm_ladspa_plugin_t, list);
@@ -836,6 +894,9 @@ static int snd_pcm_ladspa_init(snd_pcm_t *pcm)
 		snd_pcm_ladspa_free_instances(pcm, ladspa, 1);
 		return err;
 	}
+#ifdef HAVE_LIBPTHREAD
+	snd_pcm_ladspa_build_sched(pcm, ladspa);
+#endif
 	return 0;
 }
 
@@ -847,6 +908,278 @@ static int snd_pcm_ladspa_hw_free(snd_pcm_t *pcm)
 	return snd_pcm_generic_hw_free(pcm);
 }
 
+#ifdef HAVE_LIBPTHREAD
+
+static int snd_pcm_ladspa_arrays_intersect(const snd_pcm_ladspa_array_t *a,
+					   const snd_pcm_ladspa_array_t *b)
+{
+	unsigned int i, j;
+
+	for (i = 0; i < a->size; i++)
+		for (j = 0; j < b->size; j++)
+			if (a->array[i] == b->array[j])
+				return 1;
+	return 0;
+}
+
+/* two instances conflict when the later one reads or overwrites a
+ * channel the earlier one touches; two pure readers of the same input
+ * channel stay independent
+ */
+static int snd_pcm_ladspa_instances_conflict(const snd_pcm_ladspa_instance_t *a,
+					     const snd_pcm_ladspa_instance_t *b)
+{
+	return snd_pcm_ladspa_arrays_intersect(&a->output.channels, &b->input.channels) ||
+	       snd_pcm_ladspa_arrays_intersect(&a->output.channels, &b->output.channels) ||
+	       snd_pcm_ladspa_arrays_intersect(&a->input.channels, &b->output.channels);
+}
+
+/* connect the ports of one instance for the current block and run it;
+ * workers always execute a whole instance, so each LADSPA handle is
+ * driven by a single thread at a time
+ */
+static void snd_pcm_ladspa_run_one(snd_pcm_ladspa_sched_t *sched,
+				   snd_pcm_ladspa_instance_t *instance)
+{
+	LADSPA_Data *data;
+	unsigned int idx, chn;
+
+	for (idx = 0; idx < instance->input.channels.size; idx++) {
+		chn = instance->input.channels.array[idx];
+		data = instance->input.data[idx];
+		if (data == NULL) {
+			data = (LADSPA_Data *)((char *)sched->in_areas[chn].addr + (sched->first_areas[chn].first / 8));
+			data += sched->in_offset;
+		}
+		instance->desc->connect_port(instance->handle, instance->input.ports.array[idx], data);
+	}
+	for (idx = 0; idx < instance->output.channels.size; idx++) {
+		chn = instance->output.channels.array[idx];
+		data = instance->output.data[idx];
+		if (data == NULL) {
+			data = (LADSPA_Data *)((char *)sched->out_areas[chn].addr + (sched->first_areas[chn].first / 8));
+			data += sched->out_offset;
+		}
+		instance->desc->connect_port(instance->handle, instance->output.ports.array[idx], data);
+	}
+	instance->desc->run(instance->handle, sched->frames);
+}
+
+/* shared by the worker threads and the caller; takes ready tasks from
+ * the fifo and releases the successors when their last dependency ran
+ */
+static void snd_pcm_ladspa_sched_loop(snd_pcm_ladspa_sched_t *sched, int caller)
+{
+	snd_pcm_ladspa_task_t *task;
+	unsigned int idx, i;
+
+	pthread_mutex_lock(&sched->lock);
+	for (;;) {
+		if (sched->ready_head != sched->ready_tail) {
+			idx = sched->ready[sched->ready_head++];
+			task = &sched->tasks[idx];
+			pthread_mutex_unlock(&sched->lock);
+			snd_pcm_ladspa_run_one(sched, task->instance);
+			pthread_mutex_lock(&sched->lock);
+			for (i = 0; i < task->nsucc; i++) {
+				if (--sched->tasks[task->succ[i]].pending == 0) {
+					sched->ready[sched->ready_tail++] = task->succ[i];
+					pthread_cond_signal(&sched->work);
+				}
+			}
+			if (--sched->remaining == 0)
+				pthread_cond_broadcast(&sched->done);
+			continue;
+		}
+		if (caller) {
+			if (sched->remaining == 0)
+				break;
+			pthread_cond_wait(&sched->done, &sched->lock);
+		} else {
+			if (sched->shutdown)
+				break;
+			pthread_cond_wait(&sched->work, &sched->lock);
+		}
+	}
+	pthread_mutex_unlock(&sched->lock);
+}
+
+static void *snd_pcm_ladspa_sched_thread(void *data)
+{
+	snd_pcm_ladspa_sched_loop(data, 0);
+	return NULL;
+}
+
+static void snd_pcm_ladspa_sched_run(snd_pcm_ladspa_sched_t *sched,
+				     const snd_pcm_channel_area_t *areas,
+				     snd_pcm_uframes_t offset,
+				     const snd_pcm_channel_area_t *slave_areas,
+				     snd_pcm_uframes_t slave_offset,
+				     unsigned int frames,
+				     int capture)
+{
+	unsigned int i;
+
+	pthread_mutex_lock(&sched->lock);
+	sched->first_areas = areas;
+	sched->in_areas = capture ? slave_areas : areas;
+	sched->in_offset = capture ? slave_offset : offset;
+	sched->out_areas = capture ? areas : slave_areas;
+	sched->out_offset = capture ? offset : slave_offset;
+	sched->frames = frames;
+	sched->ready_head = sched->ready_tail = 0;
+	for (i = 0; i < sched->count; i++) {
+		sched->tasks[i].pending = sched->tasks[i].ndeps;
+		if (sched->tasks[i].ndeps == 0)
+			sched->ready[sched->ready_tail++] = i;
+	}
+	sched->remaining = sched->count;
+	pthread_cond_broadcast(&sched->work);
+	pthread_mutex_unlock(&sched->lock);
+	snd_pcm_ladspa_sched_loop(sched, 1);
+}
+
+static void snd_pcm_ladspa_free_sched(snd_pcm_ladspa_t *ladspa)
+{
+	snd_pcm_ladspa_sched_t *sched = ladspa->sched;
+	unsigned int i;
+
+	if (sched == NULL)
+		return;
+	pthread_mutex_lock(&sched->lock);
+	sched->shutdown = 1;
+	pthread_cond_broadcast(&sched->work);
+	pthread_mutex_unlock(&sched->lock);
+	for (i = 0; i < sched->nthreads; i++)
+		pthread_join(sched->threads[i], NULL);
+	pthread_mutex_destroy(&sched->lock);
+	pthread_cond_destroy(&sched->work);
+	pthread_cond_destroy(&sched->done);
+	for (i = 0; i < sched->count; i++)
+		free(sched->tasks[i].succ);
+	free(sched->tasks);
+	free(sched->threads);
+	free(sched->ready);
+	free(sched);
+	ladspa->sched = NULL;
+}
+
+/* analyze the instance graph and build the scheduler; best effort -
+ * a pure chain or any failure leaves the serial execution in place
+ */
+static void snd_pcm_ladspa_build_sched(snd_pcm_t *pcm, snd_pcm_ladspa_t *ladspa)
+{
+	struct list_head *list, *pos, *pos1;
+	snd_pcm_ladspa_sched_t *sched;
+	snd_pcm_ladspa_instance_t **instances;
+	unsigned char *edges;
+	unsigned int *level;
+	unsigned int count = 0, width = 0, i, j;
+	long ncpu;
+
+	list = pcm->stream == SND_PCM_STREAM_PLAYBACK ? &ladspa->pplugins : &ladspa->cplugins;
+	list_for_each(pos, list) {
+		snd_pcm_ladspa_plugin_t *plugin = list_entry(pos, snd_pcm_ladspa_plugin_t, list);
+		list_for_each(pos1, &plugin->instances)
+			count++;
+	}
+	if (count < 2)
+		return;
+	instances = malloc(count * sizeof(*instances));
+	edges = calloc(count * count, 1);
+	level = calloc(count, sizeof(*level));
+	if (!instances || !edges || !level)
+		goto __error;
+	i = 0;
+	list_for_each(pos, list) {
+		snd_pcm_ladspa_plugin_t *plugin = list_entry(pos, snd_pcm_ladspa_plugin_t, list);
+		list_for_each(pos1, &plugin->instances)
+			instances[i++] = list_entry(pos1, snd_pcm_ladspa_instance_t, list);
+	}
+	/* direct edges between all conflicting pairs; the per-task
+	 * countdown makes transitive duplicates harmless
+	 */
+	for (i = 0; i < count; i++)
+		for (j = i + 1; j < count; j++)
+			if (snd_pcm_ladspa_instances_conflict(instances[i], instances[j]))
+				edges[i * count + j] = 1;
+	/* the widest level bounds the useful thread count */
+	for (j = 0; j < count; j++)
+		for (i = 0; i < j; i++)
+			if (edges[i * count + j] && level[i] + 1 > level[j])
+				level[j] = level[i] + 1;
+	for (i = 0; i < count; i++) {
+		unsigned int n = 0;
+		for (j = 0; j < count; j++)
+			if (level[j] == level[i])
+				n++;
+		if (n > width)
+			width = n;
+	}
+	ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	if (ncpu > 0 && (long)width > ncpu)
+		width = ncpu;
+	if (width < 2)
+		goto __error;
+	sched = calloc(1, sizeof(*sched));
+	if (sched == NULL)
+		goto __error;
+	sched->count = count;
+	sched->tasks = calloc(count, sizeof(*sched->tasks));
+	sched->ready = calloc(count, sizeof(*sched->ready));
+	sched->nthreads = width - 1;
+	sched->threads = calloc(sched->nthreads, sizeof(*sched->threads));
+	if (!sched->tasks || !sched->ready || !sched->threads)
+		goto __error_sched;
+	for (i = 0; i < count; i++) {
+		snd_pcm_ladspa_task_t *task = &sched->tasks[i];
+		task->instance = instances[i];
+		for (j = 0; j < i; j++)
+			if (edges[j * count + i])
+				task->ndeps++;
+		for (j = i + 1; j < count; j++)
+			if (edges[i * count + j])
+				task->nsucc++;
+		if (task->nsucc) {
+			unsigned int n = 0;
+			task->succ = malloc(task->nsucc * sizeof(*task->succ));
+			if (task->succ == NULL)
+				goto __error_sched;
+			for (j = i + 1; j < count; j++)
+				if (edges[i * count + j])
+					task->succ[n++] = j;
+		}
+	}
+	pthread_mutex_init(&sched->lock, NULL);
+	pthread_cond_init(&sched->work, NULL);
+	pthread_cond_init(&sched->done, NULL);
+	for (i = 0; i < sched->nthreads; i++) {
+		if (pthread_create(&sched->threads[i], NULL,
+				   snd_pcm_ladspa_sched_thread, sched)) {
+			sched->nthreads = i;
+			ladspa->sched = sched;
+			snd_pcm_ladspa_free_sched(ladspa);
+			goto __error;
+		}
+	}
+	ladspa->sched = sched;
+	goto __error;	/* free the temporary arrays only */
+
+       __error_sched:
+	for (i = 0; i < count; i++)
+		free(sched->tasks ? sched->tasks[i].succ : NULL);
+	free(sched->tasks);
+	free(sched->ready);
+	free(sched->threads);
+	free(sched);
+       __error:
+	free(instances);
+	free(edges);
+	free(level);
+}
+
+#endif /* HAVE_LIBPTHREAD */
+
 static snd_pcm_uframes_t
 snd_pcm_ladspa_write_areas(snd_pcm_t *pcm,
 			   const snd_pcm_channel_area_t *areas,
@@ -874,6 +1207,17 @@ snd_pcm_ladspa_write_areas(snd_pcm_t *pcm,
                 size1 = size;
                 if (size1 > ladspa->allocated)
                         size1 = ladspa->allocated;
+#ifdef HAVE_LIBPTHREAD
+		if (ladspa->sched) {
+			snd_pcm_ladspa_sched_run(ladspa->sched, areas, offset,
+						 slave_areas, slave_offset,
+						 size1, 0);
+			offset += size1;
+			slave_offset += size1;
+			size -= size1;
+			continue;
+		}
+#endif
         	list_for_each(pos, &ladspa->pplugins) {
         		snd_pcm_ladspa_plugin_t *plugin = list_entry(pos, snd_pcm_ladspa_plugin_t, list);
         		list_for_each(pos1, &plugin->instances) {
@@ -935,6 +1279,17 @@ snd_pcm_ladspa_read_areas(snd_pcm_t *pcm,
                 size1 = size;
                 if (size1 > ladspa->allocated)
                         size1 = ladspa->allocated;
+#ifdef HAVE_LIBPTHREAD
+		if (ladspa->sched) {
+			snd_pcm_ladspa_sched_run(ladspa->sched, areas, offset,
+						 slave_areas, slave_offset,
+						 size1, 1);
+			offset += size1;
+			slave_offset += size1;
+			size -= size1;
+			continue;
+		}
+#endif
         	list_for_each(pos, &ladspa->cplugins) {
         		snd_pcm_ladspa_plugin_t *plugin = list_entry(pos, snd_pcm_ladspa_plugin_t, list);
         		list_for_each(pos1, &plugin->instances) {
@@ -1640,6 +1995,7 @@ int snd_pcm_ladspa_open(snd_pcm_t **pcmp, const char *name,
 	pcm->fast_ops = &snd_pcm_plugin_fast_ops;
 	pcm->private_data = ladspa;
 	pcm->poll_fd = slave->poll_fd;
+	pcm->poll_dynamic = slave->poll_dynamic;
 	pcm->poll_events = slave->poll_events;
 	pcm->tstamp_type = slave->tstamp_type;
 	snd_pcm_set_hw_ptr(pcm, &ladspa->plug.hw_ptr, -1, 0);
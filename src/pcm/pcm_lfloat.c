@@ -31,6 +31,14 @@
 #include "plugin_ops.h"
 #include "bswap.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define LFLOAT_CONVERT_SIMD
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define LFLOAT_CONVERT_SIMD
+#endif
+
 #ifndef DOC_HIDDEN
 
 typedef float float_t;
@@ -92,6 +100,383 @@ int snd_pcm_lfloat_put_s32_index(snd_pcm_format_t format)
 
 #ifndef DOC_HIDDEN
 
+#ifdef LFLOAT_CONVERT_SIMD
+
+/*
+ * Batch kernels for the native endian integer<->float conversions.  The
+ * label threaded loop widens every sample to S32 and moves it through a
+ * union one at a time, which the compiler cannot vectorize because of
+ * the computed goto; the cases below map onto the hardware int<->float
+ * vector conversions with the 1/2^31 scale folded in.  Only dense
+ * interleaved areas with S16/S32 on the integer side and host endian
+ * FLOAT/FLOAT64 on the float side are handled; everything else keeps
+ * the generic loop.
+ */
+static int snd_pcm_lfloat_areas_dense(const snd_pcm_channel_area_t *dst_areas,
+				      snd_pcm_uframes_t dst_offset,
+				      const snd_pcm_channel_area_t *src_areas,
+				      snd_pcm_uframes_t src_offset,
+				      unsigned int channels,
+				      unsigned int src_width,
+				      unsigned int dst_width,
+				      const char **srcp, char **dstp)
+{
+	const char *src;
+	char *dst;
+	unsigned int ch;
+
+	src = snd_pcm_channel_area_addr(&src_areas[0], src_offset);
+	dst = snd_pcm_channel_area_addr(&dst_areas[0], dst_offset);
+	if (src_areas[0].step != channels * src_width * 8 ||
+	    dst_areas[0].step != channels * dst_width * 8)
+		return 0;
+	for (ch = 1; ch < channels; ++ch) {
+		if (src_areas[ch].step != src_areas[0].step ||
+		    dst_areas[ch].step != dst_areas[0].step ||
+		    (const char *)snd_pcm_channel_area_addr(&src_areas[ch], src_offset) != src + ch * src_width ||
+		    (char *)snd_pcm_channel_area_addr(&dst_areas[ch], dst_offset) != dst + ch * dst_width)
+			return 0;
+	}
+	*srcp = src;
+	*dstp = dst;
+	return 1;
+}
+
+static int snd_pcm_lfloat_simd_int_float(const snd_pcm_channel_area_t *dst_areas,
+					 snd_pcm_uframes_t dst_offset,
+					 const snd_pcm_channel_area_t *src_areas,
+					 snd_pcm_uframes_t src_offset,
+					 unsigned int channels,
+					 snd_pcm_uframes_t frames,
+					 unsigned int get32idx,
+					 unsigned int put32floatidx)
+{
+	static int get_s16 = -1, get_s32, put_f32, put_f64;
+	unsigned int src_width, dst_width;
+	const char *src;
+	char *dst;
+	size_t total, i;
+
+	if (get_s16 < 0) {
+		get_s16 = snd_pcm_linear_get_index(SND_PCM_FORMAT_S16, SND_PCM_FORMAT_S32);
+		get_s32 = snd_pcm_linear_get_index(SND_PCM_FORMAT_S32, SND_PCM_FORMAT_S32);
+		put_f32 = snd_pcm_lfloat_put_s32_index(SND_PCM_FORMAT_FLOAT);
+		put_f64 = snd_pcm_lfloat_put_s32_index(SND_PCM_FORMAT_FLOAT64);
+	}
+	if ((int)get32idx == get_s16)
+		src_width = 2;
+	else if ((int)get32idx == get_s32)
+		src_width = 4;
+	else
+		return 0;
+	if ((int)put32floatidx == put_f32)
+		dst_width = 4;
+	else if ((int)put32floatidx == put_f64)
+		dst_width = 8;
+	else
+		return 0;
+	if (!snd_pcm_lfloat_areas_dense(dst_areas, dst_offset,
+					src_areas, src_offset, channels,
+					src_width, dst_width, &src, &dst))
+		return 0;
+	total = (size_t)frames * channels;
+	i = 0;
+	if (src_width == 2 && dst_width == 4) {
+		const short *s = (const short *)src;
+		float *d = (float *)dst;
+
+#if defined(__SSE2__)
+		{
+			__m128i zero = _mm_setzero_si128();
+			__m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+
+			for (; i + 8 <= total; i += 8) {
+				__m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+
+				/* interleaving below the halves left justifies */
+				_mm_storeu_ps(d + i,
+					      _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(zero, v)), scale));
+				_mm_storeu_ps(d + i + 4,
+					      _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(zero, v)), scale));
+			}
+		}
+#else /* __aarch64__ */
+		for (; i + 8 <= total; i += 8) {
+			int16x8_t v = vld1q_s16(s + i);
+
+			vst1q_f32(d + i, vcvtq_n_f32_s32(vshll_n_s16(vget_low_s16(v), 16), 31));
+			vst1q_f32(d + i + 4, vcvtq_n_f32_s32(vshll_n_s16(vget_high_s16(v), 16), 31));
+		}
+#endif
+		for (; i < total; ++i)
+			d[i] = (float_t)((int32_t)s[i] << 16) / (float_t)0x80000000UL;
+	} else if (src_width == 2 && dst_width == 8) {
+		const short *s = (const short *)src;
+		double *d = (double *)dst;
+
+#if defined(__SSE2__)
+		{
+			__m128i zero = _mm_setzero_si128();
+			__m128d scale = _mm_set1_pd(1.0 / 2147483648.0);
+
+			for (; i + 4 <= total; i += 4) {
+				__m128i v = _mm_unpacklo_epi16(zero,
+					_mm_loadl_epi64((const __m128i *)(s + i)));
+
+				_mm_storeu_pd(d + i,
+					      _mm_mul_pd(_mm_cvtepi32_pd(v), scale));
+				_mm_storeu_pd(d + i + 2,
+					      _mm_mul_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(v, v)), scale));
+			}
+		}
+#else /* __aarch64__ */
+		for (; i + 4 <= total; i += 4) {
+			int32x4_t v = vshll_n_s16(vld1_s16(s + i), 16);
+
+			vst1q_f64(d + i, vcvtq_n_f64_s64(vmovl_s32(vget_low_s32(v)), 31));
+			vst1q_f64(d + i + 2, vcvtq_n_f64_s64(vmovl_s32(vget_high_s32(v)), 31));
+		}
+#endif
+		for (; i < total; ++i)
+			d[i] = (double_t)((int32_t)s[i] << 16) / (double_t)0x80000000UL;
+	} else if (src_width == 4 && dst_width == 4) {
+		const int32_t *s = (const int32_t *)src;
+		float *d = (float *)dst;
+
+#if defined(__SSE2__)
+		{
+			__m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+
+			for (; i + 4 <= total; i += 4)
+				_mm_storeu_ps(d + i,
+					      _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(s + i))), scale));
+		}
+#else /* __aarch64__ */
+		for (; i + 4 <= total; i += 4)
+			vst1q_f32(d + i, vcvtq_n_f32_s32(vld1q_s32(s + i), 31));
+#endif
+		for (; i < total; ++i)
+			d[i] = (float_t)s[i] / (float_t)0x80000000UL;
+	} else {
+		const int32_t *s = (const int32_t *)src;
+		double *d = (double *)dst;
+
+#if defined(__SSE2__)
+		{
+			__m128d scale = _mm_set1_pd(1.0 / 2147483648.0);
+
+			for (; i + 4 <= total; i += 4) {
+				__m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+
+				_mm_storeu_pd(d + i,
+					      _mm_mul_pd(_mm_cvtepi32_pd(v), scale));
+				_mm_storeu_pd(d + i + 2,
+					      _mm_mul_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(v, v)), scale));
+			}
+		}
+#else /* __aarch64__ */
+		for (; i + 4 <= total; i += 4) {
+			int32x4_t v = vld1q_s32(s + i);
+
+			vst1q_f64(d + i, vcvtq_n_f64_s64(vmovl_s32(vget_low_s32(v)), 31));
+			vst1q_f64(d + i + 2, vcvtq_n_f64_s64(vmovl_s32(vget_high_s32(v)), 31));
+		}
+#endif
+		for (; i < total; ++i)
+			d[i] = (double_t)s[i] / (double_t)0x80000000UL;
+	}
+	return 1;
+}
+
+static inline int32_t lfloat_float_to_s32(float f)
+{
+	if (f >= 1.0)
+		return 0x7fffffff;
+	if (f <= -1.0)
+		return -0x7fffffff - 1;
+	return (int32_t)(f * (float_t)0x80000000UL);
+}
+
+static inline int32_t lfloat_double_to_s32(double d)
+{
+	if (d >= 1.0)
+		return 0x7fffffff;
+	if (d <= -1.0)
+		return -0x7fffffff - 1;
+	return (int32_t)(d * (double_t)0x80000000UL);
+}
+
+static int snd_pcm_lfloat_simd_float_int(const snd_pcm_channel_area_t *dst_areas,
+					 snd_pcm_uframes_t dst_offset,
+					 const snd_pcm_channel_area_t *src_areas,
+					 snd_pcm_uframes_t src_offset,
+					 unsigned int channels,
+					 snd_pcm_uframes_t frames,
+					 unsigned int put32idx,
+					 unsigned int get32floatidx)
+{
+	static int put_s16 = -1, put_s32, get_f32, get_f64;
+	unsigned int src_width, dst_width;
+	const char *src;
+	char *dst;
+	size_t total, i;
+
+	if (put_s16 < 0) {
+		put_s16 = snd_pcm_linear_put_index(SND_PCM_FORMAT_S32, SND_PCM_FORMAT_S16);
+		put_s32 = snd_pcm_linear_put_index(SND_PCM_FORMAT_S32, SND_PCM_FORMAT_S32);
+		get_f32 = snd_pcm_lfloat_get_s32_index(SND_PCM_FORMAT_FLOAT);
+		get_f64 = snd_pcm_lfloat_get_s32_index(SND_PCM_FORMAT_FLOAT64);
+	}
+	if ((int)get32floatidx == get_f32)
+		src_width = 4;
+	else if ((int)get32floatidx == get_f64)
+		src_width = 8;
+	else
+		return 0;
+	if ((int)put32idx == put_s16)
+		dst_width = 2;
+	else if ((int)put32idx == put_s32)
+		dst_width = 4;
+	else
+		return 0;
+	if (!snd_pcm_lfloat_areas_dense(dst_areas, dst_offset,
+					src_areas, src_offset, channels,
+					src_width, dst_width, &src, &dst))
+		return 0;
+	total = (size_t)frames * channels;
+	i = 0;
+	/* the generic loop clamps to the full S32 range and truncates
+	 * toward zero; the cvtt/saturating conversions below do the same,
+	 * on SSE2 with the overflown positives (which the conversion
+	 * yields as INT32_MIN) flipped to INT32_MAX by the xor
+	 */
+	if (src_width == 4 && dst_width == 4) {
+		const float *s = (const float *)src;
+		int32_t *d = (int32_t *)dst;
+
+#if defined(__SSE2__)
+		{
+			__m128 scale = _mm_set1_ps(2147483648.0f);
+			__m128 one = _mm_set1_ps(1.0f);
+
+			for (; i + 4 <= total; i += 4) {
+				__m128 v = _mm_loadu_ps(s + i);
+				__m128i r = _mm_cvttps_epi32(_mm_mul_ps(v, scale));
+
+				r = _mm_xor_si128(r, _mm_castps_si128(_mm_cmpge_ps(v, one)));
+				_mm_storeu_si128((__m128i *)(d + i), r);
+			}
+		}
+#else /* __aarch64__ */
+		for (; i + 4 <= total; i += 4)
+			vst1q_s32(d + i, vcvtq_n_s32_f32(vld1q_f32(s + i), 31));
+#endif
+		for (; i < total; ++i)
+			d[i] = lfloat_float_to_s32(s[i]);
+	} else if (src_width == 4 && dst_width == 2) {
+		const float *s = (const float *)src;
+		int16_t *d = (int16_t *)dst;
+
+#if defined(__SSE2__)
+		{
+			__m128 scale = _mm_set1_ps(2147483648.0f);
+			__m128 one = _mm_set1_ps(1.0f);
+
+			for (; i + 8 <= total; i += 8) {
+				__m128 v0 = _mm_loadu_ps(s + i);
+				__m128 v1 = _mm_loadu_ps(s + i + 4);
+				__m128i r0 = _mm_cvttps_epi32(_mm_mul_ps(v0, scale));
+				__m128i r1 = _mm_cvttps_epi32(_mm_mul_ps(v1, scale));
+
+				r0 = _mm_xor_si128(r0, _mm_castps_si128(_mm_cmpge_ps(v0, one)));
+				r1 = _mm_xor_si128(r1, _mm_castps_si128(_mm_cmpge_ps(v1, one)));
+				_mm_storeu_si128((__m128i *)(d + i),
+						 _mm_packs_epi32(_mm_srai_epi32(r0, 16),
+								 _mm_srai_epi32(r1, 16)));
+			}
+		}
+#else /* __aarch64__ */
+		for (; i + 8 <= total; i += 8) {
+			int32x4_t r0 = vshrq_n_s32(vcvtq_n_s32_f32(vld1q_f32(s + i), 31), 16);
+			int32x4_t r1 = vshrq_n_s32(vcvtq_n_s32_f32(vld1q_f32(s + i + 4), 31), 16);
+
+			vst1q_s16(d + i, vcombine_s16(vmovn_s32(r0), vmovn_s32(r1)));
+		}
+#endif
+		for (; i < total; ++i)
+			d[i] = lfloat_float_to_s32(s[i]) >> 16;
+	} else if (src_width == 8 && dst_width == 4) {
+		const double *s = (const double *)src;
+		int32_t *d = (int32_t *)dst;
+
+#if defined(__SSE2__)
+		{
+			__m128d scale = _mm_set1_pd(2147483648.0);
+			__m128d one = _mm_set1_pd(1.0);
+
+			for (; i + 4 <= total; i += 4) {
+				__m128d v0 = _mm_loadu_pd(s + i);
+				__m128d v1 = _mm_loadu_pd(s + i + 2);
+				__m128i r = _mm_unpacklo_epi64(_mm_cvttpd_epi32(_mm_mul_pd(v0, scale)),
+							       _mm_cvttpd_epi32(_mm_mul_pd(v1, scale)));
+				__m128i fix = _mm_castps_si128(_mm_shuffle_ps(_mm_castpd_ps(_mm_cmpge_pd(v0, one)),
+									      _mm_castpd_ps(_mm_cmpge_pd(v1, one)),
+									      _MM_SHUFFLE(2, 0, 2, 0)));
+
+				_mm_storeu_si128((__m128i *)(d + i), _mm_xor_si128(r, fix));
+			}
+		}
+#else /* __aarch64__ */
+		for (; i + 4 <= total; i += 4) {
+			int64x2_t r0 = vcvtq_n_s64_f64(vld1q_f64(s + i), 31);
+			int64x2_t r1 = vcvtq_n_s64_f64(vld1q_f64(s + i + 2), 31);
+
+			vst1q_s32(d + i, vcombine_s32(vqmovn_s64(r0), vqmovn_s64(r1)));
+		}
+#endif
+		for (; i < total; ++i)
+			d[i] = lfloat_double_to_s32(s[i]);
+	} else {
+		const double *s = (const double *)src;
+		int16_t *d = (int16_t *)dst;
+
+#if defined(__SSE2__)
+		{
+			__m128d scale = _mm_set1_pd(2147483648.0);
+			__m128d one = _mm_set1_pd(1.0);
+
+			for (; i + 4 <= total; i += 4) {
+				__m128d v0 = _mm_loadu_pd(s + i);
+				__m128d v1 = _mm_loadu_pd(s + i + 2);
+				__m128i r = _mm_unpacklo_epi64(_mm_cvttpd_epi32(_mm_mul_pd(v0, scale)),
+							       _mm_cvttpd_epi32(_mm_mul_pd(v1, scale)));
+				__m128i fix = _mm_castps_si128(_mm_shuffle_ps(_mm_castpd_ps(_mm_cmpge_pd(v0, one)),
+									      _mm_castpd_ps(_mm_cmpge_pd(v1, one)),
+									      _MM_SHUFFLE(2, 0, 2, 0)));
+
+				r = _mm_srai_epi32(_mm_xor_si128(r, fix), 16);
+				_mm_storel_epi64((__m128i *)(d + i),
+						 _mm_packs_epi32(r, r));
+			}
+		}
+#else /* __aarch64__ */
+		for (; i + 4 <= total; i += 4) {
+			int64x2_t r0 = vcvtq_n_s64_f64(vld1q_f64(s + i), 31);
+			int64x2_t r1 = vcvtq_n_s64_f64(vld1q_f64(s + i + 2), 31);
+			int32x4_t r = vshrq_n_s32(vcombine_s32(vqmovn_s64(r0),
+							       vqmovn_s64(r1)), 16);
+
+			vst1_s16(d + i, vmovn_s32(r));
+		}
+#endif
+		for (; i < total; ++i)
+			d[i] = lfloat_double_to_s32(s[i]) >> 16;
+	}
+	return 1;
+}
+
+#endif /* LFLOAT_CONVERT_SIMD */
+
 void snd_pcm_lfloat_convert_integer_float(const snd_pcm_channel_area_t *dst_areas, snd_pcm_uframes_t dst_offset,
 					  const snd_pcm_channel_area_t *src_areas, snd_pcm_uframes_t src_offset,
 					  unsigned int channels, snd_pcm_uframes_t frames,
@@ -105,6 +490,13 @@ void snd_pcm_lfloat_convert_integer_float(const snd_pcm_channel_area_t *dst_area
 	void *get32 = get32_labels[get32idx];
 	void *put32float = put32float_labels[put32floatidx];
 	unsigned int channel;
+#ifdef LFLOAT_CONVERT_SIMD
+	if (snd_pcm_lfloat_simd_int_float(dst_areas, dst_offset,
+					  src_areas, src_offset,
+					  channels, frames,
+					  get32idx, put32floatidx))
+		return;
+#endif
 	for (channel = 0; channel < channels; ++channel) {
 		const char *src;
 		char *dst;
@@ -150,6 +542,13 @@ void snd_pcm_lfloat_convert_float_integer(const snd_pcm_channel_area_t *dst_area
 	void *put32 = put32_labels[put32idx];
 	void *get32float = get32float_labels[get32floatidx];
 	unsigned int channel;
+#ifdef LFLOAT_CONVERT_SIMD
+	if (snd_pcm_lfloat_simd_float_int(dst_areas, dst_offset,
+					  src_areas, src_offset,
+					  channels, frames,
+					  put32idx, get32floatidx))
+		return;
+#endif
 	for (channel = 0; channel < channels; ++channel) {
 		const char *src;
 		char *dst;
@@ -388,10 +787,11 @@ int snd_pcm_lfloat_open(snd_pcm_t **pcmp, const char *name, snd_pcm_format_t sfo
 	if (snd_pcm_format_linear(sformat) != 1 &&
 	    snd_pcm_format_float(sformat) != 1)
 		return -EINVAL;
-	lfloat = calloc(1, sizeof(snd_pcm_lfloat_t));
-	if (!lfloat) {
-		return -ENOMEM;
-	}
+	err = snd_pcm_new_priv(&pcm, SND_PCM_TYPE_LINEAR_FLOAT, name,
+			       slave->stream, slave->mode,
+			       sizeof(snd_pcm_lfloat_t), (void **)&lfloat);
+	if (err < 0)
+		return err;
 	snd_pcm_plugin_init(&lfloat->plug);
 	lfloat->sformat = sformat;
 	lfloat->plug.read = snd_pcm_lfloat_read_areas;
@@ -401,15 +801,11 @@ int snd_pcm_lfloat_open(snd_pcm_t **pcmp, const char *name, snd_pcm_format_t sfo
 	lfloat->plug.gen.slave = slave;
 	lfloat->plug.gen.close_slave = close_slave;
 
-	err = snd_pcm_new(&pcm, SND_PCM_TYPE_LINEAR_FLOAT, name, slave->stream, slave->mode);
-	if (err < 0) {
-		free(lfloat);
-		return err;
-	}
 	pcm->ops = &snd_pcm_lfloat_ops;
 	pcm->fast_ops = &snd_pcm_plugin_fast_ops;
 	pcm->private_data = lfloat;
 	pcm->poll_fd = slave->poll_fd;
+	pcm->poll_dynamic = slave->poll_dynamic;
 	pcm->poll_events = slave->poll_events;
 	pcm->tstamp_type = slave->tstamp_type;
 	snd_pcm_set_hw_ptr(pcm, &lfloat->plug.hw_ptr, -1, 0);
@@ -31,6 +31,17 @@
 #include "plugin_ops.h"
 #include "bswap.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+#define LINEAR_CONVERT_SIMD
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define LINEAR_CONVERT_SIMD
+#endif
+
 #ifndef PIC
 /* entry for static linking */
 const char *_snd_module_pcm_linear = "";
@@ -143,6 +154,353 @@ int snd_pcm_linear_put_index(snd_pcm_format_t src_format, snd_pcm_format_t dst_f
 	}
 }
 
+#ifdef LINEAR_CONVERT_SIMD
+
+/*
+ * Batch kernels for the conversions which dominate plug chains: the
+ * native S16<->S32 widen/narrow and the 16/32 bit endian swaps.  The
+ * label threaded loop below cannot be vectorized by the compiler
+ * because of the computed goto, while these cases map 1:1 onto vector
+ * shifts and byte shuffles.  Only dense interleaved areas are handled;
+ * everything else keeps the generic loop.
+ */
+static int snd_pcm_linear_convert_simd(const snd_pcm_channel_area_t *dst_areas,
+				       snd_pcm_uframes_t dst_offset,
+				       const snd_pcm_channel_area_t *src_areas,
+				       snd_pcm_uframes_t src_offset,
+				       unsigned int channels,
+				       snd_pcm_uframes_t frames,
+				       unsigned int convidx)
+{
+	static int idx_16_32 = -1, idx_32_16 = -1;
+	static int idx_swap16a = -1, idx_swap16b = -1;
+	static int idx_swap32a = -1, idx_swap32b = -1;
+	unsigned int src_width, dst_width, ch;
+	const char *src;
+	char *dst;
+	size_t total, i;
+
+	if (idx_16_32 < 0) {
+		idx_16_32 = snd_pcm_linear_convert_index(SND_PCM_FORMAT_S16, SND_PCM_FORMAT_S32);
+		idx_32_16 = snd_pcm_linear_convert_index(SND_PCM_FORMAT_S32, SND_PCM_FORMAT_S16);
+		idx_swap16a = snd_pcm_linear_convert_index(SND_PCM_FORMAT_S16_LE, SND_PCM_FORMAT_S16_BE);
+		idx_swap16b = snd_pcm_linear_convert_index(SND_PCM_FORMAT_S16_BE, SND_PCM_FORMAT_S16_LE);
+		idx_swap32a = snd_pcm_linear_convert_index(SND_PCM_FORMAT_S32_LE, SND_PCM_FORMAT_S32_BE);
+		idx_swap32b = snd_pcm_linear_convert_index(SND_PCM_FORMAT_S32_BE, SND_PCM_FORMAT_S32_LE);
+	}
+	if ((int)convidx == idx_16_32) {
+		src_width = 2;
+		dst_width = 4;
+	} else if ((int)convidx == idx_32_16) {
+		src_width = 4;
+		dst_width = 2;
+	} else if ((int)convidx == idx_swap16a || (int)convidx == idx_swap16b) {
+		src_width = dst_width = 2;
+	} else if ((int)convidx == idx_swap32a || (int)convidx == idx_swap32b) {
+		src_width = dst_width = 4;
+	} else {
+		return 0;
+	}
+	src = snd_pcm_channel_area_addr(&src_areas[0], src_offset);
+	dst = snd_pcm_channel_area_addr(&dst_areas[0], dst_offset);
+	if (src_areas[0].step != channels * src_width * 8 ||
+	    dst_areas[0].step != channels * dst_width * 8)
+		return 0;
+	for (ch = 1; ch < channels; ++ch) {
+		if (src_areas[ch].step != src_areas[0].step ||
+		    dst_areas[ch].step != dst_areas[0].step ||
+		    (const char *)snd_pcm_channel_area_addr(&src_areas[ch], src_offset) != src + ch * src_width ||
+		    (char *)snd_pcm_channel_area_addr(&dst_areas[ch], dst_offset) != dst + ch * dst_width)
+			return 0;
+	}
+	total = (size_t)frames * channels;
+	i = 0;
+	if ((int)convidx == idx_16_32) {
+		const short *s = (const short *)src;
+		int *d = (int *)dst;
+
+#if defined(__SSE2__)
+		{
+			__m128i zero = _mm_setzero_si128();
+
+			for (; i + 8 <= total; i += 8) {
+				__m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+
+				/* interleaving below the halves left justifies */
+				_mm_storeu_si128((__m128i *)(d + i),
+						 _mm_unpacklo_epi16(zero, v));
+				_mm_storeu_si128((__m128i *)(d + i + 4),
+						 _mm_unpackhi_epi16(zero, v));
+			}
+		}
+#else /* __aarch64__ */
+		for (; i + 8 <= total; i += 8) {
+			int16x8_t v = vld1q_s16(s + i);
+
+			vst1q_s32(d + i, vshll_n_s16(vget_low_s16(v), 16));
+			vst1q_s32(d + i + 4, vshll_n_s16(vget_high_s16(v), 16));
+		}
+#endif
+		for (; i < total; ++i)
+			d[i] = (int)s[i] << 16;
+	} else if ((int)convidx == idx_32_16) {
+		const int *s = (const int *)src;
+		short *d = (short *)dst;
+
+#if defined(__SSE2__)
+		for (; i + 8 <= total; i += 8) {
+			__m128i v0 = _mm_loadu_si128((const __m128i *)(s + i));
+			__m128i v1 = _mm_loadu_si128((const __m128i *)(s + i + 4));
+
+			/* values fit after the shift, the saturation is moot */
+			_mm_storeu_si128((__m128i *)(d + i),
+					 _mm_packs_epi32(_mm_srai_epi32(v0, 16),
+							 _mm_srai_epi32(v1, 16)));
+		}
+#else /* __aarch64__ */
+		for (; i + 8 <= total; i += 8) {
+			int32x4_t v0 = vld1q_s32(s + i);
+			int32x4_t v1 = vld1q_s32(s + i + 4);
+
+			vst1q_s16(d + i, vcombine_s16(vshrn_n_s32(v0, 16),
+						      vshrn_n_s32(v1, 16)));
+		}
+#endif
+		for (; i < total; ++i)
+			d[i] = s[i] >> 16;
+	} else if (src_width == 2) {
+		const uint16_t *s = (const uint16_t *)src;
+		uint16_t *d = (uint16_t *)dst;
+
+#if defined(__SSE2__)
+		for (; i + 8 <= total; i += 8) {
+			__m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+
+			v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+			_mm_storeu_si128((__m128i *)(d + i), v);
+		}
+#else /* __aarch64__ */
+		for (; i + 8 <= total; i += 8)
+			vst1q_u16(d + i, vreinterpretq_u16_u8(
+					 vrev16q_u8(vreinterpretq_u8_u16(vld1q_u16(s + i)))));
+#endif
+		for (; i < total; ++i)
+			d[i] = bswap_16(s[i]);
+	} else {
+		const uint32_t *s = (const uint32_t *)src;
+		uint32_t *d = (uint32_t *)dst;
+
+#if defined(__SSE2__)
+		for (; i + 4 <= total; i += 4) {
+			__m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+
+			v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+			v = _mm_or_si128(_mm_slli_epi32(v, 16), _mm_srli_epi32(v, 16));
+			_mm_storeu_si128((__m128i *)(d + i), v);
+		}
+#else /* __aarch64__ */
+		for (; i + 4 <= total; i += 4)
+			vst1q_u32(d + i, vreinterpretq_u32_u8(
+					 vrev32q_u8(vreinterpretq_u8_u32(vld1q_u32(s + i)))));
+#endif
+		for (; i < total; ++i)
+			d[i] = bswap_32(s[i]);
+	}
+	return 1;
+}
+
+/*
+ * Batch kernels for the packed 24bit formats, which otherwise take the
+ * get/put detour widening every sample to 32bit through byte loads.
+ * The conversions against the native 16/32bit formats are plain byte
+ * shuffles, so dense interleaved areas are rewritten in one pass over
+ * the whole block (pshufb/NEON interleaved loads where available, a
+ * tight scalar loop otherwise); everything else keeps the label
+ * threaded loop.  Only the signed/no-toggle combinations are handled,
+ * the byte moves do not depend on the sign bit anyway.
+ */
+static inline uint32_t linear_get_triple_le(const char *p)
+{
+	return (uint8_t)p[0] | (uint32_t)(uint8_t)p[1] << 8 |
+	       (uint32_t)(uint8_t)p[2] << 16;
+}
+
+static inline void linear_put_triple_le(char *p, uint32_t val)
+{
+	p[0] = val;
+	p[1] = val >> 8;
+	p[2] = val >> 16;
+}
+
+static int snd_pcm_linear_getput_simd(const snd_pcm_channel_area_t *dst_areas,
+				      snd_pcm_uframes_t dst_offset,
+				      const snd_pcm_channel_area_t *src_areas,
+				      snd_pcm_uframes_t src_offset,
+				      unsigned int channels,
+				      snd_pcm_uframes_t frames,
+				      unsigned int get_idx, unsigned int put_idx)
+{
+	enum { P24_TO_32, P32_TO_24, P24_TO_16, P16_TO_24, P_OPS };
+	static const snd_pcm_format_t fmts[P_OPS][2] = {
+		{ SND_PCM_FORMAT_S24_3LE, SND_PCM_FORMAT_S32 },
+		{ SND_PCM_FORMAT_S32, SND_PCM_FORMAT_S24_3LE },
+		{ SND_PCM_FORMAT_S24_3LE, SND_PCM_FORMAT_S16 },
+		{ SND_PCM_FORMAT_S16, SND_PCM_FORMAT_S24_3LE },
+	};
+	static const unsigned int widths[P_OPS][2] = {
+		{ 3, 4 }, { 4, 3 }, { 3, 2 }, { 2, 3 },
+	};
+	static int gets[P_OPS] = { -1, -1, -1, -1 };
+	static int puts[P_OPS];
+	unsigned int src_width, dst_width, ch, op;
+	const char *src;
+	char *dst;
+	size_t total, i;
+
+	if (gets[0] < 0) {
+		for (op = 0; op < P_OPS; op++) {
+			puts[op] = snd_pcm_linear_put_index(fmts[op][0], fmts[op][1]);
+			gets[op] = snd_pcm_linear_get_index(fmts[op][0], fmts[op][1]);
+		}
+	}
+	for (op = 0; op < P_OPS; op++)
+		if ((int)get_idx == gets[op] && (int)put_idx == puts[op])
+			break;
+	if (op >= P_OPS)
+		return 0;
+	src_width = widths[op][0];
+	dst_width = widths[op][1];
+	src = snd_pcm_channel_area_addr(&src_areas[0], src_offset);
+	dst = snd_pcm_channel_area_addr(&dst_areas[0], dst_offset);
+	if (src_areas[0].step != channels * src_width * 8 ||
+	    dst_areas[0].step != channels * dst_width * 8)
+		return 0;
+	for (ch = 1; ch < channels; ++ch) {
+		if (src_areas[ch].step != src_areas[0].step ||
+		    dst_areas[ch].step != dst_areas[0].step ||
+		    (const char *)snd_pcm_channel_area_addr(&src_areas[ch], src_offset) != src + ch * src_width ||
+		    (char *)snd_pcm_channel_area_addr(&dst_areas[ch], dst_offset) != dst + ch * dst_width)
+			return 0;
+	}
+	total = (size_t)frames * channels;
+	i = 0;
+	/* the vector loops stop a few samples short of the block end, so
+	 * that the full width loads and the padded stores never touch
+	 * memory outside the areas; the scalar tail finishes up
+	 */
+	switch (op) {
+	case P24_TO_32:
+#if defined(__SSE2__)
+#ifdef __SSSE3__
+	{
+		const __m128i mask = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5,
+						   -1, 6, 7, 8, -1, 9, 10, 11);
+
+		for (; i + 8 <= total; i += 4)
+			_mm_storeu_si128((__m128i *)(dst + i * 4),
+					 _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + i * 3)), mask));
+	}
+#endif
+#else /* __aarch64__ */
+		for (; i + 16 <= total; i += 16) {
+			uint8x16x3_t v = vld3q_u8((const uint8_t *)src + i * 3);
+			uint8x16x4_t w;
+
+			w.val[0] = vdupq_n_u8(0);
+			w.val[1] = v.val[0];
+			w.val[2] = v.val[1];
+			w.val[3] = v.val[2];
+			vst4q_u8((uint8_t *)dst + i * 4, w);
+		}
+#endif
+		for (; i < total; ++i)
+			*(uint32_t *)(dst + i * 4) = linear_get_triple_le(src + i * 3) << 8;
+		break;
+	case P32_TO_24:
+#if defined(__SSE2__)
+#ifdef __SSSE3__
+	{
+		const __m128i mask = _mm_setr_epi8(1, 2, 3, 5, 6, 7, 9, 10, 11,
+						   13, 14, 15, -1, -1, -1, -1);
+
+		/* the 4 pad bytes land inside the area and are rewritten
+		 * by the next iteration or the tail */
+		for (; i + 8 <= total; i += 4)
+			_mm_storeu_si128((__m128i *)(dst + i * 3),
+					 _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + i * 4)), mask));
+	}
+#endif
+#else /* __aarch64__ */
+		for (; i + 16 <= total; i += 16) {
+			uint8x16x4_t v = vld4q_u8((const uint8_t *)src + i * 4);
+			uint8x16x3_t w;
+
+			w.val[0] = v.val[1];
+			w.val[1] = v.val[2];
+			w.val[2] = v.val[3];
+			vst3q_u8((uint8_t *)dst + i * 3, w);
+		}
+#endif
+		for (; i < total; ++i)
+			linear_put_triple_le(dst + i * 3, *(const uint32_t *)(src + i * 4) >> 8);
+		break;
+	case P24_TO_16:
+#if defined(__SSE2__)
+#ifdef __SSSE3__
+	{
+		const __m128i mask = _mm_setr_epi8(1, 2, 4, 5, 7, 8, 10, 11,
+						   -1, -1, -1, -1, -1, -1, -1, -1);
+
+		for (; i + 8 <= total; i += 4)
+			_mm_storel_epi64((__m128i *)(dst + i * 2),
+					 _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + i * 3)), mask));
+	}
+#endif
+#else /* __aarch64__ */
+		for (; i + 16 <= total; i += 16) {
+			uint8x16x3_t v = vld3q_u8((const uint8_t *)src + i * 3);
+			uint8x16x2_t w;
+
+			w.val[0] = v.val[1];
+			w.val[1] = v.val[2];
+			vst2q_u8((uint8_t *)dst + i * 2, w);
+		}
+#endif
+		for (; i < total; ++i)
+			*(uint16_t *)(dst + i * 2) = linear_get_triple_le(src + i * 3) >> 8;
+		break;
+	case P16_TO_24:
+#if defined(__SSE2__)
+#ifdef __SSSE3__
+	{
+		const __m128i mask = _mm_setr_epi8(-1, 0, 1, -1, 2, 3, -1, 4,
+						   5, -1, 6, 7, -1, -1, -1, -1);
+
+		for (; i + 8 <= total; i += 4)
+			_mm_storeu_si128((__m128i *)(dst + i * 3),
+					 _mm_shuffle_epi8(_mm_loadl_epi64((const __m128i *)(src + i * 2)), mask));
+	}
+#endif
+#else /* __aarch64__ */
+		for (; i + 16 <= total; i += 16) {
+			uint8x16x2_t v = vld2q_u8((const uint8_t *)src + i * 2);
+			uint8x16x3_t w;
+
+			w.val[0] = vdupq_n_u8(0);
+			w.val[1] = v.val[0];
+			w.val[2] = v.val[1];
+			vst3q_u8((uint8_t *)dst + i * 3, w);
+		}
+#endif
+		for (; i < total; ++i)
+			linear_put_triple_le(dst + i * 3, (uint32_t)*(const uint16_t *)(src + i * 2) << 8);
+		break;
+	}
+	return 1;
+}
+
+#endif /* LINEAR_CONVERT_SIMD */
+
 void snd_pcm_linear_convert(const snd_pcm_channel_area_t *dst_areas, snd_pcm_uframes_t dst_offset,
 			    const snd_pcm_channel_area_t *src_areas, snd_pcm_uframes_t src_offset,
 			    unsigned int channels, snd_pcm_uframes_t frames,
@@ -153,6 +511,12 @@ void snd_pcm_linear_convert(const snd_pcm_channel_area_t *dst_areas, snd_pcm_ufr
 #undef CONV_LABELS
 	void *conv = conv_labels[convidx];
 	unsigned int channel;
+#ifdef LINEAR_CONVERT_SIMD
+	if (snd_pcm_linear_convert_simd(dst_areas, dst_offset,
+					src_areas, src_offset,
+					channels, frames, convidx))
+		return;
+#endif
 	for (channel = 0; channel < channels; ++channel) {
 		const char *src;
 		char *dst;
@@ -189,6 +553,12 @@ void snd_pcm_linear_getput(const snd_pcm_channel_area_t *dst_areas, snd_pcm_ufra
 	void *put = put32_labels[put_idx];
 	unsigned int channel;
 	uint32_t sample = 0;
+#ifdef LINEAR_CONVERT_SIMD
+	if (snd_pcm_linear_getput_simd(dst_areas, dst_offset,
+				       src_areas, src_offset,
+				       channels, frames, get_idx, put_idx))
+		return;
+#endif
 	for (channel = 0; channel < channels; ++channel) {
 		const char *src;
 		char *dst;
@@ -215,6 +585,106 @@ void snd_pcm_linear_getput(const snd_pcm_channel_area_t *dst_areas, snd_pcm_ufra
 
 #endif /* DOC_HIDDEN */
 
+/**
+ * \brief Convert samples between two PCM formats
+ * \param dst_areas destination areas specification (one for each channel)
+ * \param dst_offset offset in frames inside destination area
+ * \param dst_format destination PCM sample format
+ * \param src_areas source areas specification (one for each channel)
+ * \param src_offset offset in frames inside source area
+ * \param src_format source PCM sample format
+ * \param channels channels count
+ * \param frames frames to convert
+ * \return 0 on success otherwise a negative error code
+ *
+ * Converts between any two linear formats and between linear and float
+ * formats, using the same conversion kernels as the format conversion
+ * plugins.  Equal formats degrade to a plain copy.  The conversion may
+ * be done in place only when the physical widths of both formats match;
+ * otherwise the samples would be overwritten while still needed and
+ * -EINVAL is returned.  Formats outside the supported set (compressed,
+ * sub-byte resolution) also return -EINVAL.
+ */
+int snd_pcm_format_convert(const snd_pcm_channel_area_t *dst_areas,
+			   snd_pcm_uframes_t dst_offset,
+			   snd_pcm_format_t dst_format,
+			   const snd_pcm_channel_area_t *src_areas,
+			   snd_pcm_uframes_t src_offset,
+			   snd_pcm_format_t src_format,
+			   unsigned int channels, snd_pcm_uframes_t frames)
+{
+	int src_linear, dst_linear;
+
+	assert(dst_areas && src_areas);
+	if (!channels) {
+		SNDMSG("invalid channels %d", channels);
+		return -EINVAL;
+	}
+	if (!frames) {
+		SNDMSG("invalid frames %ld", frames);
+		return -EINVAL;
+	}
+	if (src_format == dst_format)
+		return snd_pcm_areas_copy(dst_areas, dst_offset,
+					  src_areas, src_offset,
+					  channels, frames, dst_format);
+	if (dst_areas->addr == src_areas->addr &&
+	    snd_pcm_format_physical_width(src_format) !=
+	    snd_pcm_format_physical_width(dst_format)) {
+		SNDMSG("in place conversion needs equal physical widths");
+		return -EINVAL;
+	}
+	src_linear = snd_pcm_format_linear(src_format);
+	dst_linear = snd_pcm_format_linear(dst_format);
+	if (src_linear && dst_linear) {
+		/* the same getput/convert split as the linear plugin
+		 * makes at hw_params */
+		if (snd_pcm_format_physical_width(src_format) == 24 ||
+		    snd_pcm_format_physical_width(dst_format) == 24 ||
+		    snd_pcm_format_width(src_format) == 20 ||
+		    snd_pcm_format_width(dst_format) == 20)
+			snd_pcm_linear_getput(dst_areas, dst_offset,
+					      src_areas, src_offset,
+					      channels, frames,
+					      snd_pcm_linear_get_index(src_format, SND_PCM_FORMAT_S32),
+					      snd_pcm_linear_put_index(SND_PCM_FORMAT_S32, dst_format));
+		else
+			snd_pcm_linear_convert(dst_areas, dst_offset,
+					       src_areas, src_offset,
+					       channels, frames,
+					       snd_pcm_linear_convert_index(src_format, dst_format));
+		return 0;
+	}
+#ifdef BUILD_PCM_PLUGIN_LFLOAT
+	if (src_linear && snd_pcm_format_float(dst_format) == 1) {
+		int put_idx = snd_pcm_lfloat_put_s32_index(dst_format);
+		if (put_idx < 0)
+			return put_idx;
+		snd_pcm_lfloat_convert_integer_float(dst_areas, dst_offset,
+						     src_areas, src_offset,
+						     channels, frames,
+						     snd_pcm_linear_get_index(src_format, SND_PCM_FORMAT_S32),
+						     put_idx);
+		return 0;
+	}
+	if (snd_pcm_format_float(src_format) == 1 && dst_linear) {
+		int get_idx = snd_pcm_lfloat_get_s32_index(src_format);
+		if (get_idx < 0)
+			return get_idx;
+		snd_pcm_lfloat_convert_float_integer(dst_areas, dst_offset,
+						     src_areas, src_offset,
+						     channels, frames,
+						     snd_pcm_linear_put_index(SND_PCM_FORMAT_S32, dst_format),
+						     get_idx);
+		return 0;
+	}
+#endif
+	SNDMSG("unsupported conversion %s -> %s",
+	       snd_pcm_format_name(src_format),
+	       snd_pcm_format_name(dst_format));
+	return -EINVAL;
+}
+
 static int snd_pcm_linear_hw_refine_cprepare(snd_pcm_t *pcm ATTRIBUTE_UNUSED, snd_pcm_hw_params_t *params)
 {
 	int err;
@@ -432,10 +902,11 @@ int snd_pcm_linear_open(snd_pcm_t **pcmp, const char *name, snd_pcm_format_t sfo
 	assert(pcmp && slave);
 	if (snd_pcm_format_linear(sformat) != 1)
 		return -EINVAL;
-	linear = calloc(1, sizeof(snd_pcm_linear_t));
-	if (!linear) {
-		return -ENOMEM;
-	}
+	err = snd_pcm_new_priv(&pcm, SND_PCM_TYPE_LINEAR, name, slave->stream,
+			       slave->mode, sizeof(snd_pcm_linear_t),
+			       (void **)&linear);
+	if (err < 0)
+		return err;
 	snd_pcm_plugin_init(&linear->plug);
 	linear->sformat = sformat;
 	linear->plug.read = snd_pcm_linear_read_areas;
@@ -445,15 +916,11 @@ int snd_pcm_linear_open(snd_pcm_t **pcmp, const char *name, snd_pcm_format_t sfo
 	linear->plug.gen.slave = slave;
 	linear->plug.gen.close_slave = close_slave;
 
-	err = snd_pcm_new(&pcm, SND_PCM_TYPE_LINEAR, name, slave->stream, slave->mode);
-	if (err < 0) {
-		free(linear);
-		return err;
-	}
 	pcm->ops = &snd_pcm_linear_ops;
 	pcm->fast_ops = &snd_pcm_plugin_fast_ops;
 	pcm->private_data = linear;
 	pcm->poll_fd = slave->poll_fd;
+	pcm->poll_dynamic = slave->poll_dynamic;
 	pcm->poll_events = slave->poll_events;
 	pcm->tstamp_type = slave->tstamp_type;
 	snd_pcm_set_hw_ptr(pcm, &linear->plug.hw_ptr, -1, 0);
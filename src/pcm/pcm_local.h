@@ -155,6 +155,8 @@ typedef struct {
 	int (*munmap)(snd_pcm_t *pcm);
 	snd_pcm_chmap_query_t **(*query_chmaps)(snd_pcm_t *pcm);
 	snd_pcm_chmap_t *(*get_chmap)(snd_pcm_t *pcm);
+	/* optional non-allocating variant of get_chmap */
+	int (*get_chmap_buf)(snd_pcm_t *pcm, snd_pcm_chmap_t *map, size_t maxlen);
 	int (*set_chmap)(snd_pcm_t *pcm, const snd_pcm_chmap_t *map);
 } snd_pcm_ops_t;
 
@@ -184,9 +186,11 @@ typedef struct {
 	snd_pcm_sframes_t (*avail_update)(snd_pcm_t *pcm); /* locked */
 	snd_pcm_sframes_t (*mmap_commit)(snd_pcm_t *pcm, snd_pcm_uframes_t offset, snd_pcm_uframes_t size); /* locked */
 	int (*htimestamp)(snd_pcm_t *pcm, snd_pcm_uframes_t *avail, snd_htimestamp_t *tstamp); /* locked */
+	int (*audio_htimestamp)(snd_pcm_t *pcm, snd_pcm_uframes_t *avail, snd_htimestamp_t *tstamp, snd_htimestamp_t *audio_tstamp); /* locked; optional, NULL falls back to status */
 	int (*poll_descriptors_count)(snd_pcm_t *pcm); /* locked */
 	int (*poll_descriptors)(snd_pcm_t *pcm, struct pollfd *pfds, unsigned int space); /* locked */
 	int (*poll_revents)(snd_pcm_t *pcm, struct pollfd *pfds, unsigned int nfds, unsigned short *revents); /* locked */
+	int (*wait)(snd_pcm_t *pcm, int timeout); /* locked; optional, -ENOSYS falls back to poll */
 	int (*may_wait_for_avail_min)(snd_pcm_t *pcm, snd_pcm_uframes_t avail);
 	int (*mmap_begin)(snd_pcm_t *pcm, const snd_pcm_channel_area_t **areas, snd_pcm_uframes_t *offset, snd_pcm_uframes_t *frames); /* locked */
 } snd_pcm_fast_ops_t;
@@ -194,6 +198,9 @@ typedef struct {
 struct _snd_pcm {
 	void *open_func;
 	char *name;
+	snd_config_t *open_conf;	/* resolved configuration this handle
+					 * was opened from, kept for
+					 * snd_pcm_clone() */
 	snd_pcm_type_t type;
 	snd_pcm_stream_t stream;
 	int mode;
@@ -201,8 +208,21 @@ struct _snd_pcm {
 	int poll_fd_count;
 	int poll_fd;
 	unsigned short poll_events;
+	unsigned int poll_gen;		/* bumped when the descriptor set may change */
+	struct pollfd *poll_cache;	/* cached poll descriptor set */
+	unsigned int poll_cache_count;
+	unsigned int poll_cache_gen;	/* generation the cache was built at */
 	int setup: 1,
-	    compat: 1;
+	    compat: 1,
+	    poll_dynamic: 1,		/* descriptors may change at any time */
+	    rewindable_valid: 1,	/* rewindable_cache matches horizon_* */
+	    forwardable_valid: 1;	/* forwardable_cache matches horizon_* */
+	/* cached rewindable/forwardable horizons; valid while the appl/hw
+	 * pointer snapshot below is unchanged */
+	snd_pcm_uframes_t horizon_appl;
+	snd_pcm_uframes_t horizon_hw;
+	snd_pcm_sframes_t rewindable_cache;
+	snd_pcm_sframes_t forwardable_cache;
 	snd_pcm_access_t access;	/* access mode */
 	snd_pcm_format_t format;	/* SND_PCM_FORMAT_* */
 	snd_pcm_subformat_t subformat;	/* subformat */
@@ -216,6 +236,7 @@ struct _snd_pcm {
 	unsigned int period_step;
 	snd_pcm_uframes_t avail_min;	/* min avail frames for wakeup */
 	int period_event;
+	unsigned int wait_spin_us;	/* busy-poll budget before poll() */
 	snd_pcm_uframes_t start_threshold;
 	snd_pcm_uframes_t stop_threshold;
 	snd_pcm_uframes_t silence_threshold;	/* Silence filling happens when
@@ -241,7 +262,21 @@ struct _snd_pcm {
 					 */
 	unsigned int donot_close: 1;	/* don't close this PCM */
 	unsigned int own_state_check:1; /* plugin has own PCM state check */
+	unsigned int mmap_mirror_req: 1; /* double mapped ring requested */
+	unsigned int mmap_mirrored: 1;	/* all current areas are double mapped,
+					 * mmap_begin windows may cross the wrap
+					 */
 	snd_pcm_channel_info_t *mmap_channels;
+	unsigned char *mmap_mirror_map;	/* per channel: area is double mapped */
+	struct {
+		void *base;	/* one aligned backing block, see pcm_arena.c */
+		size_t size;	/* mapped length */
+		size_t used;
+	} arena;
+	size_t embedded_size;	/* private data co-allocated behind the
+				 * handle by snd_pcm_new_priv(); zero when
+				 * the plugin malloc'd it separately
+				 */
 	snd_pcm_channel_area_t *running_areas;
 	snd_pcm_channel_area_t *stopped_areas;
 	const snd_pcm_ops_t *ops;
@@ -250,6 +285,26 @@ struct _snd_pcm {
 	snd_pcm_t *fast_op_arg;
 	void *private_data;
 	struct list_head async_handlers;
+	snd_pcm_hw_params_t *hw_params_any_cache; /* refined full configuration
+					 * space, NULL = not primed; dropped
+					 * when the installed setup changes
+					 */
+	unsigned int stats_enabled: 1;	/* collect runtime statistics */
+	snd_pcm_stats_t stats;		/* runtime counters; updated by the
+					 * calling thread without atomics,
+					 * see snd_pcm_stats_get()
+					 */
+	unsigned int autotune_enabled: 1; /* closed-loop avail_min tuning */
+	struct {
+		snd_pcm_uframes_t min;	/* caller bounds for avail_min */
+		snd_pcm_uframes_t max;
+		snd_pcm_uframes_t pending; /* avail_min to install, 0 = none */
+		snd_pcm_uframes_t overshoot; /* peak frames past avail_min
+					      * seen at wakeup in this window */
+		unsigned long long xruns; /* xruns seen since enable */
+		unsigned long long window_xruns; /* .xruns at the window start */
+		unsigned int wakeups;	/* wakeups in the current window */
+	} autotune;
 #ifdef THREAD_SAFE_API
 	int need_lock;		/* true = this PCM (plugin) is thread-unsafe,
 				 * thus it needs a lock.
@@ -274,6 +329,8 @@ struct _snd_pcm {
 */
 #define snd_pcm_new \
 	snd1_pcm_new
+#define snd_pcm_new_priv \
+	snd1_pcm_new_priv
 #define snd_pcm_free \
 	snd1_pcm_free
 #define snd_pcm_areas_from_buf \
@@ -370,9 +427,31 @@ struct _snd_pcm {
 	snd1_pcm_hw_param_name
 #define snd_pcm_sw_params_current_no_lock \
 	snd1_pcm_sw_params_current_no_lock
+#define snd_pcm_arena_setup \
+	snd1_pcm_arena_setup
+#define snd_pcm_arena_alloc \
+	snd1_pcm_arena_alloc
+#define snd_pcm_arena_release \
+	snd1_pcm_arena_release
+#define snd_pcm_arena_free \
+	snd1_pcm_arena_free
+
+/* per-handle aligned buffer arena for plugin setup allocations
+ * (pcm_arena.c); slices start on cacheline boundaries
+ */
+#define SND_PCM_ARENA_ALIGN	64
+#define SND_PCM_ARENA_SIZE(size) \
+	(((size) + SND_PCM_ARENA_ALIGN - 1) & ~(size_t)(SND_PCM_ARENA_ALIGN - 1))
+int snd_pcm_arena_setup(snd_pcm_t *pcm, size_t size);
+void *snd_pcm_arena_alloc(snd_pcm_t *pcm, size_t size);
+void snd_pcm_arena_release(snd_pcm_t *pcm);
+void snd_pcm_arena_free(snd_pcm_t *pcm);
 
 int snd_pcm_new(snd_pcm_t **pcmp, snd_pcm_type_t type, const char *name,
 		snd_pcm_stream_t stream, int mode);
+int snd_pcm_new_priv(snd_pcm_t **pcmp, snd_pcm_type_t type, const char *name,
+		     snd_pcm_stream_t stream, int mode,
+		     size_t priv_size, void **priv_ret);
 int snd_pcm_free(snd_pcm_t *pcm);
 
 void snd_pcm_areas_from_buf(snd_pcm_t *pcm, snd_pcm_channel_area_t *areas, void *buf);
@@ -642,34 +721,50 @@ static inline snd_pcm_sframes_t snd_pcm_mmap_delay(snd_pcm_t *pcm)
 
 static inline snd_pcm_sframes_t _snd_pcm_writei(snd_pcm_t *pcm, const void *buffer, snd_pcm_uframes_t size)
 {
+	snd_pcm_sframes_t result;
 	/* lock handled in the callback */
 	if (!pcm->fast_ops->writei)
 		return -ENOSYS;
-	return pcm->fast_ops->writei(pcm->fast_op_arg, buffer, size);
+	result = pcm->fast_ops->writei(pcm->fast_op_arg, buffer, size);
+	if (pcm->stats_enabled && result > 0)
+		pcm->stats.frames_written += result;
+	return result;
 }
 
 static inline snd_pcm_sframes_t _snd_pcm_writen(snd_pcm_t *pcm, void **bufs, snd_pcm_uframes_t size)
 {
+	snd_pcm_sframes_t result;
 	/* lock handled in the callback */
 	if (!pcm->fast_ops->writen)
 		return -ENOSYS;
-	return pcm->fast_ops->writen(pcm->fast_op_arg, bufs, size);
+	result = pcm->fast_ops->writen(pcm->fast_op_arg, bufs, size);
+	if (pcm->stats_enabled && result > 0)
+		pcm->stats.frames_written += result;
+	return result;
 }
 
 static inline snd_pcm_sframes_t _snd_pcm_readi(snd_pcm_t *pcm, void *buffer, snd_pcm_uframes_t size)
 {
+	snd_pcm_sframes_t result;
 	/* lock handled in the callback */
 	if (!pcm->fast_ops->readi)
 		return -ENOSYS;
-	return pcm->fast_ops->readi(pcm->fast_op_arg, buffer, size);
+	result = pcm->fast_ops->readi(pcm->fast_op_arg, buffer, size);
+	if (pcm->stats_enabled && result > 0)
+		pcm->stats.frames_read += result;
+	return result;
 }
 
 static inline snd_pcm_sframes_t _snd_pcm_readn(snd_pcm_t *pcm, void **bufs, snd_pcm_uframes_t size)
 {
+	snd_pcm_sframes_t result;
 	/* lock handled in the callback */
 	if (!pcm->fast_ops->readn)
 		return -ENOSYS;
-	return pcm->fast_ops->readn(pcm->fast_op_arg, bufs, size);
+	result = pcm->fast_ops->readn(pcm->fast_op_arg, bufs, size);
+	if (pcm->stats_enabled && result > 0)
+		pcm->stats.frames_read += result;
+	return result;
 }
 
 static inline int muldiv(int a, int b, int c, int *r)
@@ -1165,6 +1260,27 @@ static inline void sw_set_period_event(snd_pcm_sw_params_t *params, int val)
 	params->reserved[sizeof(params->reserved) / sizeof(params->reserved[0]) - 1] = val;
 }
 
+/* similar hack for the busy-poll budget (microseconds), stored in the
+ * four reserved bytes below the period_event byte; must be cleared
+ * before the structure is passed to the kernel
+ */
+static inline unsigned int sw_get_wait_spin_us(const snd_pcm_sw_params_t *params)
+{
+	const unsigned char *r = params->reserved +
+		sizeof(params->reserved) / sizeof(params->reserved[0]) - 5;
+	return r[0] | (r[1] << 8) | (r[2] << 16) | ((unsigned int)r[3] << 24);
+}
+
+static inline void sw_set_wait_spin_us(snd_pcm_sw_params_t *params, unsigned int val)
+{
+	unsigned char *r = params->reserved +
+		sizeof(params->reserved) / sizeof(params->reserved[0]) - 5;
+	r[0] = val;
+	r[1] = val >> 8;
+	r[2] = val >> 16;
+	r[3] = val >> 24;
+}
+
 #define PCMINABORT(pcm) (((pcm)->mode & SND_PCM_ABORT) != 0)
 
 static inline snd_pcm_sframes_t pcm_frame_diff(snd_pcm_uframes_t ptr1,
@@ -593,6 +593,7 @@ int snd_pcm_meter_open(snd_pcm_t **pcmp, const char *name, unsigned int frequenc
 	pcm->fast_ops = &snd_pcm_meter_fast_ops;
 	pcm->private_data = meter;
 	pcm->poll_fd = slave->poll_fd;
+	pcm->poll_dynamic = slave->poll_dynamic;
 	pcm->poll_events = slave->poll_events;
 	pcm->tstamp_type = slave->tstamp_type;
 	snd_pcm_link_hw_ptr(pcm, slave);
@@ -1003,16 +1004,36 @@ typedef struct _snd_pcm_scope_s16 {
 	snd_pcm_uframes_t old;
 	int16_t *buf;
 	snd_pcm_channel_area_t *buf_areas;
+	struct _snd_pcm_scope_s16 *shared;	/* conversion owner, NULL
+						 * when this scope converts
+						 */
 } snd_pcm_scope_s16_t;
 
+static const snd_pcm_scope_ops_t s16_ops;
+
 static int s16_enable(snd_pcm_scope_t *scope)
 {
 	snd_pcm_scope_s16_t *s16 = scope->private_data;
 	snd_pcm_meter_t *meter = s16->pcm->private_data;
 	snd_pcm_t *spcm = meter->gen.slave;
 	snd_pcm_channel_area_t *a;
+	struct list_head *pos;
 	unsigned int c;
 	int idx;
+	/* batch the dispatch: when another s16 scope is already enabled
+	 * it converts the whole ring once per update, so just borrow its
+	 * buffer instead of running a second conversion pass
+	 */
+	list_for_each(pos, &meter->scopes) {
+		snd_pcm_scope_t *scope1 = list_entry(pos, snd_pcm_scope_t, list);
+		if (scope1 == scope || !scope1->enabled || scope1->ops != &s16_ops)
+			continue;
+		s16->shared = scope1->private_data;
+		s16->index = s16->shared->index;
+		s16->buf = s16->shared->buf;
+		s16->buf_areas = s16->shared->buf_areas;
+		return 0;
+	}
 	if (spcm->format == SND_PCM_FORMAT_S16 &&
 	    spcm->access == SND_PCM_ACCESS_MMAP_NONINTERLEAVED) {
 		s16->buf = (int16_t *) meter->buf;
@@ -1072,6 +1093,13 @@ static int s16_enable(snd_pcm_scope_t *scope)
 static void s16_disable(snd_pcm_scope_t *scope)
 {
 	snd_pcm_scope_s16_t *s16 = scope->private_data;
+	if (s16->shared) {
+		/* the buffer belongs to the conversion owner */
+		s16->shared = NULL;
+		s16->buf = NULL;
+		s16->buf_areas = NULL;
+		return;
+	}
 	free(s16->adpcm_states);
 	s16->adpcm_states = NULL;
 	free(s16->buf);
@@ -1101,6 +1129,11 @@ static void s16_update(snd_pcm_scope_t *scope)
 	snd_pcm_t *spcm = meter->gen.slave;
 	snd_pcm_sframes_t size;
 	snd_pcm_uframes_t offset;
+	if (s16->shared) {
+		/* the owner runs earlier in the scope list */
+		s16->old = meter->now;
+		return;
+	}
 	size = meter->now - s16->old;
 	if (size < 0)
 		size += spcm->boundary;
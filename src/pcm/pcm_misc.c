@@ -604,6 +604,7 @@ uint8_t snd_pcm_format_silence(snd_pcm_format_t format)
  * \param samples Samples count
  * \return 0 if successful or a negative error code
  */
+SND_TARGET_CLONES
 int snd_pcm_format_set_silence(snd_pcm_format_t format, void *data, unsigned int samples)
 {
 	if (samples == 0)
@@ -257,10 +257,62 @@ int snd_pcm_channel_info_shm(snd_pcm_t *pcm, snd_pcm_channel_info_t *info, int s
 	return 0;
 }	
 
+#ifndef DOC_HIDDEN
+
+/* Map the object behind fd twice back to back, so that the ring appears
+ * virtually contiguous across the wrap point and mmap_begin windows do
+ * not have to stop at the buffer end.  Returns NULL when the kernel
+ * refuses the layout; the caller falls back to the flat mapping.
+ */
+static void *pcm_mmap_mirror_fd(int fd, off_t offset, size_t size)
+{
+	char *ptr;
+
+	ptr = mmap(NULL, size * 2, PROT_NONE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+	if (ptr == MAP_FAILED)
+		return NULL;
+	if (mmap(ptr, size, PROT_READ|PROT_WRITE,
+		 MAP_FILE|MAP_SHARED|MAP_FIXED, fd, offset) == MAP_FAILED ||
+	    mmap(ptr + size, size, PROT_READ|PROT_WRITE,
+		 MAP_FILE|MAP_SHARED|MAP_FIXED, fd, offset) == MAP_FAILED) {
+		munmap(ptr, size * 2);
+		return NULL;
+	}
+	return ptr;
+}
+
+#ifdef HAVE_MEMFD_CREATE
+static void *pcm_mmap_mirror_local(size_t size)
+{
+	void *ptr = NULL;
+	int fd;
+
+	fd = memfd_create("alsa-pcm-mirror", MFD_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+	if (ftruncate(fd, size) == 0)
+		ptr = pcm_mmap_mirror_fd(fd, 0, size);
+	close(fd);
+	return ptr;
+}
+#endif
+
+/* the second mapping lines up with the ring only when the ring length
+ * itself fills the whole (page aligned) mapping
+ */
+static int pcm_mmap_mirror_fits(snd_pcm_t *pcm, snd_pcm_channel_info_t *i,
+				size_t size)
+{
+	return (size_t)i->step * pcm->buffer_size == size * 8;
+}
+
+#endif /* DOC_HIDDEN */
+
 int snd_pcm_mmap(snd_pcm_t *pcm)
 {
 	int err;
 	unsigned int c;
+	unsigned int blocks = 0, mirrored = 0;
 	assert(pcm);
 	if (CHECK_SANITY(! pcm->setup)) {
 		SNDMSG("PCM not set up");
@@ -287,6 +339,10 @@ int snd_pcm_mmap(snd_pcm_t *pcm)
 		pcm->mmap_channels = NULL;
 		return -ENOMEM;
 	}
+	if (pcm->mmap_mirror_req) {
+		/* a missing map just means no wrap free guarantee */
+		pcm->mmap_mirror_map = calloc(pcm->channels, 1);
+	}
 	for (c = 0; c < pcm->channels; ++c) {
 		snd_pcm_channel_info_t *i = &pcm->mmap_channels[c];
 		i->channel = c;
@@ -338,9 +394,20 @@ int snd_pcm_mmap(snd_pcm_t *pcm)
 		}
 		size = (size + 7) / 8;
 		size = page_align(size);
+		blocks++;
 		switch (i->type) {
 		case SND_PCM_AREA_MMAP:
-			ptr = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_FILE|MAP_SHARED, i->u.mmap.fd, i->u.mmap.offset);
+			ptr = NULL;
+			if (pcm->mmap_mirror_map &&
+			    pcm_mmap_mirror_fits(pcm, i, size)) {
+				ptr = pcm_mmap_mirror_fd(i->u.mmap.fd, i->u.mmap.offset, size);
+				if (ptr) {
+					pcm->mmap_mirror_map[c] = 1;
+					mirrored++;
+				}
+			}
+			if (!ptr)
+				ptr = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_FILE|MAP_SHARED, i->u.mmap.fd, i->u.mmap.offset);
 			if (ptr == MAP_FAILED) {
 				SYSERR("mmap failed");
 				return -errno;
@@ -350,29 +417,40 @@ int snd_pcm_mmap(snd_pcm_t *pcm)
 		case SND_PCM_AREA_SHM:
 #ifdef HAVE_SYS_SHM_H
 			if (i->u.shm.shmid < 0) {
-				int id;
-				/* FIXME: safer permission? */
-				id = shmget(IPC_PRIVATE, size, 0666);
+				int id = -1;
+#ifdef HAVE_MEMFD_CREATE
+				/* prefer a memfd backed area; it is not
+				 * accounted against the SysV shm limits and
+				 * large buffers may get hugepage backing
+				 */
+				i->u.shm.area = snd_shm_area_create_memfd("alsa-pcm", size, (void **)&ptr);
+				if (i->u.shm.area)
+					id = snd_shm_area_get_fd(i->u.shm.area);
+#endif
 				if (id < 0) {
-					SYSERR("shmget failed");
-					return -errno;
+					/* FIXME: safer permission? */
+					id = shmget(IPC_PRIVATE, size, 0666);
+					if (id < 0) {
+						SYSERR("shmget failed");
+						return -errno;
+					}
+					ptr = shmat(id, 0, 0);
+					if (ptr == (void *) -1) {
+						SYSERR("shmat failed");
+						return -errno;
+					}
+					/* automatically remove segment if not used */
+					if (shmctl(id, IPC_RMID, NULL) < 0){
+						SYSERR("shmctl mark remove failed");
+						return -errno;
+					}
+					i->u.shm.area = snd_shm_area_create(id, ptr);
+					if (i->u.shm.area == NULL) {
+						SYSERR("snd_shm_area_create failed");
+						return -ENOMEM;
+					}
 				}
 				i->u.shm.shmid = id;
-				ptr = shmat(i->u.shm.shmid, 0, 0);
-				if (ptr == (void *) -1) {
-					SYSERR("shmat failed");
-					return -errno;
-				}
-				/* automatically remove segment if not used */
-				if (shmctl(id, IPC_RMID, NULL) < 0){
-					SYSERR("shmctl mark remove failed");
-					return -errno;
-				}
-				i->u.shm.area = snd_shm_area_create(id, ptr);
-				if (i->u.shm.area == NULL) {
-					SYSERR("snd_shm_area_create failed");
-					return -ENOMEM;
-				}
 				if (pcm->access == SND_PCM_ACCESS_MMAP_INTERLEAVED ||
 				    pcm->access == SND_PCM_ACCESS_RW_INTERLEAVED) {
 					unsigned int c1;
@@ -398,11 +476,24 @@ int snd_pcm_mmap(snd_pcm_t *pcm)
 			return -ENOSYS;
 #endif
 		case SND_PCM_AREA_LOCAL:
-			ptr = malloc(size);
+			ptr = NULL;
+#ifdef HAVE_MEMFD_CREATE
+			if (pcm->mmap_mirror_map &&
+			    pcm_mmap_mirror_fits(pcm, i, size)) {
+				ptr = pcm_mmap_mirror_local(size);
+				if (ptr) {
+					pcm->mmap_mirror_map[c] = 1;
+					mirrored++;
+				}
+			}
+#endif
+			if (!ptr)
+				ptr = malloc(size);
 			if (ptr == NULL) {
 				SYSERR("malloc failed");
 				return -errno;
 			}
+			snd_memstat_update(SND_MEMSTAT_PCM, size, 1);
 			i->addr = ptr;
 			break;
 		default:
@@ -436,6 +527,11 @@ int snd_pcm_mmap(snd_pcm_t *pcm)
 		a->first = i->first;
 		a->step = i->step;
 	}
+	/* the wrap free window guarantee holds only when every mapped
+	 * block got its mirror
+	 */
+	if (blocks > 0 && blocks == mirrored)
+		pcm->mmap_mirrored = 1;
 	return 0;
 }
 
@@ -474,7 +570,10 @@ int snd_pcm_munmap(snd_pcm_t *pcm)
 		size = page_align(size);
 		switch (i->type) {
 		case SND_PCM_AREA_MMAP:
-			err = munmap(i->addr, size);
+			if (pcm->mmap_mirror_map && pcm->mmap_mirror_map[c])
+				err = munmap(i->addr, size * 2);
+			else
+				err = munmap(i->addr, size);
 			if (err < 0) {
 				SYSERR("mmap failed");
 				return -errno;
@@ -504,7 +603,11 @@ int snd_pcm_munmap(snd_pcm_t *pcm)
 			return -ENOSYS;
 #endif
 		case SND_PCM_AREA_LOCAL:
-			free(i->addr);
+			snd_memstat_update(SND_MEMSTAT_PCM, -(ssize_t)size, -1);
+			if (pcm->mmap_mirror_map && pcm->mmap_mirror_map[c])
+				munmap(i->addr, size * 2);
+			else
+				free(i->addr);
 			break;
 		default:
 			assert(0);
@@ -519,8 +622,11 @@ int snd_pcm_munmap(snd_pcm_t *pcm)
 		return err;
 	free(pcm->mmap_channels);
 	free(pcm->running_areas);
+	free(pcm->mmap_mirror_map);
 	pcm->mmap_channels = NULL;
 	pcm->running_areas = NULL;
+	pcm->mmap_mirror_map = NULL;
+	pcm->mmap_mirrored = 0;
 	return 0;
 }
 
@@ -635,3 +741,48 @@ snd_pcm_sframes_t snd_pcm_read_mmap(snd_pcm_t *pcm, snd_pcm_uframes_t offset,
 		return xfer;
 	return err;
 }
+
+/**
+ * \brief Request a wrap free (double mapped) ring buffer
+ * \param pcm PCM handle
+ * \param enable 0 = single mapping (default), 1 = request the mirror
+ * \return 0 on success otherwise a negative error code
+ * \retval -EBUSY the ring buffer is currently mapped
+ *
+ * When enabled, the library tries to map each ring buffer block twice
+ * back to back when the buffer is set up, so that the buffer appears
+ * virtually contiguous across the wrap point.  #snd_pcm_mmap_begin then
+ * returns windows which may cross the wrap instead of stopping at the
+ * buffer end, removing the split chunk handling from vectorized mmap
+ * consumers.
+ *
+ * The mirror is a best effort: it requires a page aligned ring length
+ * and kernel support for mapping the buffer twice, and it covers the
+ * device and plugin owned buffers, not areas exported by foreign
+ * plugins.  Whether the guarantee is in effect for the current setup
+ * must be checked with #snd_pcm_mmap_mirrored after the configuration;
+ * without it the windows stop at the buffer end as before.
+ *
+ * The request must be issued before the buffer is mapped, i.e. before
+ * #snd_pcm_hw_params, and is kept across reconfigurations.
+ */
+int snd_pcm_mmap_mirror(snd_pcm_t *pcm, int enable)
+{
+	assert(pcm);
+	if (pcm->mmap_channels)
+		return -EBUSY;
+	pcm->mmap_mirror_req = enable ? 1 : 0;
+	return 0;
+}
+
+/**
+ * \brief Check whether the current ring buffer mapping is wrap free
+ * \param pcm PCM handle
+ * \return 1 when every ring buffer block is double mapped and
+ *         #snd_pcm_mmap_begin windows may cross the wrap, 0 otherwise
+ */
+int snd_pcm_mmap_mirrored(snd_pcm_t *pcm)
+{
+	assert(pcm);
+	return pcm->mmap_mirrored;
+}
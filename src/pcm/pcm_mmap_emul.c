@@ -163,6 +163,9 @@ static int snd_pcm_mmap_emul_hw_params(snd_pcm_t *pcm,
 	err = _snd_pcm_hw_params_internal(map->gen.slave, params);
 	if (err >= 0) {
 		map->mmap_emul = 0;
+		/* the slave takes the mmap access after all; alias its
+		 * mmap buffer instead of copying through an own one */
+		pcm->mmap_shadow = 1;
 		return err;
 	}
 
@@ -195,6 +198,7 @@ static int snd_pcm_mmap_emul_hw_params(snd_pcm_t *pcm,
 
 	/* OK, we do fake */
 	map->mmap_emul = 1;
+	pcm->mmap_shadow = 0;
 	map->appl_ptr = 0;
 	map->hw_ptr = 0;
 	snd_pcm_set_hw_ptr(pcm, &map->hw_ptr, -1, 0);
@@ -411,22 +415,19 @@ int __snd_pcm_mmap_emul_open(snd_pcm_t **pcmp, const char *name,
 	mmap_emul_t *map;
 	int err;
 
-	map = calloc(1, sizeof(*map));
-	if (!map)
-		return -ENOMEM;
+	err = snd_pcm_new_priv(&pcm, SND_PCM_TYPE_MMAP_EMUL, name,
+			       slave->stream, slave->mode, sizeof(*map),
+			       (void **)&map);
+	if (err < 0)
+		return err;
 	map->gen.slave = slave;
 	map->gen.close_slave = close_slave;
 
-	err = snd_pcm_new(&pcm, SND_PCM_TYPE_MMAP_EMUL, name,
-			  slave->stream, slave->mode);
-	if (err < 0) {
-		free(map);
-		return err;
-	}
 	pcm->ops = &snd_pcm_mmap_emul_ops;
 	pcm->fast_ops = &snd_pcm_mmap_emul_fast_ops;
 	pcm->private_data = map;
 	pcm->poll_fd = slave->poll_fd;
+	pcm->poll_dynamic = slave->poll_dynamic;
 	pcm->poll_events = slave->poll_events;
 	pcm->tstamp_type = slave->tstamp_type;
 	snd_pcm_set_hw_ptr(pcm, &map->hw_ptr, -1, 0);
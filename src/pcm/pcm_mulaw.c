@@ -55,22 +55,13 @@ typedef struct {
 
 #endif
 
-static inline int val_seg(int val)
-{
-	int r = 0;
-	val >>= 7;
-	if (val & 0xf0) {
-		val >>= 4;
-		r += 4;
-	}
-	if (val & 0x0c) {
-		val >>= 2;
-		r += 2;
-	}
-	if (val & 0x02)
-		r += 1;
-	return r;
-}
+/* batch conversion tables: straight 256-entry decode lookups and a
+ * branch-free segment lookup for the encoder, filled once at open time
+ * (a concurrent refill writes the same constants, so it is harmless)
+ */
+static int16_t mulaw_decode_tab[256];
+static unsigned char mulaw_seg_tab[256];
+static int mulaw_tabs_ready;
 
 /*
  * s16_to_ulaw() - Convert a linear PCM value to u-law
@@ -104,22 +95,19 @@ static inline int val_seg(int val)
 
 static unsigned char s16_to_ulaw(int pcm_val)	/* 2's complement (16-bit range) */
 {
-	int mask;
+	int sign = pcm_val >> 31;
+	int mask = 0xff ^ (sign & 0x80);
 	int seg;
 	unsigned char uval;
 
-	if (pcm_val < 0) {
-		pcm_val = 0x84 - pcm_val;
-		mask = 0x7f;
-	} else {
-		pcm_val += 0x84;
-		mask = 0xff;
-	}
+	/* branch-free sign handling keeps the encode loop free of
+	 * data-dependent jumps */
+	pcm_val = ((pcm_val ^ sign) - sign) + 0x84;
 	if (pcm_val > 0x7fff)
 		pcm_val = 0x7fff;
 
 	/* Convert the scaled magnitude to segment number. */
-	seg = val_seg(pcm_val);
+	seg = mulaw_seg_tab[pcm_val >> 7];
 
 	/*
 	 * Combine the sign, segment, quantization bits;
@@ -155,6 +143,22 @@ static int ulaw_to_s16(unsigned char u_val)
 	return ((u_val & 0x80) ? (0x84 - t) : (t - 0x84));
 }
 
+static void mulaw_build_tables(void)
+{
+	int i, seg, v;
+
+	if (mulaw_tabs_ready)
+		return;
+	for (i = 0; i < 256; i++) {
+		mulaw_decode_tab[i] = ulaw_to_s16(i);
+		seg = 0;
+		for (v = i >> 1; v; v >>= 1)
+			seg++;
+		mulaw_seg_tab[i] = seg;
+	}
+	mulaw_tabs_ready = 1;
+}
+
 #ifndef DOC_HIDDEN
 
 void snd_pcm_mulaw_decode(const snd_pcm_channel_area_t *dst_areas,
@@ -169,6 +173,8 @@ void snd_pcm_mulaw_decode(const snd_pcm_channel_area_t *dst_areas,
 #undef PUT16_LABELS
 	void *put = put16_labels[putidx];
 	unsigned int channel;
+	int put_s16 = (int)putidx ==
+		snd_pcm_linear_put_index(SND_PCM_FORMAT_S16, SND_PCM_FORMAT_S16);
 	for (channel = 0; channel < channels; ++channel) {
 		const unsigned char *src;
 		char *dst;
@@ -181,8 +187,16 @@ void snd_pcm_mulaw_decode(const snd_pcm_channel_area_t *dst_areas,
 		src_step = snd_pcm_channel_area_step(src_area);
 		dst_step = snd_pcm_channel_area_step(dst_area);
 		frames1 = frames;
+		if (put_s16 && src_step == 1 && dst_step == 2) {
+			/* flat channel: the plain table loop lets the
+			 * compiler vectorize the lookups */
+			int16_t *dst16 = (int16_t *)dst;
+			while (frames1-- > 0)
+				*dst16++ = mulaw_decode_tab[*src++];
+			continue;
+		}
 		while (frames1-- > 0) {
-			int16_t sample = ulaw_to_s16(*src);
+			int16_t sample = mulaw_decode_tab[*src];
 			goto *put;
 #define PUT16_END after
 #include "plugin_ops.h"
@@ -207,6 +221,8 @@ void snd_pcm_mulaw_encode(const snd_pcm_channel_area_t *dst_areas,
 	void *get = get16_labels[getidx];
 	unsigned int channel;
 	int16_t sample = 0;
+	int get_s16 = (int)getidx ==
+		snd_pcm_linear_get_index(SND_PCM_FORMAT_S16, SND_PCM_FORMAT_S16);
 	for (channel = 0; channel < channels; ++channel) {
 		const char *src;
 		char *dst;
@@ -219,6 +235,12 @@ void snd_pcm_mulaw_encode(const snd_pcm_channel_area_t *dst_areas,
 		src_step = snd_pcm_channel_area_step(src_area);
 		dst_step = snd_pcm_channel_area_step(dst_area);
 		frames1 = frames;
+		if (get_s16 && src_step == 2 && dst_step == 1) {
+			const int16_t *src16 = (const int16_t *)src;
+			while (frames1-- > 0)
+				*dst++ = s16_to_ulaw(*src16++);
+			continue;
+		}
 		while (frames1-- > 0) {
 			goto *get;
 #define GET16_END after
@@ -443,10 +465,12 @@ int snd_pcm_mulaw_open(snd_pcm_t **pcmp, const char *name, snd_pcm_format_t sfor
 	if (snd_pcm_format_linear(sformat) != 1 &&
 	    sformat != SND_PCM_FORMAT_MU_LAW)
 		return -EINVAL;
-	mulaw = calloc(1, sizeof(snd_pcm_mulaw_t));
-	if (!mulaw) {
-		return -ENOMEM;
-	}
+	mulaw_build_tables();
+	err = snd_pcm_new_priv(&pcm, SND_PCM_TYPE_MULAW, name, slave->stream,
+			       slave->mode, sizeof(snd_pcm_mulaw_t),
+			       (void **)&mulaw);
+	if (err < 0)
+		return err;
 	snd_pcm_plugin_init(&mulaw->plug);
 	mulaw->sformat = sformat;
 	mulaw->plug.read = snd_pcm_mulaw_read_areas;
@@ -456,15 +480,11 @@ int snd_pcm_mulaw_open(snd_pcm_t **pcmp, const char *name, snd_pcm_format_t sfor
 	mulaw->plug.gen.slave = slave;
 	mulaw->plug.gen.close_slave = close_slave;
 
-	err = snd_pcm_new(&pcm, SND_PCM_TYPE_MULAW, name, slave->stream, slave->mode);
-	if (err < 0) {
-		free(mulaw);
-		return err;
-	}
 	pcm->ops = &snd_pcm_mulaw_ops;
 	pcm->fast_ops = &snd_pcm_plugin_fast_ops;
 	pcm->private_data = mulaw;
 	pcm->poll_fd = slave->poll_fd;
+	pcm->poll_dynamic = slave->poll_dynamic;
 	pcm->poll_events = slave->poll_events;
 	pcm->tstamp_type = slave->tstamp_type;
 	snd_pcm_set_hw_ptr(pcm, &mulaw->plug.hw_ptr, -1, 0);
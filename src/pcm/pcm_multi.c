@@ -33,6 +33,9 @@
 #include <unistd.h>
 #include <string.h>
 #include <math.h>
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
 
 #ifndef PIC
 /* entry for static linking */
@@ -53,6 +56,22 @@ typedef struct {
 	unsigned int slave_channel;
 } snd_pcm_multi_channel_t;
 
+#ifdef HAVE_LIBPTHREAD
+/* parallel slave dispatch, see snd_pcm_multi_run_job() */
+enum {
+	MULTI_JOB_NONE = 0,
+	MULTI_JOB_HW_PARAMS,
+	MULTI_JOB_PREPARE,
+	MULTI_JOB_AVAIL,
+	MULTI_JOB_COMMIT,
+};
+
+struct snd_pcm_multi_job_arg {
+	snd_pcm_t *pcm;		/* the multi PCM handle */
+	unsigned int idx;	/* slave index served by this job */
+};
+#endif
+
 typedef struct {
 	snd_pcm_uframes_t appl_ptr, hw_ptr;
 	unsigned int slaves_count;
@@ -60,8 +79,24 @@ typedef struct {
 	snd_pcm_multi_slave_t *slaves;
 	unsigned int channels_count;
 	snd_pcm_multi_channel_t *channels;
+#ifdef HAVE_LIBPTHREAD
+	snd_thread_pool_t *pool;	/* shared worker pool (threadpool.c) */
+	snd_thread_pool_job_t *jobs;	/* one per slave #1..N-1,
+					 * the caller handles slave #0
+					 */
+	struct snd_pcm_multi_job_arg *job_args;
+	int job;			/* MULTI_JOB_* */
+	snd_pcm_hw_params_t *job_sparams;	/* MULTI_JOB_HW_PARAMS */
+	snd_pcm_uframes_t job_offset;		/* MULTI_JOB_COMMIT */
+	snd_pcm_uframes_t job_size;		/* MULTI_JOB_COMMIT */
+	snd_pcm_sframes_t *job_result;		/* per-slave result */
+#endif
 } snd_pcm_multi_t;
 
+#ifdef HAVE_LIBPTHREAD
+static void snd_pcm_multi_pool_stop(snd_pcm_multi_t *multi);
+#endif
+
 #endif
 
 static int snd_pcm_multi_close(snd_pcm_t *pcm)
@@ -69,6 +104,9 @@ static int snd_pcm_multi_close(snd_pcm_t *pcm)
 	snd_pcm_multi_t *multi = pcm->private_data;
 	unsigned int i;
 	int ret = 0;
+#ifdef HAVE_LIBPTHREAD
+	snd_pcm_multi_pool_stop(multi);
+#endif
 	for (i = 0; i < multi->slaves_count; ++i) {
 		snd_pcm_multi_slave_t *slave = &multi->slaves[i];
 		if (slave->close_slave) {
@@ -314,6 +352,99 @@ static int snd_pcm_multi_hw_params_slave(snd_pcm_t *pcm,
 	return 0;
 }
 
+#ifdef HAVE_LIBPTHREAD
+/* run the current job for one slave; the public slave API takes the
+ * per-slave lock, so workers never touch each other's handles
+ */
+static snd_pcm_sframes_t snd_pcm_multi_job_one(snd_pcm_t *pcm, unsigned int i)
+{
+	snd_pcm_multi_t *multi = pcm->private_data;
+
+	switch (multi->job) {
+	case MULTI_JOB_HW_PARAMS:
+		return snd_pcm_multi_hw_params_slave(pcm, i, &multi->job_sparams[i]);
+	case MULTI_JOB_PREPARE:
+		return snd_pcm_prepare(multi->slaves[i].pcm);
+	case MULTI_JOB_AVAIL:
+		return snd_pcm_avail_update(multi->slaves[i].pcm);
+	case MULTI_JOB_COMMIT:
+		return snd_pcm_mmap_commit(multi->slaves[i].pcm,
+					   multi->job_offset, multi->job_size);
+	}
+	return 0;
+}
+
+static void snd_pcm_multi_job_func(void *data)
+{
+	struct snd_pcm_multi_job_arg *arg = data;
+	snd_pcm_multi_t *multi = arg->pcm->private_data;
+
+	multi->job_result[arg->idx] = snd_pcm_multi_job_one(arg->pcm, arg->idx);
+}
+
+/* dispatch a job to all slaves at once on the shared pool; the pool
+ * handles slaves #1..N-1 while the calling thread does slave #0 and
+ * steals queued jobs while waiting, so the total cost approaches the
+ * most expensive slave instead of the sum
+ */
+static void snd_pcm_multi_run_job(snd_pcm_t *pcm, int job,
+				  snd_pcm_hw_params_t *sparams,
+				  snd_pcm_uframes_t offset,
+				  snd_pcm_uframes_t size,
+				  snd_pcm_sframes_t *results)
+{
+	snd_pcm_multi_t *multi = pcm->private_data;
+	snd_thread_pool_batch_t batch = { 0 };
+	unsigned int i;
+
+	multi->job = job;
+	multi->job_sparams = sparams;
+	multi->job_offset = offset;
+	multi->job_size = size;
+	multi->job_result = results;
+	for (i = 1; i < multi->slaves_count; ++i)
+		snd_thread_pool_submit(multi->pool, &multi->jobs[i - 1],
+				       snd_pcm_multi_job_func,
+				       &multi->job_args[i - 1], &batch, 1);
+	results[0] = snd_pcm_multi_job_one(pcm, 0);
+	snd_thread_pool_batch_wait(multi->pool, &batch);
+	multi->job = MULTI_JOB_NONE;
+}
+
+/* best effort - without the pool the plugin falls back to serial loops */
+static void snd_pcm_multi_pool_start(snd_pcm_t *pcm)
+{
+	snd_pcm_multi_t *multi = pcm->private_data;
+	unsigned int i;
+
+	if (multi->jobs || multi->slaves_count < 2)
+		return;
+	multi->pool = snd_thread_pool_get();
+	if (!multi->pool)
+		return;
+	multi->jobs = calloc(multi->slaves_count - 1, sizeof(*multi->jobs));
+	multi->job_args = calloc(multi->slaves_count - 1,
+				 sizeof(*multi->job_args));
+	if (!multi->jobs || !multi->job_args) {
+		snd_pcm_multi_pool_stop(multi);
+		return;
+	}
+	for (i = 1; i < multi->slaves_count; ++i) {
+		multi->job_args[i - 1].pcm = pcm;
+		multi->job_args[i - 1].idx = i;
+	}
+	multi->job = MULTI_JOB_NONE;
+}
+
+static void snd_pcm_multi_pool_stop(snd_pcm_multi_t *multi)
+{
+	free(multi->jobs);
+	free(multi->job_args);
+	multi->jobs = NULL;
+	multi->job_args = NULL;
+}
+#endif /* HAVE_LIBPTHREAD */
+
 /* reset links to the normal state
  * slave #0 = trigger master
  * slave #1-(N-1) = trigger slaves, linked is set to #0
@@ -344,6 +475,24 @@ static int snd_pcm_multi_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t *params)
 		assert(err >= 0);
 		err = snd_pcm_multi_hw_refine_schange(pcm, i, params, &sparams[i]);
 		assert(err >= 0);
+	}
+#ifdef HAVE_LIBPTHREAD
+	snd_pcm_multi_pool_start(pcm);
+	if (multi->jobs) {
+		snd_pcm_sframes_t results[multi->slaves_count];
+		snd_pcm_multi_run_job(pcm, MULTI_JOB_HW_PARAMS, sparams,
+				      0, 0, results);
+		for (i = 0; i < multi->slaves_count; ++i) {
+			if (results[i] < 0) {
+				snd_pcm_multi_hw_refine_cchange(pcm, i, params, &sparams[i]);
+				return results[i];
+			}
+		}
+		reset_links(multi);
+		return 0;
+	}
+#endif
+	for (i = 0; i < multi->slaves_count; ++i) {
 		err = snd_pcm_multi_hw_params_slave(pcm, i, &sparams[i]);
 		if (err < 0) {
 			snd_pcm_multi_hw_refine_cchange(pcm, i, params, &sparams[i]);
@@ -478,6 +627,21 @@ static snd_pcm_sframes_t snd_pcm_multi_avail_update(snd_pcm_t *pcm)
 	snd_pcm_multi_t *multi = pcm->private_data;
 	snd_pcm_sframes_t ret = LONG_MAX;
 	unsigned int i;
+#ifdef HAVE_LIBPTHREAD
+	if (multi->jobs) {
+		snd_pcm_sframes_t results[multi->slaves_count];
+		snd_pcm_multi_run_job(pcm, MULTI_JOB_AVAIL, NULL,
+				      0, 0, results);
+		for (i = 0; i < multi->slaves_count; ++i) {
+			if (results[i] < 0)
+				return results[i];
+			if (ret > results[i])
+				ret = results[i];
+		}
+		snd_pcm_multi_hwptr_update(pcm);
+		return ret;
+	}
+#endif
 	for (i = 0; i < multi->slaves_count; ++i) {
 		snd_pcm_sframes_t avail;
 		avail = snd_pcm_avail_update(multi->slaves[i].pcm);
@@ -503,6 +667,19 @@ static int snd_pcm_multi_prepare(snd_pcm_t *pcm)
 	snd_pcm_multi_t *multi = pcm->private_data;
 	int result = 0, err;
 	unsigned int i;
+#ifdef HAVE_LIBPTHREAD
+	if (multi->jobs) {
+		snd_pcm_sframes_t results[multi->slaves_count];
+		snd_pcm_multi_run_job(pcm, MULTI_JOB_PREPARE, NULL,
+				      0, 0, results);
+		for (i = 0; i < multi->slaves_count; ++i) {
+			if (results[i] < 0)
+				result = results[i];
+		}
+		multi->hw_ptr = multi->appl_ptr = 0;
+		return result;
+	}
+#endif
 	for (i = 0; i < multi->slaves_count; ++i) {
 		/* We call prepare to each slave even if it's linked.
 		 * This is to make sure to sync non-mmaped control/status.
@@ -787,6 +964,21 @@ static snd_pcm_sframes_t snd_pcm_multi_mmap_commit(snd_pcm_t *pcm,
 	unsigned int i;
 	snd_pcm_sframes_t result;
 
+#ifdef HAVE_LIBPTHREAD
+	if (multi->jobs) {
+		snd_pcm_sframes_t results[multi->slaves_count];
+		snd_pcm_multi_run_job(pcm, MULTI_JOB_COMMIT, NULL,
+				      offset, size, results);
+		for (i = 0; i < multi->slaves_count; ++i) {
+			if (results[i] < 0)
+				return results[i];
+			if ((snd_pcm_uframes_t)results[i] != size)
+				return -EIO;
+		}
+		snd_pcm_mmap_appl_forward(pcm, size);
+		return size;
+	}
+#endif
 	for (i = 0; i < multi->slaves_count; ++i) {
 		slave = multi->slaves[i].pcm;
 		result = snd_pcm_mmap_commit(slave, offset, size);
@@ -1144,6 +1336,7 @@ int snd_pcm_multi_open(snd_pcm_t **pcmp, const char *name,
 	pcm->fast_ops = &snd_pcm_multi_fast_ops;
 	pcm->private_data = multi;
 	pcm->poll_fd = multi->slaves[master_slave].pcm->poll_fd;
+	pcm->poll_dynamic = multi->slaves[master_slave].pcm->poll_dynamic;
 	pcm->poll_events = multi->slaves[master_slave].pcm->poll_events;
 	pcm->tstamp_type = multi->slaves[master_slave].pcm->tstamp_type;
 	snd_pcm_set_hw_ptr(pcm, &multi->hw_ptr, -1, 0);
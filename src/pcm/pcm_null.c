@@ -43,6 +43,7 @@ typedef struct {
 	snd_pcm_uframes_t appl_ptr;
 	snd_pcm_uframes_t hw_ptr;
 	int poll_fd;
+	int lean_buffer;
 	snd_pcm_chmap_query_t **chmap;
 } snd_pcm_null_t;
 #endif
@@ -51,7 +52,8 @@ static int snd_pcm_null_close(snd_pcm_t *pcm)
 {
 	snd_pcm_null_t *null = pcm->private_data;
 	close(null->poll_fd);
-	free(null);
+	if (!pcm->embedded_size)
+		free(null);
 	return 0;
 }
 
@@ -285,6 +287,29 @@ static int snd_pcm_null_hw_params(snd_pcm_t *pcm ATTRIBUTE_UNUSED, snd_pcm_hw_pa
 	return 0;
 }
 
+static int snd_pcm_null_channel_info(snd_pcm_t *pcm, snd_pcm_channel_info_t *info)
+{
+	snd_pcm_null_t *null = pcm->private_data;
+
+	/* plugins shadowing our ring buffer (e.g. the file plugin on
+	 * capture) read committed frames back, so the degenerate layout
+	 * below is only safe when the user asked for it explicitly;
+	 * exported buffers must stay real in any case, somebody else
+	 * may map them */
+	if (!null->lean_buffer ||
+	    (pcm->hw_flags & SND_PCM_HW_PARAMS_EXPORT_BUFFER))
+		return snd_pcm_channel_info_shm(pcm, info, -1);
+	/* a discard device needs no real ring buffer; a zero step makes
+	 * every frame of the channel alias the same sample, so the
+	 * whole stream is backed by a single page whatever the buffer
+	 * size is and silence fills collapse to one sample store */
+	info->first = 0;
+	info->step = 0;
+	info->addr = 0;
+	info->type = SND_PCM_AREA_LOCAL;
+	return 0;
+}
+
 static int snd_pcm_null_hw_free(snd_pcm_t *pcm ATTRIBUTE_UNUSED)
 {
 	return 0;
@@ -329,7 +354,7 @@ static const snd_pcm_ops_t snd_pcm_null_ops = {
 	.hw_params = snd_pcm_null_hw_params,
 	.hw_free = snd_pcm_null_hw_free,
 	.sw_params = snd_pcm_null_sw_params,
-	.channel_info = snd_pcm_generic_channel_info,
+	.channel_info = snd_pcm_null_channel_info,
 	.dump = snd_pcm_null_dump,
 	.nonblock = snd_pcm_null_nonblock,
 	.async = snd_pcm_null_async,
@@ -396,20 +421,15 @@ int snd_pcm_null_open(snd_pcm_t **pcmp, const char *name, snd_pcm_stream_t strea
 			return -errno;
 		}
 	}
-	null = calloc(1, sizeof(snd_pcm_null_t));
-	if (!null) {
-		close(fd);
-		return -ENOMEM;
-	}
-	null->poll_fd = fd;
-	null->state = SND_PCM_STATE_OPEN;
-	
-	err = snd_pcm_new(&pcm, SND_PCM_TYPE_NULL, name, stream, mode);
+	err = snd_pcm_new_priv(&pcm, SND_PCM_TYPE_NULL, name, stream, mode,
+			       sizeof(snd_pcm_null_t), (void **)&null);
 	if (err < 0) {
 		close(fd);
-		free(null);
 		return err;
 	}
+	null->poll_fd = fd;
+	null->state = SND_PCM_STATE_OPEN;
+
 	pcm->ops = &snd_pcm_null_ops;
 	pcm->fast_ops = &snd_pcm_null_fast_ops;
 	pcm->private_data = null;
@@ -436,6 +456,9 @@ and /dev/full (capture, must be readable).
 pcm.name {
         type null               # Null PCM
 	[chmap MAP]		# Provide channel maps; MAP is a string array
+	[lean_buffer BOOL]	# Back the whole ring buffer by a single
+				# sample instead of real memory; committed
+				# frames cannot be read back then
 }
 \endcode
 
@@ -468,6 +491,7 @@ int _snd_pcm_null_open(snd_pcm_t **pcmp, const char *name,
 	snd_config_iterator_t i, next;
 	snd_pcm_null_t *null;
 	snd_pcm_chmap_query_t **chmap = NULL;
+	int lean_buffer = 0;
 	int err;
 
 	snd_config_for_each(i, next, conf) {
@@ -486,6 +510,16 @@ int _snd_pcm_null_open(snd_pcm_t **pcmp, const char *name,
 			}
 			continue;
 		}
+		if (strcmp(id, "lean_buffer") == 0) {
+			err = snd_config_get_bool(n);
+			if (err < 0) {
+				SNDERR("Invalid type for %s", id);
+				snd_pcm_free_chmaps(chmap);
+				return -EINVAL;
+			}
+			lean_buffer = err;
+			continue;
+		}
 		SNDERR("Unknown field %s", id);
 		snd_pcm_free_chmaps(chmap);
 		return -EINVAL;
@@ -498,6 +532,7 @@ int _snd_pcm_null_open(snd_pcm_t **pcmp, const char *name,
 
 	null = (*pcmp)->private_data;
 	null->chmap = chmap;
+	null->lean_buffer = lean_buffer;
 	return 0;
 }
 #ifndef DOC_HIDDEN
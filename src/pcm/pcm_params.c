@@ -2413,6 +2413,10 @@ int _snd_pcm_hw_params_internal(snd_pcm_t *pcm, snd_pcm_hw_params_t *params)
 	if (err < 0)
 		return err;
 
+	/* the installed configuration may constrain the full space */
+	free(pcm->hw_params_any_cache);
+	pcm->hw_params_any_cache = NULL;
+
 	pcm->setup = 1;
 	INTERNAL(snd_pcm_hw_params_get_access)(params, &pcm->access);
 	INTERNAL(snd_pcm_hw_params_get_format)(params, &pcm->format);
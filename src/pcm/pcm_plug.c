@@ -55,6 +55,8 @@ typedef struct {
 	snd_pcm_route_ttable_entry_t *ttable;
 	int ttable_ok;
 	unsigned int tt_ssize, tt_cused, tt_sused;
+	unsigned long long plan_cost;	/* predicted cost of the chosen plan */
+	int route_client_side;		/* route above the rate converter */
 } snd_pcm_plug_t;
 
 #endif
@@ -76,7 +78,8 @@ static int snd_pcm_plug_close(snd_pcm_t *pcm)
 		if (err < 0)
 			result = err;
 	}
-	free(plug);
+	if (!pcm->embedded_size)
+		free(plug);
 	return result;
 }
 
@@ -393,6 +396,29 @@ static int snd_pcm_plug_change_rate(snd_pcm_t *pcm, snd_pcm_t **new, snd_pcm_plu
 #endif
 
 #ifdef BUILD_PCM_PLUGIN_ROUTE
+/* relative per-sample kernel weights for the cost model below; the
+ * ratio reflects the measured throughput of the resampler loop against
+ * the route mixing loop, the absolute scale is meaningless */
+#define PLUG_COST_RATE		16
+#define PLUG_COST_ROUTE		2
+
+static unsigned long long plug_rate_cost(unsigned int channels,
+					 unsigned int crate,
+					 unsigned int srate)
+{
+	unsigned int fmax = crate > srate ? crate : srate;
+
+	return (unsigned long long)PLUG_COST_RATE * channels * fmax;
+}
+
+static unsigned long long plug_route_cost(unsigned int frames,
+					  unsigned int cchannels,
+					  unsigned int schannels)
+{
+	return (unsigned long long)PLUG_COST_ROUTE * frames *
+		cchannels * schannels;
+}
+
 static int snd_pcm_plug_change_channels(snd_pcm_t *pcm, snd_pcm_t **new, snd_pcm_plug_params_t *clt, snd_pcm_plug_params_t *slv)
 {
 	snd_pcm_plug_t *plug = pcm->private_data;
@@ -402,9 +428,30 @@ static int snd_pcm_plug_change_channels(snd_pcm_t *pcm, snd_pcm_t **new, snd_pcm
 	if (clt->channels == slv->channels &&
 	    (!plug->ttable || plug->ttable_ok))
 		return 0;
-	if (clt->rate != slv->rate &&
-	    clt->channels > slv->channels)
-		return 0;
+	if (clt->rate != slv->rate) {
+		unsigned long long cost_sside, cost_cside;
+
+		/* the route can sit on either side of the rate converter;
+		 * weigh samples x per-sample kernel cost of both plans
+		 * (normalized to one second of stream) and keep the
+		 * cheaper one */
+		cost_sside = plug_rate_cost(clt->channels, clt->rate,
+					    slv->rate) +
+			plug_route_cost(slv->rate, clt->channels,
+					slv->channels);
+		cost_cside = plug_route_cost(clt->rate, clt->channels,
+					     slv->channels) +
+			plug_rate_cost(slv->channels, clt->rate, slv->rate);
+		if (cost_cside < cost_sside) {
+			/* deferred to the second pass, which inserts the
+			 * route above the rate plugin */
+			plug->plan_cost = cost_cside;
+			plug->route_client_side = 1;
+			return 0;
+		}
+		plug->plan_cost = cost_sside;
+		plug->route_client_side = 0;
+	}
 	assert(snd_pcm_format_linear(slv->format));
 	tt_ssize = slv->channels;
 	tt_cused = clt->channels;
@@ -689,6 +736,7 @@ static int snd_pcm_plug_insert_plugins(snd_pcm_t *pcm,
 	snd_pcm_plug_params_t p = *slave;
 	unsigned int k = 0;
 	plug->ttable_ok = 0;
+	plug->plan_cost = 0;
 	while (client->format != p.format ||
 	       client->channels != p.channels ||
 	       client->rate != p.rate ||
@@ -1109,7 +1157,12 @@ static int snd_pcm_plug_sw_params(snd_pcm_t *pcm, snd_pcm_sw_params_t * params)
 static void snd_pcm_plug_dump(snd_pcm_t *pcm, snd_output_t *out)
 {
 	snd_pcm_plug_t *plug = pcm->private_data;
-	snd_output_printf(out, "Plug PCM: ");
+	if (plug->plan_cost)
+		snd_output_printf(out, "Plug PCM (route on the %s side of rate, predicted cost %llu): ",
+				  plug->route_client_side ? "client" : "slave",
+				  plug->plan_cost);
+	else
+		snd_output_printf(out, "Plug PCM: ");
 	snd_pcm_dump(plug->gen.slave, out);
 }
 
@@ -1158,9 +1211,11 @@ int snd_pcm_plug_open(snd_pcm_t **pcmp,
 	int err;
 	assert(pcmp && slave);
 
-	plug = calloc(1, sizeof(snd_pcm_plug_t));
-	if (!plug)
-		return -ENOMEM;
+	err = snd_pcm_new_priv(&pcm, SND_PCM_TYPE_PLUG, name, slave->stream,
+			       slave->mode, sizeof(snd_pcm_plug_t),
+			       (void **)&plug);
+	if (err < 0)
+		return err;
 	plug->sformat = sformat;
 	plug->schannels = schannels;
 	plug->srate = srate;
@@ -1171,12 +1226,7 @@ int snd_pcm_plug_open(snd_pcm_t **pcmp,
 	plug->tt_ssize = tt_ssize;
 	plug->tt_cused = tt_cused;
 	plug->tt_sused = tt_sused;
-	
-	err = snd_pcm_new(&pcm, SND_PCM_TYPE_PLUG, name, slave->stream, slave->mode);
-	if (err < 0) {
-		free(plug);
-		return err;
-	}
+
 	pcm->ops = &snd_pcm_plug_ops;
 	pcm->fast_ops = slave->fast_ops;
 	pcm->fast_op_arg = slave->fast_op_arg;
@@ -1185,12 +1235,12 @@ int snd_pcm_plug_open(snd_pcm_t **pcmp,
 				      (snd_config_t *)rate_converter);
 		if (err < 0) {
 			snd_pcm_free(pcm);
-			free(plug);
 			return err;
 		}
 	}
 	pcm->private_data = plug;
 	pcm->poll_fd = slave->poll_fd;
+	pcm->poll_dynamic = slave->poll_dynamic;
 	pcm->poll_events = slave->poll_events;
 	pcm->mmap_shadow = 1;
 	pcm->tstamp_type = slave->tstamp_type;
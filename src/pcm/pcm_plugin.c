@@ -230,6 +230,32 @@ snd_pcm_sframes_t snd_pcm_plugin_forward(snd_pcm_t *pcm, snd_pcm_uframes_t frame
 	return (snd_pcm_sframes_t) frames;
 }
 
+/*
+ * Process stacked conversions in cache sized tiles.  Committing to a
+ * slave which is itself a conversion plugin runs the next stage over the
+ * committed region right away, so limiting one iteration to a tile lets
+ * the samples flow through all stages of a plug chain while still cache
+ * resident, instead of streaming the full buffer through every stage in
+ * turn.  Direct hardware slaves are left alone - no further pass follows
+ * there.
+ */
+#define PLUGIN_TILE_BYTES	(64 * 1024)
+
+static snd_pcm_uframes_t snd_pcm_plugin_tile_frames(snd_pcm_t *pcm,
+						    snd_pcm_t *slave)
+{
+	unsigned int bits;
+
+	if (slave->type == SND_PCM_TYPE_HW)
+		return ULONG_MAX;
+	bits = pcm->frame_bits;
+	if (slave->frame_bits > bits)
+		bits = slave->frame_bits;
+	if (bits == 0)
+		return ULONG_MAX;
+	return ((snd_pcm_uframes_t)PLUGIN_TILE_BYTES * 8) / bits;
+}
+
 static snd_pcm_sframes_t snd_pcm_plugin_write_areas(snd_pcm_t *pcm,
 						    const snd_pcm_channel_area_t *areas,
 						    snd_pcm_uframes_t offset,
@@ -237,6 +263,7 @@ static snd_pcm_sframes_t snd_pcm_plugin_write_areas(snd_pcm_t *pcm,
 {
 	snd_pcm_plugin_t *plugin = pcm->private_data;
 	snd_pcm_t *slave = plugin->gen.slave;
+	snd_pcm_uframes_t tile = snd_pcm_plugin_tile_frames(pcm, slave);
 	snd_pcm_uframes_t xfer = 0;
 	snd_pcm_sframes_t result;
 	int err;
@@ -246,7 +273,7 @@ static snd_pcm_sframes_t snd_pcm_plugin_write_areas(snd_pcm_t *pcm,
 		const snd_pcm_channel_area_t *slave_areas;
 		snd_pcm_uframes_t slave_offset;
 		snd_pcm_uframes_t slave_frames = ULONG_MAX;
-		
+
 		result = snd_pcm_mmap_begin(slave, &slave_areas, &slave_offset, &slave_frames);
 		if (result < 0) {
 			err = result;
@@ -254,6 +281,8 @@ static snd_pcm_sframes_t snd_pcm_plugin_write_areas(snd_pcm_t *pcm,
 		}
 		if (slave_frames == 0)
 			break;
+		if (slave_frames > tile)
+			slave_frames = tile;
 		frames = plugin->write(pcm, areas, offset, frames,
 				       slave_areas, slave_offset, &slave_frames);
 		if (CHECK_SANITY(slave_frames > snd_pcm_mmap_playback_avail(slave))) {
@@ -294,16 +323,17 @@ static snd_pcm_sframes_t snd_pcm_plugin_read_areas(snd_pcm_t *pcm,
 {
 	snd_pcm_plugin_t *plugin = pcm->private_data;
 	snd_pcm_t *slave = plugin->gen.slave;
+	snd_pcm_uframes_t tile = snd_pcm_plugin_tile_frames(pcm, slave);
 	snd_pcm_uframes_t xfer = 0;
 	snd_pcm_sframes_t result;
 	int err;
-	
+
 	while (size > 0) {
 		snd_pcm_uframes_t frames = size;
 		const snd_pcm_channel_area_t *slave_areas;
 		snd_pcm_uframes_t slave_offset;
 		snd_pcm_uframes_t slave_frames = ULONG_MAX;
-		
+
 		result = snd_pcm_mmap_begin(slave, &slave_areas, &slave_offset, &slave_frames);
 		if (result < 0) {
 			err = result;
@@ -311,6 +341,8 @@ static snd_pcm_sframes_t snd_pcm_plugin_read_areas(snd_pcm_t *pcm,
 		}
 		if (slave_frames == 0)
 			break;
+		if (slave_frames > tile)
+			slave_frames = tile;
 		frames = (plugin->read)(pcm, areas, offset, frames,
 				      slave_areas, slave_offset, &slave_frames);
 		if (CHECK_SANITY(slave_frames > snd_pcm_mmap_capture_avail(slave))) {
@@ -408,6 +440,7 @@ snd_pcm_plugin_mmap_commit(snd_pcm_t *pcm,
 	while (size > 0 && slave_size > 0) {
 		snd_pcm_uframes_t frames = size;
 		snd_pcm_uframes_t cont = pcm->buffer_size - appl_offset;
+		snd_pcm_uframes_t tile = snd_pcm_plugin_tile_frames(pcm, slave);
 		const snd_pcm_channel_area_t *slave_areas;
 		snd_pcm_uframes_t slave_offset;
 		snd_pcm_uframes_t slave_frames = ULONG_MAX;
@@ -418,6 +451,8 @@ snd_pcm_plugin_mmap_commit(snd_pcm_t *pcm,
 			err = result;
 			goto error;
 		}
+		if (slave_frames > tile)
+			slave_frames = tile;
 		if (frames > cont)
 			frames = cont;
 		frames = plugin->write(pcm, areas, appl_offset, frames,
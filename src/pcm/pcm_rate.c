@@ -33,6 +33,9 @@
 #include "plugin_ops.h"
 #include "bswap.h"
 #include <inttypes.h>
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
 
 #if 0
 #define DEBUG_REFINE
@@ -61,8 +64,12 @@ struct _snd_pcm_rate {
 	void *open_func;
 	void *obj;
 	snd_pcm_rate_ops_t ops;
+	int src_conv_type;
+	int dst_conv_type;
 	unsigned int src_conv_idx;
 	unsigned int dst_conv_idx;
+	unsigned int src_lf_idx;
+	unsigned int dst_lf_idx;
 	snd_pcm_channel_area_t *src_buf;
 	snd_pcm_channel_area_t *dst_buf;
 	int start_pending; /* start is triggered but not commited to slave */
@@ -74,28 +81,67 @@ struct _snd_pcm_rate {
 	uint64_t in_formats;
 	uint64_t out_formats;
 	unsigned int format_flags;
+	/* converter state snapshots taken at period boundaries */
+	size_t snap_size;		/* bytes per snapshot, 0 = unsupported */
+	unsigned int snap_slots;	/* ring capacity in periods */
+	unsigned int snap_count;	/* valid snapshots behind last_commit_ptr */
+	unsigned int snap_head;		/* slot receiving the next snapshot */
+	char *snap_buf;
+	int pipeline;			/* pipelined conversion requested */
+#ifdef HAVE_LIBPTHREAD
+	int cthread_started;
+	int cthread_stop;
+	int cvt_state;			/* RATE_PIPE_* */
+	pthread_t cthread;
+	pthread_mutex_t cmutex;
+	pthread_cond_t ccond;
+	snd_pcm_channel_area_t *cvt_pareas; /* staged source period */
+	snd_pcm_channel_area_t *cvt_sareas; /* converted slave period */
+#endif
 };
 
 #define SND_PCM_RATE_PLUGIN_VERSION_OLD	0x010001	/* old rate plugin */
+
+/* pivot buffer conversion types */
+enum {
+	RATE_CONV_LINEAR = 0,	/* linear <-> linear */
+	RATE_CONV_INT_FLOAT,	/* linear -> float */
+	RATE_CONV_FLOAT_INT,	/* float -> linear */
+};
+
+/* pipelined conversion states */
+enum {
+	RATE_PIPE_EMPTY = 0,	/* nothing staged */
+	RATE_PIPE_BUSY,		/* worker converting the staged period */
+	RATE_PIPE_READY,	/* cvt_sareas holds a converted slave period */
+};
 #endif /* DOC_HIDDEN */
 
-/* allocate a channel area and a temporary buffer for the given size */
+/* arena bytes needed by one temporary buffer of the given size */
+static size_t rate_tmp_buf_size(snd_pcm_format_t format,
+				unsigned int channels, unsigned int frames)
+{
+	int width = snd_pcm_format_physical_width(format);
+
+	return SND_PCM_ARENA_SIZE(sizeof(snd_pcm_channel_area_t) * channels) +
+	       SND_PCM_ARENA_SIZE(frames * channels * width / 8);
+}
+
+/* slice a channel area and a temporary buffer from the handle arena */
 static snd_pcm_channel_area_t *
-rate_alloc_tmp_buf(snd_pcm_format_t format,
+rate_alloc_tmp_buf(snd_pcm_t *pcm, snd_pcm_format_t format,
 		   unsigned int channels, unsigned int frames)
 {
 	snd_pcm_channel_area_t *ap;
 	int width = snd_pcm_format_physical_width(format);
 	unsigned int i;
 
-	ap = malloc(sizeof(*ap) * channels);
+	ap = snd_pcm_arena_alloc(pcm, sizeof(*ap) * channels);
 	if (!ap)
 		return NULL;
-	ap->addr = malloc(frames * channels * width / 8);
-	if (!ap->addr) {
-		free(ap);
+	ap->addr = snd_pcm_arena_alloc(pcm, frames * channels * width / 8);
+	if (!ap->addr)
 		return NULL;
-	}
 
 	/* set up in interleaved format */
 	for (i = 0; i < channels; i++) {
@@ -109,13 +155,8 @@ rate_alloc_tmp_buf(snd_pcm_format_t format,
 
 static void rate_free_tmp_buf(snd_pcm_channel_area_t **ptr)
 {
-	snd_pcm_channel_area_t *c = *ptr;
-
-	if (c) {
-		free(c->addr);
-		free(c);
-		*ptr = NULL;
-	}
+	/* arena backed - the block is dropped wholesale at hw_free */
+	*ptr = NULL;
 }
 
 static int snd_pcm_rate_hw_refine_cprepare(snd_pcm_t *pcm ATTRIBUTE_UNUSED, snd_pcm_hw_params_t *params)
@@ -124,6 +165,10 @@ static int snd_pcm_rate_hw_refine_cprepare(snd_pcm_t *pcm ATTRIBUTE_UNUSED, snd_
 	int err;
 	snd_pcm_access_mask_t access_mask = { SND_PCM_ACCBIT_SHM };
 	snd_pcm_format_mask_t format_mask = { SND_PCM_FMTBIT_LINEAR };
+#ifdef BUILD_PCM_PLUGIN_LFLOAT
+	snd_pcm_format_mask_set(&format_mask, SND_PCM_FORMAT_FLOAT_LE);
+	snd_pcm_format_mask_set(&format_mask, SND_PCM_FORMAT_FLOAT_BE);
+#endif
 	err = _snd_pcm_hw_param_set_mask(params, SND_PCM_HW_PARAM_ACCESS,
 					 &access_mask);
 	if (err < 0)
@@ -301,6 +346,18 @@ static int get_best_format(uint64_t mask, snd_pcm_format_t orig)
 			if (snd_pcm_format_signed(f) == signd)
 				score++;
 		}
+#ifdef BUILD_PCM_PLUGIN_LFLOAT
+		else if (snd_pcm_format_float(f) &&
+			 snd_pcm_format_width(f) == 32) {
+			/* full precision for any linear input, still
+			 * losing against an exact linear match */
+			score += 2;
+			if (snd_pcm_format_float(orig))
+				score += 2;
+			if ((snd_pcm_format_t)f == orig)
+				score++;
+		}
+#endif
 		if (score > best_score) {
 			match = f;
 			best_score = score;
@@ -310,6 +367,18 @@ static int get_best_format(uint64_t mask, snd_pcm_format_t orig)
 	return match;
 }
 
+/* mask of all linear formats */
+static uint64_t linear_format_mask(void)
+{
+	uint64_t mask = 0;
+	int f;
+
+	for (f = 0; f <= SND_PCM_FORMAT_LAST; f++)
+		if (snd_pcm_format_linear(f) == 1)
+			mask |= 1ULL << f;
+	return mask;
+}
+
 /* set up the input and output formats from the available lists */
 static int choose_preferred_format(snd_pcm_rate_t *rate)
 {
@@ -317,8 +386,20 @@ static int choose_preferred_format(snd_pcm_rate_t *rate)
 	uint64_t out_mask = rate->out_formats;
 	int in, out;
 
-	if (!in_mask || !out_mask)
-		return 0;
+	/* converters that don't advertise their formats take any linear
+	 * format as before; non-linear formats go through a pivot buffer */
+	if (!in_mask) {
+		if (snd_pcm_format_linear(rate->orig_in_format) == 1)
+			in_mask = 1ULL << rate->orig_in_format;
+		else
+			in_mask = linear_format_mask();
+	}
+	if (!out_mask) {
+		if (snd_pcm_format_linear(rate->orig_out_format) == 1)
+			out_mask = 1ULL << rate->orig_out_format;
+		else
+			out_mask = linear_format_mask();
+	}
 
 	if (rate->orig_in_format == rate->orig_out_format)
 		if (in_mask & out_mask & (1ULL << rate->orig_in_format))
@@ -348,6 +429,88 @@ static int choose_preferred_format(snd_pcm_rate_t *rate)
 	return 0;
 }
 
+/*
+ * Resolve the conversion into or out of the converter's processing
+ * format.  Either side may be a float format, which goes through the
+ * lfloat get/put pairs with an S32 intermediate instead of the plain
+ * linear conversion, so no precision is lost on the way.
+ */
+static int rate_setup_conv(snd_pcm_format_t src, snd_pcm_format_t dst,
+			   int *type, unsigned int *conv_idx,
+			   unsigned int *lf_idx)
+{
+	int src_float = snd_pcm_format_float(src) == 1;
+	int dst_float = snd_pcm_format_float(dst) == 1;
+
+	if (src_float && dst_float) {
+		/* pure endian conversion, copy the raw 32-bit words */
+		if (snd_pcm_format_width(src) != 32 ||
+		    snd_pcm_format_width(dst) != 32)
+			return -EINVAL;
+		src = snd_pcm_format_big_endian(src) ?
+			SND_PCM_FORMAT_S32_BE : SND_PCM_FORMAT_S32_LE;
+		dst = snd_pcm_format_big_endian(dst) ?
+			SND_PCM_FORMAT_S32_BE : SND_PCM_FORMAT_S32_LE;
+		src_float = dst_float = 0;
+	}
+#ifdef BUILD_PCM_PLUGIN_LFLOAT
+	if (src_float) {
+		*type = RATE_CONV_FLOAT_INT;
+		*conv_idx = snd_pcm_linear_put_index(SND_PCM_FORMAT_S32, dst);
+		*lf_idx = snd_pcm_lfloat_get_s32_index(src);
+		return 0;
+	}
+	if (dst_float) {
+		*type = RATE_CONV_INT_FLOAT;
+		*conv_idx = snd_pcm_linear_get_index(src, SND_PCM_FORMAT_S32);
+		*lf_idx = snd_pcm_lfloat_put_s32_index(dst);
+		return 0;
+	}
+#else
+	if (src_float || dst_float)
+		return -EINVAL;
+#endif
+	*type = RATE_CONV_LINEAR;
+	*conv_idx = snd_pcm_linear_convert_index(src, dst);
+	return 0;
+}
+
+static void rate_conv_buf(const snd_pcm_channel_area_t *dst_areas,
+			  snd_pcm_uframes_t dst_offset,
+			  const snd_pcm_channel_area_t *src_areas,
+			  snd_pcm_uframes_t src_offset,
+			  unsigned int channels, snd_pcm_uframes_t frames,
+			  int type, unsigned int conv_idx,
+			  unsigned int lf_idx ATTRIBUTE_UNUSED)
+{
+	switch (type) {
+#ifdef BUILD_PCM_PLUGIN_LFLOAT
+	case RATE_CONV_FLOAT_INT:
+		snd_pcm_lfloat_convert_float_integer(dst_areas, dst_offset,
+						     src_areas, src_offset,
+						     channels, frames,
+						     conv_idx, lf_idx);
+		break;
+	case RATE_CONV_INT_FLOAT:
+		snd_pcm_lfloat_convert_integer_float(dst_areas, dst_offset,
+						     src_areas, src_offset,
+						     channels, frames,
+						     conv_idx, lf_idx);
+		break;
+#endif
+	default:
+		snd_pcm_linear_convert(dst_areas, dst_offset,
+				       src_areas, src_offset,
+				       channels, frames, conv_idx);
+		break;
+	}
+}
+
+#ifdef HAVE_LIBPTHREAD
+static void *snd_pcm_rate_cvt_thread(void *data);
+static void snd_pcm_rate_pipeline_drop(snd_pcm_rate_t *rate);
+#endif
+
 static int snd_pcm_rate_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t * params)
 {
 	snd_pcm_rate_t *rate = pcm->private_data;
@@ -355,6 +518,7 @@ static int snd_pcm_rate_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t * params)
 	snd_pcm_rate_side_info_t *sinfo, *cinfo;
 	unsigned int channels, acc;
 	int need_src_buf, need_dst_buf;
+	size_t total;
 	int err = snd_pcm_hw_params_slave(pcm, params,
 					  snd_pcm_rate_hw_refine_cchange,
 					  snd_pcm_rate_hw_refine_sprepare,
@@ -400,27 +564,13 @@ static int snd_pcm_rate_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t * params)
 		return -EBUSY;
 	}
 
-	rate->pareas = rate_alloc_tmp_buf(cinfo->format, channels,
-					  cinfo->period_size);
-	rate->sareas = rate_alloc_tmp_buf(sinfo->format, channels,
-					  sinfo->period_size);
-	if (!rate->pareas || !rate->sareas) {
-		err = -ENOMEM;
-		goto error_pareas;
-	}
-
 	rate->orig_in_format = rate->info.in.format;
 	rate->orig_out_format = rate->info.out.format;
 	if (choose_preferred_format(rate) < 0) {
 		SNDERR("No matching format in rate plugin");
-		err = -EINVAL;
-		goto error_pareas;
+		return -EINVAL;
 	}
 
-	err = rate->ops.init(rate->obj, &rate->info);
-	if (err < 0)
-		goto error_init;
-
 	rate_free_tmp_buf(&rate->src_buf);
 	rate_free_tmp_buf(&rate->dst_buf);
 
@@ -438,40 +588,139 @@ static int snd_pcm_rate_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t * params)
 	}
 
 	if (need_src_buf) {
-		rate->src_conv_idx =
-			snd_pcm_linear_convert_index(rate->orig_in_format,
-						     rate->info.in.format);
-		rate->src_buf = rate_alloc_tmp_buf(rate->info.in.format,
-						   channels, rate->info.in.period_size);
-		if (!rate->src_buf) {
+		err = rate_setup_conv(rate->orig_in_format,
+				      rate->info.in.format,
+				      &rate->src_conv_type,
+				      &rate->src_conv_idx,
+				      &rate->src_lf_idx);
+		if (err < 0)
+			return err;
+	}
+
+	if (need_dst_buf) {
+		err = rate_setup_conv(rate->info.out.format,
+				      rate->orig_out_format,
+				      &rate->dst_conv_type,
+				      &rate->dst_conv_idx,
+				      &rate->dst_lf_idx);
+		if (err < 0)
+			return err;
+	}
+
+	/* declare the period buffers of this configuration up front and
+	 * back them all with one aligned block
+	 */
+	total = rate_tmp_buf_size(cinfo->format, channels,
+				  cinfo->period_size) +
+		rate_tmp_buf_size(sinfo->format, channels,
+				  sinfo->period_size);
+	if (need_src_buf)
+		total += rate_tmp_buf_size(rate->info.in.format, channels,
+					   rate->info.in.period_size);
+	if (need_dst_buf)
+		total += rate_tmp_buf_size(rate->info.out.format, channels,
+					   rate->info.out.period_size);
+#ifdef HAVE_LIBPTHREAD
+	if (rate->pipeline && pcm->stream == SND_PCM_STREAM_PLAYBACK)
+		total += rate_tmp_buf_size(cinfo->format, channels,
+					   cinfo->period_size) +
+			 rate_tmp_buf_size(sinfo->format, channels,
+					   sinfo->period_size);
+#endif
+	err = snd_pcm_arena_setup(pcm, total);
+	if (err < 0)
+		return err;
+
+	rate->pareas = rate_alloc_tmp_buf(pcm, cinfo->format, channels,
+					  cinfo->period_size);
+	rate->sareas = rate_alloc_tmp_buf(pcm, sinfo->format, channels,
+					  sinfo->period_size);
+	if (need_src_buf)
+		rate->src_buf = rate_alloc_tmp_buf(pcm, rate->info.in.format,
+						   channels,
+						   rate->info.in.period_size);
+	if (need_dst_buf)
+		rate->dst_buf = rate_alloc_tmp_buf(pcm, rate->info.out.format,
+						   channels,
+						   rate->info.out.period_size);
+	if (!rate->pareas || !rate->sareas ||
+	    (need_src_buf && !rate->src_buf) ||
+	    (need_dst_buf && !rate->dst_buf)) {
+		err = -ENOMEM;
+		goto error_bufs;
+	}
+
+	err = rate->ops.init(rate->obj, &rate->info);
+	if (err < 0)
+		goto error;
+
+	/* converter state snapshots enable cheap rewind; the pipelined
+	 * mode owns the converter state on the worker thread, so the
+	 * two are mutually exclusive */
+	rate->snap_size = 0;
+	if (pcm->stream == SND_PCM_STREAM_PLAYBACK &&
+#ifdef HAVE_LIBPTHREAD
+	    !rate->pipeline &&
+#endif
+	    rate->plugin_version >= 0x010004 &&
+	    rate->ops.snapshot_size && rate->ops.snapshot && rate->ops.restore)
+		rate->snap_size = rate->ops.snapshot_size(rate->obj);
+	if (rate->snap_size > 0) {
+		rate->snap_slots = cinfo->buffer_size / cinfo->period_size;
+		rate->snap_buf = malloc(rate->snap_slots * rate->snap_size);
+		if (!rate->snap_buf) {
+			rate->snap_size = 0;
 			err = -ENOMEM;
 			goto error;
 		}
+		rate->snap_head = 0;
+		rate->snap_count = 0;
 	}
 
-	if (need_dst_buf) {
-		rate->dst_conv_idx =
-			snd_pcm_linear_convert_index(rate->info.out.format,
-						     rate->orig_out_format);
-		rate->dst_buf = rate_alloc_tmp_buf(rate->info.out.format,
-						   channels, rate->info.out.period_size);
-		if (!rate->dst_buf) {
+#ifdef HAVE_LIBPTHREAD
+	if (rate->pipeline && pcm->stream == SND_PCM_STREAM_PLAYBACK) {
+		rate->cvt_pareas = rate_alloc_tmp_buf(pcm, cinfo->format,
+						      channels,
+						      cinfo->period_size);
+		rate->cvt_sareas = rate_alloc_tmp_buf(pcm, sinfo->format,
+						      channels,
+						      sinfo->period_size);
+		if (!rate->cvt_pareas || !rate->cvt_sareas) {
 			err = -ENOMEM;
-			goto error;
+			goto error_cvt;
+		}
+		rate->cvt_state = RATE_PIPE_EMPTY;
+		rate->cthread_stop = 0;
+		pthread_mutex_init(&rate->cmutex, NULL);
+		pthread_cond_init(&rate->ccond, NULL);
+		err = pthread_create(&rate->cthread, NULL,
+				     snd_pcm_rate_cvt_thread, pcm);
+		if (err) {
+			pthread_mutex_destroy(&rate->cmutex);
+			pthread_cond_destroy(&rate->ccond);
+			err = -err;
+			goto error_cvt;
 		}
+		rate->cthread_started = 1;
 	}
+#endif
 
 	return 0;
 
+#ifdef HAVE_LIBPTHREAD
+ error_cvt:
+	rate_free_tmp_buf(&rate->cvt_pareas);
+	rate_free_tmp_buf(&rate->cvt_sareas);
+#endif
  error:
-	rate_free_tmp_buf(&rate->src_buf);
-	rate_free_tmp_buf(&rate->dst_buf);
- error_init:
 	if (rate->ops.free)
 		rate->ops.free(rate->obj);
- error_pareas:
+ error_bufs:
+	rate_free_tmp_buf(&rate->src_buf);
+	rate_free_tmp_buf(&rate->dst_buf);
 	rate_free_tmp_buf(&rate->pareas);
 	rate_free_tmp_buf(&rate->sareas);
+	snd_pcm_arena_release(pcm);
 	return err;
 }
 
@@ -479,12 +728,31 @@ static int snd_pcm_rate_hw_free(snd_pcm_t *pcm)
 {
 	snd_pcm_rate_t *rate = pcm->private_data;
 
+#ifdef HAVE_LIBPTHREAD
+	if (rate->cthread_started) {
+		pthread_mutex_lock(&rate->cmutex);
+		rate->cthread_stop = 1;
+		pthread_cond_signal(&rate->ccond);
+		pthread_mutex_unlock(&rate->cmutex);
+		pthread_join(rate->cthread, NULL);
+		rate->cthread_started = 0;
+		rate->cthread_stop = 0;
+		pthread_mutex_destroy(&rate->cmutex);
+		pthread_cond_destroy(&rate->ccond);
+	}
+	rate_free_tmp_buf(&rate->cvt_pareas);
+	rate_free_tmp_buf(&rate->cvt_sareas);
+#endif
+	free(rate->snap_buf);
+	rate->snap_buf = NULL;
+	rate->snap_size = 0;
 	rate_free_tmp_buf(&rate->pareas);
 	rate_free_tmp_buf(&rate->sareas);
 	if (rate->ops.free)
 		rate->ops.free(rate->obj);
 	rate_free_tmp_buf(&rate->src_buf);
 	rate_free_tmp_buf(&rate->dst_buf);
+	snd_pcm_arena_release(pcm);
 	return snd_pcm_hw_free(rate->gen.slave);
 }
 
@@ -560,6 +828,11 @@ static int snd_pcm_rate_init(snd_pcm_t *pcm)
 
 	if (rate->ops.reset)
 		rate->ops.reset(rate->obj);
+#ifdef HAVE_LIBPTHREAD
+	snd_pcm_rate_pipeline_drop(rate);
+#endif
+	rate->snap_head = 0;
+	rate->snap_count = 0;
 	rate->last_commit_ptr = 0;
 	rate->start_pending = 0;
 	return 0;
@@ -575,6 +848,7 @@ static void do_convert(const snd_pcm_channel_area_t *dst_areas,
 	const snd_pcm_channel_area_t *out_areas;
 	snd_pcm_uframes_t out_offset;
 
+	snd_trace3(rate_convert, rate, src_frames, dst_frames);
 	if (rate->dst_buf) {
 		out_areas = rate->dst_buf;
 		out_offset = 0;
@@ -584,10 +858,11 @@ static void do_convert(const snd_pcm_channel_area_t *dst_areas,
 	}
 
 	if (rate->src_buf) {
-		snd_pcm_linear_convert(rate->src_buf, 0,
-				       src_areas, src_offset,
-				       channels, src_frames,
-				       rate->src_conv_idx);
+		rate_conv_buf(rate->src_buf, 0,
+			      src_areas, src_offset,
+			      channels, src_frames,
+			      rate->src_conv_type, rate->src_conv_idx,
+			      rate->src_lf_idx);
 		src_areas = rate->src_buf;
 		src_offset = 0;
 	}
@@ -602,10 +877,11 @@ static void do_convert(const snd_pcm_channel_area_t *dst_areas,
 				      snd_pcm_channel_area_addr(src_areas, src_offset),
 				      src_frames);
 	if (rate->dst_buf)
-		snd_pcm_linear_convert(dst_areas, dst_offset,
-				       rate->dst_buf, 0,
-				       channels, dst_frames,
-				       rate->dst_conv_idx);
+		rate_conv_buf(dst_areas, dst_offset,
+			      rate->dst_buf, 0,
+			      channels, dst_frames,
+			      rate->dst_conv_type, rate->dst_conv_idx,
+			      rate->dst_lf_idx);
 }
 
 static inline void
@@ -745,9 +1021,29 @@ static int snd_pcm_rate_reset(snd_pcm_t *pcm)
 	return 0;
 }
 
-static snd_pcm_sframes_t snd_pcm_rate_rewindable(snd_pcm_t *pcm ATTRIBUTE_UNUSED)
+static snd_pcm_sframes_t snd_pcm_rate_rewindable(snd_pcm_t *pcm)
 {
-	return 0;
+	snd_pcm_rate_t *rate = pcm->private_data;
+	snd_pcm_uframes_t frames;
+	snd_pcm_sframes_t srew;
+	unsigned int periods;
+
+	if (pcm->stream != SND_PCM_STREAM_PLAYBACK)
+		return 0;
+	/* frames not yet committed to the slave are always recallable */
+	frames = pcm_frame_diff(rate->appl_ptr, rate->last_commit_ptr,
+				pcm->boundary);
+	if (!rate->snap_count)
+		return frames;
+	/* committed periods can be recalled as far back as both a
+	 * converter state snapshot and the slave data still exist */
+	srew = snd_pcm_rewindable(rate->gen.slave);
+	if (srew < 0)
+		return frames;
+	periods = srew / rate->gen.slave->period_size;
+	if (periods > rate->snap_count)
+		periods = rate->snap_count;
+	return frames + (snd_pcm_uframes_t)periods * pcm->period_size;
 }
 
 static snd_pcm_sframes_t snd_pcm_rate_forwardable(snd_pcm_t *pcm ATTRIBUTE_UNUSED)
@@ -755,10 +1051,45 @@ static snd_pcm_sframes_t snd_pcm_rate_forwardable(snd_pcm_t *pcm ATTRIBUTE_UNUSE
 	return 0;
 }
 
-static snd_pcm_sframes_t snd_pcm_rate_rewind(snd_pcm_t *pcm ATTRIBUTE_UNUSED,
-                                             snd_pcm_uframes_t frames ATTRIBUTE_UNUSED)
+static snd_pcm_sframes_t snd_pcm_rate_rewind(snd_pcm_t *pcm,
+					     snd_pcm_uframes_t frames)
 {
-        return 0;
+	snd_pcm_rate_t *rate = pcm->private_data;
+	snd_pcm_uframes_t xfer;
+	snd_pcm_sframes_t result;
+
+	if (pcm->stream != SND_PCM_STREAM_PLAYBACK)
+		return 0;
+	xfer = pcm_frame_diff(rate->appl_ptr, rate->last_commit_ptr,
+			      pcm->boundary);
+	if (xfer > frames)
+		xfer = frames;
+	/* step back over committed periods, restoring the converter
+	 * state captured before each of them was converted */
+	while (frames - xfer >= pcm->period_size && rate->snap_count > 0) {
+		result = snd_pcm_rewind(rate->gen.slave,
+					rate->gen.slave->period_size);
+		if (result < 0)
+			break;
+		if ((snd_pcm_uframes_t)result != rate->gen.slave->period_size) {
+			/* the slave couldn't give the whole period back */
+			if (result > 0)
+				snd_pcm_forward(rate->gen.slave, result);
+			break;
+		}
+		rate->snap_head = (rate->snap_head + rate->snap_slots - 1) %
+			rate->snap_slots;
+		rate->snap_count--;
+		rate->ops.restore(rate->obj, rate->snap_buf +
+				  rate->snap_head * rate->snap_size);
+		if (rate->last_commit_ptr < pcm->period_size)
+			rate->last_commit_ptr += pcm->boundary;
+		rate->last_commit_ptr -= pcm->period_size;
+		xfer += pcm->period_size;
+	}
+	if (xfer > 0)
+		snd_pcm_mmap_appl_backward(pcm, xfer);
+	return xfer;
 }
 
 static snd_pcm_sframes_t snd_pcm_rate_forward(snd_pcm_t *pcm ATTRIBUTE_UNUSED,
@@ -767,6 +1098,72 @@ static snd_pcm_sframes_t snd_pcm_rate_forward(snd_pcm_t *pcm ATTRIBUTE_UNUSED,
         return 0;
 }
 
+/* copy a prepared slave period from areas to the slave buffer, in up
+ * to two fragments; returns 1 when all slave_size frames were
+ * committed, 0 after an incomplete commit (already rewound), or a
+ * negative error code */
+static int snd_pcm_rate_push_slave_area(snd_pcm_t *pcm, snd_pcm_rate_t *rate,
+					const snd_pcm_channel_area_t *areas,
+					snd_pcm_uframes_t slave_size)
+{
+	const snd_pcm_channel_area_t *slave_areas;
+	snd_pcm_uframes_t slave_offset, cont, xfer;
+	snd_pcm_uframes_t slave_frames = ULONG_MAX;
+	snd_pcm_sframes_t result;
+
+	/* ok, commit first fragment */
+	result = snd_pcm_mmap_begin(rate->gen.slave, &slave_areas, &slave_offset, &slave_frames);
+	if (result < 0)
+		return result;
+	cont = slave_frames;
+	if (cont > slave_size)
+		cont = slave_size;
+	snd_pcm_areas_copy(slave_areas, slave_offset,
+			   areas, 0,
+			   pcm->channels, cont,
+			   rate->gen.slave->format);
+	result = snd_pcm_mmap_commit(rate->gen.slave, slave_offset, cont);
+	if (result < (snd_pcm_sframes_t)cont) {
+		if (result < 0)
+			return result;
+		result = snd_pcm_rewind(rate->gen.slave, result);
+		if (result < 0)
+			return result;
+		return 0;
+	}
+	xfer = cont;
+
+	if (xfer == slave_size)
+		return 1;
+
+	/* commit second fragment */
+	cont = slave_size - cont;
+	slave_frames = cont;
+	result = snd_pcm_mmap_begin(rate->gen.slave, &slave_areas, &slave_offset, &slave_frames);
+	if (result < 0)
+		return result;
+#if 0
+	if (slave_offset) {
+		SNDERR("non-zero slave_offset %ld", slave_offset);
+		return -EIO;
+	}
+#endif
+	snd_pcm_areas_copy(slave_areas, slave_offset,
+			   areas, xfer,
+			   pcm->channels, cont,
+			   rate->gen.slave->format);
+	result = snd_pcm_mmap_commit(rate->gen.slave, slave_offset, cont);
+	if (result < (snd_pcm_sframes_t)cont) {
+		if (result < 0)
+			return result;
+		result = snd_pcm_rewind(rate->gen.slave, result + xfer);
+		if (result < 0)
+			return result;
+		return 0;
+	}
+	return 1;
+}
+
 static int snd_pcm_rate_commit_area(snd_pcm_t *pcm, snd_pcm_rate_t *rate,
 				    snd_pcm_uframes_t appl_offset,
 				    snd_pcm_uframes_t size ATTRIBUTE_UNUSED,
@@ -775,7 +1172,7 @@ static int snd_pcm_rate_commit_area(snd_pcm_t *pcm, snd_pcm_rate_t *rate,
 	snd_pcm_uframes_t cont = pcm->buffer_size - appl_offset;
 	const snd_pcm_channel_area_t *areas;
 	const snd_pcm_channel_area_t *slave_areas;
-	snd_pcm_uframes_t slave_offset, xfer;
+	snd_pcm_uframes_t slave_offset;
 	snd_pcm_uframes_t slave_frames = ULONG_MAX;
 	snd_pcm_sframes_t result;
 
@@ -794,7 +1191,12 @@ static int snd_pcm_rate_commit_area(snd_pcm_t *pcm, snd_pcm_rate_t *rate,
 		 */
 		if (slave_frames < rate->gen.slave->period_size) {
 			snd_pcm_rate_write_areas1(pcm, areas, appl_offset, rate->sareas, 0);
-			goto __partial;
+			result = snd_pcm_rate_push_slave_area(pcm, rate,
+							      rate->sareas,
+							      slave_size);
+			if (result <= 0)
+				return result;
+			goto commit_done;
 		}
 		snd_pcm_rate_write_areas1(pcm, areas, appl_offset,
 					  slave_areas, slave_offset);
@@ -820,60 +1222,111 @@ static int snd_pcm_rate_commit_area(snd_pcm_t *pcm, snd_pcm_rate_t *rate,
 
 		snd_pcm_rate_write_areas1(pcm, rate->pareas, 0, rate->sareas, 0);
 
-		/* ok, commit first fragment */
-		result = snd_pcm_mmap_begin(rate->gen.slave, &slave_areas, &slave_offset, &slave_frames);
-		if (result < 0)
+		result = snd_pcm_rate_push_slave_area(pcm, rate, rate->sareas,
+						      slave_size);
+		if (result <= 0)
 			return result;
-	      __partial:
-		cont = slave_frames;
-		if (cont > slave_size)
-			cont = slave_size;
-		snd_pcm_areas_copy(slave_areas, slave_offset,
-				   rate->sareas, 0,
-				   pcm->channels, cont,
-				   rate->gen.slave->format);
-		result = snd_pcm_mmap_commit(rate->gen.slave, slave_offset, cont);
-		if (result < (snd_pcm_sframes_t)cont) {
-			if (result < 0)
-				return result;
-			result = snd_pcm_rewind(rate->gen.slave, result);
-			if (result < 0)
-				return result;
-			return 0;
-		}
-		xfer = cont;
+	}
 
-		if (xfer == slave_size)
-			goto commit_done;
-		
-		/* commit second fragment */
-		cont = slave_size - cont;
-		slave_frames = cont;
-		result = snd_pcm_mmap_begin(rate->gen.slave, &slave_areas, &slave_offset, &slave_frames);
-		if (result < 0)
-			return result;
-#if 0
-		if (slave_offset) {
-			SNDERR("non-zero slave_offset %ld", slave_offset);
-			return -EIO;
+ commit_done:
+	if (rate->start_pending) {
+		/* we have pending start-trigger.  let's issue it now */
+		snd_pcm_start(rate->gen.slave);
+		rate->start_pending = 0;
+	}
+	return 1;
+}
+
+#ifdef HAVE_LIBPTHREAD
+/* worker thread for the pipelined mode: converts the staged source
+ * period into cvt_sareas while the application fills the next one */
+static void *snd_pcm_rate_cvt_thread(void *data)
+{
+	snd_pcm_t *pcm = data;
+	snd_pcm_rate_t *rate = pcm->private_data;
+
+	pthread_mutex_lock(&rate->cmutex);
+	while (!rate->cthread_stop) {
+		if (rate->cvt_state != RATE_PIPE_BUSY) {
+			pthread_cond_wait(&rate->ccond, &rate->cmutex);
+			continue;
 		}
-#endif
-		snd_pcm_areas_copy(slave_areas, slave_offset,
-				   rate->sareas, xfer,
+		pthread_mutex_unlock(&rate->cmutex);
+		do_convert(rate->cvt_sareas, 0, rate->gen.slave->period_size,
+			   rate->cvt_pareas, 0, pcm->period_size,
+			   pcm->channels, rate);
+		pthread_mutex_lock(&rate->cmutex);
+		rate->cvt_state = RATE_PIPE_READY;
+		pthread_cond_signal(&rate->ccond);
+	}
+	pthread_mutex_unlock(&rate->cmutex);
+	return NULL;
+}
+
+/* wait until the worker has finished the staged conversion;
+ * called with cmutex held */
+static void snd_pcm_rate_cvt_wait(snd_pcm_rate_t *rate)
+{
+	while (rate->cvt_state == RATE_PIPE_BUSY)
+		pthread_cond_wait(&rate->ccond, &rate->cmutex);
+}
+
+/* pipelined variant of the period commit: push the previously
+ * converted period (or one slave period of silence right after a
+ * prepare) to the slave, then stage the new source period for the
+ * worker thread; the conversion overlaps the application filling
+ * the next period, at the deterministic cost of one slave period of
+ * extra latency */
+static int snd_pcm_rate_commit_pipelined(snd_pcm_t *pcm, snd_pcm_rate_t *rate,
+					 snd_pcm_uframes_t appl_offset)
+{
+	const snd_pcm_channel_area_t *areas;
+	snd_pcm_uframes_t cont;
+	int result;
+
+	pthread_mutex_lock(&rate->cmutex);
+	snd_pcm_rate_cvt_wait(rate);
+	if (rate->cvt_state == RATE_PIPE_READY) {
+		result = snd_pcm_rate_push_slave_area(pcm, rate,
+						      rate->cvt_sareas,
+						      rate->gen.slave->period_size);
+	} else {
+		/* prime the pipeline with one period of silence */
+		snd_pcm_areas_silence(rate->sareas, 0, pcm->channels,
+				      rate->gen.slave->period_size,
+				      rate->gen.slave->format);
+		result = snd_pcm_rate_push_slave_area(pcm, rate, rate->sareas,
+						      rate->gen.slave->period_size);
+	}
+	if (result <= 0) {
+		/* keep the staged data for the retry */
+		pthread_mutex_unlock(&rate->cmutex);
+		return result;
+	}
+
+	/* stage the new source period; the application may overwrite
+	 * its buffer as soon as we return, so take a copy */
+	areas = snd_pcm_mmap_areas(pcm);
+	cont = pcm->buffer_size - appl_offset;
+	if (cont >= pcm->period_size) {
+		snd_pcm_areas_copy(rate->cvt_pareas, 0,
+				   areas, appl_offset,
+				   pcm->channels, pcm->period_size,
+				   pcm->format);
+	} else {
+		snd_pcm_areas_copy(rate->cvt_pareas, 0,
+				   areas, appl_offset,
 				   pcm->channels, cont,
-				   rate->gen.slave->format);
-		result = snd_pcm_mmap_commit(rate->gen.slave, slave_offset, cont);
-		if (result < (snd_pcm_sframes_t)cont) {
-			if (result < 0)
-				return result;
-			result = snd_pcm_rewind(rate->gen.slave, result + xfer);
-			if (result < 0)
-				return result;
-			return 0;
-		}
+				   pcm->format);
+		snd_pcm_areas_copy(rate->cvt_pareas, cont,
+				   areas, 0,
+				   pcm->channels, pcm->period_size - cont,
+				   pcm->format);
 	}
+	rate->cvt_state = RATE_PIPE_BUSY;
+	pthread_cond_signal(&rate->ccond);
+	pthread_mutex_unlock(&rate->cmutex);
 
- commit_done:
 	if (rate->start_pending) {
 		/* we have pending start-trigger.  let's issue it now */
 		snd_pcm_start(rate->gen.slave);
@@ -882,12 +1335,81 @@ static int snd_pcm_rate_commit_area(snd_pcm_t *pcm, snd_pcm_rate_t *rate,
 	return 1;
 }
 
+/* push out the period still sitting in the pipeline so that the
+ * remaining data is committed behind it; called with the pcm lock
+ * held at the start of a playback drain */
+static int snd_pcm_rate_pipeline_flush(snd_pcm_t *pcm, snd_pcm_rate_t *rate)
+{
+	int err = 0, pushed = 0;
+
+	if (!rate->cthread_started)
+		return 0;
+	pthread_mutex_lock(&rate->cmutex);
+	snd_pcm_rate_cvt_wait(rate);
+	while (rate->cvt_state == RATE_PIPE_READY) {
+		err = snd_pcm_rate_push_slave_area(pcm, rate, rate->cvt_sareas,
+						   rate->gen.slave->period_size);
+		if (err > 0) {
+			rate->cvt_state = RATE_PIPE_EMPTY;
+			err = 0;
+			pushed = 1;
+			break;
+		}
+		if (err < 0)
+			break;
+		if (pcm->mode & SND_PCM_NONBLOCK) {
+			err = -EAGAIN;
+			break;
+		}
+		err = __snd_pcm_wait_in_lock(rate->gen.slave, SND_PCM_WAIT_DRAIN);
+		if (err < 0)
+			break;
+	}
+	pthread_mutex_unlock(&rate->cmutex);
+	if (pushed && rate->start_pending) {
+		/* we have pending start-trigger.  let's issue it now */
+		snd_pcm_start(rate->gen.slave);
+		rate->start_pending = 0;
+	}
+	return err;
+}
+
+/* forget the staged period after a prepare or reset */
+static void snd_pcm_rate_pipeline_drop(snd_pcm_rate_t *rate)
+{
+	if (!rate->cthread_started)
+		return;
+	pthread_mutex_lock(&rate->cmutex);
+	snd_pcm_rate_cvt_wait(rate);
+	rate->cvt_state = RATE_PIPE_EMPTY;
+	pthread_mutex_unlock(&rate->cmutex);
+}
+#endif /* HAVE_LIBPTHREAD */
+
 static int snd_pcm_rate_commit_next_period(snd_pcm_t *pcm, snd_pcm_uframes_t appl_offset)
 {
 	snd_pcm_rate_t *rate = pcm->private_data;
+	int result;
 
-	return snd_pcm_rate_commit_area(pcm, rate, appl_offset, pcm->period_size,
-					rate->gen.slave->period_size);
+#ifdef HAVE_LIBPTHREAD
+	if (rate->cthread_started)
+		return snd_pcm_rate_commit_pipelined(pcm, rate, appl_offset);
+#endif
+	/* capture the converter state at this period boundary; the slot
+	 * is kept only when the whole period goes out, so the ring
+	 * always holds the states right behind last_commit_ptr */
+	if (rate->snap_buf)
+		rate->ops.snapshot(rate->obj, rate->snap_buf +
+				   rate->snap_head * rate->snap_size);
+	result = snd_pcm_rate_commit_area(pcm, rate, appl_offset,
+					  pcm->period_size,
+					  rate->gen.slave->period_size);
+	if (result == 1 && rate->snap_buf) {
+		rate->snap_head = (rate->snap_head + 1) % rate->snap_slots;
+		if (rate->snap_count < rate->snap_slots)
+			rate->snap_count++;
+	}
+	return result;
 }
 
 static int snd_pcm_rate_grab_next_period(snd_pcm_t *pcm, snd_pcm_uframes_t hw_offset)
@@ -1139,12 +1661,23 @@ static int snd_pcm_rate_drain(snd_pcm_t *pcm)
 		sw_params.avail_min = 1;
 		snd_pcm_sw_params(rate->gen.slave, &sw_params);
 
+#ifdef HAVE_LIBPTHREAD
+		/* the pipeline holds the oldest uncommitted period;
+		 * push it out before the remaining data */
+		commit_err = snd_pcm_rate_pipeline_flush(pcm, rate);
+#endif
+
+		/* the commits below go past the snapshot ring */
+		rate->snap_count = 0;
+
 		size = pcm_frame_diff(rate->appl_ptr, rate->last_commit_ptr, pcm->boundary);
 		ofs = rate->last_commit_ptr % pcm->buffer_size;
 		while (size > 0) {
 			snd_pcm_uframes_t psize, spsize;
 			int err;
 
+			if (commit_err < 0)
+				break;
 			err = __snd_pcm_wait_in_lock(rate->gen.slave, SND_PCM_WAIT_DRAIN);
 			if (err < 0)
 				break;
@@ -1395,11 +1928,12 @@ static void rate_initial_setup(snd_pcm_rate_t *rate)
 #ifdef PIC
 static int is_builtin_plugin(const char *type)
 {
-	return strcmp(type, "linear") == 0;
+	return strcmp(type, "linear") == 0 ||
+	       strcmp(type, "polyphase") == 0;
 }
 
 static const char *const default_rate_plugins[] = {
-	"speexrate", "linear", NULL
+	"speexrate", "polyphase", "linear", NULL
 };
 
 static int rate_open_func(snd_pcm_rate_t *rate, const char *type, const snd_config_t *converter_conf, int verbose)
@@ -1508,12 +2042,14 @@ int snd_pcm_rate_open(snd_pcm_t **pcmp, const char *name,
 
 	assert(pcmp && slave);
 	if (sformat != SND_PCM_FORMAT_UNKNOWN &&
-	    snd_pcm_format_linear(sformat) != 1)
+	    snd_pcm_format_linear(sformat) != 1 &&
+	    snd_pcm_format_float(sformat) != 1)
 		return -EINVAL;
-	rate = calloc(1, sizeof(snd_pcm_rate_t));
-	if (!rate) {
-		return -ENOMEM;
-	}
+	err = snd_pcm_new_priv(&pcm, SND_PCM_TYPE_RATE, name, slave->stream,
+			       slave->mode, sizeof(snd_pcm_rate_t),
+			       (void **)&rate);
+	if (err < 0)
+		return err;
 	rate->gen.slave = slave;
 	rate->gen.close_slave = close_slave;
 	rate->srate = srate;
@@ -1523,12 +2059,6 @@ int snd_pcm_rate_open(snd_pcm_t **pcmp, const char *name,
 	rate->rate_max = SND_PCM_PLUGIN_RATE_MAX;
 	rate->plugin_version = SND_PCM_RATE_PLUGIN_VERSION;
 
-	err = snd_pcm_new(&pcm, SND_PCM_TYPE_RATE, name, slave->stream, slave->mode);
-	if (err < 0) {
-		free(rate);
-		return err;
-	}
-
 #ifdef PIC
 	err = -ENOENT;
 	if (!converter) {
@@ -1567,20 +2097,17 @@ int snd_pcm_rate_open(snd_pcm_t **pcmp, const char *name,
 		if (!type) {
 			SNDERR("No name given for rate converter");
 			snd_pcm_free(pcm);
-			free(rate);
 			return -EINVAL;
 		}
 		err = rate_open_func(rate, type, converter, 1);
 	} else {
 		SNDERR("Invalid type for rate converter");
 		snd_pcm_free(pcm);
-		free(rate);
 		return -EINVAL;
 	}
 	if (err < 0) {
 		SNDERR("Cannot find rate converter");
 		snd_pcm_free(pcm);
-		free(rate);
 		return -ENOENT;
 	}
 #else
@@ -1589,7 +2116,6 @@ int snd_pcm_rate_open(snd_pcm_t **pcmp, const char *name,
 	err = open_func(SND_PCM_RATE_PLUGIN_VERSION, &rate->obj, &rate->ops);
 	if (err < 0) {
 		snd_pcm_free(pcm);
-		free(rate);
 		return err;
 	}
 #endif
@@ -1598,7 +2124,6 @@ int snd_pcm_rate_open(snd_pcm_t **pcmp, const char *name,
 	    ! rate->ops.input_frames || ! rate->ops.output_frames) {
 		SNDERR("Inproper rate plugin %s initialization", type);
 		snd_pcm_free(pcm);
-		free(rate);
 		return err;
 	}
 
@@ -1608,6 +2133,7 @@ int snd_pcm_rate_open(snd_pcm_t **pcmp, const char *name,
 	pcm->fast_ops = &snd_pcm_rate_fast_ops;
 	pcm->private_data = rate;
 	pcm->poll_fd = slave->poll_fd;
+	pcm->poll_dynamic = slave->poll_dynamic;
 	pcm->poll_events = slave->poll_events;
 	pcm->mmap_rw = 1;
 	pcm->tstamp_type = slave->tstamp_type;
@@ -1622,7 +2148,10 @@ int snd_pcm_rate_open(snd_pcm_t **pcmp, const char *name,
 
 \section pcm_plugins_rate Plugin: Rate
 
-This plugin converts a stream rate. The input and output formats must be linear.
+This plugin converts a stream rate. The input and output formats must be
+linear or 32-bit float; samples are carried to and from the rate converter
+at full precision, using an S32 or float intermediate buffer when the
+converter processes a different format.
 
 \code
 pcm.name {
@@ -1646,9 +2175,17 @@ pcm.name {
 		name STR	# Convertor type
 		xxx yyy		# optional convertor-specific configuration
 	}
+	pipeline BOOL		# convert each period on a worker thread,
+				# one period ahead of the application
+				# (playback only; adds one period latency)
 }
 \endcode
 
+Two converters are built in: \c polyphase, a windowed-sinc polyphase
+resampler working on S16 and S32 data, and \c linear, the low-quality
+linear interpolator.  Other converters are loaded from external plugin
+libraries.
+
 \subsection pcm_plugins_rate_funcref Function reference
 
 <UL>
@@ -1681,6 +2218,7 @@ int _snd_pcm_rate_open(snd_pcm_t **pcmp, const char *name,
 	snd_config_t *slave = NULL, *sconf;
 	snd_pcm_format_t sformat = SND_PCM_FORMAT_UNKNOWN;
 	int srate = -1;
+	int pipeline = 0;
 	const snd_config_t *converter = NULL;
 
 	snd_config_for_each(i, next, conf) {
@@ -1698,6 +2236,15 @@ int _snd_pcm_rate_open(snd_pcm_t **pcmp, const char *name,
 			converter = n;
 			continue;
 		}
+		if (strcmp(id, "pipeline") == 0) {
+			err = snd_config_get_bool(n);
+			if (err < 0) {
+				SNDERR("Invalid type for %s", id);
+				return -EINVAL;
+			}
+			pipeline = err;
+			continue;
+		}
 		SNDERR("Unknown field %s", id);
 		return -EINVAL;
 	}
@@ -1712,9 +2259,10 @@ int _snd_pcm_rate_open(snd_pcm_t **pcmp, const char *name,
 	if (err < 0)
 		return err;
 	if (sformat != SND_PCM_FORMAT_UNKNOWN &&
-	    snd_pcm_format_linear(sformat) != 1) {
+	    snd_pcm_format_linear(sformat) != 1 &&
+	    snd_pcm_format_float(sformat) != 1) {
 	    	snd_config_delete(sconf);
-		SNDERR("slave format is not linear");
+		SNDERR("slave format is not linear nor float");
 		return -EINVAL;
 	}
 	err = snd_pcm_open_slave(&spcm, root, sconf, stream, mode, conf);
@@ -1723,9 +2271,12 @@ int _snd_pcm_rate_open(snd_pcm_t **pcmp, const char *name,
 		return err;
 	err = snd_pcm_rate_open(pcmp, name, sformat, (unsigned int) srate,
 				converter, spcm, 1);
-	if (err < 0)
+	if (err < 0) {
 		snd_pcm_close(spcm);
-	return err;
+		return err;
+	}
+	((snd_pcm_rate_t *)(*pcmp)->private_data)->pipeline = pipeline;
+	return 0;
 }
 #ifndef DOC_HIDDEN
 SND_DLSYM_BUILD_VERSION(_snd_pcm_rate_open, SND_PCM_DLSYM_VERSION);
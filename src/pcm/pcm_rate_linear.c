@@ -404,6 +404,29 @@ static void linear_close(void *obj)
 	free(obj);
 }
 
+static size_t linear_snapshot_size(void *obj)
+{
+	struct rate_linear *rate = obj;
+
+	return sizeof(*rate->old_sample) * rate->channels;
+}
+
+static void linear_snapshot(void *obj, void *buf)
+{
+	struct rate_linear *rate = obj;
+
+	memcpy(buf, rate->old_sample,
+	       sizeof(*rate->old_sample) * rate->channels);
+}
+
+static void linear_restore(void *obj, const void *buf)
+{
+	struct rate_linear *rate = obj;
+
+	memcpy(rate->old_sample, buf,
+	       sizeof(*rate->old_sample) * rate->channels);
+}
+
 static int get_supported_rates(ATTRIBUTE_UNUSED void *rate,
 			       unsigned int *rate_min, unsigned int *rate_max)
 {
@@ -429,6 +452,9 @@ static const snd_pcm_rate_ops_t linear_ops = {
 	.version = SND_PCM_RATE_PLUGIN_VERSION,
 	.get_supported_rates = get_supported_rates,
 	.dump = linear_dump,
+	.snapshot_size = linear_snapshot_size,
+	.snapshot = linear_snapshot,
+	.restore = linear_restore,
 };
 
 int SND_PCM_RATE_PLUGIN_ENTRY(linear) (ATTRIBUTE_UNUSED unsigned int version,
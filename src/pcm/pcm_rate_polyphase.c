@@ -0,0 +1,444 @@
+/*
+ *  Polyphase windowed-sinc rate converter plugin
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 2.1 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <math.h>
+#include "pcm_local.h"
+#include "pcm_plugin.h"
+#include "pcm_rate.h"
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#define POLY_SIMD
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define POLY_SIMD
+#endif
+
+/* needs to be large enough to handle resampling from 768000 -> 8000 */
+#define POLY_DIV_SHIFT		19
+#define POLY_DIV		(1 << POLY_DIV_SHIFT)
+
+#define POLY_PHASES		128	/* fractional sub-phases of the bank */
+#define POLY_BASE_TAPS		64	/* taps per phase for upsampling */
+#define POLY_MAX_STRETCH	4	/* tap stretch cap when downsampling */
+#define POLY_CUTOFF		0.92	/* passband fraction of the narrower Nyquist */
+#define POLY_KAISER_BETA	9.0	/* ~80 dB stopband */
+
+struct rate_polyphase {
+	unsigned int channels;
+	snd_pcm_format_t format;	/* in == out, S16 or S32 */
+	unsigned int in_rate, out_rate;
+	unsigned int pitch;
+	unsigned int taps;		/* filter taps per phase */
+	float *filter;			/* (POLY_PHASES + 1) phases x taps */
+	float *hist;			/* per channel: taps - 1 input samples */
+	float *line;			/* scratch: history + one input period */
+	unsigned int line_size;		/* capacity of line in frames */
+};
+
+static snd_pcm_uframes_t input_frames(void *obj, snd_pcm_uframes_t frames)
+{
+	struct rate_polyphase *rate = obj;
+	if (frames == 0)
+		return 0;
+	return muldiv_near(frames, POLY_DIV, rate->pitch);
+}
+
+static snd_pcm_uframes_t output_frames(void *obj, snd_pcm_uframes_t frames)
+{
+	struct rate_polyphase *rate = obj;
+	if (frames == 0)
+		return 0;
+	return muldiv_near(frames, rate->pitch, POLY_DIV);
+}
+
+static double bessel_i0(double x)
+{
+	double sum = 1.0, term = 1.0;
+	int k;
+
+	for (k = 1; k < 64; k++) {
+		term *= (x * x) / (4.0 * (double)k * k);
+		sum += term;
+		if (term < sum * 1e-12)
+			break;
+	}
+	return sum;
+}
+
+/*
+ * Build the coefficient bank: POLY_PHASES + 1 Kaiser-windowed sinc
+ * filters, phase p holding the taps for a fractional position of
+ * p / POLY_PHASES between two input samples.  The extra phase allows
+ * linear interpolation between adjacent phases without wrapping.
+ * Each phase is normalized to unity DC gain.
+ */
+static int poly_build_filter(struct rate_polyphase *rate)
+{
+	double fc, delay, i0_beta;
+	unsigned int p, k;
+	float *coefs;
+
+	rate->filter = malloc((POLY_PHASES + 1) * rate->taps * sizeof(float));
+	if (!rate->filter)
+		return -ENOMEM;
+
+	/* cycles per input sample; scale below the output Nyquist when
+	 * downsampling */
+	fc = 0.5 * POLY_CUTOFF;
+	if (rate->out_rate < rate->in_rate)
+		fc = fc * rate->out_rate / rate->in_rate;
+	delay = rate->taps / 2;
+	i0_beta = bessel_i0(POLY_KAISER_BETA);
+
+	for (p = 0; p <= POLY_PHASES; p++) {
+		double u = (double)p / POLY_PHASES;
+		double sum = 0.0;
+
+		coefs = rate->filter + p * rate->taps;
+		for (k = 0; k < rate->taps; k++) {
+			/* time distance between the output position and
+			 * the input sample this tap weights */
+			double x = (double)(rate->taps - 1) + u - k - delay;
+			double s = 2.0 * fc * x * M_PI;
+			double w, win;
+
+			win = 1.0 - (x / delay) * (x / delay);
+			if (win <= 0.0) {
+				coefs[k] = 0.0f;
+				continue;
+			}
+			w = (s == 0.0) ? 2.0 * fc : 2.0 * fc * sin(s) / s;
+			w *= bessel_i0(POLY_KAISER_BETA * sqrt(win)) / i0_beta;
+			coefs[k] = w;
+			sum += w;
+		}
+		for (k = 0; k < rate->taps; k++)
+			coefs[k] /= sum;
+	}
+	return 0;
+}
+
+/*
+ * Dot product of the input line against two adjacent phases of the
+ * bank, linearly interpolated; taps is a multiple of 4.
+ */
+static inline float poly_dot(const float *x, const float *c0, const float *c1,
+			     float frac, unsigned int taps)
+{
+	float d0, d1;
+	unsigned int k;
+
+#if defined(__SSE__)
+	__m128 a0 = _mm_setzero_ps();
+	__m128 a1 = _mm_setzero_ps();
+
+	for (k = 0; k < taps; k += 4) {
+		__m128 v = _mm_loadu_ps(x + k);
+#ifdef __FMA__
+		a0 = _mm_fmadd_ps(v, _mm_loadu_ps(c0 + k), a0);
+		a1 = _mm_fmadd_ps(v, _mm_loadu_ps(c1 + k), a1);
+#else
+		a0 = _mm_add_ps(a0, _mm_mul_ps(v, _mm_loadu_ps(c0 + k)));
+		a1 = _mm_add_ps(a1, _mm_mul_ps(v, _mm_loadu_ps(c1 + k)));
+#endif
+	}
+	a0 = _mm_add_ps(a0, _mm_movehl_ps(a0, a0));
+	a0 = _mm_add_ss(a0, _mm_shuffle_ps(a0, a0, 1));
+	a1 = _mm_add_ps(a1, _mm_movehl_ps(a1, a1));
+	a1 = _mm_add_ss(a1, _mm_shuffle_ps(a1, a1, 1));
+	d0 = _mm_cvtss_f32(a0);
+	d1 = _mm_cvtss_f32(a1);
+#elif defined(__aarch64__)
+	float32x4_t a0 = vdupq_n_f32(0);
+	float32x4_t a1 = vdupq_n_f32(0);
+
+	for (k = 0; k < taps; k += 4) {
+		float32x4_t v = vld1q_f32(x + k);
+		a0 = vfmaq_f32(a0, v, vld1q_f32(c0 + k));
+		a1 = vfmaq_f32(a1, v, vld1q_f32(c1 + k));
+	}
+	d0 = vaddvq_f32(a0);
+	d1 = vaddvq_f32(a1);
+#else
+	d0 = d1 = 0.0f;
+	for (k = 0; k < taps; k++) {
+		d0 += x[k] * c0[k];
+		d1 += x[k] * c1[k];
+	}
+#endif
+	return d0 + frac * (d1 - d0);
+}
+
+static void poly_convert(void *obj,
+			 const snd_pcm_channel_area_t *dst_areas,
+			 snd_pcm_uframes_t dst_offset, unsigned int dst_frames,
+			 const snd_pcm_channel_area_t *src_areas,
+			 snd_pcm_uframes_t src_offset, unsigned int src_frames)
+{
+	struct rate_polyphase *rate = obj;
+	unsigned int hist_len = rate->taps - 1;
+	unsigned int channel, i, j;
+
+	if (CHECK_SANITY(src_frames > rate->line_size)) {
+		SNDMSG("src_frames overflow %u > %u",
+		       src_frames, rate->line_size);
+		return;
+	}
+
+	for (channel = 0; channel < rate->channels; ++channel) {
+		const snd_pcm_channel_area_t *src_area = &src_areas[channel];
+		const snd_pcm_channel_area_t *dst_area = &dst_areas[channel];
+		float *hist = rate->hist + channel * hist_len;
+		float *line = rate->line;
+		const char *src;
+		char *dst;
+		int src_step, dst_step;
+		unsigned int idx = 0, acc = 0;
+
+		src = snd_pcm_channel_area_addr(src_area, src_offset);
+		dst = snd_pcm_channel_area_addr(dst_area, dst_offset);
+		src_step = snd_pcm_channel_area_step(src_area);
+		dst_step = snd_pcm_channel_area_step(dst_area);
+
+		memcpy(line, hist, hist_len * sizeof(float));
+		if (rate->format == SND_PCM_FORMAT_S16) {
+			for (i = 0; i < src_frames; i++)
+				line[hist_len + i] = (float)*(const int16_t *)(src + (size_t)i * src_step) *
+					(1.0f / 0x8000);
+		} else {
+			for (i = 0; i < src_frames; i++)
+				line[hist_len + i] = (float)*(const int32_t *)(src + (size_t)i * src_step) *
+					(1.0f / 0x80000000u);
+		}
+
+		/*
+		 * Exact rational stepping: each output advances the
+		 * input position by src_frames / dst_frames, so after
+		 * dst_frames outputs exactly src_frames inputs are
+		 * consumed and the remainder returns to zero - the
+		 * bank phase never drifts between periods.
+		 */
+		for (j = 0; j < dst_frames; j++) {
+			uint64_t pp = (uint64_t)acc * POLY_PHASES;
+			unsigned int p = pp / dst_frames;
+			float frac = (float)(pp - (uint64_t)p * dst_frames) /
+				(float)dst_frames;
+			const float *c0 = rate->filter + p * rate->taps;
+			float v = poly_dot(line + idx, c0, c0 + rate->taps,
+					   frac, rate->taps);
+
+			if (rate->format == SND_PCM_FORMAT_S16) {
+				long d = lrintf(v * 0x8000);
+				if (d > 0x7fff)
+					d = 0x7fff;
+				else if (d < -0x8000)
+					d = -0x8000;
+				*(int16_t *)(dst + (size_t)j * dst_step) = d;
+			} else {
+				double d = (double)v * 0x80000000u;
+				if (d >= 2147483647.0)
+					d = 2147483647.0;
+				else if (d < -2147483648.0)
+					d = -2147483648.0;
+				*(int32_t *)(dst + (size_t)j * dst_step) = lrint(d);
+			}
+
+			acc += src_frames;
+			idx += acc / dst_frames;
+			acc %= dst_frames;
+		}
+
+		memcpy(hist, line + src_frames, hist_len * sizeof(float));
+	}
+}
+
+static int poly_init(void *obj, snd_pcm_rate_info_t *info)
+{
+	struct rate_polyphase *rate = obj;
+	unsigned int stretch;
+	int err;
+
+	rate->channels = info->channels;
+	rate->format = info->in.format;
+	rate->in_rate = info->in.rate;
+	rate->out_rate = info->out.rate;
+	rate->pitch = (((uint64_t)info->out.rate * POLY_DIV) +
+		       (info->in.rate / 2)) / info->in.rate;
+
+	/* stretch the filter when downsampling so the stopband stays
+	 * below the output Nyquist */
+	stretch = (info->in.rate + info->out.rate - 1) / info->out.rate;
+	if (stretch < 1)
+		stretch = 1;
+	else if (stretch > POLY_MAX_STRETCH)
+		stretch = POLY_MAX_STRETCH;
+	rate->taps = POLY_BASE_TAPS * stretch;
+
+	free(rate->filter);
+	rate->filter = NULL;
+	err = poly_build_filter(rate);
+	if (err < 0)
+		return err;
+
+	free(rate->hist);
+	free(rate->line);
+	rate->line_size = info->in.period_size;
+	rate->hist = calloc(rate->channels * (rate->taps - 1), sizeof(float));
+	rate->line = malloc((rate->taps - 1 + rate->line_size) * sizeof(float));
+	if (!rate->hist || !rate->line)
+		return -ENOMEM;
+
+	return 0;
+}
+
+static int poly_adjust_pitch(void *obj, snd_pcm_rate_info_t *info)
+{
+	struct rate_polyphase *rate = obj;
+	snd_pcm_uframes_t cframes;
+
+	rate->pitch = (((uint64_t)info->out.period_size * POLY_DIV) +
+		       (info->in.period_size / 2)) / info->in.period_size;
+
+	cframes = input_frames(rate, info->out.period_size);
+	while (cframes != info->in.period_size) {
+		snd_pcm_uframes_t cframes_new;
+		if (cframes > info->in.period_size)
+			rate->pitch++;
+		else
+			rate->pitch--;
+		cframes_new = input_frames(rate, info->out.period_size);
+		if ((cframes > info->in.period_size && cframes_new < info->in.period_size) ||
+		    (cframes < info->in.period_size && cframes_new > info->in.period_size)) {
+			SNDERR("invalid pcm period_size %ld -> %ld",
+			       info->in.period_size, info->out.period_size);
+			return -EIO;
+		}
+		cframes = cframes_new;
+	}
+	return 0;
+}
+
+static void poly_reset(void *obj)
+{
+	struct rate_polyphase *rate = obj;
+
+	if (rate->hist)
+		memset(rate->hist, 0,
+		       rate->channels * (rate->taps - 1) * sizeof(float));
+}
+
+static void poly_free(void *obj)
+{
+	struct rate_polyphase *rate = obj;
+
+	free(rate->filter);
+	free(rate->hist);
+	free(rate->line);
+	rate->filter = NULL;
+	rate->hist = NULL;
+	rate->line = NULL;
+}
+
+static void poly_close(void *obj)
+{
+	free(obj);
+}
+
+static size_t poly_snapshot_size(void *obj)
+{
+	struct rate_polyphase *rate = obj;
+
+	return rate->channels * (rate->taps - 1) * sizeof(float);
+}
+
+static void poly_snapshot(void *obj, void *buf)
+{
+	struct rate_polyphase *rate = obj;
+
+	memcpy(buf, rate->hist,
+	       rate->channels * (rate->taps - 1) * sizeof(float));
+}
+
+static void poly_restore(void *obj, const void *buf)
+{
+	struct rate_polyphase *rate = obj;
+
+	memcpy(rate->hist, buf,
+	       rate->channels * (rate->taps - 1) * sizeof(float));
+}
+
+static int get_supported_rates(ATTRIBUTE_UNUSED void *rate,
+			       unsigned int *rate_min, unsigned int *rate_max)
+{
+	*rate_min = SND_PCM_PLUGIN_RATE_MIN;
+	*rate_max = SND_PCM_PLUGIN_RATE_MAX;
+	return 0;
+}
+
+static int get_supported_formats(ATTRIBUTE_UNUSED void *rate,
+				 uint64_t *in_formats,
+				 uint64_t *out_formats,
+				 unsigned int *flags)
+{
+	*in_formats = *out_formats =
+		(1ULL << SND_PCM_FORMAT_S16) |
+		(1ULL << SND_PCM_FORMAT_S32);
+	*flags = SND_PCM_RATE_FLAG_SYNC_FORMATS;
+	return 0;
+}
+
+static void poly_dump(void *obj, snd_output_t *out)
+{
+	struct rate_polyphase *rate = obj;
+
+	snd_output_printf(out, "Converter: polyphase windowed-sinc (%u taps, %u phases)\n",
+			  rate->taps, POLY_PHASES);
+}
+
+static const snd_pcm_rate_ops_t polyphase_ops = {
+	.close = poly_close,
+	.init = poly_init,
+	.free = poly_free,
+	.reset = poly_reset,
+	.adjust_pitch = poly_adjust_pitch,
+	.convert = poly_convert,
+	.input_frames = input_frames,
+	.output_frames = output_frames,
+	.version = SND_PCM_RATE_PLUGIN_VERSION,
+	.get_supported_rates = get_supported_rates,
+	.get_supported_formats = get_supported_formats,
+	.dump = poly_dump,
+	.snapshot_size = poly_snapshot_size,
+	.snapshot = poly_snapshot,
+	.restore = poly_restore,
+};
+
+int SND_PCM_RATE_PLUGIN_ENTRY(polyphase) (ATTRIBUTE_UNUSED unsigned int version,
+					  void **objp, snd_pcm_rate_ops_t *ops)
+{
+	struct rate_polyphase *rate;
+
+	rate = calloc(1, sizeof(*rate));
+	if (!rate)
+		return -ENOMEM;
+
+	*objp = rate;
+	*ops = polyphase_ops;
+	return 0;
+}
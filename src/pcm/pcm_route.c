@@ -32,6 +32,14 @@
 #include "bswap.h"
 #include <math.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define ROUTE_CONVERT1_MANY_SIMD
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define ROUTE_CONVERT1_MANY_SIMD
+#endif
+
 #ifndef PIC
 /* entry for static linking */
 const char *_snd_module_pcm_route = "";
@@ -64,6 +72,7 @@ typedef struct {
 	unsigned int put_idx;
 	unsigned int conv_idx;
 	int use_getput;
+	unsigned int simd_width;	/* 16/32 for the native S16/S32 fast path, else 0 */
 	unsigned int src_size;
 	snd_pcm_format_t dst_sfmt;
 	unsigned int nsrcs;
@@ -224,6 +233,155 @@ static void snd_pcm_route_convert1_one_getput(const snd_pcm_channel_area_t *dst_
 	}
 }
 
+#ifdef ROUTE_CONVERT1_MANY_SIMD
+
+/*
+ * Vectorized many-to-one mix for the native S16/S32 formats with the
+ * source channels packed back to back inside one interleaved frame, as
+ * in a 7.1 -> stereo downmix.  The whole inner source loop collapses
+ * into one widening multiply-accumulate per frame.  The coefficients
+ * are applied in the same fixed point as the label threaded loop and
+ * the output is bit identical to it (the table entries are bounded by
+ * SND_PCM_PLUGIN_ROUTE_FULL, so the narrower accumulators cannot
+ * overflow).  Returns 0 when the layout does not fit and the caller
+ * falls back to the generic code.
+ */
+static int snd_pcm_route_convert1_many_simd(char *dst, int dst_step,
+					    const char **srcs,
+					    const int *src_steps,
+					    const snd_pcm_route_ttable_src_t *src_tt,
+					    int nsrcs, snd_pcm_uframes_t frames,
+					    const snd_pcm_route_params_t *params)
+{
+	const char *src = srcs[0];
+	int step = src_steps[0];
+	snd_pcm_uframes_t f = 0;
+	int64_t sum;
+	int i;
+
+	if (params->simd_width == 0 || params->sum_idx != UINT64 || frames == 0)
+		return 0;
+	for (i = 1; i < nsrcs; ++i)
+		if (src_steps[i] != step ||
+		    srcs[i] != src + i * (int)(params->simd_width / 8))
+			return 0;
+	/*
+	 * The scalar code attenuates in 32.16 and shifts the sum right by
+	 * 4 bits (or adds unscaled for the non attenuated case, where all
+	 * table entries equal SND_PCM_PLUGIN_ROUTE_RESOLUTION); multiplying
+	 * by as_int and always shifting yields the same values for both.
+	 * The last frame is converted by the scalar tail below so that the
+	 * full width vector load never reads past the end of the area.
+	 */
+	if (params->simd_width == 16 && nsrcs <= 8) {
+		int16_t cbuf[8] = {0};
+
+		for (i = 0; i < nsrcs; ++i)
+			cbuf[i] = src_tt[i].as_int;
+#if defined(__SSE2__)
+		{
+			__m128i c = _mm_loadu_si128((const __m128i *)cbuf);
+
+			for (; f + 1 < frames; ++f) {
+				__m128i v = _mm_loadu_si128((const __m128i *)src);
+				__m128i s = _mm_madd_epi16(v, c);
+				int32_t t;
+
+				s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+				s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+				t = _mm_cvtsi128_si32(s) >> 4;
+				if (t > 0x7fff)
+					t = 0x7fff;
+				else if (t < -0x8000)
+					t = -0x8000;
+				*(int16_t *)dst = t;
+				src += step;
+				dst += dst_step;
+			}
+		}
+#else /* __aarch64__ */
+		{
+			int16x8_t c = vld1q_s16(cbuf);
+
+			for (; f + 1 < frames; ++f) {
+				int16x8_t v = vld1q_s16((const int16_t *)src);
+				int32x4_t p = vmull_s16(vget_low_s16(v), vget_low_s16(c));
+				int32_t t;
+
+				p = vmlal_s16(p, vget_high_s16(v), vget_high_s16(c));
+				t = vaddvq_s32(p) >> 4;
+				if (t > 0x7fff)
+					t = 0x7fff;
+				else if (t < -0x8000)
+					t = -0x8000;
+				*(int16_t *)dst = t;
+				src += step;
+				dst += dst_step;
+			}
+		}
+#endif
+		for (; f < frames; ++f) {
+			int32_t s = 0;
+
+			for (i = 0; i < nsrcs; ++i)
+				s += *(const int16_t *)(src + 2 * i) * src_tt[i].as_int;
+			s >>= 4;
+			if (s > 0x7fff)
+				s = 0x7fff;
+			else if (s < -0x8000)
+				s = -0x8000;
+			*(int16_t *)dst = s;
+			src += step;
+			dst += dst_step;
+		}
+		return 1;
+	}
+	if (params->simd_width == 32 && nsrcs <= 4) {
+#if defined(__aarch64__)
+		int32_t cbuf[4] = {0};
+		int32x4_t c;
+
+		for (i = 0; i < nsrcs; ++i)
+			cbuf[i] = src_tt[i].as_int;
+		c = vld1q_s32(cbuf);
+		for (; f + 1 < frames; ++f) {
+			int32x4_t v = vld1q_s32((const int32_t *)src);
+			int64x2_t p = vmull_s32(vget_low_s32(v), vget_low_s32(c));
+
+			p = vmlal_s32(p, vget_high_s32(v), vget_high_s32(c));
+			sum = vaddvq_s64(p) >> 4;
+			if (sum > (int64_t)0x7fffffff)
+				sum = 0x7fffffff;
+			else if (sum < -(int64_t)0x80000000)
+				sum = -(int64_t)0x80000000;
+			*(int32_t *)dst = sum;
+			src += step;
+			dst += dst_step;
+		}
+#endif
+		/* x86 lacks a packed signed 32x32 multiply before SSE4.1,
+		 * so only the scalar specialization is used there
+		 */
+		for (; f < frames; ++f) {
+			sum = 0;
+			for (i = 0; i < nsrcs; ++i)
+				sum += (int64_t)*(const int32_t *)(src + 4 * i) * src_tt[i].as_int;
+			sum >>= 4;
+			if (sum > (int64_t)0x7fffffff)
+				sum = 0x7fffffff;
+			else if (sum < -(int64_t)0x80000000)
+				sum = -(int64_t)0x80000000;
+			*(int32_t *)dst = sum;
+			src += step;
+			dst += dst_step;
+		}
+		return 1;
+	}
+	return 0;
+}
+
+#endif /* ROUTE_CONVERT1_MANY_SIMD */
+
 static void snd_pcm_route_convert1_many(const snd_pcm_channel_area_t *dst_area,
 					snd_pcm_uframes_t dst_offset,
 					const snd_pcm_channel_area_t *src_areas,
@@ -309,6 +467,12 @@ static void snd_pcm_route_convert1_many(const snd_pcm_channel_area_t *dst_area,
 	dst = snd_pcm_channel_area_addr(dst_area, dst_offset);
 	dst_step = snd_pcm_channel_area_step(dst_area);
 
+#ifdef ROUTE_CONVERT1_MANY_SIMD
+	if (snd_pcm_route_convert1_many_simd(dst, dst_step, srcs, src_steps,
+					     src_tt, nsrcs, frames, params))
+		return;
+#endif
+
 	while (frames-- > 0) {
 		snd_pcm_route_ttable_src_t *ttp = src_tt;
 		sum_t sum;
@@ -575,6 +739,11 @@ static int snd_pcm_route_hw_params(snd_pcm_t *pcm, snd_pcm_hw_params_t * params)
 	route->params.get_idx = snd_pcm_linear_get_index(src_format, SND_PCM_FORMAT_S32);
 	route->params.put_idx = snd_pcm_linear_put_index(SND_PCM_FORMAT_S32, dst_format);
 	route->params.conv_idx = snd_pcm_linear_convert_index(src_format, dst_format);
+	if (src_format == dst_format &&
+	    (src_format == SND_PCM_FORMAT_S16 || src_format == SND_PCM_FORMAT_S32))
+		route->params.simd_width = snd_pcm_format_width(src_format);
+	else
+		route->params.simd_width = 0;
 	route->params.src_size = snd_pcm_format_width(src_format) / 8;
 	route->params.dst_sfmt = dst_format;
 #if SND_PCM_PLUGIN_ROUTE_FLOAT
@@ -1028,10 +1197,11 @@ int snd_pcm_route_open(snd_pcm_t **pcmp, const char *name,
 	if (sformat != SND_PCM_FORMAT_UNKNOWN && 
 	    snd_pcm_format_linear(sformat) != 1)
 		return -EINVAL;
-	route = calloc(1, sizeof(snd_pcm_route_t));
-	if (!route) {
-		return -ENOMEM;
-	}
+	err = snd_pcm_new_priv(&pcm, SND_PCM_TYPE_ROUTE, name, slave->stream,
+			       slave->mode, sizeof(snd_pcm_route_t),
+			       (void **)&route);
+	if (err < 0)
+		return err;
 	snd_pcm_plugin_init(&route->plug);
 	route->sformat = sformat;
 	route->schannels = schannels;
@@ -1043,15 +1213,11 @@ int snd_pcm_route_open(snd_pcm_t **pcmp, const char *name,
 	route->plug.gen.close_slave = close_slave;
 	route->plug.init = route_chmap_init;
 
-	err = snd_pcm_new(&pcm, SND_PCM_TYPE_ROUTE, name, slave->stream, slave->mode);
-	if (err < 0) {
-		free(route);
-		return err;
-	}
 	pcm->ops = &snd_pcm_route_ops;
 	pcm->fast_ops = &snd_pcm_plugin_fast_ops;
 	pcm->private_data = route;
 	pcm->poll_fd = slave->poll_fd;
+	pcm->poll_dynamic = slave->poll_dynamic;
 	pcm->poll_events = slave->poll_events;
 	pcm->tstamp_type = slave->tstamp_type;
 	snd_pcm_set_hw_ptr(pcm, &route->plug.hw_ptr, -1, 0);
@@ -1233,6 +1399,165 @@ int snd_pcm_route_load_ttable(snd_config_t *tt, snd_pcm_route_ttable_entry_t *tt
 					  tt_cused, tt_sused, schannels, NULL);
 }
 
+/*
+ * Process-level cache of flattened ttables: open storms with a static
+ * route configuration resolve the identical matrix hundreds of times,
+ * so key the flattened result by the serialized content of the ttable
+ * subtree plus the matched chmap and slave channel count, and let
+ * repeat opens share the immutable matrix.  The cache is bounded and
+ * entries live for the process lifetime.
+ */
+struct route_ttable_cache_entry {
+	struct route_ttable_cache_entry *next;
+	unsigned char *key;
+	size_t key_len;
+	unsigned int csize, ssize;
+	unsigned int cused, sused;
+	snd_pcm_route_ttable_entry_t *ttable;
+};
+
+#define ROUTE_TTABLE_CACHE_MAX	64
+
+static struct route_ttable_cache_entry *route_ttable_cache;
+static unsigned int route_ttable_cache_count;
+#ifdef HAVE_LIBPTHREAD
+static pthread_mutex_t route_ttable_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+struct route_key_buf {
+	unsigned char *buf;
+	size_t len;
+	size_t alloc;
+};
+
+static int route_key_add(struct route_key_buf *kb, const void *data,
+			 size_t size)
+{
+	if (kb->len + size > kb->alloc) {
+		size_t alloc = kb->alloc ? kb->alloc * 2 : 256;
+		unsigned char *buf;
+		while (alloc < kb->len + size)
+			alloc *= 2;
+		buf = realloc(kb->buf, alloc);
+		if (buf == NULL)
+			return -ENOMEM;
+		kb->buf = buf;
+		kb->alloc = alloc;
+	}
+	memcpy(kb->buf + kb->len, data, size);
+	kb->len += size;
+	return 0;
+}
+
+/* serialize the inputs of the ttable resolution; any anomaly aborts the
+ * key build and the caller falls back to the uncached path, which
+ * reports the configuration error as before
+ */
+static int route_ttable_key_build(snd_config_t *tt, int schannels,
+				  const snd_pcm_chmap_t *chmap,
+				  unsigned char **keyp, size_t *lenp)
+{
+	struct route_key_buf kb = { NULL, 0, 0 };
+	snd_config_iterator_t i, inext;
+
+	if (route_key_add(&kb, &schannels, sizeof(schannels)) < 0)
+		goto _err;
+	if (chmap &&
+	    (route_key_add(&kb, &chmap->channels, sizeof(chmap->channels)) < 0 ||
+	     route_key_add(&kb, chmap->pos,
+			   chmap->channels * sizeof(chmap->pos[0])) < 0))
+		goto _err;
+	snd_config_for_each(i, inext, tt) {
+		snd_config_t *in = snd_config_iterator_entry(i);
+		snd_config_iterator_t j, jnext;
+		const char *id;
+		if (snd_config_get_id(in, &id) < 0)
+			continue;
+		if (snd_config_get_type(in) != SND_CONFIG_TYPE_COMPOUND)
+			goto _err;
+		if (route_key_add(&kb, id, strlen(id) + 1) < 0)
+			goto _err;
+		snd_config_for_each(j, jnext, in) {
+			snd_config_t *jnode = snd_config_iterator_entry(j);
+			double value;
+			if (snd_config_get_id(jnode, &id) < 0)
+				continue;
+			if (snd_config_get_ireal(jnode, &value) < 0)
+				goto _err;
+			if (route_key_add(&kb, id, strlen(id) + 1) < 0 ||
+			    route_key_add(&kb, &value, sizeof(value)) < 0)
+				goto _err;
+		}
+	}
+	*keyp = kb.buf;
+	*lenp = kb.len;
+	return 0;
+ _err:
+	free(kb.buf);
+	return -EINVAL;
+}
+
+static const struct route_ttable_cache_entry *
+route_ttable_cache_lookup(const unsigned char *key, size_t key_len)
+{
+	struct route_ttable_cache_entry *e;
+
+#ifdef HAVE_LIBPTHREAD
+	pthread_mutex_lock(&route_ttable_cache_mutex);
+#endif
+	for (e = route_ttable_cache; e; e = e->next)
+		if (e->key_len == key_len && !memcmp(e->key, key, key_len))
+			break;
+#ifdef HAVE_LIBPTHREAD
+	pthread_mutex_unlock(&route_ttable_cache_mutex);
+#endif
+	return e;
+}
+
+static void route_ttable_cache_store(const unsigned char *key, size_t key_len,
+				     unsigned int csize, unsigned int ssize,
+				     unsigned int cused, unsigned int sused,
+				     const snd_pcm_route_ttable_entry_t *ttable)
+{
+	struct route_ttable_cache_entry *e;
+
+	e = malloc(sizeof(*e));
+	if (e == NULL)
+		return;
+	e->key = malloc(key_len);
+	e->ttable = malloc(csize * ssize * sizeof(*e->ttable));
+	if (e->key == NULL || e->ttable == NULL) {
+		free(e->key);
+		free(e->ttable);
+		free(e);
+		return;
+	}
+	memcpy(e->key, key, key_len);
+	memcpy(e->ttable, ttable, csize * ssize * sizeof(*e->ttable));
+	e->key_len = key_len;
+	e->csize = csize;
+	e->ssize = ssize;
+	e->cused = cused;
+	e->sused = sused;
+#ifdef HAVE_LIBPTHREAD
+	pthread_mutex_lock(&route_ttable_cache_mutex);
+#endif
+	if (route_ttable_cache_count < ROUTE_TTABLE_CACHE_MAX) {
+		e->next = route_ttable_cache;
+		route_ttable_cache = e;
+		route_ttable_cache_count++;
+		e = NULL;
+	}
+#ifdef HAVE_LIBPTHREAD
+	pthread_mutex_unlock(&route_ttable_cache_mutex);
+#endif
+	if (e) {
+		free(e->key);
+		free(e->ttable);
+		free(e);
+	}
+}
+
 /*! \page pcm_plugins
 
 \section pcm_plugins_route Plugin: Route & Volume
@@ -1302,6 +1627,9 @@ int _snd_pcm_route_open(snd_pcm_t **pcmp, const char *name,
 	unsigned int csize, ssize;
 	unsigned int cused, sused;
 	snd_pcm_chmap_query_t **chmaps = NULL;
+	unsigned char *ttkey = NULL;
+	size_t ttkey_len = 0;
+	const struct route_ttable_cache_entry *tce = NULL;
 	snd_config_for_each(i, next, conf) {
 		snd_config_t *n = snd_config_iterator_entry(i);
 		const char *id;
@@ -1387,35 +1715,55 @@ int _snd_pcm_route_open(snd_pcm_t **pcmp, const char *name,
 		}
 	}
 
-	err = _snd_pcm_route_determine_ttable(tt, &csize, &ssize, chmap);
-	if (err < 0) {
-		free(chmap);
-		snd_pcm_free_chmaps(chmaps);
-		snd_pcm_close(spcm);
-		return err;
-	}
-	ttable = malloc(csize * ssize * sizeof(snd_pcm_route_ttable_entry_t));
-	if (ttable == NULL) {
-		free(chmap);
-		snd_pcm_free_chmaps(chmaps);
-		snd_pcm_close(spcm);
-		return -ENOMEM;
-	}
-	err = _snd_pcm_route_load_ttable(tt, ttable, csize, ssize,
-					&cused, &sused, schannels, chmap);
-	if (err < 0) {
-		free(chmap);
-		free(ttable);
-		snd_pcm_free_chmaps(chmaps);
-		snd_pcm_close(spcm);
-		return err;
+	if (route_ttable_key_build(tt, schannels, chmap, &ttkey, &ttkey_len) < 0)
+		ttkey = NULL;
+	if (ttkey)
+		tce = route_ttable_cache_lookup(ttkey, ttkey_len);
+	if (tce) {
+		csize = tce->csize;
+		ssize = tce->ssize;
+		cused = tce->cused;
+		sused = tce->sused;
+		ttable = tce->ttable;
+	} else {
+		err = _snd_pcm_route_determine_ttable(tt, &csize, &ssize, chmap);
+		if (err < 0) {
+			free(ttkey);
+			free(chmap);
+			snd_pcm_free_chmaps(chmaps);
+			snd_pcm_close(spcm);
+			return err;
+		}
+		ttable = malloc(csize * ssize * sizeof(snd_pcm_route_ttable_entry_t));
+		if (ttable == NULL) {
+			free(ttkey);
+			free(chmap);
+			snd_pcm_free_chmaps(chmaps);
+			snd_pcm_close(spcm);
+			return -ENOMEM;
+		}
+		err = _snd_pcm_route_load_ttable(tt, ttable, csize, ssize,
+						&cused, &sused, schannels, chmap);
+		if (err < 0) {
+			free(ttkey);
+			free(chmap);
+			free(ttable);
+			snd_pcm_free_chmaps(chmaps);
+			snd_pcm_close(spcm);
+			return err;
+		}
+		if (ttkey)
+			route_ttable_cache_store(ttkey, ttkey_len, csize, ssize,
+						 cused, sused, ttable);
 	}
+	free(ttkey);
 
 	err = snd_pcm_route_open(pcmp, name, sformat, schannels,
 				 ttable, ssize,
 				 cused, sused,
 				 spcm, 1);
-	free(ttable);
+	if (!tce)
+		free(ttable);
 	if (err < 0) {
 		free(chmap);
 		snd_pcm_free_chmaps(chmaps);
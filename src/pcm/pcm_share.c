@@ -118,6 +118,17 @@ typedef struct {
 
 static void _snd_pcm_share_stop(snd_pcm_t *pcm, snd_pcm_state_t state);
 
+/* The slave hardware pointer is additionally published through an atomic
+ * cursor, so that clients which only need to re-read it (avail_update,
+ * hwsync) do not have to queue on the slave mutex while another client
+ * or the slave thread is syncing the very same pointer; the mutex is
+ * still taken for all state transitions and appl pointer updates. */
+static void _snd_pcm_share_slave_hw_ptr_set(snd_pcm_share_slave_t *slave,
+					    snd_pcm_uframes_t hw_ptr)
+{
+	__atomic_store_n(&slave->hw_ptr, hw_ptr, __ATOMIC_RELEASE);
+}
+
 static snd_pcm_uframes_t snd_pcm_share_slave_avail(snd_pcm_share_slave_t *slave)
 {
 	snd_pcm_sframes_t avail;
@@ -348,7 +359,7 @@ static snd_pcm_uframes_t _snd_pcm_share_slave_missing(snd_pcm_share_slave_t *sla
 	snd_pcm_uframes_t missing = INT_MAX;
 	struct list_head *i;
 	/* snd_pcm_sframes_t avail = */ snd_pcm_avail_update(slave->pcm);
-	slave->hw_ptr = *slave->pcm->hw.ptr;
+	_snd_pcm_share_slave_hw_ptr_set(slave, *slave->pcm->hw.ptr);
 	list_for_each(i, &slave->clients) {
 		snd_pcm_share_t *share = list_entry(i, snd_pcm_share_t, list);
 		snd_pcm_t *pcm = share->pcm;
@@ -432,7 +443,7 @@ static void _snd_pcm_share_update(snd_pcm_t *pcm)
 	snd_pcm_t *spcm = slave->pcm;
 	snd_pcm_uframes_t missing;
 	/* snd_pcm_sframes_t avail = */ snd_pcm_avail_update(spcm);
-	slave->hw_ptr = *slave->pcm->hw.ptr;
+	_snd_pcm_share_slave_hw_ptr_set(slave, *slave->pcm->hw.ptr);
 	missing = _snd_pcm_share_missing(pcm);
 	// printf("missing %ld\n", missing);
 	if (!slave->polling) {
@@ -752,7 +763,12 @@ static int snd_pcm_share_hwsync(snd_pcm_t *pcm)
 	snd_pcm_share_t *share = pcm->private_data;
 	snd_pcm_share_slave_t *slave = share->slave;
 	int err;
-	Pthread_mutex_lock(&slave->mutex);
+	if (pthread_mutex_trylock(&slave->mutex) != 0) {
+		/* the mutex holder is syncing the slave for us */
+		if (share->state == SND_PCM_STATE_XRUN)
+			return -EPIPE;
+		return 0;
+	}
 	err = _snd_pcm_share_hwsync(pcm);
 	Pthread_mutex_unlock(&slave->mutex);
 	return err;
@@ -793,16 +809,24 @@ static snd_pcm_sframes_t snd_pcm_share_avail_update(snd_pcm_t *pcm)
 	snd_pcm_share_t *share = pcm->private_data;
 	snd_pcm_share_slave_t *slave = share->slave;
 	snd_pcm_sframes_t avail;
-	Pthread_mutex_lock(&slave->mutex);
 	if (share->state == SND_PCM_STATE_RUNNING) {
-		avail = snd_pcm_avail_update(slave->pcm);
-		if (avail < 0) {
+		if (pthread_mutex_trylock(&slave->mutex) == 0) {
+			avail = snd_pcm_avail_update(slave->pcm);
+			if (avail < 0) {
+				Pthread_mutex_unlock(&slave->mutex);
+				return avail;
+			}
+			share->hw_ptr = *slave->pcm->hw.ptr;
+			_snd_pcm_share_slave_hw_ptr_set(slave, share->hw_ptr);
 			Pthread_mutex_unlock(&slave->mutex);
-			return avail;
+		} else {
+			/* the mutex holder is syncing the very same slave
+			 * cursor right now; instead of convoying on the
+			 * lock, pick up the last published cursor */
+			share->hw_ptr = __atomic_load_n(&slave->hw_ptr,
+							__ATOMIC_ACQUIRE);
 		}
-		share->hw_ptr = *slave->pcm->hw.ptr;
 	}
-	Pthread_mutex_unlock(&slave->mutex);
 	avail = snd_pcm_mmap_avail(pcm);
 	if ((snd_pcm_uframes_t)avail > pcm->buffer_size)
 		return -EPIPE;
@@ -55,6 +55,9 @@ const char *_snd_module_pcm_shm = "";
 typedef struct {
 	int socket;
 	volatile snd_pcm_shm_ctrl_t *ctrl;
+	int no_status_avail;		/* server lacks the coalesced command */
+	int avail_valid;		/* avail_cached holds a fresh result */
+	snd_pcm_sframes_t avail_cached;	/* avail piggybacked on the last status */
 } snd_pcm_shm_t;
 #endif
 
@@ -119,6 +122,7 @@ static long snd_pcm_shm_action(snd_pcm_t *pcm)
 
 	if (ctrl->hw.changed || ctrl->appl.changed)
 		return -EBADFD;
+	shm->avail_valid = 0;
 	err = write(shm->socket, buf, 1);
 	if (err != 1)
 		return -EBADFD;
@@ -392,12 +396,27 @@ static int snd_pcm_shm_status(snd_pcm_t *pcm, snd_pcm_status_t * status)
 	snd_pcm_shm_t *shm = pcm->private_data;
 	volatile snd_pcm_shm_ctrl_t *ctrl = shm->ctrl;
 	int err;
-	ctrl->cmd = SNDRV_PCM_IOCTL_STATUS;
+	/* piggyback an avail_update on the status round trip; the following
+	 * snd_pcm_shm_avail_update() is then answered from memory
+	 */
+	ctrl->cmd = shm->no_status_avail ?
+		SNDRV_PCM_IOCTL_STATUS : SND_PCM_IOCTL_STATUS_AVAIL;
 	// ctrl->u.status = *status;
 	err = snd_pcm_shm_action(pcm);
+	if (err == -ENOSYS && !shm->no_status_avail) {
+		/* old server, fall back for good */
+		shm->no_status_avail = 1;
+		ctrl->cmd = SNDRV_PCM_IOCTL_STATUS;
+		err = snd_pcm_shm_action(pcm);
+	}
 	if (err < 0)
 		return err;
 	*status = ctrl->u.status;
+	if (!shm->no_status_avail) {
+		shm->avail_cached = err;
+		shm->avail_valid = 1;
+		err = 0;
+	}
 	return err;
 }
 
@@ -435,6 +454,10 @@ static snd_pcm_sframes_t snd_pcm_shm_avail_update(snd_pcm_t *pcm)
 	snd_pcm_shm_t *shm = pcm->private_data;
 	volatile snd_pcm_shm_ctrl_t *ctrl = shm->ctrl;
 	int err;
+	if (shm->avail_valid) {
+		shm->avail_valid = 0;
+		return shm->avail_cached;
+	}
 	ctrl->cmd = SND_PCM_IOCTL_AVAIL_UPDATE;
 	err = snd_pcm_shm_action(pcm);
 	if (err < 0)
@@ -271,6 +271,97 @@ int snd_spcm_init_duplex(snd_pcm_t *playback_pcm,
 	return 0;
 }
 
+static int set_preset_hw_params(snd_pcm_t *pcm,
+				snd_pcm_hw_params_t *hw_params,
+				const snd_spcm_preset_t *preset)
+{
+	int err;
+
+	err = snd_pcm_hw_params_any(pcm, hw_params);
+	if (err < 0)
+		return err;
+	err = snd_pcm_hw_params_set_access(pcm, hw_params, preset->access);
+	if (err < 0)
+		return err;
+	err = snd_pcm_hw_params_set_format(pcm, hw_params, preset->format);
+	if (err < 0)
+		return err;
+	if (preset->subformat != SND_PCM_SUBFORMAT_STD) {
+		err = snd_pcm_hw_params_set_subformat(pcm, hw_params, preset->subformat);
+		if (err < 0)
+			return err;
+	}
+	err = snd_pcm_hw_params_set_channels(pcm, hw_params, preset->channels);
+	if (err < 0)
+		return err;
+	err = snd_pcm_hw_params_set_rate(pcm, hw_params, preset->rate, 0);
+	if (err < 0)
+		return err;
+	err = snd_pcm_hw_params_set_buffer_time(pcm, hw_params, preset->buffer_time, 0);
+	if (err < 0)
+		return err;
+	if (preset->period_time == 0) {
+		unsigned int periods = 3;
+		err = INTERNAL(snd_pcm_hw_params_set_periods_near)(pcm, hw_params, &periods, NULL);
+		if (err < 0)
+			return err;
+		if (periods == 1)
+			return -EINVAL;
+	} else {
+		err = snd_pcm_hw_params_set_period_time(pcm, hw_params, preset->period_time, 0);
+		if (err < 0)
+			return err;
+		if (preset->buffer_time == preset->period_time)
+			return -EINVAL;
+	}
+	return 0;
+}
+
+/**
+ * \brief Set up a simple PCM from a parameter preset
+ * \param pcm PCM handle
+ * \param preset Parameter preset
+ * \return 0 if successful, or a negative error code
+ *
+ * Unlike snd_spcm_init() the parameters are requested exactly as given
+ * in the preset (only the period layout may be refined when the preset
+ * period time is zero) and installed through snd_pcm_configure(), so a
+ * configuration verified once against the target device is applied
+ * deterministically with a minimal number of negotiation round trips.
+ * The preset does not match the device when -EINVAL is returned.
+ *
+ * \warning The simple PCM API may be broken in the current release.
+ */
+int snd_spcm_init_preset(snd_pcm_t *pcm, const snd_spcm_preset_t *preset)
+{
+	int err;
+	snd_pcm_hw_params_t hw_params = {0};
+	snd_pcm_sw_params_t sw_params = {0};
+
+	assert(pcm);
+	assert(preset);
+	assert(preset->rate >= 5000 && preset->rate <= 786000);
+	assert(preset->channels >= 1 && preset->channels <= 512);
+
+	if (preset->buffer_time == 0)
+		return -EINVAL;
+	err = set_preset_hw_params(pcm, &hw_params, preset);
+	if (err < 0)
+		goto _error;
+	err = snd_pcm_configure(pcm, &hw_params, NULL);
+	if (err < 0)
+		goto _error;
+	err = set_sw_params(pcm, &sw_params, preset->xrun_type);
+	if (err < 0)
+		goto _error;
+	return 0;
+
+ _error:
+	SNDERR("cannot apply preset '%s': %s",
+	       preset->name ? preset->name : "(unnamed)", snd_strerror(err));
+	return err;
+}
+
 /**
  * \brief Get the set up of simple PCM
  * \param pcm PCM handle
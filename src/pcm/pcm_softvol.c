@@ -32,6 +32,14 @@
 #include <math.h>
 #include <sound/tlv.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SOFTVOL_SIMD
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define SOFTVOL_SIMD
+#endif
+
 #ifndef PIC
 /* entry for static linking */
 const char *_snd_module_pcm_softvol = "";
@@ -52,6 +60,9 @@ typedef struct {
 	double min_dB;
 	double max_dB;
 	unsigned int *dB_value;
+	int ramp;			/* interpolate volume changes over one period */
+	int ramp_valid;
+	unsigned int ramp_vol[3];	/* last applied left/right/center scales */
 } snd_pcm_softvol_t;
 
 #define VOL_SCALE_SHIFT		16
@@ -173,12 +184,287 @@ static inline short MULTI_DIV_short(short a, unsigned int b, int swap)
 	return swap ? (short)bswap_16((short)fraction) : (short)fraction;
 }
 
+/* scale index (left/right/center) used for a channel, as GET_VOL_SCALE */
+static inline unsigned int softvol_chan_scale_idx(unsigned int ch,
+						  unsigned int channels)
+{
+	switch (ch) {
+	case 0:
+	case 2:
+		return (channels == ch + 1) ? 2 : 0;
+	case 4:
+	case 5:
+		return 2;
+	default:
+		return ch & 1;
+	}
+}
+
+#ifdef SOFTVOL_SIMD
+
+/*
+ * Vectorized attenuation for the native S16/S32 formats on interleaved
+ * areas.  Only plain attenuation (scale below 0x10000) is handled; the
+ * 0xffff copy shortcut and gains above 0 dB keep the generic per-type
+ * loops, as do layouts where the per-channel scale pattern does not
+ * repeat within one vector.  The results are bit identical to
+ * MULTI_DIV_short/MULTI_DIV_int.
+ */
+static int softvol_convert_simd(snd_pcm_softvol_t *svol,
+				const snd_pcm_channel_area_t *dst_areas,
+				snd_pcm_uframes_t dst_offset,
+				const snd_pcm_channel_area_t *src_areas,
+				snd_pcm_uframes_t src_offset,
+				unsigned int channels,
+				snd_pcm_uframes_t frames,
+				const unsigned int *vols)
+{
+	unsigned int scale[8], width, lanes, uniform = 1, ch;
+	const char *src;
+	char *dst;
+	size_t total, i;
+
+	if (svol->sformat == SND_PCM_FORMAT_S16)
+		width = 2;
+	else if (svol->sformat == SND_PCM_FORMAT_S32)
+		width = 4;
+	else
+		return 0;
+	src = snd_pcm_channel_area_addr(&src_areas[0], src_offset);
+	dst = snd_pcm_channel_area_addr(&dst_areas[0], dst_offset);
+	if (src_areas[0].step != channels * width * 8 ||
+	    dst_areas[0].step != src_areas[0].step)
+		return 0;
+	for (ch = 1; ch < channels; ++ch) {
+		if (src_areas[ch].step != src_areas[0].step ||
+		    dst_areas[ch].step != dst_areas[0].step ||
+		    (const char *)snd_pcm_channel_area_addr(&src_areas[ch], src_offset) != src + ch * width ||
+		    (char *)snd_pcm_channel_area_addr(&dst_areas[ch], dst_offset) != dst + ch * width)
+			return 0;
+	}
+	lanes = 16 / width;
+	for (ch = 0; ch < channels && ch < 8; ++ch) {
+		scale[ch] = vols[softvol_chan_scale_idx(ch, channels)];
+		if (scale[ch] >= 0xffff)
+			return 0;
+		if (scale[ch] != scale[0])
+			uniform = 0;
+	}
+	if (channels > lanes || lanes % channels) {
+		if (!uniform || channels > 8)
+			return 0;
+		/* a single scale repeats cleanly whatever the geometry */
+	}
+	total = (size_t)frames * channels;
+	i = 0;
+	if (width == 2) {
+		const short *s = (const short *)src;
+		short *d = (short *)dst;
+		unsigned short pat[8];
+		unsigned int k;
+
+		for (k = 0; k < 8; ++k)
+			pat[k] = scale[uniform ? 0 : k % channels];
+#if defined(__SSE2__)
+		{
+			__m128i vs = _mm_loadu_si128((const __m128i *)pat);
+			/* fix _mm_mulhi_epi16 for scales above 0x7fff */
+			__m128i sign = _mm_srai_epi16(vs, 15);
+
+			for (; i + 8 <= total; i += 8) {
+				__m128i a = _mm_loadu_si128((const __m128i *)(s + i));
+				__m128i hi = _mm_mulhi_epi16(a, vs);
+
+				hi = _mm_add_epi16(hi, _mm_and_si128(a, sign));
+				_mm_storeu_si128((__m128i *)(d + i), hi);
+			}
+		}
+#else /* __aarch64__ */
+		{
+			/* products of s16 by a scale below 0x10000 fit in s32 */
+			int32x4_t v0 = vreinterpretq_s32_u32(vmovl_u16(vld1_u16(pat)));
+			int32x4_t v1 = vreinterpretq_s32_u32(vmovl_u16(vld1_u16(pat + 4)));
+
+			for (; i + 8 <= total; i += 8) {
+				int16x8_t a = vld1q_s16(s + i);
+				int32x4_t p0 = vmulq_s32(vmovl_s16(vget_low_s16(a)), v0);
+				int32x4_t p1 = vmulq_s32(vmovl_s16(vget_high_s16(a)), v1);
+
+				p0 = vshrq_n_s32(p0, 16);
+				p1 = vshrq_n_s32(p1, 16);
+				vst1q_s16(d + i, vcombine_s16(vmovn_s32(p0), vmovn_s32(p1)));
+			}
+		}
+#endif
+		for (; i < total; ++i)
+			d[i] = ((int)s[i] * (int)scale[uniform ? 0 : i % channels]) >> 16;
+	} else {
+		const int *s = (const int *)src;
+		int *d = (int *)dst;
+		unsigned int pat[4];
+		unsigned int k;
+
+		for (k = 0; k < 4; ++k)
+			pat[k] = scale[uniform ? 0 : k % channels];
+#if defined(__SSE2__)
+		{
+			__m128i vs = _mm_loadu_si128((const __m128i *)pat);
+			__m128i corr = _mm_slli_epi32(vs, 16);
+
+			for (; i + 4 <= total; i += 4) {
+				__m128i a = _mm_loadu_si128((const __m128i *)(s + i));
+				/* 32x16 -> 48 bit products via unsigned 64 bit
+				 * multiplies, with the usual sign correction
+				 */
+				__m128i pe = _mm_srli_epi64(_mm_mul_epu32(a, vs), 16);
+				__m128i po = _mm_srli_epi64(_mm_mul_epu32(_mm_srli_epi64(a, 32),
+									  _mm_srli_epi64(vs, 32)), 16);
+				__m128i r = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(pe),
+									    _mm_castsi128_ps(po),
+									    _MM_SHUFFLE(2, 0, 2, 0)));
+
+				r = _mm_shuffle_epi32(r, _MM_SHUFFLE(3, 1, 2, 0));
+				r = _mm_sub_epi32(r, _mm_and_si128(corr, _mm_srai_epi32(a, 31)));
+				_mm_storeu_si128((__m128i *)(d + i), r);
+			}
+		}
+#else /* __aarch64__ */
+		{
+			int32x4_t vs = vreinterpretq_s32_u32(vld1q_u32(pat));
+
+			for (; i + 4 <= total; i += 4) {
+				int32x4_t a = vld1q_s32(s + i);
+				int64x2_t p0 = vmull_s32(vget_low_s32(a), vget_low_s32(vs));
+				int64x2_t p1 = vmull_s32(vget_high_s32(a), vget_high_s32(vs));
+
+				p0 = vshrq_n_s64(p0, 16);
+				p1 = vshrq_n_s64(p1, 16);
+				vst1q_s32(d + i, vcombine_s32(vmovn_s64(p0), vmovn_s64(p1)));
+			}
+		}
+#endif
+		for (; i < total; ++i)
+			d[i] = (int)(((int64_t)s[i] * scale[uniform ? 0 : i % channels]) >> 16);
+	}
+	return 1;
+}
+
+#endif /* SOFTVOL_SIMD */
+
+/*
+ * Interpolate the volume scale linearly over the transferred period to
+ * avoid the zipper noise of an instant volume step (enabled with the
+ * 'ramp' configuration key).  Native S16/S32 only; the other formats
+ * keep the historic stepping behaviour.
+ */
+SND_TARGET_CLONES
+static int softvol_convert_ramp(snd_pcm_softvol_t *svol,
+				const snd_pcm_channel_area_t *dst_areas,
+				snd_pcm_uframes_t dst_offset,
+				const snd_pcm_channel_area_t *src_areas,
+				snd_pcm_uframes_t src_offset,
+				unsigned int channels,
+				snd_pcm_uframes_t frames,
+				const unsigned int *from, const unsigned int *to)
+{
+	unsigned int ch;
+	snd_pcm_uframes_t fr;
+
+	if (svol->sformat != SND_PCM_FORMAT_S16 &&
+	    svol->sformat != SND_PCM_FORMAT_S32)
+		return 0;
+	if (frames == 0)
+		return 1;
+	for (ch = 0; ch < channels; ++ch) {
+		const snd_pcm_channel_area_t *src_area = &src_areas[ch];
+		const snd_pcm_channel_area_t *dst_area = &dst_areas[ch];
+		unsigned int idx = softvol_chan_scale_idx(ch, channels);
+		int64_t delta = (int64_t)to[idx] - (int64_t)from[idx];
+		unsigned int vol_scale;
+
+		if (svol->sformat == SND_PCM_FORMAT_S16) {
+			const short *src = snd_pcm_channel_area_addr(src_area, src_offset);
+			short *dst = snd_pcm_channel_area_addr(dst_area, dst_offset);
+			unsigned int src_step = snd_pcm_channel_area_step(src_area) / sizeof(short);
+			unsigned int dst_step = snd_pcm_channel_area_step(dst_area) / sizeof(short);
+
+			for (fr = 0; fr < frames; ++fr) {
+				vol_scale = from[idx] + (unsigned int)((delta * (int64_t)(fr + 1)) / (int64_t)frames);
+				*dst = MULTI_DIV_short(*src, vol_scale, 0);
+				src += src_step;
+				dst += dst_step;
+			}
+		} else {
+			const int *src = snd_pcm_channel_area_addr(src_area, src_offset);
+			int *dst = snd_pcm_channel_area_addr(dst_area, dst_offset);
+			unsigned int src_step = snd_pcm_channel_area_step(src_area) / sizeof(int);
+			unsigned int dst_step = snd_pcm_channel_area_step(dst_area) / sizeof(int);
+
+			for (fr = 0; fr < frames; ++fr) {
+				vol_scale = from[idx] + (unsigned int)((delta * (int64_t)(fr + 1)) / (int64_t)frames);
+				*dst = MULTI_DIV_int(*src, vol_scale, 0);
+				src += src_step;
+				dst += dst_step;
+			}
+		}
+	}
+	return 1;
+}
+
+/* effective left/right/center scales of the current volume setting */
+static void softvol_stereo_scales(snd_pcm_softvol_t *svol, unsigned int *s)
+{
+	if (svol->cur_vol[0] == 0 && svol->cur_vol[1] == 0) {
+		s[0] = s[1] = s[2] = 0;
+	} else if (svol->max_val == 1) {
+		s[0] = svol->cur_vol[0] ? 0xffff : 0;
+		s[1] = svol->cur_vol[1] ? 0xffff : 0;
+		s[2] = s[0] | s[1];
+	} else {
+		s[0] = svol->dB_value[svol->cur_vol[0]];
+		s[1] = svol->dB_value[svol->cur_vol[1]];
+		s[2] = svol->dB_value[(svol->cur_vol[0] + svol->cur_vol[1]) / 2];
+	}
+}
+
+static void softvol_mono_scales(snd_pcm_softvol_t *svol, unsigned int *s)
+{
+	if (svol->cur_vol[0] == 0)
+		s[0] = 0;
+	else if (svol->max_val == 1)
+		s[0] = 0xffff;
+	else
+		s[0] = svol->dB_value[svol->cur_vol[0]];
+	s[1] = s[2] = s[0];
+}
+
+/* ramp from the previously applied scales when the volume moved */
+static int softvol_ramp_check(snd_pcm_softvol_t *svol,
+			      const snd_pcm_channel_area_t *dst_areas,
+			      snd_pcm_uframes_t dst_offset,
+			      const snd_pcm_channel_area_t *src_areas,
+			      snd_pcm_uframes_t src_offset,
+			      unsigned int channels,
+			      snd_pcm_uframes_t frames,
+			      const unsigned int *scales)
+{
+	int done = 0;
+
+	if (svol->ramp_valid &&
+	    memcmp(scales, svol->ramp_vol, 3 * sizeof(*scales)) != 0)
+		done = softvol_convert_ramp(svol, dst_areas, dst_offset,
+					    src_areas, src_offset,
+					    channels, frames,
+					    svol->ramp_vol, scales);
+	memcpy(svol->ramp_vol, scales, sizeof(svol->ramp_vol));
+	svol->ramp_valid = 1;
+	return done;
+}
+
 #endif /* DOC_HIDDEN */
 
 /*
  * apply volumue attenuation
- *
- * TODO: use SIMD operations
  */
 
 #ifndef DOC_HIDDEN
@@ -313,6 +599,7 @@ static inline short MULTI_DIV_short(short a, unsigned int b, int swap)
 #endif /* DOC_HIDDEN */
 
 /* 2-channel stereo control */
+SND_TARGET_CLONES
 static void softvol_convert_stereo_vol(snd_pcm_softvol_t *svol,
 				       const snd_pcm_channel_area_t *dst_areas,
 				       snd_pcm_uframes_t dst_offset,
@@ -324,6 +611,13 @@ static void softvol_convert_stereo_vol(snd_pcm_softvol_t *svol,
 	const snd_pcm_channel_area_t *dst_area, *src_area;
 	unsigned int src_step, dst_step;
 	unsigned int vol_scale, vol[2], vol_c;
+	unsigned int scales[3];
+
+	softvol_stereo_scales(svol, scales);
+	if (svol->ramp &&
+	    softvol_ramp_check(svol, dst_areas, dst_offset, src_areas,
+			       src_offset, channels, frames, scales))
+		return;
 
 	if (svol->cur_vol[0] == 0 && svol->cur_vol[1] == 0) {
 		snd_pcm_areas_silence(dst_areas, dst_offset, channels, frames,
@@ -345,6 +639,11 @@ static void softvol_convert_stereo_vol(snd_pcm_softvol_t *svol,
 		vol[1] = svol->dB_value[svol->cur_vol[1]];
 		vol_c = svol->dB_value[(svol->cur_vol[0] + svol->cur_vol[1]) / 2];
 	}
+#ifdef SOFTVOL_SIMD
+	if (softvol_convert_simd(svol, dst_areas, dst_offset, src_areas,
+				 src_offset, channels, frames, scales))
+		return;
+#endif
 	switch (svol->sformat) {
 	case SND_PCM_FORMAT_S16_LE:
 	case SND_PCM_FORMAT_S16_BE:
@@ -374,6 +673,7 @@ static void softvol_convert_stereo_vol(snd_pcm_softvol_t *svol,
 #define GET_VOL_SCALE
 
 /* mono control */
+SND_TARGET_CLONES
 static void softvol_convert_mono_vol(snd_pcm_softvol_t *svol,
 				     const snd_pcm_channel_area_t *dst_areas,
 				     snd_pcm_uframes_t dst_offset,
@@ -385,6 +685,13 @@ static void softvol_convert_mono_vol(snd_pcm_softvol_t *svol,
 	const snd_pcm_channel_area_t *dst_area, *src_area;
 	unsigned int src_step, dst_step;
 	unsigned int vol_scale;
+	unsigned int scales[3];
+
+	softvol_mono_scales(svol, scales);
+	if (svol->ramp &&
+	    softvol_ramp_check(svol, dst_areas, dst_offset, src_areas,
+			       src_offset, channels, frames, scales))
+		return;
 
 	if (svol->cur_vol[0] == 0) {
 		snd_pcm_areas_silence(dst_areas, dst_offset, channels, frames,
@@ -400,6 +707,11 @@ static void softvol_convert_mono_vol(snd_pcm_softvol_t *svol,
 		vol_scale = svol->cur_vol[0] ? 0xffff : 0;
 	else
 		vol_scale = svol->dB_value[svol->cur_vol[0]];
+#ifdef SOFTVOL_SIMD
+	if (softvol_convert_simd(svol, dst_areas, dst_offset, src_areas,
+				 src_offset, channels, frames, scales))
+		return;
+#endif
 	switch (svol->sformat) {
 	case SND_PCM_FORMAT_S16_LE:
 	case SND_PCM_FORMAT_S16_BE:
@@ -445,6 +757,94 @@ static void get_current_volume(snd_pcm_softvol_t *svol)
 	}
 }
 
+/*
+ * Process-level cache of computed dB tables: instances opened with the
+ * same range and resolution share one refcounted table instead of
+ * burning the pow() loop and the table memory per stream.
+ */
+struct softvol_db_cache_entry {
+	struct softvol_db_cache_entry *next;
+	double min_dB;
+	double max_dB;
+	unsigned int resolution;
+	unsigned int refcount;
+	unsigned int dB_value[0];
+};
+
+static struct softvol_db_cache_entry *softvol_db_cache;
+#ifdef HAVE_LIBPTHREAD
+static pthread_mutex_t softvol_db_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+#ifndef HAVE_SOFT_FLOAT
+/* look up or compute the table for the given range; the zero dB entry
+ * is part of the key space already since zero_dB_val is derived from
+ * the range and resolution alone
+ */
+static unsigned int *softvol_db_table_get(double min_dB, double max_dB,
+					  unsigned int resolution,
+					  unsigned int zero_dB_val)
+{
+	struct softvol_db_cache_entry *e;
+	unsigned int i;
+
+#ifdef HAVE_LIBPTHREAD
+	pthread_mutex_lock(&softvol_db_cache_mutex);
+#endif
+	for (e = softvol_db_cache; e; e = e->next) {
+		if (e->min_dB == min_dB && e->max_dB == max_dB &&
+		    e->resolution == resolution) {
+			e->refcount++;
+			goto _found;
+		}
+	}
+	e = malloc(sizeof(*e) + resolution * sizeof(unsigned int));
+	if (e) {
+		e->min_dB = min_dB;
+		e->max_dB = max_dB;
+		e->resolution = resolution;
+		e->refcount = 1;
+		for (i = 0; i < resolution; i++) {
+			double db = min_dB +
+				(i * (max_dB - min_dB)) / (resolution - 1);
+			double v = (pow(10.0, db / 20.0) *
+					(double)(1 << VOL_SCALE_SHIFT));
+			e->dB_value[i] = (unsigned int)v;
+		}
+		if (zero_dB_val)
+			e->dB_value[zero_dB_val] = 65535;
+		e->next = softvol_db_cache;
+		softvol_db_cache = e;
+	}
+ _found:
+#ifdef HAVE_LIBPTHREAD
+	pthread_mutex_unlock(&softvol_db_cache_mutex);
+#endif
+	return e ? e->dB_value : NULL;
+}
+#endif /* !HAVE_SOFT_FLOAT */
+
+static void softvol_db_table_put(unsigned int *dB_value)
+{
+	struct softvol_db_cache_entry *e, **prev;
+
+#ifdef HAVE_LIBPTHREAD
+	pthread_mutex_lock(&softvol_db_cache_mutex);
+#endif
+	for (prev = &softvol_db_cache; (e = *prev); prev = &e->next) {
+		if (e->dB_value != dB_value)
+			continue;
+		if (--e->refcount == 0) {
+			*prev = e->next;
+			free(e);
+		}
+		break;
+	}
+#ifdef HAVE_LIBPTHREAD
+	pthread_mutex_unlock(&softvol_db_cache_mutex);
+#endif
+}
+
 static void softvol_free(snd_pcm_softvol_t *svol)
 {
 	if (svol->plug.gen.close_slave)
@@ -452,7 +852,7 @@ static void softvol_free(snd_pcm_softvol_t *svol)
 	if (svol->ctl)
 		snd_ctl_close(svol->ctl);
 	if (svol->dB_value && svol->dB_value != preset_dB_value)
-		free(svol->dB_value);
+		softvol_db_table_put(svol->dB_value);
 	free(svol);
 }
 
@@ -850,23 +1250,13 @@ static int softvol_load_control(snd_pcm_t *pcm, snd_pcm_softvol_t *svol,
 		svol->dB_value = (unsigned int*)preset_dB_value;
 	else {
 #ifndef HAVE_SOFT_FLOAT
-		svol->dB_value = calloc(resolution, sizeof(unsigned int));
+		svol->dB_value = softvol_db_table_get(min_dB, max_dB,
+						      resolution,
+						      svol->zero_dB_val);
 		if (! svol->dB_value) {
 			SNDERR("cannot allocate dB table");
 			return -ENOMEM;
 		}
-		svol->min_dB = min_dB;
-		svol->max_dB = max_dB;
-		for (i = 0; i <= svol->max_val; i++) {
-			double db = svol->min_dB +
-				(i * (svol->max_dB - svol->min_dB)) /
-					svol->max_val;
-			double v = (pow(10.0, db / 20.0) *
-					(double)(1 << VOL_SCALE_SHIFT));
-			svol->dB_value[i] = (unsigned int)v;
-		}
-		if (svol->zero_dB_val)
-			svol->dB_value[svol->zero_dB_val] = 65535;
 #else
 		SNDERR("Cannot handle the given dB range and resolution");
 		return -EINVAL;
@@ -967,6 +1357,7 @@ int snd_pcm_softvol_open(snd_pcm_t **pcmp, const char *name,
 	pcm->fast_ops = &snd_pcm_plugin_fast_ops;
 	pcm->private_data = svol;
 	pcm->poll_fd = slave->poll_fd;
+	pcm->poll_dynamic = slave->poll_dynamic;
 	pcm->poll_events = slave->poll_events;
 	/*
 	 * Since the softvol converts on the place, and the format/channels
@@ -1122,6 +1513,8 @@ pcm.name {
 	[max_dB REAL]           # maximal dB value (default:   0.0)
 	[resolution INT]        # resolution (default: 256)
 				# resolution = 2 means a mute switch
+	[ramp BOOL]             # ramp volume changes over one period instead
+				# of an instant step (S16/S32 only)
 }
 \endcode
 
@@ -1161,7 +1554,7 @@ int _snd_pcm_softvol_open(snd_pcm_t **pcmp, const char *name,
 	int resolution = PRESET_RESOLUTION;
 	double min_dB = PRESET_MIN_DB;
 	double max_dB = ZERO_DB;
-	int card = -1, cchannels = 2;
+	int card = -1, cchannels = 2, ramp = 0;
 
 	snd_config_for_each(i, next, conf) {
 		snd_config_t *n = snd_config_iterator_entry(i);
@@ -1204,6 +1597,15 @@ int _snd_pcm_softvol_open(snd_pcm_t **pcmp, const char *name,
 			}
 			continue;
 		}
+		if (strcmp(id, "ramp") == 0) {
+			err = snd_config_get_bool(n);
+			if (err < 0) {
+				SNDERR("Invalid ramp value");
+				return err;
+			}
+			ramp = err;
+			continue;
+		}
 		SNDERR("Unknown field %s", id);
 		return -EINVAL;
 	}
@@ -1265,6 +1667,11 @@ int _snd_pcm_softvol_open(snd_pcm_t **pcmp, const char *name,
 					   resolution, spcm, 1);
 		if (err < 0)
 			snd_pcm_close(spcm);
+		/* the open passes the bare slave through when the control
+		 * is not ours; ramping applies only to a real instance
+		 */
+		else if ((*pcmp)->type == SND_PCM_TYPE_SOFTVOL)
+			((snd_pcm_softvol_t *)(*pcmp)->private_data)->ramp = ramp;
 	}
 	return err;
 }
@@ -0,0 +1,303 @@
+/**
+ * \file pcm/pcm_waitset.c
+ * \ingroup PCM
+ * \brief PCM Wait Set Interface
+ * \date 2026
+ *
+ * PCM wait set routines - aggregated waiting on many PCM handles
+ */
+/*
+ *  PCM - Wait Set
+ *
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 2.1 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include <sys/epoll.h>
+#include "pcm_local.h"
+
+#ifndef DOC_HIDDEN
+typedef struct {
+	struct list_head list;
+	snd_pcm_t *pcm;
+	struct pollfd *pfds;
+	unsigned int nfds;
+	unsigned int direct: 1;		/* not epollable, poll directly */
+	unsigned int generation;
+} snd_pcm_waitset_node_t;
+
+struct _snd_pcm_waitset {
+	int epfd;
+	struct list_head pcms;
+	unsigned int generation;
+};
+#endif
+
+static snd_pcm_waitset_node_t *snd_pcm_waitset_find(snd_pcm_waitset_t *waitset,
+						    snd_pcm_t *pcm)
+{
+	struct list_head *pos;
+	snd_pcm_waitset_node_t *node;
+
+	list_for_each(pos, &waitset->pcms) {
+		node = list_entry(pos, snd_pcm_waitset_node_t, list);
+		if (node->pcm == pcm)
+			return node;
+	}
+	return NULL;
+}
+
+static void snd_pcm_waitset_node_free(snd_pcm_waitset_t *waitset,
+				      snd_pcm_waitset_node_t *node)
+{
+	unsigned int i;
+
+	if (!node->direct)
+		for (i = 0; i < node->nfds; ++i)
+			epoll_ctl(waitset->epfd, EPOLL_CTL_DEL,
+				  node->pfds[i].fd, NULL);
+	list_del(&node->list);
+	free(node->pfds);
+	free(node);
+}
+
+/**
+ * \brief Opens a PCM wait set
+ * \param waitsetp Returned wait set handle
+ * \return 0 on success otherwise a negative error code
+ *
+ * A wait set aggregates the poll descriptors of many PCM handles into
+ * one kernel epoll instance, so that an application serving many
+ * devices needs a single blocking call per wakeup instead of
+ * rebuilding a pollfd array from every handle each time.
+ */
+int snd_pcm_waitset_open(snd_pcm_waitset_t **waitsetp)
+{
+	snd_pcm_waitset_t *waitset;
+
+	assert(waitsetp);
+	waitset = calloc(1, sizeof(*waitset));
+	if (!waitset)
+		return -ENOMEM;
+	waitset->epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (waitset->epfd < 0) {
+		int err = -errno;
+		free(waitset);
+		return err;
+	}
+	INIT_LIST_HEAD(&waitset->pcms);
+	*waitsetp = waitset;
+	return 0;
+}
+
+/**
+ * \brief Closes a PCM wait set
+ * \param waitset Wait set handle
+ * \return 0 on success otherwise a negative error code
+ *
+ * Registered PCM handles are only deregistered, not closed.
+ */
+int snd_pcm_waitset_close(snd_pcm_waitset_t *waitset)
+{
+	struct list_head *pos, *next;
+
+	assert(waitset);
+	list_for_each_safe(pos, next, &waitset->pcms)
+		snd_pcm_waitset_node_free(waitset,
+					  list_entry(pos, snd_pcm_waitset_node_t, list));
+	close(waitset->epfd);
+	free(waitset);
+	return 0;
+}
+
+/**
+ * \brief Registers a PCM handle into a wait set
+ * \param waitset Wait set handle
+ * \param pcm PCM handle
+ * \return 0 on success otherwise a negative error code
+ *
+ * The PCM's current poll descriptors are registered, so the PCM should
+ * be configured via #snd_pcm_hw_params first; plugins may exchange
+ * their descriptors when the configuration changes.  After such a
+ * change remove the handle and add it again.
+ */
+int snd_pcm_waitset_add(snd_pcm_waitset_t *waitset, snd_pcm_t *pcm)
+{
+	snd_pcm_waitset_node_t *node;
+	struct epoll_event ev;
+	int count, err;
+	unsigned int i;
+
+	assert(waitset && pcm);
+	if (snd_pcm_waitset_find(waitset, pcm))
+		return -EBUSY;
+	count = snd_pcm_poll_descriptors_count(pcm);
+	if (count < 0)
+		return count;
+	if (count == 0)
+		return -EIO;
+	node = calloc(1, sizeof(*node));
+	if (!node)
+		return -ENOMEM;
+	node->pfds = calloc(count, sizeof(*node->pfds));
+	if (!node->pfds) {
+		free(node);
+		return -ENOMEM;
+	}
+	err = snd_pcm_poll_descriptors(pcm, node->pfds, count);
+	if (err < 0)
+		goto _error;
+	node->pcm = pcm;
+	node->nfds = err;
+	for (i = 0; i < node->nfds; ++i) {
+		memset(&ev, 0, sizeof(ev));
+		/* POLLIN/POLLOUT/POLLPRI and the EPOLL* counterparts
+		 * share the values; epoll is level triggered by default
+		 * which matches poll() semantics
+		 */
+		ev.events = node->pfds[i].events & (POLLIN | POLLOUT | POLLPRI);
+		ev.data.ptr = node;
+		if (epoll_ctl(waitset->epfd, EPOLL_CTL_ADD,
+			      node->pfds[i].fd, &ev) < 0) {
+			err = -errno;
+			while (i-- > 0)
+				epoll_ctl(waitset->epfd, EPOLL_CTL_DEL,
+					  node->pfds[i].fd, NULL);
+			/* EPERM means the file cannot be epolled and is
+			 * always ready (e.g. /dev/null backing the null
+			 * plugin) - keep the handle on the direct list
+			 */
+			if (err != -EPERM)
+				goto _error;
+			node->direct = 1;
+			break;
+		}
+	}
+	list_add_tail(&node->list, &waitset->pcms);
+	return 0;
+
+ _error:
+	free(node->pfds);
+	free(node);
+	return err;
+}
+
+/**
+ * \brief Removes a PCM handle from a wait set
+ * \param waitset Wait set handle
+ * \param pcm PCM handle
+ * \return 0 on success otherwise a negative error code
+ */
+int snd_pcm_waitset_remove(snd_pcm_waitset_t *waitset, snd_pcm_t *pcm)
+{
+	snd_pcm_waitset_node_t *node;
+
+	assert(waitset && pcm);
+	node = snd_pcm_waitset_find(waitset, pcm);
+	if (!node)
+		return -ENOENT;
+	snd_pcm_waitset_node_free(waitset, node);
+	return 0;
+}
+
+/**
+ * \brief Waits for ready PCM handles in a wait set
+ * \param waitset Wait set handle
+ * \param timeout Maximum time in milliseconds to wait,
+ *        a -1 value means infinity
+ * \param ready Array filled with the ready PCM handles
+ * \param space Capacity of the ready array
+ * \return count of ready PCM handles otherwise a negative error code
+ *
+ * Blocks in a single epoll_wait() call for all registered handles and
+ * resolves the raw descriptor events through
+ * #snd_pcm_poll_descriptors_revents internally, so spurious wakeups
+ * from timer or control descriptors of the plugin chain are filtered
+ * out; a zero return means the timeout elapsed.  At most \a space
+ * handles are stored; descriptors are watched level triggered, so
+ * handles not reported due to a small array are returned by the next
+ * call.
+ */
+static int snd_pcm_waitset_node_ready(snd_pcm_waitset_node_t *node)
+{
+	unsigned short revents;
+	int err;
+
+	/* refresh the whole descriptor set of the handle and let the
+	 * plugin chain demangle it
+	 */
+	err = poll(node->pfds, node->nfds, 0);
+	if (err < 0)
+		return -errno;
+	if (err == 0)
+		return 0;
+	err = snd_pcm_poll_descriptors_revents(node->pcm, node->pfds,
+					       node->nfds, &revents);
+	if (err < 0)
+		return err;
+	return revents != 0;
+}
+
+int snd_pcm_waitset_wait(snd_pcm_waitset_t *waitset, int timeout,
+			 snd_pcm_t **ready, unsigned int space)
+{
+	struct epoll_event events[16];
+	snd_pcm_waitset_node_t *node;
+	struct list_head *pos;
+	int n, i, err, count = 0;
+
+	assert(waitset && (ready || !space));
+	/* descriptors which refused epoll are always ready for the
+	 * kernel; check them first and do not block when one fires
+	 */
+	list_for_each(pos, &waitset->pcms) {
+		node = list_entry(pos, snd_pcm_waitset_node_t, list);
+		if (!node->direct)
+			continue;
+		err = snd_pcm_waitset_node_ready(node);
+		if (err < 0)
+			return err;
+		if (!err)
+			continue;
+		if ((unsigned int)count < space)
+			ready[count] = node->pcm;
+		count++;
+	}
+	if (count)
+		timeout = 0;
+	do {
+		n = epoll_wait(waitset->epfd, events,
+			       sizeof(events) / sizeof(events[0]), timeout);
+	} while (n < 0 && errno == EINTR);
+	if (n < 0)
+		return -errno;
+	waitset->generation++;
+	for (i = 0; i < n; ++i) {
+		node = events[i].data.ptr;
+		if (node->generation == waitset->generation)
+			continue;	/* this handle is done already */
+		node->generation = waitset->generation;
+		err = snd_pcm_waitset_node_ready(node);
+		if (err < 0)
+			return err;
+		if (!err)
+			continue;
+		if ((unsigned int)count < space)
+			ready[count] = node->pcm;
+		count++;
+	}
+	return count;
+}
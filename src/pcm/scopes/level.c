@@ -22,6 +22,12 @@
 #include <errno.h>
 #include <alsa/asoundlib.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 #define BAR_WIDTH 70
 /* milliseconds to go from 32767 to 0 */
 #define DECAY_MS 400
@@ -92,6 +98,58 @@ static void level_stop(snd_pcm_scope_t *scope)
 	refresh();
 }
 
+/* highest absolute sample value of a block; this runs once per channel
+ * and update over the whole ring delta, so it is worth vectorizing
+ */
+static int level_max_abs(const int16_t *ptr, snd_pcm_uframes_t n)
+{
+	int lev = 0;
+#if defined(__SSE2__)
+	const __m128i bias = _mm_set1_epi16((short)0x8000);
+	__m128i vmax = bias;	/* biased zero */
+	int16_t tmp[8];
+	int i, s;
+
+	while (n >= 8) {
+		__m128i v = _mm_loadu_si128((const __m128i *)ptr);
+		__m128i sign = _mm_srai_epi16(v, 15);
+		/* abs; -32768 keeps the 0x8000 pattern, which the bias
+		 * below orders correctly as 32768 */
+		v = _mm_sub_epi16(_mm_xor_si128(v, sign), sign);
+		vmax = _mm_max_epi16(vmax, _mm_xor_si128(v, bias));
+		ptr += 8;
+		n -= 8;
+	}
+	_mm_storeu_si128((__m128i *)tmp, vmax);
+	for (i = 0; i < 8; i++) {
+		s = (uint16_t)tmp[i] ^ 0x8000;
+		if (s > lev)
+			lev = s;
+	}
+#elif defined(__aarch64__)
+	uint16x8_t vmax = vdupq_n_u16(0);
+	int s;
+
+	while (n >= 8) {
+		int16x8_t v = vld1q_s16(ptr);
+		vmax = vmaxq_u16(vmax, vreinterpretq_u16_s16(vabsq_s16(v)));
+		ptr += 8;
+		n -= 8;
+	}
+	s = vmaxvq_u16(vmax);
+	if (s > lev)
+		lev = s;
+#endif
+	for (; n > 0; n--) {
+		int s = *ptr++;
+		if (s < 0)
+			s = -s;
+		if (s > lev)
+			lev = s;
+	}
+	return lev;
+}
+
 static void level_update(snd_pcm_scope_t *scope)
 {
 	snd_pcm_scope_level_t *level = snd_pcm_scope_get_callback_private(scope);
@@ -118,28 +176,15 @@ static void level_update(snd_pcm_scope_t *scope)
 	for (c = 0; c < channels; c++) {
 		int16_t *ptr;
 		int s, lev = 0;
-		snd_pcm_uframes_t n;
 		snd_pcm_scope_level_channel_t *l;
 		unsigned int lev_pos, peak_pos;
 		l = &level->channels[c];
 		ptr = snd_pcm_scope_s16_get_channel_buffer(level->s16, c) + offset;
-		for (n = size1; n > 0; n--) {
-			s = *ptr;
-			if (s < 0)
-				s = -s;
-			if (s > lev)
-				lev = s;
-			ptr++;
-		}
+		lev = level_max_abs(ptr, size1);
 		ptr = snd_pcm_scope_s16_get_channel_buffer(level->s16, c);
-		for (n = size2; n > 0; n--) {
-			s = *ptr;
-			if (s < 0)
-				s = -s;
-			if (s > lev)
-				lev = s;
-			ptr++;
-		}
+		s = level_max_abs(ptr, size2);
+		if (s > lev)
+			lev = s;
 		l->level = lev;
 		l->peak_age += ms;
 		if (l->peak_age >= level->peak_ms ||
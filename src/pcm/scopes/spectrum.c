@@ -0,0 +1,353 @@
+/*
+ *  PCM - Meter spectrum plugin (ncurses)
+ *  Copyright (c) 2026 by Jaroslav Kysela <perex@perex.cz>
+ *
+ *  Radix-2 FFT over the s16 pseudo scope ring with vectorized
+ *  butterflies, one log-magnitude row per channel.
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 2.1 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include <curses.h>
+#include <errno.h>
+#include <math.h>
+#include <alsa/asoundlib.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* analysis block, must be a power of two */
+#define FFT_SIZE 1024
+/* displayed dynamic range in dB */
+#define RANGE_DB 60.0
+
+typedef struct _snd_pcm_scope_spectrum {
+	snd_pcm_t *pcm;
+	snd_pcm_scope_t *s16;
+	snd_pcm_uframes_t old;
+	snd_pcm_uframes_t filled;	/* frames seen since start/reset */
+	unsigned int fft_size;
+	unsigned int log2n;
+	float *re;
+	float *im;
+	float *window;			/* Hann, scaled to s16 range */
+	float *wre;			/* per-stage twiddle tables, */
+	float *wim;			/* contiguous for each stage  */
+	unsigned int *bitrev;
+	float *mag;			/* N/2 magnitudes */
+	int top;
+	WINDOW *win;
+} snd_pcm_scope_spectrum_t;
+
+/* butterflies of one stage over contiguous twiddles; the split
+ * real/imaginary layout makes the inner loop a straight vector
+ * multiply-add, four butterflies per step on SSE2
+ */
+static void spectrum_stage(float *re, float *im,
+			   const float *wre, const float *wim,
+			   unsigned int n, unsigned int size)
+{
+	unsigned int half = size / 2;
+	unsigned int block, j;
+
+	for (block = 0; block < n; block += size) {
+		float *re1 = re + block, *im1 = im + block;
+		float *re2 = re1 + half, *im2 = im1 + half;
+		j = 0;
+#if defined(__SSE2__)
+		for (; j + 4 <= half; j += 4) {
+			__m128 wr = _mm_loadu_ps(wre + j);
+			__m128 wi = _mm_loadu_ps(wim + j);
+			__m128 ar = _mm_loadu_ps(re2 + j);
+			__m128 ai = _mm_loadu_ps(im2 + j);
+			__m128 br = _mm_loadu_ps(re1 + j);
+			__m128 bi = _mm_loadu_ps(im1 + j);
+			__m128 tr = _mm_sub_ps(_mm_mul_ps(ar, wr),
+					       _mm_mul_ps(ai, wi));
+			__m128 ti = _mm_add_ps(_mm_mul_ps(ar, wi),
+					       _mm_mul_ps(ai, wr));
+			_mm_storeu_ps(re2 + j, _mm_sub_ps(br, tr));
+			_mm_storeu_ps(im2 + j, _mm_sub_ps(bi, ti));
+			_mm_storeu_ps(re1 + j, _mm_add_ps(br, tr));
+			_mm_storeu_ps(im1 + j, _mm_add_ps(bi, ti));
+		}
+#endif
+		for (; j < half; j++) {
+			float tr = re2[j] * wre[j] - im2[j] * wim[j];
+			float ti = re2[j] * wim[j] + im2[j] * wre[j];
+			re2[j] = re1[j] - tr;
+			im2[j] = im1[j] - ti;
+			re1[j] += tr;
+			im1[j] += ti;
+		}
+	}
+}
+
+static void spectrum_fft(snd_pcm_scope_spectrum_t *spectrum)
+{
+	unsigned int n = spectrum->fft_size;
+	const float *wre = spectrum->wre;
+	const float *wim = spectrum->wim;
+	unsigned int size;
+
+	for (size = 2; size <= n; size *= 2) {
+		spectrum_stage(spectrum->re, spectrum->im, wre, wim, n, size);
+		wre += size / 2;
+		wim += size / 2;
+	}
+}
+
+static int spectrum_enable(snd_pcm_scope_t *scope)
+{
+	snd_pcm_scope_spectrum_t *spectrum = snd_pcm_scope_get_callback_private(scope);
+	unsigned int n = spectrum->fft_size;
+	unsigned int i, j, k, size;
+	float *wre, *wim;
+	int y, x;
+
+	spectrum->re = calloc(n, sizeof(float));
+	spectrum->im = calloc(n, sizeof(float));
+	spectrum->window = calloc(n, sizeof(float));
+	spectrum->wre = calloc(n, sizeof(float));
+	spectrum->wim = calloc(n, sizeof(float));
+	spectrum->bitrev = calloc(n, sizeof(unsigned int));
+	spectrum->mag = calloc(n / 2, sizeof(float));
+	if (!spectrum->re || !spectrum->im || !spectrum->window ||
+	    !spectrum->wre || !spectrum->wim || !spectrum->bitrev ||
+	    !spectrum->mag)
+		return -ENOMEM;
+	for (i = 0; i < n; i++)
+		spectrum->window[i] = (0.5 - 0.5 * cos(2.0 * M_PI * i / n)) / 32768.0;
+	for (i = 0; i < n; i++) {
+		for (j = 0, k = 0; k < spectrum->log2n; k++)
+			j |= ((i >> k) & 1) << (spectrum->log2n - 1 - k);
+		spectrum->bitrev[i] = j;
+	}
+	wre = spectrum->wre;
+	wim = spectrum->wim;
+	for (size = 2; size <= n; size *= 2) {
+		for (j = 0; j < size / 2; j++) {
+			wre[j] = cos(2.0 * M_PI * j / size);
+			wim[j] = -sin(2.0 * M_PI * j / size);
+		}
+		wre += size / 2;
+		wim += size / 2;
+	}
+	spectrum->win = initscr();
+	winsdelln(spectrum->win, snd_pcm_meter_get_channels(spectrum->pcm));
+	getyx(spectrum->win, y, x);
+	(void)x;
+	spectrum->top = y;
+	return 0;
+}
+
+static void spectrum_free(snd_pcm_scope_spectrum_t *spectrum)
+{
+	free(spectrum->re);
+	free(spectrum->im);
+	free(spectrum->window);
+	free(spectrum->wre);
+	free(spectrum->wim);
+	free(spectrum->bitrev);
+	free(spectrum->mag);
+	spectrum->re = spectrum->im = spectrum->window = NULL;
+	spectrum->wre = spectrum->wim = spectrum->mag = NULL;
+	spectrum->bitrev = NULL;
+}
+
+static void spectrum_disable(snd_pcm_scope_t *scope)
+{
+	snd_pcm_scope_spectrum_t *spectrum = snd_pcm_scope_get_callback_private(scope);
+	endwin();
+	spectrum_free(spectrum);
+}
+
+static void spectrum_close(snd_pcm_scope_t *scope)
+{
+	snd_pcm_scope_spectrum_t *spectrum = snd_pcm_scope_get_callback_private(scope);
+	free(spectrum);
+}
+
+static void spectrum_start(snd_pcm_scope_t *scope ATTRIBUTE_UNUSED)
+{
+}
+
+static void spectrum_stop(snd_pcm_scope_t *scope)
+{
+	snd_pcm_scope_spectrum_t *spectrum = snd_pcm_scope_get_callback_private(scope);
+	unsigned int c;
+	for (c = 0; c < snd_pcm_meter_get_channels(spectrum->pcm); c++) {
+		move(spectrum->top + c, 0);
+		clrtoeol();
+	}
+	move(spectrum->top, 0);
+	refresh();
+}
+
+static void spectrum_update(snd_pcm_scope_t *scope)
+{
+	snd_pcm_scope_spectrum_t *spectrum = snd_pcm_scope_get_callback_private(scope);
+	static const char ramp[] = " .:-=+*#%@";
+	snd_pcm_t *pcm = spectrum->pcm;
+	snd_pcm_sframes_t size;
+	snd_pcm_uframes_t bufsize = snd_pcm_meter_get_bufsize(pcm);
+	unsigned int n = spectrum->fft_size;
+	unsigned int channels, bands, bins_per_band;
+	unsigned int c, i, b;
+
+	size = snd_pcm_meter_get_now(pcm) - spectrum->old;
+	if (size < 0)
+		size += snd_pcm_meter_get_boundary(pcm);
+	spectrum->old = snd_pcm_meter_get_now(pcm);
+	spectrum->filled += size;
+	if (spectrum->filled < n || n > bufsize)
+		return;
+	channels = snd_pcm_meter_get_channels(pcm);
+	bands = COLS > 0 ? (unsigned int)COLS : 80;
+	if (bands > n / 2)
+		bands = n / 2;
+	bins_per_band = (n / 2) / bands;
+	for (c = 0; c < channels; c++) {
+		int16_t *buf = snd_pcm_scope_s16_get_channel_buffer(spectrum->s16, c);
+		snd_pcm_uframes_t pos = (spectrum->old - n) % bufsize;
+		for (i = 0; i < n; i++) {
+			spectrum->re[spectrum->bitrev[i]] =
+				buf[pos] * spectrum->window[i];
+			if (++pos == bufsize)
+				pos = 0;
+		}
+		memset(spectrum->im, 0, n * sizeof(float));
+		/* the bit-reversed imaginary part is all zero too */
+		spectrum_fft(spectrum);
+		for (i = 0; i < n / 2; i++)
+			spectrum->mag[i] = hypotf(spectrum->re[i],
+						  spectrum->im[i]) / (n / 2);
+		move(spectrum->top + c, 0);
+		for (b = 0; b < bands; b++) {
+			float peak = 0.0;
+			double db;
+			int lev;
+			for (i = b * bins_per_band; i < (b + 1) * bins_per_band; i++)
+				if (spectrum->mag[i] > peak)
+					peak = spectrum->mag[i];
+			db = peak > 0.0 ? 20.0 * log10(peak) : -RANGE_DB;
+			lev = (int)((db + RANGE_DB) *
+				    (sizeof(ramp) - 2) / RANGE_DB + 0.5);
+			if (lev < 0)
+				lev = 0;
+			if (lev > (int)sizeof(ramp) - 2)
+				lev = sizeof(ramp) - 2;
+			addch(ramp[lev]);
+		}
+		clrtoeol();
+	}
+	move(spectrum->top, 0);
+	refresh();
+}
+
+static void spectrum_reset(snd_pcm_scope_t *scope)
+{
+	snd_pcm_scope_spectrum_t *spectrum = snd_pcm_scope_get_callback_private(scope);
+	spectrum->old = snd_pcm_meter_get_now(spectrum->pcm);
+	spectrum->filled = 0;
+}
+
+snd_pcm_scope_ops_t spectrum_ops = {
+	.enable = spectrum_enable,
+	.disable = spectrum_disable,
+	.close = spectrum_close,
+	.start = spectrum_start,
+	.stop = spectrum_stop,
+	.update = spectrum_update,
+	.reset = spectrum_reset,
+};
+
+int snd_pcm_scope_spectrum_open(snd_pcm_t *pcm, const char *name,
+				unsigned int fft_size,
+				snd_pcm_scope_t **scopep)
+{
+	snd_pcm_scope_t *scope, *s16;
+	snd_pcm_scope_spectrum_t *spectrum;
+	unsigned int log2n, n;
+	int err;
+
+	for (log2n = 0, n = 1; n < fft_size; log2n++)
+		n <<= 1;
+	if (n != fft_size || fft_size < 8)
+		return -EINVAL;
+	err = snd_pcm_scope_malloc(&scope);
+	if (err < 0)
+		return err;
+	spectrum = calloc(1, sizeof(*spectrum));
+	if (!spectrum) {
+		free(scope);
+		return -ENOMEM;
+	}
+	spectrum->pcm = pcm;
+	spectrum->fft_size = fft_size;
+	spectrum->log2n = log2n;
+	s16 = snd_pcm_meter_search_scope(pcm, "s16");
+	if (!s16) {
+		err = snd_pcm_scope_s16_open(pcm, "s16", &s16);
+		if (err < 0) {
+			free(scope);
+			free(spectrum);
+			return err;
+		}
+	}
+	spectrum->s16 = s16;
+	snd_pcm_scope_set_ops(scope, &spectrum_ops);
+	snd_pcm_scope_set_callback_private(scope, spectrum);
+	if (name)
+		snd_pcm_scope_set_name(scope, strdup(name));
+	snd_pcm_meter_add_scope(pcm, scope);
+	*scopep = scope;
+	return 0;
+}
+
+int _snd_pcm_scope_spectrum_open(snd_pcm_t *pcm, const char *name,
+				 snd_config_t *root, snd_config_t *conf)
+{
+	snd_config_iterator_t i, next;
+	snd_pcm_scope_t *scope;
+	long fft_size = -1;
+	int err;
+	snd_config_for_each(i, next, conf) {
+		snd_config_t *n = snd_config_iterator_entry(i);
+		const char *id;
+		if (snd_config_get_id(n, &id) < 0)
+			continue;
+		if (strcmp(id, "comment") == 0)
+			continue;
+		if (strcmp(id, "type") == 0)
+			continue;
+		if (strcmp(id, "fft_size") == 0) {
+			err = snd_config_get_integer(n, &fft_size);
+			if (err < 0) {
+				SNDERR("Invalid type for %s", id);
+				return -EINVAL;
+			}
+			continue;
+		}
+		SNDERR("Unknown field %s", id);
+		return -EINVAL;
+	}
+	(void)root;
+	if (fft_size < 0)
+		fft_size = FFT_SIZE;
+	return snd_pcm_scope_spectrum_open(pcm, name, fft_size, &scope);
+}
@@ -349,6 +349,45 @@ int snd_rawmidi_open_lconf(snd_rawmidi_t **inputp, snd_rawmidi_t **outputp,
 	return snd_rawmidi_open_noupdate(inputp, outputp, lconf, name, mode);
 }
 
+/* write out all staged bytes of the buffered writer mode;
+ * a partial result is kept at the buffer start for the next attempt
+ */
+static int snd_rawmidi_obuf_flush(snd_rawmidi_t *rawmidi)
+{
+	ssize_t res;
+	size_t ofs = 0;
+
+	while (ofs < rawmidi->obufused) {
+		res = rawmidi->ops->write(rawmidi, rawmidi->obuf + ofs,
+					  rawmidi->obufused - ofs);
+		if (res < 0) {
+			if (ofs > 0) {
+				memmove(rawmidi->obuf, rawmidi->obuf + ofs,
+					rawmidi->obufused - ofs);
+				rawmidi->obufused -= ofs;
+			}
+			return res;
+		}
+		ofs += res;
+	}
+	rawmidi->obufused = 0;
+	return 0;
+}
+
+/* check whether the oldest staged byte passed the flush deadline */
+static int snd_rawmidi_obuf_deadline_hit(snd_rawmidi_t *rawmidi)
+{
+	struct timespec ts;
+	long diff_us;
+
+	if (rawmidi->obuf_deadline == 0 || rawmidi->obufused == 0)
+		return 0;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	diff_us = (ts.tv_sec - rawmidi->obuf_tstamp.tv_sec) * 1000000L +
+		  (ts.tv_nsec - rawmidi->obuf_tstamp.tv_nsec) / 1000L;
+	return diff_us >= (long)rawmidi->obuf_deadline;
+}
+
 /**
  * \brief close RawMidi handle
  * \param rawmidi RawMidi handle
@@ -361,6 +400,11 @@ int snd_rawmidi_close(snd_rawmidi_t *rawmidi)
 {
 	int err;
   	assert(rawmidi);
+	if (rawmidi->obuf) {
+		snd_rawmidi_obuf_flush(rawmidi);	/* best effort */
+		free(rawmidi->obuf);
+	}
+	free(rawmidi->iring);
 	err = rawmidi->ops->close(rawmidi);
 	free(rawmidi->name);
 	if (rawmidi->open_func)
@@ -1054,6 +1098,7 @@ int snd_rawmidi_status(snd_rawmidi_t *rawmidi, snd_rawmidi_status_t * status)
 int snd_rawmidi_drop(snd_rawmidi_t *rawmidi)
 {
 	assert(rawmidi);
+	rawmidi->obufused = 0;
 	return rawmidi->ops->drop(rawmidi);
 }
 
@@ -1067,7 +1112,13 @@ int snd_rawmidi_drop(snd_rawmidi_t *rawmidi)
  */
 int snd_rawmidi_drain(snd_rawmidi_t *rawmidi)
 {
+	int err;
 	assert(rawmidi);
+	if (rawmidi->obufused > 0) {
+		err = snd_rawmidi_obuf_flush(rawmidi);
+		if (err < 0)
+			return err;
+	}
 	return rawmidi->ops->drain(rawmidi);
 }
 
@@ -1076,13 +1127,151 @@ int snd_rawmidi_drain(snd_rawmidi_t *rawmidi)
  * \param rawmidi RawMidi handle
  * \param buffer buffer containing MIDI bytes
  * \param size output buffer size in bytes
+ *
+ * With the buffered writer mode enabled (see
+ * #snd_rawmidi_output_buffer_mode) the bytes are staged in a library
+ * buffer first and passed to the device in bursts, either when the
+ * buffer fills up or when the flush deadline expires.
  */
 ssize_t snd_rawmidi_write(snd_rawmidi_t *rawmidi, const void *buffer, size_t size)
 {
+	int err;
 	assert(rawmidi);
 	assert(rawmidi->stream == SND_RAWMIDI_STREAM_OUTPUT);
 	assert(buffer || size == 0);
-	return rawmidi->ops->write(rawmidi, buffer, size);
+	if (rawmidi->obuf == NULL)
+		return rawmidi->ops->write(rawmidi, buffer, size);
+	if (size >= rawmidi->obufsize) {
+		/* oversized chunk, pass it through in order */
+		err = snd_rawmidi_obuf_flush(rawmidi);
+		if (err < 0)
+			return err;
+		return rawmidi->ops->write(rawmidi, buffer, size);
+	}
+	if (rawmidi->obufused + size > rawmidi->obufsize) {
+		err = snd_rawmidi_obuf_flush(rawmidi);
+		if (err < 0)
+			return err;
+	}
+	if (rawmidi->obufused == 0)
+		clock_gettime(CLOCK_MONOTONIC, &rawmidi->obuf_tstamp);
+	memcpy(rawmidi->obuf + rawmidi->obufused, buffer, size);
+	rawmidi->obufused += size;
+	/* a failing burst is not an error here, the bytes are staged
+	 * and the flush is retried from the next call
+	 */
+	if (rawmidi->obufused == rawmidi->obufsize ||
+	    snd_rawmidi_obuf_deadline_hit(rawmidi))
+		snd_rawmidi_obuf_flush(rawmidi);
+	return size;
+}
+
+/**
+ * \brief enable or disable the buffered writer mode
+ * \param rawmidi RawMidi handle (output stream only)
+ * \param size staging buffer size in bytes, 0 to disable the mode
+ * \param deadline flush deadline in microseconds, 0 = flush only when
+ *        the staging buffer is full
+ * \return 0 on success otherwise a negative error code
+ *
+ * By default every snd_rawmidi_write() issues one syscall, which is
+ * wasteful for producers emitting many small (often three byte)
+ * messages.  With the buffered writer mode enabled the written bytes
+ * are accumulated in a library staging buffer and passed to the device
+ * as one burst when the buffer fills up or when the oldest staged byte
+ * becomes \a deadline microseconds old, whichever comes first.  The
+ * deadline is checked from the output functions; an idle handle does
+ * not flush by itself, use snd_rawmidi_output_flush() or
+ * snd_rawmidi_drain() to force out a tail.
+ *
+ * Disabling the mode (or shrinking the buffer) flushes the staged
+ * bytes first and fails when the device cannot take them.
+ *
+ * \sa snd_rawmidi_output_flush(), snd_rawmidi_output_pending()
+ */
+int snd_rawmidi_output_buffer_mode(snd_rawmidi_t *rawmidi, size_t size,
+				   unsigned int deadline)
+{
+	char *buf;
+	int err;
+
+	assert(rawmidi);
+	assert(rawmidi->stream == SND_RAWMIDI_STREAM_OUTPUT);
+	if (size == 0) {
+		if (rawmidi->obuf == NULL)
+			return 0;
+		err = snd_rawmidi_obuf_flush(rawmidi);
+		if (err < 0)
+			return err;
+		free(rawmidi->obuf);
+		rawmidi->obuf = NULL;
+		rawmidi->obufsize = 0;
+		rawmidi->obuf_deadline = 0;
+		return 0;
+	}
+	if (rawmidi->obuf) {
+		err = snd_rawmidi_obuf_flush(rawmidi);
+		if (err < 0)
+			return err;
+		buf = realloc(rawmidi->obuf, size);
+	} else {
+		buf = malloc(size);
+	}
+	if (buf == NULL)
+		return -ENOMEM;
+	rawmidi->obuf = buf;
+	rawmidi->obufsize = size;
+	rawmidi->obufused = 0;
+	rawmidi->obuf_deadline = deadline;
+	return 0;
+}
+
+/**
+ * \brief flush the staged bytes of the buffered writer mode
+ * \param rawmidi RawMidi handle (output stream only)
+ * \return 0 on success otherwise a negative error code
+ *
+ * Writes all bytes staged by the buffered writer mode to the device
+ * without waiting for the flush deadline.  A no-op when the mode is
+ * disabled or nothing is staged.  Unlike snd_rawmidi_drain() this does
+ * not wait until the device ring buffer is empty.
+ */
+int snd_rawmidi_output_flush(snd_rawmidi_t *rawmidi)
+{
+	assert(rawmidi);
+	assert(rawmidi->stream == SND_RAWMIDI_STREAM_OUTPUT);
+	if (rawmidi->obufused == 0)
+		return 0;
+	return snd_rawmidi_obuf_flush(rawmidi);
+}
+
+/**
+ * \brief query the amount of not yet drained output bytes
+ * \param rawmidi RawMidi handle (output stream only)
+ * \return count of pending bytes otherwise a negative error code
+ *
+ * Returns the number of output bytes not yet sent to the MIDI line:
+ * the bytes staged by the buffered writer mode plus the occupied part
+ * of the device ring buffer.  The query never blocks, so it can be
+ * used to poll for the completion of a transmission instead of the
+ * blocking snd_rawmidi_drain().  Zero means fully drained.
+ */
+int snd_rawmidi_output_pending(snd_rawmidi_t *rawmidi)
+{
+	snd_rawmidi_status_t status;
+	size_t pending;
+	int err;
+
+	assert(rawmidi);
+	assert(rawmidi->stream == SND_RAWMIDI_STREAM_OUTPUT);
+	memset(&status, 0, sizeof(status));
+	err = rawmidi->ops->status(rawmidi, &status);
+	if (err < 0)
+		return err;
+	pending = rawmidi->obufused + (rawmidi->buffer_size - status.avail);
+	if (pending > INT_MAX)
+		pending = INT_MAX;
+	return pending;
 }
 
 /**
@@ -1102,6 +1291,109 @@ ssize_t snd_rawmidi_read(snd_rawmidi_t *rawmidi, void *buffer, size_t size)
 	return (rawmidi->ops->read)(rawmidi, buffer, size);
 }
 
+/**
+ * \brief lend a persistent input ring to the RawMidi handle
+ * \param rawmidi RawMidi handle (input stream only)
+ * \param size ring size in bytes, 0 to release the ring
+ * \return 0 on success otherwise a negative error code
+ *
+ * Attaches a persistent input ring of the given size to the handle so
+ * that incoming bytes can be consumed without a per-read copy: the ring
+ * is refilled with one large read from the device and
+ * snd_rawmidi_read_begin() returns borrowed slices of it, mirroring how
+ * snd_pcm_mmap_begin() avoids copies on PCM.  This is a win for bulk
+ * transfers like sysex dumps where snd_rawmidi_read() would otherwise
+ * pay a copy plus a syscall for every small chunk.
+ *
+ * Releasing or resizing the ring discards any not yet consumed bytes,
+ * so do it only between transfers.  The ring cannot be combined with
+ * the timestamp framing read mode.
+ *
+ * \sa snd_rawmidi_read_begin(), snd_rawmidi_read_done()
+ */
+int snd_rawmidi_input_ring(snd_rawmidi_t *rawmidi, size_t size)
+{
+	char *buf;
+
+	assert(rawmidi);
+	assert(rawmidi->stream == SND_RAWMIDI_STREAM_INPUT);
+	if (size == 0) {
+		free(rawmidi->iring);
+		rawmidi->iring = NULL;
+		rawmidi->iringsize = 0;
+		rawmidi->iring_head = rawmidi->iring_tail = 0;
+		return 0;
+	}
+	buf = realloc(rawmidi->iring, size);
+	if (buf == NULL)
+		return -ENOMEM;
+	rawmidi->iring = buf;
+	rawmidi->iringsize = size;
+	rawmidi->iring_head = rawmidi->iring_tail = 0;
+	return 0;
+}
+
+/**
+ * \brief borrow the next slice of input bytes from the lent ring
+ * \param rawmidi RawMidi handle (input stream only)
+ * \param buf returned pointer to the borrowed bytes
+ * \return count of borrowed bytes otherwise a negative error code
+ *
+ * Returns a pointer into the ring lent with snd_rawmidi_input_ring()
+ * covering the bytes read from the device but not yet consumed; the
+ * ring is refilled with a single large read when it is empty.  The
+ * slice stays valid until it is consumed with snd_rawmidi_read_done()
+ * or the ring is released; the bytes are not copied.  In blocking mode
+ * the refill blocks like snd_rawmidi_read(), in nonblock mode -EAGAIN
+ * is returned when no bytes are pending.
+ */
+ssize_t snd_rawmidi_read_begin(snd_rawmidi_t *rawmidi, const unsigned char **buf)
+{
+	ssize_t res;
+
+	assert(rawmidi);
+	assert(rawmidi->stream == SND_RAWMIDI_STREAM_INPUT);
+	assert(buf);
+	if (rawmidi->iring == NULL)
+		return -EINVAL;
+	if ((rawmidi->params_mode & SNDRV_RAWMIDI_MODE_FRAMING_MASK) == SNDRV_RAWMIDI_MODE_FRAMING_TSTAMP)
+		return -EINVAL;
+	if (rawmidi->iring_tail == rawmidi->iring_head) {
+		rawmidi->iring_head = rawmidi->iring_tail = 0;
+		res = (rawmidi->ops->read)(rawmidi, rawmidi->iring,
+					   rawmidi->iringsize);
+		if (res < 0)
+			return res;
+		rawmidi->iring_head = res;
+	}
+	*buf = (unsigned char *)rawmidi->iring + rawmidi->iring_tail;
+	return rawmidi->iring_head - rawmidi->iring_tail;
+}
+
+/**
+ * \brief return a borrowed slice of input bytes to the ring
+ * \param rawmidi RawMidi handle (input stream only)
+ * \param size count of consumed bytes
+ * \return 0 on success otherwise a negative error code
+ *
+ * Marks the first \a size bytes of the slice borrowed with
+ * snd_rawmidi_read_begin() as consumed.  A partial consume is allowed;
+ * the remaining bytes are returned again by the next
+ * snd_rawmidi_read_begin() call.
+ */
+int snd_rawmidi_read_done(snd_rawmidi_t *rawmidi, size_t size)
+{
+	assert(rawmidi);
+	assert(rawmidi->stream == SND_RAWMIDI_STREAM_INPUT);
+	if (rawmidi->iring == NULL ||
+	    size > rawmidi->iring_head - rawmidi->iring_tail)
+		return -EINVAL;
+	rawmidi->iring_tail += size;
+	if (rawmidi->iring_tail == rawmidi->iring_head)
+		rawmidi->iring_head = rawmidi->iring_tail = 0;
+	return 0;
+}
+
 /**
  * \brief read MIDI bytes from MIDI stream with timestamp
  * \param rawmidi RawMidi handle
@@ -1122,6 +1414,37 @@ ssize_t snd_rawmidi_tread(snd_rawmidi_t *rawmidi, struct timespec *tstamp, void
 	return (rawmidi->ops->tread)(rawmidi, tstamp, buffer, size);
 }
 
+/**
+ * \brief read a batch of timestamped frames from MIDI stream
+ * \param rawmidi RawMidi handle
+ * \param frames caller array of frame descriptors to fill
+ * \param space count of descriptors in \a frames
+ * \retval count of filled frames otherwise a negative error code
+ *
+ * Fills the caller array with all framed chunks delivered by one read
+ * from the device; each descriptor carries the frame timestamp and a
+ * zero-copy view into the handle owned read buffer, so decoding a dense
+ * timestamped capture stream no longer costs a syscall per frame as
+ * with #snd_rawmidi_tread.  The data views stay valid until the next
+ * read call on the handle (any of the read variants); consume or copy
+ * them before reading again.  The timestamp framing mode must be
+ * enabled in the parameters (see #snd_rawmidi_params_set_read_mode).
+ *
+ * \sa snd_rawmidi_tread()
+ */
+ssize_t snd_rawmidi_tread_frames(snd_rawmidi_t *rawmidi,
+				 snd_rawmidi_frame_t *frames, size_t space)
+{
+	assert(rawmidi);
+	assert(rawmidi->stream == SND_RAWMIDI_STREAM_INPUT);
+	assert(frames || space == 0);
+	if ((rawmidi->params_mode & SNDRV_RAWMIDI_MODE_FRAMING_MASK) != SNDRV_RAWMIDI_MODE_FRAMING_TSTAMP)
+		return -EINVAL;
+	if (rawmidi->ops->tread_frames == NULL)
+		return -ENOTSUP;
+	return (rawmidi->ops->tread_frames)(rawmidi, frames, space);
+}
+
 #ifndef DOXYGEN
 /*
  * internal API functions for obtaining UMP info from rawmidi instance
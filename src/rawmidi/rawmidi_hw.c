@@ -274,6 +274,57 @@ static ssize_t snd_rawmidi_hw_tread(snd_rawmidi_t *rmidi, struct timespec *tstam
 	return ret + result;
 }
 
+/* decode the buffered frames into caller descriptors; the data pointers
+ * borrow the read buffer, so the views stay valid until the next refill */
+static size_t frames_from_ts_buf(snd_rawmidi_hw_t *hw, snd_rawmidi_frame_t *frames,
+				 size_t space)
+{
+	struct snd_rawmidi_framing_tstamp *f;
+	size_t n = 0;
+
+	f = (struct snd_rawmidi_framing_tstamp *)(hw->buf + hw->buf_pos);
+	while (n < space && hw->buf_fill >= sizeof(*f)) {
+		/* skip unknown frame types and malformed frames */
+		if (f->frame_type == 0 && f->length > 0 &&
+		    f->length <= SNDRV_RAWMIDI_FRAMING_DATA_LENGTH &&
+		    hw->buf_fpos < f->length) {
+			frames[n].tstamp.tv_sec = f->tv_sec;
+			frames[n].tstamp.tv_nsec = f->tv_nsec;
+			frames[n].data = f->data + hw->buf_fpos;
+			frames[n].length = f->length - hw->buf_fpos;
+			n++;
+		}
+		hw->buf_fpos = 0;
+		hw->buf_pos += sizeof(*f);
+		hw->buf_fill -= sizeof(*f);
+		f++;
+	}
+	return n;
+}
+
+static ssize_t snd_rawmidi_hw_tread_frames(snd_rawmidi_t *rmidi,
+					   snd_rawmidi_frame_t *frames,
+					   size_t space)
+{
+	snd_rawmidi_hw_t *hw = rmidi->private_data;
+	size_t n = 0;
+	ssize_t ret;
+
+	/* hand out frames still left from the previous refill first;
+	 * a refill would invalidate the borrowed views */
+	if (hw->buf_fill >= sizeof(struct snd_rawmidi_framing_tstamp)) {
+		n = frames_from_ts_buf(hw, frames, space);
+		if (n > 0)
+			return n;
+	}
+	buf_reset(hw);
+	ret = read(hw->fd, hw->buf, hw->buf_size);
+	if (ret < 0)
+		return -errno;
+	hw->buf_fill = ret;
+	return frames_from_ts_buf(hw, frames, space);
+}
+
 static int snd_rawmidi_hw_ump_endpoint_info(snd_rawmidi_t *rmidi, void *buf)
 {
 	snd_rawmidi_hw_t *hw = rmidi->private_data;
@@ -307,6 +358,7 @@ static const snd_rawmidi_ops_t snd_rawmidi_hw_ops = {
 	.write = snd_rawmidi_hw_write,
 	.read = snd_rawmidi_hw_read,
 	.tread = snd_rawmidi_hw_tread,
+	.tread_frames = snd_rawmidi_hw_tread_frames,
 	.ump_endpoint_info = snd_rawmidi_hw_ump_endpoint_info,
 	.ump_block_info = snd_rawmidi_hw_ump_block_info,
 };
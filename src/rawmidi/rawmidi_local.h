@@ -23,6 +23,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <time.h>
 
 typedef struct {
 	int (*close)(snd_rawmidi_t *rawmidi);
@@ -35,6 +36,7 @@ typedef struct {
 	ssize_t (*write)(snd_rawmidi_t *rawmidi, const void *buffer, size_t size);
 	ssize_t (*read)(snd_rawmidi_t *rawmidi, void *buffer, size_t size);
 	ssize_t (*tread)(snd_rawmidi_t *rawmidi, struct timespec *tstamp, void *buffer, size_t size);
+	ssize_t (*tread_frames)(snd_rawmidi_t *rawmidi, snd_rawmidi_frame_t *frames, size_t space);
 	int (*ump_endpoint_info)(snd_rawmidi_t *rmidi, void *buf);
 	int (*ump_block_info)(snd_rawmidi_t *rmidi, void *buf);
 } snd_rawmidi_ops_t;
@@ -53,6 +55,17 @@ struct _snd_rawmidi {
 	size_t avail_min;
 	unsigned int no_active_sensing: 1;
 	int params_mode;
+	/* buffered writer mode (output only), NULL = disabled */
+	char *obuf;			/* staging buffer */
+	size_t obufsize;		/* staging buffer size */
+	size_t obufused;		/* staged byte count */
+	unsigned int obuf_deadline;	/* flush deadline in microseconds, 0 = none */
+	struct timespec obuf_tstamp;	/* time of the oldest staged byte */
+	/* lent input ring for zero-copy reads (input only), NULL = disabled */
+	char *iring;			/* input ring buffer */
+	size_t iringsize;		/* ring size */
+	size_t iring_head;		/* fill position */
+	size_t iring_tail;		/* consume position */
 };
 
 int snd_rawmidi_hw_open(snd_rawmidi_t **input, snd_rawmidi_t **output,
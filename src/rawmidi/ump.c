@@ -307,6 +307,57 @@ ssize_t snd_ump_read(snd_ump_t *ump, void *buffer, size_t size)
 	return snd_rawmidi_read(ump->rawmidi, buffer, size);
 }
 
+/**
+ * \brief lend a persistent input ring to the UMP handle
+ * \param ump UMP handle (input stream only)
+ * \param size ring size in bytes, must be aligned to 4 bytes,
+ *        0 to release the ring
+ * \return 0 on success otherwise a negative error code
+ *
+ * UMP variant of snd_rawmidi_input_ring(); the borrowed slices stay
+ * aligned to the 32bit UMP words as long as only whole packets are
+ * consumed.
+ */
+int snd_ump_input_ring(snd_ump_t *ump, size_t size)
+{
+	if (!ump->is_input || size % 4)
+		return -EINVAL;
+	return snd_rawmidi_input_ring(ump->rawmidi, size);
+}
+
+/**
+ * \brief borrow the next slice of UMP words from the lent ring
+ * \param ump UMP handle (input stream only)
+ * \param buf returned pointer to the borrowed UMP words
+ * \return count of borrowed bytes otherwise a negative error code
+ *
+ * UMP variant of snd_rawmidi_read_begin(); the returned count is in
+ * bytes and covers whole 32bit UMP words.
+ */
+ssize_t snd_ump_read_begin(snd_ump_t *ump, const uint32_t **buf)
+{
+	if (!ump->is_input)
+		return -EINVAL;
+	return snd_rawmidi_read_begin(ump->rawmidi,
+				      (const unsigned char **)buf);
+}
+
+/**
+ * \brief return a borrowed slice of UMP words to the ring
+ * \param ump UMP handle (input stream only)
+ * \param size count of consumed bytes, must be aligned to 4 bytes
+ * \return 0 on success otherwise a negative error code
+ *
+ * UMP variant of snd_rawmidi_read_done(); consume only whole packets
+ * so that the following slices keep the word alignment.
+ */
+int snd_ump_read_done(snd_ump_t *ump, size_t size)
+{
+	if (!ump->is_input || size % 4)
+		return -EINVAL;
+	return snd_rawmidi_read_done(ump->rawmidi, size);
+}
+
 /**
  * \brief read UMP packets from UMP stream with timestamp
  * \param ump UMP handle
@@ -1089,3 +1140,390 @@ int snd_ump_packet_length(unsigned int type)
 		return 0;
 	return packet_length[type];
 }
+
+/*
+ * Batch conversion between UMP packet streams and legacy MIDI 1.0 byte
+ * streams.  The per-message dispatch is table-driven so that dense
+ * streams are translated in a single pass without re-parsing each
+ * message through the accessor helpers.
+ */
+
+/* data byte count of MIDI 1.0 channel voice messages, indexed by the
+ * status nibble; 0 = no channel voice status
+ */
+static const unsigned char midi1_channel_bytes[16] = {
+	0, 0, 0, 0, 0, 0, 0, 0,
+	2, 2, 2, 2, 1, 1, 2, 0,
+};
+
+/* data byte count of MIDI 1.0 system messages, indexed by the low
+ * nibble of the status byte (0xf0 - 0xff); -1 = invalid or sysex
+ */
+static const signed char midi1_system_bytes[16] = {
+	-1, 1, 2, 1, -1, -1, 0, -1,
+	0, -1, 0, 0, 0, -1, 0, 0,
+};
+
+/* down-convert a MIDI 2.0 channel voice packet to MIDI 1.0 bytes;
+ * returns the number of bytes written to tmp (up to 12), 0 = skip
+ */
+static int convert_midi2_to_midi1(const uint32_t *ump, uint8_t *tmp)
+{
+	unsigned char status = snd_ump_msg_status(ump);
+	unsigned char channel = snd_ump_msg_channel(ump);
+	uint32_t data = ump[1];
+	unsigned int val;
+	int n = 0;
+
+	switch (status) {
+	case SND_UMP_MSG_NOTE_OFF:
+	case SND_UMP_MSG_NOTE_ON:
+		tmp[0] = (status << 4) | channel;
+		tmp[1] = snd_ump_get_byte(ump, 2);
+		tmp[2] = (data >> 16) >> 9;
+		/* don't mute a note-on by the down-scaling */
+		if (status == SND_UMP_MSG_NOTE_ON && !tmp[2])
+			tmp[2] = 1;
+		return 3;
+	case SND_UMP_MSG_POLY_PRESSURE:
+	case SND_UMP_MSG_CONTROL_CHANGE:
+		tmp[0] = (status << 4) | channel;
+		tmp[1] = snd_ump_get_byte(ump, 2);
+		tmp[2] = data >> 25;
+		return 3;
+	case SND_UMP_MSG_PROGRAM_CHANGE:
+		if (ump[0] & 1) {	/* bank valid */
+			tmp[n++] = (SND_UMP_MSG_CONTROL_CHANGE << 4) | channel;
+			tmp[n++] = 0;	/* bank select MSB */
+			tmp[n++] = (data >> 8) & 0x7f;
+			tmp[n++] = (SND_UMP_MSG_CONTROL_CHANGE << 4) | channel;
+			tmp[n++] = 32;	/* bank select LSB */
+			tmp[n++] = data & 0x7f;
+		}
+		tmp[n++] = (status << 4) | channel;
+		tmp[n++] = (data >> 24) & 0x7f;
+		return n;
+	case SND_UMP_MSG_CHANNEL_PRESSURE:
+		tmp[0] = (status << 4) | channel;
+		tmp[1] = data >> 25;
+		return 2;
+	case SND_UMP_MSG_PITCHBEND:
+		val = data >> 18;
+		tmp[0] = (status << 4) | channel;
+		tmp[1] = val & 0x7f;
+		tmp[2] = (val >> 7) & 0x7f;
+		return 3;
+	case SND_UMP_MSG_RPN:
+	case SND_UMP_MSG_NRPN:
+		val = data >> 18;
+		tmp[n++] = (SND_UMP_MSG_CONTROL_CHANGE << 4) | channel;
+		tmp[n++] = (status == SND_UMP_MSG_RPN) ? 101 : 99;
+		tmp[n++] = snd_ump_get_byte(ump, 2);
+		tmp[n++] = (SND_UMP_MSG_CONTROL_CHANGE << 4) | channel;
+		tmp[n++] = (status == SND_UMP_MSG_RPN) ? 100 : 98;
+		tmp[n++] = snd_ump_get_byte(ump, 3);
+		tmp[n++] = (SND_UMP_MSG_CONTROL_CHANGE << 4) | channel;
+		tmp[n++] = 6;	/* data entry MSB */
+		tmp[n++] = (val >> 7) & 0x7f;
+		tmp[n++] = (SND_UMP_MSG_CONTROL_CHANGE << 4) | channel;
+		tmp[n++] = 38;	/* data entry LSB */
+		tmp[n++] = val & 0x7f;
+		return n;
+	default:
+		return 0;	/* no MIDI 1.0 equivalent, skip */
+	}
+}
+
+/**
+ * \brief convert a stream of UMP packets to a MIDI 1.0 byte stream
+ * \param ump array of UMP packet words
+ * \param words pointer to the number of available words; the number of
+ *        actually consumed words is stored on return
+ * \param buf buffer to store the converted MIDI 1.0 byte stream
+ * \param maxlen max buffer size in bytes
+ * \return the byte size of the converted stream or a negative error code
+ *
+ * Converts the given UMP packets to the legacy MIDI 1.0 byte stream in
+ * a single pass.  MIDI 1.0 channel voice, system and 7bit SysEx packets
+ * are translated directly, MIDI 2.0 channel voice packets are
+ * down-converted, and the packets without a MIDI 1.0 equivalent
+ * (utility, stream, flex data, 8bit data) are skipped.
+ *
+ * The conversion stops when the output buffer cannot hold the next
+ * message or when the input ends with a truncated packet; the consumed
+ * word count is stored back to \a words, so the caller can pass the
+ * remaining words (together with the following read) to the next call.
+ */
+ssize_t snd_ump_msgs_to_midi1(const uint32_t *ump, size_t *words,
+			      uint8_t *buf, size_t maxlen)
+{
+	size_t avail, produced = 0;
+	unsigned int plen;
+	unsigned char status;
+	uint8_t tmp[12];
+	size_t fill;
+	int n, bytes;
+
+	assert(ump && words && (buf || !maxlen));
+	avail = *words;
+	while (avail > 0) {
+		plen = snd_ump_packet_length(snd_ump_msg_type(ump));
+		if (plen > avail)
+			break;	/* truncated packet */
+		n = 0;
+		switch (snd_ump_msg_type(ump)) {
+		case SND_UMP_MSG_TYPE_SYSTEM:
+			tmp[0] = snd_ump_get_byte(ump, 1);
+			bytes = midi1_system_bytes[tmp[0] & 0x0f];
+			if (tmp[0] >= 0xf0 && bytes >= 0) {
+				tmp[1] = snd_ump_get_byte(ump, 2);
+				tmp[2] = snd_ump_get_byte(ump, 3);
+				n = bytes + 1;
+			}
+			break;
+		case SND_UMP_MSG_TYPE_MIDI1_CHANNEL_VOICE:
+			status = snd_ump_msg_status(ump);
+			bytes = midi1_channel_bytes[status];
+			if (bytes > 0) {
+				tmp[0] = (status << 4) | snd_ump_msg_channel(ump);
+				tmp[1] = snd_ump_get_byte(ump, 2);
+				tmp[2] = snd_ump_get_byte(ump, 3);
+				n = bytes + 1;
+			}
+			break;
+		case SND_UMP_MSG_TYPE_DATA:
+			status = snd_ump_sysex_msg_status(ump);
+			bytes = snd_ump_sysex_msg_length(ump);
+			if (status > SND_UMP_SYSEX_STATUS_END || bytes > 6)
+				break;	/* invalid, skip */
+			if (status == SND_UMP_SYSEX_STATUS_SINGLE ||
+			    status == SND_UMP_SYSEX_STATUS_START)
+				tmp[n++] = 0xf0;
+			fill = expand_sysex_data(ump, tmp + n, sizeof(tmp) - n,
+						 bytes, 8);
+			n += fill;
+			if (status == SND_UMP_SYSEX_STATUS_SINGLE ||
+			    status == SND_UMP_SYSEX_STATUS_END)
+				tmp[n++] = 0xf7;
+			break;
+		case SND_UMP_MSG_TYPE_MIDI2_CHANNEL_VOICE:
+			n = convert_midi2_to_midi1(ump, tmp);
+			break;
+		default:
+			break;	/* no MIDI 1.0 equivalent */
+		}
+		if ((size_t)n > maxlen - produced)
+			break;	/* output full */
+		memcpy(buf + produced, tmp, n);
+		produced += n;
+		ump += plen;
+		avail -= plen;
+	}
+	*words -= avail;
+	return produced;
+}
+
+/* fill a 7bit SysEx data packet (two words) */
+static void fill_sysex7_packet(uint32_t *ump, unsigned int group,
+			       unsigned int status, const uint8_t *data,
+			       unsigned int len)
+{
+	uint32_t w0, w1 = 0;
+	unsigned int i;
+
+	w0 = ((uint32_t)SND_UMP_MSG_TYPE_DATA << 28) | (group << 24) |
+		(status << 20) | (len << 16);
+	for (i = 0; i < len && i < 2; i++)
+		w0 |= (uint32_t)data[i] << (8 - i * 8);
+	for (i = 2; i < len; i++)
+		w1 |= (uint32_t)data[i] << (24 - (i - 2) * 8);
+	ump[0] = w0;
+	ump[1] = w1;
+}
+
+/* fill a system message packet (one word) */
+static inline uint32_t system_packet(unsigned int group, unsigned char status,
+				     unsigned char d1, unsigned char d2)
+{
+	return ((uint32_t)SND_UMP_MSG_TYPE_SYSTEM << 28) | (group << 24) |
+		((uint32_t)status << 16) | ((uint32_t)d1 << 8) | d2;
+}
+
+/**
+ * \brief convert a MIDI 1.0 byte stream to a stream of UMP packets
+ * \param buf buffer containing the MIDI 1.0 byte stream
+ * \param len pointer to the number of available bytes; the number of
+ *        actually consumed bytes is stored on return
+ * \param group UMP group number (0-15) to be stored on the packets
+ * \param ump array to store the converted UMP packet words
+ * \param words max size of the array in 32bit words
+ * \return the number of the converted words or a negative error code
+ *
+ * Converts the given MIDI 1.0 byte stream to UMP packets (MIDI 1.0
+ * channel voice, system and 7bit SysEx data packets) in a single pass.
+ * Running status is handled within the given buffer.
+ *
+ * The conversion stops when the output array cannot hold the next
+ * message or when the input ends in the middle of a message (including
+ * an unterminated SysEx); the consumed byte count is stored back to
+ * \a len, so the caller can pass the remaining bytes (together with
+ * the following data) to the next call.
+ */
+ssize_t snd_ump_msgs_from_midi1(const uint8_t *buf, size_t *len,
+				unsigned int group, uint32_t *ump,
+				size_t words)
+{
+	size_t avail, left = words;
+	unsigned char running = 0;
+	unsigned char c;
+	int bytes;
+
+	assert(buf && len && (ump || !words));
+	avail = *len;
+	group &= 0x0f;
+	while (avail > 0) {
+		c = *buf;
+		if (c >= 0xf8) {	/* realtime message */
+			if (left < 1)
+				break;
+			*ump++ = system_packet(group, c, 0, 0);
+			left--;
+			buf++;
+			avail--;
+			continue;
+		}
+		if (c == 0xf0) {	/* sysex */
+			size_t i, nd = 0, nr = 0, need;
+			uint8_t chunk[6];
+			unsigned int cnt = 0;
+			int complete = 0, first = 1;
+
+			/* pre-scan up to the terminating byte */
+			for (i = 1; i < avail; i++) {
+				if (buf[i] < 0x80)
+					nd++;
+				else if (buf[i] >= 0xf8)
+					nr++;
+				else {
+					complete = 1;
+					break;
+				}
+			}
+			if (!complete)
+				break;	/* wait for the terminator */
+			need = nr + (nd ? (nd + 5) / 6 : 1) * 2;
+			if (need > left)
+				break;	/* output full */
+			for (i = 1; ; i++) {
+				c = buf[i];
+				if (c >= 0xf8) {
+					*ump++ = system_packet(group, c, 0, 0);
+					left--;
+					continue;
+				}
+				if (c < 0x80) {
+					if (cnt == 6) {
+						fill_sysex7_packet(ump, group,
+							first ? SND_UMP_SYSEX_STATUS_START :
+								SND_UMP_SYSEX_STATUS_CONTINUE,
+							chunk, 6);
+						ump += 2;
+						left -= 2;
+						first = 0;
+						cnt = 0;
+					}
+					chunk[cnt++] = c;
+					continue;
+				}
+				/* 0xf7 or another status byte terminates */
+				fill_sysex7_packet(ump, group,
+					first ? SND_UMP_SYSEX_STATUS_SINGLE :
+						SND_UMP_SYSEX_STATUS_END,
+					chunk, cnt);
+				ump += 2;
+				left -= 2;
+				buf += i;
+				avail -= i;
+				if (c == 0xf7) {
+					buf++;
+					avail--;
+				}
+				break;
+			}
+			running = 0;
+			continue;
+		}
+		if (c >= 0x80 && c < 0xf0) {	/* channel voice message */
+			bytes = midi1_channel_bytes[c >> 4];
+			if (avail < (size_t)bytes + 1)
+				break;	/* partial message */
+			if (buf[1] >= 0x80 || (bytes > 1 && buf[2] >= 0x80)) {
+				/* malformed, drop the status byte */
+				buf++;
+				avail--;
+				continue;
+			}
+			if (left < 1)
+				break;
+			*ump++ = ((uint32_t)SND_UMP_MSG_TYPE_MIDI1_CHANNEL_VOICE << 28) |
+				(group << 24) | ((uint32_t)c << 16) |
+				((uint32_t)buf[1] << 8) |
+				(bytes > 1 ? buf[2] : 0);
+			left--;
+			running = c;
+			buf += bytes + 1;
+			avail -= bytes + 1;
+			continue;
+		}
+		if (c >= 0xf1) {	/* system common message */
+			bytes = midi1_system_bytes[c & 0x0f];
+			running = 0;
+			if (bytes < 0) {	/* stray 0xf4/0xf5/0xf7 */
+				buf++;
+				avail--;
+				continue;
+			}
+			if (avail < (size_t)bytes + 1)
+				break;	/* partial message */
+			if ((bytes > 0 && buf[1] >= 0x80) ||
+			    (bytes > 1 && buf[2] >= 0x80)) {
+				buf++;
+				avail--;
+				continue;
+			}
+			if (left < 1)
+				break;
+			*ump++ = system_packet(group, c,
+					       bytes > 0 ? buf[1] : 0,
+					       bytes > 1 ? buf[2] : 0);
+			left--;
+			buf += bytes + 1;
+			avail -= bytes + 1;
+			continue;
+		}
+		/* data byte - apply the running status */
+		if (!running) {	/* stray data byte, skip */
+			buf++;
+			avail--;
+			continue;
+		}
+		bytes = midi1_channel_bytes[running >> 4];
+		if (avail < (size_t)bytes)
+			break;	/* partial message */
+		if (bytes > 1 && buf[1] >= 0x80) {
+			buf++;
+			avail--;
+			continue;
+		}
+		if (left < 1)
+			break;
+		*ump++ = ((uint32_t)SND_UMP_MSG_TYPE_MIDI1_CHANNEL_VOICE << 28) |
+			(group << 24) | ((uint32_t)running << 16) |
+			((uint32_t)buf[0] << 8) | (bytes > 1 ? buf[1] : 0);
+		left--;
+		buf += bytes;
+		avail -= bytes;
+	}
+	*len -= avail;
+	return words - left;
+}
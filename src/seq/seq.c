@@ -1125,6 +1125,7 @@ int snd_seq_close(snd_seq_t *seq)
 	if (seq->dl_handle)
 		snd_dlclose(seq->dl_handle);
 	free(seq->obuf);
+	free(seq->staging);
 	free(seq->ibuf);
 	free(seq->tmpbuf);
 	free(seq->name);
@@ -3555,6 +3556,8 @@ int snd_seq_free_queue(snd_seq_t *seq, int q)
 {
 	snd_seq_queue_info_t info;
 	assert(seq);
+	if (q >= 0 && q < SND_SEQ_TBCACHE_QUEUES)
+		seq->tbcache[q].valid = 0;
 	memset(&info, 0, sizeof(info));
 	info.queue = q;
 	return seq->ops->delete_queue(seq, &info);
@@ -3976,6 +3979,21 @@ void snd_seq_queue_tempo_set_tempo_base(snd_seq_queue_tempo_t *info, unsigned in
 	info->tempo_base = tempo_base;
 }
 
+/* remember the authoritative timebase of a queue for the cached queries */
+static void tbcache_store(snd_seq_t *seq, const snd_seq_queue_tempo_t *tempo)
+{
+	int q = tempo->queue;
+
+	if (q < 0 || q >= SND_SEQ_TBCACHE_QUEUES)
+		return;
+	seq->tbcache[q].tempo = tempo->tempo;
+	seq->tbcache[q].ppq = tempo->ppq;
+	seq->tbcache[q].skew_value = tempo->skew_value;
+	seq->tbcache[q].skew_base = tempo->skew_base;
+	seq->tbcache[q].tempo_base = tempo->tempo_base;
+	seq->tbcache[q].valid = 1;
+}
+
 /**
  * \brief obtain the current tempo of the queue
  * \param seq sequencer handle
@@ -3987,10 +4005,104 @@ void snd_seq_queue_tempo_set_tempo_base(snd_seq_queue_tempo_t *info, unsigned in
  */
 int snd_seq_get_queue_tempo(snd_seq_t *seq, int q, snd_seq_queue_tempo_t * tempo)
 {
+	int err;
+
 	assert(seq && tempo);
 	memset(tempo, 0, sizeof(snd_seq_queue_tempo_t));
 	tempo->queue = q;
-	return seq->ops->get_queue_tempo(seq, tempo);
+	err = seq->ops->get_queue_tempo(seq, tempo);
+	if (err >= 0)
+		tbcache_store(seq, tempo);
+	return err;
+}
+
+/**
+ * \brief obtain the current tempo of the queue from the local cache
+ * \param seq sequencer handle
+ * \param q queue id to be queried
+ * \param tempo pointer to store the current tempo
+ * \return 0 on success otherwise a negative error code
+ *
+ * Like snd_seq_get_queue_tempo(), but answered from a local cache
+ * without a syscall whenever possible.  The cache is primed by the
+ * first (uncached) query or by snd_seq_set_queue_tempo(), and follows
+ * the #SND_SEQ_EVENT_TEMPO and #SND_SEQ_EVENT_QUEUE_SKEW events
+ * received on input, so a client subscribed to the queue's timer
+ * announcements can convert timestamps with
+ * snd_seq_queue_tempo_tick_to_ns() at event rate without ioctls.
+ * Tempo changes the client never sees as events are not reflected;
+ * call snd_seq_get_queue_tempo() to force a resynchronization.
+ *
+ * \sa snd_seq_get_queue_tempo(), snd_seq_queue_tempo_tick_to_ns()
+ */
+int snd_seq_get_queue_tempo_cached(snd_seq_t *seq, int q, snd_seq_queue_tempo_t * tempo)
+{
+	assert(seq && tempo);
+	if (q >= 0 && q < SND_SEQ_TBCACHE_QUEUES && seq->tbcache[q].valid) {
+		memset(tempo, 0, sizeof(snd_seq_queue_tempo_t));
+		tempo->queue = q;
+		tempo->tempo = seq->tbcache[q].tempo;
+		tempo->ppq = seq->tbcache[q].ppq;
+		tempo->skew_value = seq->tbcache[q].skew_value;
+		tempo->skew_base = seq->tbcache[q].skew_base;
+		tempo->tempo_base = seq->tbcache[q].tempo_base;
+		return 0;
+	}
+	return snd_seq_get_queue_tempo(seq, q, tempo);
+}
+
+/**
+ * \brief convert a queue tick time to nanoseconds
+ * \param tempo queue tempo container
+ * \param tick tick time
+ * \return the nominal nanosecond time of the tick
+ *
+ * Pure arithmetic on the tempo container, following the tempo base,
+ * the time resolution and the queue skew; no syscall is involved.
+ *
+ * \sa snd_seq_queue_tempo_ns_to_tick(), snd_seq_get_queue_tempo_cached()
+ */
+unsigned long long snd_seq_queue_tempo_tick_to_ns(const snd_seq_queue_tempo_t *tempo,
+						  snd_seq_tick_time_t tick)
+{
+	unsigned long long ns;
+
+	assert(tempo);
+	if (tempo->ppq <= 0)
+		return 0;
+	ns = (unsigned long long)tick * tempo->tempo *
+		(tempo->tempo_base ? tempo->tempo_base : 1000);
+	ns /= tempo->ppq;
+	if (tempo->skew_value && tempo->skew_base &&
+	    tempo->skew_value != tempo->skew_base)
+		ns = ns * tempo->skew_base / tempo->skew_value;
+	return ns;
+}
+
+/**
+ * \brief convert a nanosecond time to queue ticks
+ * \param tempo queue tempo container
+ * \param ns nanosecond time
+ * \return the tick time corresponding to the nanosecond time
+ *
+ * The inverse of snd_seq_queue_tempo_tick_to_ns().
+ *
+ * \sa snd_seq_queue_tempo_tick_to_ns(), snd_seq_get_queue_tempo_cached()
+ */
+snd_seq_tick_time_t snd_seq_queue_tempo_ns_to_tick(const snd_seq_queue_tempo_t *tempo,
+						   unsigned long long ns)
+{
+	unsigned long long per_quarter;
+
+	assert(tempo);
+	per_quarter = (unsigned long long)tempo->tempo *
+		(tempo->tempo_base ? tempo->tempo_base : 1000);
+	if (!per_quarter || tempo->ppq <= 0)
+		return 0;
+	if (tempo->skew_value && tempo->skew_base &&
+	    tempo->skew_value != tempo->skew_base)
+		ns = ns * tempo->skew_value / tempo->skew_base;
+	return ns * tempo->ppq / per_quarter;
 }
 
 /**
@@ -4004,12 +4116,17 @@ int snd_seq_get_queue_tempo(snd_seq_t *seq, int q, snd_seq_queue_tempo_t * tempo
  */
 int snd_seq_set_queue_tempo(snd_seq_t *seq, int q, snd_seq_queue_tempo_t * tempo)
 {
+	int err;
+
 	assert(seq && tempo);
 	if (!seq->has_queue_tempo_base &&
 	    tempo->tempo_base && tempo->tempo_base != 1000)
 		return -EINVAL;
 	tempo->queue = q;
-	return seq->ops->set_queue_tempo(seq, tempo);
+	err = seq->ops->set_queue_tempo(seq, tempo);
+	if (err >= 0)
+		tbcache_store(seq, tempo);
+	return err;
 }
 
 /**
@@ -4270,16 +4387,26 @@ ssize_t snd_seq_event_length(snd_seq_event_t *ev)
  *    snd_seq_drop_output(), snd_seq_extract_output(),
  *    snd_seq_remove_events()
  */
+static int flush_policy_hit(snd_seq_t *seq);
+
 int snd_seq_event_output(snd_seq_t *seq, snd_seq_event_t *ev)
 {
-	int result;
+	int result, err;
 
 	result = snd_seq_event_output_buffer(seq, ev);
 	if (result == -EAGAIN) {
 		result = snd_seq_drain_output(seq);
 		if (result < 0)
 			return result;
-		return snd_seq_event_output_buffer(seq, ev);
+		result = snd_seq_event_output_buffer(seq, ev);
+	}
+	if (result >= 0 &&
+	    (seq->flush_count > 0 || seq->flush_time > 0) &&
+	    flush_policy_hit(seq)) {
+		/* best effort - keep the events buffered on -EAGAIN */
+		err = snd_seq_drain_output(seq);
+		if (err < 0 && err != -EAGAIN)
+			return err;
 	}
 	return result;
 }
@@ -4324,10 +4451,31 @@ int snd_seq_event_output_buffer(snd_seq_t *seq, snd_seq_event_t *ev)
 			memcpy(seq->obuf + seq->obufused + sizeof(snd_seq_event_t),
 			       ev->data.ext.ptr, ev->data.ext.len);
 	}
+	if (seq->flush_time > 0 && seq->obufused == 0)
+		clock_gettime(CLOCK_MONOTONIC, &seq->obuf_tstamp);
 	seq->obufused += len;
+	seq->obuf_events++;
 	return seq->obufused;
 }
 
+/* check whether the flush policy asks for a drain */
+static int flush_policy_hit(snd_seq_t *seq)
+{
+	struct timespec ts;
+	long diff_us;
+
+	if (seq->flush_count > 0 && seq->obuf_events >= seq->flush_count)
+		return 1;
+	if (seq->flush_time > 0) {
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		diff_us = (ts.tv_sec - seq->obuf_tstamp.tv_sec) * 1000000L +
+			  (ts.tv_nsec - seq->obuf_tstamp.tv_nsec) / 1000L;
+		if (diff_us >= (long)seq->flush_time)
+			return 1;
+	}
+	return 0;
+}
+
 /*
  * allocate the temporary buffer
  */
@@ -4358,10 +4506,16 @@ static int alloc_tmpbuf(snd_seq_t *seq, size_t len)
  * \return the byte size sent to sequencer or a negative error code
  *
  * This function sends an event to the sequencer directly not through the
- * output buffer.  When the event is a variable length event, a temporary
+ * output buffer.  When the event is a variable length event, it is sent
+ * with a vectored write, or - when that is not available - a temporary
  * buffer is allocated inside alsa-lib and the data is copied there before
  * actually sent.
  *
+ * When an output flush policy is set (see #snd_seq_set_output_flush_policy),
+ * the event goes through the output buffer like #snd_seq_event_output and
+ * the buffer is drained according to the policy, so that bursts of direct
+ * outputs are batched into few syscalls.
+ *
  * \sa snd_seq_event_output()
  */
 int snd_seq_event_output_direct(snd_seq_t *seq, snd_seq_event_t *ev)
@@ -4369,12 +4523,21 @@ int snd_seq_event_output_direct(snd_seq_t *seq, snd_seq_event_t *ev)
 	ssize_t len;
 	void *buf;
 
+	if (seq->flush_count > 0 || seq->flush_time > 0)
+		return snd_seq_event_output(seq, ev);
 	clear_ump_for_legacy_apps(seq, ev);
 	len = snd_seq_event_length(ev);
 	if (len < 0)
 		return len;
 	if (snd_seq_ev_is_ump(ev) || !snd_seq_ev_is_variable(ev)) {
 		buf = ev;
+	} else if (seq->ops->writev) {
+		struct iovec iov[2];
+		iov[0].iov_base = ev;
+		iov[0].iov_len = sizeof(snd_seq_event_t);
+		iov[1].iov_base = ev->data.ext.ptr;
+		iov[1].iov_len = ev->data.ext.len;
+		return seq->ops->writev(seq, iov, 2);
 	} else {
 		if (alloc_tmpbuf(seq, (size_t)len) < 0)
 			return -ENOMEM;
@@ -4398,6 +4561,199 @@ int snd_seq_event_output_pending(snd_seq_t *seq)
 	return seq->obufused;
 }
 
+/*
+ * Lock-free output staging ring.
+ *
+ * Producer threads reserve space with a CAS loop on staging_head, fill
+ * the record and publish it by storing the record header word last with
+ * release semantics.  The single draining thread walks the committed
+ * records from staging_tail, appends them to the regular output buffer
+ * and sends them through the usual write path.  A record never wraps
+ * around the ring end; when it would not fit, the remainder of the ring
+ * is padded with a skip marker instead.  Each record is the kernel wire
+ * format of the event (header plus inline variable data), prefixed by
+ * one 32-bit word holding the payload length; a zero word marks a slot
+ * which is reserved but not yet committed.
+ */
+
+#define STAGING_ALIGN		sizeof(unsigned int)
+#define STAGING_SKIP		(~0U)
+#define STAGING_MIN_SIZE	4096
+
+/**
+ * \brief queue an event on the lock-free staging ring
+ * \param seq sequencer handle
+ * \param ev event to be output
+ * \return the byte size of the staged event or a negative error code
+ *
+ * Unlike the other output functions this one may be called from several
+ * threads concurrently without external locking: the event is copied
+ * onto the staging ring set up with #snd_seq_set_output_staging and
+ * becomes visible to the next #snd_seq_drain_output call.  The draining
+ * itself must still be done by a single thread.  Variable length data
+ * is copied onto the ring, so the caller's buffer may be reused as soon
+ * as this function returns.
+ *
+ * \c -EBADFD is returned when no staging ring was set up, \c -EAGAIN
+ * when the ring is full; the caller may then drain (or wait for the
+ * draining thread) and retry.
+ *
+ * \sa snd_seq_set_output_staging(), snd_seq_drain_output()
+ */
+int snd_seq_event_output_staged(snd_seq_t *seq, snd_seq_event_t *ev)
+{
+	unsigned long long head, tail;
+	size_t size, pos, avail, need, pad;
+	ssize_t len;
+	char *rec;
+
+	assert(seq && ev);
+	if (!seq->staging)
+		return -EBADFD;
+	clear_ump_for_legacy_apps(seq, ev);
+	len = snd_seq_event_length(ev);
+	if (len < 0)
+		return -EINVAL;
+	if ((size_t)len >= seq->obufsize)
+		return -EINVAL;
+	size = seq->staging_size;
+	need = STAGING_ALIGN + (((size_t)len + STAGING_ALIGN - 1) & ~(STAGING_ALIGN - 1));
+	if (need > size / 2)
+		return -EINVAL;
+	for (;;) {
+		head = __atomic_load_n(&seq->staging_head, __ATOMIC_RELAXED);
+		tail = __atomic_load_n(&seq->staging_tail, __ATOMIC_ACQUIRE);
+		pos = (size_t)head & (size - 1);
+		avail = size - (size_t)(head - tail);
+		if (pos + need > size) {
+			/* no room before the ring end - pad with a skip marker */
+			pad = size - pos;
+			if (avail < pad)
+				return -EAGAIN;
+			if (!__atomic_compare_exchange_n(&seq->staging_head,
+							 &head, head + pad, 0,
+							 __ATOMIC_ACQ_REL,
+							 __ATOMIC_RELAXED))
+				continue;
+			__atomic_store_n((unsigned int *)(seq->staging + pos),
+					 STAGING_SKIP, __ATOMIC_RELEASE);
+			continue;
+		}
+		if (avail < need)
+			return -EAGAIN;
+		if (__atomic_compare_exchange_n(&seq->staging_head,
+						&head, head + need, 0,
+						__ATOMIC_ACQ_REL,
+						__ATOMIC_RELAXED))
+			break;
+	}
+	rec = seq->staging + pos + STAGING_ALIGN;
+	if (snd_seq_ev_is_ump(ev)) {
+		memcpy(rec, ev, sizeof(snd_seq_ump_event_t));
+	} else {
+		memcpy(rec, ev, sizeof(snd_seq_event_t));
+		if (snd_seq_ev_is_variable(ev))
+			memcpy(rec + sizeof(snd_seq_event_t),
+			       ev->data.ext.ptr, ev->data.ext.len);
+	}
+	__atomic_store_n((unsigned int *)(seq->staging + pos),
+			 (unsigned int)len, __ATOMIC_RELEASE);
+	return len;
+}
+
+/* move committed staged records onto the output buffer;
+ * called only from the single draining thread
+ */
+static void staging_pump(snd_seq_t *seq)
+{
+	unsigned long long head, tail;
+	size_t size = seq->staging_size, pos, rec;
+	unsigned int hdr;
+
+	tail = seq->staging_tail;
+	head = __atomic_load_n(&seq->staging_head, __ATOMIC_ACQUIRE);
+	while (tail != head) {
+		pos = (size_t)tail & (size - 1);
+		hdr = __atomic_load_n((unsigned int *)(seq->staging + pos),
+				      __ATOMIC_ACQUIRE);
+		if (hdr == 0)
+			break;	/* reserved but not yet committed */
+		if (hdr == STAGING_SKIP) {
+			rec = size - pos;
+		} else {
+			if (seq->obufsize - seq->obufused < hdr)
+				break;
+			rec = STAGING_ALIGN +
+				((hdr + STAGING_ALIGN - 1) & ~(STAGING_ALIGN - 1));
+			if (seq->flush_time > 0 && seq->obufused == 0)
+				clock_gettime(CLOCK_MONOTONIC, &seq->obuf_tstamp);
+			memcpy(seq->obuf + seq->obufused,
+			       seq->staging + pos + STAGING_ALIGN, hdr);
+			seq->obufused += hdr;
+			seq->obuf_events++;
+		}
+		__atomic_store_n((unsigned int *)(seq->staging + pos), 0,
+				 __ATOMIC_RELAXED);
+		tail += rec;
+		__atomic_store_n(&seq->staging_tail, tail, __ATOMIC_RELEASE);
+	}
+}
+
+/* note a kernel pool-full incident and grow the output pool (doubling,
+ * up to the configured cap); returns 1 when the pool was grown so the
+ * refused write is worth retrying immediately.  The kernel rejects the
+ * resize with -EBUSY while cells are still in flight; in that case the
+ * wanted size is remembered and installed after a later full drain.
+ */
+static int adapt_pool_full(snd_seq_t *seq)
+{
+	snd_seq_client_pool_t info;
+	unsigned int want;
+	int err;
+
+	seq->pool_full_count++;
+	if (snd_seq_get_client_pool(seq, &info) < 0)
+		return 0;
+	want = info.output_pool * 2;
+	if (want > seq->pool_cap)
+		want = seq->pool_cap;
+	if (want <= (unsigned int)info.output_pool)
+		return 0;		/* already at the cap */
+	info.output_pool = want;
+	err = snd_seq_set_client_pool(seq, &info);
+	if (err < 0) {
+		if (err == -EBUSY)
+			seq->pool_want = want;
+		return 0;
+	}
+	seq->pool_grow_count++;
+	return 1;
+}
+
+/* install a postponed pool grow target; called when the output buffer
+ * ran empty, the most likely moment for the kernel pool to be idle */
+static void adapt_pool_apply(snd_seq_t *seq)
+{
+	snd_seq_client_pool_t info;
+	int err;
+
+	if (snd_seq_get_client_pool(seq, &info) < 0)
+		return;
+	if ((unsigned int)info.output_pool >= seq->pool_want) {
+		seq->pool_want = 0;
+		return;
+	}
+	info.output_pool = seq->pool_want;
+	err = snd_seq_set_client_pool(seq, &info);
+	if (err < 0) {
+		if (err != -EBUSY)
+			seq->pool_want = 0;	/* do not retry forever */
+		return;
+	}
+	seq->pool_grow_count++;
+	seq->pool_want = 0;
+}
+
 /**
  * \brief drain output buffer to sequencer
  * \param seq sequencer handle
@@ -4417,9 +4773,14 @@ int snd_seq_drain_output(snd_seq_t *seq)
 {
 	ssize_t result, processed = 0;
 	assert(seq);
+	if (seq->staging)
+		staging_pump(seq);
 	while (seq->obufused > 0) {
 		result = seq->ops->write(seq, seq->obuf, seq->obufused);
 		if (result < 0) {
+			if (result == -EAGAIN && seq->pool_cap > 0 &&
+			    adapt_pool_full(seq))
+				continue;
 			if (result == -EAGAIN && processed)
 				return seq->obufused;
 			return result;
@@ -4427,7 +4788,169 @@ int snd_seq_drain_output(snd_seq_t *seq)
 		if ((size_t)result < seq->obufused)
 			memmove(seq->obuf, seq->obuf + result, seq->obufused - result);
 		seq->obufused -= result;
+		if (seq->staging && seq->obufused == 0)
+			staging_pump(seq);
+	}
+	seq->obuf_events = 0;
+	if (seq->pool_want > 0)
+		adapt_pool_apply(seq);
+	return 0;
+}
+
+/**
+ * \brief drain output buffer without blocking the caller
+ * \param seq sequencer handle
+ * \return 0 when all events are drained and sent to sequencer.
+ *         When events still remain on the buffer, the byte size of remaining
+ *         events are returned.  On error a negative error code is returned.
+ *
+ * Like #snd_seq_drain_output, but the call never blocks even when the
+ * sequencer handle was opened in blocking mode: events which cannot be
+ * written without waiting for pool space stay on the output buffer.
+ * This is meant for producer threads which must not stall; the remaining
+ * events can be drained later.
+ *
+ * \sa snd_seq_drain_output()
+ */
+int snd_seq_drain_output_nowait(snd_seq_t *seq)
+{
+	int nonblock, err, res;
+
+	assert(seq);
+	nonblock = !!(seq->mode & SND_SEQ_NONBLOCK);
+	if (!nonblock) {
+		err = seq->ops->nonblock(seq, 1);
+		if (err < 0)
+			return err;
+	}
+	res = snd_seq_drain_output(seq);
+	if (res == -EAGAIN)
+		res = seq->obufused;
+	if (!nonblock)
+		seq->ops->nonblock(seq, 0);
+	return res;
+}
+
+/**
+ * \brief set the automatic flush policy for the output buffer
+ * \param seq sequencer handle
+ * \param count drain the buffer when this many events are buffered, 0 to disable
+ * \param time_us drain the buffer when the oldest buffered event is this
+ *        many microseconds old, 0 to disable
+ * \return 0 on success otherwise a negative error code
+ *
+ * By default (both thresholds zero) the output buffer is drained only
+ * when it becomes full or when #snd_seq_drain_output is called, and
+ * #snd_seq_event_output_direct issues one syscall per event.  With a
+ * flush policy set, direct outputs are buffered as well and the buffer
+ * is drained automatically from the output functions whenever one of
+ * the thresholds is exceeded, reducing the syscall rate for high
+ * frequency event producers.
+ *
+ * \sa snd_seq_event_output(), snd_seq_event_output_direct()
+ */
+int snd_seq_set_output_flush_policy(snd_seq_t *seq, unsigned int count,
+				    unsigned int time_us)
+{
+	assert(seq);
+	seq->flush_count = count;
+	seq->flush_time = time_us;
+	return 0;
+}
+
+/**
+ * \brief let the kernel output pool grow on demand
+ * \param seq sequencer handle
+ * \param max_size pool size limit in cells, 0 to disable adaptive sizing
+ * \return 0 on success otherwise a negative error code
+ *
+ * By default the kernel output pool has a fixed size and a burst
+ * overrunning it makes the drain block or fail with -EAGAIN, which
+ * usually ends in hand-tuned #snd_seq_set_client_pool_output calls per
+ * deployment.  With adaptive sizing enabled, every pool-full incident
+ * doubles the pool (up to \a max_size) through the pool ioctls, so the
+ * pool converges on the size the actual traffic needs.  The kernel
+ * refuses to resize a pool with undelivered events; such a grow is
+ * retried automatically after a later complete drain.
+ *
+ * \sa snd_seq_get_output_pool_stats(), snd_seq_set_client_pool_output()
+ */
+int snd_seq_set_output_pool_adaptive(snd_seq_t *seq, size_t max_size)
+{
+	assert(seq);
+	seq->pool_cap = max_size;
+	if (max_size == 0)
+		seq->pool_want = 0;
+	return 0;
+}
+
+/**
+ * \brief read the adaptive output pool statistics
+ * \param seq sequencer handle
+ * \param full_count returns the number of pool-full incidents seen, may be NULL
+ * \param grow_count returns the number of successful pool resizes, may be NULL
+ * \return 0 on success otherwise a negative error code
+ *
+ * The counters accumulate since the handle was opened.  The current
+ * pool size and free space can be obtained with
+ * #snd_seq_get_client_pool.
+ *
+ * \sa snd_seq_set_output_pool_adaptive(), snd_seq_get_client_pool()
+ */
+int snd_seq_get_output_pool_stats(snd_seq_t *seq, unsigned int *full_count,
+				  unsigned int *grow_count)
+{
+	assert(seq);
+	if (full_count)
+		*full_count = seq->pool_full_count;
+	if (grow_count)
+		*grow_count = seq->pool_grow_count;
+	return 0;
+}
+
+/**
+ * \brief set up a lock-free staging ring for multi-threaded output
+ * \param seq sequencer handle
+ * \param size requested ring size in bytes, 0 to release the ring
+ * \return 0 on success otherwise a negative error code
+ *
+ * Allocates a lock-free staging ring so that several producer threads
+ * can queue events concurrently with #snd_seq_event_output_staged while
+ * a single thread flushes them with #snd_seq_drain_output; no external
+ * locking is needed between the producers and the drainer.  The given
+ * size is rounded up to a power of two (at least 4 kB).
+ *
+ * This function itself is not thread safe: call it before the producer
+ * threads are started, and release the ring (size 0) only after they
+ * have stopped and the ring has been drained.  Any events still staged
+ * when the ring is released are discarded.
+ *
+ * \sa snd_seq_event_output_staged(), snd_seq_drain_output()
+ */
+int snd_seq_set_output_staging(snd_seq_t *seq, size_t size)
+{
+	char *buf;
+	size_t rsize;
+
+	assert(seq);
+	if (size == 0) {
+		free(seq->staging);
+		seq->staging = NULL;
+		seq->staging_size = 0;
+		return 0;
 	}
+	rsize = STAGING_MIN_SIZE;
+	while (rsize < size)
+		rsize <<= 1;
+	/* the ring must be zeroed - a zero header marks a free slot */
+	buf = calloc(1, rsize);
+	if (buf == NULL)
+		return -ENOMEM;
+	free(seq->staging);
+	seq->staging = buf;
+	seq->staging_size = rsize;
+	seq->staging_head = 0;
+	seq->staging_tail = 0;
 	return 0;
 }
 
@@ -4462,6 +4985,8 @@ int snd_seq_extract_output(snd_seq_t *seq, snd_seq_event_t **ev_res)
 	}
 	seq->obufused = olen - len;
 	memmove(seq->obuf, seq->obuf + len, seq->obufused);
+	if (seq->obuf_events > 0)
+		seq->obuf_events--;
 	return 0;
 }
 
@@ -4484,9 +5009,29 @@ static ssize_t snd_seq_event_read_buffer(snd_seq_t *seq)
 		return len;
 	seq->ibuflen = len / packet_size;
 	seq->ibufptr = 0;
+	seq->ibuflast = seq->ibuflen;
 	return seq->ibuflen;
 }
 
+/* follow the tempo/skew changes flowing through the input so the
+ * cached queue timebases stay current without extra ioctls
+ */
+static void tbcache_update_event(snd_seq_t *seq, const snd_seq_event_t *ev)
+{
+	int q;
+
+	if (ev->type != SND_SEQ_EVENT_TEMPO &&
+	    ev->type != SND_SEQ_EVENT_QUEUE_SKEW)
+		return;
+	q = ev->data.queue.queue;
+	if (q < 0 || q >= SND_SEQ_TBCACHE_QUEUES || !seq->tbcache[q].valid)
+		return;
+	if (ev->type == SND_SEQ_EVENT_TEMPO)
+		seq->tbcache[q].tempo = ev->data.queue.param.value;
+	else
+		seq->tbcache[q].skew_value = ev->data.queue.param.value;
+}
+
 static int snd_seq_event_retrieve_buffer(snd_seq_t *seq, snd_seq_event_t **retp)
 {
 	size_t packet_size = get_packet_size(seq);
@@ -4495,6 +5040,7 @@ static int snd_seq_event_retrieve_buffer(snd_seq_t *seq, snd_seq_event_t **retp)
 
 	*retp = ev = (snd_seq_event_t *)(seq->ibuf + seq->ibufptr * packet_size);
 	clear_ump_for_legacy_apps(seq, ev);
+	tbcache_update_event(seq, ev);
 	seq->ibufptr++;
 	seq->ibuflen--;
 	if (! snd_seq_ev_is_variable(ev))
@@ -4596,6 +5142,28 @@ int snd_seq_event_input_pending(snd_seq_t *seq, int fetch_sequencer)
 	return seq->ibuflen;
 }
 
+/**
+ * \brief return the number of events fetched by the last kernel read
+ * \param seq sequencer handle
+ * \return the number of event packets the last read from the sequencer
+ *         FIFO carried
+ *
+ * The input events are received in batches, one read syscall per
+ * refill of the input buffer.  This function tells how many event
+ * packets the last refill returned in one go, without touching the
+ * buffer state.  When dense event bursts keep filling the buffer
+ * completely, the syscall cost can be amortized further by enlarging
+ * it with snd_seq_set_input_buffer_size().
+ *
+ * \sa snd_seq_event_input(), snd_seq_event_input_pending(),
+ *     snd_seq_set_input_buffer_size()
+ */
+int snd_seq_event_input_batch_size(snd_seq_t *seq)
+{
+	assert(seq);
+	return seq->ibuflast;
+}
+
 /*----------------------------------------------------------------*/
 
 /*
@@ -4721,6 +5289,7 @@ int snd_seq_drop_output_buffer(snd_seq_t *seq)
 {
 	assert(seq);
 	seq->obufused = 0;
+	seq->obuf_events = 0;
 	return 0;
 }
 
@@ -4735,6 +5304,7 @@ int snd_seq_drop_input_buffer(snd_seq_t *seq)
 	assert(seq);
 	seq->ibufptr = 0;
 	seq->ibuflen = 0;
+	seq->ibuflast = 0;
 	return 0;
 }
 
@@ -390,6 +390,15 @@ static ssize_t snd_seq_hw_write(snd_seq_t *seq, void *buf, size_t len)
 	return result;
 }
 
+static ssize_t snd_seq_hw_writev(snd_seq_t *seq, const struct iovec *iov, int iovcnt)
+{
+	snd_seq_hw_t *hw = seq->private_data;
+	ssize_t result = writev(hw->fd, iov, iovcnt);
+	if (result < 0)
+		return -errno;
+	return result;
+}
+
 static ssize_t snd_seq_hw_read(snd_seq_t *seq, void *buf, size_t len)
 {
 	snd_seq_hw_t *hw = seq->private_data;
@@ -482,6 +491,7 @@ static const snd_seq_ops_t snd_seq_hw_ops = {
 	.set_queue_info = snd_seq_hw_set_queue_info,
 	.get_named_queue = snd_seq_hw_get_named_queue,
 	.write = snd_seq_hw_write,
+	.writev = snd_seq_hw_writev,
 	.read = snd_seq_hw_read,
 	.remove_events = snd_seq_hw_remove_events,
 	.get_client_pool = snd_seq_hw_get_client_pool,
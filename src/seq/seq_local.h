@@ -27,6 +27,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <time.h>
+#include <sys/uio.h>
 
 #define SND_SEQ_OBUF_SIZE	(16*1024)	/* default size */
 #define SND_SEQ_IBUF_SIZE	500		/* in event_size aligned */
@@ -64,6 +66,7 @@ typedef struct {
 	int (*set_queue_info)(snd_seq_t *seq, snd_seq_queue_info_t *info);
 	int (*get_named_queue)(snd_seq_t *seq, snd_seq_queue_info_t *info);
 	ssize_t (*write)(snd_seq_t *seq, void *buf, size_t len);
+	ssize_t (*writev)(snd_seq_t *seq, const struct iovec *iov, int iovcnt);
 	ssize_t (*read)(snd_seq_t *seq, void *buf, size_t len);
 	int (*remove_events)(snd_seq_t *seq, snd_seq_remove_events_t *rmp);
 	int (*get_client_pool)(snd_seq_t *seq, snd_seq_client_pool_t *info);
@@ -86,16 +89,45 @@ struct _snd_seq {
 	char *obuf;		/* output buffer */
 	size_t obufsize;		/* output buffer size */
 	size_t obufused;		/* output buffer used size */
+	/* output flush policy, 0 = disabled */
+	unsigned int flush_count;	/* drain after this many buffered events */
+	unsigned int flush_time;	/* drain after this many microseconds */
+	unsigned int obuf_events;	/* buffered event count */
+	struct timespec obuf_tstamp;	/* time of the first buffered event */
+	/* lock-free output staging ring, NULL = disabled */
+	char *staging;			/* staging ring buffer */
+	size_t staging_size;		/* ring size, power of two */
+	unsigned long long staging_head;	/* producer reserve cursor */
+	unsigned long long staging_tail;	/* consumer cursor */
+	/* adaptive output pool sizing, 0 = disabled */
+	unsigned int pool_cap;		/* output pool growth limit (cells) */
+	unsigned int pool_want;		/* postponed grow target, 0 = none */
+	unsigned int pool_full_count;	/* kernel pool-full incidents seen */
+	unsigned int pool_grow_count;	/* successful pool grow operations */
 	char *ibuf;		/* input buffer */
 	size_t ibufptr;		/* current pointer of input buffer */
 	size_t ibuflen;		/* queued length */
 	size_t ibufsize;		/* input buffer size */
+	size_t ibuflast;	/* events fetched by the last kernel read */
 	snd_seq_event_t *tmpbuf;	/* temporary event for extracted event */
 	size_t tmpbufsize;		/* size of errbuf */
 	size_t packet_size;		/* input packet alignment size */
 	int midi_version;	/* current protocol version */
 	int has_queue_tempo_base;	/* support queue tempo-base? */
 
+	/* cached queue timebases, indexed by queue id; refreshed from the
+	 * tempo ioctls and from tempo/skew events seen on input
+	 */
+#define SND_SEQ_TBCACHE_QUEUES	32
+	struct {
+		unsigned char valid;
+		unsigned short tempo_base;	/* ns unit of tempo, 0 = 1000 */
+		unsigned int tempo;		/* tempo units per quarter */
+		int ppq;			/* ticks per quarter */
+		unsigned int skew_value;
+		unsigned int skew_base;
+	} tbcache[SND_SEQ_TBCACHE_QUEUES];
+
 	unsigned int num_ump_groups;		/* number of UMP groups */
 	snd_ump_endpoint_info_t *ump_ep;	/* optional UMP info */
 	snd_ump_block_info_t *ump_blks[16];	/* optional UMP block info */
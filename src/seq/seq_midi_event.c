@@ -128,6 +128,46 @@ static const struct extra_event_list_t {
 };
 
 #define numberof(ary)	(sizeof(ary)/sizeof(ary[0]))
+
+/*
+ * direct dispatch tables, built once at the first parser creation:
+ * a status byte indexes its parser state and an event type indexes its
+ * entry in status_event[] (or extra_event[], marked by the high bit)
+ * without scanning the lists per byte or per event
+ */
+static struct {
+	unsigned char type;	/* index into status_event[] */
+	signed char qlen;	/* bytes following the status byte */
+} status_dispatch[256];
+static unsigned char event_dispatch[256];
+static int dispatch_ready;
+
+#define EV_DISPATCH_NONE	0xff
+#define EV_DISPATCH_EXTRA	0x80
+
+static void build_dispatch_tables(void)
+{
+	unsigned int c, i;
+
+	for (c = 0; c < 256; c++) {
+		if (c < 0x80)
+			status_dispatch[c].type = ST_INVALID;
+		else if (c < 0xf0)
+			status_dispatch[c].type = (c >> 4) & 0x07;
+		else
+			status_dispatch[c].type = (c & 0x0f) + ST_SPECIAL;
+		status_dispatch[c].qlen =
+			status_event[status_dispatch[c].type].qlen;
+	}
+	memset(event_dispatch, EV_DISPATCH_NONE, sizeof(event_dispatch));
+	for (i = 0; i < numberof(status_event); i++)
+		if (status_event[i].event != SND_SEQ_EVENT_NONE &&
+		    event_dispatch[status_event[i].event] == EV_DISPATCH_NONE)
+			event_dispatch[status_event[i].event] = i;
+	for (i = 0; i < numberof(extra_event); i++)
+		event_dispatch[extra_event[i].event] = EV_DISPATCH_EXTRA | i;
+	dispatch_ready = 1;
+}
 #endif /* DOC_HIDDEN */
 
 /**
@@ -154,6 +194,8 @@ int snd_midi_event_new(size_t bufsize, snd_midi_event_t **rdev)
 	snd_midi_event_t *dev;
 
 	*rdev = NULL;
+	if (!dispatch_ready)
+		build_dispatch_tables();
 	dev = (snd_midi_event_t *)calloc(1, sizeof(snd_midi_event_t));
 	if (dev == NULL)
 		return -ENOMEM;
@@ -366,6 +408,34 @@ long snd_midi_event_encode(snd_midi_event_t *dev, const unsigned char *buf, long
 
 	ev->type = SND_SEQ_EVENT_NONE;
 
+	/* bulk-copy the body of a system exclusive message instead of
+	 * pushing the bytes one by one through the state machine
+	 */
+	while (count > 0 && dev->type == ST_SYSEX && dev->read > 0 &&
+	       *buf < 0x80) {
+		size_t n, space = dev->bufsize - dev->read;
+
+		for (n = 1; n < (size_t)count && buf[n] < 0x80; n++)
+			;
+		if (n > space)
+			n = space;
+		memcpy(dev->buf + dev->read, buf, n);
+		dev->read += n;
+		buf += n;
+		count -= n;
+		result += n;
+		if (dev->read >= dev->bufsize) {
+			/* buffer full - emit this part of the message */
+			ev->flags &= ~SND_SEQ_EVENT_LENGTH_MASK;
+			ev->flags |= SND_SEQ_EVENT_LENGTH_VARIABLE;
+			ev->type = SND_SEQ_EVENT_SYSEX;
+			ev->data.ext.len = dev->read;
+			ev->data.ext.ptr = dev->buf;
+			dev->read = 0; /* continue to parse */
+			return result;
+		}
+	}
+
 	while (count-- > 0) {
 		rc = snd_midi_event_encode_byte(dev, *buf++, ev);
 		result++;
@@ -378,6 +448,97 @@ long snd_midi_event_encode(snd_midi_event_t *dev, const unsigned char *buf, long
 	return result;
 }
 
+/**
+ * \brief Encodes bytes to sequencer event without copying sysex data.
+ * \param[in] dev MIDI event parser.
+ * \param[in] buf Buffer containing bytes of a raw MIDI stream.
+ * \param[in] count Number of bytes in \a buf.
+ * \param[out] ev Sequencer event.
+ * \return The number of bytes consumed, or a negative error code.
+ *
+ * Like #snd_midi_event_encode, but when a complete System Exclusive
+ * message lies at the beginning of the buffer, the returned event
+ * references the message bytes in the caller's buffer directly instead
+ * of copying them into the parser's buffer.  Such an event is valid
+ * only as long as the caller's buffer is, so it has to be output (e.g.
+ * with #snd_seq_event_output_direct, which sends the referenced data
+ * with a vectored write) before the buffer is reused.  In all other
+ * cases the function behaves exactly like #snd_midi_event_encode.
+ *
+ * \sa snd_midi_event_encode
+ */
+long snd_midi_event_encode_direct(snd_midi_event_t *dev, const unsigned char *buf, long count, snd_seq_event_t *ev)
+{
+	long i;
+
+	ev->type = SND_SEQ_EVENT_NONE;
+
+	if (dev->read == 0 && count > 1 && buf[0] == MIDI_CMD_COMMON_SYSEX) {
+		for (i = 1; i < count && buf[i] < 0x80; i++)
+			;
+		if (i < count && buf[i] == MIDI_CMD_COMMON_SYSEX_END) {
+			ev->flags &= ~SND_SEQ_EVENT_LENGTH_MASK;
+			ev->flags |= SND_SEQ_EVENT_LENGTH_VARIABLE;
+			ev->type = SND_SEQ_EVENT_SYSEX;
+			ev->data.ext.len = i + 1;
+			ev->data.ext.ptr = (void *)buf;
+			reset_encode(dev);
+			return i + 1;
+		}
+	}
+	return snd_midi_event_encode(dev, buf, count, ev);
+}
+
+/**
+ * \brief Encodes bytes to an array of sequencer events.
+ * \param[in] dev MIDI event parser.
+ * \param[in] buf Buffer containing bytes of a raw MIDI stream.
+ * \param[in] count Number of bytes in \a buf.
+ * \param[out] evs Array receiving the sequencer events.
+ * \param[in] max_events Capacity of the \a evs array.
+ * \param[out] nevents Number of events written to \a evs.
+ * \return The number of bytes consumed, or a negative error code.
+ *
+ * Like #snd_midi_event_encode, but consumes the buffer in one call and
+ * emits one event per complete MIDI message, so a whole rawmidi read
+ * chunk can be encoded without re-entering the parser per event.  The
+ * events are cleared before encoding; any incomplete message at the end
+ * of the buffer is kept in the parser state as usual.
+ *
+ * The function stops early when the event array is full or after
+ * a System Exclusive event has been emitted, since such an event
+ * references the parser's buffer which the next message would reuse;
+ * the remaining bytes are left unconsumed for the next call.
+ *
+ * \sa snd_midi_event_encode, snd_midi_event_encode_byte
+ */
+long snd_midi_event_encode_buffer(snd_midi_event_t *dev,
+				  const unsigned char *buf, long count,
+				  snd_seq_event_t *evs, long max_events,
+				  long *nevents)
+{
+	long result = 0, used;
+	snd_seq_event_t *ev;
+
+	*nevents = 0;
+	while (count > 0 && *nevents < max_events) {
+		ev = &evs[*nevents];
+		memset(ev, 0, sizeof(*ev));
+		used = snd_midi_event_encode(dev, buf, count, ev);
+		if (used < 0)
+			return *nevents > 0 ? result : used;
+		buf += used;
+		count -= used;
+		result += used;
+		if (ev->type == SND_SEQ_EVENT_NONE)
+			break;
+		(*nevents)++;
+		if (ev->type == SND_SEQ_EVENT_SYSEX)
+			break;
+	}
+	return result;
+}
+
 /**
  * \brief Encodes byte to sequencer event.
  * \param[in] dev MIDI event parser.
@@ -415,12 +576,9 @@ int snd_midi_event_encode_byte(snd_midi_event_t *dev, int c, snd_seq_event_t *ev
 	    (c != MIDI_CMD_COMMON_SYSEX_END || dev->type != ST_SYSEX)) {
 		/* new command */
 		dev->buf[0] = c;
-		if ((c & 0xf0) == 0xf0) /* system message */
-			dev->type = (c & 0x0f) + ST_SPECIAL;
-		else
-			dev->type = (c >> 4) & 0x07;
+		dev->type = status_dispatch[c].type;
 		dev->read = 1;
-		dev->qlen = status_event[dev->type].qlen;
+		dev->qlen = status_dispatch[c].qlen;
 	} else {
 		if (dev->qlen > 0) {
 			/* rest of command */
@@ -565,17 +723,12 @@ long snd_midi_event_decode(snd_midi_event_t *dev, unsigned char *buf, long count
 	if (ev->type == SND_SEQ_EVENT_NONE)
 		return -ENOENT;
 
-	for (type = 0; type < numberof(status_event); type++) {
-		if (ev->type == status_event[type].event)
-			goto __found;
-	}
-	for (type = 0; type < numberof(extra_event); type++) {
-		if (ev->type == extra_event[type].event)
-			return extra_event[type].decode(dev, buf, count, ev);
-	}
-	return -ENOENT;
+	type = event_dispatch[ev->type];
+	if (type == EV_DISPATCH_NONE)
+		return -ENOENT;
+	if (type & EV_DISPATCH_EXTRA)
+		return extra_event[type & ~EV_DISPATCH_EXTRA].decode(dev, buf, count, ev);
 
-      __found:
 	if (type >= ST_SPECIAL)
 		cmd = 0xf0 + (type - ST_SPECIAL);
 	else
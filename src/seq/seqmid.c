@@ -55,6 +55,53 @@ int snd_seq_control_queue(snd_seq_t *seq, int q, int type, int value, snd_seq_ev
 	return snd_seq_event_output(seq, ev);
 }
 
+/**
+ * \brief queue controls - batched version
+ * \param seq sequencer handle
+ * \param q queue id to control
+ * \param cmds array of control commands
+ * \param count number of commands in \a cmds
+ * \param ev event instance
+ * \return 0 when all commands are packed and drained, the byte size of
+ *         remaining buffered events, or a negative error code
+ *
+ * Packs the given control commands into the output buffer and drains it
+ * once at the end, so a composite transport operation (e.g. stop, tempo
+ * change and position update at a locate) costs a single kernel write
+ * instead of one round trip per command.  \a ev is used as the template
+ * for every command like in #snd_seq_control_queue; when NULL, the
+ * commands are sent directly.
+ *
+ * \sa snd_seq_control_queue()
+ */
+int snd_seq_control_queue_batch(snd_seq_t *seq, int q,
+				const snd_seq_queue_control_cmd_t *cmds,
+				int count, snd_seq_event_t *ev)
+{
+	snd_seq_event_t tmpev;
+	int i, err;
+
+	assert(seq && (cmds || count == 0));
+	if (ev == NULL) {
+		snd_seq_ev_clear(&tmpev);
+		ev = &tmpev;
+		snd_seq_ev_set_direct(ev);
+	}
+	for (i = 0; i < count; i++) {
+		snd_seq_ev_set_queue_control(ev, cmds[i].type, q, cmds[i].value);
+		err = snd_seq_event_output_buffer(seq, ev);
+		if (err == -EAGAIN) {
+			err = snd_seq_drain_output(seq);
+			if (err < 0)
+				return err;
+			err = snd_seq_event_output_buffer(seq, ev);
+		}
+		if (err < 0)
+			return err;
+	}
+	return snd_seq_drain_output(seq);
+}
+
 
 /**
  * \brief create a port - simple version
@@ -400,12 +447,71 @@ int snd_seq_sync_output_queue(snd_seq_t *seq)
 	pfd.fd = seq->poll_fd;
 	pfd.events = POLLOUT;
 	err = poll(&pfd, 1, -1);
-	/* restore the room size */ 
+	/* restore the room size */
 	info.output_room = saved_room;
 	snd_seq_set_client_pool(seq, &info);
 	return err;
 }
 
+/**
+ * \brief request an event-driven queue sync
+ * \param seq sequencer handle
+ * \param q queue id to sync with
+ * \param port own port receiving the completion event
+ * \param cookie caller chosen value identifying this request
+ * \return 0 on success or negative error code
+ *
+ * Schedules an echo event to the own client on the given queue at the
+ * current queue time and drains the output buffer.  The echo is
+ * dispatched after every event scheduled up to that time has been
+ * delivered, so when it arrives on input the queue has caught up with
+ * the request - without blocking the caller like
+ * #snd_seq_sync_output_queue does.  Detect the completion in the normal
+ * event loop with #snd_seq_sync_queue_done, using \a cookie to tell
+ * concurrent requests apart.
+ *
+ * \sa snd_seq_sync_queue_done(), snd_seq_sync_output_queue()
+ */
+int snd_seq_sync_queue_request(snd_seq_t *seq, int q, int port,
+			       unsigned int cookie)
+{
+	snd_seq_event_t ev;
+	int err;
+
+	assert(seq);
+	snd_seq_ev_clear(&ev);
+	ev.type = SND_SEQ_EVENT_ECHO;
+	snd_seq_ev_set_source(&ev, port);
+	snd_seq_ev_set_dest(&ev, seq->client, port);
+	snd_seq_ev_schedule_tick(&ev, q, 1, 0);	/* relative "now" */
+	ev.data.raw32.d[0] = cookie;
+	err = snd_seq_event_output(seq, &ev);
+	if (err < 0)
+		return err;
+	err = snd_seq_drain_output(seq);
+	if (err < 0)
+		return err;
+	return 0;
+}
+
+/**
+ * \brief check whether an input event completes a queue sync request
+ * \param seq sequencer handle
+ * \param ev input event to examine
+ * \param cookie the value passed to #snd_seq_sync_queue_request
+ * \return 1 when \a ev is the matching completion event, 0 otherwise
+ *
+ * \sa snd_seq_sync_queue_request()
+ */
+int snd_seq_sync_queue_done(snd_seq_t *seq, const snd_seq_event_t *ev,
+			    unsigned int cookie)
+{
+	assert(seq && ev);
+	return ev->type == SND_SEQ_EVENT_ECHO &&
+	       ev->source.client == seq->client &&
+	       ev->data.raw32.d[0] == cookie;
+}
+
 /**
  * \brief parse the given string and get the sequencer address
  * \param seq sequencer handle
@@ -669,9 +775,10 @@ static void update_group_ports(snd_seq_t *seq, snd_ump_endpoint_info_t *ep)
 			if (!*bp->name)
 				continue;
 			if (*blknames) {
-				strlcat(blknames, ", ", sizeof(blknames));
-				strlcat(blknames, (const char *)bp->name,
-					sizeof(blknames));
+				size_t len = strlen(blknames);
+				snprintf(blknames + len,
+					 sizeof(blknames) - len, ", %s",
+					 (const char *)bp->name);
 			} else {
 				snd_strlcpy(blknames, (const char *)bp->name,
 					    sizeof(blknames));
@@ -40,6 +40,8 @@
 #endif
 #include <string.h>
 #include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
 #include <poll.h>
 #include <sys/mman.h>
 #include <sys/shm.h>
@@ -48,8 +50,10 @@
 #ifndef DOC_HIDDEN
 struct snd_shm_area {
 	struct list_head list;
-	int shmid;
+	int shmid;	/* IPC SHM ID, -1 for a memfd backed area */
+	int memfd;	/* memfd descriptor, -1 for an IPC SHM area */
 	void *ptr;
+	size_t size;	/* mapping size (memfd backed areas only) */
 	int share;
 };
 #endif
@@ -70,13 +74,115 @@ struct snd_shm_area *snd_shm_area_create(int shmid, void *ptr)
 	struct snd_shm_area *area = malloc(sizeof(*area));
 	if (area) {
 		area->shmid = shmid;
+		area->memfd = -1;
 		area->ptr = ptr;
+		area->size = 0;
 		area->share = 1;
 		list_add_tail(&area->list, &shm_areas);
 	}
 	return area;
 }
 
+#ifdef HAVE_MEMFD_CREATE
+
+#ifndef DOC_HIDDEN
+/* the most common hugepage size; when the actual default differs,
+ * the hugetlb attempt fails and the normal page path is taken
+ */
+#define SHM_AREA_HUGETLB_SIZE	(2UL * 1024 * 1024)
+#endif
+
+static void *shm_area_memfd_map(int *_fd, const char *name, size_t size,
+				unsigned int flags)
+{
+	void *ptr;
+	int fd;
+
+	fd = memfd_create(name, flags | MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (fd < 0)
+		return MAP_FAILED;
+	if (ftruncate(fd, size) < 0)
+		goto _err;
+#ifdef F_ADD_SEALS
+	/* the area has a fixed size for its whole lifetime; sealing is
+	 * only a hardening measure, thus a failure is not fatal
+	 */
+	fcntl(fd, F_ADD_SEALS, F_SEAL_GROW | F_SEAL_SHRINK | F_SEAL_SEAL);
+#endif
+	ptr = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	if (ptr == MAP_FAILED)
+		goto _err;
+	*_fd = fd;
+	return ptr;
+ _err:
+	close(fd);
+	return MAP_FAILED;
+}
+
+/**
+ * \brief Create a memfd backed shm area record
+ * \param name the area name (debugging aid, shows up in /proc)
+ * \param size the requested area size in bytes
+ * \param ptr the pointer to store the mapped area address
+ * \return The allocated shm area record, NULL if fail
+ *
+ * Allocates an anonymous memory area via \c memfd_create, seals its size
+ * and maps it. Unlike the IPC SHM areas, the memfd areas are not accounted
+ * against the \c shmmax / \c shmall limits. For large areas a hugepage
+ * backing is tried first and the normal page size is used as a fallback.
+ * The record has a reference counter, which is initialized to 1.
+ */
+struct snd_shm_area *snd_shm_area_create_memfd(const char *name, size_t size,
+					       void **ptr)
+{
+	struct snd_shm_area *area;
+	void *p = MAP_FAILED;
+	size_t msize = size;
+	int fd = -1;
+
+#ifdef MFD_HUGETLB
+	if (size >= SHM_AREA_HUGETLB_SIZE) {
+		msize = (size + SHM_AREA_HUGETLB_SIZE - 1) &
+						~(SHM_AREA_HUGETLB_SIZE - 1);
+		p = shm_area_memfd_map(&fd, name, msize, MFD_HUGETLB);
+	}
+#endif
+	if (p == MAP_FAILED) {
+		msize = size;
+		p = shm_area_memfd_map(&fd, name, msize, 0);
+		if (p == MAP_FAILED)
+			return NULL;
+	}
+	area = malloc(sizeof(*area));
+	if (area == NULL) {
+		munmap(p, msize);
+		close(fd);
+		return NULL;
+	}
+	area->shmid = -1;
+	area->memfd = fd;
+	area->ptr = p;
+	area->size = msize;
+	area->share = 1;
+	list_add_tail(&area->list, &shm_areas);
+	*ptr = p;
+	return area;
+}
+
+/**
+ * \brief Get the memfd descriptor of a shm area record
+ * \param area shm area record
+ * \return the memfd descriptor, or -1 for an IPC SHM backed area
+ */
+int snd_shm_area_get_fd(struct snd_shm_area *area)
+{
+	if (area == NULL)
+		return -1;
+	return area->memfd;
+}
+
+#endif /* HAVE_MEMFD_CREATE */
+
 /**
  * \brief Increase the reference counter of shm area record
  * \param area shm area record
@@ -107,7 +213,12 @@ int snd_shm_area_destroy(struct snd_shm_area *area)
 	if (--area->share)
 		return 0;
 	list_del(&area->list);
-	shmdt(area->ptr);
+	if (area->memfd >= 0) {
+		munmap(area->ptr, area->size);
+		close(area->memfd);
+	} else {
+		shmdt(area->ptr);
+	}
 	free(area);
 	return 0;
 }
@@ -122,7 +233,10 @@ void snd_shm_area_destructor(void)
 
 	list_for_each(pos, &shm_areas) {
 		area = list_entry(pos, struct snd_shm_area, list);
-		shmdt(area->ptr);
+		if (area->memfd >= 0)
+			munmap(area->ptr, area->size);
+		else
+			shmdt(area->ptr);
 	}
 }
 #endif /* DOC_HIDDEN */
@@ -0,0 +1,260 @@
+/**
+ * \file threadpool.c
+ * \brief Shared worker thread pool service
+ * \author Jaroslav Kysela <perex@perex.cz>
+ * \date 2025
+ *
+ * One process-wide pool of worker threads shared by all threaded
+ * plugin features (parallel slave dispatch in the multi plugin and
+ * similar bounded jobs).  Spawning one thread per plugin instance
+ * does not scale when many streams are open at once; the pool is
+ * created lazily on first use and sized from the configuration.
+ *
+ * Long-running plugin threads (meter, share) watch the stream for the
+ * whole lifetime of the handle and keep their dedicated threads; the
+ * pool serves short jobs with a bounded runtime only.
+ */
+/*
+ *  Shared worker thread pool service
+ *  Copyright (c) 2025 by Jaroslav Kysela <perex@perex.cz>
+ *
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as
+ *   published by the Free Software Foundation; either version 2.1 of
+ *   the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "local.h"
+
+#ifdef HAVE_LIBPTHREAD
+
+#include <unistd.h>
+#include <pthread.h>
+
+#ifndef DOC_HIDDEN
+
+#define SND_THREAD_POOL_MAX	16
+
+struct _snd_thread_pool {
+	pthread_mutex_t lock;
+	pthread_cond_t work;		/* a job was queued */
+	pthread_cond_t done;		/* a batch job finished */
+	struct list_head critical;	/* audio-critical jobs, served first */
+	struct list_head normal;
+	pthread_t *threads;
+	unsigned int threads_count;
+	int shutdown;
+};
+
+static snd_thread_pool_t *global_pool;
+static int global_pool_failed;
+static pthread_mutex_t global_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#endif /* DOC_HIDDEN */
+
+static snd_thread_pool_job_t *pool_job_pop(snd_thread_pool_t *pool)
+{
+	struct list_head *pos;
+
+	if (!list_empty(&pool->critical))
+		pos = pool->critical.next;
+	else if (!list_empty(&pool->normal))
+		pos = pool->normal.next;
+	else
+		return NULL;
+	list_del(pos);
+	return list_entry(pos, snd_thread_pool_job_t, list);
+}
+
+/* run one queued job; called and returned with the pool lock held */
+static void pool_job_run(snd_thread_pool_t *pool, snd_thread_pool_job_t *job)
+{
+	pthread_mutex_unlock(&pool->lock);
+	job->func(job->data);
+	pthread_mutex_lock(&pool->lock);
+	if (job->batch && --job->batch->pending == 0)
+		pthread_cond_broadcast(&pool->done);
+}
+
+static void *pool_worker_thread(void *data)
+{
+	snd_thread_pool_t *pool = data;
+	snd_thread_pool_job_t *job;
+
+	pthread_mutex_lock(&pool->lock);
+	for (;;) {
+		job = pool_job_pop(pool);
+		if (!job) {
+			if (pool->shutdown)
+				break;
+			pthread_cond_wait(&pool->work, &pool->lock);
+			continue;
+		}
+		pool_job_run(pool, job);
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return NULL;
+}
+
+/* defaults.thread_pool.size; 0 disables the pool, a negative value
+ * (the default) sizes it by the count of the online processors
+ */
+static long pool_conf_size(void)
+{
+	snd_config_t *root, *conf;
+	long size = -1;
+
+	if (snd_config_update_ref(&root) >= 0) {
+		if (snd_config_search(root, "defaults.thread_pool.size",
+				      &conf) >= 0)
+			snd_config_get_integer(conf, &size);
+		snd_config_unref(root);
+	}
+	if (size < 0) {
+		size = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+		if (size < 1)
+			size = 1;
+	}
+	if (size > SND_THREAD_POOL_MAX)
+		size = SND_THREAD_POOL_MAX;
+	return size;
+}
+
+static snd_thread_pool_t *pool_create(unsigned int count)
+{
+	snd_thread_pool_t *pool;
+	pthread_mutexattr_t mattr;
+	unsigned int i;
+
+	pool = calloc(1, sizeof(*pool));
+	if (!pool)
+		return NULL;
+	pool->threads = calloc(count, sizeof(*pool->threads));
+	if (!pool->threads) {
+		free(pool);
+		return NULL;
+	}
+	pthread_mutexattr_init(&mattr);
+#ifdef _POSIX_THREAD_PRIO_INHERIT
+	/* a worker holding the lock inherits the priority of a waiting
+	 * audio-critical submitter
+	 */
+	pthread_mutexattr_setprotocol(&mattr, PTHREAD_PRIO_INHERIT);
+#endif
+	pthread_mutex_init(&pool->lock, &mattr);
+	pthread_mutexattr_destroy(&mattr);
+	pthread_cond_init(&pool->work, NULL);
+	pthread_cond_init(&pool->done, NULL);
+	INIT_LIST_HEAD(&pool->critical);
+	INIT_LIST_HEAD(&pool->normal);
+	for (i = 0; i < count; ++i) {
+		if (pthread_create(&pool->threads[i], NULL,
+				   pool_worker_thread, pool))
+			break;
+		pool->threads_count++;
+	}
+	if (pool->threads_count == 0) {
+		pthread_mutex_destroy(&pool->lock);
+		pthread_cond_destroy(&pool->work);
+		pthread_cond_destroy(&pool->done);
+		free(pool->threads);
+		free(pool);
+		return NULL;
+	}
+	return pool;
+}
+
+/**
+ * \brief Get the shared worker thread pool
+ * \return the process-wide pool or NULL when disabled or unavailable
+ *
+ * The pool is created lazily on the first call and lives until the
+ * process exits.  The size is taken from defaults.thread_pool.size;
+ * setting it to zero disables the pool and all users fall back to
+ * their serial code paths.
+ */
+snd_thread_pool_t *snd_thread_pool_get(void)
+{
+	snd_thread_pool_t *pool;
+	long size;
+
+	pthread_mutex_lock(&global_pool_lock);
+	pool = global_pool;
+	if (!pool && !global_pool_failed) {
+		size = pool_conf_size();
+		if (size > 0)
+			pool = global_pool = pool_create(size);
+		if (!pool)
+			global_pool_failed = 1;
+	}
+	pthread_mutex_unlock(&global_pool_lock);
+	return pool;
+}
+
+/**
+ * \brief Queue a job on the thread pool
+ * \param pool the pool from snd_thread_pool_get()
+ * \param job caller-provided job node, owned by the pool until the
+ *            job has run
+ * \param func function to run on a worker thread
+ * \param data argument passed to func
+ * \param batch completion counter shared by related jobs (may be NULL)
+ * \param critical non-zero for audio-critical jobs; they are served
+ *                 before all normal jobs
+ *
+ * The job node lives in the caller (no allocation on the audio path).
+ */
+void snd_thread_pool_submit(snd_thread_pool_t *pool,
+			    snd_thread_pool_job_t *job,
+			    void (*func)(void *data), void *data,
+			    snd_thread_pool_batch_t *batch, int critical)
+{
+	job->func = func;
+	job->data = data;
+	job->batch = batch;
+	pthread_mutex_lock(&pool->lock);
+	if (batch)
+		batch->pending++;
+	list_add_tail(&job->list, critical ? &pool->critical : &pool->normal);
+	pthread_cond_signal(&pool->work);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * \brief Wait until all jobs of a batch have finished
+ * \param pool the pool the jobs were submitted to
+ * \param batch the completion counter passed to snd_thread_pool_submit()
+ *
+ * While waiting the calling thread steals queued jobs and runs them
+ * itself, so a busy pool cannot stall a waiter which has work of its
+ * own pending and the priority of the submitter is never inverted
+ * against lower-priority queue content.
+ */
+void snd_thread_pool_batch_wait(snd_thread_pool_t *pool,
+				snd_thread_pool_batch_t *batch)
+{
+	snd_thread_pool_job_t *job;
+
+	pthread_mutex_lock(&pool->lock);
+	while (batch->pending > 0) {
+		job = pool_job_pop(pool);
+		if (job)
+			pool_job_run(pool, job);
+		else
+			pthread_cond_wait(&pool->done, &pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+}
+
+#endif /* HAVE_LIBPTHREAD */
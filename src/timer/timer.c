@@ -256,6 +256,7 @@ int snd_timer_close(snd_timer_t *timer)
 	err = timer->ops->close(timer);
 	if (timer->dl_handle)
 		snd_dlclose(timer->dl_handle);
+	free(timer->tring);
 	free(timer->name);
 	free(timer);
 	return err;
@@ -896,10 +897,44 @@ long snd_timer_status_get_queue(snd_timer_status_t * status)
  * \return 0 on success otherwise a negative error code
  */
 int snd_timer_status(snd_timer_t *timer, snd_timer_status_t * status)
+{
+	int err;
+	assert(timer);
+	assert(status);
+	err = timer->ops->status(timer, status);
+	if (err >= 0) {
+		timer->status_mirror = *status;
+		timer->status_valid = 1;
+	}
+	return err;
+}
+
+/**
+ * \brief get status from the library status mirror without a syscall
+ * \param timer timer handle
+ * \param status pointer to a #snd_timer_status_t structure to be filled
+ * \return 0 on success otherwise a negative error code
+ *
+ * The library keeps a passive mirror of the timer status, primed by
+ * snd_timer_status() and kept current from the timestamp and resolution
+ * carried by the events read in the enhanced read mode (see
+ * #SND_TIMER_OPEN_TREAD).  This query fills the container from the
+ * mirror so that high frequency resolution or drift polling costs a
+ * couple of loads instead of an ioctl; the kernel timer interface
+ * offers no mmap'ed status page, this is the closest equivalent.
+ *
+ * The lost, overrun and queue counters advance only on a real
+ * snd_timer_status() call, which also resynchronizes the mirror.  The
+ * first call falls back to the ioctl to prime it.
+ */
+int snd_timer_status_cached(snd_timer_t *timer, snd_timer_status_t *status)
 {
 	assert(timer);
 	assert(status);
-	return timer->ops->status(timer, status);
+	if (!timer->status_valid)
+		return snd_timer_status(timer, status);
+	*status = timer->status_mirror;
+	return 0;
 }
 
 /**
@@ -935,6 +970,30 @@ int snd_timer_continue(snd_timer_t *timer)
 	return timer->ops->rt_continue(timer);
 }
 
+#ifndef DOC_HIDDEN
+/* update the passive status mirror from incoming tread events */
+static void snd_timer_status_track(snd_timer_t *timer,
+				   const snd_timer_tread_t *tr, size_t events)
+{
+	if (!timer->status_valid)
+		return;
+	for (; events > 0; events--, tr++) {
+		switch (tr->event) {
+		case SND_TIMER_EVENT_RESOLUTION:
+		case SND_TIMER_EVENT_START:
+		case SND_TIMER_EVENT_CONTINUE:
+		case SND_TIMER_EVENT_RESUME:
+			if (tr->val > 0)
+				timer->status_mirror.resolution = tr->val;
+			break;
+		default:
+			break;
+		}
+		timer->status_mirror.tstamp = tr->tstamp;
+	}
+}
+#endif
+
 /**
  * \brief read bytes using timer handle
  * \param timer timer handle
@@ -943,10 +1002,111 @@ int snd_timer_continue(snd_timer_t *timer)
  */
 ssize_t snd_timer_read(snd_timer_t *timer, void *buffer, size_t size)
 {
+	ssize_t res;
 	assert(timer);
 	assert(((timer->mode & O_ACCMODE) == O_RDONLY) || ((timer->mode & O_ACCMODE) == O_RDWR));
 	assert(buffer || size == 0);
-	return (timer->ops->read)(timer, buffer, size);
+	res = (timer->ops->read)(timer, buffer, size);
+	if (res > 0 && timer->tread)
+		snd_timer_status_track(timer, buffer,
+				       res / sizeof(snd_timer_tread_t));
+	return res;
+}
+
+/**
+ * \brief lend a persistent event ring to the timer handle
+ * \param timer timer handle opened with #SND_TIMER_OPEN_TREAD
+ * \param events ring capacity in events, 0 to release the ring
+ * \return 0 on success otherwise a negative error code
+ *
+ * Attaches a ring of #snd_timer_tread_t events to the handle so that
+ * many events can be fetched with one syscall and consumed in place:
+ * snd_timer_tread_begin() refills the empty ring with a single large
+ * read and returns a borrowed slice of it.  Releasing or resizing the
+ * ring discards any not yet consumed events.
+ *
+ * \sa snd_timer_tread_begin(), snd_timer_tread_done()
+ */
+int snd_timer_tread_ring(snd_timer_t *timer, size_t events)
+{
+	snd_timer_tread_t *buf;
+
+	assert(timer);
+	if (!timer->tread)
+		return -EINVAL;
+	if (events == 0) {
+		free(timer->tring);
+		timer->tring = NULL;
+		timer->tring_size = 0;
+		timer->tring_head = timer->tring_tail = 0;
+		return 0;
+	}
+	buf = realloc(timer->tring, events * sizeof(*buf));
+	if (buf == NULL)
+		return -ENOMEM;
+	timer->tring = buf;
+	timer->tring_size = events;
+	timer->tring_head = timer->tring_tail = 0;
+	return 0;
+}
+
+/**
+ * \brief borrow the next batch of timer events from the lent ring
+ * \param timer timer handle opened with #SND_TIMER_OPEN_TREAD
+ * \param evs returned pointer to the borrowed events
+ * \return count of borrowed events otherwise a negative error code
+ *
+ * Returns a pointer into the ring lent with snd_timer_tread_ring()
+ * covering the events read from the device but not yet consumed; the
+ * ring is refilled with a single large read when it is empty, so one
+ * syscall can deliver up to the ring capacity of events.  The slice
+ * stays valid until it is consumed with snd_timer_tread_done() or the
+ * ring is released.  In blocking mode the refill blocks like
+ * snd_timer_read(), in nonblock mode -EAGAIN is returned when no
+ * events are pending.
+ */
+ssize_t snd_timer_tread_begin(snd_timer_t *timer, const snd_timer_tread_t **evs)
+{
+	ssize_t res;
+
+	assert(timer);
+	assert(evs);
+	if (timer->tring == NULL)
+		return -EINVAL;
+	if (timer->tring_tail == timer->tring_head) {
+		timer->tring_head = timer->tring_tail = 0;
+		res = (timer->ops->read)(timer, timer->tring,
+					 timer->tring_size * sizeof(snd_timer_tread_t));
+		if (res < 0)
+			return res;
+		timer->tring_head = res / sizeof(snd_timer_tread_t);
+		snd_timer_status_track(timer, timer->tring, timer->tring_head);
+	}
+	*evs = timer->tring + timer->tring_tail;
+	return timer->tring_head - timer->tring_tail;
+}
+
+/**
+ * \brief return a borrowed batch of timer events to the ring
+ * \param timer timer handle opened with #SND_TIMER_OPEN_TREAD
+ * \param events count of consumed events
+ * \return 0 on success otherwise a negative error code
+ *
+ * Marks the first \a events events of the batch borrowed with
+ * snd_timer_tread_begin() as consumed.  A partial consume is allowed;
+ * the remaining events are returned again by the next
+ * snd_timer_tread_begin() call.
+ */
+int snd_timer_tread_done(snd_timer_t *timer, size_t events)
+{
+	assert(timer);
+	if (timer->tring == NULL ||
+	    events > timer->tring_head - timer->tring_tail)
+		return -EINVAL;
+	timer->tring_tail += events;
+	if (timer->tring_tail == timer->tring_head)
+		timer->tring_head = timer->tring_tail = 0;
+	return 0;
 }
 
 /**
@@ -962,3 +1122,279 @@ long snd_timer_info_get_ticks(snd_timer_info_t * info)
 #ifndef DOC_HIDDEN
 link_warning(snd_timer_info_get_ticks, "Warning: snd_timer_info_get_ticks is deprecated");
 #endif
+
+/*
+ * timer multiplexer - many logical subscriptions over one timer fd
+ */
+
+/** timer multiplexer subscription */
+struct _snd_timer_mux_sub {
+	struct list_head list;
+	snd_timer_mux_t *mux;
+	unsigned long long interval;	/* callback interval in ns */
+	unsigned long long pending;	/* elapsed ns not yet dispatched */
+	snd_timer_mux_callback_t callback;
+	void *private_data;
+};
+
+/** timer multiplexer handle */
+struct _snd_timer_mux {
+	snd_timer_t *timer;
+	long resolution;		/* base timer resolution in ns */
+	unsigned int ticks;		/* currently programmed ticks, 0 = stopped */
+	struct list_head subs;
+};
+
+/* program the base timer with the coarsest tick count satisfying every
+ * subscription, (re)starting or stopping it as the set demands */
+static int snd_timer_mux_program(snd_timer_mux_t *mux)
+{
+	snd_timer_params_t params = {0};
+	snd_timer_mux_sub_t *sub;
+	struct list_head *pos;
+	unsigned int ticks = 0, t;
+	int err;
+
+	list_for_each(pos, &mux->subs) {
+		sub = list_entry(pos, snd_timer_mux_sub_t, list);
+		t = sub->interval / mux->resolution;
+		if (t == 0)
+			t = 1;
+		if (ticks == 0 || t < ticks)
+			ticks = t;
+	}
+	if (ticks == 0) {
+		if (mux->ticks > 0) {
+			mux->ticks = 0;
+			return snd_timer_stop(mux->timer);
+		}
+		return 0;
+	}
+	if (ticks == mux->ticks)
+		return 0;
+	snd_timer_params_set_auto_start(&params, 1);
+	snd_timer_params_set_ticks(&params, ticks);
+	err = snd_timer_params(mux->timer, &params);
+	if (err < 0)
+		return err;
+	if (mux->ticks == 0) {
+		err = snd_timer_start(mux->timer);
+		if (err < 0)
+			return err;
+	}
+	mux->ticks = ticks;
+	return 0;
+}
+
+/**
+ * \brief Opens a timer multiplexer
+ * \param muxp Returned timer multiplexer handle
+ * \param name ASCII identifier of the timer to share (see #snd_timer_open)
+ * \param mode Open mode (see #SND_TIMER_OPEN_NONBLOCK)
+ * \return 0 on success otherwise a negative error code
+ *
+ * A multiplexer owns a single kernel timer descriptor and fans its
+ * ticks out to many logical subscriptions, each with its own callback
+ * interval; a process with dozens of periodic activities then costs one
+ * fd and one poll slot instead of one timer handle per activity.  The
+ * base timer always runs at the coarsest tick count which still serves
+ * the finest subscription.  The underlying timer is opened in nonblock
+ * mode regardless of \a mode so that event dispatch never stalls.
+ *
+ * \sa snd_timer_mux_subscribe(), snd_timer_mux_handle_events()
+ */
+int snd_timer_mux_open(snd_timer_mux_t **muxp, const char *name, int mode)
+{
+	snd_timer_mux_t *mux;
+	snd_timer_info_t info;
+	int err;
+
+	assert(muxp && name);
+	mux = calloc(1, sizeof(*mux));
+	if (mux == NULL)
+		return -ENOMEM;
+	INIT_LIST_HEAD(&mux->subs);
+	err = snd_timer_open(&mux->timer, name,
+			     mode | SND_TIMER_OPEN_NONBLOCK);
+	if (err < 0) {
+		free(mux);
+		return err;
+	}
+	memset(&info, 0, sizeof(info));
+	err = snd_timer_info(mux->timer, &info);
+	if (err < 0) {
+		snd_timer_close(mux->timer);
+		free(mux);
+		return err;
+	}
+	mux->resolution = snd_timer_info_get_resolution(&info);
+	if (mux->resolution <= 0)
+		mux->resolution = 1;
+	*muxp = mux;
+	return 0;
+}
+
+/**
+ * \brief Closes a timer multiplexer
+ * \param mux timer multiplexer handle
+ * \return 0 on success otherwise a negative error code
+ *
+ * Closes the underlying timer and frees all remaining subscriptions.
+ */
+int snd_timer_mux_close(snd_timer_mux_t *mux)
+{
+	snd_timer_mux_sub_t *sub;
+	int err;
+
+	assert(mux);
+	while (!list_empty(&mux->subs)) {
+		sub = list_entry(mux->subs.next, snd_timer_mux_sub_t, list);
+		list_del(&sub->list);
+		free(sub);
+	}
+	err = snd_timer_close(mux->timer);
+	free(mux);
+	return err;
+}
+
+/**
+ * \brief get count of poll descriptors for a timer multiplexer
+ * \param mux timer multiplexer handle
+ * \return count of poll descriptors
+ */
+int snd_timer_mux_poll_descriptors_count(snd_timer_mux_t *mux)
+{
+	assert(mux);
+	return snd_timer_poll_descriptors_count(mux->timer);
+}
+
+/**
+ * \brief get poll descriptors for a timer multiplexer
+ * \param mux timer multiplexer handle
+ * \param pfds array of poll descriptors
+ * \param space space in the poll descriptors array
+ * \return count of filled descriptors
+ */
+int snd_timer_mux_poll_descriptors(snd_timer_mux_t *mux, struct pollfd *pfds,
+				   unsigned int space)
+{
+	assert(mux);
+	return snd_timer_poll_descriptors(mux->timer, pfds, space);
+}
+
+/**
+ * \brief add a subscription to a timer multiplexer
+ * \param subp Returned subscription handle
+ * \param mux timer multiplexer handle
+ * \param interval_ns callback interval in nanoseconds
+ * \param callback function called from #snd_timer_mux_handle_events
+ * \param private_data value passed unchanged to the callback
+ * \return 0 on success otherwise a negative error code
+ *
+ * The interval is rounded down to a whole multiple of the base timer
+ * resolution (at least one tick).  The base timer is reprogrammed and
+ * started or stopped automatically as subscriptions come and go.
+ *
+ * \sa snd_timer_mux_unsubscribe()
+ */
+int snd_timer_mux_subscribe(snd_timer_mux_sub_t **subp, snd_timer_mux_t *mux,
+			    unsigned long long interval_ns,
+			    snd_timer_mux_callback_t callback,
+			    void *private_data)
+{
+	snd_timer_mux_sub_t *sub;
+	int err;
+
+	assert(subp && mux && callback);
+	if (interval_ns == 0)
+		return -EINVAL;
+	sub = calloc(1, sizeof(*sub));
+	if (sub == NULL)
+		return -ENOMEM;
+	sub->mux = mux;
+	sub->interval = interval_ns;
+	sub->callback = callback;
+	sub->private_data = private_data;
+	list_add_tail(&sub->list, &mux->subs);
+	err = snd_timer_mux_program(mux);
+	if (err < 0) {
+		list_del(&sub->list);
+		free(sub);
+		snd_timer_mux_program(mux);
+		return err;
+	}
+	*subp = sub;
+	return 0;
+}
+
+/**
+ * \brief remove a subscription from its timer multiplexer
+ * \param sub subscription handle
+ * \return 0 on success otherwise a negative error code
+ *
+ * May be called from the subscription's own callback.  The base timer
+ * is slowed down or stopped when the remaining subscriptions allow it.
+ */
+int snd_timer_mux_unsubscribe(snd_timer_mux_sub_t *sub)
+{
+	snd_timer_mux_t *mux;
+
+	assert(sub);
+	mux = sub->mux;
+	list_del(&sub->list);
+	free(sub);
+	return snd_timer_mux_program(mux);
+}
+
+/**
+ * \brief read pending timer events and dispatch the subscriptions
+ * \param mux timer multiplexer handle
+ * \return count of invoked callbacks otherwise a negative error code
+ *
+ * Drains the base timer descriptor and credits the elapsed time to
+ * every subscription; a callback is invoked once per subscription with
+ * the count of its intervals that elapsed since the last dispatch.
+ * Call it when poll() reports the multiplexer descriptor ready.  A
+ * callback may unsubscribe itself; unsubscribing other subscriptions
+ * from a callback is not allowed.
+ */
+int snd_timer_mux_handle_events(snd_timer_mux_t *mux)
+{
+	snd_timer_read_t buf[64];
+	snd_timer_mux_sub_t *sub;
+	struct list_head *pos, *next;
+	unsigned long long elapsed = 0;
+	unsigned int intervals;
+	ssize_t res;
+	size_t i, n;
+	int dispatched = 0;
+
+	assert(mux);
+	for (;;) {
+		res = snd_timer_read(mux->timer, buf, sizeof(buf));
+		if (res <= 0) {
+			if (res < 0 && res != -EAGAIN)
+				return res;
+			break;
+		}
+		n = res / sizeof(buf[0]);
+		for (i = 0; i < n; i++)
+			elapsed += (unsigned long long)buf[i].resolution *
+				   buf[i].ticks;
+		if (n < sizeof(buf) / sizeof(buf[0]))
+			break;
+	}
+	if (elapsed == 0)
+		return 0;
+	list_for_each_safe(pos, next, &mux->subs) {
+		sub = list_entry(pos, snd_timer_mux_sub_t, list);
+		sub->pending += elapsed;
+		intervals = sub->pending / sub->interval;
+		if (intervals == 0)
+			continue;
+		sub->pending -= (unsigned long long)intervals * sub->interval;
+		sub->callback(sub->private_data, intervals);
+		dispatched++;
+	}
+	return dispatched;
+}
@@ -47,6 +47,16 @@ struct _snd_timer {
 	const snd_timer_ops_t *ops;
 	void *private_data;
 	struct list_head async_handlers;
+	unsigned int tread: 1;		/* enhanced (tstamp + event) read mode */
+	unsigned int status_valid: 1;	/* status mirror primed */
+	snd_timer_status_t status_mirror; /* passive status mirror, updated
+					   * from the status ioctl and from
+					   * incoming tread events */
+	/* lent tread event ring, NULL = disabled */
+	snd_timer_tread_t *tring;	/* tread event ring */
+	size_t tring_size;		/* ring capacity in events */
+	size_t tring_head;		/* fill position */
+	size_t tring_tail;		/* consume position */
 };
 
 typedef struct {
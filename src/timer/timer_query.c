@@ -27,6 +27,78 @@
  */
 
 #include "timer_local.h"
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
+
+#ifndef DOC_HIDDEN
+/* process-level snapshot of the timer device topology; the kernel list
+ * only changes on card hotplug, so identical enumeration walks from
+ * many handles (e.g. a burst of starting direct plugin clients) can be
+ * answered from memory
+ */
+static snd_timer_id_t *snd_timer_enum_cache;
+static int snd_timer_enum_count = -1;	/* -1 = not primed */
+
+#ifdef HAVE_LIBPTHREAD
+static pthread_mutex_t snd_timer_enum_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static inline void snd_timer_enum_lock(void)
+{
+	pthread_mutex_lock(&snd_timer_enum_mutex);
+}
+
+static inline void snd_timer_enum_unlock(void)
+{
+	pthread_mutex_unlock(&snd_timer_enum_mutex);
+}
+#else
+static inline void snd_timer_enum_lock(void) {}
+static inline void snd_timer_enum_unlock(void) {}
+#endif
+
+static int snd_timer_id_equal(const snd_timer_id_t *a, const snd_timer_id_t *b)
+{
+	return a->dev_class == b->dev_class &&
+	       a->dev_sclass == b->dev_sclass &&
+	       a->card == b->card &&
+	       a->device == b->device &&
+	       a->subdevice == b->subdevice;
+}
+
+/* walk the kernel device list once and snapshot it */
+static int snd_timer_enum_prime(snd_timer_query_t *timer)
+{
+	snd_timer_id_t id, *list = NULL, *n;
+	int err, count = 0, size = 0;
+
+	memset(&id, 0, sizeof(id));
+	id.dev_class = -1;
+	while (1) {
+		err = timer->ops->next_device(timer, &id);
+		if (err < 0) {
+			free(list);
+			return err;
+		}
+		if (id.dev_class < 0)
+			break;
+		if (count == size) {
+			size += 16;
+			n = realloc(list, size * sizeof(*list));
+			if (n == NULL) {
+				free(list);
+				return -ENOMEM;
+			}
+			list = n;
+		}
+		list[count++] = id;
+	}
+	free(snd_timer_enum_cache);
+	snd_timer_enum_cache = list;
+	snd_timer_enum_count = count;
+	return 0;
+}
+#endif /* DOC_HIDDEN */
 
 static int snd_timer_query_open_conf(snd_timer_query_t **timer,
 				     const char *name, snd_config_t *timer_root,
@@ -225,6 +297,66 @@ int snd_timer_query_next_device(snd_timer_query_t *timer, snd_timer_id_t *tid)
 	return timer->ops->next_device(timer, tid);
 }
 
+/**
+ * \brief obtain the next timer identification from the process cache
+ * \param timer timer handle
+ * \param tid timer identification
+ * \return 0 on success otherwise a negative error code
+ *
+ * Same iteration contract as snd_timer_query_next_device(), but the
+ * kernel device list is walked only once per process and subsequent
+ * walks are answered from the snapshot without an ioctl per step.
+ * This removes the repeated identical enumeration when many clients
+ * resolve their timers at the same time.
+ *
+ * The snapshot does not follow card hotplug; call
+ * snd_timer_query_cache_flush() to force a fresh walk.
+ */
+int snd_timer_query_next_device_cached(snd_timer_query_t *timer, snd_timer_id_t *tid)
+{
+	int err = 0, i;
+
+  	assert(timer);
+  	assert(tid);
+	snd_timer_enum_lock();
+	if (snd_timer_enum_count < 0)
+		err = snd_timer_enum_prime(timer);
+	if (err < 0) {
+		snd_timer_enum_unlock();
+		return err;
+	}
+	if (tid->dev_class < 0) {
+		i = 0;
+	} else {
+		for (i = 0; i < snd_timer_enum_count; i++)
+			if (snd_timer_id_equal(&snd_timer_enum_cache[i], tid))
+				break;
+		i++;	/* the entry after the match, or the end */
+	}
+	if (i < snd_timer_enum_count)
+		*tid = snd_timer_enum_cache[i];
+	else
+		tid->dev_class = -1;
+	snd_timer_enum_unlock();
+	return 0;
+}
+
+/**
+ * \brief drop the process-level timer enumeration snapshot
+ *
+ * Frees the snapshot taken by snd_timer_query_next_device_cached() so
+ * that the next cached walk re-reads the kernel device list.  Call it
+ * after a card hotplug event.
+ */
+void snd_timer_query_cache_flush(void)
+{
+	snd_timer_enum_lock();
+	free(snd_timer_enum_cache);
+	snd_timer_enum_cache = NULL;
+	snd_timer_enum_count = -1;
+	snd_timer_enum_unlock();
+}
+
 /**
  * \brief get size of the snd_timer_ginfo_t structure in bytes
  * \return size of the snd_timer_ginfo_t structure in bytes
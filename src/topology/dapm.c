@@ -127,7 +127,7 @@ static int tplg_build_widget(snd_tplg_t *tplg, struct tplg_elem *elem)
 		switch (ref->type) {
 		case SND_TPLG_TYPE_MIXER:
 			if (!ref->elem)
-				ref->elem = tplg_elem_lookup(&tplg->mixer_list,
+				ref->elem = tplg_elem_lookup(tplg, &tplg->mixer_list,
 				ref->id, SND_TPLG_TYPE_MIXER, elem->index);
 			if (ref->elem)
 				err = copy_dapm_control(elem, ref->elem);
@@ -135,7 +135,7 @@ static int tplg_build_widget(snd_tplg_t *tplg, struct tplg_elem *elem)
 
 		case SND_TPLG_TYPE_ENUM:
 			if (!ref->elem)
-				ref->elem = tplg_elem_lookup(&tplg->enum_list,
+				ref->elem = tplg_elem_lookup(tplg, &tplg->enum_list,
 				ref->id, SND_TPLG_TYPE_ENUM, elem->index);
 			if (ref->elem)
 				err = copy_dapm_control(elem, ref->elem);
@@ -143,7 +143,7 @@ static int tplg_build_widget(snd_tplg_t *tplg, struct tplg_elem *elem)
 
 		case SND_TPLG_TYPE_BYTES:
 			if (!ref->elem)
-				ref->elem = tplg_elem_lookup(&tplg->bytes_ext_list,
+				ref->elem = tplg_elem_lookup(tplg, &tplg->bytes_ext_list,
 				ref->id, SND_TPLG_TYPE_BYTES, elem->index);
 			if (ref->elem)
 				err = copy_dapm_control(elem, ref->elem);
@@ -196,8 +196,9 @@ int tplg_build_widgets(snd_tplg_t *tplg)
 int tplg_build_routes(snd_tplg_t *tplg)
 {
 	struct list_head *base, *pos;
-	struct tplg_elem *elem;
+	struct tplg_elem *elem, *sink, *source, *control;
 	struct snd_soc_tplg_dapm_graph_elem *route;
+	int err;
 
 	base = &tplg->route_list;
 
@@ -219,17 +220,23 @@ int tplg_build_routes(snd_tplg_t *tplg)
 			return -EINVAL;
 
 		}
-		if (!tplg_elem_lookup(&tplg->widget_list, route->sink,
-			SND_TPLG_TYPE_DAPM_WIDGET, SND_TPLG_INDEX_ALL)) {
+		sink = tplg_elem_lookup(tplg, &tplg->widget_list, route->sink,
+			SND_TPLG_TYPE_DAPM_WIDGET, SND_TPLG_INDEX_ALL);
+		if (!sink) {
 			SNDERR("undefined sink widget/stream '%s'", route->sink);
 		}
 
 		/* validate control name */
+		control = NULL;
 		if (strlen(route->control)) {
-			if (!tplg_elem_lookup(&tplg->mixer_list, route->control,
-					SND_TPLG_TYPE_MIXER, elem->index) &&
-			!tplg_elem_lookup(&tplg->enum_list, route->control,
-					SND_TPLG_TYPE_ENUM, elem->index)) {
+			control = tplg_elem_lookup(tplg, &tplg->mixer_list,
+					route->control,
+					SND_TPLG_TYPE_MIXER, elem->index);
+			if (!control)
+				control = tplg_elem_lookup(tplg, &tplg->enum_list,
+					route->control,
+					SND_TPLG_TYPE_ENUM, elem->index);
+			if (!control) {
 				SNDERR("undefined mixer/enum control '%s'",
 				       route->control);
 			}
@@ -241,12 +248,32 @@ int tplg_build_routes(snd_tplg_t *tplg)
 			return -EINVAL;
 
 		}
-		if (!tplg_elem_lookup(&tplg->widget_list, route->source,
-			SND_TPLG_TYPE_DAPM_WIDGET, SND_TPLG_INDEX_ALL)) {
+		source = tplg_elem_lookup(tplg, &tplg->widget_list, route->source,
+			SND_TPLG_TYPE_DAPM_WIDGET, SND_TPLG_INDEX_ALL);
+		if (!source) {
 			SNDERR("undefined source widget/stream '%s'",
 			       route->source);
 		}
 
+		/* keep the resolved endpoints as references on the route,
+		 * so later validation/ordering passes need no more lookups
+		 */
+		if (sink) {
+			err = tplg_ref_add_elem(elem, sink);
+			if (err < 0)
+				return err;
+		}
+		if (control) {
+			err = tplg_ref_add_elem(elem, control);
+			if (err < 0)
+				return err;
+		}
+		if (source) {
+			err = tplg_ref_add_elem(elem, source);
+			if (err < 0)
+				return err;
+		}
+
 		/* add graph to manifest */
 		tplg->manifest.graph_elems++;
 	}
@@ -264,12 +291,12 @@ struct tplg_elem *tplg_elem_new_route(snd_tplg_t *tplg, int index)
 		return NULL;
 
 	elem->index = index;
+	strcpy(elem->id, "line");
+	elem->type = SND_TPLG_TYPE_DAPM_GRAPH;
 	if (tplg->dapm_sort)
-		tplg_elem_insert(elem, &tplg->route_list);
+		tplg_elem_insert(tplg, elem, &tplg->route_list);
 	else
 		list_add_tail(&elem->list, &tplg->route_list);
-	strcpy(elem->id, "line");
-	elem->type = SND_TPLG_TYPE_DAPM_GRAPH;
 	elem->size = sizeof(*line);
 
 	line = calloc(1, sizeof(*line));
@@ -257,11 +257,19 @@ static void dump_priv_data(struct tplg_elem *elem ATTRIBUTE_UNUSED)
 #endif
 }
 
+/* hex digit value + 1, 0 = not a hex digit */
+static const unsigned char hex_nibble[256] = {
+	['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5,
+	['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+	['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15,
+	['f'] = 16,
+	['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15,
+	['F'] = 16,
+};
+
 static inline int check_nibble(unsigned char c)
 {
-	return (c >= '0' && c <= '9') ||
-	       (c >= 'a' && c <= 'f') ||
-	       (c >= 'A' && c <= 'F');
+	return hex_nibble[c] != 0;
 }
 
 /* get number of hex value elements in CSV list */
@@ -407,56 +415,48 @@ out:
 	return ret;
 }
 
-static int write_hex(char *buf, char *str, int width)
-{
-	long val;
-	void *p = &val;
-
-        errno = 0;
-	if (safe_strtol_base(str, &val, 16) < 0)
-		return -EINVAL;
-
-	switch (width) {
-	case 1:
-		*(unsigned char *)buf = *(unsigned char *)p;
-		break;
-	case 2:
-		*(unsigned short *)buf = *(unsigned short *)p;
-		break;
-	case 4:
-		*(unsigned int *)buf = *(unsigned int *)p;
-		break;
-	default:
-		return -EINVAL;
-	}
-
-	return 0;
-}
-
+/* decode a CSV hex list in one pass, no per-token strdup/strtol */
 static int copy_data_hex(char *data, int off, const char *str, int width)
 {
-	char *tmp, *s = NULL, *p = data;
-	int ret;
-
-	tmp = strdup(str);
-	if (tmp == NULL)
-		return -ENOMEM;
+	const unsigned char *s = (const unsigned char *)str;
+	char *p = data + off;
+	unsigned int val, nibbles;
 
-	p += off;
-	s = strtok(tmp, ",:");
-
-	while (s != NULL) {
-		ret = write_hex(p, s, width);
-		if (ret < 0) {
-			free(tmp);
-			return ret;
+	while (*s != '\0') {
+		if (isspace(*s) || *s == ',' || *s == ':') {
+			s++;
+			continue;
+		}
+		if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X'))
+			s += 2;
+		/* skip leading zeroes so they do not count against the width */
+		while (s[0] == '0' && check_nibble(s[1]))
+			s++;
+		val = 0;
+		nibbles = 0;
+		while (hex_nibble[*s]) {
+			val = (val << 4) | (hex_nibble[*s] - 1);
+			s++;
+			nibbles++;
+		}
+		if (nibbles == 0 || nibbles > (unsigned int)width * 2)
+			return -EINVAL;
+		switch (width) {
+		case 1:
+			*(unsigned char *)p = val;
+			break;
+		case 2:
+			*(unsigned short *)p = val;
+			break;
+		case 4:
+			*(unsigned int *)p = val;
+			break;
+		default:
+			return -EINVAL;
 		}
-
-		s = strtok(NULL, ",:");
 		p += width;
 	}
 
-	free(tmp);
 	return 0;
 }
 
@@ -510,6 +510,98 @@ static int tplg_parse_data_hex(snd_config_t *cfg, struct tplg_elem *elem,
 	return ret;
 }
 
+static inline int base64_decode_sym(unsigned char c)
+{
+	if (c >= 'A' && c <= 'Z')
+		return c - 'A';
+	if (c >= 'a' && c <= 'z')
+		return c - 'a' + 26;
+	if (c >= '0' && c <= '9')
+		return c - '0' + 52;
+	if (c == '+')
+		return 62;
+	if (c == '/')
+		return 63;
+	return -1;
+}
+
+/* Get private data from an inline base64 string. */
+static int tplg_parse_data_base64(snd_config_t *cfg, struct tplg_elem *elem)
+{
+	struct snd_soc_tplg_private *priv;
+	const char *value = NULL, *s;
+	unsigned char *p;
+	unsigned int buf, bits;
+	int size, esize, off, chars, pad;
+
+	tplg_dbg(" data: %s", elem->id);
+
+	if (snd_config_get_string(cfg, &value) < 0)
+		return -EINVAL;
+
+	/* pre-scan, so a single allocation suffices */
+	chars = pad = 0;
+	for (s = value; *s != '\0'; s++) {
+		if (isspace((unsigned char)*s))
+			continue;
+		if (*s == '=') {
+			pad++;
+			continue;
+		}
+		if (pad > 0 || base64_decode_sym(*s) < 0)
+			goto malformed;
+		chars++;
+	}
+	/* padding is optional, but a lone symbol carries too few bits */
+	if (chars == 0 || chars % 4 == 1 || pad > 2)
+		goto malformed;
+
+	size = (chars / 4) * 3 + (chars % 4 > 0 ? chars % 4 - 1 : 0);
+
+	if (size > TPLG_MAX_PRIV_SIZE) {
+		SNDERR("data too big %d", size);
+		return -EINVAL;
+	}
+
+	priv = elem->data;
+	if (priv != NULL) {
+		off = priv->size;
+		esize = elem->size + size;
+		priv = realloc(priv, esize);
+	} else {
+		off = 0;
+		esize = sizeof(*priv) + size;
+		priv = calloc(1, esize);
+	}
+
+	if (!priv)
+		return -ENOMEM;
+
+	elem->data = priv;
+	priv->size += size;
+	elem->size = esize;
+
+	p = (unsigned char *)priv->data + off;
+	buf = bits = 0;
+	for (s = value; *s != '\0'; s++) {
+		if (isspace((unsigned char)*s) || *s == '=')
+			continue;
+		buf = (buf << 6) | base64_decode_sym(*s);
+		bits += 6;
+		if (bits >= 8) {
+			bits -= 8;
+			*p++ = (buf >> bits) & 0xff;
+		}
+	}
+
+	dump_priv_data(elem);
+	return 0;
+
+malformed:
+	SNDERR("malformed base64 data for %s", elem->id);
+	return -EINVAL;
+}
+
 /* get the token integer value from its id */
 static int get_token_value(const char *token_id,
 			   struct tplg_vendor_tokens *tokens)
@@ -540,7 +632,7 @@ static struct tplg_elem *get_tokens(snd_tplg_t *tplg, struct tplg_elem *elem)
 			continue;
 
 		if (!ref->elem) {
-			ref->elem = tplg_elem_lookup(&tplg->token_list,
+			ref->elem = tplg_elem_lookup(tplg, &tplg->token_list,
 				ref->id, SND_TPLG_TYPE_TOKEN, elem->index);
 		}
 
@@ -689,7 +781,7 @@ static int build_tuples(snd_tplg_t *tplg, struct tplg_elem *elem)
 		tplg_dbg("tuples '%s' used by data '%s'", ref->id, elem->id);
 
 		if (!ref->elem)
-			ref->elem = tplg_elem_lookup(&tplg->tuple_list,
+			ref->elem = tplg_elem_lookup(tplg, &tplg->tuple_list,
 				ref->id, SND_TPLG_TYPE_TUPLE, elem->index);
 		tuples = ref->elem;
 		if (!tuples) {
@@ -1338,8 +1430,8 @@ int tplg_build_manifest_data(snd_tplg_t *tplg)
 
 /* Parse Private data.
  *
- * Object private data can either be from file or defined as bytes, shorts,
- * words, tuples.
+ * Object private data can either be from file or defined as base64, bytes,
+ * shorts, words, tuples.
  */
 int tplg_parse_data(snd_tplg_t *tplg, snd_config_t *cfg,
 		    void *private ATTRIBUTE_UNUSED)
@@ -1370,6 +1462,15 @@ int tplg_parse_data(snd_tplg_t *tplg, snd_config_t *cfg,
 			continue;
 		}
 
+		if (strcmp(id, "base64") == 0) {
+			err = tplg_parse_data_base64(n, elem);
+			if (err < 0) {
+				SNDERR("failed to parse base64 data");
+				return err;
+			}
+			continue;
+		}
+
 		if (strcmp(id, "bytes") == 0) {
 			err = tplg_parse_data_hex(n, elem, 1);
 			if (err < 0) {
@@ -1505,7 +1606,7 @@ int tplg_copy_data(snd_tplg_t *tplg, struct tplg_elem *elem,
 	int priv_data_size, old_priv_data_size;
 	void *obj;
 
-	ref_elem = tplg_elem_lookup(&tplg->pdata_list,
+	ref_elem = tplg_elem_lookup(tplg, &tplg->pdata_list,
 				     ref->id, SND_TPLG_TYPE_DATA, elem->index);
 	if (!ref_elem) {
 		SNDERR("cannot find data '%s' referenced by"
@@ -1625,7 +1726,7 @@ int tplg_add_token(snd_tplg_t *tplg, struct tplg_elem *parent,
 	unsigned int i;
 	size_t size;
 
-	elem = tplg_elem_lookup(&tplg->token_list, parent->id,
+	elem = tplg_elem_lookup(tplg, &tplg->token_list, parent->id,
 				SND_TPLG_TYPE_TOKEN, parent->index);
 	if (elem == NULL) {
 		elem = tplg_elem_new_common(tplg, NULL, parent->id,
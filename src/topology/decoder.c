@@ -40,38 +40,46 @@ int tplg_decode_template(snd_tplg_t *tplg,
 	return 0;
 }
 
-int snd_tplg_decode(snd_tplg_t *tplg, void *bin, size_t size, int dflags)
+/* walk the block headers of a binary topology image; the payloads are
+ * never touched here, so the image may come from a read-only mapping.
+ * The callback is invoked for each block and may stop the walk by
+ * returning a non-zero value, which is passed back to the caller.
+ */
+static int tplg_decode_walk(snd_tplg_t *tplg, const void *bin, size_t size,
+			    int (*blkcb)(snd_tplg_t *tplg, size_t pos,
+					 struct snd_soc_tplg_hdr *hdr,
+					 void *payload, void *private_data),
+			    void *private_data)
 {
 	struct snd_soc_tplg_hdr *hdr;
-	struct tplg_table *tptr;
 	size_t pos;
-	void *b = bin;
-	unsigned int index;
+	const void *b = bin;
 	int err;
 
-	if (dflags != 0)
-		return -EINVAL;
-	if (tplg == NULL || bin == NULL)
+	if (bin == NULL)
 		return -EINVAL;
 	while (1) {
 		pos = b - bin;
 		if (size == pos) {
-			tplg_log(tplg, 'D', pos, "block: success (total %zd)", size);
+			if (tplg)
+				tplg_log(tplg, 'D', pos, "block: success (total %zd)", size);
 			return 0;
 		}
 		if (size - pos < sizeof(*hdr)) {
-			tplg_log(tplg, 'D', pos, "block: small size");
+			if (tplg)
+				tplg_log(tplg, 'D', pos, "block: small size");
 			SNDERR("incomplete header data to decode");
 			return -EINVAL;
 		}
-		hdr = b;
+		hdr = (struct snd_soc_tplg_hdr *)b;
 		if (hdr->magic != SND_SOC_TPLG_MAGIC) {
 			SNDERR("bad block magic %08x", hdr->magic);
 			return -EINVAL;
 		}
 
-		tplg_log(tplg, 'D', pos, "block: abi %d size %d payload size %d",
-			 hdr->abi, hdr->size, hdr->payload_size);
+		if (tplg)
+			tplg_log(tplg, 'D', pos, "block: abi %d size %d payload size %d",
+				 hdr->abi, hdr->size, hdr->payload_size);
 		if (hdr->abi != SND_SOC_TPLG_ABI_VERSION) {
 			SNDERR("unsupported ABI version %d", hdr->abi);
 			return -EINVAL;
@@ -97,25 +105,134 @@ int snd_tplg_decode(snd_tplg_t *tplg, void *bin, size_t size, int dflags)
 				SNDERR("first block must be manifest (value %d)", hdr->type);
 				return -EINVAL;
 			}
-			err = snd_tplg_set_version(tplg, hdr->version);
-			if (err < 0)
-				return err;
+			if (tplg) {
+				err = snd_tplg_set_version(tplg, hdr->version);
+				if (err < 0)
+					return err;
+			}
 		}
 
-		pos += hdr->size;
-		for (index = 0; index < tplg_table_items; index++) {
-			tptr = &tplg_table[index];
-			if (tptr->tsoc == (int)hdr->type)
-				break;
-		}
-		if (index >= tplg_table_items || tptr->decod == NULL) {
-			SNDERR("unknown block type %d", hdr->type);
-			return -EINVAL;
-		}
-		tplg_log(tplg, 'D', pos, "block: type %d - %s", hdr->type, tptr->name);
-		err = tptr->decod(tplg, pos, hdr, b + hdr->size, hdr->payload_size);
-		if (err < 0)
+		err = blkcb(tplg, pos + hdr->size, hdr,
+			    (void *)(b + hdr->size), private_data);
+		if (err)
 			return err;
 		b += hdr->size + hdr->payload_size;
 	}
 }
+
+/* find the type table entry for an asoc block type */
+static struct tplg_table *tplg_table_lookup_tsoc(int tsoc)
+{
+	unsigned int index;
+
+	for (index = 0; index < tplg_table_items; index++) {
+		if (tplg_table[index].tsoc == tsoc)
+			return &tplg_table[index];
+	}
+	return NULL;
+}
+
+static int decode_block(snd_tplg_t *tplg, size_t pos,
+			struct snd_soc_tplg_hdr *hdr,
+			void *payload, void *private_data ATTRIBUTE_UNUSED)
+{
+	struct tplg_table *tptr;
+
+	tptr = tplg_table_lookup_tsoc(hdr->type);
+	if (tptr == NULL || tptr->decod == NULL) {
+		SNDERR("unknown block type %d", hdr->type);
+		return -EINVAL;
+	}
+	tplg_log(tplg, 'D', pos, "block: type %d - %s", hdr->type, tptr->name);
+	return tptr->decod(tplg, pos, hdr, payload, hdr->payload_size);
+}
+
+int snd_tplg_decode(snd_tplg_t *tplg, void *bin, size_t size, int dflags)
+{
+	if (dflags != 0)
+		return -EINVAL;
+	if (tplg == NULL)
+		return -EINVAL;
+	return tplg_decode_walk(tplg, bin, size, decode_block, NULL);
+}
+
+#ifndef DOC_HIDDEN
+struct tplg_scan_data {
+	snd_tplg_scan_cb_t callback;
+	void *private_data;
+};
+
+struct tplg_sect_filter {
+	int type;
+	int index;
+};
+#endif /* DOC_HIDDEN */
+
+static int scan_block(snd_tplg_t *tplg ATTRIBUTE_UNUSED, size_t pos,
+		      struct snd_soc_tplg_hdr *hdr,
+		      void *payload, void *private_data)
+{
+	struct tplg_scan_data *scan = private_data;
+	snd_tplg_sect_view_t view;
+
+	memset(&view, 0, sizeof(view));
+	view.type = tplg_get_type(hdr->type);
+	view.index = hdr->index;
+	view.count = hdr->count;
+	view.vendor_type = hdr->vendor_type;
+	view.version = hdr->version;
+	view.pos = pos;
+	view.payload = payload;
+	view.payload_size = hdr->payload_size;
+	return scan->callback(&view, scan->private_data);
+}
+
+int snd_tplg_scan(const void *bin, size_t size,
+		  snd_tplg_scan_cb_t callback, void *private_data)
+{
+	struct tplg_scan_data scan;
+
+	if (callback == NULL)
+		return -EINVAL;
+	scan.callback = callback;
+	scan.private_data = private_data;
+	return tplg_decode_walk(NULL, bin, size, scan_block, &scan);
+}
+
+static int decode_section_block(snd_tplg_t *tplg, size_t pos,
+				struct snd_soc_tplg_hdr *hdr,
+				void *payload, void *private_data)
+{
+	struct tplg_sect_filter *filter = private_data;
+	struct tplg_table *tptr;
+
+	tptr = tplg_table_lookup_tsoc(hdr->type);
+	if (tptr == NULL || tptr->decod == NULL) {
+		/* not decodable - just skip in the filtered mode */
+		tplg_log(tplg, 'D', pos, "block: skip unknown type %d", hdr->type);
+		return 0;
+	}
+	if (tptr->type != filter->type ||
+	    (filter->index != SND_TPLG_INDEX_ALL &&
+	     (int)hdr->index != filter->index)) {
+		tplg_log(tplg, 'D', pos, "block: skip type %d - %s",
+			 hdr->type, tptr->name);
+		return 0;
+	}
+	tplg_log(tplg, 'D', pos, "block: type %d - %s", hdr->type, tptr->name);
+	return tptr->decod(tplg, pos, hdr, payload, hdr->payload_size);
+}
+
+int snd_tplg_decode_section(snd_tplg_t *tplg, void *bin, size_t size,
+			    int type, int index, int dflags)
+{
+	struct tplg_sect_filter filter;
+
+	if (dflags != 0)
+		return -EINVAL;
+	if (tplg == NULL)
+		return -EINVAL;
+	filter.type = type;
+	filter.index = index;
+	return tplg_decode_walk(tplg, bin, size, decode_section_block, &filter);
+}
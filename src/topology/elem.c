@@ -298,8 +298,59 @@ struct tplg_elem *tplg_elem_new(void)
 	return elem;
 }
 
+/*
+ * Element lookup hash table.
+ *
+ * Reference resolution looks up elements by id for every cross
+ * reference, which walked the per-type list and made the build time
+ * quadratic in the element count.  All inserted elements are hashed
+ * by id and type on the owning context, so the lookups stay O(1)
+ * even for topologies with thousands of elements.  The sorted
+ * per-type lists are kept as the authoritative order for building
+ * and saving.
+ */
+static unsigned int tplg_elem_hash_val(const char *id, unsigned int type)
+{
+	unsigned int hval = 2166136261U;	/* FNV-1a */
+
+	while (*id) {
+		hval ^= (unsigned char)*id++;
+		hval *= 16777619U;
+	}
+	hval ^= type;
+	hval *= 16777619U;
+	return hval & (TPLG_ELEM_HASH_SIZE - 1);
+}
+
+static void tplg_elem_hash_add(snd_tplg_t *tplg, struct tplg_elem *elem)
+{
+	struct tplg_elem **bucket;
+
+	bucket = &tplg->elem_hash[tplg_elem_hash_val(elem->id, elem->type)];
+	elem->hash_bucket = bucket;
+	elem->hash_next = *bucket;
+	*bucket = elem;
+}
+
+static void tplg_elem_hash_del(struct tplg_elem *elem)
+{
+	struct tplg_elem **p;
+
+	if (!elem->hash_bucket)
+		return;
+	for (p = elem->hash_bucket; *p; p = &(*p)->hash_next) {
+		if (*p == elem) {
+			*p = elem->hash_next;
+			break;
+		}
+	}
+	elem->hash_bucket = NULL;
+	elem->hash_next = NULL;
+}
+
 void tplg_elem_free(struct tplg_elem *elem)
 {
+	tplg_elem_hash_del(elem);
 	list_del(&elem->list);
 
 	tplg_ref_free_list(&elem->ref_list);
@@ -328,25 +379,43 @@ void tplg_elem_free_list(struct list_head *base)
 	}
 }
 
-struct tplg_elem *tplg_elem_lookup(struct list_head *base, const char* id,
-				   unsigned int type, int index)
+struct tplg_elem *tplg_elem_lookup(snd_tplg_t *tplg, struct list_head *base,
+				   const char* id, unsigned int type, int index)
 {
 	struct list_head *pos;
-	struct tplg_elem *elem;
+	struct tplg_elem *elem, *match = NULL;
 
 	if (!base || !id)
 		return NULL;
 
+	/* fast path - resolve via the hash table; among the elements with
+	 * the same id and type pick the one coming first on the sorted
+	 * list (the lowest index, insertion order on ties)
+	 */
+	elem = tplg->elem_hash[tplg_elem_hash_val(id, type)];
+	for (; elem; elem = elem->hash_next) {
+		if (elem->type != type || strcmp(elem->id, id))
+			continue;
+		if (!match || elem->index <= match->index)
+			match = elem;
+	}
+	if (!match)
+		return NULL;
+	/* SND_TPLG_INDEX_ALL is the default value "0" and applicable
+	   for all use cases */
+	if (index == SND_TPLG_INDEX_ALL || match->index <= index)
+		return match;
+
+	/* the only match lies beyond the requested index - fall back to
+	 * the list walk which stops at the first element past the index
+	 */
 	list_for_each(pos, base) {
 
 		elem = list_entry(pos, struct tplg_elem, list);
 
 		if (!strcmp(elem->id, id) && elem->type == type)
 			return elem;
-		/* SND_TPLG_INDEX_ALL is the default value "0" and applicable
-		   for all use cases */
-		if ((index != SND_TPLG_INDEX_ALL)
-			&& (elem->index > index))
+		if (elem->index > index)
 			break;
 	}
 
@@ -384,18 +453,24 @@ struct tplg_elem *tplg_elem_type_lookup(snd_tplg_t *tplg,
 }
 
 /* insert a new element into list in the ascending order of index value */
-void tplg_elem_insert(struct tplg_elem *elem_p, struct list_head *list)
+void tplg_elem_insert(snd_tplg_t *tplg, struct tplg_elem *elem_p,
+		      struct list_head *list)
 {
 	struct list_head *pos, *p = &(elem_p->list);
 	struct tplg_elem *elem;
 
-	list_for_each(pos, list) {
+	/* walk backwards from the tail; topology files are usually already
+	 * ordered by index, so the insertion point is found in one step
+	 * instead of rescanning the whole list for every element
+	 */
+	for (pos = list->prev; pos != list; pos = pos->prev) {
 		elem = list_entry(pos, struct tplg_elem, list);
-		if (elem_p->index < elem->index)
+		if (elem->index <= elem_p->index)
 			break;
 	}
-	/* insert item before pos */
-	list_insert(p, pos->prev, pos);
+	/* insert item after pos (keeps insertion order on equal indices) */
+	list_insert(p, pos, pos->next);
+	tplg_elem_hash_add(tplg, elem_p);
 }
 
 /* create a new common element and object */
@@ -460,7 +535,9 @@ struct tplg_elem* tplg_elem_new_common(snd_tplg_t *tplg,
 	}
 
 	list = (struct list_head *)((void *)tplg + tptr->loff);
-	tplg_elem_insert(elem, list);
+	/* the type must be set before the insertion for the hash key */
+	elem->type = type;
+	tplg_elem_insert(tplg, elem, list);
 	obj_size = tptr->size;
 	elem->free = tptr->free;
 	elem->table = tptr;
@@ -477,7 +554,6 @@ struct tplg_elem* tplg_elem_new_common(snd_tplg_t *tplg,
 		elem->size = obj_size;
 	}
 
-	elem->type = type;
 	return elem;
 }
 
@@ -19,6 +19,9 @@
 
 #include "tplg_local.h"
 #include <sys/stat.h>
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
 
 /*
  * Get integer value
@@ -142,14 +145,184 @@ int tplg_parse_compound(snd_tplg_t *tplg, snd_config_t *cfg,
 	return err;
 }
 
+/* find the section parser for a top level id, NULL = unknown section */
+static tplg_parser_t tplg_lookup_parser(const char *id)
+{
+	struct tplg_table *p;
+	unsigned int idx;
+
+	for (idx = 0; idx < tplg_table_items; idx++) {
+		p = &tplg_table[idx];
+		if (p->id && strcmp(id, p->id) == 0)
+			return p->parse;
+		if (p->id2 && strcmp(id, p->id2) == 0)
+			return p->parse;
+	}
+	return NULL;
+}
+
+#ifdef HAVE_LIBPTHREAD
+
+#define TPLG_PARSE_THREADS 4
+
+struct tplg_parse_job {
+	snd_config_t *cfg;
+	tplg_parser_t parser;
+	snd_tplg_t *shell;	/* per section element container */
+	int err;
+};
+
+struct tplg_parse_jobs {
+	struct tplg_parse_job *jobs;
+	unsigned int count;
+	unsigned int next;
+	pthread_mutex_t lock;
+};
+
+static void *tplg_parse_worker(void *data)
+{
+	struct tplg_parse_jobs *w = data;
+	struct tplg_parse_job *job;
+	unsigned int idx;
+
+	for (;;) {
+		pthread_mutex_lock(&w->lock);
+		idx = w->next++;
+		pthread_mutex_unlock(&w->lock);
+		if (idx >= w->count)
+			return NULL;
+		job = &w->jobs[idx];
+		if (job->shell == NULL) {
+			job->err = -ENOMEM;
+			continue;
+		}
+		job->err = tplg_parse_compound(job->shell, job->cfg,
+					       job->parser, NULL);
+	}
+}
+
+/* move all elements of a section shell into the main context; merging
+ * the shells in section order reproduces the serial element order
+ */
+static void tplg_merge_shell(snd_tplg_t *tplg, snd_tplg_t *shell)
+{
+	struct list_head *list, *shell_list, *pos, *npos;
+	struct tplg_elem *elem;
+	unsigned int idx;
+
+	for (idx = 0; idx < tplg_table_items; idx++) {
+		shell_list = (struct list_head *)((void *)shell +
+						  tplg_table[idx].loff);
+		list = (struct list_head *)((void *)tplg +
+					    tplg_table[idx].loff);
+		list_for_each_safe(pos, npos, shell_list) {
+			elem = list_entry(pos, struct tplg_elem, list);
+			list_del(&elem->list);
+			/* unsorted routes bypass the hash (see
+			 * tplg_elem_new_route), recognizable by the
+			 * unset hash bucket
+			 */
+			if (elem->hash_bucket)
+				tplg_elem_insert(tplg, elem, list);
+			else
+				list_add_tail(&elem->list, list);
+		}
+	}
+}
+
+static int tplg_parse_config_parallel(snd_tplg_t *tplg, snd_config_t *cfg)
+{
+	struct tplg_parse_jobs w;
+	struct tplg_parse_job *job;
+	pthread_t threads[TPLG_PARSE_THREADS];
+	snd_config_iterator_t i, next;
+	snd_config_t *n;
+	const char *id;
+	struct list_head *pos;
+	unsigned int idx, count, nthreads;
+	int sflags, err = 0;
+
+	count = 0;
+	snd_config_for_each(i, next, cfg)
+		count++;
+	if (count == 0)
+		return 0;
+
+	w.jobs = calloc(count, sizeof(*w.jobs));
+	if (w.jobs == NULL)
+		return -ENOMEM;
+	w.count = 0;
+	w.next = 0;
+	pthread_mutex_init(&w.lock, NULL);
+
+	sflags = 0;
+	if (tplg->verbose)
+		sflags |= SND_TPLG_CREATE_VERBOSE;
+	if (!tplg->dapm_sort)
+		sflags |= SND_TPLG_CREATE_DAPM_NOSORT;
+
+	snd_config_for_each(i, next, cfg) {
+		n = snd_config_iterator_entry(i);
+		if (snd_config_get_id(n, &id) < 0)
+			continue;
+		job = &w.jobs[w.count];
+		job->parser = tplg_lookup_parser(id);
+		if (job->parser == NULL) {
+			SNDERR("unknown section %s", id);
+			continue;
+		}
+		job->cfg = n;
+		/* a missing shell is turned into -ENOMEM by the worker */
+		job->shell = snd_tplg_create(sflags);
+		w.count++;
+	}
+
+	nthreads = w.count < TPLG_PARSE_THREADS ? w.count : TPLG_PARSE_THREADS;
+	for (idx = 0; idx < nthreads; idx++) {
+		if (pthread_create(&threads[idx], NULL, tplg_parse_worker, &w))
+			break;
+	}
+	nthreads = idx;
+	if (nthreads == 0)
+		tplg_parse_worker(&w);
+	for (idx = 0; idx < nthreads; idx++)
+		pthread_join(threads[idx], NULL);
+
+	/* first error in section order wins, like the serial parser */
+	for (idx = 0; idx < w.count && err == 0; idx++)
+		err = w.jobs[idx].err;
+
+	if (err == 0)
+		for (idx = 0; idx < w.count; idx++)
+			tplg_merge_shell(tplg, w.jobs[idx].shell);
+
+	for (idx = 0; idx < w.count; idx++)
+		if (w.jobs[idx].shell)
+			snd_tplg_free(w.jobs[idx].shell);
+	pthread_mutex_destroy(&w.lock);
+	free(w.jobs);
+
+	/* the serial parser rejects a second manifest when it sees it;
+	 * with independent shells the check moves after the merge
+	 */
+	pos = tplg->manifest_list.next;
+	if (err == 0 && pos != &tplg->manifest_list &&
+	    pos->next != &tplg->manifest_list) {
+		SNDERR("already has manifest data");
+		err = -EINVAL;
+	}
+
+	return err;
+}
+
+#endif /* HAVE_LIBPTHREAD */
+
 static int tplg_parse_config(snd_tplg_t *tplg, snd_config_t *cfg)
 {
-	int (*parser)(snd_tplg_t *tplg, snd_config_t *cfg, void *priv);
+	tplg_parser_t parser;
 	snd_config_iterator_t i, next;
 	snd_config_t *n;
 	const char *id;
-	struct tplg_table *p;
-	unsigned int idx;
 	int err;
 
 	if (snd_config_get_type(cfg) != SND_CONFIG_TYPE_COMPOUND) {
@@ -157,6 +330,11 @@ static int tplg_parse_config(snd_tplg_t *tplg, snd_config_t *cfg)
 		return -EINVAL;
 	}
 
+#ifdef HAVE_LIBPTHREAD
+	if (tplg->parallel)
+		return tplg_parse_config_parallel(tplg, cfg);
+#endif
+
 	/* parse topology config sections */
 	snd_config_for_each(i, next, cfg) {
 
@@ -164,19 +342,7 @@ static int tplg_parse_config(snd_tplg_t *tplg, snd_config_t *cfg)
 		if (snd_config_get_id(n, &id) < 0)
 			continue;
 
-		parser = NULL;
-		for (idx = 0; idx < tplg_table_items; idx++) {
-			p = &tplg_table[idx];
-			if (p->id && strcmp(id, p->id) == 0) {
-				parser = p->parse;
-				break;
-			}
-			if (p->id2 && strcmp(id, p->id2) == 0) {
-				parser = p->parse;
-				break;
-			}
-		}
-
+		parser = tplg_lookup_parser(id);
 		if (parser == NULL) {
 			SNDERR("unknown section %s", id);
 			continue;
@@ -348,10 +514,34 @@ int snd_tplg_add_object(snd_tplg_t *tplg, snd_tplg_obj_template_t *t)
 	};
 }
 
+/* write the assembled binary image to a file descriptor in one stream,
+ * resuming on short writes and EINTR
+ */
+static int tplg_write_bin_fd(snd_tplg_t *tplg, int fd)
+{
+	size_t pos = 0;
+	ssize_t r;
+
+	while (pos < tplg->bin_size) {
+		r = write(fd, tplg->bin + pos, tplg->bin_size - pos);
+		if (r < 0) {
+			if (errno == EINTR)
+				continue;
+			SNDERR("write error: %s", strerror(errno));
+			return -errno;
+		}
+		if (r == 0) {
+			SNDERR("partial write (%zd != %zd)", pos, tplg->bin_size);
+			return -EIO;
+		}
+		pos += r;
+	}
+	return 0;
+}
+
 int snd_tplg_build(snd_tplg_t *tplg, const char *outfile)
 {
 	int fd, err;
-	ssize_t r;
 
 	err = tplg_build(tplg);
 	if (err < 0)
@@ -362,18 +552,20 @@ int snd_tplg_build(snd_tplg_t *tplg, const char *outfile)
 		SNDERR("failed to open %s err %d", outfile, -errno);
 		return -errno;
 	}
-	r = write(fd, tplg->bin, tplg->bin_size);
+	err = tplg_write_bin_fd(tplg, fd);
 	close(fd);
-	if (r < 0) {
-		err = -errno;
-		SNDERR("write error: %s", strerror(errno));
+	return err;
+}
+
+int snd_tplg_build_to_fd(snd_tplg_t *tplg, int fd)
+{
+	int err;
+
+	err = tplg_build(tplg);
+	if (err < 0)
 		return err;
-	}
-	if ((size_t)r != tplg->bin_size) {
-		SNDERR("partial write (%zd != %zd)", r, tplg->bin_size);
-		return -EIO;
-	}
-	return 0;
+
+	return tplg_write_bin_fd(tplg, fd);
 }
 
 int snd_tplg_build_bin(snd_tplg_t *tplg,
@@ -446,6 +638,9 @@ snd_tplg_t *snd_tplg_create(int flags)
 
 	tplg->verbose = !!(flags & SND_TPLG_CREATE_VERBOSE);
 	tplg->dapm_sort = (flags & SND_TPLG_CREATE_DAPM_NOSORT) == 0;
+#ifdef HAVE_LIBPTHREAD
+	tplg->parallel = !!(flags & SND_TPLG_CREATE_PARALLEL);
+#endif
 
 	tplg->manifest.size = sizeof(struct snd_soc_tplg_manifest);
 
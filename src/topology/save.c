@@ -17,87 +17,85 @@
 
 #include "tplg_local.h"
 
-#define SAVE_ALLOC_SHIFT	(13)	/* 8192 bytes */
-#define PRINT_ALLOC_SHIFT	(10)	/* 1024 bytes */
+#define SAVE_ALLOC_SIZE		(8 * 1024)	/* initial arena size */
 #define PRINT_BUF_SIZE_MAX	(1024 * 1024)
-#define NEXT_CHUNK(val, shift)	((((val) >> (shift)) + 1) << (shift))
 
 void tplg_buf_init(struct tplg_buf *buf)
 {
 	buf->dst = NULL;
 	buf->dst_len = 0;
-	buf->printf_buf = NULL;
-	buf->printf_buf_size = 0;
+	buf->dst_size = 0;
 }
 
 void tplg_buf_free(struct tplg_buf *buf)
 {
 	free(buf->dst);
-	free(buf->printf_buf);
 }
 
 char *tplg_buf_detach(struct tplg_buf *buf)
 {
-	char *ret = buf->dst;
-	free(buf->printf_buf);
-	return ret;
+	return buf->dst;
+}
+
+/* make sure that at least size bytes (including the terminator) can be
+ * written at the current end of the arena; the arena grows geometrically,
+ * so the total copying stays linear in the output size
+ */
+static char *tplg_buf_reserve(struct tplg_buf *buf, size_t size)
+{
+	size_t t = buf->dst_size;
+	char *s;
+
+	if (buf->dst_len + size <= t)
+		return buf->dst + buf->dst_len;
+	if (t == 0)
+		t = SAVE_ALLOC_SIZE;
+	while (buf->dst_len + size > t)
+		t *= 2;
+	s = realloc(buf->dst, t);
+	if (s == NULL)
+		return NULL;
+	buf->dst = s;
+	buf->dst_size = t;
+	return s + buf->dst_len;
 }
 
 int tplg_save_printf(struct tplg_buf *dst, const char *pfx, const char *fmt, ...)
 {
 	va_list va;
 	char *s;
-	size_t n, l, t, pl;
-	int ret = 0;
+	size_t n, pl, avail;
 
 	if (pfx == NULL)
 		pfx = "";
+	pl = strlen(pfx);
 
+	/* reserve, format in place, commit; retry once when the formatted
+	 * string did not fit into the reserved tail
+	 */
+	s = tplg_buf_reserve(dst, pl + 64);
+	if (s == NULL)
+		return -ENOMEM;
+	avail = dst->dst_size - dst->dst_len - pl;
+	memcpy(s, pfx, pl);
 	va_start(va, fmt);
-	n = vsnprintf(dst->printf_buf, dst->printf_buf_size, fmt, va);
+	n = vsnprintf(s + pl, avail, fmt, va);
 	va_end(va);
 
-	if (n >= PRINT_BUF_SIZE_MAX) {
-		ret = -EOVERFLOW;
-		goto end;
-	}
+	if (n >= PRINT_BUF_SIZE_MAX)
+		return -EOVERFLOW;
 
-	if (n >= dst->printf_buf_size) {
-		t = NEXT_CHUNK(n + 1, PRINT_ALLOC_SHIFT);
-		s = realloc(dst->printf_buf, t);
-		if (!s) {
-			ret = -ENOMEM;
-			goto end;
-		}
-		dst->printf_buf = s;
-		dst->printf_buf_size = t;
+	if (n >= avail) {
+		s = tplg_buf_reserve(dst, pl + n + 1);
+		if (s == NULL)
+			return -ENOMEM;
 		va_start(va, fmt);
-		n = vsnprintf(dst->printf_buf, n + 1, fmt, va);
+		vsnprintf(s + pl, n + 1, fmt, va);
 		va_end(va);
 	}
 
-	pl = strlen(pfx);
-	l = dst->dst_len;
-	t = l + pl + n + 1;
-	/* allocate chunks */
-	if (dst->dst == NULL ||
-	    (l >> SAVE_ALLOC_SHIFT) != (t >> SAVE_ALLOC_SHIFT)) {
-		s = realloc(dst->dst, NEXT_CHUNK(t, SAVE_ALLOC_SHIFT));
-		if (s == NULL) {
-			ret = -ENOMEM;
-			goto end;
-		}
-	} else {
-		s = dst->dst;
-	}
-
-	if (pl > 0)
-		strcpy(s + l, pfx);
-	strcpy(s + l + pl, dst->printf_buf);
-	dst->dst = s;
-	dst->dst_len = t - 1;
-end:
-	return ret;
+	dst->dst_len += pl + n;
+	return 0;
 }
 
 int tplg_nice_value_format(char *dst, size_t dst_size, unsigned int value)
@@ -40,6 +40,9 @@ struct tplg_ref;
 struct tplg_elem;
 struct tplg_table;
 
+/* number of the element hash table buckets, must be a power of two */
+#define TPLG_ELEM_HASH_SIZE	256
+
 typedef enum _snd_pcm_rates {
 	SND_PCM_RATE_UNKNOWN = -1,
 	SND_PCM_RATE_5512 = 0,
@@ -68,6 +71,7 @@ struct snd_tplg {
 
 	int verbose;
 	unsigned int dapm_sort: 1;
+	unsigned int parallel: 1;
 	unsigned int version;
 
 	/* runtime state */
@@ -100,6 +104,9 @@ struct snd_tplg {
 	struct list_head mixer_list;
 	struct list_head enum_list;
 	struct list_head bytes_ext_list;
+
+	/* hash table over all elements for the id lookup */
+	struct tplg_elem *elem_hash[TPLG_ELEM_HASH_SIZE];
 };
 
 /* object text references */
@@ -194,6 +201,10 @@ struct tplg_elem {
 	struct list_head ref_list;
 	struct list_head list; /* list of all elements with same type */
 
+	/* chain on the per-context element hash table */
+	struct tplg_elem *hash_next;
+	struct tplg_elem **hash_bucket;
+
 	void (*free)(void *obj);
 };
 
@@ -202,14 +213,16 @@ struct map_elem {
 	int id;
 };
 
-/* output buffer */
+/* output buffer - growable arena, formatted in place */
 struct tplg_buf {
 	char *dst;
-	size_t dst_len;
-	char *printf_buf;
-	size_t printf_buf_size;
+	size_t dst_len;		/* used bytes, excluding the terminator */
+	size_t dst_size;	/* allocated bytes */
 };
 
+/* section parser callback */
+typedef int (*tplg_parser_t)(snd_tplg_t *tplg, snd_config_t *cfg, void *priv);
+
 /* mapping table */
 struct tplg_table {
 	const char *name;
@@ -222,7 +235,7 @@ struct tplg_table {
 	unsigned build: 1;
 	unsigned enew: 1;
 	void (*free)(void *);
-	int (*parse)(snd_tplg_t *tplg, snd_config_t *cfg, void *priv);
+	tplg_parser_t parse;
 	int (*save)(snd_tplg_t *tplg, struct tplg_elem *elem,
 		    struct tplg_buf *dst, const char *prefix);
 	int (*gsave)(snd_tplg_t *tplg, int index,
@@ -312,8 +325,10 @@ int tplg_ref_add_elem(struct tplg_elem *elem, struct tplg_elem *elem_ref);
 struct tplg_elem *tplg_elem_new(void);
 void tplg_elem_free(struct tplg_elem *elem);
 void tplg_elem_free_list(struct list_head *base);
-void tplg_elem_insert(struct tplg_elem *elem_p, struct list_head *list);
-struct tplg_elem *tplg_elem_lookup(struct list_head *base,
+void tplg_elem_insert(snd_tplg_t *tplg, struct tplg_elem *elem_p,
+				struct list_head *list);
+struct tplg_elem *tplg_elem_lookup(snd_tplg_t *tplg,
+				struct list_head *base,
 				const char* id,
 				unsigned int type,
 				int index);
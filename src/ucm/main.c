@@ -38,6 +38,7 @@
 #include <pthread.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
+#include <sys/inotify.h>
 #include <limits.h>
 
 /*
@@ -399,10 +400,12 @@ er:
 	return -EINVAL;
 }
 
-static int execute_cset(snd_ctl_t *ctl, const char *cset, unsigned int type)
+static int execute_cset(snd_ctl_t *ctl, struct sequence_element *s)
 {
+	const char *cset = s->data.cset;
+	unsigned int type = s->type;
 	const char *pos;
-	int err;
+	int cacheable, err;
 	snd_ctl_elem_id_t *id;
 	snd_ctl_elem_value_t *value;
 	snd_ctl_elem_info_t *info, *info2 = NULL;
@@ -412,6 +415,20 @@ static int execute_cset(snd_ctl_t *ctl, const char *cset, unsigned int type)
 	snd_ctl_elem_value_malloc(&value);
 	snd_ctl_elem_info_malloc(&info);
 
+	/* the target of a plain cset line never changes - reuse the
+	 * resolved id (numid included) and element info from the last
+	 * execution on the same ctl handle
+	 */
+	cacheable = type == SEQUENCE_ELEMENT_TYPE_CSET ||
+		    type == SEQUENCE_ELEMENT_TYPE_CSET_BIN_FILE ||
+		    type == SEQUENCE_ELEMENT_TYPE_CSET_TLV;
+	if (cacheable && s->cset_id != NULL && s->cset_ctl == ctl) {
+		*id = *s->cset_id;
+		*info = *s->cset_info;
+		pos = s->cset_vpos;
+		goto __value;
+	}
+
 	err = __snd_ctl_ascii_elem_id_parse(id, cset, &pos);
 	if (err < 0)
 		goto __fail;
@@ -465,6 +482,19 @@ static int execute_cset(snd_ctl_t *ctl, const char *cset, unsigned int type)
 		snd_ctl_elem_info_set_id(info, id);
 	} else if (err < 0)
 		goto __fail;
+	if (cacheable) {
+		if (s->cset_id == NULL)
+			snd_ctl_elem_id_malloc(&s->cset_id);
+		if (s->cset_info == NULL)
+			snd_ctl_elem_info_malloc(&s->cset_info);
+		if (s->cset_id != NULL && s->cset_info != NULL) {
+			snd_ctl_elem_info_get_id(info, s->cset_id);
+			*s->cset_info = *info;
+			s->cset_vpos = pos;
+			s->cset_ctl = ctl;
+		}
+	}
+      __value:
 	if (type == SEQUENCE_ELEMENT_TYPE_CSET_TLV) {
 		if (!snd_ctl_elem_info_is_tlv_writable(info)) {
 			err = -EINVAL;
@@ -823,7 +853,7 @@ static int execute_sequence(snd_use_case_mgr_t *uc_mgr,
 				}
 				ctl = ctl_list->ctl;
 			}
-			err = execute_cset(ctl, s->data.cset, s->type);
+			err = execute_cset(ctl, s);
 			if (err < 0) {
 				uc_error("unable to execute cset '%s'", s->data.cset);
 				goto __fail;
@@ -1202,12 +1232,19 @@ static int get_list20(struct list_head *list,
  * \param verb_name verb to find
  * \return structure on success, otherwise a NULL (not found)
  */
-static inline struct use_case_verb *find_verb(snd_use_case_mgr_t *uc_mgr,
-					      const char *verb_name)
+static struct use_case_verb *find_verb(snd_use_case_mgr_t *uc_mgr,
+				       const char *verb_name)
 {
-	return find(&uc_mgr->verb_list,
+	struct use_case_verb *verb;
+
+	verb = find(&uc_mgr->verb_list,
 		    struct use_case_verb, list, name,
 		    verb_name);
+	/* in the lazy mode the verb file body is parsed on first use */
+	if (verb != NULL && !verb->parsed &&
+	    uc_mgr_parse_verb_body(uc_mgr, verb) < 0)
+		return NULL;
+	return verb;
 }
 
 static int is_devlist_supported(snd_use_case_mgr_t *uc_mgr, 
@@ -1268,6 +1305,20 @@ static inline struct use_case_device *
 	struct use_case_device *device;
 	struct list_head *pos;
 
+	if (verb->indexed) {
+		device = verb->device_hash[uc_mgr_index_hash(device_name,
+						strlen(device_name))];
+		for (; device; device = device->hash_next) {
+			if (strcmp(device_name, device->name))
+				continue;
+			if (check_supported &&
+			    !is_device_supported(uc_mgr, device))
+				continue;
+			return device;
+		}
+		return NULL;
+	}
+
 	list_for_each(pos, &verb->device_list) {
 		device = list_entry(pos, struct use_case_device, list);
 
@@ -1296,6 +1347,20 @@ static struct use_case_modifier *
 	struct use_case_modifier *modifier;
 	struct list_head *pos;
 
+	if (verb->indexed) {
+		modifier = verb->modifier_hash[uc_mgr_index_hash(modifier_name,
+						strlen(modifier_name))];
+		for (; modifier; modifier = modifier->hash_next) {
+			if (strcmp(modifier->name, modifier_name))
+				continue;
+			if (check_supported &&
+			    !is_modifier_supported(uc_mgr, modifier))
+				continue;
+			return modifier;
+		}
+		return NULL;
+	}
+
 	list_for_each(pos, &verb->modifier_list) {
 		modifier = list_entry(pos, struct use_case_modifier, list);
 
@@ -1515,6 +1580,7 @@ int snd_use_case_mgr_open(snd_use_case_mgr_t **uc_mgr,
 	mgr = calloc(1, sizeof(snd_use_case_mgr_t));
 	if (mgr == NULL)
 		return -ENOMEM;
+	snd_memstat_update(SND_MEMSTAT_UCM, sizeof(*mgr), 1);
 	INIT_LIST_HEAD(&mgr->verb_list);
 	INIT_LIST_HEAD(&mgr->fixedboot_list);
 	INIT_LIST_HEAD(&mgr->boot_list);
@@ -1524,6 +1590,10 @@ int snd_use_case_mgr_open(snd_use_case_mgr_t **uc_mgr,
 	INIT_LIST_HEAD(&mgr->active_devices);
 	INIT_LIST_HEAD(&mgr->ctl_list);
 	INIT_LIST_HEAD(&mgr->variable_list);
+	INIT_LIST_HEAD(&mgr->subs_cache);
+	INIT_LIST_HEAD(&mgr->regex_cache);
+	INIT_LIST_HEAD(&mgr->file_list);
+	mgr->watch_fd = -1;
 	pthread_mutex_init(&mgr->mutex, NULL);
 
 	if (card_name && *card_name == '-') {
@@ -1595,6 +1665,70 @@ int snd_use_case_mgr_reload(snd_use_case_mgr_t *uc_mgr)
 	return err;
 }
 
+/* add a directory watch for the parent of a configuration file; the
+ * directory is watched instead of the file itself so a replace by
+ * rename or a re-creation of the file is noticed as well
+ */
+static int watch_add_file(int fd, const char *filename)
+{
+	char dir[PATH_MAX];
+	const char *slash;
+	size_t len;
+
+	slash = strrchr(filename, '/');
+	if (slash == NULL || slash == filename) {
+		strcpy(dir, slash ? "/" : ".");
+	} else {
+		len = slash - filename;
+		if (len >= sizeof(dir))
+			return -ENAMETOOLONG;
+		memcpy(dir, filename, len);
+		dir[len] = '\0';
+	}
+	if (inotify_add_watch(fd, dir, IN_CLOSE_WRITE | IN_CREATE |
+					IN_DELETE | IN_MOVE) < 0)
+		return -errno;
+	return 0;
+}
+
+int snd_use_case_mgr_watch(snd_use_case_mgr_t *uc_mgr)
+{
+	char buf[sizeof(struct inotify_event) + NAME_MAX + 1];
+	struct list_head *pos;
+	struct ucm_watch_file *file;
+	int err = 0;
+
+	pthread_mutex_lock(&uc_mgr->mutex);
+	if (uc_mgr->watch_fd < 0) {
+		uc_mgr->watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (uc_mgr->watch_fd < 0) {
+			err = -errno;
+			goto _end;
+		}
+	} else {
+		/* re-arm: the caller handled the events reported so far */
+		while (read(uc_mgr->watch_fd, buf, sizeof(buf)) > 0)
+			;
+	}
+	/* adding a watch for an already watched directory just refreshes
+	 * it, so the whole list is walked on every call */
+	list_for_each(pos, &uc_mgr->file_list) {
+		file = list_entry(pos, struct ucm_watch_file, list);
+		err = watch_add_file(uc_mgr->watch_fd, file->name);
+		if (err < 0)
+			break;
+	}
+	if (err < 0) {
+		close(uc_mgr->watch_fd);
+		uc_mgr->watch_fd = -1;
+	} else {
+		err = uc_mgr->watch_fd;
+	}
+_end:
+	pthread_mutex_unlock(&uc_mgr->mutex);
+	return err;
+}
+
 int snd_use_case_mgr_close(snd_use_case_mgr_t *uc_mgr)
 {
 	uc_mgr_card_close(uc_mgr);
@@ -2123,34 +2257,53 @@ int snd_use_case_get_list(snd_use_case_mgr_t *uc_mgr,
 	return err;
 }
 
+static int get_value_emit(snd_use_case_mgr_t *uc_mgr, char **value,
+			  struct ucm_value *val)
+{
+	int err;
+
+	if (uc_mgr->conf_format < 2) {
+		*value = strdup(val->data);
+		if (*value == NULL)
+			return -ENOMEM;
+		return 0;
+	}
+	err = uc_mgr_get_substituted_value(uc_mgr, value, val->data);
+	if (err < 0)
+		return err;
+	return rewrite_device_value(uc_mgr, val->name, value);
+}
+
 static int get_value1(snd_use_case_mgr_t *uc_mgr, char **value,
 		      struct list_head *value_list, const char *identifier)
 {
 	struct ucm_value *val;
 	struct list_head *pos;
-	int err;
 
 	if (!value_list)
 		return -ENOENT;
 
 	list_for_each(pos, value_list) {
 		val = list_entry(pos, struct ucm_value, list);
-		if (check_identifier(identifier, val->name)) {
-			if (uc_mgr->conf_format < 2) {
-				*value = strdup(val->data);
-				if (*value == NULL)
-					return -ENOMEM;
-				return 0;
-			}
-			err = uc_mgr_get_substituted_value(uc_mgr, value, val->data);
-			if (err < 0)
-				return err;
-			return rewrite_device_value(uc_mgr, val->name, value);
-		}
+		if (check_identifier(identifier, val->name))
+			return get_value_emit(uc_mgr, value, val);
 	}
 	return -ENOENT;
 }
 
+/* hashed variant of get_value1 for the per-verb indexes */
+static int get_value_indexed(snd_use_case_mgr_t *uc_mgr, char **value,
+			     struct ucm_value *const *hash,
+			     const char *identifier)
+{
+	struct ucm_value *val;
+
+	val = uc_mgr_value_index_find(hash, identifier);
+	if (val == NULL)
+		return -ENOENT;
+	return get_value_emit(uc_mgr, value, val);
+}
+
 static int get_value3(snd_use_case_mgr_t *uc_mgr,
 		      char **value,
 		      const char *identifier,
@@ -2203,9 +2356,14 @@ static int get_value(snd_use_case_mgr_t *uc_mgr,
 				mod = find_modifier(uc_mgr, verb,
 						    mod_dev_name, 0);
 				if (mod) {
-					err = get_value1(uc_mgr, value,
-							 &mod->value_list,
-							 identifier);
+					if (verb->indexed)
+						err = get_value_indexed(uc_mgr,
+							value, mod->value_hash,
+							identifier);
+					else
+						err = get_value1(uc_mgr, value,
+							&mod->value_list,
+							identifier);
 					if (err >= 0 || err != -ENOENT)
 						return err;
 				}
@@ -2213,9 +2371,14 @@ static int get_value(snd_use_case_mgr_t *uc_mgr,
 				dev = find_device(uc_mgr, verb,
 						  mod_dev_name, 0);
 				if (dev) {
-					err = get_value1(uc_mgr, value,
-							 &dev->value_list,
-							 identifier);
+					if (verb->indexed)
+						err = get_value_indexed(uc_mgr,
+							value, dev->value_hash,
+							identifier);
+					else
+						err = get_value1(uc_mgr, value,
+							&dev->value_list,
+							identifier);
 					if (err >= 0 || err != -ENOENT)
 						return err;
 				}
@@ -2224,7 +2387,12 @@ static int get_value(snd_use_case_mgr_t *uc_mgr,
 					return -ENOENT;
 			}
 
-			err = get_value1(uc_mgr, value, &verb->value_list, identifier);
+			if (verb->indexed)
+				err = get_value_indexed(uc_mgr, value,
+						verb->value_hash, identifier);
+			else
+				err = get_value1(uc_mgr, value,
+						 &verb->value_list, identifier);
 			if (err >= 0 || err != -ENOENT)
 				return err;
 		}
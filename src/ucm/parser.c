@@ -34,6 +34,7 @@
 #include <sys/stat.h>
 #include <stdbool.h>
 #include <dirent.h>
+#include <fcntl.h>
 #include <limits.h>
 
 static int filename_filter(const struct dirent64 *dirent);
@@ -78,6 +79,8 @@ int uc_mgr_config_load_file(snd_use_case_mgr_t *uc_mgr,
 		uc_error("error: failed to open file %s: %d", filename, err);
 		return err;
 	}
+	uc_mgr_cache_loaded_file(uc_mgr, filename);
+	uc_mgr_record_loaded_file(uc_mgr, filename);
 	return 0;
 }
 
@@ -1964,16 +1967,18 @@ static int parse_verb(snd_use_case_mgr_t *uc_mgr,
  *  o Optional PCM device ID for verb and modifiers
  *  o Alias kcontrols IDs for master and volumes and mutes.
  */
+static int ucm_lazy_verbs(void)
+{
+	const char *e = getenv(ALSA_UCM_LAZY_VERBS_VAR);
+	return e != NULL && *e != '\0' && strcmp(e, "0") != 0;
+}
+
 static int parse_verb_file(snd_use_case_mgr_t *uc_mgr,
 			   const char *use_case_name,
 			   const char *comment,
 			   const char *file)
 {
-	snd_config_iterator_t i, next;
-	snd_config_t *n;
 	struct use_case_verb *verb;
-	snd_config_t *cfg;
-	int err;
 
 	/* allocate verb */
 	verb = calloc(1, sizeof(struct use_case_verb));
@@ -2001,15 +2006,65 @@ static int parse_verb_file(snd_use_case_mgr_t *uc_mgr,
 			return -ENOMEM;
 	}
 
-	/* open Verb file for reading */
-	err = uc_mgr_config_load_file(uc_mgr, file, &cfg);
-	if (err < 0)
-		return err;
+	verb->file = strdup(file);
+	if (verb->file == NULL)
+		return -ENOMEM;
+	if (uc_mgr->parse_variant != NULL) {
+		verb->variant = strdup(uc_mgr->parse_variant);
+		if (verb->variant == NULL)
+			return -ENOMEM;
+	}
 
-	/* in-place evaluation */
-	err = uc_mgr_evaluate_inplace(uc_mgr, cfg);
-	if (err < 0)
-		goto _err;
+	/* in the lazy mode the verb body is parsed on the first use
+	 * (see find_verb), parse errors surface there instead of here
+	 */
+	if (ucm_lazy_verbs())
+		return 0;
+
+	return uc_mgr_parse_verb_body(uc_mgr, verb);
+}
+
+/*
+ * Parse the body of a verb file (everything beyond the name and the
+ * comment, which come from the master configuration).
+ */
+int uc_mgr_parse_verb_body(snd_use_case_mgr_t *uc_mgr,
+			   struct use_case_verb *verb)
+{
+	snd_config_iterator_t i, next;
+	snd_config_t *n;
+	const char *file = verb->file;
+	const char *saved_variant;
+	snd_config_t *cfg;
+	int err;
+
+	/* the variant selection must match the master section parse */
+	saved_variant = uc_mgr->parse_variant;
+	uc_mgr->parse_variant = verb->variant;
+
+	/* reuse the evaluated verb tree from the compiled profile cache */
+	cfg = NULL;
+	if (uc_mgr->cache_config) {
+		err = uc_mgr_cache_get_verb(uc_mgr, file, &cfg);
+		if (err < 0 && err != -ENOENT)
+			goto _err_novalid;
+	}
+
+	if (cfg == NULL) {
+		/* open Verb file for reading */
+		err = uc_mgr_config_load_file(uc_mgr, file, &cfg);
+		if (err < 0)
+			goto _err_novalid;
+
+		/* in-place evaluation */
+		err = uc_mgr_evaluate_inplace(uc_mgr, cfg);
+		if (err < 0)
+			goto _err;
+
+		err = uc_mgr_cache_put_verb(uc_mgr, file, cfg);
+		if (err < 0)
+			goto _err;
+	}
 
 	/* parse master config sections */
 	snd_config_for_each(i, next, cfg) {
@@ -2087,24 +2142,33 @@ static int parse_verb_file(snd_use_case_mgr_t *uc_mgr,
 	}
 
 	snd_config_delete(cfg);
+	cfg = NULL;
 
 	/* use case verb must have at least 1 device */
 	if (list_empty(&verb->device_list)) {
 		uc_error("error: no use case device defined", file);
-		return -EINVAL;
+		err = -EINVAL;
+		goto _err_novalid;
 	}
 
 	/* do device rename and delete */
 	err = verb_device_management(verb);
 	if (err < 0) {
 		uc_error("error: device management error in verb '%s'", verb->name);
-		return err;
+		goto _err_novalid;
 	}
 
+	/* the lists are final now, build the name-keyed indexes */
+	uc_mgr_index_verb(verb);
+
+	verb->parsed = 1;
+	uc_mgr->parse_variant = saved_variant;
 	return 0;
 
        _err:
 	snd_config_delete(cfg);
+       _err_novalid:
+	uc_mgr->parse_variant = saved_variant;
 	return err;
 }
 
@@ -2416,16 +2480,29 @@ static int parse_master_file(snd_use_case_mgr_t *uc_mgr, snd_config_t *cfg)
 		return -EINVAL;
 	}
 
-	if (uc_mgr->conf_format >= 2) {
-		err = parse_syntax_field(uc_mgr, cfg, uc_mgr->conf_file_name);
+	if (uc_mgr->cache_config) {
+		/* reuse the evaluated master tree from the compiled
+		 * profile cache (restores the syntax version, too)
+		 */
+		err = uc_mgr_cache_get_master(uc_mgr, cfg);
 		if (err < 0)
 			return err;
-	}
+	} else {
+		if (uc_mgr->conf_format >= 2) {
+			err = parse_syntax_field(uc_mgr, cfg, uc_mgr->conf_file_name);
+			if (err < 0)
+				return err;
+		}
 
-	/* in-place evaluation */
-	err = uc_mgr_evaluate_inplace(uc_mgr, cfg);
-	if (err < 0)
-		return err;
+		/* in-place evaluation */
+		err = uc_mgr_evaluate_inplace(uc_mgr, cfg);
+		if (err < 0)
+			return err;
+
+		err = uc_mgr_cache_put_master(uc_mgr, cfg);
+		if (err < 0)
+			return err;
+	}
 
 	/* parse master config sections */
 	snd_config_for_each(i, next, cfg) {
@@ -2807,12 +2884,23 @@ static int load_toplevel_config(snd_use_case_mgr_t *uc_mgr,
 	if (err < 0)
 		goto __error;
 
+	/* the card configuration names are resolved now */
+	err = uc_mgr_cache_open(uc_mgr);
+	if (err < 0)
+		goto __error;
+
+	/* warm open - the master file contents come from the cache */
+	if (uc_mgr->cache_config)
+		return snd_config_top(cfg);
+
 	err = uc_mgr_config_load(uc_mgr->conf_format, filename, cfg);
 	if (err < 0) {
 		uc_error("error: could not parse configuration for card %s",
 				uc_mgr->card_name);
 		goto __error;
 	}
+	uc_mgr_cache_loaded_file(uc_mgr, filename);
+	uc_mgr_record_loaded_file(uc_mgr, filename);
 
 	return 0;
 
@@ -2862,11 +2950,15 @@ int uc_mgr_import_master_config(snd_use_case_mgr_t *uc_mgr)
 	if (err < 0) {
 		uc_mgr_free_ctl_list(uc_mgr);
 		uc_mgr_free_verb(uc_mgr);
+	} else {
+		uc_mgr_cache_save(uc_mgr);
 	}
+	uc_mgr_cache_done(uc_mgr);
 
 	return err;
 
 __error:
+	uc_mgr_cache_done(uc_mgr);
 	uc_mgr_free_ctl_list(uc_mgr);
 	replace_string(&uc_mgr->conf_dir_name, NULL);
 	return err;
@@ -2889,6 +2981,95 @@ static int filename_filter(const struct dirent64 *dirent)
 	return 0;
 }
 
+/* probe one card - open its UCM profile and fetch the comment */
+static int scan_card_comment(int card, char **name, char **comment)
+{
+	char fn[FILENAME_MAX];
+	snd_use_case_mgr_t *uc_mgr;
+	char *s;
+	int err;
+
+	snprintf(fn, sizeof(fn), "-hw:%d", card);
+	err = snd_use_case_mgr_open(&uc_mgr, fn);
+	if (err < 0) {
+		if (err != -ENOENT && err != -ENXIO)
+			uc_error("Unable to open '%s': %s", fn, snd_strerror(err));
+		return err;
+	}
+	err = snd_use_case_get(uc_mgr, "comment", (const char **)&s);
+	if (err < 0)
+		err = snd_card_get_longname(card, &s);
+	snd_use_case_mgr_close(uc_mgr);
+	if (err < 0)
+		return err;
+	*name = strdup(fn + 1);
+	if (*name == NULL) {
+		free(s);
+		return -ENOMEM;
+	}
+	*comment = s;
+	return 0;
+}
+
+#ifndef DOC_HIDDEN
+struct scan_card {
+	pthread_t thread;
+	int active;
+	int card;
+	int err;
+	char *name;
+	char *comment;
+};
+#endif /* DOC_HIDDEN */
+
+static void *scan_card_thread(void *data)
+{
+	struct scan_card *w = data;
+
+	w->err = scan_card_comment(w->card, &w->name, &w->comment);
+	return NULL;
+}
+
+static int scan_parallel_enabled(void)
+{
+	const char *e = getenv(ALSA_UCM_PARALLEL_SCAN_VAR);
+
+	return e != NULL && *e != '\0' && strcmp(e, "0") != 0;
+}
+
+/* ask the kernel to read the configuration tree ahead; the advises are
+ * asynchronous, so the file contents are fetched from the storage while
+ * the workers parse the profiles
+ */
+static void scan_readahead_dir(const char *path, int depth)
+{
+	char fn[PATH_MAX];
+	struct dirent64 *de;
+	DIR *d;
+	int fd;
+
+	if (depth <= 0)
+		return;
+	d = opendir(path);
+	if (d == NULL)
+		return;
+	while ((de = readdir64(d)) != NULL) {
+		if (de->d_name[0] == '.')
+			continue;
+		snprintf(fn, sizeof(fn), "%s/%s", path, de->d_name);
+		if (de->d_type == DT_DIR) {
+			scan_readahead_dir(fn, depth - 1);
+			continue;
+		}
+		fd = open(fn, O_RDONLY | O_NONBLOCK);
+		if (fd >= 0) {
+			posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+			close(fd);
+		}
+	}
+	closedir(d);
+}
+
 /* scan all cards and comments
  *
  * Cards are defined by machines. Each card/machine installs its UCM
@@ -2896,28 +3077,42 @@ static int filename_filter(const struct dirent64 *dirent)
  * card under /usr/share/alsa/ucm2. This function will scan all the card
  * directories and skip the component directories defined in the array
  * component_dir.
+ *
+ * The per-card probes open the full UCM profiles. When the parallel
+ * scan is enabled (ALSA_UCM_PARALLEL_SCAN environment variable), the
+ * probes run in one worker thread per card and the results are merged
+ * in the card order, so the output is identical to the serial scan.
  */
 int uc_mgr_scan_master_configs(const char **_list[])
 {
 	char filename[PATH_MAX], dfl[PATH_MAX], fn[FILENAME_MAX];
 	char *env = getenv(ALSA_CONFIG_UCM2_VAR);
-	snd_use_case_mgr_t *uc_mgr;
 	const char **list, *d_name;
-	char *s;
+	struct scan_card *workers = NULL, *nworkers, *w;
 	snd_config_t *cfg, *c;
-	int i, j, cnt, err, cards;
+	int i, j, k, cnt, err, cards, nw, parallel;
 	long l;
 	ssize_t ss;
 	struct dirent64 **namelist;
 
 	i = -1;
-	cards = 0;
+	cards = nw = 0;
 	while (1) {
 		err = snd_card_next(&i);
-		if (err < 0)
+		if (err < 0) {
+			free(workers);
 			return err;
+		}
 		if (i < 0)
 			break;
+		nworkers = realloc(workers, (nw + 1) * sizeof(*workers));
+		if (nworkers == NULL) {
+			free(workers);
+			return -ENOMEM;
+		}
+		workers = nworkers;
+		memset(&workers[nw], 0, sizeof(*workers));
+		workers[nw++].card = i;
 		cards++;
 	}
 	cards += 4;	/* plug-and-play */
@@ -2938,6 +3133,7 @@ int uc_mgr_scan_master_configs(const char **_list[])
 		err = -errno;
 		uc_error("error: could not scan directory %s: %s",
 				filename, strerror(-err));
+		free(workers);
 		return err;
 	}
 	cnt = err;
@@ -2963,35 +3159,40 @@ int uc_mgr_scan_master_configs(const char **_list[])
 		goto __err;
 	}
 
-	i = -1;
-	while (j / 2 < cards) {
-		err = snd_card_next(&i);
-		if (err < 0)
-			goto __err;
-		if (i < 0)
-			break;
-		snprintf(fn, sizeof(fn), "-hw:%d", i);
-		err = snd_use_case_mgr_open(&uc_mgr, fn);
-		if (err == -ENOENT || err == -ENXIO)
-			continue;
-		if (err < 0) {
-			uc_error("Unable to open '%s': %s", fn, snd_strerror(err));
-			goto __err;
+	parallel = nw > 1 && scan_parallel_enabled();
+	if (parallel) {
+		scan_readahead_dir(uc_mgr_config_dir(2), 8);
+		for (k = 0; k < nw; k++) {
+			w = &workers[k];
+			if (pthread_create(&w->thread, NULL, scan_card_thread, w) == 0)
+				w->active = 1;
+			else
+				scan_card_thread(w);
 		}
-		err = snd_use_case_get(uc_mgr, "comment", (const char **)&s);
-		if (err < 0) {
-			err = snd_card_get_longname(i, &s);
-			if (err < 0)
-				goto __err;
+		for (k = 0; k < nw; k++) {
+			w = &workers[k];
+			if (w->active)
+				pthread_join(w->thread, NULL);
 		}
-		snd_use_case_mgr_close(uc_mgr);
-		list[j] = strdup(fn + 1);
-		if (list[j] == NULL) {
-			free(s);
-			err = -ENOMEM;
-			goto __err;
+	} else {
+		for (k = 0; k < nw; k++) {
+			w = &workers[k];
+			w->err = scan_card_comment(w->card, &w->name, &w->comment);
 		}
-		list[j + 1] = s;
+	}
+
+	/* merge the probe results in the card order */
+	for (k = 0; k < nw && j / 2 < cards; k++) {
+		w = &workers[k];
+		err = w->err;
+		if (err == -ENOENT || err == -ENXIO)
+			continue;
+		if (err < 0)
+			goto __err;
+		list[j] = w->name;
+		list[j + 1] = w->comment;
+		w->name = NULL;
+		w->comment = NULL;
 		j += 2;
 	}
 
@@ -3055,6 +3256,11 @@ int uc_mgr_scan_master_configs(const char **_list[])
 	err = 0;
 
       __err:
+	for (k = 0; k < nw; k++) {
+		free(workers[k].name);
+		free(workers[k].comment);
+	}
+	free(workers);
 	for (i = 0; i < cnt; i++)
 		free(namelist[i]);
 	free(namelist);
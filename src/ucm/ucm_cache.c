@@ -0,0 +1,526 @@
+/*
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *  Copyright (C) 2025 Red Hat Inc.
+ *  Authors: Jaroslav Kysela <perex@perex.cz>
+ */
+
+#include "ucm_local.h"
+#include <sys/stat.h>
+#include <limits.h>
+
+/*
+ * Compiled profile cache
+ *
+ * The full evaluation of an UCM2 configuration tree (includes, macros,
+ * variables and conditions) opens many small files and may become the
+ * dominant cost of snd_use_case_mgr_open() on slow storage. This cache
+ * stores the result of the evaluation - the master configuration tree
+ * and the per-verb trees after uc_mgr_evaluate_inplace() together with
+ * the snapshots of the UCM variables - in one file in the per-user
+ * cache directory, so subsequent opens parse a single file and skip
+ * the evaluation completely.
+ *
+ * The cache is validated using the modification time and size of all
+ * source configuration files which were opened while the profile was
+ * compiled. Conditions may also depend on inputs outside those files
+ * (control elements, sysfs attributes, environment), which cannot be
+ * tracked here; for this reason the cache is strictly opt-in through
+ * the ALSA_UCM_PROFILE_CACHE environment variable.
+ */
+
+#define UCM_CACHE_VERSION	1
+
+static int ucm_cache_enabled(void)
+{
+	const char *e = getenv(ALSA_UCM_PROFILE_CACHE_VAR);
+	return e != NULL && *e != '\0' && strcmp(e, "0") != 0;
+}
+
+static unsigned int ucm_cache_hash(unsigned int hash, const char *s)
+{
+	while (*s)
+		hash = (hash ^ (unsigned char)*s++) * 16777619U;
+	return hash;
+}
+
+static void ucm_cache_filename(snd_use_case_mgr_t *uc_mgr,
+			       char *fn, size_t fn_len)
+{
+	unsigned int hash = 2166136261U;
+
+	hash = ucm_cache_hash(hash, uc_mgr_config_dir(uc_mgr->conf_format));
+	hash = ucm_cache_hash(hash, uc_mgr->card_name ?: "");
+	hash = ucm_cache_hash(hash, uc_mgr->conf_dir_name ?: "");
+	hash = ucm_cache_hash(hash, uc_mgr->conf_file_name ?: "");
+	snprintf(fn, fn_len, "ucm-%08x", hash);
+}
+
+/* stamp used to detect the modification of a source file */
+static int ucm_cache_file_stamp(const char *path, char *buf, size_t buf_len)
+{
+	struct stat64 st;
+
+	if (stat64(path, &st) < 0)
+		return -errno;
+	snprintf(buf, buf_len, "%llx-%lx-%llx",
+		 (long long)st.st_mtim.tv_sec,
+		 (unsigned long)st.st_mtim.tv_nsec,
+		 (long long)st.st_size);
+	return 0;
+}
+
+static int ucm_cache_add_string(snd_config_t *parent, const char *id,
+				const char *value)
+{
+	snd_config_t *n;
+	int err;
+
+	err = snd_config_imake_string(&n, id, value);
+	if (err < 0)
+		return err;
+	err = snd_config_add(parent, n);
+	if (err < 0)
+		snd_config_delete(n);
+	return err;
+}
+
+static int ucm_cache_add_integer(snd_config_t *parent, const char *id,
+				 long value)
+{
+	snd_config_t *n;
+	int err;
+
+	err = snd_config_imake_integer(&n, id, value);
+	if (err < 0)
+		return err;
+	err = snd_config_add(parent, n);
+	if (err < 0)
+		snd_config_delete(n);
+	return err;
+}
+
+static int ucm_cache_add_compound(snd_config_t *parent, const char *id,
+				  snd_config_t **result)
+{
+	snd_config_t *n;
+	int err;
+
+	err = snd_config_make_compound(&n, id, 0);
+	if (err < 0)
+		return err;
+	err = snd_config_add(parent, n);
+	if (err < 0) {
+		snd_config_delete(n);
+		return err;
+	}
+	*result = n;
+	return 0;
+}
+
+/* find a direct child; the ids may contain dots (file paths), thus
+ * snd_config_search() cannot be used here
+ */
+static snd_config_t *ucm_cache_find_child(snd_config_t *parent, const char *id)
+{
+	snd_config_iterator_t i, next;
+	snd_config_t *n;
+	const char *id2;
+
+	snd_config_for_each(i, next, parent) {
+		n = snd_config_iterator_entry(i);
+		if (snd_config_get_id(n, &id2) < 0)
+			continue;
+		if (strcmp(id, id2) == 0)
+			return n;
+	}
+	return NULL;
+}
+
+/* copy all childs from one compound to another */
+static int ucm_cache_copy_childs(snd_config_t *dst, snd_config_t *src)
+{
+	snd_config_iterator_t i, next;
+	snd_config_t *n, *copy;
+	int err;
+
+	snd_config_for_each(i, next, src) {
+		n = snd_config_iterator_entry(i);
+		err = snd_config_copy(&copy, n);
+		if (err < 0)
+			return err;
+		err = snd_config_add(dst, copy);
+		if (err < 0) {
+			snd_config_delete(copy);
+			return err;
+		}
+	}
+	return 0;
+}
+
+/* replace all childs of a compound by the childs of a cached one */
+static int ucm_cache_replace_childs(snd_config_t *dst, snd_config_t *src)
+{
+	snd_config_iterator_t i, next;
+	int err;
+
+	snd_config_for_each(i, next, dst) {
+		err = snd_config_delete(snd_config_iterator_entry(i));
+		if (err < 0)
+			return err;
+	}
+	return ucm_cache_copy_childs(dst, src);
+}
+
+/* store the current UCM variables to the given compound */
+static int ucm_cache_put_variables(snd_use_case_mgr_t *uc_mgr,
+				   snd_config_t *parent)
+{
+	snd_config_t *vars;
+	struct list_head *pos;
+	struct ucm_value *value;
+	int err;
+
+	err = ucm_cache_add_compound(parent, "Variables", &vars);
+	if (err < 0)
+		return err;
+	list_for_each(pos, &uc_mgr->variable_list) {
+		value = list_entry(pos, struct ucm_value, list);
+		err = ucm_cache_add_string(vars, value->name, value->data);
+		if (err < 0)
+			return err;
+	}
+	return 0;
+}
+
+/* restore the UCM variables from the given compound */
+static int ucm_cache_get_variables(snd_use_case_mgr_t *uc_mgr,
+				   snd_config_t *parent)
+{
+	snd_config_iterator_t i, next;
+	snd_config_t *vars, *n;
+	const char *id, *str;
+	int err;
+
+	err = snd_config_search(parent, "Variables", &vars);
+	if (err < 0)
+		return err;
+	uc_mgr_free_value(&uc_mgr->variable_list);
+	snd_config_for_each(i, next, vars) {
+		n = snd_config_iterator_entry(i);
+		if (snd_config_get_id(n, &id) < 0)
+			return -EINVAL;
+		err = snd_config_get_string(n, &str);
+		if (err < 0)
+			return err;
+		err = uc_mgr_set_variable(uc_mgr, id, str);
+		if (err < 0)
+			return err;
+	}
+	return 0;
+}
+
+/* check the recorded source file stamps against the current state;
+ * the verified files are also recorded on the manager so a warm open
+ * feeds the change watch like a regular parse would
+ */
+static int ucm_cache_verify(snd_use_case_mgr_t *uc_mgr, snd_config_t *top)
+{
+	snd_config_iterator_t i, next;
+	snd_config_t *files, *n;
+	const char *id, *str;
+	char stamp[64];
+	long version;
+	int err;
+
+	err = snd_config_search(top, "Version", &n);
+	if (err < 0 || snd_config_get_integer(n, &version) < 0 ||
+	    version != UCM_CACHE_VERSION)
+		return -EINVAL;
+	err = snd_config_search(top, "Files", &files);
+	if (err < 0)
+		return -EINVAL;
+	snd_config_for_each(i, next, files) {
+		n = snd_config_iterator_entry(i);
+		if (snd_config_get_id(n, &id) < 0)
+			return -EINVAL;
+		if (snd_config_get_string(n, &str) < 0)
+			return -EINVAL;
+		if (ucm_cache_file_stamp(id, stamp, sizeof(stamp)) < 0)
+			return -EINVAL;
+		if (strcmp(stamp, str) != 0)
+			return -EINVAL;
+	}
+	/* all stamps matched - the profile is used as is; record its
+	 * sources only now to keep the list free of rejected caches */
+	snd_config_for_each(i, next, files) {
+		n = snd_config_iterator_entry(i);
+		if (snd_config_get_id(n, &id) >= 0)
+			uc_mgr_record_loaded_file(uc_mgr, id);
+	}
+	return 0;
+}
+
+/*
+ * Initialize the cache for one open; either load and validate the
+ * stored profile (warm path - cache_config is set) or prepare the
+ * skeleton of a new one (cold path - cache_build is set). Must be
+ * called when conf_dir_name and conf_file_name are already known.
+ */
+int uc_mgr_cache_open(snd_use_case_mgr_t *uc_mgr)
+{
+	char fn[64], *path;
+	snd_config_t *top, *files;
+	snd_input_t *in;
+	int err;
+
+	/* the cache works with the v2+ syntax only */
+	if (!ucm_cache_enabled() || uc_mgr->conf_format < 2)
+		return 0;
+
+	ucm_cache_filename(uc_mgr, fn, sizeof(fn));
+	if (snd_user_cache_path(fn, 0, &path) >= 0) {
+		err = snd_input_stdio_open(&in, path, "r");
+		free(path);
+		if (err >= 0) {
+			err = snd_config_top(&top);
+			if (err < 0) {
+				snd_input_close(in);
+				return err;
+			}
+			err = snd_config_load(top, in);
+			snd_input_close(in);
+			if (err >= 0 && ucm_cache_verify(uc_mgr, top) == 0) {
+				uc_mgr->cache_config = top;
+				return 0;
+			}
+			snd_config_delete(top);
+		}
+	}
+
+	/* cold open - collect a new profile */
+	err = snd_config_top(&top);
+	if (err < 0)
+		return err;
+	err = ucm_cache_add_integer(top, "Version", UCM_CACHE_VERSION);
+	if (err >= 0)
+		err = ucm_cache_add_compound(top, "Files", &files);
+	if (err < 0) {
+		snd_config_delete(top);
+		return err;
+	}
+	uc_mgr->cache_build = top;
+	return 0;
+}
+
+/* record a source configuration file for the cache validation */
+void uc_mgr_cache_loaded_file(snd_use_case_mgr_t *uc_mgr, const char *filename)
+{
+	snd_config_t *files;
+	char stamp[64];
+
+	if (uc_mgr->cache_build == NULL)
+		return;
+	if (snd_config_search(uc_mgr->cache_build, "Files", &files) < 0)
+		goto __fail;
+	if (ucm_cache_file_stamp(filename, stamp, sizeof(stamp)) < 0)
+		goto __fail;
+	if (ucm_cache_find_child(files, filename) != NULL)
+		return;
+	if (ucm_cache_add_string(files, filename, stamp) < 0)
+		goto __fail;
+	return;
+      __fail:
+	/* do not save a profile with incomplete validation data */
+	snd_config_delete(uc_mgr->cache_build);
+	uc_mgr->cache_build = NULL;
+}
+
+/* store the evaluated master configuration tree */
+int uc_mgr_cache_put_master(snd_use_case_mgr_t *uc_mgr, snd_config_t *cfg)
+{
+	snd_config_t *master, *tree;
+	int err;
+
+	if (uc_mgr->cache_build == NULL)
+		return 0;
+	err = ucm_cache_add_compound(uc_mgr->cache_build, "Master", &master);
+	if (err < 0)
+		return err;
+	err = ucm_cache_add_integer(master, "Syntax", uc_mgr->conf_format);
+	if (err < 0)
+		return err;
+	err = ucm_cache_put_variables(uc_mgr, master);
+	if (err < 0)
+		return err;
+	err = ucm_cache_add_compound(master, "Config", &tree);
+	if (err < 0)
+		return err;
+	return ucm_cache_copy_childs(tree, cfg);
+}
+
+/*
+ * Replace the childs of the given master configuration tree by the
+ * evaluated ones from the cache and restore the parser state (syntax
+ * version and variables) recorded after the original evaluation.
+ */
+int uc_mgr_cache_get_master(snd_use_case_mgr_t *uc_mgr, snd_config_t *cfg)
+{
+	snd_config_t *master, *tree, *n;
+	long syntax;
+	int err;
+
+	err = snd_config_search(uc_mgr->cache_config, "Master", &master);
+	if (err < 0)
+		return err;
+	err = snd_config_search(master, "Syntax", &n);
+	if (err < 0)
+		return err;
+	err = snd_config_get_integer(n, &syntax);
+	if (err < 0)
+		return err;
+	if (syntax < 2 || syntax > SYNTAX_VERSION_MAX)
+		return -EINVAL;
+	err = ucm_cache_get_variables(uc_mgr, master);
+	if (err < 0)
+		return err;
+	err = snd_config_search(master, "Config", &tree);
+	if (err < 0)
+		return err;
+	err = ucm_cache_replace_childs(cfg, tree);
+	if (err < 0)
+		return err;
+	uc_mgr->conf_format = syntax;
+	return 0;
+}
+
+/* store one evaluated verb configuration tree */
+int uc_mgr_cache_put_verb(snd_use_case_mgr_t *uc_mgr, const char *file,
+			  snd_config_t *cfg)
+{
+	snd_config_t *verbs, *verb, *tree;
+	int err;
+
+	if (uc_mgr->cache_build == NULL)
+		return 0;
+	err = snd_config_search(uc_mgr->cache_build, "Verbs", &verbs);
+	if (err == -ENOENT)
+		err = ucm_cache_add_compound(uc_mgr->cache_build, "Verbs", &verbs);
+	if (err < 0)
+		return err;
+	err = ucm_cache_add_compound(verbs, file, &verb);
+	if (err < 0)
+		return err;
+	err = ucm_cache_put_variables(uc_mgr, verb);
+	if (err < 0)
+		return err;
+	err = ucm_cache_add_compound(verb, "Config", &tree);
+	if (err < 0)
+		return err;
+	return ucm_cache_copy_childs(tree, cfg);
+}
+
+/* create an evaluated verb configuration tree from the cache */
+int uc_mgr_cache_get_verb(snd_use_case_mgr_t *uc_mgr, const char *file,
+			  snd_config_t **cfg)
+{
+	snd_config_t *verbs, *verb, *tree, *top;
+	int err;
+
+	err = snd_config_search(uc_mgr->cache_config, "Verbs", &verbs);
+	if (err < 0)
+		return err;
+	verb = ucm_cache_find_child(verbs, file);
+	if (verb == NULL)
+		return -ENOENT;
+	err = ucm_cache_get_variables(uc_mgr, verb);
+	if (err < 0)
+		return err;
+	err = snd_config_search(verb, "Config", &tree);
+	if (err < 0)
+		return err;
+	err = snd_config_top(&top);
+	if (err < 0)
+		return err;
+	err = ucm_cache_copy_childs(top, tree);
+	if (err < 0) {
+		snd_config_delete(top);
+		return err;
+	}
+	*cfg = top;
+	return 0;
+}
+
+/* publish the collected profile; errors only drop the cache */
+void uc_mgr_cache_save(snd_use_case_mgr_t *uc_mgr)
+{
+	char fn[64], *path, *tmp;
+	snd_output_t *out;
+	FILE *fp;
+	int fd, err;
+
+	if (uc_mgr->cache_build == NULL)
+		return;
+	ucm_cache_filename(uc_mgr, fn, sizeof(fn));
+	if (snd_user_cache_path(fn, 1, &path) < 0)
+		return;
+	tmp = malloc(strlen(path) + 8);
+	if (tmp == NULL) {
+		free(path);
+		return;
+	}
+	sprintf(tmp, "%s.XXXXXX", path);
+	fd = mkstemp(tmp);
+	if (fd < 0)
+		goto __end;
+	fp = fdopen(fd, "w");
+	if (fp == NULL) {
+		close(fd);
+		remove(tmp);
+		goto __end;
+	}
+	err = snd_output_stdio_attach(&out, fp, 1);
+	if (err < 0) {
+		fclose(fp);
+		remove(tmp);
+		goto __end;
+	}
+	err = snd_config_save(uc_mgr->cache_build, out);
+	if (snd_output_close(out) < 0)
+		err = -1;
+	/* publish atomically so concurrent clients never read a
+	 * partial profile
+	 */
+	if (err >= 0)
+		err = rename(tmp, path);
+	if (err < 0)
+		remove(tmp);
+      __end:
+	free(tmp);
+	free(path);
+}
+
+/* release the cache state of one open */
+void uc_mgr_cache_done(snd_use_case_mgr_t *uc_mgr)
+{
+	if (uc_mgr->cache_config) {
+		snd_config_delete(uc_mgr->cache_config);
+		uc_mgr->cache_config = NULL;
+	}
+	if (uc_mgr->cache_build) {
+		snd_config_delete(uc_mgr->cache_build);
+		uc_mgr->cache_build = NULL;
+	}
+}
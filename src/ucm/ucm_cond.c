@@ -139,7 +139,7 @@ static int if_eval_regex_match(snd_use_case_mgr_t *uc_mgr, snd_config_t *eval)
 {
 	const char *string, *regex_string;
 	char *s;
-	regex_t re;
+	const regex_t *re;
 	int options = REG_EXTENDED | REG_ICASE;
 	regmatch_t match[1];
 	int err;
@@ -159,7 +159,7 @@ static int if_eval_regex_match(snd_use_case_mgr_t *uc_mgr, snd_config_t *eval)
 	err = uc_mgr_get_substituted_value(uc_mgr, &s, regex_string);
 	if (err < 0)
 		return err;
-	err = regcomp(&re, s, options);
+	err = uc_mgr_regcomp(uc_mgr, &re, s, options);
 	if (err) {
 		uc_error("Regex '%s' compilation failed (code %d)", s, err);
 		free(s);
@@ -168,13 +168,10 @@ static int if_eval_regex_match(snd_use_case_mgr_t *uc_mgr, snd_config_t *eval)
 	free(s);
 
 	err = uc_mgr_get_substituted_value(uc_mgr, &s, string);
-	if (err < 0) {
-		regfree(&re);
+	if (err < 0)
 		return err;
-	}
-	err = regexec(&re, s, ARRAY_SIZE(match), match, 0);
+	err = regexec(re, s, ARRAY_SIZE(match), match, 0);
 	free(s);
-	regfree(&re);
 	return err == 0;
 }
 
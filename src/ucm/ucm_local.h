@@ -38,6 +38,7 @@
 
 #include "local.h"
 #include <pthread.h>
+#include <regex.h>
 #include "use-case.h"
 
 #define SYNTAX_VERSION_MAX	7
@@ -61,10 +62,30 @@
 #define SEQUENCE_ELEMENT_TYPE_DEV_DISABLE_SEQ	14
 #define SEQUENCE_ELEMENT_TYPE_DEV_DISABLE_ALL	15
 
+/* name-keyed index tables, power of two */
+#define UCM_INDEX_HASH_SIZE 16
+
 struct ucm_value {
         struct list_head list;
         char *name;
         char *data;
+        struct ucm_value *hash_next;
+        unsigned int seq;	/* list position, the lowest match wins */
+};
+
+/* configuration file contributing to the manager contents; the list
+ * feeds the change watch created by snd_use_case_mgr_watch() */
+struct ucm_watch_file {
+	struct list_head list;
+	char *name;
+};
+
+/* compiled regular expression (keyed by pattern and options) */
+struct ucm_regex {
+	struct list_head list;
+	char *pattern;
+	int options;
+	regex_t re;
 };
 
 /* sequence of a component device */
@@ -86,6 +107,14 @@ struct sequence_element {
 		char *device;
 		struct component_sequence cmpt_seq; /* component sequence */
 	} data;
+	/* cached cset target (plain cset/bin/tlv only), so repeated
+	 * sequence executions skip the id parsing and the info ioctl;
+	 * valid for the recorded ctl handle only
+	 */
+	snd_ctl_t *cset_ctl;
+	snd_ctl_elem_id_t *cset_id;
+	snd_ctl_elem_info_t *cset_info;
+	const char *cset_vpos;	/* value part inside data.cset */
 };
 
 /*
@@ -159,6 +188,10 @@ struct use_case_modifier {
 
 	/* values */
 	struct list_head value_list;
+
+	/* name-keyed indexes (see uc_mgr_index_verb) */
+	struct use_case_modifier *hash_next;
+	struct ucm_value *value_hash[UCM_INDEX_HASH_SIZE];
 };
 
 /*
@@ -184,6 +217,10 @@ struct use_case_device {
 
 	/* value list */
 	struct list_head value_list;
+
+	/* name-keyed indexes (see uc_mgr_index_verb) */
+	struct use_case_device *hash_next;
+	struct ucm_value *value_hash[UCM_INDEX_HASH_SIZE];
 };
 
 /*
@@ -194,9 +231,12 @@ struct use_case_verb {
 	struct list_head list;
 
 	unsigned int active: 1;
+	unsigned int parsed: 1;	/* verb file body parsed */
 
 	char *name;
 	char *comment;
+	char *file;	/* verb file, body may be parsed on first use */
+	char *variant;	/* variant id for the body parse, may be NULL */
 
 	/* verb enable and disable sequences */
 	struct list_head enable_list;
@@ -219,6 +259,15 @@ struct use_case_verb {
 	/* temporary modifications lists */
 	struct list_head rename_list;
 	struct list_head remove_list;
+
+	/* name-keyed indexes over devices, modifiers and values, built
+	 * once after the verb file parse (uc_mgr_index_verb); same-name
+	 * entries chain in list order for the supported-device checks
+	 */
+	unsigned int indexed: 1;
+	struct use_case_device *device_hash[UCM_INDEX_HASH_SIZE];
+	struct use_case_modifier *modifier_hash[UCM_INDEX_HASH_SIZE];
+	struct ucm_value *value_hash[UCM_INDEX_HASH_SIZE];
 };
 
 /*
@@ -266,6 +315,12 @@ struct snd_use_case_mgr {
 	/* UCM internal variables defined in configuration files */
 	struct list_head variable_list;
 
+	/* memoized ${...} substitution results, flushed on variable change */
+	struct list_head subs_cache;
+
+	/* compiled regular expressions */
+	struct list_head regex_cache;
+
 	/* list of opened control devices */
 	struct list_head ctl_list;
 
@@ -276,6 +331,15 @@ struct snd_use_case_mgr {
 	/* local library configuration */
 	snd_config_t *local_config;
 
+	/* compiled profile cache (ucm_cache.c) */
+	snd_config_t *cache_config;	/* validated profile (warm open) */
+	snd_config_t *cache_build;	/* collected profile (cold open) */
+
+	/* configuration files behind the manager contents and the
+	 * inotify descriptor watching them (snd_use_case_mgr_watch) */
+	struct list_head file_list;
+	int watch_fd;
+
 	/* Components don't define cdev, the card device. When executing
 	 * a sequence of a component device, ucm manager enters component
 	 * domain and needs to provide cdev to the component. This cdev
@@ -302,6 +366,8 @@ int uc_mgr_config_load_into(int format, const char *file, snd_config_t *cfg);
 int uc_mgr_config_load(int format, const char *file, snd_config_t **cfg);
 int uc_mgr_config_load_file(snd_use_case_mgr_t *uc_mgr,  const char *file, snd_config_t **cfg);
 int uc_mgr_import_master_config(snd_use_case_mgr_t *uc_mgr);
+int uc_mgr_parse_verb_body(snd_use_case_mgr_t *uc_mgr,
+			   struct use_case_verb *verb);
 int uc_mgr_scan_master_configs(const char **_list[]);
 
 int uc_mgr_put_to_dev_list(struct dev_list *dev_list, const char *name);
@@ -309,6 +375,9 @@ int uc_mgr_remove_device(struct use_case_verb *verb, const char *name);
 int uc_mgr_rename_device(struct use_case_verb *verb, const char *src,
 			 const char *dst);
 
+void uc_mgr_record_loaded_file(snd_use_case_mgr_t *uc_mgr,
+			       const char *filename);
+void uc_mgr_free_value(struct list_head *base);
 void uc_mgr_free_dev_name_list(struct list_head *base);
 void uc_mgr_free_sequence_element(struct sequence_element *seq);
 void uc_mgr_free_transition_element(struct transition_sequence *seq);
@@ -338,6 +407,11 @@ void uc_mgr_free_ctl_list(snd_use_case_mgr_t *uc_mgr);
 
 int uc_mgr_add_value(struct list_head *base, const char *key, char *val);
 
+unsigned int uc_mgr_index_hash(const char *name, size_t len);
+void uc_mgr_index_verb(struct use_case_verb *verb);
+struct ucm_value *uc_mgr_value_index_find(struct ucm_value *const *hash,
+					  const char *identifier);
+
 const char *uc_mgr_get_variable(snd_use_case_mgr_t *uc_mgr,
 				const char *name);
 
@@ -347,6 +421,16 @@ int uc_mgr_set_variable(snd_use_case_mgr_t *uc_mgr,
 
 int uc_mgr_delete_variable(snd_use_case_mgr_t *uc_mgr, const char *name);
 
+const char *uc_mgr_subs_cache_get(snd_use_case_mgr_t *uc_mgr,
+				  const char *value);
+int uc_mgr_subs_cache_put(snd_use_case_mgr_t *uc_mgr,
+			  const char *value, const char *rvalue);
+void uc_mgr_subs_cache_flush(snd_use_case_mgr_t *uc_mgr);
+
+int uc_mgr_regcomp(snd_use_case_mgr_t *uc_mgr, const regex_t **re,
+		   const char *pattern, int options);
+void uc_mgr_free_regex_cache(snd_use_case_mgr_t *uc_mgr);
+
 int uc_mgr_get_substituted_value(snd_use_case_mgr_t *uc_mgr,
 				 char **_rvalue,
 				 const char *value);
@@ -375,8 +459,28 @@ int uc_mgr_define_regex(snd_use_case_mgr_t *uc_mgr,
 
 int uc_mgr_exec(const char *prog);
 
+int uc_mgr_cache_open(snd_use_case_mgr_t *uc_mgr);
+void uc_mgr_cache_loaded_file(snd_use_case_mgr_t *uc_mgr, const char *filename);
+int uc_mgr_cache_put_master(snd_use_case_mgr_t *uc_mgr, snd_config_t *cfg);
+int uc_mgr_cache_get_master(snd_use_case_mgr_t *uc_mgr, snd_config_t *cfg);
+int uc_mgr_cache_put_verb(snd_use_case_mgr_t *uc_mgr, const char *file,
+			  snd_config_t *cfg);
+int uc_mgr_cache_get_verb(snd_use_case_mgr_t *uc_mgr, const char *file,
+			  snd_config_t **cfg);
+void uc_mgr_cache_save(snd_use_case_mgr_t *uc_mgr);
+void uc_mgr_cache_done(snd_use_case_mgr_t *uc_mgr);
+
 /** The name of the environment variable containing the UCM directory */
 #define ALSA_CONFIG_UCM_VAR "ALSA_CONFIG_UCM"
 
 /** The name of the environment variable containing the UCM directory (new syntax) */
 #define ALSA_CONFIG_UCM2_VAR "ALSA_CONFIG_UCM2"
+
+/** The name of the environment variable enabling the compiled profile cache */
+#define ALSA_UCM_PROFILE_CACHE_VAR "ALSA_UCM_PROFILE_CACHE"
+
+/** The name of the environment variable enabling the parallel card scan */
+#define ALSA_UCM_PARALLEL_SCAN_VAR "ALSA_UCM_PARALLEL_SCAN"
+
+/** The name of the environment variable enabling lazy verb parsing */
+#define ALSA_UCM_LAZY_VERBS_VAR "ALSA_UCM_LAZY_VERBS"
@@ -92,7 +92,7 @@ int uc_mgr_define_regex(snd_use_case_mgr_t *uc_mgr, const char *name,
 {
 	const char *string, *regex_string, *flags_string;
 	char *s;
-	regex_t re;
+	const regex_t *re;
 	int options = 0;
 	regmatch_t match[20];
 	int err;
@@ -151,19 +151,18 @@ int uc_mgr_define_regex(snd_use_case_mgr_t *uc_mgr, const char *name,
 	err = uc_mgr_get_substituted_value(uc_mgr, &s, regex_string);
 	if (err < 0)
 		return err;
-	err = regcomp(&re, s, options);
-	free(s);
+	err = uc_mgr_regcomp(uc_mgr, &re, s, options);
 	if (err) {
-		uc_error("Regex '%s' compilation failed (code %d)", err);
+		uc_error("Regex '%s' compilation failed (code %d)", s, err);
+		free(s);
 		return -EINVAL;
 	}
+	free(s);
 
 	err = uc_mgr_get_substituted_value(uc_mgr, &s, string);
-	if (err < 0) {
-		regfree(&re);
+	if (err < 0)
 		return err;
-	}
-	err = regexec(&re, s, ARRAY_SIZE(match), match, 0);
+	err = regexec(re, s, ARRAY_SIZE(match), match, 0);
 	if (err < 0)
 		err = -errno;
 	else if (err == REG_NOMATCH)
@@ -171,6 +170,5 @@ int uc_mgr_define_regex(snd_use_case_mgr_t *uc_mgr, const char *name,
 	else
 		err = set_variables(uc_mgr, s, ARRAY_SIZE(match), match, name);
 	free(s);
-	regfree(&re);
 	return err;
 }
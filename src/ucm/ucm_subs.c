@@ -225,7 +225,7 @@ static char *rval_lookup_main(snd_use_case_mgr_t *uc_mgr,
 	const char *s;
 	char *result;
 	regmatch_t match[1];
-	regex_t re;
+	const regex_t *re;
 	int err;
 
 	if (uc_mgr->conf_format < 4) {
@@ -262,7 +262,7 @@ static char *rval_lookup_main(snd_use_case_mgr_t *uc_mgr,
 	}
 	if (snd_config_get_string(d, &s))
 		goto null;
-	err = regcomp(&re, s, REG_EXTENDED | REG_ICASE);
+	err = uc_mgr_regcomp(uc_mgr, &re, s, REG_EXTENDED | REG_ICASE);
 	if (err) {
 		uc_error("Regex '%s' compilation failed (code %d)", s, err);
 		goto null;
@@ -273,12 +273,11 @@ static char *rval_lookup_main(snd_use_case_mgr_t *uc_mgr,
 		s = curr->fcn(iter->info);
 		if (s == NULL)
 			continue;
-		if (regexec(&re, s, ARRAY_SIZE(match), match, 0) == 0) {
+		if (regexec(re, s, ARRAY_SIZE(match), match, 0) == 0) {
 			result = curr->retfcn(iter, config);
 			break;
 		}
 	}
-	regfree(&re);
 fin:
 	snd_config_delete(config);
 	if (iter->done)
@@ -709,7 +708,7 @@ int uc_mgr_get_substituted_value(snd_use_case_mgr_t *uc_mgr,
 				 const char *value)
 {
 	size_t size, nsize, idsize, rvalsize, dpos = 0;
-	const char *tmp;
+	const char *tmp, *value0;
 	char *r, *nr, *rval, v2[128];
 	bool ignore_error, allow_empty;
 	char *(*fcn2)(snd_use_case_mgr_t *, const char *id);
@@ -718,6 +717,17 @@ int uc_mgr_get_substituted_value(snd_use_case_mgr_t *uc_mgr,
 	if (value == NULL)
 		return -ENOENT;
 
+	/* reuse a memoized result, if any */
+	value0 = value;
+	tmp = uc_mgr_subs_cache_get(uc_mgr, value);
+	if (tmp) {
+		r = strdup(tmp);
+		if (r == NULL)
+			return -ENOMEM;
+		*_rvalue = r;
+		return 0;
+	}
+
 	size = strlen(value) + 1;
 	r = malloc(size);
 	if (r == NULL)
@@ -828,6 +838,9 @@ __rval:
 	}
 	r[dpos] = '\0';
 
+	/* remember the result; errors only skip the memoization */
+	uc_mgr_subs_cache_put(uc_mgr, value0, r);
+
 	*_rvalue = r;
 	return 0;
 
@@ -419,6 +419,46 @@ void uc_mgr_free_value(struct list_head *base)
 	}
 }
 
+/*
+ * remember a configuration file contributing to the manager contents;
+ * the list feeds the change watch (snd_use_case_mgr_watch), so an
+ * allocation failure only costs a missed notification
+ */
+void uc_mgr_record_loaded_file(snd_use_case_mgr_t *uc_mgr,
+			       const char *filename)
+{
+	struct list_head *pos;
+	struct ucm_watch_file *file;
+
+	list_for_each(pos, &uc_mgr->file_list) {
+		file = list_entry(pos, struct ucm_watch_file, list);
+		if (strcmp(file->name, filename) == 0)
+			return;
+	}
+	file = calloc(1, sizeof(*file));
+	if (file == NULL)
+		return;
+	file->name = strdup(filename);
+	if (file->name == NULL) {
+		free(file);
+		return;
+	}
+	list_add_tail(&file->list, &uc_mgr->file_list);
+}
+
+static void uc_mgr_free_file_list(snd_use_case_mgr_t *uc_mgr)
+{
+	struct list_head *pos, *npos;
+	struct ucm_watch_file *file;
+
+	list_for_each_safe(pos, npos, &uc_mgr->file_list) {
+		file = list_entry(pos, struct ucm_watch_file, list);
+		free(file->name);
+		list_del(&file->list);
+		free(file);
+	}
+}
+
 void uc_mgr_free_dev_list(struct dev_list *dev_list)
 {
 	struct list_head *pos, *npos;
@@ -509,6 +549,8 @@ void uc_mgr_free_sequence_element(struct sequence_element *seq)
 	case SEQUENCE_ELEMENT_TYPE_CSET_TLV:
 	case SEQUENCE_ELEMENT_TYPE_CTL_REMOVE:
 		free(seq->data.cset);
+		free(seq->cset_id);
+		free(seq->cset_info);
 		break;
 	case SEQUENCE_ELEMENT_TYPE_SYSSET:
 		free(seq->data.sysw);
@@ -683,6 +725,9 @@ int uc_mgr_set_variable(snd_use_case_mgr_t *uc_mgr, const char *name,
 	struct ucm_value *curr;
 	char *val2;
 
+	/* the memoized substitutions may depend on this variable */
+	uc_mgr_subs_cache_flush(uc_mgr);
+
 	list_for_each(pos, &uc_mgr->variable_list) {
 		curr = list_entry(pos, struct ucm_value, list);
 		if (strcmp(curr->name, name) == 0) {
@@ -721,6 +766,7 @@ int uc_mgr_delete_variable(snd_use_case_mgr_t *uc_mgr, const char *name)
 	list_for_each(pos, &uc_mgr->variable_list) {
 		curr = list_entry(pos, struct ucm_value, list);
 		if (strcmp(curr->name, name) == 0) {
+			uc_mgr_subs_cache_flush(uc_mgr);
 			uc_mgr_free_value1(curr);
 			return 0;
 		}
@@ -729,6 +775,200 @@ int uc_mgr_delete_variable(snd_use_case_mgr_t *uc_mgr, const char *name)
 	return -ENOENT;
 }
 
+/*
+ * Memoization of the ${...} substitution results. The cache is flushed
+ * every time an UCM variable changes; the other substitution inputs
+ * (environment, sysfs, card lookups) are considered stable during the
+ * life of the manager.
+ */
+
+const char *uc_mgr_subs_cache_get(snd_use_case_mgr_t *uc_mgr,
+				  const char *value)
+{
+	struct list_head *pos;
+	struct ucm_value *curr;
+
+	list_for_each(pos, &uc_mgr->subs_cache) {
+		curr = list_entry(pos, struct ucm_value, list);
+		if (strcmp(curr->name, value) == 0)
+			return curr->data;
+	}
+	return NULL;
+}
+
+int uc_mgr_subs_cache_put(snd_use_case_mgr_t *uc_mgr,
+			  const char *value, const char *rvalue)
+{
+	char *data;
+	int err;
+
+	/* values without a substitution are cheap to copy directly */
+	if (strstr(value, "${") == NULL)
+		return 0;
+	data = strdup(rvalue);
+	if (data == NULL)
+		return -ENOMEM;
+	err = uc_mgr_add_value(&uc_mgr->subs_cache, value, data);
+	if (err < 0)
+		free(data);
+	return err;
+}
+
+void uc_mgr_subs_cache_flush(snd_use_case_mgr_t *uc_mgr)
+{
+	uc_mgr_free_value(&uc_mgr->subs_cache);
+}
+
+/*
+ * Compiled regular expression cache. The patterns are compiled on the
+ * first use and reused for the life of the manager; the returned
+ * compiled expression is owned by the cache (do not call regfree()).
+ * The return value comes from regcomp().
+ */
+int uc_mgr_regcomp(snd_use_case_mgr_t *uc_mgr, const regex_t **re,
+		   const char *pattern, int options)
+{
+	struct list_head *pos;
+	struct ucm_regex *curr;
+	int err;
+
+	list_for_each(pos, &uc_mgr->regex_cache) {
+		curr = list_entry(pos, struct ucm_regex, list);
+		if (curr->options == options &&
+		    strcmp(curr->pattern, pattern) == 0) {
+			*re = &curr->re;
+			return 0;
+		}
+	}
+
+	curr = calloc(1, sizeof(struct ucm_regex));
+	if (curr == NULL)
+		return REG_ESPACE;
+	curr->pattern = strdup(pattern);
+	if (curr->pattern == NULL) {
+		free(curr);
+		return REG_ESPACE;
+	}
+	curr->options = options;
+	err = regcomp(&curr->re, pattern, options);
+	if (err) {
+		free(curr->pattern);
+		free(curr);
+		return err;
+	}
+	list_add_tail(&curr->list, &uc_mgr->regex_cache);
+	*re = &curr->re;
+	return 0;
+}
+
+void uc_mgr_free_regex_cache(snd_use_case_mgr_t *uc_mgr)
+{
+	struct list_head *pos, *npos;
+	struct ucm_regex *curr;
+
+	list_for_each_safe(pos, npos, &uc_mgr->regex_cache) {
+		curr = list_entry(pos, struct ucm_regex, list);
+		regfree(&curr->re);
+		free(curr->pattern);
+		list_del(&curr->list);
+		free(curr);
+	}
+}
+
+/*
+ * Name-keyed verb indexes. Built once after the verb file parse; the
+ * device, modifier and value lists do not change afterwards. Entries
+ * hashing to the same bucket chain in list order, so lookups which
+ * filter by the runtime supported-device state keep the original
+ * priority.
+ */
+unsigned int uc_mgr_index_hash(const char *name, size_t len)
+{
+	unsigned int hash = 2166136261U;
+
+	while (len-- > 0)
+		hash = (hash ^ (unsigned char)*name++) * 16777619U;
+	return hash & (UCM_INDEX_HASH_SIZE - 1);
+}
+
+static void index_values(struct ucm_value **hash, struct list_head *base)
+{
+	struct ucm_value *v, **chain;
+	struct list_head *pos;
+	unsigned int seq = 0;
+
+	memset(hash, 0, sizeof(*hash) * UCM_INDEX_HASH_SIZE);
+	list_for_each(pos, base) {
+		v = list_entry(pos, struct ucm_value, list);
+		v->seq = seq++;
+		v->hash_next = NULL;
+		chain = &hash[uc_mgr_index_hash(v->name, strlen(v->name))];
+		while (*chain)
+			chain = &(*chain)->hash_next;
+		*chain = v;
+	}
+}
+
+void uc_mgr_index_verb(struct use_case_verb *verb)
+{
+	struct use_case_device *dev, **dchain;
+	struct use_case_modifier *mod, **mchain;
+	struct list_head *pos;
+
+	memset(verb->device_hash, 0, sizeof(verb->device_hash));
+	memset(verb->modifier_hash, 0, sizeof(verb->modifier_hash));
+	list_for_each(pos, &verb->device_list) {
+		dev = list_entry(pos, struct use_case_device, list);
+		dev->hash_next = NULL;
+		dchain = &verb->device_hash[uc_mgr_index_hash(dev->name,
+							strlen(dev->name))];
+		while (*dchain)
+			dchain = &(*dchain)->hash_next;
+		*dchain = dev;
+		index_values(dev->value_hash, &dev->value_list);
+	}
+	list_for_each(pos, &verb->modifier_list) {
+		mod = list_entry(pos, struct use_case_modifier, list);
+		mod->hash_next = NULL;
+		mchain = &verb->modifier_hash[uc_mgr_index_hash(mod->name,
+							strlen(mod->name))];
+		while (*mchain)
+			mchain = &(*mchain)->hash_next;
+		*mchain = mod;
+		index_values(mod->value_hash, &mod->value_list);
+	}
+	index_values(verb->value_hash, &verb->value_list);
+	verb->indexed = 1;
+}
+
+/*
+ * Find a value for the identifier. A value name matches when it equals
+ * the identifier up to a '/' boundary (same rule as check_identifier);
+ * among multiple matching names the first list entry wins.
+ */
+struct ucm_value *uc_mgr_value_index_find(struct ucm_value *const *hash,
+					  const char *identifier)
+{
+	struct ucm_value *v, *best = NULL;
+	size_t len;
+
+	len = strlen(identifier);
+	for (;;) {
+		v = hash[uc_mgr_index_hash(identifier, len)];
+		for (; v; v = v->hash_next) {
+			if (strlen(v->name) == len &&
+			    memcmp(v->name, identifier, len) == 0 &&
+			    (best == NULL || v->seq < best->seq))
+				best = v;
+		}
+		while (len > 0 && identifier[--len] != '/')
+			;
+		if (len == 0)
+			break;
+	}
+	return best;
+}
+
 void uc_mgr_free_verb(snd_use_case_mgr_t *uc_mgr)
 {
 	struct list_head *pos, *npos;
@@ -742,10 +982,20 @@ void uc_mgr_free_verb(snd_use_case_mgr_t *uc_mgr)
 		snd_config_delete(uc_mgr->macros);
 		uc_mgr->macros = NULL;
 	}
+	if (uc_mgr->cache_config) {
+		snd_config_delete(uc_mgr->cache_config);
+		uc_mgr->cache_config = NULL;
+	}
+	if (uc_mgr->cache_build) {
+		snd_config_delete(uc_mgr->cache_build);
+		uc_mgr->cache_build = NULL;
+	}
 	list_for_each_safe(pos, npos, &uc_mgr->verb_list) {
 		verb = list_entry(pos, struct use_case_verb, list);
 		free(verb->name);
 		free(verb->comment);
+		free(verb->file);
+		free(verb->variant);
 		uc_mgr_free_sequence(&verb->enable_list);
 		uc_mgr_free_sequence(&verb->disable_list);
 		uc_mgr_free_transition(&verb->transition_list);
@@ -763,6 +1013,9 @@ void uc_mgr_free_verb(snd_use_case_mgr_t *uc_mgr)
 	uc_mgr_free_sequence(&uc_mgr->default_list);
 	uc_mgr_free_value(&uc_mgr->value_list);
 	uc_mgr_free_value(&uc_mgr->variable_list);
+	uc_mgr_subs_cache_flush(uc_mgr);
+	uc_mgr_free_regex_cache(uc_mgr);
+	uc_mgr_free_file_list(uc_mgr);
 	free(uc_mgr->comment);
 	free(uc_mgr->conf_dir_name);
 	free(uc_mgr->conf_file_name);
@@ -778,7 +1031,10 @@ void uc_mgr_free(snd_use_case_mgr_t *uc_mgr)
 {
 	uc_mgr_free_verb(uc_mgr);
 	uc_mgr_free_ctl_list(uc_mgr);
+	if (uc_mgr->watch_fd >= 0)
+		close(uc_mgr->watch_fd);
 	free(uc_mgr->card_name);
+	snd_memstat_update(SND_MEMSTAT_UCM, -(ssize_t)sizeof(*uc_mgr), -1);
 	free(uc_mgr);
 }
 
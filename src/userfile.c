@@ -19,9 +19,12 @@
  */
   
 #include "config.h"
+#include "local.h"
 #include <string.h>
+#include <ctype.h>
 #include <errno.h>
 #include <assert.h>
+#include <sys/stat.h>
 
 /**
  * \brief Get the full file name
@@ -68,55 +71,311 @@ int snd_user_file(const char *file, char **result)
 #include <pwd.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <glob.h>
+#ifdef HAVE_LIBPTHREAD
+#include <pthread.h>
+#endif
 
-int snd_user_file(const char *file, char **result)
+/*
+ * Internal lightweight expander covering what ALSA configurations
+ * actually use - a leading ~/ , $VAR and ${VAR} references and simple
+ * glob patterns - without pulling in the wordexp machinery.  The
+ * full wordexp() stays available via --with-wordexp.
+ */
+
+/* process-level cache of expanded names; configuration updates expand
+ * the same few strings over and over.  Expansions involving a glob
+ * pattern are not cached since their match may change with the
+ * filesystem; cached environment references are resolved only once.
+ */
+struct user_file_cached {
+	struct list_head list;
+	char *file;
+	char *result;
+};
+
+#define USER_FILE_CACHE_MAX	32
+
+#ifdef HAVE_LIBPTHREAD
+static pthread_mutex_t user_file_mutex = PTHREAD_MUTEX_INITIALIZER;
+static inline void user_file_lock(void)
+{
+	pthread_mutex_lock(&user_file_mutex);
+}
+static inline void user_file_unlock(void)
+{
+	pthread_mutex_unlock(&user_file_mutex);
+}
+#else
+static inline void user_file_lock(void) { }
+static inline void user_file_unlock(void) { }
+#endif
+
+static LIST_HEAD(user_file_cache);
+static unsigned int user_file_cache_count;
+
+/* append a byte range to a malloc'ed buffer */
+static int user_file_append(char **dst, size_t *len, size_t *size,
+			    const char *s, size_t l)
+{
+	char *d;
+
+	if (*len + l + 1 > *size) {
+		size_t n = *size ? *size * 2 : 64;
+		while (n < *len + l + 1)
+			n *= 2;
+		d = realloc(*dst, n);
+		if (d == NULL)
+			return -ENOMEM;
+		*dst = d;
+		*size = n;
+	}
+	memcpy(*dst + *len, s, l);
+	*len += l;
+	(*dst)[*len] = '\0';
+	return 0;
+}
+
+/* the home directory from $HOME with a passwd database fallback;
+ * *buf receives the buffer to free when the database was used
+ */
+static const char *user_file_home(char **buf)
 {
+	const char *home = getenv("HOME");
+	struct passwd pwent, *p = NULL;
+	uid_t id;
+	size_t bufsize = 1024;
+	char *newbuf;
+	int err;
+
+	*buf = NULL;
+	if (home != NULL)
+		return home;
+	id = getuid();
+	*buf = malloc(bufsize);
+	if (*buf == NULL)
+		return "";
+	while ((err = getpwuid_r(id, &pwent, *buf, bufsize, &p)) == ERANGE) {
+		bufsize += 1024;
+		if (bufsize < 1024)
+			break;
+		newbuf = realloc(*buf, bufsize);
+		if (newbuf == NULL)
+			return "";
+		*buf = newbuf;
+	}
+	return err || p == NULL ? "" : pwent.pw_dir;
+}
+
+/* expand ~/ and environment references; *cacheable is cleared when the
+ * result contains an unexpanded glob pattern
+ */
+static int user_file_expand(const char *file, char **result, int *cacheable)
+{
+	char *dst = NULL, *homebuf;
+	size_t len = 0, size = 0, l;
+	const char *p = file, *e, *v;
+	char name[64];
 	int err;
-	size_t len;
-	char *buf = NULL;
+
+	if (p[0] == '~' && p[1] == '/') {
+		homebuf = NULL;
+		v = user_file_home(&homebuf);
+		err = user_file_append(&dst, &len, &size, v, strlen(v));
+		free(homebuf);
+		if (err < 0)
+			goto _err;
+		p++;
+	}
+	while (*p) {
+		if (*p == '\\' && p[1] != '\0') {
+			err = user_file_append(&dst, &len, &size, p + 1, 1);
+			if (err < 0)
+				goto _err;
+			p += 2;
+			continue;
+		}
+		if (*p != '$') {
+			err = user_file_append(&dst, &len, &size, p, 1);
+			if (err < 0)
+				goto _err;
+			p++;
+			continue;
+		}
+		if (p[1] == '{') {
+			e = strchr(p + 2, '}');
+			if (e == NULL) {
+				err = -EINVAL;
+				goto _err;
+			}
+			v = p + 2;
+			l = e - v;
+			p = e + 1;
+		} else {
+			v = p + 1;
+			for (e = v; isalnum((unsigned char)*e) || *e == '_'; e++)
+				;
+			l = e - v;
+			if (l == 0) {
+				/* lone '$' stays literal */
+				err = user_file_append(&dst, &len, &size, p, 1);
+				if (err < 0)
+					goto _err;
+				p++;
+				continue;
+			}
+			p = e;
+		}
+		if (l >= sizeof(name)) {
+			err = -EINVAL;
+			goto _err;
+		}
+		memcpy(name, v, l);
+		name[l] = '\0';
+		v = getenv(name);
+		if (v != NULL) {
+			err = user_file_append(&dst, &len, &size, v, strlen(v));
+			if (err < 0)
+				goto _err;
+		}
+	}
+	if (dst == NULL) {
+		dst = strdup("");
+		if (dst == NULL)
+			return -ENOMEM;
+	}
+	*cacheable = strpbrk(dst, "*?[") == NULL;
+	*result = dst;
+	return 0;
+
+ _err:
+	free(dst);
+	return err;
+}
+
+int snd_user_file(const char *file, char **result)
+{
+	struct list_head *pos;
+	struct user_file_cached *c;
+	char *res;
+	int err, cacheable;
 
 	assert(file && result);
 	*result = NULL;
 
-	/* expand ~/ if needed */
-	if (file[0] == '~' && file[1] == '/') {
-		const char *home = getenv("HOME");
-		if (home == NULL) {
-			struct passwd pwent, *p = NULL;
-			uid_t id = getuid();
-			size_t bufsize = 1024;
-
-			buf = malloc(bufsize);
-			if (buf == NULL)
-				goto out;
-
-			while ((err = getpwuid_r(id, &pwent, buf, bufsize, &p)) == ERANGE) {
-				char *newbuf;
-				bufsize += 1024;
-				if (bufsize < 1024)
-					break;
-				newbuf = realloc(buf, bufsize);
-				if (newbuf == NULL)
-					goto out;
-				buf = newbuf;
-			}
-			home = err ? "" : pwent.pw_dir;
+	user_file_lock();
+	list_for_each(pos, &user_file_cache) {
+		c = list_entry(pos, struct user_file_cached, list);
+		if (strcmp(c->file, file) == 0) {
+			res = strdup(c->result);
+			user_file_unlock();
+			if (res == NULL)
+				return -ENOMEM;
+			*result = res;
+			return 0;
 		}
-		len = strlen(home) + strlen(&file[2]) + 2;
-		*result = malloc(len);
-		if (*result)
-			snprintf(*result, len, "%s/%s", home, &file[2]);
-	} else {
-		*result = strdup(file);
 	}
+	user_file_unlock();
 
-out:
-	if (buf)
-		free(buf);
+	err = user_file_expand(file, &res, &cacheable);
+	if (err < 0)
+		return err;
 
-	if (*result == NULL)
-		return -ENOMEM;
+	if (!cacheable) {
+		/* take the first (sorted) match like wordexp does; a
+		 * pattern without any match stays as it is */
+		glob_t g;
+
+		err = glob(res, 0, NULL, &g);
+		switch (err) {
+		case 0:
+			free(res);
+			res = strdup(g.gl_pathv[0]);
+			globfree(&g);
+			if (res == NULL)
+				return -ENOMEM;
+			break;
+		case GLOB_NOMATCH:
+			break;
+		case GLOB_NOSPACE:
+			free(res);
+			return -ENOMEM;
+		default:
+			free(res);
+			return -EINVAL;
+		}
+	} else if (user_file_cache_count < USER_FILE_CACHE_MAX) {
+		c = calloc(1, sizeof(*c));
+		if (c != NULL) {
+			c->file = strdup(file);
+			c->result = strdup(res);
+			if (c->file == NULL || c->result == NULL) {
+				free(c->file);
+				free(c->result);
+				free(c);
+			} else {
+				user_file_lock();
+				list_add_tail(&c->list, &user_file_cache);
+				user_file_cache_count++;
+				user_file_unlock();
+			}
+		}
+	}
+	*result = res;
 	return 0;
 }
 
 #endif /* HAVE_WORDEXP */
+
+#ifndef DOC_HIDDEN
+/**
+ * \brief Build the path of a per-user cache file
+ * \param name The file name below the user's ALSA cache directory
+ * \param create When non-zero, create the cache directory chain
+ * \param result The pointer to store the resultant path
+ * \return 0 if successful, or a negative error code
+ *
+ * The cache directory is $XDG_CACHE_HOME/alsa, falling back to
+ * ~/.cache/alsa.  To avoid trusting the environment of privileged
+ * programs, -EPERM is returned when the real and effective user or
+ * group IDs differ.
+ */
+int snd_user_cache_path(const char *name, int create, char **result)
+{
+	const char *env, *suffix = "";
+	char *res, *s;
+	size_t len;
+
+	assert(name && result);
+	if (getuid() != geteuid() || getgid() != getegid())
+		return -EPERM;
+	env = getenv("XDG_CACHE_HOME");
+	if (env == NULL || env[0] != '/') {
+		env = getenv("HOME");
+		if (env == NULL || env[0] != '/')
+			return -ENOENT;
+		suffix = "/.cache";
+	}
+	len = strlen(env) + strlen(suffix) + strlen(name) + 32;
+	res = malloc(len);
+	if (res == NULL)
+		return -ENOMEM;
+	snprintf(res, len, "%s%s/alsa/%s", env, suffix, name);
+	if (create) {
+		s = strrchr(res, '/');
+		*s = '\0';
+		if (mkdir(res, 0700) < 0 && errno == ENOENT) {
+			char *s1 = strrchr(res, '/');
+			if (s1 != NULL) {
+				*s1 = '\0';
+				mkdir(res, 0700);
+				*s1 = '/';
+				mkdir(res, 0700);
+			}
+		}
+		*s = '/';
+	}
+	*result = res;
+	return 0;
+}
+#endif
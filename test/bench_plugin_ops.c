@@ -0,0 +1,518 @@
+/*
+ *  Microbenchmark for the PCM plugin conversion kernels
+ *
+ *  Times the sample conversion label zoo from src/pcm/plugin_ops.h
+ *  (conv, get16/put16, get32/put32) together with replicas of the
+ *  softvol scaling, dmix mixing and route ttable accumulation loops,
+ *  across several buffer sizes and byte alignments.
+ *
+ *  The kernels are included/copied here because the library does not
+ *  export them; keep the replicas in sync with pcm_softvol.c,
+ *  pcm_dmix_generic.c and pcm_route.c when those change.
+ *
+ *  Output is machine readable, one tab separated line per measurement:
+ *    kernel  variant  samples  align  ns/sample  Msamples/s
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "bswap.h"
+#include "plugin_ops.h"	/* common inlines and accessors */
+
+#define BENCH_TARGET_SAMPLES	(4U * 1024 * 1024)
+#define BENCH_MAX_SAMPLES	16384
+#define BENCH_STEP		4	/* widest sample container */
+
+static const unsigned int bench_sizes[] = { 64, 1024, 16384 };
+static const unsigned int bench_aligns[] = { 0, 2 };
+
+static unsigned char src_mem[BENCH_MAX_SAMPLES * BENCH_STEP + 64]
+	__attribute__((aligned(64)));
+static unsigned char dst_mem[BENCH_MAX_SAMPLES * BENCH_STEP + 64]
+	__attribute__((aligned(64)));
+static int sum_mem[BENCH_MAX_SAMPLES + 16] __attribute__((aligned(64)));
+
+static volatile unsigned int sink;
+
+static double now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void report(const char *kernel, const char *variant,
+		   unsigned int samples, unsigned int align,
+		   double seconds, unsigned long long total)
+{
+	double ns = seconds * 1e9 / total;
+
+	printf("%s\t%s\t%u\t%u\t%.3f\t%.1f\n",
+	       kernel, variant, samples, align, ns, 1e3 / ns);
+}
+
+/*
+ * plugin_ops.h conversion kernels
+ */
+
+static double bench_conv(unsigned int idx, const unsigned char *src0,
+			 unsigned char *dst0, unsigned int samples,
+			 unsigned int reps)
+{
+#define CONV_LABELS
+#include "plugin_ops.h"
+#undef CONV_LABELS
+	void *conv = conv_labels[idx];
+	double t0;
+	unsigned int r, n;
+	const char *src;
+	char *dst;
+
+	t0 = now_sec();
+	for (r = 0; r < reps; r++) {
+		src = (const char *)src0;
+		dst = (char *)dst0;
+		n = samples;
+		while (n-- > 0) {
+			goto *conv;
+#define CONV_END conv_after
+#include "plugin_ops.h"
+#undef CONV_END
+		conv_after:
+			src += BENCH_STEP;
+			dst += BENCH_STEP;
+		}
+	}
+	return now_sec() - t0;
+}
+
+static double bench_get16(unsigned int idx, const unsigned char *src0,
+			  unsigned int samples, unsigned int reps)
+{
+#define GET16_LABELS
+#include "plugin_ops.h"
+#undef GET16_LABELS
+	void *get = get16_labels[idx];
+	int16_t sample = 0;
+	unsigned int acc = 0;
+	double t0;
+	unsigned int r, n;
+	const char *src;
+
+	t0 = now_sec();
+	for (r = 0; r < reps; r++) {
+		src = (const char *)src0;
+		n = samples;
+		while (n-- > 0) {
+			goto *get;
+#define GET16_END get16_after
+#include "plugin_ops.h"
+#undef GET16_END
+		get16_after:
+			acc += (uint16_t)sample;
+			src += BENCH_STEP;
+		}
+	}
+	sink = acc;
+	return now_sec() - t0;
+}
+
+static double bench_put16(unsigned int idx, const unsigned char *src0,
+			  unsigned char *dst0, unsigned int samples,
+			  unsigned int reps)
+{
+#define PUT16_LABELS
+#include "plugin_ops.h"
+#undef PUT16_LABELS
+	void *put = put16_labels[idx];
+	int16_t sample = 0;
+	double t0;
+	unsigned int r, n;
+	const char *src;
+	char *dst;
+
+	t0 = now_sec();
+	for (r = 0; r < reps; r++) {
+		src = (const char *)src0;
+		dst = (char *)dst0;
+		n = samples;
+		while (n-- > 0) {
+			sample = *(const int16_t *)src;
+			goto *put;
+#define PUT16_END put16_after
+#include "plugin_ops.h"
+#undef PUT16_END
+		put16_after:
+			src += BENCH_STEP;
+			dst += BENCH_STEP;
+		}
+	}
+	return now_sec() - t0;
+}
+
+static double bench_get32(unsigned int idx, const unsigned char *src0,
+			  unsigned int samples, unsigned int reps)
+{
+#define GET32_LABELS
+#include "plugin_ops.h"
+#undef GET32_LABELS
+	void *get = get32_labels[idx];
+	uint32_t sample = 0;
+	unsigned int acc = 0;
+	double t0;
+	unsigned int r, n;
+	const char *src;
+
+	t0 = now_sec();
+	for (r = 0; r < reps; r++) {
+		src = (const char *)src0;
+		n = samples;
+		while (n-- > 0) {
+			goto *get;
+#define GET32_END get32_after
+#include "plugin_ops.h"
+#undef GET32_END
+		get32_after:
+			acc += sample;
+			src += BENCH_STEP;
+		}
+	}
+	sink = acc;
+	return now_sec() - t0;
+}
+
+static double bench_put32(unsigned int idx, const unsigned char *src0,
+			  unsigned char *dst0, unsigned int samples,
+			  unsigned int reps)
+{
+#define PUT32_LABELS
+#include "plugin_ops.h"
+#undef PUT32_LABELS
+	void *put = put32_labels[idx];
+	uint32_t sample = 0;
+	double t0;
+	unsigned int r, n;
+	const char *src;
+	char *dst;
+
+	t0 = now_sec();
+	for (r = 0; r < reps; r++) {
+		src = (const char *)src0;
+		dst = (char *)dst0;
+		n = samples;
+		while (n-- > 0) {
+			sample = *(const uint32_t *)src;
+			goto *put;
+#define PUT32_END put32_after
+#include "plugin_ops.h"
+#undef PUT32_END
+		put32_after:
+			src += BENCH_STEP;
+			dst += BENCH_STEP;
+		}
+	}
+	return now_sec() - t0;
+}
+
+/*
+ * softvol scaling (replica of MULTI_DIV_short/MULTI_DIV_int from
+ * pcm_softvol.c, without the endian swap)
+ */
+
+#define VOL_SCALE_SHIFT		16
+#define VOL_SCALE_MASK		((1 << VOL_SCALE_SHIFT) - 1)
+
+typedef union {
+	int i;
+	short s[2];
+} val_t;
+
+static inline int MULTI_DIV_32x16(int a, unsigned short b)
+{
+	val_t v, x, y;
+	v.i = a;
+	y.i = 0;
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+	x.i = (unsigned short)v.s[0];
+	x.i *= (unsigned int)b;
+	y.s[0] = x.s[1];
+	y.i += (int)v.s[1] * b;
+#else
+	x.i = (unsigned int)v.s[1] * b;
+	y.s[1] = x.s[0];
+	y.i += (int)v.s[0] * b;
+#endif
+	return y.i;
+}
+
+static inline short MULTI_DIV_short(short a, unsigned int b)
+{
+	unsigned int gain = b >> VOL_SCALE_SHIFT;
+	int fraction;
+	fraction = (int)(a * (b & VOL_SCALE_MASK)) >> VOL_SCALE_SHIFT;
+	if (gain) {
+		int amp = a * gain + fraction;
+		if (abs(amp) > 0x7fff)
+			amp = (a < 0) ? (short)0x8000 : (short)0x7fff;
+		return (short)amp;
+	}
+	return (short)fraction;
+}
+
+static inline int MULTI_DIV_int(int a, unsigned int b)
+{
+	unsigned int gain = (b >> VOL_SCALE_SHIFT);
+	int fraction;
+	fraction = MULTI_DIV_32x16(a, b & VOL_SCALE_MASK);
+	if (gain) {
+		long long amp = (long long)a * gain + fraction;
+		if (amp > (int)0x7fffffff)
+			amp = (int)0x7fffffff;
+		else if (amp < (int)0x80000000)
+			amp = (int)0x80000000;
+		return (int)amp;
+	}
+	return fraction;
+}
+
+static double bench_softvol_s16(const unsigned char *src0,
+				unsigned char *dst0, unsigned int samples,
+				unsigned int reps)
+{
+	const unsigned int vol = 0xb000;	/* ~ -3 dB */
+	double t0;
+	unsigned int r, n;
+	const short *src;
+	short *dst;
+
+	t0 = now_sec();
+	for (r = 0; r < reps; r++) {
+		src = (const short *)src0;
+		dst = (short *)dst0;
+		for (n = 0; n < samples; n++)
+			dst[n] = MULTI_DIV_short(src[n], vol);
+	}
+	return now_sec() - t0;
+}
+
+static double bench_softvol_s32(const unsigned char *src0,
+				unsigned char *dst0, unsigned int samples,
+				unsigned int reps)
+{
+	const unsigned int vol = 0xb000;
+	double t0;
+	unsigned int r, n;
+	const int *src;
+	int *dst;
+
+	t0 = now_sec();
+	for (r = 0; r < reps; r++) {
+		src = (const int *)src0;
+		dst = (int *)dst0;
+		for (n = 0; n < samples; n++)
+			dst[n] = MULTI_DIV_int(src[n], vol);
+	}
+	return now_sec() - t0;
+}
+
+/*
+ * dmix mixing (replica of generic_mix_areas_16/32_native from
+ * pcm_dmix_generic.c with contiguous areas)
+ */
+
+static double bench_mix_16(const unsigned char *src0, unsigned char *dst0,
+			   unsigned int samples, unsigned int reps)
+{
+	double t0;
+	unsigned int r, n;
+	signed short *src;
+	volatile signed short *dst;
+	volatile signed int *sum;
+	register signed int sample;
+
+	t0 = now_sec();
+	for (r = 0; r < reps; r++) {
+		src = (signed short *)src0;
+		dst = (volatile signed short *)dst0;
+		sum = sum_mem;
+		for (n = 0; n < samples; n++) {
+			sample = src[n];
+			if (!dst[n]) {
+				sum[n] = sample;
+				dst[n] = src[n];
+			} else {
+				sample += sum[n];
+				sum[n] = sample;
+				if (sample > 0x7fff)
+					sample = 0x7fff;
+				else if (sample < -0x8000)
+					sample = -0x8000;
+				dst[n] = sample;
+			}
+		}
+	}
+	return now_sec() - t0;
+}
+
+static double bench_mix_32(const unsigned char *src0, unsigned char *dst0,
+			   unsigned int samples, unsigned int reps)
+{
+	double t0;
+	unsigned int r, n;
+	signed int *src;
+	volatile signed int *dst;
+	volatile signed int *sum;
+	register signed int sample;
+
+	t0 = now_sec();
+	for (r = 0; r < reps; r++) {
+		src = (signed int *)src0;
+		dst = (volatile signed int *)dst0;
+		sum = sum_mem;
+		for (n = 0; n < samples; n++) {
+			sample = src[n] >> 8;
+			if (!dst[n]) {
+				sum[n] = sample;
+				dst[n] = src[n];
+			} else {
+				sample += sum[n];
+				sum[n] = sample;
+				if (sample > 0x7fffff)
+					sample = 0x7fffffff;
+				else if (sample < -0x800000)
+					sample = -0x80000000;
+				else
+					sample *= 256;
+				dst[n] = sample;
+			}
+		}
+	}
+	return now_sec() - t0;
+}
+
+/*
+ * route ttable accumulation (scalar shape of
+ * snd_pcm_route_convert1_many for interleaved s16 sources: attenuate
+ * each source in 32.16, shift the sum right by 4 and saturate)
+ */
+
+static double bench_route_many(unsigned int nsrcs, const unsigned char *src0,
+			       unsigned char *dst0, unsigned int samples,
+			       unsigned int reps)
+{
+	const int frames = samples / nsrcs;
+	int coefs[8];
+	double t0;
+	unsigned int r, i;
+	int f;
+	const short *src;
+	short *dst;
+
+	for (i = 0; i < nsrcs; i++)
+		coefs[i] = 0x10 / nsrcs;	/* equal share of full scale */
+	t0 = now_sec();
+	for (r = 0; r < reps; r++) {
+		src = (const short *)src0;
+		dst = (short *)dst0;
+		for (f = 0; f < frames; f++) {
+			int sum = 0;
+
+			for (i = 0; i < nsrcs; i++)
+				sum += src[i] * coefs[i];
+			sum >>= 4;
+			if (sum > 0x7fff)
+				sum = 0x7fff;
+			else if (sum < -0x8000)
+				sum = -0x8000;
+			dst[f] = sum;
+			src += nsrcs;
+		}
+	}
+	return now_sec() - t0;
+}
+
+/*
+ * driver
+ */
+
+static const unsigned int getput_widths[5] = { 8, 16, 24, 32, 20 };
+static const unsigned int getput_widths3[3] = { 24, 20, 18 };
+
+static void getput_variant(char *buf, size_t len, unsigned int idx)
+{
+	if (idx < 20)
+		snprintf(buf, len, "w%u%s%s", getput_widths[idx >> 2],
+			 (idx >> 1) & 1 ? "s" : "h",
+			 idx & 1 ? "^" : "-");
+	else
+		snprintf(buf, len, "w%u_3%s%s",
+			 getput_widths3[(idx - 20) >> 2],
+			 ((idx - 20) >> 1) & 1 ? "s" : "h",
+			 (idx - 20) & 1 ? "^" : "-");
+}
+
+int main(void)
+{
+	char variant[64];
+	unsigned int si, ai, idx, n;
+
+	for (n = 0; n < sizeof(src_mem); n++)
+		src_mem[n] = (n * 2654435761U) >> 24;
+
+	printf("# kernel\tvariant\tsamples\talign\tns/sample\tMsamples/s\n");
+	for (si = 0; si < sizeof(bench_sizes) / sizeof(bench_sizes[0]); si++) {
+		unsigned int samples = bench_sizes[si];
+		unsigned int reps = BENCH_TARGET_SAMPLES / samples;
+		unsigned long long total = (unsigned long long)samples * reps;
+
+		for (ai = 0; ai < sizeof(bench_aligns) / sizeof(bench_aligns[0]); ai++) {
+			unsigned int align = bench_aligns[ai];
+			const unsigned char *src = src_mem + align;
+			unsigned char *dst = dst_mem + align;
+			double t;
+
+			for (idx = 0; idx < 4 * 2 * 2 * 4 * 2; idx++) {
+				snprintf(variant, sizeof(variant),
+					 "w%u%s%s_w%u%s",
+					 ((idx >> 5) & 3) + 1,
+					 (idx >> 4) & 1 ? "s" : "h",
+					 (idx >> 3) & 1 ? "^" : "-",
+					 ((idx >> 1) & 3) + 1,
+					 idx & 1 ? "s" : "h");
+				t = bench_conv(idx, src, dst, samples, reps);
+				report("conv", variant, samples, align, t, total);
+			}
+			for (idx = 0; idx < 5 * 2 * 2 + 4 * 3; idx++) {
+				getput_variant(variant, sizeof(variant), idx);
+				t = bench_get16(idx, src, samples, reps);
+				report("get16", variant, samples, align, t, total);
+				t = bench_put16(idx, src, dst, samples, reps);
+				report("put16", variant, samples, align, t, total);
+				t = bench_get32(idx, src, samples, reps);
+				report("get32", variant, samples, align, t, total);
+				t = bench_put32(idx, src, dst, samples, reps);
+				report("put32", variant, samples, align, t, total);
+			}
+			t = bench_softvol_s16(src, dst, samples, reps);
+			report("softvol", "s16", samples, align, t, total);
+			t = bench_softvol_s32(src, dst, samples, reps);
+			report("softvol", "s32", samples, align, t, total);
+			memset(dst_mem, 0, sizeof(dst_mem));
+			t = bench_mix_16(src, dst, samples, reps);
+			report("dmix", "mix16", samples, align, t, total);
+			memset(dst_mem, 0, sizeof(dst_mem));
+			t = bench_mix_32(src, dst, samples, reps);
+			report("dmix", "mix32", samples, align, t, total);
+			for (n = 1; n <= 4; n <<= 1) {
+				snprintf(variant, sizeof(variant), "%u:1", n);
+				t = bench_route_many(n, src, dst, samples, reps);
+				report("route", variant, samples, align, t, total);
+			}
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,220 @@
+/*
+ * benchmark for the configuration parsing and expansion paths
+ *
+ * Times the phases an application pays before the first byte of audio:
+ * loading the global configuration (snd_config_update), expanding a
+ * PCM definition out of it (snd_config_search_definition), enumerating
+ * device name hints and - optionally - opening a UCM manager.  Each
+ * phase is timed cache-cold (the global tree is dropped with
+ * snd_config_update_free_global first, so the files are re-parsed) and
+ * cache-warm (the tree is reused and only revalidated), since the two
+ * differ by an order of magnitude and regressions tend to hide in one
+ * of them only.
+ *
+ * The config root comes from the usual lookup, so pointing
+ * ALSA_CONFIG_PATH at an image's tree and running this in the image
+ * build makes configuration bloat visible before it ships.  Next to
+ * the timings the tool reports the node count and memory footprint of
+ * the loaded tree as a proxy for the allocation load.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <sys/resource.h>
+#include "../include/asoundlib.h"
+#include "../include/use-case.h"
+
+static const char *pcmname = "default";
+static const char *ucmname = NULL;
+static int loops = 20;
+static int do_hints = 1;
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static long count_nodes(snd_config_t *node)
+{
+	snd_config_iterator_t i, next;
+	long count = 1;
+
+	if (snd_config_get_type(node) != SND_CONFIG_TYPE_COMPOUND)
+		return count;
+	snd_config_for_each(i, next, node)
+		count += count_nodes(snd_config_iterator_entry(i));
+	return count;
+}
+
+static void report(const char *phase, unsigned long long total_ns,
+		   unsigned long long min_ns, int runs)
+{
+	printf("%-24s %4d runs  avg %10.1f us  min %10.1f us\n",
+	       phase, runs, (double)total_ns / runs / 1000.0,
+	       (double)min_ns / 1000.0);
+}
+
+static int bench_update(int cold)
+{
+	unsigned long long t, total = 0, min = ~0ULL;
+	int i, err;
+
+	for (i = 0; i < loops; i++) {
+		if (cold)
+			snd_config_update_free_global();
+		t = now_ns();
+		err = snd_config_update();
+		t = now_ns() - t;
+		if (err < 0) {
+			fprintf(stderr, "snd_config_update: %s\n",
+				snd_strerror(err));
+			return err;
+		}
+		total += t;
+		if (t < min)
+			min = t;
+	}
+	report(cold ? "update (cold)" : "update (warm)", total, min, loops);
+	return 0;
+}
+
+static int bench_expand(void)
+{
+	unsigned long long t, total = 0, min = ~0ULL;
+	snd_config_t *conf;
+	int i, err;
+
+	for (i = 0; i < loops; i++) {
+		t = now_ns();
+		err = snd_config_search_definition(snd_config, "pcm",
+						   pcmname, &conf);
+		t = now_ns() - t;
+		if (err < 0) {
+			fprintf(stderr, "cannot expand pcm.%s: %s\n",
+				pcmname, snd_strerror(err));
+			return err;
+		}
+		snd_config_delete(conf);
+		total += t;
+		if (t < min)
+			min = t;
+	}
+	report("expand", total, min, loops);
+	return 0;
+}
+
+static int bench_hints(void)
+{
+	unsigned long long t, total = 0, min = ~0ULL;
+	void **hints;
+	int i, err;
+
+	for (i = 0; i < loops; i++) {
+		t = now_ns();
+		err = snd_device_name_hint(-1, "pcm", &hints);
+		t = now_ns() - t;
+		if (err < 0) {
+			fprintf(stderr, "snd_device_name_hint: %s\n",
+				snd_strerror(err));
+			return err;
+		}
+		snd_device_name_free_hint(hints);
+		total += t;
+		if (t < min)
+			min = t;
+	}
+	report("name hints", total, min, loops);
+	return 0;
+}
+
+static int bench_ucm(void)
+{
+	unsigned long long t, total = 0, min = ~0ULL;
+	snd_use_case_mgr_t *uc_mgr;
+	int i, err;
+
+	for (i = 0; i < loops; i++) {
+		t = now_ns();
+		err = snd_use_case_mgr_open(&uc_mgr, ucmname);
+		t = now_ns() - t;
+		if (err < 0) {
+			fprintf(stderr, "snd_use_case_mgr_open %s: %s\n",
+				ucmname, snd_strerror(err));
+			return err;
+		}
+		snd_use_case_mgr_close(uc_mgr);
+		total += t;
+		if (t < min)
+			min = t;
+	}
+	report("ucm open", total, min, loops);
+	return 0;
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: config-bench [-options]\n");
+	fprintf(stderr, "  -n str  PCM name to expand (default 'default')\n");
+	fprintf(stderr, "  -U str  Also time snd_use_case_mgr_open for the given card\n");
+	fprintf(stderr, "  -l val  Runs per phase\n");
+	fprintf(stderr, "  -H      Skip the device name hint phase\n");
+}
+
+int main(int argc, char **argv)
+{
+	struct rusage ru0, ru1;
+	long nodes;
+	int c, err;
+
+	while ((c = getopt(argc, argv, "n:U:l:Hh")) >= 0) {
+		switch (c) {
+		case 'n':
+			pcmname = optarg;
+			break;
+		case 'U':
+			ucmname = optarg;
+			break;
+		case 'l':
+			loops = atoi(optarg);
+			if (loops < 1)
+				loops = 1;
+			break;
+		case 'H':
+			do_hints = 0;
+			break;
+		default:
+			usage();
+			return 1;
+		}
+	}
+
+	getrusage(RUSAGE_SELF, &ru0);
+	err = snd_config_update();
+	if (err < 0) {
+		fprintf(stderr, "snd_config_update: %s\n", snd_strerror(err));
+		return 1;
+	}
+	getrusage(RUSAGE_SELF, &ru1);
+	nodes = count_nodes(snd_config);
+	printf("config tree: %ld nodes, ~%ld KiB resident for the first load\n\n",
+	       nodes, ru1.ru_maxrss - ru0.ru_maxrss);
+
+	if (bench_update(1) < 0)
+		return 1;
+	if (bench_update(0) < 0)
+		return 1;
+	if (bench_expand() < 0)
+		return 1;
+	if (do_hints && bench_hints() < 0)
+		return 1;
+	if (ucmname && bench_ucm() < 0)
+		return 1;
+	snd_config_update_free_global();
+	return 0;
+}
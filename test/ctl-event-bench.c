@@ -0,0 +1,331 @@
+/*
+ * control event storm benchmark
+ *
+ * The tool adds a set of user controls to a card, then hammers them
+ * with value writes from a second control handle and drains the
+ * resulting events through the hctl and mixer layers.  Because the
+ * user controls are named like simple mixer volumes, every one of
+ * them also materializes as a simple mixer element, so the storm
+ * exercises the whole pipeline: kernel event queue, snd_ctl_read,
+ * snd_hctl_handle_events dispatch and the simple mixer's element
+ * re-reads.
+ *
+ * Reported per phase: writes issued, events delivered to element
+ * callbacks, handle_events calls and poll wakeups, events per second
+ * and the callback amplification per write.  A rising amplification
+ * factor is the signature of a layer re-reading more state per event
+ * than the event touched, which is exactly the regression this tool
+ * exists to catch.
+ *
+ * Needs a real control device with user control support; run it
+ * against a scratch card (e.g. snd-dummy).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <getopt.h>
+#include "../include/asoundlib.h"
+
+static const char *card = "default";
+static int nctls = 64;
+static int seconds = 2;
+static int burst = 16;
+
+static unsigned long long writes;
+static unsigned long long elem_events;
+static unsigned long long drain_calls;
+static unsigned long long wakeups;
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void ctl_name(char *buf, size_t size, int idx)
+{
+	snprintf(buf, size, "Bench%03d Playback Volume", idx);
+}
+
+static int add_controls(snd_ctl_t *ctl)
+{
+	snd_ctl_elem_id_t *id;
+	char name[44];
+	int i, err;
+
+	snd_ctl_elem_id_alloca(&id);
+	for (i = 0; i < nctls; i++) {
+		ctl_name(name, sizeof(name), i);
+		snd_ctl_elem_id_set_interface(id, SND_CTL_ELEM_IFACE_MIXER);
+		snd_ctl_elem_id_set_name(id, name);
+		err = snd_ctl_elem_add_integer(ctl, id, 1, 0, 255, 1);
+		if (err < 0) {
+			fprintf(stderr, "cannot add user control '%s': %s\n",
+				name, snd_strerror(err));
+			return err;
+		}
+	}
+	return 0;
+}
+
+static void remove_controls(snd_ctl_t *ctl)
+{
+	snd_ctl_elem_id_t *id;
+	char name[44];
+	int i;
+
+	snd_ctl_elem_id_alloca(&id);
+	for (i = 0; i < nctls; i++) {
+		ctl_name(name, sizeof(name), i);
+		snd_ctl_elem_id_set_interface(id, SND_CTL_ELEM_IFACE_MIXER);
+		snd_ctl_elem_id_set_name(id, name);
+		snd_ctl_elem_remove(ctl, id);
+	}
+}
+
+static int write_burst(snd_ctl_t *ctl, int *next, long *val)
+{
+	snd_ctl_elem_value_t *value;
+	char name[44];
+	int i, err;
+
+	snd_ctl_elem_value_alloca(&value);
+	for (i = 0; i < burst; i++) {
+		ctl_name(name, sizeof(name), *next);
+		snd_ctl_elem_value_set_interface(value,
+						 SND_CTL_ELEM_IFACE_MIXER);
+		snd_ctl_elem_value_set_name(value, name);
+		snd_ctl_elem_value_set_integer(value, 0, *val & 0xff);
+		err = snd_ctl_elem_write(ctl, value);
+		if (err < 0) {
+			fprintf(stderr, "elem write failed: %s\n",
+				snd_strerror(err));
+			return err;
+		}
+		writes++;
+		if (++*next >= nctls) {
+			*next = 0;
+			(*val)++;
+		}
+	}
+	return 0;
+}
+
+static int hctl_elem_cb(snd_hctl_elem_t *elem ATTRIBUTE_UNUSED,
+			unsigned int mask)
+{
+	if (mask & SND_CTL_EVENT_MASK_VALUE)
+		elem_events++;
+	return 0;
+}
+
+static int hctl_cb(snd_hctl_t *hctl ATTRIBUTE_UNUSED, unsigned int mask,
+		   snd_hctl_elem_t *elem)
+{
+	/* hook newly added elements so their value events are counted */
+	if ((mask & SND_CTL_EVENT_MASK_ADD) && elem)
+		snd_hctl_elem_set_callback(elem, hctl_elem_cb);
+	return 0;
+}
+
+static int mixer_elem_cb(snd_mixer_elem_t *elem ATTRIBUTE_UNUSED,
+			 unsigned int mask)
+{
+	if (mask & SND_CTL_EVENT_MASK_VALUE)
+		elem_events++;
+	return 0;
+}
+
+static int mixer_cb(snd_mixer_t *mixer ATTRIBUTE_UNUSED, unsigned int mask,
+		    snd_mixer_elem_t *elem)
+{
+	if ((mask & SND_CTL_EVENT_MASK_ADD) && elem)
+		snd_mixer_elem_set_callback(elem, mixer_elem_cb);
+	return 0;
+}
+
+static int drain(struct pollfd *pfds, int npfds,
+		 int (*handler)(void *), void *handle)
+{
+	int err;
+
+	while ((err = poll(pfds, npfds, 0)) > 0) {
+		wakeups++;
+		drain_calls++;
+		err = handler(handle);
+		if (err < 0)
+			return err;
+	}
+	return err;
+}
+
+static int hctl_handler(void *handle)
+{
+	int err = snd_hctl_handle_events(handle);
+	return err < 0 ? err : 0;
+}
+
+static int mixer_handler(void *handle)
+{
+	int err = snd_mixer_handle_events(handle);
+	return err < 0 ? err : 0;
+}
+
+static void report(const char *phase, unsigned long long ns)
+{
+	printf("%-6s %9llu writes %9llu events %8llu drains %8llu wakeups"
+	       " %9.0f ev/s %6.2f ev/write\n",
+	       phase, writes, elem_events, drain_calls, wakeups,
+	       elem_events * 1.0e9 / ns,
+	       writes ? (double)elem_events / writes : 0.0);
+}
+
+static int run_hctl(snd_ctl_t *writer)
+{
+	snd_hctl_t *hctl;
+	snd_hctl_elem_t *elem;
+	struct pollfd pfds[4];
+	unsigned long long t0, end;
+	long val = 0;
+	int next = 0, npfds, err;
+
+	err = snd_hctl_open(&hctl, card, SND_CTL_NONBLOCK);
+	if (err < 0) {
+		fprintf(stderr, "hctl open failed: %s\n", snd_strerror(err));
+		return err;
+	}
+	snd_hctl_set_callback(hctl, hctl_cb);
+	err = snd_hctl_load(hctl);
+	if (err < 0)
+		goto _out;
+	for (elem = snd_hctl_first_elem(hctl); elem;
+	     elem = snd_hctl_elem_next(elem))
+		snd_hctl_elem_set_callback(elem, hctl_elem_cb);
+	err = snd_ctl_subscribe_events(snd_hctl_ctl(hctl), 1);
+	if (err < 0)
+		goto _out;
+	npfds = snd_hctl_poll_descriptors(hctl, pfds, 4);
+	writes = elem_events = drain_calls = wakeups = 0;
+	t0 = now_ns();
+	end = t0 + (unsigned long long)seconds * 1000000000ULL;
+	do {
+		err = write_burst(writer, &next, &val);
+		if (err < 0)
+			goto _out;
+		err = drain(pfds, npfds, hctl_handler, hctl);
+		if (err < 0)
+			goto _out;
+	} while (now_ns() < end);
+	report("hctl", now_ns() - t0);
+	err = 0;
+ _out:
+	if (err < 0)
+		fprintf(stderr, "hctl phase failed: %s\n", snd_strerror(err));
+	snd_hctl_close(hctl);
+	return err;
+}
+
+static int run_mixer(snd_ctl_t *writer)
+{
+	snd_mixer_t *mixer;
+	snd_mixer_elem_t *elem;
+	struct pollfd pfds[4];
+	unsigned long long t0, end;
+	long val = 0;
+	int next = 0, npfds, err;
+
+	err = snd_mixer_open(&mixer, 0);
+	if (err < 0) {
+		fprintf(stderr, "mixer open failed: %s\n", snd_strerror(err));
+		return err;
+	}
+	err = snd_mixer_attach(mixer, card);
+	if (err >= 0)
+		err = snd_mixer_selem_register(mixer, NULL, NULL);
+	snd_mixer_set_callback(mixer, mixer_cb);
+	if (err >= 0)
+		err = snd_mixer_load(mixer);
+	if (err < 0)
+		goto _out;
+	for (elem = snd_mixer_first_elem(mixer); elem;
+	     elem = snd_mixer_elem_next(elem))
+		snd_mixer_elem_set_callback(elem, mixer_elem_cb);
+	npfds = snd_mixer_poll_descriptors(mixer, pfds, 4);
+	writes = elem_events = drain_calls = wakeups = 0;
+	t0 = now_ns();
+	end = t0 + (unsigned long long)seconds * 1000000000ULL;
+	do {
+		err = write_burst(writer, &next, &val);
+		if (err < 0)
+			goto _out;
+		err = drain(pfds, npfds, mixer_handler, mixer);
+		if (err < 0)
+			goto _out;
+	} while (now_ns() < end);
+	report("mixer", now_ns() - t0);
+	err = 0;
+ _out:
+	if (err < 0)
+		fprintf(stderr, "mixer phase failed: %s\n", snd_strerror(err));
+	snd_mixer_close(mixer);
+	return err;
+}
+
+static void usage(void)
+{
+	printf("usage: ctl-event-bench [options]\n"
+	       "  -D name   control device (default 'default')\n"
+	       "  -n count  user controls to add (default 64)\n"
+	       "  -b count  writes per burst before draining (default 16)\n"
+	       "  -s secs   seconds per phase (default 2)\n");
+}
+
+int main(int argc, char **argv)
+{
+	snd_ctl_t *writer;
+	int c, err;
+
+	while ((c = getopt(argc, argv, "D:n:b:s:h")) != -1) {
+		switch (c) {
+		case 'D':
+			card = optarg;
+			break;
+		case 'n':
+			nctls = atoi(optarg);
+			break;
+		case 'b':
+			burst = atoi(optarg);
+			break;
+		case 's':
+			seconds = atoi(optarg);
+			break;
+		default:
+			usage();
+			return c == 'h' ? 0 : 1;
+		}
+	}
+	err = snd_ctl_open(&writer, card, 0);
+	if (err < 0) {
+		fprintf(stderr, "cannot open control '%s': %s\n", card,
+			snd_strerror(err));
+		return 1;
+	}
+	err = add_controls(writer);
+	if (err < 0) {
+		snd_ctl_close(writer);
+		return 1;
+	}
+	printf("# card %s, %d user controls, burst %d, %d s per phase\n",
+	       card, nctls, burst, seconds);
+	err = run_hctl(writer);
+	if (err >= 0)
+		err = run_mixer(writer);
+	remove_controls(writer);
+	snd_ctl_close(writer);
+	return err < 0 ? 1 : 0;
+}
@@ -68,6 +68,8 @@ int resample = 1;
 int sys_latency = 0;		/* data I/O: use system timings instead driver wakeups */
 int pos_dump = 0;		/* dump positions */
 int realtime_check = 0;
+int histogram = 0;		/* collect/print wakeup-to-commit latencies */
+int sweep = 0;			/* sweep all latencies from min to max */
 unsigned long loop_limit;
 snd_pcm_uframes_t playback_buffer_size;
 
@@ -84,6 +86,106 @@ void timestamp_now(timestamp_t *tstamp)
 		printf("clock_gettime() failed\n");
 }
 
+/*
+ * HDR-style log-linear histogram of microsecond latencies: values below
+ * 2^HIST_SUB_BITS go to unit-wide buckets, each higher power of two is
+ * split into 2^HIST_SUB_BITS linear sub-buckets, values above ~16s are
+ * clamped into the last bucket
+ */
+#define HIST_SUB_BITS	5
+#define HIST_SUB_COUNT	(1 << HIST_SUB_BITS)
+#define HIST_MAX_POW	24
+#define HIST_BUCKETS	((HIST_MAX_POW - HIST_SUB_BITS + 2) * HIST_SUB_COUNT)
+
+static unsigned long hist_count[HIST_BUCKETS];
+static unsigned long long hist_total, hist_sum;
+static long long hist_min, hist_max;
+
+void hist_reset(void)
+{
+	memset(hist_count, 0, sizeof(hist_count));
+	hist_total = hist_sum = 0;
+	hist_min = -1;
+	hist_max = 0;
+}
+
+static int hist_bucket(long long us)
+{
+	int pow2;
+
+	if (us < 0)
+		us = 0;
+	if (us < HIST_SUB_COUNT)
+		return us;
+	if (us >= (1LL << (HIST_MAX_POW + 1)))
+		us = (1LL << (HIST_MAX_POW + 1)) - 1;
+	pow2 = 63 - __builtin_clzll(us);
+	return (pow2 - HIST_SUB_BITS + 1) * HIST_SUB_COUNT +
+	       ((us - (1LL << pow2)) >> (pow2 - HIST_SUB_BITS));
+}
+
+/* lower bound of a bucket in microseconds */
+static long long hist_bucket_low(int idx)
+{
+	int pow2;
+
+	if (idx < HIST_SUB_COUNT)
+		return idx;
+	pow2 = idx / HIST_SUB_COUNT + HIST_SUB_BITS - 1;
+	return (1LL << pow2) +
+	       ((long long)(idx % HIST_SUB_COUNT) << (pow2 - HIST_SUB_BITS));
+}
+
+void hist_record(long long us)
+{
+	hist_count[hist_bucket(us)]++;
+	hist_total++;
+	hist_sum += us;
+	if (hist_min < 0 || us < hist_min)
+		hist_min = us;
+	if (us > hist_max)
+		hist_max = us;
+}
+
+/* upper bound estimate of the bucket holding the given percentile */
+long long hist_percentile(double pct)
+{
+	unsigned long long limit, cum = 0;
+	int i;
+
+	limit = (unsigned long long)((pct / 100.0) * hist_total + 0.5);
+	if (limit < 1)
+		limit = 1;
+	for (i = 0; i < HIST_BUCKETS; i++) {
+		cum += hist_count[i];
+		if (cum >= limit)
+			return hist_bucket_low(i + 1);
+	}
+	return hist_max;
+}
+
+void hist_print(void)
+{
+	static const double pcts[] = { 50.0, 90.0, 99.0, 99.9, 99.99 };
+	unsigned int i;
+
+	if (hist_total == 0) {
+		printf("No wakeup-to-commit latencies recorded\n");
+		return;
+	}
+	printf("Wakeup-to-commit latency histogram (%llu periods):\n", hist_total);
+	for (i = 0; i < HIST_BUCKETS; i++) {
+		if (!hist_count[i])
+			continue;
+		printf("  %8lld - %8lldus: %lu\n", hist_bucket_low(i),
+		       hist_bucket_low(i + 1), hist_count[i]);
+	}
+	printf("  min %lldus, mean %.1fus, max %lldus\n",
+	       hist_min, (double)hist_sum / hist_total, hist_max);
+	for (i = 0; i < sizeof(pcts) / sizeof(pcts[0]); i++)
+		printf("  p%-6g <= %lldus\n", pcts[i], hist_percentile(pcts[i]));
+}
+
 long long timestamp_diff_micro(timestamp_t *tstamp)
 {
 	timestamp_t now, diff;
@@ -536,6 +638,12 @@ void help(void)
 "-x,--posdump   dump buffer positions\n"
 "-X,--realtime  do a realtime check (buffering)\n"
 "-O,--policy    set scheduler policy (RR, FIFO or OTHER)\n"
+"-H,--histogram collect per-period wakeup-to-commit latencies and print\n"
+"               a histogram with percentiles (p50..p99.99) per run\n"
+"-S,--sweep     benchmark mode: run every latency from min to max\n"
+"               (doubling), do not stop at the first success; combine\n"
+"               with -H to compare plugin chains (plug/rate/dmix/...)\n"
+"               passed as -P/-C devices\n"
 );
         printf("Recognized sample formats are:");
         for (k = 0; k < SND_PCM_FORMAT_LAST; ++k) {
@@ -577,6 +685,8 @@ int main(int argc, char *argv[])
 		{"posdump", 0, NULL, 'x'},
 		{"realtime", 0, NULL, 'X'},
 		{"policy", 1, NULL, 'O'},
+		{"histogram", 0, NULL, 'H'},
+		{"sweep", 0, NULL, 'S'},
 		{NULL, 0, NULL, 0},
 	};
 	snd_pcm_t *phandle, *chandle;
@@ -586,12 +696,12 @@ int main(int argc, char *argv[])
 	snd_timestamp_t p_tstamp, c_tstamp;
 	ssize_t r, cap_avail, cap_avail_max, pbk_fill, pbk_fill_min;
 	size_t frames_in, frames_out, in_max;
-	timestamp_t tstamp_start;
+	timestamp_t tstamp_start, tstamp_cycle;
 	int effect = 0;
 	morehelp = 0;
 	while (1) {
 		int c;
-		if ((c = getopt_long(argc, argv, "hP:C:m:M:U:F:f:c:r:B:E:s:y:O:bpenxX", long_option, NULL)) < 0)
+		if ((c = getopt_long(argc, argv, "hP:C:m:M:U:F:f:c:r:B:E:s:y:O:bpenxXHS", long_option, NULL)) < 0)
 			break;
 		switch (c) {
 		case 'h':
@@ -668,6 +778,12 @@ int main(int argc, char *argv[])
 		case 'O':
 			sched_policy = optarg;
 			break;
+		case 'H':
+			histogram = 1;
+			break;
+		case 'S':
+			sweep = 1;
+			break;
 		}
 	}
 
@@ -734,9 +850,14 @@ int main(int argc, char *argv[])
 
 	cap_avail_max = 0;
 	pbk_fill_min = latency * 2;
-			  
+
+	if (sweep)
+		buffer_size = latency_min;
+
 	while (1) {
 		frames_in = frames_out = 0;
+		if (histogram)
+			hist_reset();
 		if (setparams(phandle, chandle, &latency) < 0)
 			break;
 		showlatency(latency);
@@ -792,6 +913,8 @@ int main(int argc, char *argv[])
 			} else if (!block && usleep_val > 0) {
 				usleep(usleep_val);
 			}
+			if (histogram)
+				timestamp_now(&tstamp_cycle);
 			if (pos_dump || realtime_check) {
 				if (sys_latency <= 0)
 					cap_avail = get_avail(chandle);
@@ -821,6 +944,8 @@ int main(int argc, char *argv[])
 					applyeffect(buffer, r);
 			 	if (writebuf(phandle, buffer, r, &frames_out) < 0)
 					ok = 0;
+				else if (histogram && r > 0)
+					hist_record(timestamp_diff_micro(&tstamp_cycle));
 			}
 		}
 		if (ok)
@@ -832,6 +957,8 @@ int main(int argc, char *argv[])
 		printf("Capture:\n");
 		showstat(chandle, frames_in);
 		showinmax(in_max);
+		if (histogram)
+			hist_print();
 		if (p_tstamp.tv_sec == c_tstamp.tv_sec &&
 		    p_tstamp.tv_usec == c_tstamp.tv_usec)
 			printf("Hardware sync\n");
@@ -855,7 +982,14 @@ int main(int argc, char *argv[])
 			       (int)c_tstamp.tv_usec,
 			       timediff(p_tstamp, c_tstamp));
 #endif
-			break;
+			if (!sweep)
+				break;
+		}
+		if (sweep) {
+			/* benchmark mode: walk all latencies up to the maximum */
+			buffer_size *= 2;
+			if (buffer_size > latency_max)
+				break;
 		}
 		snd_pcm_unlink(chandle);
 		snd_pcm_hw_free(phandle);
@@ -0,0 +1,364 @@
+/*
+ * throughput benchmark for whole PCM plugin chains
+ *
+ * The tool builds a chain of conversion plugins from a spec string
+ * (application side first), stacks it on top of a null sink and runs
+ * timed transfers through it.  Because the null device consumes
+ * frames immediately, the loop never blocks and the measured time is
+ * the pure processing cost of the chain.  Every prefix of the chain
+ * is measured separately - the sink alone, then with the innermost
+ * plugin, and so on - so the difference between two neighbouring rows
+ * is the cost of exactly one layer at the position it really runs in,
+ * including the access and format negotiation the outer layers force
+ * on it.  The frame accounting comes from the runtime statistics
+ * counters (snd_pcm_stats_get), not from the loop itself.
+ *
+ * Example:
+ *	pcm-chain-bench -c plug,rate=44100,linear=S32_LE -p 256
+ * measures null, linear->null, rate->linear->null and the full
+ * plug->rate->linear->null stack with 256 frame periods and prints
+ * one row per prefix plus the per-layer cost table.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include "../include/asoundlib.h"
+
+#define MAX_LAYERS	16
+
+static const char *chain = "plug,rate=44100";
+static const char *sink = "null";
+static int seconds = 2;
+static int periodsize = 1024;
+static int channels = 2;
+static int rate = 48000;
+static int use_mmap = 0;
+static snd_pcm_format_t format = SND_PCM_FORMAT_S16_LE;
+
+struct layer {
+	char name[16];
+	char arg[32];
+};
+
+struct result {
+	unsigned long long frames;
+	unsigned long long wall_ns;
+	unsigned long long cpu_ns;
+	unsigned long long waits;
+	unsigned long long wakeups;
+};
+
+static unsigned long long now_ns(clockid_t clock)
+{
+	struct timespec ts;
+
+	clock_gettime(clock, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int parse_chain(struct layer *layers)
+{
+	char *spec = strdup(chain);
+	char *tok, *arg, *save = NULL;
+	int count = 0;
+
+	if (spec == NULL)
+		return -ENOMEM;
+	for (tok = strtok_r(spec, ",", &save); tok;
+	     tok = strtok_r(NULL, ",", &save)) {
+		if (count >= MAX_LAYERS) {
+			fprintf(stderr, "too many layers (max %d)\n",
+				MAX_LAYERS);
+			free(spec);
+			return -EINVAL;
+		}
+		arg = strchr(tok, '=');
+		if (arg)
+			*arg++ = '\0';
+		snprintf(layers[count].name, sizeof(layers[count].name),
+			 "%s", tok);
+		snprintf(layers[count].arg, sizeof(layers[count].arg),
+			 "%s", arg ? arg : "");
+		count++;
+	}
+	free(spec);
+	if (count == 0) {
+		fprintf(stderr, "empty chain spec\n");
+		return -EINVAL;
+	}
+	return count;
+}
+
+/* append the definition for prefix pcm __l<idx> wrapping __l<idx-1>;
+ * the layer types mirror the configuration the plugins document in
+ * pcm_plugins.
+ */
+static int emit_layer(char *buf, size_t size, int idx,
+		      const struct layer *l)
+{
+	size_t len = strlen(buf);
+	char *p = buf + len;
+	int n, c;
+
+	size -= len;
+	if (strcmp(l->name, "plug") == 0)
+		n = snprintf(p, size, "pcm.__l%d { type plug slave.pcm \"__l%d\" }\n",
+			     idx, idx - 1);
+	else if (strcmp(l->name, "copy") == 0 ||
+		 strcmp(l->name, "empty") == 0)
+		n = snprintf(p, size, "pcm.__l%d { type %s slave.pcm \"__l%d\" }\n",
+			     idx, l->name, idx - 1);
+	else if (strcmp(l->name, "rate") == 0)
+		n = snprintf(p, size, "pcm.__l%d { type rate slave { pcm \"__l%d\" rate %s } }\n",
+			     idx, idx - 1, l->arg[0] ? l->arg : "44100");
+	else if (strcmp(l->name, "linear") == 0 ||
+		 strcmp(l->name, "lfloat") == 0 ||
+		 strcmp(l->name, "mulaw") == 0 ||
+		 strcmp(l->name, "alaw") == 0 ||
+		 strcmp(l->name, "adpcm") == 0) {
+		if (!l->arg[0]) {
+			fprintf(stderr, "layer '%s' needs a slave format (e.g. %s=S32_LE)\n",
+				l->name, l->name);
+			return -EINVAL;
+		}
+		n = snprintf(p, size, "pcm.__l%d { type %s slave { pcm \"__l%d\" format %s } }\n",
+			     idx, l->name, idx - 1, l->arg);
+	} else if (strcmp(l->name, "route") == 0) {
+		n = snprintf(p, size, "pcm.__l%d { type route slave.pcm \"__l%d\"",
+			     idx, idx - 1);
+		for (c = 0; c < channels && n > 0 && (size_t)n < size; c++)
+			n += snprintf(p + n, size - n, " ttable.%d.%d 1", c, c);
+		if (n > 0 && (size_t)n < size)
+			n += snprintf(p + n, size - n, " }\n");
+	} else if (strcmp(l->name, "softvol") == 0)
+		n = snprintf(p, size, "pcm.__l%d { type softvol slave.pcm \"__l%d\" control.name \"Chain Bench\" }\n",
+			     idx, idx - 1);
+	else {
+		fprintf(stderr, "unknown layer type '%s'\n", l->name);
+		return -EINVAL;
+	}
+	if (n < 0 || (size_t)n >= size) {
+		fprintf(stderr, "chain configuration too long\n");
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+static int build_config(snd_config_t **top, const struct layer *layers,
+			int count)
+{
+	char buf[8192];
+	snd_input_t *input;
+	int i, err;
+
+	if (strcmp(sink, "null") == 0)
+		snprintf(buf, sizeof(buf), "pcm.__l0 { type null }\n");
+	else
+		snprintf(buf, sizeof(buf), "pcm.__l0 { type empty slave.pcm \"%s\" }\n",
+			 sink);
+	/* the spec lists the application side first, __l1 wraps the sink */
+	for (i = 0; i < count; i++) {
+		err = emit_layer(buf, sizeof(buf), i + 1,
+				 &layers[count - 1 - i]);
+		if (err < 0)
+			return err;
+	}
+	err = snd_config_top(top);
+	if (err < 0)
+		return err;
+	err = snd_input_buffer_open(&input, buf, strlen(buf));
+	if (err < 0)
+		return err;
+	err = snd_config_load(*top, input);
+	snd_input_close(input);
+	return err;
+}
+
+static int run_one(snd_config_t *top, int prefix, struct result *res)
+{
+	char name[16];
+	snd_pcm_t *pcm;
+	snd_pcm_hw_params_t *params;
+	snd_pcm_uframes_t psize = periodsize;
+	snd_pcm_stats_t stats;
+	unsigned long long end, wall0, cpu0;
+	short *buf;
+	int err, dir = 0;
+
+	memset(res, 0, sizeof(*res));
+	snprintf(name, sizeof(name), "__l%d", prefix);
+	err = snd_pcm_open_lconf(&pcm, name, SND_PCM_STREAM_PLAYBACK, 0, top);
+	if (err < 0) {
+		fprintf(stderr, "%s: open failed: %s\n", name,
+			snd_strerror(err));
+		return err;
+	}
+	snd_pcm_hw_params_alloca(&params);
+	snd_pcm_hw_params_any(pcm, params);
+	err = snd_pcm_hw_params_set_access(pcm, params, use_mmap ?
+					   SND_PCM_ACCESS_MMAP_INTERLEAVED :
+					   SND_PCM_ACCESS_RW_INTERLEAVED);
+	if (err >= 0)
+		err = snd_pcm_hw_params_set_format(pcm, params, format);
+	if (err >= 0)
+		err = snd_pcm_hw_params_set_channels(pcm, params, channels);
+	if (err >= 0)
+		err = snd_pcm_hw_params_set_rate(pcm, params, rate, 0);
+	if (err >= 0)
+		err = snd_pcm_hw_params_set_period_size_near(pcm, params,
+							     &psize, &dir);
+	if (err >= 0)
+		err = snd_pcm_hw_params(pcm, params);
+	if (err < 0) {
+		fprintf(stderr, "%s: hw_params failed: %s\n", name,
+			snd_strerror(err));
+		snd_pcm_close(pcm);
+		return err;
+	}
+	buf = calloc(psize, (snd_pcm_format_physical_width(format) / 8) *
+		     channels);
+	if (buf == NULL) {
+		snd_pcm_close(pcm);
+		return -ENOMEM;
+	}
+	for (end = 0; end < psize * channels; end++)
+		buf[end] = (short)(end * 123);
+	snd_pcm_stats_enable(pcm, 1);
+	err = snd_pcm_prepare(pcm);
+	if (err < 0)
+		goto _out;
+	wall0 = now_ns(CLOCK_MONOTONIC);
+	cpu0 = now_ns(CLOCK_PROCESS_CPUTIME_ID);
+	end = wall0 + (unsigned long long)seconds * 1000000000ULL;
+	do {
+		snd_pcm_sframes_t r;
+
+		if (use_mmap)
+			r = snd_pcm_mmap_writei(pcm, buf, psize);
+		else
+			r = snd_pcm_writei(pcm, buf, psize);
+		if (r < 0)
+			r = snd_pcm_recover(pcm, r, 1);
+		if (r < 0) {
+			err = r;
+			goto _out;
+		}
+	} while (now_ns(CLOCK_MONOTONIC) < end);
+	res->cpu_ns = now_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu0;
+	res->wall_ns = now_ns(CLOCK_MONOTONIC) - wall0;
+	err = snd_pcm_stats_get(pcm, &stats);
+	if (err < 0)
+		goto _out;
+	res->frames = use_mmap ? stats.mmap_commit_frames :
+		      stats.frames_written;
+	res->waits = stats.waits;
+	res->wakeups = stats.wakeups;
+	err = 0;
+ _out:
+	if (err < 0)
+		fprintf(stderr, "%s: transfer failed: %s\n", name,
+			snd_strerror(err));
+	free(buf);
+	snd_pcm_drop(pcm);
+	snd_pcm_close(pcm);
+	return err;
+}
+
+static void usage(void)
+{
+	printf("usage: pcm-chain-bench [options]\n"
+	       "  -c spec    chain layers, application side first\n"
+	       "             (plug, rate=R, linear=FMT, lfloat=FMT, mulaw=FMT,\n"
+	       "              alaw=FMT, adpcm=FMT, route, softvol, copy, empty)\n"
+	       "  -D dev     sink device (default null)\n"
+	       "  -p frames  period size (default 1024)\n"
+	       "  -n chans   channels (default 2)\n"
+	       "  -r rate    stream rate (default 48000)\n"
+	       "  -f fmt     stream format (default S16_LE)\n"
+	       "  -s secs    seconds per measurement (default 2)\n"
+	       "  -m         use the mmap transfer path\n");
+}
+
+int main(int argc, char **argv)
+{
+	struct layer layers[MAX_LAYERS];
+	struct result res[MAX_LAYERS + 1];
+	snd_config_t *top;
+	int i, c, count, err;
+
+	while ((c = getopt(argc, argv, "c:D:p:n:r:f:s:mh")) != -1) {
+		switch (c) {
+		case 'c':
+			chain = optarg;
+			break;
+		case 'D':
+			sink = optarg;
+			break;
+		case 'p':
+			periodsize = atoi(optarg);
+			break;
+		case 'n':
+			channels = atoi(optarg);
+			break;
+		case 'r':
+			rate = atoi(optarg);
+			break;
+		case 'f':
+			format = snd_pcm_format_value(optarg);
+			if (format == SND_PCM_FORMAT_UNKNOWN) {
+				fprintf(stderr, "unknown format '%s'\n",
+					optarg);
+				return 1;
+			}
+			break;
+		case 's':
+			seconds = atoi(optarg);
+			break;
+		case 'm':
+			use_mmap = 1;
+			break;
+		default:
+			usage();
+			return c == 'h' ? 0 : 1;
+		}
+	}
+	count = parse_chain(layers);
+	if (count < 0)
+		return 1;
+	err = build_config(&top, layers, count);
+	if (err < 0) {
+		fprintf(stderr, "cannot build chain configuration: %s\n",
+			snd_strerror(err));
+		return 1;
+	}
+	printf("# chain %s, sink %s, %d ch %s %d Hz, period %d, %s path\n",
+	       chain, sink, channels, snd_pcm_format_name(format), rate,
+	       periodsize, use_mmap ? "mmap" : "writei");
+	printf("%-24s %12s %10s %10s %8s %8s\n", "stack", "frames/s",
+	       "ns/frame", "cpu/frame", "waits", "wakeups");
+	for (i = 0; i <= count; i++) {
+		const char *label = i == 0 ? "(sink)" :
+				    layers[count - i].name;
+
+		err = run_one(top, i, &res[i]);
+		if (err < 0)
+			return 1;
+		printf("%-24s %12.0f %10.1f %10.1f %8llu %8llu\n",
+		       label,
+		       res[i].frames * 1.0e9 / res[i].wall_ns,
+		       (double)res[i].wall_ns / res[i].frames,
+		       (double)res[i].cpu_ns / res[i].frames,
+		       res[i].waits, res[i].wakeups);
+	}
+	printf("\n# per-layer cost (difference to the stack below)\n");
+	printf("%-24s %10s\n", "layer", "cpu/frame");
+	for (i = 1; i <= count; i++)
+		printf("%-24s %10.1f\n", layers[count - i].name,
+		       (double)res[i].cpu_ns / res[i].frames -
+		       (double)res[i - 1].cpu_ns / res[i - 1].frames);
+	snd_config_delete(top);
+	return 0;
+}
@@ -0,0 +1,262 @@
+/*
+ * contention benchmark for the direct (dmix/dshare/dsnoop) plugins
+ *
+ * The tool forks N clients against the given device and lets each of
+ * them run a plain wait/write (or wait/read for capture) period loop
+ * for a fixed time.  Every client measures the time it spends blocked
+ * in snd_pcm_wait() and the time the transfer itself takes - for the
+ * direct plugins the latter includes taking the IPC semaphore and
+ * running the mix kernel - and reports the totals to the parent over
+ * a pipe.  The parent aggregates them into one CSV row per client
+ * count, so sweeping 1..N shows how the mixing cost, the wakeup
+ * fan-out and the achieved throughput scale with contention.
+ *
+ * The measurement loop uses only the public API, so the tool runs
+ * against any device; pointing it at a dmix/dshare/dsnoop definition
+ * on top of a loopback or null slave gives the plugin scaling figures
+ * without real hardware.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <getopt.h>
+#include "../include/asoundlib.h"
+
+#define MAX_CLIENTS	64
+
+static const char *pcmdev = "default";
+static int stream = SND_PCM_STREAM_PLAYBACK;
+static int max_clients = 8;
+static int step = 1;
+static int seconds = 2;
+static int periodsize = 1024;
+static int channels = 2;
+static int rate = 48000;
+static snd_pcm_format_t format = SND_PCM_FORMAT_S16_LE;
+
+struct client_report {
+	unsigned long long periods;
+	unsigned long long frames;
+	unsigned long long wakeups;
+	unsigned long long wait_ns;	/* total time blocked in snd_pcm_wait */
+	unsigned long long xfer_ns;	/* total time in the transfer call */
+	unsigned long long max_wait_ns;
+	int error;
+};
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int run_client(struct client_report *rep)
+{
+	snd_pcm_t *pcm;
+	char *buf;
+	unsigned long long end, t0, t1, t2;
+	int err;
+
+	memset(rep, 0, sizeof(*rep));
+	err = snd_pcm_open(&pcm, pcmdev, stream, 0);
+	if (err < 0)
+		goto _error;
+	err = snd_pcm_set_params(pcm, format, SND_PCM_ACCESS_RW_INTERLEAVED,
+				 channels, rate, 1,
+				 ((unsigned long long)periodsize * 4 * 1000000) / rate);
+	if (err < 0)
+		goto _close;
+	buf = calloc(periodsize, (snd_pcm_format_physical_width(format) / 8) * channels);
+	if (buf == NULL) {
+		err = -ENOMEM;
+		goto _close;
+	}
+	if (stream == SND_PCM_STREAM_CAPTURE) {
+		err = snd_pcm_start(pcm);
+		if (err < 0)
+			goto _free;
+	}
+	end = now_ns() + seconds * 1000000000ULL;
+	while ((t0 = now_ns()) < end) {
+		err = snd_pcm_wait(pcm, 1000);
+		t1 = now_ns();
+		if (err < 0) {
+			err = snd_pcm_recover(pcm, err, 1);
+			if (err < 0)
+				break;
+			continue;
+		}
+		rep->wakeups++;
+		if (stream == SND_PCM_STREAM_PLAYBACK)
+			err = snd_pcm_writei(pcm, buf, periodsize);
+		else
+			err = snd_pcm_readi(pcm, buf, periodsize);
+		t2 = now_ns();
+		if (err < 0) {
+			err = snd_pcm_recover(pcm, err, 1);
+			if (err < 0)
+				break;
+			continue;
+		}
+		rep->periods++;
+		rep->frames += err;
+		rep->wait_ns += t1 - t0;
+		rep->xfer_ns += t2 - t1;
+		if (t1 - t0 > rep->max_wait_ns)
+			rep->max_wait_ns = t1 - t0;
+		err = 0;
+	}
+	if (stream == SND_PCM_STREAM_PLAYBACK && err >= 0)
+		snd_pcm_drain(pcm);
+ _free:
+	free(buf);
+ _close:
+	snd_pcm_close(pcm);
+ _error:
+	rep->error = err < 0 ? err : 0;
+	return rep->error;
+}
+
+static int run_round(int clients)
+{
+	int fds[MAX_CLIENTS][2];
+	pid_t pids[MAX_CLIENTS];
+	struct client_report rep, sum;
+	unsigned long long max_wait = 0;
+	int i, status, failed = 0;
+
+	memset(&sum, 0, sizeof(sum));
+	for (i = 0; i < clients; i++) {
+		if (pipe(fds[i]) < 0) {
+			perror("pipe");
+			return 1;
+		}
+		pids[i] = fork();
+		if (pids[i] < 0) {
+			perror("fork");
+			return 1;
+		}
+		if (pids[i] == 0) {
+			close(fds[i][0]);
+			run_client(&rep);
+			if (write(fds[i][1], &rep, sizeof(rep)) != sizeof(rep))
+				_exit(1);
+			_exit(0);
+		}
+		close(fds[i][1]);
+	}
+	for (i = 0; i < clients; i++) {
+		if (read(fds[i][0], &rep, sizeof(rep)) != sizeof(rep) ||
+		    rep.error) {
+			if (rep.error)
+				fprintf(stderr, "client %d: %s\n",
+					i, snd_strerror(rep.error));
+			failed++;
+		} else {
+			sum.periods += rep.periods;
+			sum.frames += rep.frames;
+			sum.wakeups += rep.wakeups;
+			sum.wait_ns += rep.wait_ns;
+			sum.xfer_ns += rep.xfer_ns;
+			if (rep.max_wait_ns > max_wait)
+				max_wait = rep.max_wait_ns;
+		}
+		close(fds[i][0]);
+		waitpid(pids[i], &status, 0);
+	}
+	if (failed || !sum.periods) {
+		fprintf(stderr, "%d of %d clients failed\n", failed, clients);
+		return 1;
+	}
+	printf("%d,%llu,%.0f,%.2f,%.2f,%.2f,%.2f\n",
+	       clients,
+	       sum.periods,
+	       (double)sum.frames / seconds,
+	       (double)sum.wait_ns / sum.periods / 1000.0,
+	       (double)max_wait / 1000.0,
+	       (double)sum.xfer_ns / sum.periods / 1000.0,
+	       (double)sum.wakeups / ((double)sum.periods / clients));
+	fflush(stdout);
+	return 0;
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: pcm-direct-bench [-options]\n");
+	fprintf(stderr, "  -D str  Set device name (a dmix/dshare/dsnoop definition)\n");
+	fprintf(stderr, "  -n val  Sweep up to this many concurrent clients\n");
+	fprintf(stderr, "  -i val  Client count increment per round\n");
+	fprintf(stderr, "  -t val  Seconds per round\n");
+	fprintf(stderr, "  -r val  Set sample rate\n");
+	fprintf(stderr, "  -p val  Set period size (in frame)\n");
+	fprintf(stderr, "  -c val  Set number of channels\n");
+	fprintf(stderr, "  -f str  Set PCM format\n");
+	fprintf(stderr, "  -s str  Set stream direction (playback or capture)\n");
+}
+
+int main(int argc, char **argv)
+{
+	int c, n;
+
+	while ((c = getopt(argc, argv, "D:n:i:t:r:p:c:f:s:h")) >= 0) {
+		switch (c) {
+		case 'D':
+			pcmdev = optarg;
+			break;
+		case 'n':
+			max_clients = atoi(optarg);
+			if (max_clients < 1 || max_clients > MAX_CLIENTS) {
+				fprintf(stderr, "invalid client count %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'i':
+			step = atoi(optarg);
+			if (step < 1)
+				step = 1;
+			break;
+		case 't':
+			seconds = atoi(optarg);
+			if (seconds < 1)
+				seconds = 1;
+			break;
+		case 'r':
+			rate = atoi(optarg);
+			break;
+		case 'p':
+			periodsize = atoi(optarg);
+			break;
+		case 'c':
+			channels = atoi(optarg);
+			break;
+		case 'f':
+			format = snd_pcm_format_value(optarg);
+			if (format == SND_PCM_FORMAT_UNKNOWN) {
+				fprintf(stderr, "invalid PCM format %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 's':
+			if (*optarg == 'c' || *optarg == 'C')
+				stream = SND_PCM_STREAM_CAPTURE;
+			else
+				stream = SND_PCM_STREAM_PLAYBACK;
+			break;
+		default:
+			usage();
+			return 1;
+		}
+	}
+
+	printf("clients,periods,frames_per_sec,avg_wait_us,max_wait_us,avg_xfer_us,wakeups_per_period\n");
+	for (n = 1; n <= max_clients; n += step)
+		if (run_round(n))
+			return 1;
+	return 0;
+}
@@ -0,0 +1,217 @@
+/*
+ * sequencer event throughput and latency benchmark
+ *
+ * Two client handles in one process: the sender pushes USR0 events in
+ * configurable bursts through snd_seq_event_output()/drain, the
+ * receiver thread reads them back.  Every event carries its submission
+ * time (CLOCK_MONOTONIC, stamped into the raw32 payload, so no running
+ * queue is needed), giving end-to-end enqueue-to-deliver latency
+ * percentiles next to the raw event rate.  The sender runs in
+ * non-blocking mode and counts how often the output pool refused an
+ * event (-EAGAIN), so pool-full stalls are visible, and it counts its
+ * drain calls, so the batching factor - events shipped per kernel
+ * round trip - can be read off directly.
+ *
+ * Typical use: vary -b (burst size) and -g (gap between bursts) and
+ * compare events/sec, drains per event and the latency tail.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <getopt.h>
+#include "../include/asoundlib.h"
+
+static int total_events = 100000;
+static int burst = 16;
+static int gap_us = 0;
+
+static snd_seq_t *rseq;
+static unsigned long long *latency;
+static int received;
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void *receiver(void *data ATTRIBUTE_UNUSED)
+{
+	snd_seq_event_t *ev;
+	unsigned long long sent;
+	int err;
+
+	while (received < total_events) {
+		err = snd_seq_event_input(rseq, &ev);
+		if (err < 0) {
+			if (err == -EAGAIN || err == -EINTR)
+				continue;
+			fprintf(stderr, "event_input: %s\n", snd_strerror(err));
+			break;
+		}
+		if (ev->type != SND_SEQ_EVENT_USR0)
+			continue;
+		sent = ((unsigned long long)ev->data.raw32.d[0] << 32) |
+			ev->data.raw32.d[1];
+		latency[received++] = now_ns() - sent;
+	}
+	return NULL;
+}
+
+static int cmp_ull(const void *a, const void *b)
+{
+	unsigned long long x = *(const unsigned long long *)a;
+	unsigned long long y = *(const unsigned long long *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: seq-bench [-options]\n");
+	fprintf(stderr, "  -n val  Total number of events\n");
+	fprintf(stderr, "  -b val  Events per burst\n");
+	fprintf(stderr, "  -g val  Gap between bursts (us)\n");
+}
+
+int main(int argc, char **argv)
+{
+	snd_seq_t *sseq;
+	snd_seq_event_t ev;
+	pthread_t rthread;
+	struct pollfd pfd;
+	unsigned long long t, start, stamp;
+	unsigned long long drains = 0, stalls = 0;
+	int sport, rport, rclient;
+	int c, i, sent, err;
+
+	while ((c = getopt(argc, argv, "n:b:g:h")) >= 0) {
+		switch (c) {
+		case 'n':
+			total_events = atoi(optarg);
+			if (total_events < 1)
+				total_events = 1;
+			break;
+		case 'b':
+			burst = atoi(optarg);
+			if (burst < 1)
+				burst = 1;
+			break;
+		case 'g':
+			gap_us = atoi(optarg);
+			break;
+		default:
+			usage();
+			return 1;
+		}
+	}
+
+	err = snd_seq_open(&sseq, "default", SND_SEQ_OPEN_OUTPUT, 0);
+	if (err < 0) {
+		fprintf(stderr, "cannot open sequencer: %s\n", snd_strerror(err));
+		return 1;
+	}
+	err = snd_seq_open(&rseq, "default", SND_SEQ_OPEN_INPUT, 0);
+	if (err < 0) {
+		fprintf(stderr, "cannot open sequencer: %s\n", snd_strerror(err));
+		return 1;
+	}
+	snd_seq_set_client_name(sseq, "bench sender");
+	snd_seq_set_client_name(rseq, "bench receiver");
+	rport = snd_seq_create_simple_port(rseq, "sink",
+			SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_SUBS_WRITE,
+			SND_SEQ_PORT_TYPE_MIDI_GENERIC);
+	sport = snd_seq_create_simple_port(sseq, "source",
+			SND_SEQ_PORT_CAP_READ | SND_SEQ_PORT_CAP_SUBS_READ,
+			SND_SEQ_PORT_TYPE_MIDI_GENERIC);
+	if (rport < 0 || sport < 0) {
+		fprintf(stderr, "cannot create ports\n");
+		return 1;
+	}
+	rclient = snd_seq_client_id(rseq);
+	err = snd_seq_connect_to(sseq, sport, rclient, rport);
+	if (err < 0) {
+		fprintf(stderr, "cannot connect: %s\n", snd_strerror(err));
+		return 1;
+	}
+	/* non-blocking sender so pool-full shows up as -EAGAIN */
+	snd_seq_nonblock(sseq, 1);
+
+	latency = calloc(total_events, sizeof(*latency));
+	if (latency == NULL)
+		return 1;
+	if (pthread_create(&rthread, NULL, receiver, NULL)) {
+		fprintf(stderr, "cannot create receiver thread\n");
+		return 1;
+	}
+
+	snd_seq_ev_clear(&ev);
+	ev.type = SND_SEQ_EVENT_USR0;
+	snd_seq_ev_set_source(&ev, sport);
+	snd_seq_ev_set_subs(&ev);
+	snd_seq_ev_set_direct(&ev);
+	pfd.fd = -1;
+
+	start = now_ns();
+	for (sent = 0; sent < total_events; ) {
+		for (i = 0; i < burst && sent < total_events; i++, sent++) {
+			stamp = now_ns();
+			ev.data.raw32.d[0] = stamp >> 32;
+			ev.data.raw32.d[1] = stamp & 0xffffffffULL;
+			while ((err = snd_seq_event_output(sseq, &ev)) == -EAGAIN) {
+				stalls++;
+				drains++;
+				snd_seq_drain_output(sseq);
+				if (snd_seq_poll_descriptors(sseq, &pfd, 1, POLLOUT) == 1)
+					poll(&pfd, 1, 100);
+			}
+			if (err < 0) {
+				fprintf(stderr, "event_output: %s\n",
+					snd_strerror(err));
+				return 1;
+			}
+		}
+		drains++;
+		while ((err = snd_seq_drain_output(sseq)) == -EAGAIN) {
+			stalls++;
+			if (snd_seq_poll_descriptors(sseq, &pfd, 1, POLLOUT) == 1)
+				poll(&pfd, 1, 100);
+		}
+		if (err < 0) {
+			fprintf(stderr, "drain_output: %s\n", snd_strerror(err));
+			return 1;
+		}
+		if (gap_us)
+			usleep(gap_us);
+	}
+	pthread_join(rthread, NULL);
+	t = now_ns() - start;
+
+	qsort(latency, received, sizeof(*latency), cmp_ull);
+	printf("events          : %d in %.3f ms\n", received, t / 1000000.0);
+	printf("throughput      : %.0f events/sec\n",
+	       received / ((double)t / 1000000000.0));
+	printf("drain calls     : %llu (%.2f events per drain)\n",
+	       drains, (double)received / drains);
+	printf("pool-full stalls: %llu\n", stalls);
+	if (received > 0) {
+		printf("latency p50     : %.1f us\n",
+		       latency[received / 2] / 1000.0);
+		printf("latency p90     : %.1f us\n",
+		       latency[received * 9 / 10] / 1000.0);
+		printf("latency p99     : %.1f us\n",
+		       latency[received * 99 / 100] / 1000.0);
+		printf("latency max     : %.1f us\n",
+		       latency[received - 1] / 1000.0);
+	}
+	free(latency);
+	snd_seq_close(sseq);
+	snd_seq_close(rseq);
+	return 0;
+}